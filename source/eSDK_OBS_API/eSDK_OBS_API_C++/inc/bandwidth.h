@@ -0,0 +1,59 @@
+/*********************************************************************************
+* Copyright 2024 Huawei Technologies Co.,Ltd.
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+* this file except in compliance with the License.  You may obtain a copy of the
+* License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed
+* under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+* CONDITIONS OF ANY KIND, either express or implied.  See the License for the
+* specific language governing permissions and limitations under the License.
+**********************************************************************************
+*/
+#ifndef BANDWIDTH_H
+#define BANDWIDTH_H
+
+#include <stddef.h>
+#include "eSDKOBS.h"
+
+#define BANDWIDTH_UPLOAD            0
+#define BANDWIDTH_DOWNLOAD          1
+#define BANDWIDTH_DIRECTIONS        2
+#define BANDWIDTH_MAX_LIMITERS      3         // 全局、桶、优先级
+
+struct bandwidth_limiter;
+
+/**
+ * 单个请求从开始到结束期间适用的限速器，随http_request保存
+ */
+typedef struct bandwidth_transfer
+{
+    struct bandwidth_limiter *limiters[BANDWIDTH_MAX_LIMITERS];
+    int limiter_count;
+    obs_bandwidth_priority priority;
+} bandwidth_transfer;
+
+/* 曾设置过任一限速时非0，未设置时读写回调直接返回 */
+extern volatile int g_bandwidth_enabled;
+
+void bandwidth_initialize(void);
+
+void bandwidth_deinitialize(void);
+
+/**
+ * 请求开始时登记到适用的限速器，用于优先级让行判断
+ */
+void bandwidth_transfer_begin(bandwidth_transfer *transfer, const char *bucket_name,
+    obs_bandwidth_priority priority);
+
+void bandwidth_transfer_end(bandwidth_transfer *transfer);
+
+/**
+ * 在curl读写回调中调用，按各限速器预约bytes字节并阻塞到允许的时刻。
+ * curl_multi驱动的请求会阻塞整个multi循环，其中各请求按整体限速
+ */
+void bandwidth_consume(bandwidth_transfer *transfer, int direction, size_t bytes);
+
+#endif /* BANDWIDTH_H */
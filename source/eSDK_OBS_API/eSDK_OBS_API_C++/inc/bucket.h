@@ -22,6 +22,7 @@
 #include "simplexml.h"
 #include "securec.h"
 #include "util.h"
+#include "xml_writer.h"
 #include "common.h"
 
 
@@ -322,9 +323,12 @@ typedef struct set_lifecycle_data
     obs_response_properties_callback    *response_properties_callback;
     obs_response_complete_callback      *response_complete_callback;
     void *callback_data;
-        
-    char doc[MAX_XML_LEN];
-    int docLen, docBytesWritten;
+
+    xml_writer writer;
+    obs_lifecycle_conf *bucket_lifecycle_conf;
+    unsigned int blcc_number;
+    char **storage_class;
+    int64_t doc_len;
     char doc_md5[64];
 } set_lifecycle_data;
 
@@ -418,8 +422,10 @@ typedef struct set_cors_config_data
     obs_response_complete_callback   *response_complete_callback;
     void *callback_data;
 
-    char doc[1024*100];
-    int  doc_len, doc_bytes_written;
+    xml_writer writer;
+    obs_bucket_cors_conf *obs_cors_conf_info;
+    unsigned int conf_num;
+    int64_t doc_len;
     char doc_md5[64];
 }set_cors_config_data;
 
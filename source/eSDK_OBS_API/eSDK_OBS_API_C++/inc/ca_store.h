@@ -0,0 +1,42 @@
+/*********************************************************************************
+* Copyright 2024 Huawei Technologies Co.,Ltd.
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+* this file except in compliance with the License.  You may obtain a copy of the
+* License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed
+* under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+* CONDITIONS OF ANY KIND, either express or implied.  See the License for the
+* specific language governing permissions and limitations under the License.
+**********************************************************************************
+*/
+#ifndef CA_STORE_H
+#define CA_STORE_H
+
+#include <curl/curl.h>
+#include <openssl/x509_vfy.h>
+
+void ca_store_initialize(void);
+
+void ca_store_deinitialize(void);
+
+/**
+ * 记录init_certificate_by_path加载到buffer的证书文件，之后以buffer为证书的请求
+ * 使用该文件解析出的证书，文件修改后自动重新加载；path为NULL时取消
+ */
+void ca_store_watch_file(const char *buffer, const char *path);
+
+/**
+ * 证书文件每次重新加载或更换后加1。pem为监视的证书时先检查文件是否已修改（至多每秒一次），
+ * 已修改时在后台线程重新加载，加载完成前仍返回旧的值
+ */
+unsigned int ca_store_generation(const char *pem);
+
+/**
+ * 将pem中的证书加入store，证书只在首次使用时解析，之后由所有连接共享
+ */
+CURLcode ca_store_add_certs(X509_STORE *store, const char *pem);
+
+#endif /* CA_STORE_H */
@@ -0,0 +1,30 @@
+/*********************************************************************************
+* Copyright 2024 Huawei Technologies Co.,Ltd.
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+* this file except in compliance with the License.  You may obtain a copy of the
+* License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed
+* under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+* CONDITIONS OF ANY KIND, either express or implied.  See the License for the
+* specific language governing permissions and limitations under the License.
+**********************************************************************************
+*/
+#ifndef CHUNK_CACHE_H
+#define CHUNK_CACHE_H
+
+#include "eSDKOBS.h"
+
+/**
+ * 范围读取经块缓存处理时返回1（结果已通过handler回调），不满足缓存条件时返回0；
+ * allow_compressed_range含义同get_object_internal
+ */
+int chunk_cache_get_object(const obs_options *options, obs_object_info *object_info,
+    obs_get_conditions *get_conditions, server_side_encryption_params *encryption_params,
+    obs_get_object_handler *handler, void *callback_data, int allow_compressed_range);
+
+void chunk_cache_deinitialize(void);
+
+#endif /* CHUNK_CACHE_H */
@@ -0,0 +1,118 @@
+/*********************************************************************************
+* Copyright 2024 Huawei Technologies Co.,Ltd.
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+* this file except in compliance with the License.  You may obtain a copy of the
+* License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed
+* under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+* CONDITIONS OF ANY KIND, either express or implied.  See the License for the
+* specific language governing permissions and limitations under the License.
+**********************************************************************************
+*/
+#ifndef CLIENT_ENCRYPTION_H
+#define CLIENT_ENCRYPTION_H
+
+#include "eSDKOBS.h"
+
+#define CLIENT_ENCRYPTION_IV_SIZE       12
+#define CLIENT_ENCRYPTION_MAX_KEY_SIZE  32
+#define CLIENT_ENCRYPTION_TEXT_SIZE     128
+#define CLIENT_ENCRYPTION_META_COUNT    5
+
+/**
+ * 一个对象的加密上下文，data_key为明文数据密钥，使用完后需client_encryption_clear清除
+ */
+typedef struct client_encryption_context
+{
+    obs_client_encryption_algorithm algorithm;
+    unsigned char data_key[CLIENT_ENCRYPTION_MAX_KEY_SIZE];
+    unsigned int key_size;
+    unsigned char base_iv[CLIENT_ENCRYPTION_IV_SIZE];
+    uint64_t part_size;                       // 明文段大小，密文段多OBS_CLIENT_ENCRYPTION_TAG_SIZE字节
+    char wrapped_key[CLIENT_ENCRYPTION_TEXT_SIZE];  // base64(IV|加密的数据密钥|标签)
+    char iv_text[CLIENT_ENCRYPTION_TEXT_SIZE];
+    char part_size_text[32];
+    char key_id[CLIENT_ENCRYPTION_TEXT_SIZE];
+} client_encryption_context;
+
+/**
+ * 单个段的加解密状态，加密时就地处理读回调的缓冲区，解密时经work缓冲交给sink
+ */
+typedef struct client_encryption_part
+{
+    void *cipher;                             // EVP_CIPHER_CTX
+    uint64_t plain_size;
+    uint64_t processed;
+    unsigned char tag[OBS_CLIENT_ENCRYPTION_TAG_SIZE];
+    unsigned int tag_pos;
+    int encrypt;
+    int finished;
+    char *work;
+} client_encryption_part;
+
+typedef obs_status (client_encryption_sink)(const char *data, int length, void *sink_data);
+
+/**
+ * 生成新的数据密钥和基础IV，并用主密钥加密数据密钥
+ */
+obs_status client_encryption_create(const obs_client_encryption_params *params, uint64_t part_size,
+    client_encryption_context *context);
+
+/**
+ * 用主密钥解开已保存的数据密钥，用于断点续传和下载
+ */
+obs_status client_encryption_open(const obs_client_encryption_params *params,
+    obs_client_encryption_algorithm algorithm, const char *wrapped_key, const char *iv_text, uint64_t part_size,
+    client_encryption_context *context);
+
+/**
+ * 从对象元数据恢复加密上下文，对象未加密时返回OBS_STATUS_InvalidParameter
+ */
+obs_status client_encryption_from_metadata(const obs_client_encryption_params *params,
+    const obs_response_properties *properties, client_encryption_context *context);
+
+/**
+ * 向meta追加加密元数据，值指向context内部，返回追加的个数
+ */
+int client_encryption_fill_metadata(const client_encryption_context *context, obs_name_value *meta);
+
+/**
+ * 由密文对象大小计算明文大小
+ */
+uint64_t client_encryption_plain_size(const client_encryption_context *context, uint64_t stored_size);
+
+void client_encryption_clear(client_encryption_context *context);
+
+/**
+ * 开始第part_index(从0开始)个段，plain_size为该段明文长度，object_size为整个对象的明文长度
+ */
+obs_status client_encryption_part_begin(const client_encryption_context *context, client_encryption_part *part,
+    unsigned int part_index, uint64_t plain_size, uint64_t object_size, int encrypt);
+
+/**
+ * 就地加密length字节明文
+ */
+obs_status client_encryption_part_encrypt(client_encryption_part *part, char *buffer, int length);
+
+/**
+ * 明文加密完后输出认证标签，返回写入的字节数，标签输出完返回0，失败返回-1
+ */
+int client_encryption_part_read_tag(client_encryption_part *part, char *buffer, int buffer_size);
+
+/**
+ * 解密密文段数据(末尾为认证标签)，明文交给sink；标签校验前的明文未经认证，sink不应将其作为可用数据
+ */
+obs_status client_encryption_part_decrypt(client_encryption_part *part, const char *data, int length,
+    client_encryption_sink *sink, void *sink_data);
+
+/**
+ * 段接收完毕后校验认证标签，数据不完整返回OBS_STATUS_PartialFile，校验失败返回OBS_STATUS_BadDigest
+ */
+obs_status client_encryption_part_finish(client_encryption_part *part);
+
+void client_encryption_part_end(client_encryption_part *part);
+
+#endif /* CLIENT_ENCRYPTION_H */
@@ -0,0 +1,95 @@
+/*********************************************************************************
+* Copyright 2024 Huawei Technologies Co.,Ltd.
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+* this file except in compliance with the License.  You may obtain a copy of the
+* License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed
+* under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+* CONDITIONS OF ANY KIND, either express or implied.  See the License for the
+* specific language governing permissions and limitations under the License.
+**********************************************************************************
+*/
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include "eSDKOBS.h"
+#include "request.h"
+
+typedef struct compression_reader compression_reader;
+
+typedef struct compression_writer compression_writer;
+
+/**
+ * 解压后数据的接收者，返回非OBS_STATUS_OK时中止
+ */
+typedef obs_status (compression_sink)(const char *data, uint64_t length, void *sink_data);
+
+/**
+ * 编码名，用于Content-Encoding和元数据
+ */
+const char *compression_codec_name(obs_compression_type type);
+
+/**
+ * 从元数据中取出编码和原始大小，未压缩时返回OBS_COMPRESSION_NONE
+ */
+obs_compression_type compression_from_metadata(const obs_response_properties *properties,
+    uint64_t *original_size);
+
+/**
+ * 当前编译是否支持该编码
+ */
+int compression_supported(obs_compression_type type);
+
+/**
+ * 创建分块并行压缩器：task_num个线程依次从source读取块并各自压缩为独立的gzip成员或zstd帧，
+ * 按块顺序从compression_reader_read输出；source在内部线程中串行调用
+ */
+obs_status compression_reader_create(obs_compression_type type, int level, int task_num,
+    obs_put_stream_read_callback *source, void *source_data, compression_reader **reader);
+
+/**
+ * 与obs_put_stream_read_callback签名一致，返回0表示结束，负数表示失败
+ */
+int compression_reader_read(int buffer_size, char *buffer, void *reader);
+
+obs_status compression_reader_status(const compression_reader *reader);
+
+uint64_t compression_reader_input_bytes(compression_reader *reader);
+
+void compression_reader_destroy(compression_reader *reader);
+
+/**
+ * 创建流式解压器，支持多成员gzip和多帧zstd
+ */
+obs_status compression_writer_create(obs_compression_type type, compression_sink *sink, void *sink_data,
+    compression_writer **writer);
+
+obs_status compression_writer_write(compression_writer *writer, const char *data, uint64_t length);
+
+/**
+ * 输入结束，压缩流不完整时返回OBS_STATUS_PartialFile
+ */
+obs_status compression_writer_finish(compression_writer *writer);
+
+void compression_writer_destroy(compression_writer *writer);
+
+/**
+ * 范围读取时若响应元数据表明对象已压缩则以OBS_STATUS_InvalidRange拒绝，
+ * 解压需要完整的压缩流；由公开的get_object在请求带范围时使用，调用方放在栈上。
+ * SDK内部按范围拼出整个对象的调用方经get_object_internal不使用该检查
+ */
+typedef struct compression_range_guard
+{
+    obs_response_properties_callback *properties_callback;
+    obs_response_complete_callback *complete_callback;
+    obs_get_object_data_callback *data_callback;
+    void *callback_data;
+    obs_status status;                        // 拒绝后为OBS_STATUS_InvalidRange，中止数据并改写完成状态
+} compression_range_guard;
+
+void compression_range_guard_wrap(compression_range_guard *guard, request_params *params);
+
+#endif /* COMPRESSION_H */
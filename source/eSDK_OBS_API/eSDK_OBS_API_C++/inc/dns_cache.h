@@ -0,0 +1,34 @@
+/*********************************************************************************
+* Copyright 2024 Huawei Technologies Co.,Ltd.
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+* this file except in compliance with the License.  You may obtain a copy of the
+* License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed
+* under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+* CONDITIONS OF ANY KIND, either express or implied.  See the License for the
+* specific language governing permissions and limitations under the License.
+**********************************************************************************
+*/
+#ifndef DNS_CACHE_H
+#define DNS_CACHE_H
+
+#include <curl/curl.h>
+#include "eSDKOBS.h"
+
+/* 已启用解析缓存时非0 */
+extern volatile int g_dns_cache_enabled;
+
+void dns_cache_initialize(void);
+
+void dns_cache_deinitialize(void);
+
+/**
+ * 按uri中的主机和端口查找缓存的解析结果，生成CURLOPT_RESOLVE使用的列表，
+ * 未命中或已过期时返回NULL并在后台解析。返回的列表由调用者以curl_slist_free_all释放
+ */
+struct curl_slist *dns_cache_resolve_list(const char *uri, obs_ip_preference preference);
+
+#endif /* DNS_CACHE_H */
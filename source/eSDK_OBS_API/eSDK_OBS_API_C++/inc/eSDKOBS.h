@@ -225,6 +225,7 @@ typedef enum
 	OBS_STATUS_NULL_SECRETE_ACCESS_KEY,
 	OBS_STATUS_NoSuchTrashConfiguration,
 	OBS_STATUS_InvalidRequestBody,
+    OBS_STATUS_HttpErrorNotModified,
     OBS_STATUS_BUTT
 } obs_status;
 
@@ -751,6 +752,33 @@ typedef struct _obs_sever_callback_data
     uint64_t  buffer_len;
 }obs_sever_callback_data;
 
+/**
+ * 客户端信封加密算法：每个对象随机生成数据密钥，用主密钥加密后保存在对象元数据中；
+ * 每个段独立加密并在末尾附加16字节认证标签，IV由基础IV与段号派生
+ */
+typedef enum
+{
+    OBS_CLIENT_ENCRYPTION_NONE = 0,
+    OBS_CLIENT_ENCRYPTION_AES_256_GCM,        // 主密钥32字节
+    OBS_CLIENT_ENCRYPTION_SM4_GCM,            // 主密钥16字节，需使用铜锁(Tongsuo)编译
+    OBS_CLIENT_ENCRYPTION_BUTT
+} obs_client_encryption_algorithm;
+
+#define OBS_CLIENT_ENCRYPTION_META_ALGORITHM    "client-encryption-algorithm"
+#define OBS_CLIENT_ENCRYPTION_META_KEY          "client-encryption-key"
+#define OBS_CLIENT_ENCRYPTION_META_IV           "client-encryption-iv"
+#define OBS_CLIENT_ENCRYPTION_META_PART_SIZE    "client-encryption-part-size"
+#define OBS_CLIENT_ENCRYPTION_META_KEY_ID       "client-encryption-key-id"
+#define OBS_CLIENT_ENCRYPTION_TAG_SIZE          16
+
+typedef struct obs_client_encryption_params
+{
+    obs_client_encryption_algorithm algorithm;
+    const unsigned char *master_key;
+    unsigned int master_key_len;
+    char *master_key_id;                      // 可选，记录在元数据中便于轮换主密钥
+} obs_client_encryption_params;
+
 typedef struct _obs_download_file_configuration
 {
     char * downLoad_file;
@@ -758,6 +786,7 @@ typedef struct _obs_download_file_configuration
     char * check_point_file;
     int enable_check_point;
     int task_num;
+    obs_client_encryption_params *client_encryption;  // 非NULL时解密客户端加密的对象，段大小取自元数据
 }obs_download_file_configuration;
 
 typedef struct _obs_upload_file_part_info
@@ -1049,6 +1078,9 @@ typedef struct get_access_label_handler
 }get_access_label_handler;
 
 /**************************return struct*******************************************/
+/* 多端点负载均衡池，由obs_endpoint_pool_create创建 */
+typedef struct obs_endpoint_pool obs_endpoint_pool;
+
 typedef struct obs_bucket_context
 {
     char *host_name;
@@ -1064,6 +1096,7 @@ typedef struct obs_bucket_context
     char * epid;
     obs_bucket_type bucket_type;
     obs_bucket_list_type bucket_list_type;
+    obs_endpoint_pool *endpoint_pool;         // 非NULL时每个请求从池中选择连接的端点，host_name仍用于签名和缓存
 } obs_bucket_context;
 
 typedef enum
@@ -1123,6 +1156,27 @@ typedef enum
     OBS_GM_MODE_OPEN = 1     // 国密模式（支持SM2/SM3/SM4）
 } obs_gm_mode_switch;
 
+/**
+ * 客户端带宽调度优先级：同一限速器上有较高优先级的传输进行时，较低优先级的传输让出大部分带宽
+ */
+typedef enum
+{
+    OBS_BANDWIDTH_PRIORITY_NORMAL = 0,
+    OBS_BANDWIDTH_PRIORITY_HIGH,              // 时延敏感的请求，如get_object
+    OBS_BANDWIDTH_PRIORITY_LOW,               // 后台任务，如upload_file/download_file
+    OBS_BANDWIDTH_PRIORITY_BUTT
+} obs_bandwidth_priority;
+
+/* 地址族偏好，PREFER只调整happy eyeballs先尝试的地址族，需启用解析缓存才生效 */
+typedef enum
+{
+    OBS_IP_PREFER_DEFAULT = 0,                // 按系统解析器返回的顺序
+    OBS_IP_PREFER_V4,
+    OBS_IP_PREFER_V6,
+    OBS_IP_PREFER_V4_ONLY,
+    OBS_IP_PREFER_V6_ONLY
+} obs_ip_preference;
+
 typedef struct obs_http_request_option
 {
     int speed_limit;
@@ -1152,6 +1206,9 @@ typedef struct obs_http_request_option
     obs_gm_mode_switch gm_mode_switch;   // 国密模式开关
     long ssl_min_version;                // SSL最小版本（可选，默认TLSv1.2）
     long ssl_max_version;                // SSL最大版本（可选，默认TLSv1.3）
+    obs_bandwidth_priority bandwidth_priority;  // 客户端带宽调度优先级
+    obs_ip_preference ip_preference;         // 地址族偏好
+    long happy_eyeballs_timeout_ms;          // 双栈时等待首选地址族的时间，0表示curl默认值
 } obs_http_request_option;
 
 typedef struct temp_auth_configure
@@ -1235,6 +1292,11 @@ typedef struct _obs_upload_file_configuration
     int task_num;
     int *pause_upload_flag;
     obs_put_properties *put_properties;
+    obs_client_encryption_params *client_encryption;  // 非NULL时上传前在客户端加密
+    int resume_from_server;           // 非0时不依赖断点文件，分页list_parts与服务端已上传段对账后续传，失败时不取消上传
+    char *resume_upload_id;           // 续传的上传ID，为NULL时按key查找最近初始化的分段上传，此时总是校验已上传段，
+                                      // 没有段与本地文件一致时新建上传
+    int verify_uploaded_parts;        // 续传时计算本地段MD5与服务端ETag比较，不一致的段重新上传
 }obs_upload_file_configuration;
 
 typedef struct server_side_encryption_params
@@ -1332,6 +1394,505 @@ typedef struct obs_temp_url_result
     const char *error_message;                // 错误消息（如果失败）
 } obs_temp_url_result;
 
+/**
+ * 批量临时授权URL参数，所有key共享同一组过期时间、方法和查询参数
+ */
+typedef struct obs_temp_url_batch_params
+{
+    const char **keys;                        // 对象键名数组，必填
+    unsigned int key_count;                   // 对象键名数量，必填
+    uint64_t expires;                         // 过期时间（秒），必填
+    obs_http_method http_method;              // HTTP方法，必填
+    obs_name_value *query_params;             // 查询参数（可选）
+    unsigned int query_params_count;          // 查询参数数量
+    unsigned int thread_num;                  // 并行线程数（可选），0或1表示在调用线程中生成
+} obs_temp_url_batch_params;
+
+/**
+ * 批量临时授权URL中单个URL的位置和状态
+ */
+typedef struct obs_temp_url_batch_entry
+{
+    uint64_t offset;                          // URL在输出缓冲区中的起始偏移
+    unsigned int length;                      // URL长度，不含结尾的'\0'
+    obs_status status;                        // 生成状态
+} obs_temp_url_batch_entry;
+
+/**
+ * 批量临时授权URL生成结果，arena和entries由调用者分配
+ */
+typedef struct obs_temp_url_batch_result
+{
+    char *arena;                              // 连续输出缓冲区，URL之间以'\0'分隔
+    uint64_t arena_size;                      // 输出缓冲区大小
+    obs_temp_url_batch_entry *entries;        // 与keys一一对应，至少key_count个
+    uint64_t arena_used;                      // 已使用的缓冲区大小
+    int64_t expires_timestamp;                // 过期时间戳
+    unsigned int success_count;               // 生成成功的URL数量
+} obs_temp_url_batch_result;
+
+/**
+ * 批量上传小对象时的单个对象，file_name与buffer二选一
+ * 结构体及其引用的内存需保持有效，直到该对象的完成回调返回
+ */
+typedef struct obs_bulk_put_item
+{
+    char *key;                                // 对象键名，必填
+    const char *file_name;                    // 本地文件路径
+    const char *buffer;                       // 内存数据
+    uint64_t buffer_size;                     // 内存数据长度
+    obs_put_properties *put_properties;       // 对象属性（可选）
+    void *item_data;                          // 调用者数据，原样传给完成回调
+} obs_bulk_put_item;
+
+/**
+ * 获取下一个待上传对象，填充item后返回1，没有更多对象时返回0
+ */
+typedef int (obs_bulk_put_next_item_callback)(obs_bulk_put_item *item, void *callback_data);
+
+/**
+ * 单个对象上传完成回调，etag仅在成功时有效；返回非OBS_STATUS_OK时停止提交新的对象
+ */
+typedef obs_status (obs_bulk_put_item_complete_callback)(obs_status status, const obs_bulk_put_item *item,
+    const char *etag, const obs_error_details *error_details, void *callback_data);
+
+/**
+ * 批量上传参数，items与next_item_callback二选一
+ */
+typedef struct obs_bulk_put_params
+{
+    obs_bulk_put_item *items;                 // 对象数组
+    unsigned int item_count;                  // 对象数量
+    obs_bulk_put_next_item_callback *next_item_callback;   // 流式获取对象
+    obs_bulk_put_item_complete_callback *item_complete_callback;
+    void *callback_data;
+    unsigned int max_connections;             // 并发的持久连接数，0表示默认值
+    unsigned int max_retries;                 // 单个对象可重试错误的最大重试次数
+} obs_bulk_put_params;
+
+/**
+ * 批量上传的汇总结果
+ */
+typedef struct obs_bulk_put_summary
+{
+    uint64_t total_count;
+    uint64_t success_count;
+    uint64_t failed_count;
+    uint64_t retry_count;
+    uint64_t total_bytes;                     // 成功上传的字节数
+    obs_status first_error_status;
+    char first_error_key[OBS_MAX_KEY_SIZE + 1];
+    uint64_t status_count[OBS_STATUS_BUTT];   // 按状态码统计的对象数量
+} obs_bulk_put_summary;
+
+/**
+ * 目录同步方向
+ */
+typedef enum
+{
+    OBS_SYNC_TO_BUCKET   = 0,                 // 本地目录上传到桶前缀
+    OBS_SYNC_FROM_BUCKET = 1                  // 桶前缀下载到本地目录
+} obs_sync_direction;
+
+/**
+ * 单个文件同步完成回调，relative_path为相对本地目录的路径，跳过的文件不回调
+ */
+typedef void (obs_sync_file_callback)(const char *relative_path, obs_status status, void *callback_data);
+
+/**
+ * 目录同步配置
+ */
+typedef struct obs_sync_directory_configuration
+{
+    const char *local_dir;                    // 本地目录，必填
+    const char *prefix;                       // 桶内对象前缀，可为NULL
+    obs_sync_direction direction;
+    const char *manifest_file;                // 本地清单文件，NULL时使用local_dir/.obs_sync_manifest
+    int task_num;                             // 并发同步的文件数，0表示默认值
+    uint64_t part_size;                       // 传给upload_file/download_file的分段大小，0表示默认值
+    obs_sync_file_callback *file_callback;
+    void *callback_data;
+} obs_sync_directory_configuration;
+
+/**
+ * 目录同步的汇总结果
+ */
+typedef struct obs_sync_directory_summary
+{
+    uint64_t local_file_count;
+    uint64_t remote_object_count;
+    uint64_t skipped_count;                   // 未发生变化而跳过的文件数
+    uint64_t hashed_count;                    // 需要计算MD5比对的文件数
+    uint64_t transferred_count;
+    uint64_t failed_count;
+    uint64_t transferred_bytes;
+    obs_status first_error_status;
+} obs_sync_directory_summary;
+
+/**
+ * 客户端压缩编码，压缩后的对象带Content-Encoding头，并在自定义元数据中记录编码和原始大小。
+ * get_object对压缩对象的范围读取返回OBS_STATUS_InvalidRange；download_file、download_objects
+ * 按原样下载压缩数据，get_object_stream可按decompress解压
+ */
+typedef enum
+{
+    OBS_COMPRESSION_NONE = 0,
+    OBS_COMPRESSION_GZIP,                     // 多成员gzip，可直接用gunzip解压
+    OBS_COMPRESSION_ZSTD,                     // 多帧zstd，需编译时定义OBS_WITH_ZSTD
+    OBS_COMPRESSION_BUTT
+} obs_compression_type;
+
+#define OBS_COMPRESSION_META_CODEC          "compression-codec"
+#define OBS_COMPRESSION_META_ORIGINAL_SIZE  "compression-original-size"
+
+/**
+ * 流式上传数据来源回调：向buffer写入不超过buffer_size字节并返回写入的字节数，
+ * 返回0表示数据结束，返回负数表示中止上传
+ */
+typedef int (obs_put_stream_read_callback)(int buffer_size, char *buffer, void *callback_data);
+
+/**
+ * 长度未知数据的流式上传配置，read_callback为NULL时从fd读取直到EOF
+ * 内存占用上限为buffer_count * part_size，总长度不超过part_size时使用单次PUT
+ */
+typedef struct obs_put_object_stream_configuration
+{
+    obs_put_stream_read_callback *read_callback;
+    int fd;                                   // 管道、套接字或文件描述符
+    uint64_t part_size;                       // 段大小，0表示默认值
+    int buffer_count;                         // 段缓冲区个数，至少为2，0表示默认值
+    int task_num;                             // 并发上传段的线程数，0表示默认值
+    unsigned int max_retries;                 // 单个段可重试错误的最大重试次数
+    obs_put_properties *put_properties;       // 对象属性（可选）
+    server_side_encryption_params *encryption_params;
+    void *callback_data;
+    obs_compression_type compression;         // 上传前分块并行压缩，此时数据回调在内部线程中串行调用
+    int compression_level;                    // 0表示编码的默认级别
+} obs_put_object_stream_configuration;
+
+/**
+ * 流式上传结果
+ */
+typedef struct obs_put_object_stream_summary
+{
+    uint64_t total_bytes;                     // 上传的字节数，压缩时为压缩后的大小
+    uint64_t original_bytes;                  // 读取的原始数据字节数
+    unsigned int part_count;                  // 0表示使用了单次PUT
+    unsigned int retry_count;
+    char etag[64];
+    obs_status first_error_status;
+} obs_put_object_stream_summary;
+
+/**
+ * 按对象内的顺序并行分段下载到流的配置，write_callback为NULL时写入fd
+ * 每段先下载到重排缓冲区，按序交给调用者，内存占用上限为buffer_count * part_size
+ */
+typedef struct obs_get_object_stream_configuration
+{
+    obs_get_object_data_callback *write_callback;   // 返回非OBS_STATUS_OK时中止下载
+    int fd;                                   // 管道、套接字或文件描述符
+    char *version_id;                         // 对象版本号（可选）
+    uint64_t part_size;                       // 每个范围请求的大小，0表示默认值
+    int buffer_count;                         // 重排缓冲区个数，0表示默认值
+    int task_num;                             // 并发下载的线程数，0表示默认值
+    unsigned int max_retries;                 // 单个范围可重试错误的最大重试次数
+    server_side_encryption_params *encryption_params;
+    void *callback_data;
+    int decompress;                           // 非0时按元数据记录的编码解压后交付
+} obs_get_object_stream_configuration;
+
+/**
+ * 流式下载结果
+ */
+typedef struct obs_get_object_stream_summary
+{
+    uint64_t total_bytes;                     // 已按序交给调用者的字节数
+    uint64_t object_size;
+    uint64_t original_size;                   // 元数据记录的压缩前大小，未记录时为0
+    obs_compression_type compression;         // 元数据记录的编码
+    unsigned int range_count;                 // 0表示使用了单次GET
+    unsigned int retry_count;
+    char etag[64];
+    obs_status first_error_status;
+} obs_get_object_stream_summary;
+
+/**
+ * 批量下载中的单个对象，结构体及其引用的内存需保持有效，直到download_objects返回
+ */
+typedef struct obs_download_object_item
+{
+    char *key;                                // 对象键名，必填
+    char *version_id;                         // 对象版本号（可选）
+    const char *file_name;                    // 本地目标文件，必填，缺失的父目录会自动创建
+    void *item_data;                          // 调用者数据，原样传给完成回调
+} obs_download_object_item;
+
+/**
+ * 单个对象下载完成或失败时回调一次，续传时日志中已完成的对象不回调
+ */
+typedef void (obs_download_object_complete_callback)(obs_status status, const obs_download_object_item *item,
+    void *callback_data);
+
+/**
+ * 全部对象的汇总进度，done_bytes包含续传前已完成的部分；在下载线程中调用
+ */
+typedef void (obs_download_objects_progress_callback)(uint64_t done_bytes, uint64_t total_bytes,
+    uint64_t done_count, uint64_t total_count, void *callback_data);
+
+/**
+ * 多对象下载配置：所有对象的分段共用一个下载线程池，小对象优先调度
+ */
+typedef struct obs_download_objects_configuration
+{
+    obs_download_object_item *items;          // 对象数组
+    unsigned int item_count;
+    uint64_t part_size;                       // 大对象的分段大小，0表示默认值，续传时沿用日志中的值
+    int task_num;                             // 共享的下载线程数，0表示默认值
+    unsigned int max_retries;                 // 单个请求可重试错误的最大重试次数
+    const char *journal_file;                 // 续传日志，NULL时不记录，失败的对象下次需重新下载
+    server_side_encryption_params *encryption_params;
+    obs_download_object_complete_callback *complete_callback;
+    obs_download_objects_progress_callback *progress_callback;
+    void *callback_data;
+} obs_download_objects_configuration;
+
+/**
+ * 多对象下载的汇总结果
+ */
+typedef struct obs_download_objects_summary
+{
+    uint64_t total_count;
+    uint64_t success_count;                   // 包含续传时日志中已完成的对象
+    uint64_t resumed_count;                   // 日志中已完成而跳过的对象数
+    uint64_t failed_count;
+    uint64_t total_bytes;                     // 已知大小的对象的总字节数
+    uint64_t downloaded_bytes;                // 本次实际下载的字节数
+    uint64_t part_count;                      // 本次下载的分段数
+    uint64_t retry_count;
+    obs_status first_error_status;
+    char first_error_key[OBS_MAX_KEY_SIZE + 1];
+} obs_download_objects_summary;
+
+/**
+ * 对象元数据缓存配置，缓存HEAD/GET响应中的对象属性
+ */
+typedef struct obs_metadata_cache_config
+{
+    unsigned int shard_count;                 // 分片数，向上取整为2的幂
+    uint64_t max_entries;                     // 条目数上限
+    uint64_t max_memory;                      // 内存上限（字节），0表示不限制
+    unsigned int ttl_ms;                      // 条目有效期（毫秒）
+    int revalidate;                           // 过期后携带If-None-Match确认，返回304时续期
+} obs_metadata_cache_config;
+
+/**
+ * 元数据缓存统计
+ */
+typedef struct obs_metadata_cache_stats
+{
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t revalidations;                   // 发起的条件请求数
+    uint64_t not_modified;                    // 条件请求返回304的次数
+    uint64_t insertions;
+    uint64_t evictions;                       // 超出容量被淘汰的条目数
+    uint64_t expirations;
+    uint64_t invalidations;
+    uint64_t entries;
+    uint64_t memory;
+} obs_metadata_cache_stats;
+
+/**
+ * 范围读取的磁盘块缓存配置，块按对象etag索引，对象被覆盖后旧块自然失效
+ */
+typedef struct obs_chunk_cache_config
+{
+    const char *cache_dir;                    // 缓存目录，存放slab文件
+    uint64_t chunk_size;                      // 对齐的块大小，0表示1MB
+    uint64_t max_disk_size;                   // 磁盘预算（字节）
+} obs_chunk_cache_config;
+
+/**
+ * 块缓存统计
+ */
+typedef struct obs_chunk_cache_stats
+{
+    uint64_t hits;                            // 命中的块数
+    uint64_t misses;
+    uint64_t fetches;                         // 合并未命中块后发起的范围请求数
+    uint64_t bytes_from_cache;
+    uint64_t bytes_from_server;
+    uint64_t evictions;
+    uint64_t chunks;                          // 当前缓存的块数
+    uint64_t disk_usage;                      // 当前缓存块占用的字节数
+} obs_chunk_cache_stats;
+
+typedef enum
+{
+    OBS_ENDPOINT_SELECT_LEAST_OUTSTANDING = 0,    // 未完成请求数/权重最小
+    OBS_ENDPOINT_SELECT_EWMA_LATENCY              // EWMA首字节时延*(未完成请求数+1)/权重最小
+} obs_endpoint_select_policy;
+
+/**
+ * 端点池配置：连续失败达到阈值的端点被摘除，期满后放行一个探测请求，成功则恢复，
+ * 探测失败时摘除时长翻倍
+ */
+typedef struct obs_endpoint_pool_config
+{
+    obs_endpoint_select_policy policy;
+    unsigned int failure_threshold;           // 连续网络错误或5xx的次数
+    unsigned int eject_ms;                    // 首次摘除时长
+    unsigned int max_eject_ms;
+} obs_endpoint_pool_config;
+
+typedef struct obs_endpoint_stats
+{
+    const char *host_name;
+    unsigned int weight;
+    int healthy;
+    uint64_t outstanding;                     // 未完成的请求数
+    uint64_t requests;
+    uint64_t failures;
+    uint64_t ejections;
+    uint64_t ewma_latency_us;
+} obs_endpoint_stats;
+
+/**
+ * 解析缓存配置：连接的域名解析一次后由所有请求句柄共享，经CURLOPT_RESOLVE注入，
+ * 有效期后段被使用时由后台线程提前刷新
+ */
+typedef struct obs_dns_cache_config
+{
+    unsigned int ttl_ms;                      // 解析结果有效期
+    unsigned int refresh_percent;             // 超过有效期的该百分比后被使用时后台刷新
+    unsigned int max_entries;
+} obs_dns_cache_config;
+
+typedef struct obs_dns_cache_stats
+{
+    uint64_t hits;
+    uint64_t misses;                          // 未解析或已过期，由curl自行解析
+    uint64_t resolves;                        // 预解析和后台刷新的解析次数
+    uint64_t resolve_failures;
+    uint64_t entries;
+} obs_dns_cache_stats;
+
+/**
+ * GET/HEAD请求对冲配置：原请求超过延迟仍未收到响应头时，在另一条连接上发出相同请求，
+ * 采用先响应的一个并中止另一个
+ */
+typedef struct obs_hedging_config
+{
+    unsigned int delay_percentile;            // 延迟取近期首字节时延的百分位，1~100
+    unsigned int min_delay_ms;
+    unsigned int max_delay_ms;                // 样本不足时使用该值
+    unsigned int budget_percent;              // 对冲请求数最多占可对冲请求数的百分比
+} obs_hedging_config;
+
+/**
+ * 对冲统计
+ */
+typedef struct obs_hedging_stats
+{
+    uint64_t eligible;                        // 可对冲的请求数
+    uint64_t hedged;                          // 发出对冲请求的次数
+    uint64_t hedge_wins;                      // 对冲请求先响应的次数
+    uint64_t budget_exhausted;                // 因预算不足未对冲的次数
+    uint64_t delay_ms;                        // 当前的对冲延迟
+} obs_hedging_stats;
+
+/**
+ * 指标统计的操作类型，由请求方法、子资源和查询参数推断
+ */
+typedef enum
+{
+    OBS_METRICS_OP_GET_OBJECT = 0,
+    OBS_METRICS_OP_HEAD_OBJECT,
+    OBS_METRICS_OP_PUT_OBJECT,
+    OBS_METRICS_OP_COPY_OBJECT,
+    OBS_METRICS_OP_APPEND_OBJECT,
+    OBS_METRICS_OP_DELETE_OBJECT,
+    OBS_METRICS_OP_BATCH_DELETE,
+    OBS_METRICS_OP_INITIATE_MULTIPART,
+    OBS_METRICS_OP_UPLOAD_PART,
+    OBS_METRICS_OP_COMPLETE_MULTIPART,
+    OBS_METRICS_OP_ABORT_MULTIPART,
+    OBS_METRICS_OP_LIST_PARTS,
+    OBS_METRICS_OP_LIST_OBJECTS,
+    OBS_METRICS_OP_LIST_VERSIONS,
+    OBS_METRICS_OP_LIST_MULTIPART_UPLOADS,
+    OBS_METRICS_OP_LIST_BUCKETS,
+    OBS_METRICS_OP_CREATE_BUCKET,
+    OBS_METRICS_OP_HEAD_BUCKET,
+    OBS_METRICS_OP_DELETE_BUCKET,
+    OBS_METRICS_OP_OPTIONS,
+    OBS_METRICS_OP_OBJECT_OTHER,              // acl、metadata、restore等对象子资源操作
+    OBS_METRICS_OP_BUCKET_OTHER,              // 桶配置类操作
+    OBS_METRICS_OP_BUTT
+} obs_metrics_operation;
+
+/* 时延直方图：每个2的幂区间再细分为4个桶，单位微秒，覆盖约38小时 */
+#define OBS_METRICS_HISTOGRAM_BUCKETS   144
+/* HTTP响应码分布的数组长度，下标0表示未收到HTTP响应 */
+#define OBS_METRICS_HTTP_CODE_MAX       600
+
+typedef struct obs_metrics_histogram
+{
+    uint64_t count;
+    uint64_t sum_us;
+    uint64_t max_us;
+    uint64_t buckets[OBS_METRICS_HISTOGRAM_BUCKETS];
+} obs_metrics_histogram;
+
+typedef struct obs_metrics_operation_stats
+{
+    uint64_t requests;                        // 发出的HTTP请求数（每次尝试计一次）
+    uint64_t errors;                          // 最终状态非OBS_STATUS_OK的请求数
+    uint64_t retries;
+    uint64_t bytes_sent;                      // 请求体字节数
+    uint64_t bytes_received;                  // 响应体字节数
+    obs_metrics_histogram latency;            // 单次请求的传输时延
+} obs_metrics_operation_stats;
+
+/**
+ * 指标快照，为所有线程（含已退出线程）计数器之和
+ */
+typedef struct obs_metrics_snapshot
+{
+    obs_metrics_operation_stats operations[OBS_METRICS_OP_BUTT];
+    uint64_t http_code_count[OBS_METRICS_HTTP_CODE_MAX];
+    uint64_t status_count[OBS_STATUS_BUTT];
+    uint64_t handle_pool_hits;                // 从请求句柄池取到已有句柄
+    uint64_t handle_pool_misses;              // 句柄池为空，新建curl句柄
+    uint64_t connections_reused;              // 复用已有连接完成的请求数
+    uint64_t connections_created;             // 新建的连接数
+} obs_metrics_snapshot;
+
+/**
+ * 单次HTTP请求的耗时分解，时间点均为自请求开始的累计微秒数（来自curl的传输计时）
+ */
+typedef struct obs_request_trace
+{
+    obs_metrics_operation operation;
+    obs_status status;
+    int http_code;                            // 0表示未收到HTTP响应
+    int retry_count;                          // 首次请求为0，SDK内部重试循环的第n次重试为n
+    const char *request_id;                   // 服务端返回的请求ID，可能为空串
+    const char *uri;
+    int64_t namelookup_us;                    // DNS解析完成
+    int64_t connect_us;                       // TCP连接建立
+    int64_t appconnect_us;                    // TLS握手完成，HTTP请求为0
+    int64_t pretransfer_us;                   // 开始发送请求
+    int64_t starttransfer_us;                 // 收到响应首字节
+    int64_t total_us;
+    uint64_t bytes_sent;                      // 请求体字节数
+    uint64_t bytes_received;                  // 响应体字节数
+    uint64_t header_bytes_received;
+    long new_connections;                     // 本次请求新建的连接数，0表示复用连接
+} obs_request_trace;
+
+typedef void (obs_request_trace_callback)(const obs_request_trace *trace, void *callback_data);
+
 /****************************init handle *****************************************************/
 eSDK_OBS_API obs_status obs_initialize(int win32_flags);
 
@@ -1436,6 +1997,37 @@ eSDK_OBS_API obs_status create_head_temp_url(
     int url_out_len
 );
 
+/**
+ * 初始化批量临时授权URL参数结构
+ */
+eSDK_OBS_API void init_temp_url_batch_params(obs_temp_url_batch_params *params);
+
+/**
+ * 计算批量生成所需的输出缓冲区大小（上限值）
+ *
+ * @param options SDK配置选项
+ * @param params 批量临时授权URL参数
+ * @return 所需字节数，参数非法时返回0
+ */
+eSDK_OBS_API uint64_t get_presigned_url_batch_size(
+    const obs_options *options,
+    const obs_temp_url_batch_params *params
+);
+
+/**
+ * 批量生成临时授权URL，结果与逐个调用create_presigned_url一致
+ *
+ * @param options SDK配置选项
+ * @param params 批量临时授权URL参数
+ * @param result 输出结果，每个key的URL位置和状态记录在entries中
+ * @return OBS_STATUS_OK表示批量执行完成（单个URL的状态见entries），其他失败
+ */
+eSDK_OBS_API obs_status create_presigned_url_batch(
+    const obs_options *options,
+    const obs_temp_url_batch_params *params,
+    obs_temp_url_batch_result *result
+);
+
 eSDK_OBS_API obs_status set_online_request_max_count(uint32_t online_request_max);
 
 eSDK_OBS_API obs_status init_certificate_by_path(obs_protocol protocol, 
@@ -1684,6 +2276,138 @@ eSDK_OBS_API void download_file(const obs_options *options, char *key, char* ver
                         obs_download_file_configuration * download_file_config,
                         obs_download_file_response_handler *handler, void *callback_data);
 
+eSDK_OBS_API obs_status bulk_put_object(const obs_options *options, obs_bulk_put_params *params,
+                                    obs_bulk_put_summary *summary);
+
+eSDK_OBS_API obs_status obs_sync_directory(const obs_options *options, obs_sync_directory_configuration *config,
+                                    obs_sync_directory_summary *summary);
+
+eSDK_OBS_API void init_put_object_stream_configuration(obs_put_object_stream_configuration *config);
+
+eSDK_OBS_API obs_status put_object_stream(const obs_options *options, char *key,
+                                    obs_put_object_stream_configuration *config,
+                                    obs_put_object_stream_summary *summary);
+
+eSDK_OBS_API void init_get_object_stream_configuration(obs_get_object_stream_configuration *config);
+
+eSDK_OBS_API obs_status get_object_stream(const obs_options *options, char *key,
+                                    obs_get_object_stream_configuration *config,
+                                    obs_get_object_stream_summary *summary);
+
+eSDK_OBS_API void init_download_objects_configuration(obs_download_objects_configuration *config);
+
+eSDK_OBS_API obs_status download_objects(const obs_options *options, obs_download_objects_configuration *config,
+                                    obs_download_objects_summary *summary);
+
+eSDK_OBS_API void init_metadata_cache_config(obs_metadata_cache_config *config);
+
+/* 需在obs_initialize之后、发起请求之前调用，不可与进行中的请求并发 */
+eSDK_OBS_API obs_status obs_metadata_cache_enable(const obs_metadata_cache_config *config);
+
+eSDK_OBS_API void obs_metadata_cache_disable(void);
+
+eSDK_OBS_API void obs_metadata_cache_invalidate(const obs_options *options, const char *key);
+
+eSDK_OBS_API void obs_metadata_cache_get_stats(obs_metadata_cache_stats *stats);
+
+/* 启用后get_object的范围读取经过块缓存，需在obs_initialize之后、发起请求之前调用 */
+eSDK_OBS_API obs_status obs_chunk_cache_enable(const obs_chunk_cache_config *config);
+
+eSDK_OBS_API void obs_chunk_cache_disable(void);
+
+eSDK_OBS_API void obs_chunk_cache_get_stats(obs_chunk_cache_stats *stats);
+
+eSDK_OBS_API void init_endpoint_pool_config(obs_endpoint_pool_config *config);
+
+/* weights为NULL时各端点权重相同；端点池可被多个obs_options共享，使用它的请求全部结束后才可销毁 */
+eSDK_OBS_API obs_status obs_endpoint_pool_create(const obs_endpoint_pool_config *config,
+                                    const char *const *host_names, const unsigned int *weights,
+                                    unsigned int count, obs_endpoint_pool **pool);
+
+eSDK_OBS_API void obs_endpoint_pool_destroy(obs_endpoint_pool *pool);
+
+/* 返回写入stats的端点数 */
+eSDK_OBS_API unsigned int obs_endpoint_pool_get_stats(obs_endpoint_pool *pool, obs_endpoint_stats *stats,
+                                    unsigned int count);
+
+eSDK_OBS_API void init_dns_cache_config(obs_dns_cache_config *config);
+
+/* 需在obs_initialize之后、发起请求之前调用，不可与进行中的请求并发 */
+eSDK_OBS_API obs_status obs_dns_cache_enable(const obs_dns_cache_config *config);
+
+eSDK_OBS_API void obs_dns_cache_disable(void);
+
+/* 同步解析options的请求将连接的域名，设置了端点池时解析池中全部端点 */
+eSDK_OBS_API obs_status obs_dns_cache_preresolve(const obs_options *options);
+
+eSDK_OBS_API void obs_dns_cache_get_stats(obs_dns_cache_stats *stats);
+
+eSDK_OBS_API void init_hedging_config(obs_hedging_config *config);
+
+/* 启用后幂等的GET/HEAD请求经当前线程的curl multi句柄发送，不额外创建线程 */
+eSDK_OBS_API obs_status obs_hedging_enable(const obs_hedging_config *config);
+
+eSDK_OBS_API void obs_hedging_disable(void);
+
+eSDK_OBS_API void obs_hedging_get_stats(obs_hedging_stats *stats);
+
+/**
+ * 并发建立count个到options所连接端点的连接（含TLS握手），放入请求句柄池供后续请求复用，
+ * 同时刷新桶的API版本缓存；count最多为100，全部成功时返回OK
+ */
+eSDK_OBS_API obs_status obs_prewarm_connections(const obs_options *options, unsigned int count);
+
+/* 后台线程每隔interval_ms重新探测count个连接，避免被服务端空闲超时关闭；
+   options指向的字符串需保持有效直到obs_prewarm_keepalive_stop返回 */
+eSDK_OBS_API obs_status obs_prewarm_keepalive_start(const obs_options *options, unsigned int count,
+                                    unsigned int interval_ms);
+
+eSDK_OBS_API void obs_prewarm_keepalive_stop(void);
+
+/* 开启或关闭指标采集，默认关闭；采集计数器为线程私有，读取快照时才汇总 */
+eSDK_OBS_API void obs_metrics_enable(int enable);
+
+eSDK_OBS_API void obs_get_metrics_snapshot(obs_metrics_snapshot *snapshot);
+
+/* 返回直方图的百分位时延（微秒），percentile取值0~100 */
+eSDK_OBS_API uint64_t obs_metrics_histogram_percentile(const obs_metrics_histogram *histogram,
+                                    double percentile);
+
+eSDK_OBS_API const char *obs_metrics_operation_name(obs_metrics_operation operation);
+
+/**
+ * 以Prometheus文本格式导出当前指标
+ *
+ * @return 完整输出所需的长度（不含结尾'\0'），不小于buffer_size时输出被截断
+ */
+eSDK_OBS_API int obs_metrics_export_prometheus(char *buffer, int buffer_size);
+
+/**
+ * 设置全局请求跟踪回调，每个HTTP请求结束、complete_callback之前在请求线程中调用，
+ * 回调应尽快返回；传入NULL取消。需在发起请求之前设置
+ */
+eSDK_OBS_API void obs_set_request_trace_callback(obs_request_trace_callback *callback, void *callback_data);
+
+/**
+ * 设置进程级客户端限速（字节/秒，上传和下载分别计算），0表示不限速。
+ * 在curl读写回调中按令牌桶阻塞，并发传输按数据块先后公平分享；
+ * 限速只对设置之后开始的请求生效，需在obs_initialize之后调用
+ */
+eSDK_OBS_API obs_status obs_set_bandwidth_limit(uint64_t upload_bytes_per_second,
+    uint64_t download_bytes_per_second);
+
+/**
+ * 设置单个桶的客户端限速，与全局限速同时生效
+ */
+eSDK_OBS_API obs_status obs_set_bucket_bandwidth_limit(const char *bucket_name, uint64_t upload_bytes_per_second,
+    uint64_t download_bytes_per_second);
+
+/**
+ * 设置某一优先级全部请求合计的客户端限速，与全局和桶限速同时生效
+ */
+eSDK_OBS_API obs_status obs_set_priority_bandwidth_limit(obs_bandwidth_priority priority,
+    uint64_t upload_bytes_per_second, uint64_t download_bytes_per_second);
+
 eSDK_OBS_API void batch_delete_objects(const obs_options *options, obs_object_info *object_info,obs_delete_object_info *delobj,     
                                   obs_put_properties *put_properties, obs_delete_object_handler *handler, void *callback_data);
 
@@ -0,0 +1,53 @@
+/*********************************************************************************
+* Copyright 2024 Huawei Technologies Co.,Ltd.
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+* this file except in compliance with the License.  You may obtain a copy of the
+* License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed
+* under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+* CONDITIONS OF ANY KIND, either express or implied.  See the License for the
+* specific language governing permissions and limitations under the License.
+**********************************************************************************
+*/
+#ifndef ENDPOINT_POOL_H
+#define ENDPOINT_POOL_H
+
+#include <stdint.h>
+#include "eSDKOBS.h"
+
+struct http_request;
+typedef struct endpoint_pool_entry endpoint_pool_entry;
+
+/* 请求结束时对端点健康度的影响 */
+typedef enum
+{
+    ENDPOINT_OUTCOME_NEUTRAL = 0,             // 未收到响应且非网络错误，如对冲中被取消
+    ENDPOINT_OUTCOME_SUCCESS,
+    ENDPOINT_OUTCOME_FAILURE                  // 网络错误或5xx
+} endpoint_outcome;
+
+/**
+ * 为一次请求选择端点并计入未完成请求数，返回的端点在endpoint_pool_release之前有效
+ */
+endpoint_pool_entry *endpoint_pool_acquire(obs_endpoint_pool *pool);
+
+const char *endpoint_pool_host_name(const endpoint_pool_entry *entry);
+
+unsigned int endpoint_pool_count(const obs_endpoint_pool *pool);
+
+const char *endpoint_pool_host_at(const obs_endpoint_pool *pool, unsigned int index);
+
+void endpoint_pool_release(endpoint_pool_entry *entry, endpoint_outcome outcome, uint64_t latency_us);
+
+/**
+ * 每个端点单独缓存请求句柄，句柄内的curl连接因此按端点复用；没有缓存的句柄时返回NULL
+ */
+struct http_request *endpoint_pool_take_handle(endpoint_pool_entry *entry);
+
+/* 缓存已满时返回0，由调用者放回全局句柄池或销毁 */
+int endpoint_pool_park_handle(endpoint_pool_entry *entry, struct http_request *request);
+
+#endif /* ENDPOINT_POOL_H */
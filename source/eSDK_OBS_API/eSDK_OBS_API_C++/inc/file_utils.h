@@ -21,12 +21,16 @@ int checkPointFileSave(const char *filename, xmlDocPtr doc);
 xmlDocPtr checkPointFileRead(const char *filename, const char *encoding, int options);
 int file_path_cmp(char const* path1, char const* path2);
 int remove_file(const char* filename);
+int rename_file(const char* from, const char* to);
+void make_parent_dirs(char *path);
 int file_path_append(char* destination, size_t destinationSize);
 int path_copy(void* const destination, size_t const destinationSize,
 	void const* const source, size_t const sourceSize);
 char *getPathBuffer(size_t bufferLen);
 int temp_part_file_path_printf(char * fileNameTempBuffer,
 	size_t const fileNameTempBufferCount, const char * storeFileName, int part_num);
+int staging_part_file_path_printf(char * fileNameTempBuffer,
+	size_t const fileNameTempBufferCount, const char * storeFileName, int part_num);
 int checkpoint_file_path_printf(char* const path_buffer
 	, size_t const path_buffer_count, char const* uploadFileName);
 size_t  file_path_strlen(char const* filePath);
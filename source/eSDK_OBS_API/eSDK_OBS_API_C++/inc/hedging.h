@@ -0,0 +1,58 @@
+/*********************************************************************************
+* Copyright 2024 Huawei Technologies Co.,Ltd.
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+* this file except in compliance with the License.  You may obtain a copy of the
+* License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed
+* under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+* CONDITIONS OF ANY KIND, either express or implied.  See the License for the
+* specific language governing permissions and limitations under the License.
+**********************************************************************************
+*/
+#ifndef HEDGING_H
+#define HEDGING_H
+
+#include <stdint.h>
+#include <curl/curl.h>
+#include "request.h"
+
+/**
+ * 同一次读取的原请求与对冲请求共享，先收到响应头的请求成为winner，
+ * 另一个在curl_header_func中被中止，不会触发任何回调
+ */
+typedef struct hedge_group
+{
+    struct http_request *winner;
+} hedge_group;
+
+/* 已启用对冲时非0 */
+extern volatile int g_hedging_enabled;
+
+void hedging_initialize(void);
+
+void hedging_deinitialize(void);
+
+/* 只对冲幂等且无请求体的GET/HEAD */
+int hedging_eligible(const request_params *params);
+
+/**
+ * 当前线程的curl multi句柄，首次使用时创建，同一线程的请求复用其连接池
+ */
+CURLM *hedging_thread_multi(void);
+
+/* 发出对冲请求前的等待时间（毫秒），取近期首字节时延的百分位 */
+uint64_t hedging_delay_ms(void);
+
+/* 从对冲预算中扣除一次，预算不足返回0 */
+int hedging_acquire_budget(void);
+
+void hedging_record_latency(uint64_t latency_ms);
+
+void hedging_record_outcome(int hedged, int hedge_won);
+
+uint64_t hedging_now_ms(void);
+
+#endif /* HEDGING_H */
@@ -0,0 +1,70 @@
+/*********************************************************************************
+* Copyright 2024 Huawei Technologies Co.,Ltd.
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+* this file except in compliance with the License.  You may obtain a copy of the
+* License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed
+* under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+* CONDITIONS OF ANY KIND, either express or implied.  See the License for the
+* specific language governing permissions and limitations under the License.
+**********************************************************************************
+*/
+#ifndef METADATA_CACHE_H
+#define METADATA_CACHE_H
+
+#include "eSDKOBS.h"
+#include "request.h"
+
+struct metadata_cache_entry;
+
+/**
+ * 一次HEAD/GET请求与元数据缓存之间的交互状态，由调用方放在栈上
+ */
+typedef struct metadata_cache_request
+{
+    int active;                                 // 缓存已启用且该请求可缓存
+    int revalidating;                           // 携带If-None-Match重新验证过期条目
+    uint64_t hash;
+    uint64_t generation;                        // 发起请求时分片的失效代数
+    char *cache_key;
+    size_t object_key_len;
+    struct metadata_cache_entry *stale;         // 待重新验证的条目
+    struct metadata_cache_entry *candidate;     // 由响应构造的新条目
+    obs_get_conditions conditions;
+    obs_response_properties_callback *properties_callback;
+    obs_response_complete_callback *complete_callback;
+    obs_get_object_data_callback *data_callback;
+    void *callback_data;
+    const obs_response_properties *pending_properties;
+} metadata_cache_request;
+
+/**
+ * 查询缓存；命中时直接回调handler并返回1，否则返回0，需继续发送请求
+ */
+int metadata_cache_begin(metadata_cache_request *cache_request, const obs_options *options,
+    const char *key, const char *version_id, obs_response_handler *handler, void *callback_data);
+
+/**
+ * 不查询缓存，仅在请求成功后用响应填充缓存（用于GET）
+ */
+void metadata_cache_begin_populate(metadata_cache_request *cache_request, const obs_options *options,
+    const char *key, const char *version_id, obs_response_handler *handler, void *callback_data);
+
+/**
+ * 将请求参数中的回调替换为缓存的包装回调
+ */
+void metadata_cache_wrap_params(metadata_cache_request *cache_request, request_params *params);
+
+void metadata_cache_end(metadata_cache_request *cache_request);
+
+/**
+ * 对象被本客户端修改或删除后调用，使该对象所有版本的缓存条目失效
+ */
+void metadata_cache_invalidate_object(const obs_bucket_context *bucket, const char *key);
+
+void metadata_cache_deinitialize(void);
+
+#endif /* METADATA_CACHE_H */
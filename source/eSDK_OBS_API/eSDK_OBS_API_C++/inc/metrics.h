@@ -0,0 +1,53 @@
+/*********************************************************************************
+* Copyright 2024 Huawei Technologies Co.,Ltd.
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+* this file except in compliance with the License.  You may obtain a copy of the
+* License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed
+* under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+* CONDITIONS OF ANY KIND, either express or implied.  See the License for the
+* specific language governing permissions and limitations under the License.
+**********************************************************************************
+*/
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "eSDKOBS.h"
+#include "request.h"
+
+extern volatile int g_metrics_enabled;
+extern obs_request_trace_callback *volatile g_request_trace_callback;
+
+/* 指标采集或请求跟踪任一开启时需要对请求分类 */
+#define metrics_collecting() (g_metrics_enabled || g_request_trace_callback != NULL)
+
+void metrics_initialize(void);
+
+/**
+ * 根据请求方法、子资源和查询参数推断操作类型
+ */
+obs_metrics_operation metrics_classify_operation(const request_params *params);
+
+void metrics_record_handle_pool(int hit);
+
+void metrics_record_retry(int operation);
+
+/**
+ * 上层重试循环在每次发起请求前调用，retry为本次重试序号（首次请求为0）。
+ * retry大于0时计入operation的重试次数；本线程随后发起的请求在跟踪信息中带上该序号，
+ * 循环结束后应以0复位
+ */
+void metrics_set_retry(int operation, unsigned int retry);
+
+int metrics_current_retry(void);
+
+/**
+ * 请求结束、状态码已转换后调用，从curl句柄读取耗时分解、字节数和连接数，
+ * 计入指标并调用请求跟踪回调
+ */
+void metrics_record_request(http_request *request);
+
+#endif /* METRICS_H */
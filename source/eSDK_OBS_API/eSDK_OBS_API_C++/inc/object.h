@@ -20,6 +20,9 @@
 #include "simplexml.h"
 #include "securec.h"
 #include "common.h"
+#include "metadata_cache.h"
+#include "client_encryption.h"
+#include "xml_writer.h"
 
 #if defined WIN32
 #include <io.h>
@@ -43,7 +46,6 @@
 #define MAX_KEY_SIZE 1024
 #define MAX_THREAD_NUM 100
 #define MAX_READ_ONCE (5*1024*1024)
-#define ONE_PART_REQUEST_XML_LEN 256
 #define MAX_XML_DEPTH 4
 
 
@@ -119,8 +121,9 @@ typedef struct complete_multi_part_upload_data
     obs_response_complete_callback *responseCompleteCallback;
     obs_complete_multi_part_upload_callback *complete_multipart_upload_callback;
     void *callback_data;
-    char* doc;
-    int docLen, docBytesWritten;
+    xml_writer writer;
+    unsigned int part_number;
+    obs_complete_upload_Info *complete_upload_Info;
     string_buffer(location, 256);
     string_buffer(etag, 256);
     string_buffer(bucket, 256);
@@ -255,6 +258,8 @@ typedef struct _upload_file_summary
     char upload_id[MAX_SIZE_UPLOADID];
     char  bucket_name[MAX_BKTNAME_SIZE];
     char  key[MAX_KEY_SIZE];
+    char encryptionKey[CLIENT_ENCRYPTION_TEXT_SIZE];//wrapped data key, empty if not client encrypted
+    char encryptionIv[CLIENT_ENCRYPTION_TEXT_SIZE];
 }upload_file_summary;
 
 typedef struct _upload_params
@@ -274,6 +279,8 @@ typedef struct _upload_params
     uint64_t totalFileSize;
     uint64_t uploadedSize;
     int *pause_upload_flag;
+    client_encryption_context *client_encryption;
+    void * xmlWriteMutex;//the checkpoint lock of this transfer
 }upload_params;
 
 typedef struct
@@ -318,6 +325,8 @@ typedef struct _upload_file_callback_data
     void * callbackDataIn;//the callback data pass from client
     upload_file_progress_info *progressInfo;
     obs_progress_callback *progressCallback;
+    client_encryption_part *cipher;//NULL if not client encrypted
+    void * xmlWriteMutex;
 }upload_file_callback_data;
 
 typedef struct
@@ -354,12 +363,17 @@ typedef struct _download_params
     obs_get_conditions *get_conditions;
     obs_response_handler * response_handler;
     void * callBackData;	
+    client_encryption_context *client_encryption;
+    uint64_t objectLength;//plaintext size of the whole object
 }download_params;
 
 typedef struct 
 {
     download_file_summary * pstFileInfo;
     obs_status retStatus;
+    const obs_client_encryption_params *clientEncryptionParams;
+    client_encryption_context *clientEncryption;
+    obs_status clientEncryptionStatus;
 }get_object_metadata_callback_data;
 
 typedef struct
@@ -382,6 +396,9 @@ typedef struct _download_file_callback_data
     download_file_part_info *pstDownloadFilePartInfo;// this store the info about one part        
     void * callbackDataIn;//the callback data pass from client
     void * xmlWriteMutex;
+    client_encryption_part *cipher;//NULL if not client encrypted
+    char *partFileName;//the part file, only written after the part is verified
+    char *stagingFileName;//the decrypted part before its tag is verified
 }download_file_callback_data;
 
 typedef struct  delete_object_contents
@@ -401,8 +418,10 @@ typedef struct delete_object_data
     obs_response_complete_callback *responseCompleteCallback;
     obs_delete_object_data_callback *delete_object_data_callback;
     void *callback_data;
-    char doc[OBS_MAX_DELETE_OBJECT_DOC];
-    int docLen, docBytesWritten;
+    xml_writer writer;
+    obs_object_info *object_info;
+    unsigned int keys_number;
+    int quiet;
     int contents_count;
     delete_object_contents contents[OBS_MAX_DELETE_OBJECT_NUMBER];
 } delete_object_data;
@@ -456,5 +475,21 @@ obs_status ListPartsPropertiesCallback_Intern(const obs_response_properties *pro
 obs_status copyObjectDataCallback(int buffer_size, const char *buffer,
     void *callback_data);
 
+/**
+ * 同get_object，allow_compressed_range非0时允许范围读取客户端压缩的对象并原样交付压缩数据。
+ * SDK内部按范围拼出整个对象的调用方（get_object_stream、download_file、download_objects、块缓存回源）
+ * 使用该模式，结果与不带范围的get_object一致；公开的get_object对压缩对象的范围读取返回OBS_STATUS_InvalidRange
+ */
+void get_object_internal(const obs_options *options, obs_object_info *object_info,
+    obs_get_conditions *get_conditions, server_side_encryption_params *encryption_params,
+    obs_get_object_handler *handler, void *callback_data, int allow_compressed_range);
+
+/**
+ * 同get_object_metadata，use_cache为0时不查询元数据缓存，用于需要服务端当前ETag的场景
+ */
+void get_object_metadata_internal(const obs_options *options, obs_object_info *object_info,
+    server_side_encryption_params *encryption_params,
+    obs_response_handler *handler, void *callback_data, int use_cache);
+
 #endif
 
@@ -2,5 +2,21 @@
 #define OBS_TIME_UTIL_H
 #include "eSDKOBS.h"
 #include "log.h"
+
+#define OBS_RFC1123_DATE_LEN 29
+#define OBS_LOCAL_TIME_LEN 19
+
 void rfc1123_date_format(char *time_buffer, size_t time_buffer_size, const struct tm *tm, const char* before_date, const char* after_date);
-#endif /* OBS_TIME_UTIL_H */
\ No newline at end of file
+
+/* 公历日期到1970-01-01的天数，month为1~12 */
+int64_t obs_days_from_civil(int64_t year, int month, int day);
+
+/* 不依赖时区和libc锁的gmtime_r，结果写入result并返回result */
+struct tm *obs_gmtime(int64_t seconds, struct tm *result);
+
+/* 当前时间的RFC 1123日期"Sun, 06 Nov 1994 08:49:37 GMT"，按秒缓存，多线程无锁读取 */
+void obs_current_rfc1123_date(char *buffer, size_t buffer_size);
+
+/* 本地时间"YYYY-mm-dd HH:MM:SS"，按秒缓存，供日志使用 */
+void obs_local_time_format(int64_t seconds, char *buffer, size_t buffer_size);
+#endif /* OBS_TIME_UTIL_H */
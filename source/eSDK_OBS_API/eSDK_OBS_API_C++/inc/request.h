@@ -22,6 +22,7 @@
 #include "log.h"
 #include "common.h"
 #include "cJSON.h"
+#include "bandwidth.h"
 
 #ifdef WIN32
 #define LIBOBS_VER_MAJOR "3.24"
@@ -117,6 +118,8 @@ typedef enum
    storage_class
 }obs_storage_class_format;
 
+struct hedge_group;
+struct endpoint_pool_entry;
 
 typedef struct http_request
 {
@@ -124,6 +127,7 @@ typedef struct http_request
     obs_status status;
     int httpResponseCode;
     struct curl_slist *headers;
+    struct curl_slist *resolve;               // 解析缓存注入的CURLOPT_RESOLVE列表
     CURL *curl;
     char uri[MAX_URI_SIZE + 1];
     obs_response_properties_callback *properties_callback;
@@ -138,6 +142,12 @@ typedef struct http_request
     int propertiesCallbackMade;
     error_parser errorParser;
     void* pause_handle;
+    int metrics_op;
+    int retry_count;
+    bandwidth_transfer bandwidth;
+    struct hedge_group *hedge;                // 参与对冲时指向共享的hedge_group，否则为NULL
+    struct endpoint_pool_entry *endpoint;     // 从端点池选择的端点，否则为NULL
+    unsigned int ca_generation;               // 取得句柄时的ca_store_generation
 } http_request;
 
 typedef struct obs_cors_conf
@@ -278,6 +288,19 @@ void request_api_deinitialize();
 
 void request_perform(const request_params *params);
 
+/* 以下接口使用调用者持有的http_request和computed values，不经过句柄池，
+   由调用者负责在multi接口中执行请求。设置了endpoint_pool时每次准备选择一个端点，
+   在finish或destroy时归还 */
+obs_status request_prepare_reusable(const request_params *params,
+    request_computed_values *values, http_request *request);
+
+void request_finish_reusable(http_request *request);
+
+void request_destroy_reusable(http_request *request);
+
+/* 并发发出count个请求以建立连接，结束后句柄连同连接放回句柄池，warmed返回成功建立的连接数 */
+obs_status request_prewarm(const request_params *params, unsigned int count, unsigned int *warmed);
+
 void set_use_api_switch(const obs_options *options ,obs_use_api *use_api_temp);
 
 obs_use_api get_api_protocol(char *bucket_name, char *host_name);
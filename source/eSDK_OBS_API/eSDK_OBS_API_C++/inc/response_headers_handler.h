@@ -25,6 +25,20 @@
 
 #define else_if else if
 
+/**
+ * 响应头分类，STRING类头的值直接拷贝到obs_response_properties对应字段
+ */
+typedef enum
+{
+    RESPONSE_HEADER_UNKNOWN = 0,
+    RESPONSE_HEADER_IGNORED,
+    RESPONSE_HEADER_STRING,
+    RESPONSE_HEADER_CONTENT_LENGTH,
+    RESPONSE_HEADER_SSE,
+    RESPONSE_HEADER_SSE_CUSTOMER_ALGORITHM,
+    RESPONSE_HEADER_META,
+    RESPONSE_HEADER_ERROR
+} response_header_type;
 
 typedef struct response_headers_handler
 {
@@ -44,8 +58,11 @@ typedef struct response_headers_handler
 
 void response_headers_handler_initialize(response_headers_handler *handler);
 
-void response_headers_handler_add(response_headers_handler *handler,
-                                  char *data, int dataLen);
+/**
+ * 解析一行响应头(就地去掉行尾空白)，返回其分类
+ */
+response_header_type response_headers_handler_add(response_headers_handler *handler,
+                                                  char *data, int dataLen);
 
 void response_headers_handler_done(response_headers_handler *handler, 
                                    CURL *curl);
@@ -0,0 +1,76 @@
+/*********************************************************************************
+* Copyright 2024 Huawei Technologies Co.,Ltd.
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+* this file except in compliance with the License.  You may obtain a copy of the
+* License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed
+* under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+* CONDITIONS OF ANY KIND, either express or implied.  See the License for the
+* specific language governing permissions and limitations under the License.
+**********************************************************************************
+*/
+#ifndef XML_WRITER_H
+#define XML_WRITER_H
+
+#include <stdint.h>
+#include "util.h"
+
+typedef struct xml_writer xml_writer;
+
+/**
+ * 生成文档的第index条记录并返回1，index超出文档末尾时不输出并返回0。
+ * 跨越读缓冲区边界的记录会被重新生成，同一index每次必须输出相同内容。
+ */
+typedef int (xml_writer_record_callback)(xml_writer *writer, unsigned int index, void *record_data);
+
+/**
+ * 流式XML请求体：文档不落地，在curl读回调中按记录逐段生成，
+ * 只把落在本次读缓冲区内的字节直接写入curl的缓冲区
+ */
+struct xml_writer
+{
+    xml_writer_record_callback *record_callback;
+    void *record_data;
+    unsigned int record;        /* 下一条待输出的记录 */
+    int64_t record_offset;      /* 该记录在文档中的起始偏移 */
+    int64_t bytes_written;      /* 已交给curl的字节数 */
+    int64_t position;           /* 生成过程中的当前偏移 */
+    char *out;                  /* 本次读缓冲区，对应偏移bytes_written，计算长度时为NULL */
+    int64_t window_end;
+    void *md5_context;
+    int finished;
+};
+
+void xml_writer_initialize(xml_writer *writer, xml_writer_record_callback *record_callback,
+    void *record_data);
+
+/* 完整生成一遍文档但不保存，返回文档长度；md5非NULL时同时计算16字节MD5 */
+int64_t xml_writer_measure(xml_writer *writer, unsigned char *md5);
+
+/* 正在xml_writer_measure中生成时返回1，记录回调中的参数错误日志只需在此时输出一次 */
+int xml_writer_measuring(const xml_writer *writer);
+
+/* 重新从文档开头输出 */
+void xml_writer_rewind(xml_writer *writer);
+
+/* 在curl读回调中生成下一段文档，返回写入buffer的字节数，0表示文档结束 */
+int xml_writer_read(xml_writer *writer, char *buffer, int buffer_size);
+
+void xml_writer_raw(xml_writer *writer, const char *data, size_t len);
+
+/* <element_name> */
+void xml_writer_open(xml_writer *writer, const char *element_name);
+
+/* </element_name> */
+void xml_writer_close(xml_writer *writer, const char *element_name);
+
+/* <element_name>content</element_name>，与add_xml_element一致，content为NULL或空串时不输出 */
+void xml_writer_element(xml_writer *writer, const char *element_name, const char *content,
+    eFormalizeChoice needFormalize);
+
+void xml_writer_element_uint(xml_writer *writer, const char *element_name, unsigned int value);
+
+#endif /* XML_WRITER_H */
@@ -0,0 +1,332 @@
+/*********************************************************************************
+* Copyright 2024 Huawei Technologies Co.,Ltd.
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+* this file except in compliance with the License.  You may obtain a copy of the
+* License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed
+* under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+* CONDITIONS OF ANY KIND, either express or implied.  See the License for the
+* specific language governing permissions and limitations under the License.
+**********************************************************************************
+*/
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include "bandwidth.h"
+#include "securec.h"
+#include "log.h"
+
+#if defined __GNUC__ || defined LINUX
+#include <pthread.h>
+#else
+#include <windows.h>
+#endif
+
+#define BANDWIDTH_BURST_SECONDS     0.05      // 空闲后允许的突发量，按50ms流量计
+#define BANDWIDTH_YIELD_PERCENT     10        // 让行时较低优先级最多使用的带宽比例
+
+/**
+ * 令牌桶限速器，按GCRA记录每个方向的理论到达时间，预约即推进，不足时调用方休眠
+ */
+typedef struct bandwidth_limiter
+{
+    struct bandwidth_limiter *next;
+    char *bucket_name;                        // 桶限速器的桶名，其他为NULL
+    int yield;                                // 是否在优先级之间让行
+    uint64_t rate[BANDWIDTH_DIRECTIONS];
+    double tat[BANDWIDTH_DIRECTIONS];
+    /* 让行期间各优先级单独按BANDWIDTH_YIELD_PERCENT的速率预约 */
+    double yield_tat[BANDWIDTH_DIRECTIONS][OBS_BANDWIDTH_PRIORITY_BUTT];
+    unsigned int active[OBS_BANDWIDTH_PRIORITY_BUTT];
+} bandwidth_limiter;
+
+volatile int g_bandwidth_enabled = 0;
+static int g_bandwidth_initialized = 0;
+static bandwidth_limiter g_global_limiter;
+static bandwidth_limiter g_priority_limiters[OBS_BANDWIDTH_PRIORITY_BUTT];
+static bandwidth_limiter *g_bucket_limiters = NULL;
+
+/* 各优先级的高低，值大的优先 */
+static const int g_priority_rank[OBS_BANDWIDTH_PRIORITY_BUTT] = {1, 2, 0};
+
+#if defined __GNUC__ || defined LINUX
+static pthread_mutex_t g_bandwidth_mutex;
+#else
+static CRITICAL_SECTION g_bandwidth_mutex;
+#endif
+
+static void bandwidth_lock(void)
+{
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_lock(&g_bandwidth_mutex);
+#else
+    EnterCriticalSection(&g_bandwidth_mutex);
+#endif
+}
+
+static void bandwidth_unlock(void)
+{
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_unlock(&g_bandwidth_mutex);
+#else
+    LeaveCriticalSection(&g_bandwidth_mutex);
+#endif
+}
+
+static double bandwidth_now(void)
+{
+#if defined __GNUC__ || defined LINUX
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+#else
+    return (double)GetTickCount64() / 1000.0;
+#endif
+}
+
+static void bandwidth_sleep(double seconds)
+{
+#if defined __GNUC__ || defined LINUX
+    struct timespec ts;
+    ts.tv_sec = (time_t)seconds;
+    ts.tv_nsec = (long)((seconds - (double)ts.tv_sec) * 1e9);
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+#else
+    Sleep((DWORD)(seconds * 1000 + 0.5));
+#endif
+}
+
+static void bandwidth_limiter_reset(bandwidth_limiter *limiter, int yield)
+{
+    memset_s(limiter, sizeof(bandwidth_limiter), 0, sizeof(bandwidth_limiter));
+    limiter->yield = yield;
+}
+
+static int bandwidth_limiter_used(const bandwidth_limiter *limiter)
+{
+    return limiter->rate[BANDWIDTH_UPLOAD] != 0 || limiter->rate[BANDWIDTH_DOWNLOAD] != 0;
+}
+
+static int bandwidth_higher_active(const bandwidth_limiter *limiter, obs_bandwidth_priority priority)
+{
+    int i;
+    for (i = 0; i < OBS_BANDWIDTH_PRIORITY_BUTT; i++) {
+        if (g_priority_rank[i] > g_priority_rank[priority] && limiter->active[i] > 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * 按rate预约bytes字节，返回允许发送的时刻
+ */
+static double bandwidth_reserve(double *tat, double rate, double now, size_t bytes)
+{
+    double start = *tat > now ? *tat : now;
+    *tat = start + (double)bytes / rate;
+    return *tat - BANDWIDTH_BURST_SECONDS;
+}
+
+static bandwidth_limiter *bandwidth_find_bucket(const char *bucket_name)
+{
+    bandwidth_limiter *limiter = g_bucket_limiters;
+    while (limiter && strcmp(limiter->bucket_name, bucket_name)) {
+        limiter = limiter->next;
+    }
+    return limiter;
+}
+
+void bandwidth_initialize(void)
+{
+    if (g_bandwidth_initialized) {
+        return;
+    }
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_init(&g_bandwidth_mutex, NULL);
+#else
+    InitializeCriticalSection(&g_bandwidth_mutex);
+#endif
+    bandwidth_limiter_reset(&g_global_limiter, 1);
+    g_bandwidth_initialized = 1;
+}
+
+void bandwidth_deinitialize(void)
+{
+    int i;
+    if (!g_bandwidth_initialized) {
+        return;
+    }
+    bandwidth_lock();
+    g_bandwidth_enabled = 0;
+    while (g_bucket_limiters) {
+        bandwidth_limiter *limiter = g_bucket_limiters;
+        g_bucket_limiters = limiter->next;
+        free(limiter->bucket_name);
+        free(limiter);
+    }
+    bandwidth_limiter_reset(&g_global_limiter, 1);
+    for (i = 0; i < OBS_BANDWIDTH_PRIORITY_BUTT; i++) {
+        bandwidth_limiter_reset(&g_priority_limiters[i], 0);
+    }
+    bandwidth_unlock();
+}
+
+void bandwidth_transfer_begin(bandwidth_transfer *transfer, const char *bucket_name,
+    obs_bandwidth_priority priority)
+{
+    bandwidth_limiter *limiter = NULL;
+    int i;
+
+    transfer->limiter_count = 0;
+    transfer->priority = (priority >= OBS_BANDWIDTH_PRIORITY_NORMAL && priority < OBS_BANDWIDTH_PRIORITY_BUTT) ?
+        priority : OBS_BANDWIDTH_PRIORITY_NORMAL;
+    if (!g_bandwidth_enabled) {
+        return;
+    }
+
+    bandwidth_lock();
+    if (bandwidth_limiter_used(&g_global_limiter)) {
+        transfer->limiters[transfer->limiter_count++] = &g_global_limiter;
+    }
+    if (bucket_name && (limiter = bandwidth_find_bucket(bucket_name)) != NULL && bandwidth_limiter_used(limiter)) {
+        transfer->limiters[transfer->limiter_count++] = limiter;
+    }
+    if (bandwidth_limiter_used(&g_priority_limiters[transfer->priority])) {
+        transfer->limiters[transfer->limiter_count++] = &g_priority_limiters[transfer->priority];
+    }
+    for (i = 0; i < transfer->limiter_count; i++) {
+        transfer->limiters[i]->active[transfer->priority]++;
+    }
+    bandwidth_unlock();
+}
+
+void bandwidth_transfer_end(bandwidth_transfer *transfer)
+{
+    int i;
+    if (transfer->limiter_count == 0) {
+        return;
+    }
+    bandwidth_lock();
+    for (i = 0; i < transfer->limiter_count; i++) {
+        transfer->limiters[i]->active[transfer->priority]--;
+    }
+    bandwidth_unlock();
+    transfer->limiter_count = 0;
+}
+
+void bandwidth_consume(bandwidth_transfer *transfer, int direction, size_t bytes)
+{
+    double now;
+    double ready;
+    int i;
+
+    if (transfer->limiter_count == 0 || bytes == 0) {
+        return;
+    }
+    bandwidth_lock();
+    now = bandwidth_now();
+    ready = now;
+    for (i = 0; i < transfer->limiter_count; i++) {
+        bandwidth_limiter *limiter = transfer->limiters[i];
+        double rate = (double)limiter->rate[direction];
+        double allowed;
+        if (rate <= 0) {
+            continue;
+        }
+        allowed = bandwidth_reserve(&limiter->tat[direction], rate, now, bytes);
+        if (limiter->yield && bandwidth_higher_active(limiter, transfer->priority)) {
+            double yield_allowed = bandwidth_reserve(&limiter->yield_tat[direction][transfer->priority],
+                rate * BANDWIDTH_YIELD_PERCENT / 100, now, bytes);
+            allowed = yield_allowed > allowed ? yield_allowed : allowed;
+        }
+        ready = allowed > ready ? allowed : ready;
+    }
+    bandwidth_unlock();
+    if (ready > now) {
+        bandwidth_sleep(ready - now);
+    }
+}
+
+static void bandwidth_set_rate(bandwidth_limiter *limiter, uint64_t upload_bytes_per_second,
+    uint64_t download_bytes_per_second)
+{
+    limiter->rate[BANDWIDTH_UPLOAD] = upload_bytes_per_second;
+    limiter->rate[BANDWIDTH_DOWNLOAD] = download_bytes_per_second;
+    if (upload_bytes_per_second || download_bytes_per_second) {
+        g_bandwidth_enabled = 1;
+    }
+}
+
+obs_status obs_set_bandwidth_limit(uint64_t upload_bytes_per_second, uint64_t download_bytes_per_second)
+{
+    if (!g_bandwidth_initialized) {
+        COMMLOG(OBS_LOGERROR, "%s: obs_initialize has not been called", __FUNCTION__);
+        return OBS_STATUS_InitCurlFailed;
+    }
+    bandwidth_lock();
+    bandwidth_set_rate(&g_global_limiter, upload_bytes_per_second, download_bytes_per_second);
+    bandwidth_unlock();
+    return OBS_STATUS_OK;
+}
+
+obs_status obs_set_bucket_bandwidth_limit(const char *bucket_name, uint64_t upload_bytes_per_second,
+    uint64_t download_bytes_per_second)
+{
+    bandwidth_limiter *limiter = NULL;
+    size_t name_len = 0;
+    if (bucket_name == NULL || bucket_name[0] == '\0') {
+        COMMLOG(OBS_LOGERROR, "%s: bucket_name is empty", __FUNCTION__);
+        return OBS_STATUS_InvalidBucketName;
+    }
+    if (!g_bandwidth_initialized) {
+        COMMLOG(OBS_LOGERROR, "%s: obs_initialize has not been called", __FUNCTION__);
+        return OBS_STATUS_InitCurlFailed;
+    }
+
+    bandwidth_lock();
+    limiter = bandwidth_find_bucket(bucket_name);
+    if (limiter == NULL) {
+        // 桶限速器在obs_deinitialize之前不释放，进行中的请求可能仍持有
+        name_len = strlen(bucket_name) + 1;
+        limiter = (bandwidth_limiter *)malloc(sizeof(bandwidth_limiter));
+        if (limiter == NULL) {
+            bandwidth_unlock();
+            return OBS_STATUS_OutOfMemory;
+        }
+        bandwidth_limiter_reset(limiter, 1);
+        if ((limiter->bucket_name = (char *)malloc(name_len)) == NULL) {
+            bandwidth_unlock();
+            free(limiter);
+            return OBS_STATUS_OutOfMemory;
+        }
+        memcpy_s(limiter->bucket_name, name_len, bucket_name, name_len);
+        limiter->next = g_bucket_limiters;
+        g_bucket_limiters = limiter;
+    }
+    bandwidth_set_rate(limiter, upload_bytes_per_second, download_bytes_per_second);
+    bandwidth_unlock();
+    return OBS_STATUS_OK;
+}
+
+obs_status obs_set_priority_bandwidth_limit(obs_bandwidth_priority priority,
+    uint64_t upload_bytes_per_second, uint64_t download_bytes_per_second)
+{
+    if (priority < OBS_BANDWIDTH_PRIORITY_NORMAL || priority >= OBS_BANDWIDTH_PRIORITY_BUTT) {
+        COMMLOG(OBS_LOGERROR, "%s: invalid priority %d", __FUNCTION__, (int)priority);
+        return OBS_STATUS_InvalidParameter;
+    }
+    if (!g_bandwidth_initialized) {
+        COMMLOG(OBS_LOGERROR, "%s: obs_initialize has not been called", __FUNCTION__);
+        return OBS_STATUS_InitCurlFailed;
+    }
+    bandwidth_lock();
+    bandwidth_set_rate(&g_priority_limiters[priority], upload_bytes_per_second, download_bytes_per_second);
+    bandwidth_unlock();
+    return OBS_STATUS_OK;
+}
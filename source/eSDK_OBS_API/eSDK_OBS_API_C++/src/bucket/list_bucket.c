@@ -43,8 +43,6 @@ obs_status xml_callback_nodata(const char* element_path, xml_callback_data* cbDa
 {
     if (!strcmp(element_path, "ListAllMyBucketsResult/Buckets/Bucket")) {
         time_t creationDate = parseIso8601Time(cbData->creationDate);
-        int nTimeZone = getTimeZone();
-        creationDate += nTimeZone * SECONDS_TO_AN_HOUR;
 
         obs_status status = (*(cbData->listServiceCallback))
             (cbData->owner_id, cbData->owner_display_name,
@@ -90,8 +88,6 @@ obs_status xml_obs_callback_nodata(const char* element_path, xml_obs_callback_da
 {
     if (!strcmp(element_path, "ListAllMyBucketsResult/Buckets/Bucket")) {
         time_t creationDate = parseIso8601Time(cbData->creationDate);
-        int nTimeZone = getTimeZone();
-        creationDate += nTimeZone * SECONDS_TO_AN_HOUR;
 
         obs_status status = (*(cbData->listServiceCallback))
             (cbData->owner_id, cbData->bucket_name,
@@ -120,8 +120,6 @@ static obs_status make_list_multipart_uploads_callback(list_multipart_uploads_da
                 uploadSrc->initiator_display_name : 0);
             upload_dest->storage_class = uploadSrc->storage_class;
             upload_dest->initiated = parseIso8601Time(uploadSrc->initiated);
-            int nTimeZone = getTimeZone();
-            upload_dest->initiated += nTimeZone * SECONDS_TO_AN_HOUR;
         }
     }
 
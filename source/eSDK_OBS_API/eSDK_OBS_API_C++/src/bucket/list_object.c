@@ -163,8 +163,6 @@ static obs_status make_list_bucket_callback(list_objects_data *lbData)
             one_object_content *contentSrc = &(lbData->contents[i]);
             contentDest->key = contentSrc->key;
             contentDest->last_modified = parseIso8601Time(contentSrc->last_modified);
-            int nTimeZone = getTimeZone();
-            contentDest->last_modified += nTimeZone * SECONDS_TO_AN_HOUR;
             contentDest->etag = contentSrc->etag;
             contentDest->size = parseUnsignedInt(contentSrc->size);
             contentDest->owner_id = contentSrc->owner_id[0] ? contentSrc->owner_id : 0;
@@ -83,8 +83,6 @@ static obs_status make_list_versions_callback(list_versions_data *lvData)
         list_versions_info->versions[i].is_latest = versionSrc->is_latest;
 
         list_versions_info->versions[i].last_modified = parseIso8601Time(versionSrc->last_modified);
-        int nTimeZone = getTimeZone();
-        list_versions_info->versions[i].last_modified += nTimeZone * SECONDS_TO_AN_HOUR;
 
         list_versions_info->versions[i].etag = versionSrc->etag;
         list_versions_info->versions[i].size = parseUnsignedInt(versionSrc->size);
@@ -16,36 +16,61 @@
 #include "request_util.h"
 #include <openssl/md5.h> 
 
-static obs_status set_cors_xml_elements(const char **elements, unsigned int elements_num,
-    char *element_name, set_cors_config_data *sbccData)
+/* CORS规则生成的XML长度上限 */
+#define SET_CORS_MAX_XML_LENGTH (1024 * 10)
+
+static void set_cors_xml_elements(xml_writer *writer, const char **elements,
+    unsigned int elements_num, char *element_name)
 {
     unsigned int uiIdx = 0;
     for (uiIdx = 0; uiIdx < elements_num; uiIdx++)
     {
         if (NULL != elements[uiIdx])
         {
-            (void)add_xml_element(sbccData->doc, &sbccData->doc_len, element_name,
-                elements[uiIdx], NEED_FORMALIZE, ADD_NAME_CONTENT);
+            xml_writer_element(writer, element_name, elements[uiIdx], NEED_FORMALIZE);
         }
+    }
+}
 
-        if ((sbccData->doc_len >= 1024 * 10) && (uiIdx != (elements_num - 1)))
-        {
-            COMMLOG(OBS_LOGERROR, "set cors fail,element_name(%s) Number(%u) too much.",
-                element_name, elements_num);
-            return OBS_STATUS_InvalidParameter;
-        }
+/* 记录0为文档头，1~conf_num依次为各条CORSRule，其后为文档尾 */
+static int set_cors_xml_record(xml_writer *writer, unsigned int index, void *record_data)
+{
+    set_cors_config_data *sbccData = (set_cors_config_data *)record_data;
+    obs_bucket_cors_conf *conf = NULL;
+
+    if (index == 0)
+    {
+        xml_writer_open(writer, "CORSConfiguration");
+        return 1;
     }
-    return OBS_STATUS_OK;
+    if (index > sbccData->conf_num + 1)
+    {
+        return 0;
+    }
+    if (index == sbccData->conf_num + 1)
+    {
+        xml_writer_close(writer, "CORSConfiguration");
+        return 1;
+    }
+
+    conf = &sbccData->obs_cors_conf_info[index - 1];
+    xml_writer_open(writer, "CORSRule");
+    xml_writer_element(writer, "ID", conf->id, NEED_FORMALIZE);
+    set_cors_xml_elements(writer, conf->allowed_method, conf->allowed_method_number, "AllowedMethod");
+    set_cors_xml_elements(writer, conf->allowed_origin, conf->allowed_origin_number, "AllowedOrigin");
+    set_cors_xml_elements(writer, conf->allowed_header, conf->allowed_header_number, "AllowedHeader");
+    xml_writer_element(writer, "MaxAgeSeconds", conf->max_age_seconds, NEED_FORMALIZE);
+    set_cors_xml_elements(writer, conf->expose_header, conf->expose_header_number, "ExposeHeader");
+    xml_writer_close(writer, "CORSRule");
+    return 1;
 }
 
-static obs_status set_cors_quest_xml(obs_bucket_cors_conf *obs_cors_conf_info,
-    unsigned int conf_num, set_cors_config_data *sbccData)
+static obs_status init_cors_data(obs_bucket_cors_conf *obs_cors_conf_info,
+    unsigned int conf_num, obs_response_handler *handler, void *callback_data,
+    set_cors_config_data **cors_data)
 {
+    unsigned char doc_md5[16];
     unsigned int i = 0;
-    obs_status ret_status = OBS_STATUS_OK;
-
-    (void)add_xml_element(sbccData->doc, &sbccData->doc_len, "CORSConfiguration", NULL,
-        NOT_NEED_FORMALIZE, ADD_HEAD_ONLY);
     for (i = 0; i < conf_num; ++i)
     {
         if (NULL == obs_cors_conf_info[i].allowed_method || NULL == obs_cors_conf_info[i].allowed_origin)
@@ -54,117 +79,41 @@ static obs_status set_cors_quest_xml(obs_bucket_cors_conf *obs_cors_conf_info,
                 obs_cors_conf_info[i].allowed_method, obs_cors_conf_info[i].allowed_origin);
             return OBS_STATUS_InvalidParameter;
         }
-
-        (void)add_xml_element(sbccData->doc, &sbccData->doc_len, "CORSRule", NULL,
-            NOT_NEED_FORMALIZE, ADD_HEAD_ONLY);
-        if (obs_cors_conf_info[i].id)
-        {
-            (void)add_xml_element(sbccData->doc, &sbccData->doc_len, "ID",
-                obs_cors_conf_info[i].id, NEED_FORMALIZE, ADD_NAME_CONTENT);
-        }
-
-        ret_status = set_cors_xml_elements(obs_cors_conf_info[i].allowed_method,
-            obs_cors_conf_info[i].allowed_method_number, "AllowedMethod", sbccData);
-        if (OBS_STATUS_OK != ret_status)
-        {
-            return OBS_STATUS_InvalidParameter;
-        }
-
-        ret_status = set_cors_xml_elements(obs_cors_conf_info[i].allowed_origin,
-            obs_cors_conf_info[i].allowed_origin_number, "AllowedOrigin", sbccData);
-        if (OBS_STATUS_OK != ret_status)
-        {
-            return OBS_STATUS_InvalidParameter;
-        }
-
-        ret_status = set_cors_xml_elements(obs_cors_conf_info[i].allowed_header,
-            obs_cors_conf_info[i].allowed_header_number, "AllowedHeader", sbccData);
-        if (OBS_STATUS_OK != ret_status)
-        {
-            return OBS_STATUS_InvalidParameter;
-        }
-
-        if (obs_cors_conf_info[i].max_age_seconds)
-        {
-            (void)add_xml_element(sbccData->doc, &sbccData->doc_len, "MaxAgeSeconds",
-                obs_cors_conf_info[i].max_age_seconds, NEED_FORMALIZE, ADD_NAME_CONTENT);
-        }
-
-        ret_status = set_cors_xml_elements(obs_cors_conf_info[i].expose_header,
-            obs_cors_conf_info[i].expose_header_number, "ExposeHeader", sbccData);
-        if (OBS_STATUS_OK != ret_status)
-        {
-            return OBS_STATUS_InvalidParameter;
-        }
-
-        (void)add_xml_element(sbccData->doc, &sbccData->doc_len, "CORSRule", NULL,
-            NOT_NEED_FORMALIZE, ADD_TAIL_ONLY);
     }
 
-    (void)add_xml_element(sbccData->doc, &sbccData->doc_len, "CORSConfiguration", NULL,
-        NOT_NEED_FORMALIZE, ADD_TAIL_ONLY);
-
-    return OBS_STATUS_OK;
-}
-
-static set_cors_config_data* init_cors_data(obs_bucket_cors_conf *obs_cors_conf_info,
-    unsigned int conf_num, obs_response_handler *handler, void *callback_data)
-{
-    unsigned char doc_md5[16];
-    obs_status ret_status = OBS_STATUS_OK;
     set_cors_config_data *sbccData = (set_cors_config_data *)malloc(sizeof(set_cors_config_data));
     if (!sbccData)
     {
-        (void)(*(handler->complete_callback))(OBS_STATUS_OutOfMemory, 0, 0);
         COMMLOG(OBS_LOGERROR, "malloc cors_data failed.");
-        return NULL;
+        return OBS_STATUS_OutOfMemory;
     }
     memset_s(sbccData, sizeof(set_cors_config_data), 0, sizeof(set_cors_config_data));
 
     sbccData->response_complete_callback = handler->complete_callback;
     sbccData->response_properties_callback = handler->properties_callback;
     sbccData->callback_data = callback_data;
-    sbccData->doc_len = 0;
-    sbccData->doc_bytes_written = 0;
+    sbccData->obs_cors_conf_info = obs_cors_conf_info;
+    sbccData->conf_num = conf_num;
 
-    ret_status = set_cors_quest_xml(obs_cors_conf_info, conf_num, sbccData);
-    if (OBS_STATUS_OK != ret_status || sbccData->doc_len <= 0)
+    xml_writer_initialize(&sbccData->writer, &set_cors_xml_record, sbccData);
+    sbccData->doc_len = xml_writer_measure(&sbccData->writer, doc_md5);
+    if (sbccData->doc_len > SET_CORS_MAX_XML_LENGTH)
     {
+        COMMLOG(OBS_LOGERROR, "set cors fail, request xml length(%lld) exceeds %d.",
+            (long long)sbccData->doc_len, SET_CORS_MAX_XML_LENGTH);
         free(sbccData);
-        sbccData = NULL;
-        return NULL;
+        return OBS_STATUS_InvalidParameter;
     }
-    COMMLOG(OBS_LOGERROR, "request xml: %s.", sbccData->doc);
-
-    MD5((unsigned char *)sbccData->doc, (size_t)sbccData->doc_len, doc_md5);
     base64Encode(doc_md5, sizeof(doc_md5), sbccData->doc_md5);
 
-    return sbccData;
+    *cors_data = sbccData;
+    return OBS_STATUS_OK;
 }
 
 static int set_cors_data_callback(int buffer_size, char *buffer, void *callback_data)
 {
     set_cors_config_data *sbccData = (set_cors_config_data *)callback_data;
-
-    if (!sbccData->doc_len) {
-        return 0;
-    }
-
-    int remaining = (sbccData->doc_len - sbccData->doc_bytes_written);
-
-    int toCopy = buffer_size > remaining ? remaining : buffer_size;
-
-    if (!toCopy) {
-        return 0;
-    }
-
-    errno_t err = EOK;
-    err = memcpy_s(buffer, buffer_size, &(sbccData->doc[sbccData->doc_bytes_written]), toCopy);
-    CheckAndLogNoneZero(err, "memcpy_s", __FUNCTION__, __LINE__);
-
-    sbccData->doc_bytes_written += toCopy;
-
-    return toCopy;
+    return xml_writer_read(&sbccData->writer, buffer, buffer_size);
 }
 
 static obs_status set_cors_properties_callback(const obs_response_properties *response_properties,
@@ -222,11 +171,10 @@ void set_bucket_cors_configuration(const obs_options *options, obs_bucket_cors_c
         return;
     }
 
-    sbccData = init_cors_data(obs_cors_conf_info, conf_num, handler, callback_data);
-    if (!sbccData)
+    obs_status status = init_cors_data(obs_cors_conf_info, conf_num, handler, callback_data, &sbccData);
+    if (OBS_STATUS_OK != status)
     {
-        (void)(*(handler->complete_callback))(OBS_STATUS_OutOfMemory, 0, callback_data);
-        COMMLOG(OBS_LOGERROR, "malloc sbccData failed.");
+        (void)(*(handler->complete_callback))(status, 0, callback_data);
         return;
     }
 
@@ -16,23 +16,22 @@
 #include "request_util.h"
 #include <openssl/md5.h> 
 
-void add_xml_element_expiration(set_lifecycle_data* sblcData, obs_lifecycle_conf* bucket_lifecycle_conf, unsigned int i)
+void add_xml_element_expiration(xml_writer *writer, obs_lifecycle_conf* bucket_lifecycle_conf, unsigned int i)
 {
-    (void)add_xml_element(sblcData->doc, &sblcData->docLen, "Expiration", NULL, NOT_NEED_FORMALIZE, ADD_HEAD_ONLY);
+    xml_writer_open(writer, "Expiration");
 
     if (bucket_lifecycle_conf[i].days) {
-        (void)add_xml_element(sblcData->doc, &sblcData->docLen, "Days", bucket_lifecycle_conf[i].days,
-            NEED_FORMALIZE, ADD_NAME_CONTENT);
+        xml_writer_element(writer, "Days", bucket_lifecycle_conf[i].days, NEED_FORMALIZE);
     }
     if (bucket_lifecycle_conf[i].date) {
         char date_Iso8601[50] = { 0 };
         changeTimeFormat(bucket_lifecycle_conf[i].date, date_Iso8601);
-        (void)add_xml_element(sblcData->doc, &sblcData->docLen, "Date", date_Iso8601, NEED_FORMALIZE, ADD_NAME_CONTENT);
+        xml_writer_element(writer, "Date", date_Iso8601, NEED_FORMALIZE);
     }
-    (void)add_xml_element(sblcData->doc, &sblcData->docLen, "Expiration", NULL, NEED_FORMALIZE, ADD_TAIL_ONLY);
+    xml_writer_close(writer, "Expiration");
 }
 
-void add_xml_element_transition(set_lifecycle_data* sblcData, obs_lifecycle_conf* bucket_lifecycle_conf, unsigned int i, char** pp_storage_class)
+void add_xml_element_transition(xml_writer *writer, obs_lifecycle_conf* bucket_lifecycle_conf, unsigned int i, char** pp_storage_class)
 {
     unsigned int j = 0;
     int is_true = 0;
@@ -44,7 +43,10 @@ void add_xml_element_transition(set_lifecycle_data* sblcData, obs_lifecycle_conf
 
         if (is_true)
         {
-            COMMLOG(OBS_LOGERROR, "date and days are both NULL for transition No %d!", j);
+            if (xml_writer_measuring(writer))
+            {
+                COMMLOG(OBS_LOGERROR, "date and days are both NULL for transition No %d!", j);
+            }
             break;
         }
 
@@ -52,30 +54,33 @@ void add_xml_element_transition(set_lifecycle_data* sblcData, obs_lifecycle_conf
             (tempStorageClass != OBS_STORAGE_CLASS_GLACIER));
         if (is_true)
         {
-            COMMLOG(OBS_LOGERROR, "storage_class[%d] for transition No %d, only glacier and standard-la are valid !",
-                tempStorageClass, j);
+            if (xml_writer_measuring(writer))
+            {
+                COMMLOG(OBS_LOGERROR, "storage_class[%d] for transition No %d, only glacier and standard-la are valid !",
+                    tempStorageClass, j);
+            }
             break;
         }
 
-        (void)add_xml_element(sblcData->doc, &sblcData->docLen, "Transition", NULL, NOT_NEED_FORMALIZE, ADD_HEAD_ONLY);
+        xml_writer_open(writer, "Transition");
 
         if (bucket_lifecycle_conf[i].transition[j].days)
         {
-            (void)add_xml_element(sblcData->doc, &sblcData->docLen, "Days", bucket_lifecycle_conf[i].transition[j].days, NEED_FORMALIZE, ADD_NAME_CONTENT);
+            xml_writer_element(writer, "Days", bucket_lifecycle_conf[i].transition[j].days, NEED_FORMALIZE);
         }
         if (bucket_lifecycle_conf[i].transition[j].date)
         {
             char date_Iso8601[50] = { 0 };
             changeTimeFormat(bucket_lifecycle_conf[i].transition[j].date, date_Iso8601);
-            (void)add_xml_element(sblcData->doc, &sblcData->docLen, "Date", date_Iso8601, NEED_FORMALIZE, ADD_NAME_CONTENT);
+            xml_writer_element(writer, "Date", date_Iso8601, NEED_FORMALIZE);
         }
-        (void)add_xml_element(sblcData->doc, &sblcData->docLen, "StorageClass", pp_storage_class[tempStorageClass], NEED_FORMALIZE, ADD_NAME_CONTENT);
+        xml_writer_element(writer, "StorageClass", pp_storage_class[tempStorageClass], NEED_FORMALIZE);
 
-        (void)add_xml_element(sblcData->doc, &sblcData->docLen, "Transition", NULL, NOT_NEED_FORMALIZE, ADD_TAIL_ONLY);
+        xml_writer_close(writer, "Transition");
     }
 }
 
-void add_xml_elemet_noversion_transition(set_lifecycle_data* sblcData, obs_lifecycle_conf* bucket_lifecycle_conf, unsigned int i, char** pp_storage_class)
+void add_xml_elemet_noversion_transition(xml_writer *writer, obs_lifecycle_conf* bucket_lifecycle_conf, unsigned int i, char** pp_storage_class)
 {
     unsigned int j = 0;
     int is_true = 0;
@@ -84,7 +89,10 @@ void add_xml_elemet_noversion_transition(set_lifecycle_data* sblcData, obs_lifec
         obs_storage_class tempStorageClass = bucket_lifecycle_conf[i].noncurrent_version_transition[j].storage_class;
         if (bucket_lifecycle_conf[i].noncurrent_version_transition[j].noncurrent_version_days == NULL)
         {
-            COMMLOG(OBS_LOGERROR, "days is NULL for nonCurrentVersionTranstion No %d!", j);
+            if (xml_writer_measuring(writer))
+            {
+                COMMLOG(OBS_LOGERROR, "days is NULL for nonCurrentVersionTranstion No %d!", j);
+            }
             break;
         }
 
@@ -92,102 +100,89 @@ void add_xml_elemet_noversion_transition(set_lifecycle_data* sblcData, obs_lifec
             (tempStorageClass != OBS_STORAGE_CLASS_GLACIER));
         if (is_true)
         {
-            COMMLOG(OBS_LOGERROR, "storage_class[%d] for transition No %d, only glacier and standard-la are valid !",
-                tempStorageClass, j);
+            if (xml_writer_measuring(writer))
+            {
+                COMMLOG(OBS_LOGERROR, "storage_class[%d] for transition No %d, only glacier and standard-la are valid !",
+                    tempStorageClass, j);
+            }
             break;
         }
 
-        (void)add_xml_element(sblcData->doc, &sblcData->docLen, "NoncurrentVersionTransition", NULL, NOT_NEED_FORMALIZE, ADD_HEAD_ONLY);
+        xml_writer_open(writer, "NoncurrentVersionTransition");
 
         if (bucket_lifecycle_conf[i].noncurrent_version_transition[j].noncurrent_version_days)
         {
-            (void)add_xml_element(sblcData->doc, &sblcData->docLen, "NoncurrentDays",
-                bucket_lifecycle_conf[i].noncurrent_version_transition[j].noncurrent_version_days, NEED_FORMALIZE, ADD_NAME_CONTENT);
+            xml_writer_element(writer, "NoncurrentDays",
+                bucket_lifecycle_conf[i].noncurrent_version_transition[j].noncurrent_version_days, NEED_FORMALIZE);
         }
 
-        (void)add_xml_element(sblcData->doc, &sblcData->docLen, "StorageClass", pp_storage_class[tempStorageClass], NEED_FORMALIZE, ADD_NAME_CONTENT);
+        xml_writer_element(writer, "StorageClass", pp_storage_class[tempStorageClass], NEED_FORMALIZE);
 
-        (void)add_xml_element(sblcData->doc, &sblcData->docLen, "NoncurrentVersionTransition", NULL, NOT_NEED_FORMALIZE, ADD_TAIL_ONLY);
+        xml_writer_close(writer, "NoncurrentVersionTransition");
     }
 
 }
 
-obs_status set_lifecycle_request_xml(set_lifecycle_data *sblcData,
-    obs_lifecycle_conf* bucket_lifecycle_conf, unsigned int blcc_number, obs_use_api use_api)
+/* 记录0为文档头，1~blcc_number依次为各条Rule，其后为文档尾 */
+static int set_lifecycle_xml_record(xml_writer *writer, unsigned int index, void *record_data)
 {
-
-    unsigned int i = 0;
+    set_lifecycle_data *sblcData = (set_lifecycle_data *)record_data;
+    obs_lifecycle_conf *bucket_lifecycle_conf = sblcData->bucket_lifecycle_conf;
+    unsigned int i = index - 1;
     int is_true = 0;
-    char **pp_storage_class = NULL;
-
-    pp_storage_class = use_api == OBS_USE_API_S3 ? g_storage_class_s3 : g_storage_class_obs;
 
-    (void)add_xml_element(sblcData->doc, &sblcData->docLen, "LifecycleConfiguration",
-        NULL, NOT_NEED_FORMALIZE, ADD_HEAD_ONLY);
-    for (i = 0; i < blcc_number; ++i)
+    if (index == 0)
     {
-        (void)add_xml_element(sblcData->doc, &sblcData->docLen, "Rule", NULL, NOT_NEED_FORMALIZE, ADD_HEAD_ONLY);
+        xml_writer_open(writer, "LifecycleConfiguration");
+        return 1;
+    }
+    if (index > sblcData->blcc_number + 1)
+    {
+        return 0;
+    }
+    if (index == sblcData->blcc_number + 1)
+    {
+        xml_writer_close(writer, "LifecycleConfiguration");
+        return 1;
+    }
 
-        //add id, prefix, status
-        (void)add_xml_element(sblcData->doc, &sblcData->docLen, "ID", bucket_lifecycle_conf[i].id, NEED_FORMALIZE, ADD_NAME_CONTENT);
-        (void)add_xml_element(sblcData->doc, &sblcData->docLen, "Prefix", bucket_lifecycle_conf[i].prefix, NEED_FORMALIZE, ADD_NAME_CONTENT);
-        (void)add_xml_element(sblcData->doc, &sblcData->docLen, "Status", bucket_lifecycle_conf[i].status, NEED_FORMALIZE, ADD_NAME_CONTENT);
+    xml_writer_open(writer, "Rule");
 
-        is_true = (NULL != bucket_lifecycle_conf[i].days || NULL != bucket_lifecycle_conf[i].date);
-        if (is_true)
-        {
-            //add expiration
-            add_xml_element_expiration(sblcData, bucket_lifecycle_conf, i);
-        }
+    //add id, prefix, status
+    xml_writer_element(writer, "ID", bucket_lifecycle_conf[i].id, NEED_FORMALIZE);
+    xml_writer_element(writer, "Prefix", bucket_lifecycle_conf[i].prefix, NEED_FORMALIZE);
+    xml_writer_element(writer, "Status", bucket_lifecycle_conf[i].status, NEED_FORMALIZE);
 
-        //add transition
-        add_xml_element_transition(sblcData, bucket_lifecycle_conf, i, pp_storage_class);
+    is_true = (NULL != bucket_lifecycle_conf[i].days || NULL != bucket_lifecycle_conf[i].date);
+    if (is_true)
+    {
+        //add expiration
+        add_xml_element_expiration(writer, bucket_lifecycle_conf, i);
+    }
 
-        //add non version transition
-        add_xml_elemet_noversion_transition(sblcData, bucket_lifecycle_conf, i, pp_storage_class);
+    //add transition
+    add_xml_element_transition(writer, bucket_lifecycle_conf, i, sblcData->storage_class);
 
-        //add non current version expiration
-        if (bucket_lifecycle_conf[i].noncurrent_version_days)
-        {
-            (void)add_xml_element(sblcData->doc, &sblcData->docLen, "NoncurrentVersionExpiration", NULL, NOT_NEED_FORMALIZE, ADD_HEAD_ONLY);
-            (void)add_xml_element(sblcData->doc, &sblcData->docLen, "NoncurrentDays",
-                bucket_lifecycle_conf[i].noncurrent_version_days, NEED_FORMALIZE, ADD_NAME_CONTENT);
-            (void)add_xml_element(sblcData->doc, &sblcData->docLen, "NoncurrentVersionExpiration", NULL, NOT_NEED_FORMALIZE, ADD_TAIL_ONLY);
-        }
+    //add non version transition
+    add_xml_elemet_noversion_transition(writer, bucket_lifecycle_conf, i, sblcData->storage_class);
 
-        (void)add_xml_element(sblcData->doc, &sblcData->docLen, "Rule", NULL, NOT_NEED_FORMALIZE, ADD_TAIL_ONLY);
+    //add non current version expiration
+    if (bucket_lifecycle_conf[i].noncurrent_version_days)
+    {
+        xml_writer_open(writer, "NoncurrentVersionExpiration");
+        xml_writer_element(writer, "NoncurrentDays",
+            bucket_lifecycle_conf[i].noncurrent_version_days, NEED_FORMALIZE);
+        xml_writer_close(writer, "NoncurrentVersionExpiration");
     }
 
-    (void)add_xml_element(sblcData->doc, &sblcData->docLen, "LifecycleConfiguration",
-        NULL, NOT_NEED_FORMALIZE, ADD_TAIL_ONLY);
-    return OBS_STATUS_OK;
+    xml_writer_close(writer, "Rule");
+    return 1;
 }
 
 static int set_lifecycle_data_callback(int buffer_size, char *buffer, void *callback_data)
 {
     set_lifecycle_data *sblcData = (set_lifecycle_data *)callback_data;
-
-    if (!sblcData->docLen) {
-        return 0;
-    }
-
-    int remaining = (sblcData->docLen - sblcData->docBytesWritten);
-
-    int toCopy = buffer_size > remaining ? remaining : buffer_size;
-    if (!toCopy) {
-        return 0;
-    }
-
-    errno_t err = EOK;
-    err = memcpy_s(buffer, buffer_size, &(sblcData->doc[sblcData->docBytesWritten]), toCopy);
-    if (err != EOK)
-    {
-        COMMLOG(OBS_LOGWARN, "set_lifecycle_data_callback: memcpy_s failed!\n");
-        return 0;
-    }
-
-    sblcData->docBytesWritten += toCopy;
-    return toCopy;
+    return xml_writer_read(&sblcData->writer, buffer, buffer_size);
 }
 
 static obs_status set_lifecycle_properties_callback(const obs_response_properties *response_properties,
@@ -240,20 +235,12 @@ static set_lifecycle_data* init_set_lifecycle_data(obs_lifecycle_conf* bucket_li
     sblcData->response_complete_callback = handler->complete_callback;
     sblcData->response_properties_callback = handler->properties_callback;
     sblcData->callback_data = callback_data;
-    sblcData->docLen = 0;
-
+    sblcData->bucket_lifecycle_conf = bucket_lifecycle_conf;
+    sblcData->blcc_number = blcc_number;
+    sblcData->storage_class = use_api == OBS_USE_API_S3 ? g_storage_class_s3 : g_storage_class_obs;
 
-    obs_status ret_status = set_lifecycle_request_xml(sblcData, bucket_lifecycle_conf, blcc_number, use_api);
-    if (OBS_STATUS_OK != ret_status || sblcData->docLen < 0)
-    {
-        (void)(*(handler->complete_callback))(OBS_STATUS_OutOfMemory, 0, callback_data);
-        free(sblcData);
-        sblcData = NULL;
-        return NULL;
-    }
-    COMMLOG(OBS_LOGERROR, "sblcData-doc: %s.", sblcData->doc);
-    sblcData->docBytesWritten = 0;
-    MD5((unsigned char *)sblcData->doc, (size_t)sblcData->docLen, doc_md5);
+    xml_writer_initialize(&sblcData->writer, &set_lifecycle_xml_record, sblcData);
+    sblcData->doc_len = xml_writer_measure(&sblcData->writer, doc_md5);
     base64Encode(doc_md5, sizeof(doc_md5), sblcData->doc_md5);
 
     return sblcData;
@@ -310,7 +297,7 @@ void set_bucket_lifecycle_configuration(const obs_options *options,
     params.properties_callback = &set_lifecycle_properties_callback;
     params.toObsCallback = &set_lifecycle_data_callback;
     params.complete_callback = &set_lifecycle_complete_callback;
-    params.toObsCallbackTotalSize = sblcData->docLen;
+    params.toObsCallbackTotalSize = sblcData->doc_len;
     params.callback_data = sblcData;
     params.isCheckCA = is_check_ca(options);
     params.storageClassFormat = no_need_storage_class;
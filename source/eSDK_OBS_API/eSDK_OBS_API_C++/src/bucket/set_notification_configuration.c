@@ -249,7 +249,7 @@ static set_notification_data* init_set_notification_data(
 static int set_notification_data_callback(int buffer_size, char *buffer,
     void *callback_data)
 {
-    set_cors_config_data *sncData = (set_cors_config_data *)callback_data;
+    set_notification_data *sncData = (set_notification_data *)callback_data;
 
     if (!sncData->doc_len)
     {
@@ -0,0 +1,438 @@
+/*********************************************************************************
+* Copyright 2024 Huawei Technologies Co.,Ltd.
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+* this file except in compliance with the License.  You may obtain a copy of the
+* License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed
+* under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+* CONDITIONS OF ANY KIND, either express or implied.  See the License for the
+* specific language governing permissions and limitations under the License.
+**********************************************************************************
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <openssl/pem.h>
+#include <openssl/err.h>
+#include "ca_store.h"
+#include "securec.h"
+#include "log.h"
+
+#if defined __GNUC__ || defined LINUX
+#include <pthread.h>
+#else
+#include <windows.h>
+#include <process.h>
+#endif
+
+#define CA_STORE_MAX_BUNDLES        8         // 缓存的不同证书内容数
+#define CA_STORE_CHECK_INTERVAL_MS  1000      // 检查证书文件是否修改的最小间隔
+#define CA_STORE_MAX_FILE_SIZE      (4 * 1024 * 1024)
+#define CA_STORE_PATH_LENGTH        1024
+
+typedef struct ca_bundle
+{
+    struct ca_bundle *next;
+    unsigned int refs;                        // 缓存持有一个引用，使用中的连接各持有一个
+    char *pem;                                // 证书内容，作为查找的键；文件证书为NULL
+    size_t pem_len;
+    STACK_OF(X509) *certs;
+} ca_bundle;
+
+static int g_ca_store_initialized = 0;
+static ca_bundle *g_ca_bundles = NULL;
+static unsigned int g_ca_bundle_count = 0;
+/* init_certificate_by_path加载的证书文件 */
+static const char *g_ca_file_buffer = NULL;
+static char g_ca_file_path[CA_STORE_PATH_LENGTH];
+static ca_bundle *g_ca_file_bundle = NULL;
+static time_t g_ca_file_mtime = 0;
+static off_t g_ca_file_size = -1;
+static uint64_t g_ca_file_checked_ms = 0;
+static int g_ca_file_loading = 0;
+/* 正在加载的文件路径，仅在g_ca_file_loading为1时由加载线程读取 */
+static char g_ca_load_path[CA_STORE_PATH_LENGTH];
+static int g_ca_loader_started = 0;
+static volatile unsigned int g_ca_store_generation = 1;
+
+#if defined __GNUC__ || defined LINUX
+static pthread_mutex_t g_ca_store_mutex;
+static pthread_t g_ca_loader;
+#else
+static CRITICAL_SECTION g_ca_store_mutex;
+static HANDLE g_ca_loader = NULL;
+#endif
+
+static void ca_store_lock(void)
+{
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_lock(&g_ca_store_mutex);
+#else
+    EnterCriticalSection(&g_ca_store_mutex);
+#endif
+}
+
+static void ca_store_unlock(void)
+{
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_unlock(&g_ca_store_mutex);
+#else
+    LeaveCriticalSection(&g_ca_store_mutex);
+#endif
+}
+
+static uint64_t ca_store_now_ms(void)
+{
+#if defined __GNUC__ || defined LINUX
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+#else
+    return (uint64_t)GetTickCount64();
+#endif
+}
+
+/* 解析pem中的全部证书，失败返回NULL */
+static ca_bundle *ca_bundle_parse(const char *pem, size_t pem_len)
+{
+    X509 *cert = NULL;
+    ca_bundle *bundle = (ca_bundle *)calloc(1, sizeof(ca_bundle));
+    BIO *bio = BIO_new_mem_buf((void *)pem, (int)pem_len);
+    if (bundle == NULL || bio == NULL || (bundle->certs = sk_X509_new_null()) == NULL) {
+        BIO_free(bio);
+        free(bundle);
+        return NULL;
+    }
+    while ((cert = PEM_read_bio_X509(bio, NULL, NULL, NULL)) != NULL) {
+        if (!sk_X509_push(bundle->certs, cert)) {
+            X509_free(cert);
+            break;
+        }
+    }
+    // 读到末尾时同样会留下PEM_R_NO_START_LINE
+    ERR_clear_error();
+    BIO_free(bio);
+    if (sk_X509_num(bundle->certs) == 0) {
+        sk_X509_free(bundle->certs);
+        free(bundle);
+        return NULL;
+    }
+    bundle->refs = 1;
+    return bundle;
+}
+
+static void ca_bundle_release(ca_bundle *bundle)
+{
+    if (bundle == NULL || --bundle->refs > 0) {
+        return;
+    }
+    sk_X509_pop_free(bundle->certs, X509_free);
+    free(bundle->pem);
+    free(bundle);
+}
+
+static void ca_bundle_add_to(const ca_bundle *bundle, X509_STORE *store)
+{
+    int i = 0;
+    for (i = 0; i < sk_X509_num(bundle->certs); i++) {
+        // 证书已存在于store中时返回失败，可以忽略
+        (void)X509_STORE_add_cert(store, sk_X509_value(bundle->certs, i));
+    }
+    ERR_clear_error();
+}
+
+/* 读取整个证书文件，返回的内容由调用者释放 */
+static char *ca_store_read_file(const char *path, size_t *length)
+{
+    char *content = NULL;
+    size_t len = 0;
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        COMMLOG(OBS_LOGERROR, "%s: fopen failed path = %s", __FUNCTION__, path);
+        return NULL;
+    }
+    if ((content = (char *)malloc(CA_STORE_MAX_FILE_SIZE)) != NULL) {
+        len = fread(content, 1, CA_STORE_MAX_FILE_SIZE, fp);
+        if (len == CA_STORE_MAX_FILE_SIZE && fgetc(fp) != EOF) {
+            COMMLOG(OBS_LOGWARN, "%s: %s is larger than %d bytes, only the beginning is used",
+                __FUNCTION__, path, CA_STORE_MAX_FILE_SIZE);
+        }
+    }
+    fclose(fp);
+    if (len == 0) {
+        free(content);
+        return NULL;
+    }
+    *length = len;
+    return content;
+}
+
+static ca_bundle *ca_store_load_file(const char *path)
+{
+    size_t len = 0;
+    ca_bundle *bundle = NULL;
+    char *content = ca_store_read_file(path, &len);
+    if (content != NULL) {
+        bundle = ca_bundle_parse(content, len);
+        free(content);
+    }
+    if (bundle == NULL) {
+        COMMLOG(OBS_LOGERROR, "%s: failed to load certificate file %s", __FUNCTION__, path);
+    }
+    else {
+        COMMLOG(OBS_LOGINFO, "%s: loaded %d certificates from %s", __FUNCTION__,
+            sk_X509_num(bundle->certs), path);
+    }
+    return bundle;
+}
+
+/* 需持有锁调用，结束本次加载并替换文件证书 */
+static void ca_store_install(ca_bundle *bundle)
+{
+    g_ca_file_loading = 0;
+    // 加载期间取消或更换了监视的文件时丢弃结果
+    if (bundle != NULL && strcmp(g_ca_load_path, g_ca_file_path) != 0) {
+        ca_bundle_release(bundle);
+        return;
+    }
+    if (bundle != NULL) {
+        if (g_ca_file_bundle != NULL) {
+            ca_bundle_release(g_ca_file_bundle);
+            g_ca_store_generation++;
+        }
+        g_ca_file_bundle = bundle;
+    }
+}
+
+static void ca_store_reload(void)
+{
+    ca_bundle *bundle = ca_store_load_file(g_ca_load_path);
+    ca_store_lock();
+    ca_store_install(bundle);
+    ca_store_unlock();
+}
+
+#if defined __GNUC__ || defined LINUX
+static void *ca_store_reload_linux(void *arg)
+{
+    (void)arg;
+    ca_store_reload();
+    return NULL;
+}
+#else
+static unsigned __stdcall ca_store_reload_win32(void *arg)
+{
+    (void)arg;
+    ca_store_reload();
+    return 0;
+}
+#endif
+
+/* 回收已结束的加载线程，调用时不能持有锁 */
+static void ca_store_join_loader(void)
+{
+    if (!g_ca_loader_started) {
+        return;
+    }
+#if defined __GNUC__ || defined LINUX
+    pthread_join(g_ca_loader, NULL);
+#else
+    WaitForSingleObject(g_ca_loader, INFINITE);
+    CloseHandle(g_ca_loader);
+    g_ca_loader = NULL;
+#endif
+    g_ca_loader_started = 0;
+}
+
+/**
+ * 证书文件修改后重新解析，需持有锁调用。首次加载在当前线程完成；
+ * 之后的重新加载由后台线程完成，期间所有连接继续使用旧的证书
+ */
+static void ca_store_check_file(void)
+{
+    struct stat st;
+    int started = 0;
+    uint64_t now = ca_store_now_ms();
+    if (g_ca_file_loading ||
+        (g_ca_file_checked_ms != 0 && now - g_ca_file_checked_ms < CA_STORE_CHECK_INTERVAL_MS)) {
+        return;
+    }
+    g_ca_file_checked_ms = now;
+    if (stat(g_ca_file_path, &st) != 0 || (st.st_mtime == g_ca_file_mtime && st.st_size == g_ca_file_size)) {
+        return;
+    }
+    if (strcpy_s(g_ca_load_path, sizeof(g_ca_load_path), g_ca_file_path) != EOK) {
+        return;
+    }
+    g_ca_file_mtime = st.st_mtime;
+    g_ca_file_size = st.st_size;
+    g_ca_file_loading = 1;
+    ca_store_unlock();
+
+    // 上一个加载线程设置g_ca_file_loading后即结束，这里不会等待
+    ca_store_join_loader();
+    ca_store_lock();
+    if (g_ca_file_bundle != NULL) {
+#if defined __GNUC__ || defined LINUX
+        started = pthread_create(&g_ca_loader, NULL, ca_store_reload_linux, NULL) == 0;
+#else
+        g_ca_loader = (HANDLE)_beginthreadex(NULL, 0, ca_store_reload_win32, NULL, 0, NULL);
+        started = g_ca_loader != 0;
+#endif
+        if (!started) {
+            COMMLOG(OBS_LOGWARN, "%s: create certificate loading thread failed, load it here", __FUNCTION__);
+        }
+        g_ca_loader_started = started;
+    }
+    if (!started) {
+        ca_store_unlock();
+        ca_store_reload();
+        ca_store_lock();
+    }
+}
+
+/* 按内容查找缓冲区证书，未缓存时解析并加入缓存，返回的证书已增加引用 */
+static ca_bundle *ca_store_get_buffer(const char *pem, size_t pem_len)
+{
+    ca_bundle *bundle = NULL;
+    ca_bundle **link = NULL;
+    for (bundle = g_ca_bundles; bundle != NULL; bundle = bundle->next) {
+        if (bundle->pem_len == pem_len && memcmp(bundle->pem, pem, pem_len) == 0) {
+            bundle->refs++;
+            return bundle;
+        }
+    }
+    if ((bundle = ca_bundle_parse(pem, pem_len)) == NULL) {
+        return NULL;
+    }
+    if ((bundle->pem = (char *)malloc(pem_len)) == NULL) {
+        // 无法缓存，仅供本次使用
+        return bundle;
+    }
+    (void)memcpy_s(bundle->pem, pem_len, pem, pem_len);
+    bundle->pem_len = pem_len;
+    if (g_ca_bundle_count == CA_STORE_MAX_BUNDLES) {
+        // 淘汰最早加入的证书
+        for (link = &g_ca_bundles; (*link)->next != NULL; link = &(*link)->next) {
+        }
+        ca_bundle_release(*link);
+        *link = NULL;
+        g_ca_bundle_count--;
+    }
+    bundle->next = g_ca_bundles;
+    g_ca_bundles = bundle;
+    g_ca_bundle_count++;
+    bundle->refs++;
+    return bundle;
+}
+
+void ca_store_initialize(void)
+{
+    if (g_ca_store_initialized) {
+        return;
+    }
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_init(&g_ca_store_mutex, NULL);
+#else
+    InitializeCriticalSection(&g_ca_store_mutex);
+#endif
+    g_ca_store_initialized = 1;
+}
+
+void ca_store_deinitialize(void)
+{
+    ca_bundle *bundle = NULL;
+    if (!g_ca_store_initialized) {
+        return;
+    }
+    ca_store_join_loader();
+    ca_store_lock();
+    while (g_ca_bundles != NULL) {
+        bundle = g_ca_bundles;
+        g_ca_bundles = bundle->next;
+        ca_bundle_release(bundle);
+    }
+    g_ca_bundle_count = 0;
+    ca_bundle_release(g_ca_file_bundle);
+    g_ca_file_bundle = NULL;
+    g_ca_file_mtime = 0;
+    g_ca_file_size = -1;
+    g_ca_file_checked_ms = 0;
+    ca_store_unlock();
+}
+
+void ca_store_watch_file(const char *buffer, const char *path)
+{
+    if (!g_ca_store_initialized) {
+        // 未初始化时无法共享证书，请求仍按buffer的内容解析
+        return;
+    }
+    ca_store_lock();
+    if (g_ca_file_buffer != NULL || path != NULL) {
+        g_ca_store_generation++;
+    }
+    g_ca_file_buffer = path != NULL ? buffer : NULL;
+    if (path == NULL || strcpy_s(g_ca_file_path, sizeof(g_ca_file_path), path) != EOK) {
+        g_ca_file_buffer = NULL;
+        g_ca_file_path[0] = '\0';
+    }
+    ca_bundle_release(g_ca_file_bundle);
+    g_ca_file_bundle = NULL;
+    g_ca_file_mtime = 0;
+    g_ca_file_size = -1;
+    g_ca_file_checked_ms = 0;
+    ca_store_unlock();
+}
+
+unsigned int ca_store_generation(const char *pem)
+{
+    if (g_ca_store_initialized && pem != NULL && pem == g_ca_file_buffer) {
+        ca_store_lock();
+        ca_store_check_file();
+        ca_store_unlock();
+    }
+    return g_ca_store_generation;
+}
+
+CURLcode ca_store_add_certs(X509_STORE *store, const char *pem)
+{
+    ca_bundle *bundle = NULL;
+    size_t pem_len = strlen(pem);
+    if (!g_ca_store_initialized) {
+        if ((bundle = ca_bundle_parse(pem, pem_len)) == NULL) {
+            COMMLOG(OBS_LOGERROR, "%s Failed to read PEM certificate", __FUNCTION__);
+            return CURLE_SSL_CACERT_BADFILE;
+        }
+        ca_bundle_add_to(bundle, store);
+        ca_bundle_release(bundle);
+        return CURLE_OK;
+    }
+
+    ca_store_lock();
+    if (pem == g_ca_file_buffer) {
+        ca_store_check_file();
+        if ((bundle = g_ca_file_bundle) != NULL) {
+            bundle->refs++;
+        }
+    }
+    if (bundle == NULL) {
+        bundle = ca_store_get_buffer(pem, pem_len);
+    }
+    ca_store_unlock();
+    if (bundle == NULL) {
+        COMMLOG(OBS_LOGERROR, "%s Failed to read PEM certificate", __FUNCTION__);
+        return CURLE_SSL_CACERT_BADFILE;
+    }
+
+    ca_bundle_add_to(bundle, store);
+    ca_store_lock();
+    ca_bundle_release(bundle);
+    ca_store_unlock();
+    return CURLE_OK;
+}
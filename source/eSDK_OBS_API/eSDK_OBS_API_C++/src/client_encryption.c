@@ -0,0 +1,426 @@
+/*********************************************************************************
+* Copyright 2024 Huawei Technologies Co.,Ltd.
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+* this file except in compliance with the License.  You may obtain a copy of the
+* License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed
+* under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+* CONDITIONS OF ANY KIND, either express or implied.  See the License for the
+* specific language governing permissions and limitations under the License.
+**********************************************************************************
+*/
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <openssl/crypto.h>
+#include "client_encryption.h"
+#include "securec.h"
+#include "util.h"
+#include "log.h"
+
+#if defined __GNUC__ || defined LINUX
+#include <strings.h>
+#endif
+
+#define CLIENT_ENCRYPTION_WORK_SIZE     (64 * 1024)
+#define CLIENT_ENCRYPTION_WRAPPED_SIZE  (CLIENT_ENCRYPTION_IV_SIZE + CLIENT_ENCRYPTION_MAX_KEY_SIZE + \
+    OBS_CLIENT_ENCRYPTION_TAG_SIZE)
+#define CLIENT_ENCRYPTION_AAD_SIZE      17
+
+static const char *g_client_encryption_names[OBS_CLIENT_ENCRYPTION_BUTT] = {"", "AES256-GCM", "SM4-GCM"};
+
+static const EVP_CIPHER *client_encryption_cipher(obs_client_encryption_algorithm algorithm)
+{
+    if (algorithm == OBS_CLIENT_ENCRYPTION_AES_256_GCM) {
+        return EVP_aes_256_gcm();
+    }
+#if defined TONGSUO_VERSION_NUMBER
+    if (algorithm == OBS_CLIENT_ENCRYPTION_SM4_GCM) {
+        return EVP_sm4_gcm();
+    }
+#endif
+    return NULL;
+}
+
+static unsigned int client_encryption_key_size(obs_client_encryption_algorithm algorithm)
+{
+    return algorithm == OBS_CLIENT_ENCRYPTION_SM4_GCM ? 16 : 32;
+}
+
+static obs_status client_encryption_check_params(const obs_client_encryption_params *params,
+    obs_client_encryption_algorithm algorithm)
+{
+    if (params == NULL || params->master_key == NULL) {
+        COMMLOG(OBS_LOGERROR, "%s: master key is NULL", __FUNCTION__);
+        return OBS_STATUS_InvalidParameter;
+    }
+    if (client_encryption_cipher(algorithm) == NULL) {
+        COMMLOG(OBS_LOGERROR, "%s: client encryption algorithm %d is not supported", __FUNCTION__, algorithm);
+        return OBS_STATUS_InvalidParameter;
+    }
+    if (params->master_key_len != client_encryption_key_size(algorithm)) {
+        COMMLOG(OBS_LOGERROR, "%s: master key must be %u bytes", __FUNCTION__, client_encryption_key_size(algorithm));
+        return OBS_STATUS_InvalidParameter;
+    }
+    return OBS_STATUS_OK;
+}
+
+/**
+ * 一次性GCM加解密，用于包装数据密钥
+ */
+static int client_encryption_gcm(const EVP_CIPHER *cipher, int encrypt, const unsigned char *key,
+    const unsigned char *iv, const unsigned char *in, int length, unsigned char *out, unsigned char *tag)
+{
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    int out_length = 0;
+    int ok;
+    if (ctx == NULL) {
+        return 0;
+    }
+    ok = EVP_CipherInit_ex(ctx, cipher, NULL, NULL, NULL, encrypt) == 1 &&
+        EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, CLIENT_ENCRYPTION_IV_SIZE, NULL) == 1 &&
+        EVP_CipherInit_ex(ctx, NULL, NULL, key, iv, encrypt) == 1 &&
+        EVP_CipherUpdate(ctx, out, &out_length, in, length) == 1;
+    if (ok && !encrypt) {
+        ok = EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, OBS_CLIENT_ENCRYPTION_TAG_SIZE, tag) == 1;
+    }
+    ok = ok && EVP_CipherFinal_ex(ctx, out + out_length, &out_length) == 1;
+    if (ok && encrypt) {
+        ok = EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, OBS_CLIENT_ENCRYPTION_TAG_SIZE, tag) == 1;
+    }
+    EVP_CIPHER_CTX_free(ctx);
+    return ok;
+}
+
+static void client_encryption_set_texts(const obs_client_encryption_params *params, uint64_t part_size,
+    client_encryption_context *context)
+{
+    int ret;
+    context->part_size = part_size;
+    ret = snprintf_s(context->part_size_text, sizeof(context->part_size_text), _TRUNCATE, "%llu",
+        (unsigned long long)part_size);
+    CheckAndLogNeg(ret, "snprintf_s", __FUNCTION__, __LINE__);
+    context->key_id[0] = '\0';
+    if (params->master_key_id != NULL) {
+        ret = snprintf_s(context->key_id, sizeof(context->key_id), _TRUNCATE, "%s", params->master_key_id);
+        CheckAndLogNeg(ret, "snprintf_s", __FUNCTION__, __LINE__);
+    }
+}
+
+obs_status client_encryption_create(const obs_client_encryption_params *params, uint64_t part_size,
+    client_encryption_context *context)
+{
+    unsigned char wrapped[CLIENT_ENCRYPTION_WRAPPED_SIZE];
+    const EVP_CIPHER *cipher = NULL;
+    obs_status status = client_encryption_check_params(params, params != NULL ? params->algorithm :
+        OBS_CLIENT_ENCRYPTION_NONE);
+    if (status != OBS_STATUS_OK) {
+        return status;
+    }
+    memset_s(context, sizeof(client_encryption_context), 0, sizeof(client_encryption_context));
+    context->algorithm = params->algorithm;
+    context->key_size = client_encryption_key_size(params->algorithm);
+    cipher = client_encryption_cipher(params->algorithm);
+    if (RAND_bytes(context->data_key, (int)context->key_size) != 1 ||
+        RAND_bytes(context->base_iv, CLIENT_ENCRYPTION_IV_SIZE) != 1 ||
+        RAND_bytes(wrapped, CLIENT_ENCRYPTION_IV_SIZE) != 1) {
+        COMMLOG(OBS_LOGERROR, "%s: generate data key failed", __FUNCTION__);
+        client_encryption_clear(context);
+        return OBS_STATUS_InternalError;
+    }
+    if (!client_encryption_gcm(cipher, 1, params->master_key, wrapped, context->data_key, (int)context->key_size,
+        wrapped + CLIENT_ENCRYPTION_IV_SIZE, wrapped + CLIENT_ENCRYPTION_IV_SIZE + context->key_size)) {
+        COMMLOG(OBS_LOGERROR, "%s: wrap data key failed", __FUNCTION__);
+        client_encryption_clear(context);
+        return OBS_STATUS_InternalError;
+    }
+    (void)base64Encode(wrapped, (int)(CLIENT_ENCRYPTION_IV_SIZE + context->key_size + OBS_CLIENT_ENCRYPTION_TAG_SIZE),
+        context->wrapped_key);
+    (void)base64Encode(context->base_iv, CLIENT_ENCRYPTION_IV_SIZE, context->iv_text);
+    client_encryption_set_texts(params, part_size, context);
+    return OBS_STATUS_OK;
+}
+
+obs_status client_encryption_open(const obs_client_encryption_params *params,
+    obs_client_encryption_algorithm algorithm, const char *wrapped_key, const char *iv_text, uint64_t part_size,
+    client_encryption_context *context)
+{
+    unsigned char wrapped[CLIENT_ENCRYPTION_WRAPPED_SIZE + 4];
+    unsigned char base_iv[CLIENT_ENCRYPTION_IV_SIZE + 4];
+    unsigned int key_size = client_encryption_key_size(algorithm);
+    obs_status status = client_encryption_check_params(params, algorithm);
+    int wrapped_size;
+
+    if (status != OBS_STATUS_OK) {
+        return status;
+    }
+    if (wrapped_key == NULL || iv_text == NULL || strlen(wrapped_key) >= CLIENT_ENCRYPTION_TEXT_SIZE ||
+        strlen(iv_text) >= CLIENT_ENCRYPTION_TEXT_SIZE || part_size == 0) {
+        return OBS_STATUS_InvalidParameter;
+    }
+    wrapped_size = base64Decode(wrapped_key, (long)strlen(wrapped_key), (char *)wrapped, (long)sizeof(wrapped));
+    if (wrapped_size != (int)(CLIENT_ENCRYPTION_IV_SIZE + key_size + OBS_CLIENT_ENCRYPTION_TAG_SIZE) ||
+        base64Decode(iv_text, (long)strlen(iv_text), (char *)base_iv, (long)sizeof(base_iv)) !=
+        CLIENT_ENCRYPTION_IV_SIZE) {
+        COMMLOG(OBS_LOGERROR, "%s: invalid wrapped key or iv", __FUNCTION__);
+        return OBS_STATUS_InvalidParameter;
+    }
+    memset_s(context, sizeof(client_encryption_context), 0, sizeof(client_encryption_context));
+    context->algorithm = algorithm;
+    context->key_size = key_size;
+    if (!client_encryption_gcm(client_encryption_cipher(algorithm), 0, params->master_key, wrapped,
+        wrapped + CLIENT_ENCRYPTION_IV_SIZE, (int)key_size, context->data_key,
+        wrapped + CLIENT_ENCRYPTION_IV_SIZE + key_size)) {
+        COMMLOG(OBS_LOGERROR, "%s: unwrap data key failed, master key mismatch", __FUNCTION__);
+        client_encryption_clear(context);
+        return OBS_STATUS_BadDigest;
+    }
+    memcpy_s(context->base_iv, sizeof(context->base_iv), base_iv, CLIENT_ENCRYPTION_IV_SIZE);
+    memcpy_s(context->wrapped_key, sizeof(context->wrapped_key), wrapped_key, strlen(wrapped_key) + 1);
+    memcpy_s(context->iv_text, sizeof(context->iv_text), iv_text, strlen(iv_text) + 1);
+    client_encryption_set_texts(params, part_size, context);
+    return OBS_STATUS_OK;
+}
+
+obs_status client_encryption_from_metadata(const obs_client_encryption_params *params,
+    const obs_response_properties *properties, client_encryption_context *context)
+{
+    const char *algorithm = NULL;
+    const char *wrapped_key = NULL;
+    const char *iv_text = NULL;
+    uint64_t part_size = 0;
+    obs_client_encryption_algorithm type = OBS_CLIENT_ENCRYPTION_NONE;
+    int i;
+
+    for (i = 0; i < properties->meta_data_count; i++) {
+        const obs_name_value *meta = &properties->meta_data[i];
+        if (meta->name == NULL || meta->value == NULL) {
+            continue;
+        }
+        if (!strcasecmp(meta->name, OBS_CLIENT_ENCRYPTION_META_ALGORITHM)) {
+            algorithm = meta->value;
+        }
+        else if (!strcasecmp(meta->name, OBS_CLIENT_ENCRYPTION_META_KEY)) {
+            wrapped_key = meta->value;
+        }
+        else if (!strcasecmp(meta->name, OBS_CLIENT_ENCRYPTION_META_IV)) {
+            iv_text = meta->value;
+        }
+        else if (!strcasecmp(meta->name, OBS_CLIENT_ENCRYPTION_META_PART_SIZE)) {
+            part_size = strtoull(meta->value, NULL, 10);
+        }
+    }
+    if (algorithm == NULL || wrapped_key == NULL || iv_text == NULL || part_size == 0) {
+        COMMLOG(OBS_LOGERROR, "%s: object is not encrypted on the client side", __FUNCTION__);
+        return OBS_STATUS_InvalidParameter;
+    }
+    for (i = OBS_CLIENT_ENCRYPTION_NONE + 1; i < OBS_CLIENT_ENCRYPTION_BUTT; i++) {
+        if (!strcasecmp(algorithm, g_client_encryption_names[i])) {
+            type = (obs_client_encryption_algorithm)i;
+        }
+    }
+    return client_encryption_open(params, type, wrapped_key, iv_text, part_size, context);
+}
+
+int client_encryption_fill_metadata(const client_encryption_context *context, obs_name_value *meta)
+{
+    int count = 0;
+    meta[count].name = OBS_CLIENT_ENCRYPTION_META_ALGORITHM;
+    meta[count++].value = (char *)g_client_encryption_names[context->algorithm];
+    meta[count].name = OBS_CLIENT_ENCRYPTION_META_KEY;
+    meta[count++].value = (char *)context->wrapped_key;
+    meta[count].name = OBS_CLIENT_ENCRYPTION_META_IV;
+    meta[count++].value = (char *)context->iv_text;
+    meta[count].name = OBS_CLIENT_ENCRYPTION_META_PART_SIZE;
+    meta[count++].value = (char *)context->part_size_text;
+    if (context->key_id[0] != '\0') {
+        meta[count].name = OBS_CLIENT_ENCRYPTION_META_KEY_ID;
+        meta[count++].value = (char *)context->key_id;
+    }
+    return count;
+}
+
+uint64_t client_encryption_plain_size(const client_encryption_context *context, uint64_t stored_size)
+{
+    uint64_t stored_part = context->part_size + OBS_CLIENT_ENCRYPTION_TAG_SIZE;
+    uint64_t parts = (stored_size + stored_part - 1) / stored_part;
+    if (parts == 0) {
+        parts = 1;
+    }
+    return stored_size > parts * OBS_CLIENT_ENCRYPTION_TAG_SIZE ? stored_size - parts * OBS_CLIENT_ENCRYPTION_TAG_SIZE :
+        0;
+}
+
+void client_encryption_clear(client_encryption_context *context)
+{
+    OPENSSL_cleanse(context->data_key, sizeof(context->data_key));
+    context->key_size = 0;
+}
+
+/************************************************************************************
+ * 段加解密
+ ************************************************************************************/
+/**
+ * 段的附加认证数据：段号(8字节)|对象明文大小(8字节)|是否末段(1字节)，均为大端，
+ * 使段不能被调换位置、截掉末尾的段或拼接到其他大小的对象上
+ */
+static void client_encryption_part_aad(const client_encryption_context *context, unsigned int part_index,
+    uint64_t plain_size, uint64_t object_size, unsigned char *aad)
+{
+    int i;
+    for (i = 0; i < 8; i++) {
+        aad[7 - i] = (unsigned char)((uint64_t)part_index >> (8 * i));
+        aad[15 - i] = (unsigned char)(object_size >> (8 * i));
+    }
+    aad[16] = (unsigned char)((uint64_t)part_index * context->part_size + plain_size >= object_size);
+}
+
+obs_status client_encryption_part_begin(const client_encryption_context *context, client_encryption_part *part,
+    unsigned int part_index, uint64_t plain_size, uint64_t object_size, int encrypt)
+{
+    unsigned char iv[CLIENT_ENCRYPTION_IV_SIZE];
+    unsigned char aad[CLIENT_ENCRYPTION_AAD_SIZE];
+    EVP_CIPHER_CTX *cipher = NULL;
+    int aad_length = 0;
+    int i;
+
+    memset_s(part, sizeof(client_encryption_part), 0, sizeof(client_encryption_part));
+    // 段IV = 基础IV的末4字节异或段号，同一数据密钥下各段IV互不相同
+    memcpy_s(iv, sizeof(iv), context->base_iv, sizeof(context->base_iv));
+    for (i = 0; i < 4; i++) {
+        iv[CLIENT_ENCRYPTION_IV_SIZE - 1 - i] ^= (unsigned char)(part_index >> (8 * i));
+    }
+    client_encryption_part_aad(context, part_index, plain_size, object_size, aad);
+    cipher = EVP_CIPHER_CTX_new();
+    if (cipher == NULL) {
+        return OBS_STATUS_OutOfMemory;
+    }
+    if (EVP_CipherInit_ex(cipher, client_encryption_cipher(context->algorithm), NULL, NULL, NULL, encrypt) != 1 ||
+        EVP_CIPHER_CTX_ctrl(cipher, EVP_CTRL_GCM_SET_IVLEN, CLIENT_ENCRYPTION_IV_SIZE, NULL) != 1 ||
+        EVP_CipherInit_ex(cipher, NULL, NULL, context->data_key, iv, encrypt) != 1 ||
+        EVP_CipherUpdate(cipher, NULL, &aad_length, aad, sizeof(aad)) != 1) {
+        COMMLOG(OBS_LOGERROR, "%s: init cipher of part %u failed", __FUNCTION__, part_index);
+        EVP_CIPHER_CTX_free(cipher);
+        return OBS_STATUS_InternalError;
+    }
+    if (!encrypt) {
+        part->work = (char *)malloc(CLIENT_ENCRYPTION_WORK_SIZE);
+        if (part->work == NULL) {
+            EVP_CIPHER_CTX_free(cipher);
+            return OBS_STATUS_OutOfMemory;
+        }
+    }
+    part->cipher = cipher;
+    part->plain_size = plain_size;
+    part->encrypt = encrypt;
+    return OBS_STATUS_OK;
+}
+
+obs_status client_encryption_part_encrypt(client_encryption_part *part, char *buffer, int length)
+{
+    int out_length = 0;
+    if ((uint64_t)length > part->plain_size - part->processed) {
+        return OBS_STATUS_InvalidParameter;
+    }
+    // GCM为流模式，可就地加密
+    if (EVP_CipherUpdate((EVP_CIPHER_CTX *)part->cipher, (unsigned char *)buffer, &out_length,
+        (const unsigned char *)buffer, length) != 1 || out_length != length) {
+        return OBS_STATUS_InternalError;
+    }
+    part->processed += (uint64_t)length;
+    return OBS_STATUS_OK;
+}
+
+int client_encryption_part_read_tag(client_encryption_part *part, char *buffer, int buffer_size)
+{
+    int length;
+    if (!part->finished) {
+        int out_length = 0;
+        if (part->processed != part->plain_size ||
+            EVP_CipherFinal_ex((EVP_CIPHER_CTX *)part->cipher, part->tag, &out_length) != 1 ||
+            EVP_CIPHER_CTX_ctrl((EVP_CIPHER_CTX *)part->cipher, EVP_CTRL_GCM_GET_TAG, OBS_CLIENT_ENCRYPTION_TAG_SIZE,
+            part->tag) != 1) {
+            COMMLOG(OBS_LOGERROR, "%s: finish part encryption failed", __FUNCTION__);
+            return -1;
+        }
+        part->finished = 1;
+    }
+    length = (int)(OBS_CLIENT_ENCRYPTION_TAG_SIZE - part->tag_pos);
+    if (length > buffer_size) {
+        length = buffer_size;
+    }
+    if (length > 0) {
+        memcpy_s(buffer, (size_t)buffer_size, part->tag + part->tag_pos, (size_t)length);
+        part->tag_pos += (unsigned int)length;
+    }
+    return length;
+}
+
+obs_status client_encryption_part_decrypt(client_encryption_part *part, const char *data, int length,
+    client_encryption_sink *sink, void *sink_data)
+{
+    while (length > 0) {
+        uint64_t cipher_remain = part->plain_size - part->processed;
+        if (cipher_remain > 0) {
+            int chunk = length < CLIENT_ENCRYPTION_WORK_SIZE ? length : CLIENT_ENCRYPTION_WORK_SIZE;
+            int out_length = 0;
+            obs_status status;
+            if ((uint64_t)chunk > cipher_remain) {
+                chunk = (int)cipher_remain;
+            }
+            if (EVP_CipherUpdate((EVP_CIPHER_CTX *)part->cipher, (unsigned char *)part->work, &out_length,
+                (const unsigned char *)data, chunk) != 1) {
+                return OBS_STATUS_InternalError;
+            }
+            status = sink(part->work, out_length, sink_data);
+            if (status != OBS_STATUS_OK) {
+                return status;
+            }
+            part->processed += (uint64_t)chunk;
+            data += chunk;
+            length -= chunk;
+        }
+        else {
+            // 末尾16字节为认证标签
+            int chunk = (int)(OBS_CLIENT_ENCRYPTION_TAG_SIZE - part->tag_pos);
+            if (chunk < length) {
+                COMMLOG(OBS_LOGERROR, "%s: part has more data than expected", __FUNCTION__);
+                return OBS_STATUS_BadDigest;
+            }
+            memcpy_s(part->tag + part->tag_pos, OBS_CLIENT_ENCRYPTION_TAG_SIZE - part->tag_pos, data, (size_t)length);
+            part->tag_pos += (unsigned int)length;
+            length = 0;
+        }
+    }
+    return OBS_STATUS_OK;
+}
+
+obs_status client_encryption_part_finish(client_encryption_part *part)
+{
+    int out_length = 0;
+    if (part->processed != part->plain_size || part->tag_pos != OBS_CLIENT_ENCRYPTION_TAG_SIZE) {
+        COMMLOG(OBS_LOGERROR, "%s: encrypted part is truncated", __FUNCTION__);
+        return OBS_STATUS_PartialFile;
+    }
+    if (EVP_CIPHER_CTX_ctrl((EVP_CIPHER_CTX *)part->cipher, EVP_CTRL_GCM_SET_TAG, OBS_CLIENT_ENCRYPTION_TAG_SIZE,
+        part->tag) != 1 ||
+        EVP_CipherFinal_ex((EVP_CIPHER_CTX *)part->cipher, (unsigned char *)part->work, &out_length) != 1) {
+        COMMLOG(OBS_LOGERROR, "%s: authentication tag mismatch", __FUNCTION__);
+        return OBS_STATUS_BadDigest;
+    }
+    part->finished = 1;
+    return OBS_STATUS_OK;
+}
+
+void client_encryption_part_end(client_encryption_part *part)
+{
+    if (part->cipher != NULL) {
+        EVP_CIPHER_CTX_free((EVP_CIPHER_CTX *)part->cipher);
+        part->cipher = NULL;
+    }
+    CHECK_NULL_FREE(part->work);
+}
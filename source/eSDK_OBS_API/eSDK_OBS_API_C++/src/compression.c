@@ -0,0 +1,696 @@
+/*********************************************************************************
+* Copyright 2024 Huawei Technologies Co.,Ltd.
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+* this file except in compliance with the License.  You may obtain a copy of the
+* License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed
+* under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+* CONDITIONS OF ANY KIND, either express or implied.  See the License for the
+* specific language governing permissions and limitations under the License.
+**********************************************************************************
+*/
+#include <stdlib.h>
+#include <string.h>
+#include "compression.h"
+#include "securec.h"
+#include "log.h"
+#include "zlib.h"
+#if defined OBS_WITH_ZSTD
+#include "zstd.h"
+#endif
+
+#if defined WIN32
+#include <process.h>
+#endif
+
+#if defined __GNUC__ || defined LINUX
+#include <strings.h>
+#include <pthread.h>
+#endif
+
+#define COMPRESSION_BLOCK_SIZE      (1024 * 1024)
+#define COMPRESSION_DEFAULT_TASK    4
+#define COMPRESSION_MAX_TASK        64
+#define COMPRESSION_GZIP_WINDOW     (15 + 16)   // 带gzip头和尾
+#define COMPRESSION_GZIP_OVERHEAD   64
+#define COMPRESSION_OUT_CHUNK       (256 * 1024)
+
+#define COMPRESSION_SLOT_FREE       0
+#define COMPRESSION_SLOT_FILLING    1
+#define COMPRESSION_SLOT_READY      2
+
+static const char *g_compression_names[OBS_COMPRESSION_BUTT] = {"", "gzip", "zstd"};
+
+/**
+ * 压缩块，第n块固定使用第n % slot_count个槽位，交付后才能被复用
+ */
+typedef struct compression_slot
+{
+    char *input;
+    char *output;
+    size_t output_cap;
+    size_t output_len;
+    size_t output_pos;
+    int state;
+} compression_slot;
+
+struct compression_reader
+{
+    obs_compression_type type;
+    int level;
+    obs_put_stream_read_callback *source;
+    void *source_data;
+    int slot_count;
+    compression_slot slots[COMPRESSION_MAX_TASK * 2];
+    uint64_t next_read;
+    uint64_t next_deliver;
+    uint64_t block_count;                     // source结束后才确定
+    uint64_t input_bytes;
+    int reading;                              // 同一时刻只有一个线程读取source
+    int source_eof;
+    int stopping;
+    obs_status status;
+    int thread_count;
+#if defined __GNUC__ || defined LINUX
+    pthread_t threads[COMPRESSION_MAX_TASK];
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+#else
+    HANDLE threads[COMPRESSION_MAX_TASK];
+    CRITICAL_SECTION mutex;
+    CONDITION_VARIABLE cond;
+#endif
+};
+
+struct compression_writer
+{
+    obs_compression_type type;
+    compression_sink *sink;
+    void *sink_data;
+    char *output;
+    int stream_end;                           // 当前gzip成员或zstd帧已完整结束
+    int has_input;
+    z_stream zs;
+#if defined OBS_WITH_ZSTD
+    ZSTD_DStream *zstd;
+#endif
+};
+
+const char *compression_codec_name(obs_compression_type type)
+{
+    if (type <= OBS_COMPRESSION_NONE || type >= OBS_COMPRESSION_BUTT) {
+        return NULL;
+    }
+    return g_compression_names[type];
+}
+
+int compression_supported(obs_compression_type type)
+{
+    if (type == OBS_COMPRESSION_GZIP) {
+        return 1;
+    }
+#if defined OBS_WITH_ZSTD
+    if (type == OBS_COMPRESSION_ZSTD) {
+        return 1;
+    }
+#endif
+    return 0;
+}
+
+obs_compression_type compression_from_metadata(const obs_response_properties *properties,
+    uint64_t *original_size)
+{
+    obs_compression_type type = OBS_COMPRESSION_NONE;
+    int i;
+    int j;
+    if (original_size != NULL) {
+        *original_size = 0;
+    }
+    for (i = 0; i < properties->meta_data_count; i++) {
+        const obs_name_value *meta = &properties->meta_data[i];
+        if (meta->name == NULL || meta->value == NULL) {
+            continue;
+        }
+        if (!strcasecmp(meta->name, OBS_COMPRESSION_META_CODEC)) {
+            for (j = OBS_COMPRESSION_NONE + 1; j < OBS_COMPRESSION_BUTT; j++) {
+                if (!strcasecmp(meta->value, g_compression_names[j])) {
+                    type = (obs_compression_type)j;
+                }
+            }
+        }
+        else if (!strcasecmp(meta->name, OBS_COMPRESSION_META_ORIGINAL_SIZE) && original_size != NULL) {
+            *original_size = strtoull(meta->value, NULL, 10);
+        }
+    }
+    return type;
+}
+
+static void compression_lock(compression_reader *reader)
+{
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_lock(&reader->mutex);
+#else
+    EnterCriticalSection(&reader->mutex);
+#endif
+}
+
+static void compression_unlock(compression_reader *reader)
+{
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_unlock(&reader->mutex);
+#else
+    LeaveCriticalSection(&reader->mutex);
+#endif
+}
+
+static void compression_wait(compression_reader *reader)
+{
+#if defined __GNUC__ || defined LINUX
+    pthread_cond_wait(&reader->cond, &reader->mutex);
+#else
+    SleepConditionVariableCS(&reader->cond, &reader->mutex, INFINITE);
+#endif
+}
+
+static void compression_wake_all(compression_reader *reader)
+{
+#if defined __GNUC__ || defined LINUX
+    pthread_cond_broadcast(&reader->cond);
+#else
+    WakeAllConditionVariable(&reader->cond);
+#endif
+}
+
+/* 记录第一个错误，调用时需持有锁 */
+static void compression_set_failed(compression_reader *reader, obs_status status)
+{
+    if (reader->status == OBS_STATUS_OK) {
+        reader->status = status;
+    }
+    compression_wake_all(reader);
+}
+
+/************************************************************************************
+ * 分块压缩
+ ************************************************************************************/
+static size_t compression_bound(obs_compression_type type, size_t length)
+{
+#if defined OBS_WITH_ZSTD
+    if (type == OBS_COMPRESSION_ZSTD) {
+        return ZSTD_compressBound(length);
+    }
+#endif
+    (void)type;
+    return (size_t)compressBound((uLong)length) + COMPRESSION_GZIP_OVERHEAD;
+}
+
+static obs_status compression_compress_block(compression_reader *reader, compression_slot *slot, size_t length)
+{
+#if defined OBS_WITH_ZSTD
+    if (reader->type == OBS_COMPRESSION_ZSTD) {
+        size_t ret = ZSTD_compress(slot->output, slot->output_cap, slot->input, length,
+            reader->level > 0 ? reader->level : ZSTD_CLEVEL_DEFAULT);
+        if (ZSTD_isError(ret)) {
+            COMMLOG(OBS_LOGERROR, "%s: zstd compress failed: %s", __FUNCTION__, ZSTD_getErrorName(ret));
+            return OBS_STATUS_InternalError;
+        }
+        slot->output_len = ret;
+        return OBS_STATUS_OK;
+    }
+#endif
+    z_stream zs;
+    int ret;
+    memset_s(&zs, sizeof(zs), 0, sizeof(zs));
+    ret = deflateInit2(&zs, reader->level > 0 ? reader->level : Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+        COMPRESSION_GZIP_WINDOW, 8, Z_DEFAULT_STRATEGY);
+    if (ret != Z_OK) {
+        COMMLOG(OBS_LOGERROR, "%s: deflateInit2 failed %d", __FUNCTION__, ret);
+        return OBS_STATUS_OutOfMemory;
+    }
+    zs.next_in = (Bytef *)slot->input;
+    zs.avail_in = (uInt)length;
+    zs.next_out = (Bytef *)slot->output;
+    zs.avail_out = (uInt)slot->output_cap;
+    ret = deflate(&zs, Z_FINISH);
+    slot->output_len = (size_t)zs.total_out;
+    (void)deflateEnd(&zs);
+    if (ret != Z_STREAM_END) {
+        COMMLOG(OBS_LOGERROR, "%s: deflate failed %d", __FUNCTION__, ret);
+        return OBS_STATUS_InternalError;
+    }
+    return OBS_STATUS_OK;
+}
+
+/**
+ * 读满一块或读到source结束，返回读取的字节数，失败返回-1
+ */
+static int64_t compression_read_block(compression_reader *reader, char *buffer, int *eof)
+{
+    int64_t length = 0;
+    while (length < COMPRESSION_BLOCK_SIZE) {
+        int ret = reader->source((int)(COMPRESSION_BLOCK_SIZE - length), buffer + length, reader->source_data);
+        if (ret < 0 || ret > COMPRESSION_BLOCK_SIZE - length) {
+            return -1;
+        }
+        if (ret == 0) {
+            *eof = 1;
+            break;
+        }
+        length += ret;
+    }
+    return length;
+}
+
+static void compression_worker(compression_reader *reader)
+{
+    for (;;) {
+        compression_slot *slot = NULL;
+        uint64_t index;
+        int64_t length;
+        int eof = 0;
+        obs_status status = OBS_STATUS_OK;
+
+        compression_lock(reader);
+        while (reader->status == OBS_STATUS_OK && !reader->stopping && !reader->source_eof &&
+            (reader->reading || reader->next_read >= reader->next_deliver + (uint64_t)reader->slot_count)) {
+            compression_wait(reader);
+        }
+        if (reader->status != OBS_STATUS_OK || reader->stopping || reader->source_eof) {
+            compression_unlock(reader);
+            break;
+        }
+        index = reader->next_read++;
+        slot = &reader->slots[index % (uint64_t)reader->slot_count];
+        slot->state = COMPRESSION_SLOT_FILLING;
+        reader->reading = 1;
+        compression_unlock(reader);
+
+        if (slot->input == NULL) {
+            slot->input = (char *)malloc(COMPRESSION_BLOCK_SIZE);
+            slot->output_cap = compression_bound(reader->type, COMPRESSION_BLOCK_SIZE);
+            slot->output = (char *)malloc(slot->output_cap);
+        }
+        length = (slot->input != NULL && slot->output != NULL) ? compression_read_block(reader, slot->input, &eof) :
+            -1;
+
+        compression_lock(reader);
+        reader->reading = 0;
+        if (length < 0) {
+            compression_set_failed(reader, slot->input == NULL || slot->output == NULL ? OBS_STATUS_OutOfMemory :
+                OBS_STATUS_AbortedByCallback);
+            compression_unlock(reader);
+            break;
+        }
+        reader->input_bytes += (uint64_t)length;
+        if (eof) {
+            // 空输入也输出一个空的gzip成员或zstd帧，保证对象是合法的压缩流
+            reader->source_eof = 1;
+            reader->block_count = (length > 0 || index == 0) ? index + 1 : index;
+        }
+        compression_wake_all(reader);
+        compression_unlock(reader);
+        if (length == 0 && index > 0) {
+            compression_lock(reader);
+            slot->state = COMPRESSION_SLOT_FREE;
+            compression_unlock(reader);
+            break;
+        }
+
+        status = compression_compress_block(reader, slot, (size_t)length);
+
+        compression_lock(reader);
+        if (status == OBS_STATUS_OK) {
+            slot->output_pos = 0;
+            slot->state = COMPRESSION_SLOT_READY;
+            compression_wake_all(reader);
+        }
+        else {
+            compression_set_failed(reader, status);
+        }
+        compression_unlock(reader);
+    }
+}
+
+#if defined __GNUC__ || defined LINUX
+static void *compression_worker_linux(void *arg)
+{
+    compression_worker((compression_reader *)arg);
+    return NULL;
+}
+#else
+static unsigned __stdcall compression_worker_win32(void *arg)
+{
+    compression_worker((compression_reader *)arg);
+    return 0;
+}
+#endif
+
+obs_status compression_reader_create(obs_compression_type type, int level, int task_num,
+    obs_put_stream_read_callback *source, void *source_data, compression_reader **reader_return)
+{
+    compression_reader *reader = NULL;
+    int i;
+
+    if (!compression_supported(type) || source == NULL || reader_return == NULL) {
+        COMMLOG(OBS_LOGERROR, "%s: compression type %d is not supported", __FUNCTION__, type);
+        return OBS_STATUS_InvalidParameter;
+    }
+    reader = (compression_reader *)malloc(sizeof(compression_reader));
+    if (reader == NULL) {
+        return OBS_STATUS_OutOfMemory;
+    }
+    memset_s(reader, sizeof(compression_reader), 0, sizeof(compression_reader));
+    reader->type = type;
+    reader->level = level;
+    reader->source = source;
+    reader->source_data = source_data;
+    if (task_num <= 0) {
+        task_num = COMPRESSION_DEFAULT_TASK;
+    }
+    if (task_num > COMPRESSION_MAX_TASK) {
+        task_num = COMPRESSION_MAX_TASK;
+    }
+    reader->slot_count = task_num * 2;
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_init(&reader->mutex, NULL);
+    pthread_cond_init(&reader->cond, NULL);
+    for (i = 0; i < task_num; i++) {
+        if (pthread_create(&reader->threads[reader->thread_count], NULL, compression_worker_linux, reader) == 0) {
+            reader->thread_count++;
+        }
+    }
+#else
+    InitializeCriticalSection(&reader->mutex);
+    InitializeConditionVariable(&reader->cond);
+    for (i = 0; i < task_num; i++) {
+        reader->threads[reader->thread_count] = (HANDLE)_beginthreadex(NULL, 0, compression_worker_win32,
+            reader, 0, NULL);
+        if (reader->threads[reader->thread_count] != 0) {
+            reader->thread_count++;
+        }
+    }
+#endif
+    if (reader->thread_count == 0) {
+        COMMLOG(OBS_LOGERROR, "%s: create compression thread failed", __FUNCTION__);
+        compression_reader_destroy(reader);
+        return OBS_STATUS_InternalError;
+    }
+    *reader_return = reader;
+    return OBS_STATUS_OK;
+}
+
+int compression_reader_read(int buffer_size, char *buffer, void *callback_data)
+{
+    compression_reader *reader = (compression_reader *)callback_data;
+    int copied = 0;
+
+    while (copied < buffer_size) {
+        compression_slot *slot = NULL;
+        size_t length;
+
+        compression_lock(reader);
+        for (;;) {
+            if (reader->status != OBS_STATUS_OK) {
+                compression_unlock(reader);
+                return -1;
+            }
+            if (reader->source_eof && reader->next_deliver >= reader->block_count) {
+                compression_unlock(reader);
+                return copied;
+            }
+            slot = &reader->slots[reader->next_deliver % (uint64_t)reader->slot_count];
+            if (slot->state == COMPRESSION_SLOT_READY) {
+                break;
+            }
+            if (copied > 0) {
+                // 已有数据时不等待下一块，尽快交给调用者
+                compression_unlock(reader);
+                return copied;
+            }
+            compression_wait(reader);
+        }
+        compression_unlock(reader);
+
+        length = slot->output_len - slot->output_pos;
+        if (length > (size_t)(buffer_size - copied)) {
+            length = (size_t)(buffer_size - copied);
+        }
+        if (length > 0) {
+            memcpy_s(buffer + copied, (size_t)(buffer_size - copied), slot->output + slot->output_pos, length);
+            slot->output_pos += length;
+            copied += (int)length;
+        }
+        if (slot->output_pos == slot->output_len) {
+            compression_lock(reader);
+            slot->state = COMPRESSION_SLOT_FREE;
+            reader->next_deliver++;
+            compression_wake_all(reader);
+            compression_unlock(reader);
+        }
+    }
+    return copied;
+}
+
+obs_status compression_reader_status(const compression_reader *reader)
+{
+    return reader->status;
+}
+
+uint64_t compression_reader_input_bytes(compression_reader *reader)
+{
+    uint64_t input_bytes;
+    compression_lock(reader);
+    input_bytes = reader->input_bytes;
+    compression_unlock(reader);
+    return input_bytes;
+}
+
+void compression_reader_destroy(compression_reader *reader)
+{
+    int i;
+    if (reader == NULL) {
+        return;
+    }
+    compression_lock(reader);
+    reader->stopping = 1;
+    compression_wake_all(reader);
+    compression_unlock(reader);
+#if defined __GNUC__ || defined LINUX
+    for (i = 0; i < reader->thread_count; i++) {
+        pthread_join(reader->threads[i], NULL);
+    }
+    pthread_cond_destroy(&reader->cond);
+    pthread_mutex_destroy(&reader->mutex);
+#else
+    for (i = 0; i < reader->thread_count; i++) {
+        WaitForSingleObject(reader->threads[i], INFINITE);
+        CloseHandle(reader->threads[i]);
+    }
+    DeleteCriticalSection(&reader->mutex);
+#endif
+    for (i = 0; i < reader->slot_count; i++) {
+        CHECK_NULL_FREE(reader->slots[i].input);
+        CHECK_NULL_FREE(reader->slots[i].output);
+    }
+    free(reader);
+}
+
+/************************************************************************************
+ * 流式解压
+ ************************************************************************************/
+obs_status compression_writer_create(obs_compression_type type, compression_sink *sink, void *sink_data,
+    compression_writer **writer_return)
+{
+    compression_writer *writer = NULL;
+
+    if (!compression_supported(type) || sink == NULL || writer_return == NULL) {
+        COMMLOG(OBS_LOGERROR, "%s: compression type %d is not supported", __FUNCTION__, type);
+        return OBS_STATUS_InvalidParameter;
+    }
+    writer = (compression_writer *)malloc(sizeof(compression_writer));
+    if (writer == NULL) {
+        return OBS_STATUS_OutOfMemory;
+    }
+    memset_s(writer, sizeof(compression_writer), 0, sizeof(compression_writer));
+    writer->type = type;
+    writer->sink = sink;
+    writer->sink_data = sink_data;
+    writer->output = (char *)malloc(COMPRESSION_OUT_CHUNK);
+    if (writer->output == NULL) {
+        free(writer);
+        return OBS_STATUS_OutOfMemory;
+    }
+#if defined OBS_WITH_ZSTD
+    if (type == OBS_COMPRESSION_ZSTD) {
+        writer->zstd = ZSTD_createDStream();
+        if (writer->zstd == NULL) {
+            free(writer->output);
+            free(writer);
+            return OBS_STATUS_OutOfMemory;
+        }
+        *writer_return = writer;
+        return OBS_STATUS_OK;
+    }
+#endif
+    if (inflateInit2(&writer->zs, COMPRESSION_GZIP_WINDOW) != Z_OK) {
+        free(writer->output);
+        free(writer);
+        return OBS_STATUS_OutOfMemory;
+    }
+    *writer_return = writer;
+    return OBS_STATUS_OK;
+}
+
+#if defined OBS_WITH_ZSTD
+static obs_status compression_write_zstd(compression_writer *writer, const char *data, size_t length)
+{
+    ZSTD_inBuffer in = {data, length, 0};
+    while (in.pos < in.size) {
+        ZSTD_outBuffer out = {writer->output, COMPRESSION_OUT_CHUNK, 0};
+        size_t ret = ZSTD_decompressStream(writer->zstd, &out, &in);
+        if (ZSTD_isError(ret)) {
+            COMMLOG(OBS_LOGERROR, "%s: zstd decompress failed: %s", __FUNCTION__, ZSTD_getErrorName(ret));
+            return OBS_STATUS_BadDigest;
+        }
+        writer->stream_end = ret == 0;
+        if (out.pos > 0) {
+            obs_status status = writer->sink(writer->output, (uint64_t)out.pos, writer->sink_data);
+            if (status != OBS_STATUS_OK) {
+                return status;
+            }
+        }
+    }
+    return OBS_STATUS_OK;
+}
+#endif
+
+obs_status compression_writer_write(compression_writer *writer, const char *data, uint64_t length)
+{
+    if (length > 0) {
+        writer->has_input = 1;
+    }
+#if defined OBS_WITH_ZSTD
+    if (writer->type == OBS_COMPRESSION_ZSTD) {
+        return compression_write_zstd(writer, data, (size_t)length);
+    }
+#endif
+    while (length > 0) {
+        uInt chunk = length > UINT32_MAX ? UINT32_MAX : (uInt)length;
+        writer->zs.next_in = (Bytef *)data;
+        writer->zs.avail_in = chunk;
+        while (writer->zs.avail_in > 0) {
+            int ret;
+            if (writer->stream_end) {
+                // 多成员gzip：上一个成员结束后继续解下一个
+                (void)inflateReset(&writer->zs);
+                writer->stream_end = 0;
+            }
+            writer->zs.next_out = (Bytef *)writer->output;
+            writer->zs.avail_out = COMPRESSION_OUT_CHUNK;
+            ret = inflate(&writer->zs, Z_NO_FLUSH);
+            if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+                COMMLOG(OBS_LOGERROR, "%s: inflate failed %d", __FUNCTION__, ret);
+                return OBS_STATUS_BadDigest;
+            }
+            if (ret == Z_STREAM_END) {
+                writer->stream_end = 1;
+            }
+            if (writer->zs.avail_out < COMPRESSION_OUT_CHUNK) {
+                obs_status status = writer->sink(writer->output,
+                    (uint64_t)(COMPRESSION_OUT_CHUNK - writer->zs.avail_out), writer->sink_data);
+                if (status != OBS_STATUS_OK) {
+                    return status;
+                }
+            }
+            else if (ret == Z_BUF_ERROR) {
+                break;
+            }
+        }
+        data += chunk;
+        length -= chunk;
+    }
+    return OBS_STATUS_OK;
+}
+
+obs_status compression_writer_finish(compression_writer *writer)
+{
+    if (writer->has_input && !writer->stream_end) {
+        COMMLOG(OBS_LOGERROR, "%s: compressed stream is truncated", __FUNCTION__);
+        return OBS_STATUS_PartialFile;
+    }
+    return OBS_STATUS_OK;
+}
+
+void compression_writer_destroy(compression_writer *writer)
+{
+    if (writer == NULL) {
+        return;
+    }
+#if defined OBS_WITH_ZSTD
+    if (writer->zstd != NULL) {
+        ZSTD_freeDStream(writer->zstd);
+    }
+    else
+#endif
+    {
+        (void)inflateEnd(&writer->zs);
+    }
+    CHECK_NULL_FREE(writer->output);
+    free(writer);
+}
+
+/************************************************************************************
+ * 范围读取保护
+ ************************************************************************************/
+static obs_status compression_guard_properties_callback(const obs_response_properties *properties,
+    void *callback_data)
+{
+    compression_range_guard *guard = (compression_range_guard *)callback_data;
+    if (compression_from_metadata(properties, NULL) != OBS_COMPRESSION_NONE) {
+        COMMLOG(OBS_LOGERROR, "range read of a compressed object is not supported");
+        guard->status = OBS_STATUS_InvalidRange;
+        return guard->status;
+    }
+    if (guard->properties_callback == NULL) {
+        return OBS_STATUS_OK;
+    }
+    return guard->properties_callback(properties, guard->callback_data);
+}
+
+static void compression_guard_complete_callback(obs_status status, const obs_error_details *error_details,
+    void *callback_data)
+{
+    compression_range_guard *guard = (compression_range_guard *)callback_data;
+    if (guard->status != OBS_STATUS_OK) {
+        status = guard->status;
+    }
+    guard->complete_callback(status, error_details, guard->callback_data);
+}
+
+static obs_status compression_guard_data_callback(int buffer_size, const char *buffer, void *callback_data)
+{
+    compression_range_guard *guard = (compression_range_guard *)callback_data;
+    if (guard->status != OBS_STATUS_OK) {
+        return guard->status;
+    }
+    if (guard->data_callback == NULL) {
+        return OBS_STATUS_OK;
+    }
+    return guard->data_callback(buffer_size, buffer, guard->callback_data);
+}
+
+void compression_range_guard_wrap(compression_range_guard *guard, request_params *params)
+{
+    guard->properties_callback = params->properties_callback;
+    guard->complete_callback = params->complete_callback;
+    guard->data_callback = params->fromObsCallback;
+    guard->callback_data = params->callback_data;
+    guard->status = OBS_STATUS_OK;
+    params->properties_callback = &compression_guard_properties_callback;
+    params->complete_callback = &compression_guard_complete_callback;
+    params->fromObsCallback = &compression_guard_data_callback;
+    params->callback_data = guard;
+}
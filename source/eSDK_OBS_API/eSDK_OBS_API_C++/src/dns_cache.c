@@ -0,0 +1,584 @@
+/*********************************************************************************
+* Copyright 2024 Huawei Technologies Co.,Ltd.
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+* this file except in compliance with the License.  You may obtain a copy of the
+* License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed
+* under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+* CONDITIONS OF ANY KIND, either express or implied.  See the License for the
+* specific language governing permissions and limitations under the License.
+**********************************************************************************
+*/
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "dns_cache.h"
+#include "endpoint_pool.h"
+#include "securec.h"
+#include "log.h"
+
+#if defined __GNUC__ || defined LINUX
+#include <pthread.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#else
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#include <process.h>
+#endif
+
+#define DNS_CACHE_DEFAULT_TTL_MS        60000
+#define DNS_CACHE_DEFAULT_REFRESH       75        // 超过有效期的百分比后被使用时提前刷新
+#define DNS_CACHE_DEFAULT_ENTRIES       256
+#define DNS_CACHE_HOST_LEN              256
+#define DNS_CACHE_MAX_ADDRESSES         8         // 每个地址族保留的地址数
+#define DNS_CACHE_ADDRESS_LEN           48        // 足够容纳带方括号的IPv6地址
+#define DNS_CACHE_RESOLVE_LEN           (DNS_CACHE_HOST_LEN + 8 + \
+    2 * DNS_CACHE_MAX_ADDRESSES * (DNS_CACHE_ADDRESS_LEN + 1))
+
+typedef struct dns_cache_addresses
+{
+    char v4[DNS_CACHE_MAX_ADDRESSES][DNS_CACHE_ADDRESS_LEN];
+    char v6[DNS_CACHE_MAX_ADDRESSES][DNS_CACHE_ADDRESS_LEN];   // 已带方括号
+    unsigned int v4_count;
+    unsigned int v6_count;
+    int v4_first;                             // 系统解析器返回的首个地址为IPv4
+} dns_cache_addresses;
+
+typedef struct dns_cache_entry
+{
+    struct dns_cache_entry *next;
+    char host[DNS_CACHE_HOST_LEN];
+    unsigned int port;
+    dns_cache_addresses addresses;
+    uint64_t resolved_ms;                     // 0表示尚未解析成功
+    uint64_t used_ms;
+    int pending;                              // 等待后台线程解析
+} dns_cache_entry;
+
+volatile int g_dns_cache_enabled = 0;
+static int g_dns_cache_initialized = 0;
+static obs_dns_cache_config g_dns_cache_config;
+static dns_cache_entry *g_dns_cache_entries = NULL;
+static unsigned int g_dns_cache_count = 0;
+static obs_dns_cache_stats g_dns_cache_stats;
+static int g_dns_cache_stop = 0;
+static int g_dns_cache_worker_started = 0;
+
+#if defined __GNUC__ || defined LINUX
+static pthread_mutex_t g_dns_cache_mutex;
+static pthread_cond_t g_dns_cache_cond;
+static pthread_t g_dns_cache_worker;
+#else
+static CRITICAL_SECTION g_dns_cache_mutex;
+static CONDITION_VARIABLE g_dns_cache_cond;
+static HANDLE g_dns_cache_worker = NULL;
+#endif
+
+static void dns_cache_lock(void)
+{
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_lock(&g_dns_cache_mutex);
+#else
+    EnterCriticalSection(&g_dns_cache_mutex);
+#endif
+}
+
+static void dns_cache_unlock(void)
+{
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_unlock(&g_dns_cache_mutex);
+#else
+    LeaveCriticalSection(&g_dns_cache_mutex);
+#endif
+}
+
+static void dns_cache_wait(void)
+{
+#if defined __GNUC__ || defined LINUX
+    pthread_cond_wait(&g_dns_cache_cond, &g_dns_cache_mutex);
+#else
+    SleepConditionVariableCS(&g_dns_cache_cond, &g_dns_cache_mutex, INFINITE);
+#endif
+}
+
+static void dns_cache_wake(void)
+{
+#if defined __GNUC__ || defined LINUX
+    pthread_cond_signal(&g_dns_cache_cond);
+#else
+    WakeConditionVariable(&g_dns_cache_cond);
+#endif
+}
+
+static uint64_t dns_cache_now_ms(void)
+{
+#if defined __GNUC__ || defined LINUX
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+#else
+    return (uint64_t)GetTickCount64();
+#endif
+}
+
+/**
+ * 拆分"host[:port]"，IP字面量不需要解析，返回0
+ */
+static int dns_cache_split_authority(const char *authority, size_t len, unsigned int default_port,
+    char *host, unsigned int *port)
+{
+    const char *colon = NULL;
+    unsigned char addr[sizeof(struct in6_addr)];
+    size_t host_len = len;
+    size_t i;
+
+    if (len == 0 || authority[0] == '[') {
+        return 0;
+    }
+    for (i = 0; i < len; i++) {
+        if (authority[i] == ':') {
+            colon = authority + i;
+        }
+    }
+    *port = default_port;
+    if (colon != NULL) {
+        host_len = (size_t)(colon - authority);
+        *port = (unsigned int)strtoul(colon + 1, NULL, 10);
+    }
+    if (host_len == 0 || host_len >= DNS_CACHE_HOST_LEN || *port == 0 || *port > 65535) {
+        return 0;
+    }
+    errno_t err = memcpy_s(host, DNS_CACHE_HOST_LEN, authority, host_len);
+    if (err != EOK) {
+        return 0;
+    }
+    host[host_len] = '\0';
+    return inet_pton(AF_INET, host, addr) != 1;
+}
+
+/* 从"http[s]://authority/..."中取出需要解析的主机和端口 */
+static int dns_cache_parse_uri(const char *uri, char *host, unsigned int *port)
+{
+    unsigned int default_port = 80;
+    const char *authority = NULL;
+
+    if (strncmp(uri, "https://", 8) == 0) {
+        default_port = 443;
+        authority = uri + 8;
+    }
+    else if (strncmp(uri, "http://", 7) == 0) {
+        authority = uri + 7;
+    }
+    else {
+        return 0;
+    }
+    return dns_cache_split_authority(authority, strcspn(authority, "/?#"), default_port, host, port);
+}
+
+static int dns_cache_getaddrinfo(const char *host, dns_cache_addresses *addresses)
+{
+    struct addrinfo hints;
+    struct addrinfo *result = NULL;
+    struct addrinfo *ai = NULL;
+    char text[INET6_ADDRSTRLEN];
+
+    memset_s(addresses, sizeof(dns_cache_addresses), 0, sizeof(dns_cache_addresses));
+    memset_s(&hints, sizeof(hints), 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, NULL, &hints, &result) != 0 || result == NULL) {
+        return 0;
+    }
+    addresses->v4_first = result->ai_family == AF_INET;
+    for (ai = result; ai != NULL; ai = ai->ai_next) {
+        if (ai->ai_family == AF_INET && addresses->v4_count < DNS_CACHE_MAX_ADDRESSES) {
+            if (inet_ntop(AF_INET, &((struct sockaddr_in *)ai->ai_addr)->sin_addr, text, sizeof(text))) {
+                int ret = snprintf_s(addresses->v4[addresses->v4_count], DNS_CACHE_ADDRESS_LEN,
+                    _TRUNCATE, "%s", text);
+                addresses->v4_count += ret > 0 ? 1 : 0;
+            }
+        }
+        else if (ai->ai_family == AF_INET6 && addresses->v6_count < DNS_CACHE_MAX_ADDRESSES) {
+            if (inet_ntop(AF_INET6, &((struct sockaddr_in6 *)ai->ai_addr)->sin6_addr, text, sizeof(text))) {
+                int ret = snprintf_s(addresses->v6[addresses->v6_count], DNS_CACHE_ADDRESS_LEN,
+                    _TRUNCATE, "[%s]", text);
+                addresses->v6_count += ret > 0 ? 1 : 0;
+            }
+        }
+    }
+    freeaddrinfo(result);
+    return addresses->v4_count + addresses->v6_count > 0;
+}
+
+/* 调用方持锁 */
+static dns_cache_entry *dns_cache_find(const char *host, unsigned int port)
+{
+    dns_cache_entry *entry = NULL;
+    for (entry = g_dns_cache_entries; entry != NULL; entry = entry->next) {
+        if (entry->port == port && strcmp(entry->host, host) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/* 新建条目，超出上限时淘汰最久未使用的条目，调用方持锁 */
+static dns_cache_entry *dns_cache_insert(const char *host, unsigned int port, uint64_t now)
+{
+    dns_cache_entry *entry = NULL;
+    if (g_dns_cache_count >= g_dns_cache_config.max_entries) {
+        dns_cache_entry **link = NULL;
+        dns_cache_entry **oldest = &g_dns_cache_entries;
+        for (link = &g_dns_cache_entries; *link != NULL; link = &(*link)->next) {
+            if ((*link)->used_ms < (*oldest)->used_ms) {
+                oldest = link;
+            }
+        }
+        entry = *oldest;
+        *oldest = entry->next;
+        g_dns_cache_count--;
+    }
+    else {
+        entry = (dns_cache_entry *)malloc(sizeof(dns_cache_entry));
+        if (entry == NULL) {
+            return NULL;
+        }
+    }
+    memset_s(entry, sizeof(dns_cache_entry), 0, sizeof(dns_cache_entry));
+    errno_t err = strcpy_s(entry->host, sizeof(entry->host), host);
+    CheckAndLogNoneZero(err, "strcpy_s", __FUNCTION__, __LINE__);
+    entry->port = port;
+    entry->used_ms = now;
+    entry->next = g_dns_cache_entries;
+    g_dns_cache_entries = entry;
+    g_dns_cache_count++;
+    return entry;
+}
+
+/* 解析失败时保留旧地址，条目到期后不再注入，由curl自行解析 */
+static void dns_cache_store(const char *host, unsigned int port, const dns_cache_addresses *addresses,
+    int resolved)
+{
+    dns_cache_entry *entry = dns_cache_find(host, port);
+    g_dns_cache_stats.resolves++;
+    if (!resolved) {
+        g_dns_cache_stats.resolve_failures++;
+        COMMLOG(OBS_LOGWARN, "%s resolve %s failed", __FUNCTION__, host);
+        return;
+    }
+    if (entry != NULL) {
+        entry->addresses = *addresses;
+        entry->resolved_ms = dns_cache_now_ms();
+    }
+}
+
+static void dns_cache_worker(void)
+{
+    dns_cache_addresses addresses;
+    char host[DNS_CACHE_HOST_LEN];
+    unsigned int port = 0;
+    int resolved = 0;
+
+    dns_cache_lock();
+    while (!g_dns_cache_stop) {
+        dns_cache_entry *entry = g_dns_cache_entries;
+        while (entry != NULL && !entry->pending) {
+            entry = entry->next;
+        }
+        if (entry == NULL) {
+            dns_cache_wait();
+            continue;
+        }
+        entry->pending = 0;
+        errno_t err = strcpy_s(host, sizeof(host), entry->host);
+        CheckAndLogNoneZero(err, "strcpy_s", __FUNCTION__, __LINE__);
+        port = entry->port;
+        // 解析期间不持锁，完成后按主机和端口重新查找条目，条目可能已被淘汰
+        dns_cache_unlock();
+        resolved = dns_cache_getaddrinfo(host, &addresses);
+        dns_cache_lock();
+        dns_cache_store(host, port, &addresses, resolved);
+    }
+    dns_cache_unlock();
+}
+
+#if defined __GNUC__ || defined LINUX
+static void *dns_cache_worker_linux(void *arg)
+{
+    (void)arg;
+    dns_cache_worker();
+    return NULL;
+}
+#else
+static unsigned __stdcall dns_cache_worker_win32(void *arg)
+{
+    (void)arg;
+    dns_cache_worker();
+    return 0;
+}
+#endif
+
+static int dns_cache_append(char *buffer, size_t size, size_t *len, const char *text)
+{
+    int ret = snprintf_s(buffer + *len, size - *len, _TRUNCATE, "%s%s", buffer[*len - 1] == ':' ? "" : ",", text);
+    if (ret < 0) {
+        return 0;
+    }
+    *len += (size_t)ret;
+    return 1;
+}
+
+struct curl_slist *dns_cache_resolve_list(const char *uri, obs_ip_preference preference)
+{
+    char host[DNS_CACHE_HOST_LEN];
+    char resolve[DNS_CACHE_RESOLVE_LEN];
+    unsigned int port = 0;
+    uint64_t now = dns_cache_now_ms();
+    dns_cache_entry *entry = NULL;
+    int v4_first = 0;
+    int use_v4 = preference != OBS_IP_PREFER_V6_ONLY;
+    int use_v6 = preference != OBS_IP_PREFER_V4_ONLY;
+    size_t len = 0;
+    unsigned int i;
+    int family;
+
+    if (!dns_cache_parse_uri(uri, host, &port)) {
+        return NULL;
+    }
+    dns_cache_lock();
+    if (!g_dns_cache_enabled) {
+        dns_cache_unlock();
+        return NULL;
+    }
+    entry = dns_cache_find(host, port);
+    if (entry == NULL) {
+        entry = dns_cache_insert(host, port, now);
+    }
+    if (entry == NULL) {
+        dns_cache_unlock();
+        return NULL;
+    }
+    entry->used_ms = now;
+    if (entry->resolved_ms == 0 || now - entry->resolved_ms >= g_dns_cache_config.ttl_ms) {
+        g_dns_cache_stats.misses++;
+        if (!entry->pending) {
+            entry->pending = 1;
+            dns_cache_wake();
+        }
+        dns_cache_unlock();
+        return NULL;
+    }
+    if (!entry->pending &&
+        now - entry->resolved_ms >= (uint64_t)g_dns_cache_config.ttl_ms * g_dns_cache_config.refresh_percent / 100) {
+        entry->pending = 1;
+        dns_cache_wake();
+    }
+    g_dns_cache_stats.hits++;
+    v4_first = preference == OBS_IP_PREFER_V4 ||
+        (preference == OBS_IP_PREFER_DEFAULT && entry->addresses.v4_first);
+    // "+"使条目在curl的DNS缓存中按正常时效过期，句柄被复用时不会一直沿用旧地址
+    len = (size_t)snprintf_s(resolve, sizeof(resolve), _TRUNCATE, "+%s:%u:", host, port);
+    // curl按列表中首个地址的地址族决定happy eyeballs先尝试的地址族
+    for (family = 0; family < 2; family++) {
+        int v4 = (family == 0) == v4_first;
+        unsigned int count = v4 ? entry->addresses.v4_count : entry->addresses.v6_count;
+        if ((v4 && !use_v4) || (!v4 && !use_v6)) {
+            continue;
+        }
+        for (i = 0; i < count; i++) {
+            if (!dns_cache_append(resolve, sizeof(resolve), &len,
+                v4 ? entry->addresses.v4[i] : entry->addresses.v6[i])) {
+                break;
+            }
+        }
+    }
+    dns_cache_unlock();
+    if (resolve[len - 1] == ':') {
+        // 缓存中没有所需地址族的地址
+        return NULL;
+    }
+    return curl_slist_append(NULL, resolve);
+}
+
+void dns_cache_initialize(void)
+{
+    if (g_dns_cache_initialized) {
+        return;
+    }
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_init(&g_dns_cache_mutex, NULL);
+    pthread_cond_init(&g_dns_cache_cond, NULL);
+#else
+    InitializeCriticalSection(&g_dns_cache_mutex);
+    InitializeConditionVariable(&g_dns_cache_cond);
+#endif
+    init_dns_cache_config(&g_dns_cache_config);
+    g_dns_cache_initialized = 1;
+}
+
+void dns_cache_deinitialize(void)
+{
+    if (!g_dns_cache_initialized) {
+        return;
+    }
+    obs_dns_cache_disable();
+}
+
+void init_dns_cache_config(obs_dns_cache_config *config)
+{
+    memset_s(config, sizeof(obs_dns_cache_config), 0, sizeof(obs_dns_cache_config));
+    config->ttl_ms = DNS_CACHE_DEFAULT_TTL_MS;
+    config->refresh_percent = DNS_CACHE_DEFAULT_REFRESH;
+    config->max_entries = DNS_CACHE_DEFAULT_ENTRIES;
+}
+
+obs_status obs_dns_cache_enable(const obs_dns_cache_config *config)
+{
+    int started = 0;
+    if (!g_dns_cache_initialized) {
+        COMMLOG(OBS_LOGERROR, "%s obs_initialize has not been called", __FUNCTION__);
+        return OBS_STATUS_InitCurlFailed;
+    }
+    if (config == NULL || config->ttl_ms == 0 || config->refresh_percent == 0 ||
+        config->refresh_percent > 100 || config->max_entries == 0) {
+        COMMLOG(OBS_LOGERROR, "%s: invalid dns cache config", __FUNCTION__);
+        return OBS_STATUS_InvalidParameter;
+    }
+    obs_dns_cache_disable();
+    dns_cache_lock();
+    g_dns_cache_config = *config;
+    memset_s(&g_dns_cache_stats, sizeof(g_dns_cache_stats), 0, sizeof(g_dns_cache_stats));
+    g_dns_cache_stop = 0;
+    dns_cache_unlock();
+#if defined __GNUC__ || defined LINUX
+    started = pthread_create(&g_dns_cache_worker, NULL, dns_cache_worker_linux, NULL) == 0;
+#else
+    g_dns_cache_worker = (HANDLE)_beginthreadex(NULL, 0, dns_cache_worker_win32, NULL, 0, NULL);
+    started = g_dns_cache_worker != 0;
+#endif
+    if (!started) {
+        COMMLOG(OBS_LOGERROR, "%s: create dns cache thread failed", __FUNCTION__);
+        return OBS_STATUS_InternalError;
+    }
+    g_dns_cache_worker_started = 1;
+    g_dns_cache_enabled = 1;
+    return OBS_STATUS_OK;
+}
+
+void obs_dns_cache_disable(void)
+{
+    dns_cache_entry *entry = NULL;
+    if (!g_dns_cache_initialized) {
+        return;
+    }
+    g_dns_cache_enabled = 0;
+    if (g_dns_cache_worker_started) {
+        dns_cache_lock();
+        g_dns_cache_stop = 1;
+        dns_cache_wake();
+        dns_cache_unlock();
+#if defined __GNUC__ || defined LINUX
+        pthread_join(g_dns_cache_worker, NULL);
+#else
+        WaitForSingleObject(g_dns_cache_worker, INFINITE);
+        CloseHandle(g_dns_cache_worker);
+        g_dns_cache_worker = NULL;
+#endif
+        g_dns_cache_worker_started = 0;
+    }
+    dns_cache_lock();
+    while (g_dns_cache_entries != NULL) {
+        entry = g_dns_cache_entries;
+        g_dns_cache_entries = entry->next;
+        free(entry);
+    }
+    g_dns_cache_count = 0;
+    dns_cache_unlock();
+}
+
+/* 同步解析一个"host[:port]"并写入缓存 */
+static obs_status dns_cache_preresolve_authority(const char *authority, obs_protocol protocol)
+{
+    char host[DNS_CACHE_HOST_LEN];
+    unsigned int port = 0;
+    dns_cache_addresses addresses;
+    dns_cache_entry *entry = NULL;
+    int resolved = 0;
+
+    if (!dns_cache_split_authority(authority, strlen(authority),
+        protocol == OBS_PROTOCOL_HTTP ? 80 : 443, host, &port)) {
+        return OBS_STATUS_OK;
+    }
+    resolved = dns_cache_getaddrinfo(host, &addresses);
+    dns_cache_lock();
+    entry = dns_cache_find(host, port);
+    if (entry == NULL) {
+        entry = dns_cache_insert(host, port, dns_cache_now_ms());
+    }
+    dns_cache_store(host, port, &addresses, resolved);
+    dns_cache_unlock();
+    if (entry == NULL) {
+        return OBS_STATUS_OutOfMemory;
+    }
+    return resolved ? OBS_STATUS_OK : OBS_STATUS_NameLookupError;
+}
+
+obs_status obs_dns_cache_preresolve(const obs_options *options)
+{
+    const obs_bucket_context *bucket = NULL;
+    char authority[DNS_CACHE_HOST_LEN * 2];
+    obs_status status = OBS_STATUS_OK;
+    obs_status ret = OBS_STATUS_OK;
+    unsigned int count = 0;
+    unsigned int i;
+
+    if (options == NULL || options->bucket_options.host_name == NULL) {
+        return OBS_STATUS_InvalidParameter;
+    }
+    if (!g_dns_cache_enabled) {
+        COMMLOG(OBS_LOGERROR, "%s dns cache is not enabled", __FUNCTION__);
+        return OBS_STATUS_InvalidParameter;
+    }
+    bucket = &options->bucket_options;
+    count = bucket->endpoint_pool != NULL ? endpoint_pool_count(bucket->endpoint_pool) : 1;
+    for (i = 0; i < count; i++) {
+        const char *host_name = bucket->endpoint_pool != NULL ?
+            endpoint_pool_host_at(bucket->endpoint_pool, i) : bucket->host_name;
+        // 与compose_uri一致，虚拟主机方式连接的是"桶名.域名"
+        int virtual_host = !bucket->useCname && bucket->bucket_name && bucket->bucket_name[0] &&
+            bucket->uri_style == OBS_URI_STYLE_VIRTUALHOST;
+        int len = virtual_host ?
+            snprintf_s(authority, sizeof(authority), _TRUNCATE, "%s.%s", bucket->bucket_name, host_name) :
+            snprintf_s(authority, sizeof(authority), _TRUNCATE, "%s", host_name);
+        if (len < 0) {
+            ret = OBS_STATUS_InvalidParameter;
+            continue;
+        }
+        status = dns_cache_preresolve_authority(authority, bucket->protocol);
+        if (status != OBS_STATUS_OK) {
+            ret = status;
+        }
+    }
+    return ret;
+}
+
+void obs_dns_cache_get_stats(obs_dns_cache_stats *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+    memset_s(stats, sizeof(obs_dns_cache_stats), 0, sizeof(obs_dns_cache_stats));
+    if (!g_dns_cache_initialized) {
+        return;
+    }
+    dns_cache_lock();
+    *stats = g_dns_cache_stats;
+    stats->entries = g_dns_cache_count;
+    dns_cache_unlock();
+}
@@ -0,0 +1,380 @@
+/*********************************************************************************
+* Copyright 2024 Huawei Technologies Co.,Ltd.
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+* this file except in compliance with the License.  You may obtain a copy of the
+* License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed
+* under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+* CONDITIONS OF ANY KIND, either express or implied.  See the License for the
+* specific language governing permissions and limitations under the License.
+**********************************************************************************
+*/
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include "endpoint_pool.h"
+#include "request.h"
+#include "securec.h"
+#include "log.h"
+
+#if defined __GNUC__ || defined LINUX
+#include <pthread.h>
+#else
+#include <windows.h>
+#endif
+
+#define ENDPOINT_POOL_MAX_ENDPOINTS         64
+#define ENDPOINT_POOL_HANDLES               32        // 每个端点缓存的请求句柄数
+#define ENDPOINT_DEFAULT_FAILURE_THRESHOLD  3
+#define ENDPOINT_DEFAULT_EJECT_MS           10000
+#define ENDPOINT_DEFAULT_MAX_EJECT_MS       300000
+#define ENDPOINT_EWMA_WEIGHT                0.3       // 新样本在EWMA时延中的权重
+#define ENDPOINT_EWMA_HALF_LIFE_MS          1000      // 无新样本时EWMA时延的衰减半衰期
+
+typedef enum
+{
+    ENDPOINT_STATE_HEALTHY = 0,
+    ENDPOINT_STATE_EJECTED,
+    ENDPOINT_STATE_PROBING                    // 摘除期满后放行一个探测请求，成功则恢复
+} endpoint_state;
+
+struct endpoint_pool_entry
+{
+    obs_endpoint_pool *pool;
+    char *host_name;
+    unsigned int weight;
+    endpoint_state state;
+    unsigned int consecutive_failures;
+    uint64_t eject_ms;                        // 下次摘除的时长，探测失败时翻倍
+    uint64_t eject_until_ms;
+    double ewma_latency_us;                   // 0表示尚无样本
+    uint64_t ewma_updated_ms;
+    double served;                            // 已分配请求数/权重，得分相同时取较小者
+    obs_endpoint_stats stats;
+    struct http_request *handles[ENDPOINT_POOL_HANDLES];
+    unsigned int handle_count;
+};
+
+struct obs_endpoint_pool
+{
+    obs_endpoint_pool_config config;
+    endpoint_pool_entry *entries;
+    unsigned int count;
+    unsigned int cursor;                      // 每次轮转扫描起点，摘除期满的端点轮流获得探测机会
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_t mutex;
+#else
+    CRITICAL_SECTION mutex;
+#endif
+};
+
+static void endpoint_pool_lock(obs_endpoint_pool *pool)
+{
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_lock(&pool->mutex);
+#else
+    EnterCriticalSection(&pool->mutex);
+#endif
+}
+
+static void endpoint_pool_unlock(obs_endpoint_pool *pool)
+{
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_unlock(&pool->mutex);
+#else
+    LeaveCriticalSection(&pool->mutex);
+#endif
+}
+
+static uint64_t endpoint_pool_now_ms(void)
+{
+#if defined __GNUC__ || defined LINUX
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+#else
+    return (uint64_t)GetTickCount64();
+#endif
+}
+
+/**
+ * 得分越低越优先，调用方持锁。EWMA时延随时间衰减，长时间未被选中的较慢端点
+ * 会重新获得请求以更新时延
+ */
+static double endpoint_score(const obs_endpoint_pool *pool, const endpoint_pool_entry *entry, uint64_t now)
+{
+    double ewma = entry->ewma_latency_us;
+    if (pool->config.policy != OBS_ENDPOINT_SELECT_EWMA_LATENCY) {
+        return (double)entry->stats.outstanding / (double)entry->weight;
+    }
+    if (ewma > 0 && now > entry->ewma_updated_ms) {
+        ewma *= pow(0.5, (double)(now - entry->ewma_updated_ms) / ENDPOINT_EWMA_HALF_LIFE_MS);
+    }
+    return ewma * (double)(entry->stats.outstanding + 1) / (double)entry->weight;
+}
+
+/* 得分相同时比较served，串行请求也按权重分摊到各端点 */
+static int endpoint_better(const endpoint_pool_entry *entry, double score,
+    const endpoint_pool_entry *best, double best_score)
+{
+    if (score != best_score) {
+        return score < best_score;
+    }
+    return entry->served < best->served;
+}
+
+/* 恢复的端点从当前进度开始分摊，不补齐摘除期间少分配的请求，调用方持锁 */
+static void endpoint_catch_up(obs_endpoint_pool *pool, endpoint_pool_entry *entry)
+{
+    unsigned int i;
+    for (i = 0; i < pool->count; i++) {
+        if (pool->entries[i].state == ENDPOINT_STATE_HEALTHY && pool->entries[i].served > entry->served) {
+            entry->served = pool->entries[i].served;
+        }
+    }
+}
+
+static void endpoint_eject(obs_endpoint_pool *pool, endpoint_pool_entry *entry, uint64_t now)
+{
+    entry->state = ENDPOINT_STATE_EJECTED;
+    entry->eject_until_ms = now + entry->eject_ms;
+    entry->stats.ejections++;
+    COMMLOG(OBS_LOGWARN, "%s endpoint %s ejected for %llu ms after %u failures", __FUNCTION__,
+        entry->host_name, (unsigned long long)entry->eject_ms, entry->consecutive_failures);
+    entry->eject_ms *= 2;
+    if (entry->eject_ms > pool->config.max_eject_ms) {
+        entry->eject_ms = pool->config.max_eject_ms;
+    }
+}
+
+endpoint_pool_entry *endpoint_pool_acquire(obs_endpoint_pool *pool)
+{
+    endpoint_pool_entry *best = NULL;
+    endpoint_pool_entry *earliest = NULL;
+    double best_score = 0;
+    uint64_t now = endpoint_pool_now_ms();
+    unsigned int i;
+
+    endpoint_pool_lock(pool);
+    for (i = 0; i < pool->count; i++) {
+        endpoint_pool_entry *entry = &pool->entries[(pool->cursor + i) % pool->count];
+        double score;
+        if (entry->state == ENDPOINT_STATE_EJECTED && now >= entry->eject_until_ms) {
+            // 摘除期满，本次请求作为探测
+            entry->state = ENDPOINT_STATE_PROBING;
+            best = entry;
+            break;
+        }
+        if (entry->state != ENDPOINT_STATE_HEALTHY) {
+            if (entry->state == ENDPOINT_STATE_EJECTED &&
+                (earliest == NULL || entry->eject_until_ms < earliest->eject_until_ms)) {
+                earliest = entry;
+            }
+            continue;
+        }
+        score = endpoint_score(pool, entry, now);
+        if (best == NULL || endpoint_better(entry, score, best, best_score)) {
+            best = entry;
+            best_score = score;
+        }
+    }
+    if (best == NULL) {
+        // 全部端点不可用时仍需发出请求，选最早恢复的端点
+        best = earliest != NULL ? earliest : &pool->entries[pool->cursor % pool->count];
+    }
+    pool->cursor = (pool->cursor + 1) % pool->count;
+    best->stats.outstanding++;
+    best->stats.requests++;
+    best->served += 1.0 / best->weight;
+    endpoint_pool_unlock(pool);
+    return best;
+}
+
+const char *endpoint_pool_host_name(const endpoint_pool_entry *entry)
+{
+    return entry->host_name;
+}
+
+unsigned int endpoint_pool_count(const obs_endpoint_pool *pool)
+{
+    return pool->count;
+}
+
+const char *endpoint_pool_host_at(const obs_endpoint_pool *pool, unsigned int index)
+{
+    return pool->entries[index].host_name;
+}
+
+void endpoint_pool_release(endpoint_pool_entry *entry, endpoint_outcome outcome, uint64_t latency_us)
+{
+    obs_endpoint_pool *pool = entry->pool;
+    uint64_t now = endpoint_pool_now_ms();
+
+    endpoint_pool_lock(pool);
+    if (entry->stats.outstanding > 0) {
+        entry->stats.outstanding--;
+    }
+    if (outcome == ENDPOINT_OUTCOME_SUCCESS) {
+        entry->consecutive_failures = 0;
+        entry->ewma_latency_us = entry->ewma_latency_us == 0 ? (double)latency_us :
+            entry->ewma_latency_us + ENDPOINT_EWMA_WEIGHT * ((double)latency_us - entry->ewma_latency_us);
+        entry->ewma_updated_ms = now;
+        if (entry->state == ENDPOINT_STATE_PROBING) {
+            COMMLOG(OBS_LOGWARN, "%s endpoint %s readmitted", __FUNCTION__, entry->host_name);
+            entry->state = ENDPOINT_STATE_HEALTHY;
+            entry->eject_ms = pool->config.eject_ms;
+            endpoint_catch_up(pool, entry);
+        }
+    }
+    else if (outcome == ENDPOINT_OUTCOME_FAILURE) {
+        entry->stats.failures++;
+        entry->consecutive_failures++;
+        if (entry->state == ENDPOINT_STATE_PROBING ||
+            (entry->state == ENDPOINT_STATE_HEALTHY &&
+             entry->consecutive_failures >= pool->config.failure_threshold)) {
+            endpoint_eject(pool, entry, now);
+        }
+    }
+    else if (entry->state == ENDPOINT_STATE_PROBING) {
+        // 探测请求没有结果，下次请求重新探测
+        entry->state = ENDPOINT_STATE_EJECTED;
+        entry->eject_until_ms = now;
+    }
+    endpoint_pool_unlock(pool);
+}
+
+struct http_request *endpoint_pool_take_handle(endpoint_pool_entry *entry)
+{
+    struct http_request *request = NULL;
+    endpoint_pool_lock(entry->pool);
+    if (entry->handle_count > 0) {
+        request = entry->handles[--entry->handle_count];
+    }
+    endpoint_pool_unlock(entry->pool);
+    return request;
+}
+
+int endpoint_pool_park_handle(endpoint_pool_entry *entry, struct http_request *request)
+{
+    int parked = 0;
+    endpoint_pool_lock(entry->pool);
+    if (entry->handle_count < ENDPOINT_POOL_HANDLES) {
+        entry->handles[entry->handle_count++] = request;
+        parked = 1;
+    }
+    endpoint_pool_unlock(entry->pool);
+    return parked;
+}
+
+void init_endpoint_pool_config(obs_endpoint_pool_config *config)
+{
+    memset_s(config, sizeof(obs_endpoint_pool_config), 0, sizeof(obs_endpoint_pool_config));
+    config->policy = OBS_ENDPOINT_SELECT_LEAST_OUTSTANDING;
+    config->failure_threshold = ENDPOINT_DEFAULT_FAILURE_THRESHOLD;
+    config->eject_ms = ENDPOINT_DEFAULT_EJECT_MS;
+    config->max_eject_ms = ENDPOINT_DEFAULT_MAX_EJECT_MS;
+}
+
+obs_status obs_endpoint_pool_create(const obs_endpoint_pool_config *config, const char *const *host_names,
+    const unsigned int *weights, unsigned int count, obs_endpoint_pool **pool_return)
+{
+    obs_endpoint_pool *pool = NULL;
+    unsigned int i;
+
+    if (config == NULL || host_names == NULL || pool_return == NULL || count == 0 ||
+        count > ENDPOINT_POOL_MAX_ENDPOINTS || config->failure_threshold == 0 ||
+        config->eject_ms == 0 || config->max_eject_ms < config->eject_ms) {
+        COMMLOG(OBS_LOGERROR, "%s: invalid endpoint pool config", __FUNCTION__);
+        return OBS_STATUS_InvalidParameter;
+    }
+    for (i = 0; i < count; i++) {
+        if (host_names[i] == NULL || host_names[i][0] == '\0') {
+            COMMLOG(OBS_LOGERROR, "%s: empty host name at %u", __FUNCTION__, i);
+            return OBS_STATUS_InvalidParameter;
+        }
+    }
+    pool = (obs_endpoint_pool *)malloc(sizeof(obs_endpoint_pool));
+    if (pool == NULL) {
+        return OBS_STATUS_OutOfMemory;
+    }
+    memset_s(pool, sizeof(obs_endpoint_pool), 0, sizeof(obs_endpoint_pool));
+    pool->entries = (endpoint_pool_entry *)calloc(count, sizeof(endpoint_pool_entry));
+    if (pool->entries == NULL) {
+        free(pool);
+        return OBS_STATUS_OutOfMemory;
+    }
+    pool->config = *config;
+    pool->count = count;
+    for (i = 0; i < count; i++) {
+        endpoint_pool_entry *entry = &pool->entries[i];
+        size_t len = strlen(host_names[i]) + 1;
+        entry->host_name = (char *)malloc(len);
+        if (entry->host_name == NULL) {
+            while (i--) {
+                free(pool->entries[i].host_name);
+            }
+            free(pool->entries);
+            free(pool);
+            return OBS_STATUS_OutOfMemory;
+        }
+        errno_t err = memcpy_s(entry->host_name, len, host_names[i], len);
+        CheckAndLogNoneZero(err, "memcpy_s", __FUNCTION__, __LINE__);
+        entry->pool = pool;
+        entry->weight = (weights != NULL && weights[i] > 0) ? weights[i] : 1;
+        entry->eject_ms = config->eject_ms;
+        entry->stats.host_name = entry->host_name;
+        entry->stats.weight = entry->weight;
+    }
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_init(&pool->mutex, NULL);
+#else
+    InitializeCriticalSection(&pool->mutex);
+#endif
+    *pool_return = pool;
+    return OBS_STATUS_OK;
+}
+
+void obs_endpoint_pool_destroy(obs_endpoint_pool *pool)
+{
+    unsigned int i;
+    if (pool == NULL) {
+        return;
+    }
+    for (i = 0; i < pool->count; i++) {
+        endpoint_pool_entry *entry = &pool->entries[i];
+        while (entry->handle_count > 0) {
+            request_destroy(entry->handles[--entry->handle_count]);
+        }
+        free(entry->host_name);
+    }
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_destroy(&pool->mutex);
+#else
+    DeleteCriticalSection(&pool->mutex);
+#endif
+    free(pool->entries);
+    free(pool);
+}
+
+unsigned int obs_endpoint_pool_get_stats(obs_endpoint_pool *pool, obs_endpoint_stats *stats, unsigned int count)
+{
+    uint64_t now = endpoint_pool_now_ms();
+    unsigned int i;
+    if (pool == NULL || stats == NULL) {
+        return 0;
+    }
+    endpoint_pool_lock(pool);
+    for (i = 0; i < count && i < pool->count; i++) {
+        endpoint_pool_entry *entry = &pool->entries[i];
+        stats[i] = entry->stats;
+        stats[i].healthy = entry->state == ENDPOINT_STATE_HEALTHY ||
+            (entry->state == ENDPOINT_STATE_EJECTED && now >= entry->eject_until_ms);
+        stats[i].ewma_latency_us = (uint64_t)entry->ewma_latency_us;
+    }
+    endpoint_pool_unlock(pool);
+    return i;
+}
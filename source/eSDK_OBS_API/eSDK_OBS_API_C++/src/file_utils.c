@@ -24,6 +24,7 @@
 
 #if defined (WIN32)
 #include <io.h>
+#include <direct.h>
 #endif
 #define TEMP_RANDOM_NAME_LEN 4
 
@@ -247,6 +248,58 @@ int remove_file(const char* filename)
 	return ret;
 }
 
+int rename_file(const char* from, const char* to)
+{
+	int ret = -1;
+	char* renameFunc = "default rename func";
+	if (file_path_code_schemes == ANSI_CODE)
+	{
+		renameFunc = "rename";
+		ret = rename(from, to);
+	}
+	else if (file_path_code_schemes == UNICODE_CODE)
+	{
+#if defined __GNUC__ || defined LINUX
+		renameFunc = SYMBOL_NAME_STR(rename);
+		ret = rename(from, to);
+#endif
+#if defined (WIN32)
+		renameFunc = SYMBOL_NAME_STR(_wrename);
+		ret = _wrename((const wchar_t*)from, (const wchar_t*)to);
+#endif
+	}
+	else
+	{
+		COMMLOG(OBS_LOGERROR, "unkown encoding scheme, function %s failed", __FUNCTION__);
+		return -1;
+	}
+	if (ret != 0) {
+		checkIfErrorAndLogStrError(renameFunc, __FUNCTION__, __LINE__, ret);
+	}
+	return ret;
+}
+
+// create the missing parent directories of a file to be written
+void make_parent_dirs(char *path)
+{
+	size_t base_len = strlen(path);
+	size_t i;
+	for (i = 1; i < base_len; i++)
+	{
+		if (path[i] != '/')
+		{
+			continue;
+		}
+		path[i] = '\0';
+#if defined (WIN32)
+		(void)_mkdir(path);
+#else
+		(void)mkdir(path, 0755);
+#endif
+		path[i] = '/';
+	}
+}
+
 int file_path_append(char* destination, size_t destinationSize)
 {
 
@@ -335,6 +388,27 @@ int temp_part_file_path_printf(char * fileNameTempBuffer,
 	return ret;
 }
 
+// the decrypted part is written here until its authentication tag is verified
+int staging_part_file_path_printf(char * fileNameTempBuffer,
+	size_t const fileNameTempBufferCount, const char * storeFileName, int part_num) {
+	int ret = -1;
+	if (file_path_code_schemes == ANSI_CODE)
+	{
+		ret = sprintf_s(fileNameTempBuffer, fileNameTempBufferCount, "%s.%d.tmp", storeFileName, part_num);
+	}
+	else if (file_path_code_schemes == UNICODE_CODE)
+	{
+		ret = swprintf_s((wchar_t*)fileNameTempBuffer, fileNameTempBufferCount
+			, L"%s.%d.tmp", (wchar_t const*)storeFileName, part_num);
+	}
+	else
+	{
+		COMMLOG(OBS_LOGERROR, "unkown encoding scheme, function %s failed", __FUNCTION__);
+		ret = -1;
+	}
+	return ret;
+}
+
 int checkpoint_file_path_printf(char* const path_buffer
 	, size_t const path_buffer_count, char const* uploadFileName)
 {
@@ -24,6 +24,13 @@
 #include <curl/curl.h>
 #include <openssl/md5.h> 
 #include "common.h"
+#include "metadata_cache.h"
+#include "chunk_cache.h"
+#include "metrics.h"
+#include "hedging.h"
+#include "dns_cache.h"
+#include "prewarm.h"
+#include "ca_store.h"
 
 #if defined __GNUC__ || defined LINUX
 #include <pthread.h>
@@ -190,6 +197,7 @@ const char *obs_get_status_name(obs_status status)
 		handlecase(NULL_SECRETE_ACCESS_KEY); 
 		handlecase(NoSuchTrashConfiguration);
 		handlecase(InvalidRequestBody);
+        handlecase(HttpErrorNotModified);
         handlecase(BUTT);
     }
 
@@ -220,6 +228,12 @@ obs_status obs_initialize(int win32_flags)
     } 
     
     ret = request_api_initialize(win32_flags);
+    metrics_initialize();
+    bandwidth_initialize();
+    hedging_initialize();
+    dns_cache_initialize();
+    prewarm_initialize();
+    ca_store_initialize();
 
     SYSTEMTIME rspTime;
     GetLocalTime(&rspTime);      
@@ -257,6 +271,9 @@ void init_obs_options(obs_options *options)
     options->request_options.gm_mode_switch = OBS_GM_MODE_CLOSE;
     options->request_options.ssl_min_version = CURL_SSLVERSION_TLSv1_2;
     options->request_options.ssl_max_version = (1 << 16) | 3;  // CURL_SSLVERSION_TLSv1_3
+    options->request_options.bandwidth_priority = OBS_BANDWIDTH_PRIORITY_NORMAL;
+    options->request_options.ip_preference = OBS_IP_PREFER_DEFAULT;
+    options->request_options.happy_eyeballs_timeout_ms = 0;
 
     options->bucket_options.access_key = NULL;
     options->bucket_options.secret_access_key =NULL;
@@ -269,6 +286,7 @@ void init_obs_options(obs_options *options)
     options->bucket_options.uri_style = OBS_URI_STYLE_VIRTUALHOST;
     options->bucket_options.epid = NULL;
 	options->bucket_options.useCname = false;
+    options->bucket_options.endpoint_pool = NULL;
     options->temp_auth = NULL;
 
     // 加载 SSL 配置文件
@@ -299,7 +317,8 @@ obs_status init_certificate_set_path(obs_certificate_conf ca_conf, char *ca_path
 	else if ((OBS_DEFINED_CERTIFICATE == ca_conf) && path && (path_length > 0))
 	{
 		errno_t err = EOK;
-		err = memcpy_s(ca_path, sizeof(ca_path), path, path_length);
+		// 保留结尾的'\0'
+		err = memcpy_s(ca_path, PATH_LENGTH - 1, path, path_length);
 		if (err != EOK)
 		{
 			COMMLOG(OBS_LOGWARN, "%s(%d):memcpy_s failed!", __FUNCTION__, __LINE__);
@@ -320,9 +339,10 @@ obs_status init_certificate_readInfo(char *ca_path, int length)
 		COMMLOG(OBS_LOGERROR, "fopen failed path = %s", ca_path);
 		return OBS_STATUS_OpenFileFailed;
 	}
-	while (1)
+	// 超出g_ca_info的部分由ca_store直接从文件加载
+	while (length < CERTIFICATE_SIZE - 1)
 	{
-		int rc = fread(g_ca_info, sizeof(char), CERTIFICATE_SIZE, fp);
+		int rc = fread(g_ca_info + length, sizeof(char), CERTIFICATE_SIZE - 1 - length, fp);
 		if (rc <= 0)
 		{
 			break;
@@ -330,6 +350,7 @@ obs_status init_certificate_readInfo(char *ca_path, int length)
 		length += rc;
 	}
 	fclose(fp);
+	g_ca_info[length] = '\0';
 	if (length <= 0)
 	{
 		COMMLOG(OBS_LOGERROR, "fread failed length = %d\n", length);
@@ -349,6 +370,7 @@ obs_status init_certificate_by_path(obs_protocol protocol, obs_certificate_conf
     g_protocol =  protocol;
     if (OBS_PROTOCOL_HTTP == protocol)
     {
+        ca_store_watch_file(g_ca_info, NULL);
         return status;
     }
 
@@ -364,6 +386,7 @@ obs_status init_certificate_by_path(obs_protocol protocol, obs_certificate_conf
 	{
 		return status;
 	}
+    ca_store_watch_file(g_ca_info, ca_path);
     return status;
 }
 
@@ -384,6 +407,11 @@ obs_status init_certificate_by_buffer(const char *buffer, int buffer_length)
     {
         COMMLOG(OBS_LOGWARN, "%s(%d): memcpy_s failed!", __FUNCTION__, __LINE__);
     }
+    if (buffer_length < (int)sizeof(g_ca_info))
+    {
+        g_ca_info[buffer_length] = '\0';
+    }
+    ca_store_watch_file(g_ca_info, NULL);
     g_protocol = OBS_PROTOCOL_HTTPS;
     return OBS_STATUS_OK;
 }
@@ -434,7 +462,14 @@ void init_server_callback(obs_upload_file_server_callback * server_callback)
 
 void obs_deinitialize(void)
 {
+    prewarm_deinitialize();
     LOG_EXIT();
+    chunk_cache_deinitialize();
+    metadata_cache_deinitialize();
+    bandwidth_deinitialize();
+    hedging_deinitialize();
+    dns_cache_deinitialize();
+    ca_store_deinitialize();
     request_api_deinitialize();
     xmlCleanupParser();
     curl_global_cleanup();
@@ -0,0 +1,369 @@
+/*********************************************************************************
+* Copyright 2024 Huawei Technologies Co.,Ltd.
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+* this file except in compliance with the License.  You may obtain a copy of the
+* License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed
+* under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+* CONDITIONS OF ANY KIND, either express or implied.  See the License for the
+* specific language governing permissions and limitations under the License.
+**********************************************************************************
+*/
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "hedging.h"
+#include "securec.h"
+#include "log.h"
+
+#if defined __GNUC__ || defined LINUX
+#include <pthread.h>
+#else
+#include <windows.h>
+#endif
+
+#define HEDGING_DEFAULT_PERCENTILE      95
+#define HEDGING_DEFAULT_MIN_DELAY_MS    10
+#define HEDGING_DEFAULT_MAX_DELAY_MS    1000
+#define HEDGING_DEFAULT_BUDGET_PERCENT  5
+#define HEDGING_SAMPLES                 512       // 参与百分位计算的最近样本数
+#define HEDGING_RECOMPUTE_INTERVAL      32        // 每新增若干样本重新计算一次延迟
+#define HEDGING_BUDGET_BURST            10        // 预算最多累积的对冲次数
+
+typedef struct hedging_thread_slot
+{
+    struct hedging_thread_slot *prev;
+    struct hedging_thread_slot *next;
+    CURLM *multi;
+} hedging_thread_slot;
+
+volatile int g_hedging_enabled = 0;
+static int g_hedging_initialized = 0;
+static obs_hedging_config g_hedging_config;
+static hedging_thread_slot *g_hedging_slots = NULL;
+/* 近期原请求收到响应头的时延，环形保存 */
+static uint32_t g_hedging_samples[HEDGING_SAMPLES];
+static unsigned int g_hedging_sample_count = 0;
+static unsigned int g_hedging_sample_next = 0;
+static unsigned int g_hedging_samples_pending = 0;
+static uint64_t g_hedging_delay_ms = HEDGING_DEFAULT_MAX_DELAY_MS;
+/* 预算以百分之一次对冲为单位，每个可对冲请求增加budget_percent，每次对冲消耗100 */
+static uint64_t g_hedging_budget = 0;
+static obs_hedging_stats g_hedging_stats;
+
+#if defined __GNUC__ || defined LINUX
+static pthread_mutex_t g_hedging_mutex;
+static pthread_key_t g_hedging_key;
+#else
+static CRITICAL_SECTION g_hedging_mutex;
+static DWORD g_hedging_key = FLS_OUT_OF_INDEXES;
+#endif
+
+static void hedging_lock(void)
+{
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_lock(&g_hedging_mutex);
+#else
+    EnterCriticalSection(&g_hedging_mutex);
+#endif
+}
+
+static void hedging_unlock(void)
+{
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_unlock(&g_hedging_mutex);
+#else
+    LeaveCriticalSection(&g_hedging_mutex);
+#endif
+}
+
+uint64_t hedging_now_ms(void)
+{
+#if defined __GNUC__ || defined LINUX
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+#else
+    return (uint64_t)GetTickCount64();
+#endif
+}
+
+#if defined __GNUC__ || defined LINUX
+static void hedging_thread_exit(void *data)
+#else
+static VOID WINAPI hedging_thread_exit(PVOID data)
+#endif
+{
+    hedging_thread_slot *slot = (hedging_thread_slot *)data;
+    if (slot == NULL) {
+        return;
+    }
+    hedging_lock();
+    if (slot->prev) {
+        slot->prev->next = slot->next;
+    }
+    else {
+        g_hedging_slots = slot->next;
+    }
+    if (slot->next) {
+        slot->next->prev = slot->prev;
+    }
+    hedging_unlock();
+    if (slot->multi != NULL) {
+        curl_multi_cleanup(slot->multi);
+    }
+    free(slot);
+}
+
+void hedging_initialize(void)
+{
+    if (g_hedging_initialized) {
+        return;
+    }
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_init(&g_hedging_mutex, NULL);
+    if (pthread_key_create(&g_hedging_key, hedging_thread_exit) != 0) {
+        COMMLOG(OBS_LOGERROR, "%s pthread_key_create failed", __FUNCTION__);
+        pthread_mutex_destroy(&g_hedging_mutex);
+        return;
+    }
+#else
+    InitializeCriticalSection(&g_hedging_mutex);
+    g_hedging_key = FlsAlloc(hedging_thread_exit);
+    if (g_hedging_key == FLS_OUT_OF_INDEXES) {
+        COMMLOG(OBS_LOGERROR, "%s FlsAlloc failed", __FUNCTION__);
+        DeleteCriticalSection(&g_hedging_mutex);
+        return;
+    }
+#endif
+    init_hedging_config(&g_hedging_config);
+    g_hedging_initialized = 1;
+}
+
+/**
+ * curl_global_cleanup之前释放各线程的multi句柄，线程槽位在线程退出时释放
+ */
+void hedging_deinitialize(void)
+{
+    hedging_thread_slot *slot = NULL;
+    if (!g_hedging_initialized) {
+        return;
+    }
+    g_hedging_enabled = 0;
+    hedging_lock();
+    for (slot = g_hedging_slots; slot != NULL; slot = slot->next) {
+        if (slot->multi != NULL) {
+            curl_multi_cleanup(slot->multi);
+            slot->multi = NULL;
+        }
+    }
+    hedging_unlock();
+}
+
+int hedging_eligible(const request_params *params)
+{
+    if (!g_hedging_enabled) {
+        return 0;
+    }
+    if (params->httpRequestType != http_request_type_get && params->httpRequestType != http_request_type_head) {
+        return 0;
+    }
+    return params->toObsCallback == NULL;
+}
+
+CURLM *hedging_thread_multi(void)
+{
+    hedging_thread_slot *slot = NULL;
+    if (!g_hedging_initialized) {
+        return NULL;
+    }
+#if defined __GNUC__ || defined LINUX
+    slot = (hedging_thread_slot *)pthread_getspecific(g_hedging_key);
+#else
+    slot = (hedging_thread_slot *)FlsGetValue(g_hedging_key);
+#endif
+    if (slot == NULL) {
+        slot = (hedging_thread_slot *)malloc(sizeof(hedging_thread_slot));
+        if (slot == NULL) {
+            COMMLOG(OBS_LOGERROR, "%s malloc failed", __FUNCTION__);
+            return NULL;
+        }
+        memset_s(slot, sizeof(hedging_thread_slot), 0, sizeof(hedging_thread_slot));
+#if defined __GNUC__ || defined LINUX
+        if (pthread_setspecific(g_hedging_key, slot) != 0) {
+            free(slot);
+            return NULL;
+        }
+#else
+        if (!FlsSetValue(g_hedging_key, slot)) {
+            free(slot);
+            return NULL;
+        }
+#endif
+        hedging_lock();
+        slot->next = g_hedging_slots;
+        if (g_hedging_slots) {
+            g_hedging_slots->prev = slot;
+        }
+        g_hedging_slots = slot;
+        hedging_unlock();
+    }
+    if (slot->multi == NULL) {
+        slot->multi = curl_multi_init();
+        if (slot->multi == NULL) {
+            COMMLOG(OBS_LOGERROR, "%s curl_multi_init failed", __FUNCTION__);
+            return NULL;
+        }
+        // 不做HTTP/2多路复用，对冲请求必须走另一条连接
+        curl_multi_setopt(slot->multi, CURLMOPT_PIPELINING, (long)CURLPIPE_NOTHING);
+    }
+    return slot->multi;
+}
+
+uint64_t hedging_delay_ms(void)
+{
+    uint64_t delay_ms;
+    hedging_lock();
+    delay_ms = g_hedging_delay_ms;
+    hedging_unlock();
+    return delay_ms;
+}
+
+int hedging_acquire_budget(void)
+{
+    int acquired = 0;
+    hedging_lock();
+    if (g_hedging_budget >= 100) {
+        g_hedging_budget -= 100;
+        acquired = 1;
+    }
+    else {
+        g_hedging_stats.budget_exhausted++;
+    }
+    hedging_unlock();
+    return acquired;
+}
+
+static int hedging_compare_sample(const void *a, const void *b)
+{
+    uint32_t left = *(const uint32_t *)a;
+    uint32_t right = *(const uint32_t *)b;
+    return left < right ? -1 : (left > right ? 1 : 0);
+}
+
+/* 调用方持锁 */
+static void hedging_recompute_delay(void)
+{
+    uint32_t sorted[HEDGING_SAMPLES];
+    unsigned int index;
+    uint64_t delay_ms;
+
+    errno_t err = memcpy_s(sorted, sizeof(sorted), g_hedging_samples,
+        g_hedging_sample_count * sizeof(uint32_t));
+    if (err != EOK) {
+        return;
+    }
+    qsort(sorted, g_hedging_sample_count, sizeof(uint32_t), hedging_compare_sample);
+    index = (unsigned int)((uint64_t)g_hedging_sample_count * g_hedging_config.delay_percentile / 100);
+    if (index >= g_hedging_sample_count) {
+        index = g_hedging_sample_count - 1;
+    }
+    delay_ms = sorted[index];
+    if (delay_ms < g_hedging_config.min_delay_ms) {
+        delay_ms = g_hedging_config.min_delay_ms;
+    }
+    if (delay_ms > g_hedging_config.max_delay_ms) {
+        delay_ms = g_hedging_config.max_delay_ms;
+    }
+    g_hedging_delay_ms = delay_ms;
+}
+
+void hedging_record_latency(uint64_t latency_ms)
+{
+    hedging_lock();
+    g_hedging_samples[g_hedging_sample_next] = latency_ms > UINT32_MAX ? UINT32_MAX : (uint32_t)latency_ms;
+    g_hedging_sample_next = (g_hedging_sample_next + 1) % HEDGING_SAMPLES;
+    if (g_hedging_sample_count < HEDGING_SAMPLES) {
+        g_hedging_sample_count++;
+    }
+    // 样本不足时保持max_delay_ms，避免冷启动阶段过早对冲
+    if (++g_hedging_samples_pending >= HEDGING_RECOMPUTE_INTERVAL) {
+        g_hedging_samples_pending = 0;
+        hedging_recompute_delay();
+    }
+    hedging_unlock();
+}
+
+void hedging_record_outcome(int hedged, int hedge_won)
+{
+    uint64_t budget_max = (uint64_t)HEDGING_BUDGET_BURST * 100;
+    hedging_lock();
+    g_hedging_stats.eligible++;
+    g_hedging_budget += g_hedging_config.budget_percent;
+    if (g_hedging_budget > budget_max) {
+        g_hedging_budget = budget_max;
+    }
+    if (hedged) {
+        g_hedging_stats.hedged++;
+    }
+    if (hedge_won) {
+        g_hedging_stats.hedge_wins++;
+    }
+    hedging_unlock();
+}
+
+void init_hedging_config(obs_hedging_config *config)
+{
+    memset_s(config, sizeof(obs_hedging_config), 0, sizeof(obs_hedging_config));
+    config->delay_percentile = HEDGING_DEFAULT_PERCENTILE;
+    config->min_delay_ms = HEDGING_DEFAULT_MIN_DELAY_MS;
+    config->max_delay_ms = HEDGING_DEFAULT_MAX_DELAY_MS;
+    config->budget_percent = HEDGING_DEFAULT_BUDGET_PERCENT;
+}
+
+obs_status obs_hedging_enable(const obs_hedging_config *config)
+{
+    if (!g_hedging_initialized) {
+        COMMLOG(OBS_LOGERROR, "%s obs_initialize has not been called", __FUNCTION__);
+        return OBS_STATUS_InitCurlFailed;
+    }
+    if (config == NULL || config->delay_percentile == 0 || config->delay_percentile > 100 ||
+        config->min_delay_ms > config->max_delay_ms || config->budget_percent > 100) {
+        COMMLOG(OBS_LOGERROR, "%s invalid hedging config", __FUNCTION__);
+        return OBS_STATUS_InvalidParameter;
+    }
+    hedging_lock();
+    g_hedging_config = *config;
+    g_hedging_sample_count = 0;
+    g_hedging_sample_next = 0;
+    g_hedging_samples_pending = 0;
+    g_hedging_delay_ms = config->max_delay_ms;
+    g_hedging_budget = 0;
+    memset_s(&g_hedging_stats, sizeof(g_hedging_stats), 0, sizeof(g_hedging_stats));
+    hedging_unlock();
+    g_hedging_enabled = 1;
+    return OBS_STATUS_OK;
+}
+
+void obs_hedging_disable(void)
+{
+    g_hedging_enabled = 0;
+}
+
+void obs_hedging_get_stats(obs_hedging_stats *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+    memset_s(stats, sizeof(obs_hedging_stats), 0, sizeof(obs_hedging_stats));
+    if (!g_hedging_initialized) {
+        return;
+    }
+    hedging_lock();
+    *stats = g_hedging_stats;
+    stats->delay_ms = g_hedging_delay_ms;
+    hedging_unlock();
+}
@@ -13,6 +13,7 @@
 **********************************************************************************
 */
 #include "log.h"
+#include "obs_time_util.h"
 #include "file_utils.h"
 #include "securec.h"
 #include <stdlib.h>
@@ -828,12 +829,17 @@ void print_current_time_ms(char* buffer, int bufferLen) {
 	sprintf_s(buffer, bufferLen, "%04d-%02d-%02d %02d:%02d:%02d.%03d", st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute, st.wSecond, st.wMilliseconds);
 #else
 	struct timeval tv;
-	struct tm* tm_info;
 	gettimeofday(&tv, NULL);
-	tm_info = localtime(&tv.tv_sec);
-	strftime(buffer, bufferLen, "%Y-%m-%d %H:%M:%S", tm_info);
+	obs_local_time_format((int64_t)tv.tv_sec, buffer, bufferLen);
 	size_t timeStrLen = strlen(buffer);
-	sprintf_s(buffer + timeStrLen, bufferLen - timeStrLen, ".%03ld", tv.tv_usec / 1000);
+	if (timeStrLen + 4 < (size_t)bufferLen) {
+		int ms = (int)(tv.tv_usec / 1000);
+		buffer[timeStrLen] = '.';
+		buffer[timeStrLen + 1] = (char)('0' + ms / 100);
+		buffer[timeStrLen + 2] = (char)('0' + ms / 10 % 10);
+		buffer[timeStrLen + 3] = (char)('0' + ms % 10);
+		buffer[timeStrLen + 4] = '\0';
+	}
 #endif
 
 }
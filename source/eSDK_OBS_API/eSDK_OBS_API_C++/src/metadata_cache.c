@@ -0,0 +1,702 @@
+/*********************************************************************************
+* Copyright 2024 Huawei Technologies Co.,Ltd.
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+* this file except in compliance with the License.  You may obtain a copy of the
+* License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed
+* under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+* CONDITIONS OF ANY KIND, either express or implied.  See the License for the
+* specific language governing permissions and limitations under the License.
+**********************************************************************************
+*/
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <time.h>
+#include "metadata_cache.h"
+#include "securec.h"
+#include "log.h"
+
+#if defined __GNUC__ || defined LINUX
+#include <pthread.h>
+#else
+#include <windows.h>
+#endif
+
+#define METADATA_CACHE_DEFAULT_SHARDS       16
+#define METADATA_CACHE_MAX_SHARDS           1024
+#define METADATA_CACHE_DEFAULT_ENTRIES      10000
+#define METADATA_CACHE_DEFAULT_TTL_MS       30000
+#define METADATA_CACHE_MIN_BUCKETS          16
+
+/**
+ * 缓存条目：properties中的字符串指针均指向同一块内存中条目之后的区域
+ */
+typedef struct metadata_cache_entry
+{
+    struct metadata_cache_entry *hash_next;
+    struct metadata_cache_entry *lru_prev;
+    struct metadata_cache_entry *lru_next;
+    uint64_t hash;
+    uint64_t expire_ms;
+    size_t memory;
+    size_t object_key_len;
+    unsigned int refs;
+    int linked;
+    char *cache_key;
+    obs_response_properties properties;
+} metadata_cache_entry;
+
+typedef struct metadata_cache_shard
+{
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_t mutex;
+#else
+    CRITICAL_SECTION mutex;
+#endif
+    metadata_cache_entry **buckets;
+    uint64_t bucket_mask;
+    metadata_cache_entry *lru_head;
+    metadata_cache_entry *lru_tail;
+    uint64_t entry_count;
+    uint64_t memory;
+    uint64_t generation;
+    obs_metadata_cache_stats stats;
+} metadata_cache_shard;
+
+typedef struct metadata_cache
+{
+    obs_metadata_cache_config config;
+    uint64_t shard_mask;
+    uint64_t max_entries_per_shard;
+    uint64_t max_memory_per_shard;
+    metadata_cache_shard *shards;
+} metadata_cache;
+
+static metadata_cache *g_metadata_cache = NULL;
+
+/* 随条目缓存的字符串字段，request_id等与单次响应相关的字段不缓存 */
+static const size_t g_cached_string_fields[] = {
+    offsetof(obs_response_properties, content_type),
+    offsetof(obs_response_properties, etag),
+    offsetof(obs_response_properties, expiration),
+    offsetof(obs_response_properties, website_redirect_location),
+    offsetof(obs_response_properties, version_id),
+    offsetof(obs_response_properties, storage_class),
+    offsetof(obs_response_properties, server_side_encryption),
+    offsetof(obs_response_properties, kms_key_id),
+    offsetof(obs_response_properties, customer_algorithm),
+    offsetof(obs_response_properties, customer_key_md5),
+    offsetof(obs_response_properties, restore),
+    offsetof(obs_response_properties, obs_object_type),
+    offsetof(obs_response_properties, obs_next_append_position),
+    offsetof(obs_response_properties, az_redundancy)
+};
+
+#define CACHED_STRING_FIELD(properties, i) \
+    (*(const char **)((char *)(properties) + g_cached_string_fields[i]))
+
+static uint64_t metadata_cache_now_ms(void)
+{
+#if defined __GNUC__ || defined LINUX
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+#else
+    return (uint64_t)GetTickCount64();
+#endif
+}
+
+static void shard_lock(metadata_cache_shard *shard)
+{
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_lock(&shard->mutex);
+#else
+    EnterCriticalSection(&shard->mutex);
+#endif
+}
+
+static void shard_unlock(metadata_cache_shard *shard)
+{
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_unlock(&shard->mutex);
+#else
+    LeaveCriticalSection(&shard->mutex);
+#endif
+}
+
+static uint64_t metadata_cache_hash(const char *data, size_t len)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    size_t i;
+    for (i = 0; i < len; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static metadata_cache_shard *metadata_cache_get_shard(uint64_t hash)
+{
+    // 分片与桶分别使用哈希的高位与低位
+    return &g_metadata_cache->shards[(hash >> 32) & g_metadata_cache->shard_mask];
+}
+
+/**
+ * 缓存键由对象部分（host/bucket/key，用于分片与失效）和访问者部分（ak/versionId）组成
+ */
+static char *metadata_cache_make_key(const obs_bucket_context *bucket, const char *key, const char *version_id,
+    size_t *object_key_len)
+{
+    const char *host = bucket->host_name ? bucket->host_name : "";
+    const char *bucket_name = bucket->bucket_name ? bucket->bucket_name : "";
+    const char *access_key = bucket->access_key ? bucket->access_key : "";
+    size_t object_len = strlen(host) + strlen(bucket_name) + strlen(key) + 2;
+    size_t total_len = object_len + strlen(access_key) + (version_id ? strlen(version_id) : 0) + 3;
+    char *cache_key = (char *)malloc(total_len);
+    if (cache_key == NULL) {
+        return NULL;
+    }
+    if (snprintf_s(cache_key, total_len, total_len - 1, "%s\n%s\n%s\n%s\n%s", host, bucket_name, key,
+        access_key, version_id ? version_id : "") < 0) {
+        free(cache_key);
+        return NULL;
+    }
+    *object_key_len = object_len;
+    return cache_key;
+}
+
+static void entry_lru_remove(metadata_cache_shard *shard, metadata_cache_entry *entry)
+{
+    if (entry->lru_prev) {
+        entry->lru_prev->lru_next = entry->lru_next;
+    }
+    else {
+        shard->lru_head = entry->lru_next;
+    }
+    if (entry->lru_next) {
+        entry->lru_next->lru_prev = entry->lru_prev;
+    }
+    else {
+        shard->lru_tail = entry->lru_prev;
+    }
+    entry->lru_prev = NULL;
+    entry->lru_next = NULL;
+}
+
+static void entry_lru_push_front(metadata_cache_shard *shard, metadata_cache_entry *entry)
+{
+    entry->lru_prev = NULL;
+    entry->lru_next = shard->lru_head;
+    if (shard->lru_head) {
+        shard->lru_head->lru_prev = entry;
+    }
+    shard->lru_head = entry;
+    if (shard->lru_tail == NULL) {
+        shard->lru_tail = entry;
+    }
+}
+
+/**
+ * 从分片中摘除条目，仍被请求引用的条目在引用释放时再释放内存
+ */
+static void entry_unlink(metadata_cache_shard *shard, metadata_cache_entry *entry)
+{
+    metadata_cache_entry **link = &shard->buckets[entry->hash & shard->bucket_mask];
+    while (*link != NULL && *link != entry) {
+        link = &(*link)->hash_next;
+    }
+    if (*link == entry) {
+        *link = entry->hash_next;
+    }
+    entry->hash_next = NULL;
+    entry_lru_remove(shard, entry);
+    entry->linked = 0;
+    shard->entry_count--;
+    shard->memory -= entry->memory;
+    if (entry->refs == 0) {
+        free(entry);
+    }
+}
+
+static void entry_release(metadata_cache_shard *shard, metadata_cache_entry *entry)
+{
+    shard_lock(shard);
+    entry->refs--;
+    if (!entry->linked && entry->refs == 0) {
+        free(entry);
+    }
+    shard_unlock(shard);
+}
+
+static metadata_cache_entry *shard_find(metadata_cache_shard *shard, uint64_t hash, const char *cache_key)
+{
+    metadata_cache_entry *entry = shard->buckets[hash & shard->bucket_mask];
+    for (; entry != NULL; entry = entry->hash_next) {
+        if (entry->hash == hash && strcmp(entry->cache_key, cache_key) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static void shard_insert(metadata_cache_shard *shard, metadata_cache_entry *entry)
+{
+    metadata_cache_entry *old = shard_find(shard, entry->hash, entry->cache_key);
+    uint64_t index = entry->hash & shard->bucket_mask;
+    if (old != NULL) {
+        entry_unlink(shard, old);
+    }
+    entry->hash_next = shard->buckets[index];
+    shard->buckets[index] = entry;
+    entry->linked = 1;
+    entry_lru_push_front(shard, entry);
+    shard->entry_count++;
+    shard->memory += entry->memory;
+    shard->stats.insertions++;
+
+    while (shard->lru_tail != NULL && shard->lru_tail != entry &&
+        (shard->entry_count > g_metadata_cache->max_entries_per_shard ||
+        (g_metadata_cache->max_memory_per_shard && shard->memory > g_metadata_cache->max_memory_per_shard))) {
+        entry_unlink(shard, shard->lru_tail);
+        shard->stats.evictions++;
+    }
+}
+
+/**
+ * 用响应头构造条目，所有字符串与用户元数据复制到同一块内存中
+ */
+static metadata_cache_entry *entry_create(const metadata_cache_request *cache_request,
+    const obs_response_properties *properties)
+{
+    size_t key_len = strlen(cache_request->cache_key) + 1;
+    size_t memory = sizeof(metadata_cache_entry) + key_len;
+    size_t field_count = sizeof(g_cached_string_fields) / sizeof(g_cached_string_fields[0]);
+    int meta_count = properties->meta_data_count > 0 ? properties->meta_data_count : 0;
+    metadata_cache_entry *entry = NULL;
+    obs_name_value *meta_data = NULL;
+    char *cursor = NULL;
+    size_t i;
+    int j;
+
+    memory += sizeof(obs_name_value) * (size_t)meta_count;
+    for (i = 0; i < field_count; i++) {
+        const char *value = CACHED_STRING_FIELD(properties, i);
+        memory += value ? strlen(value) + 1 : 0;
+    }
+    for (j = 0; j < meta_count; j++) {
+        memory += strlen(properties->meta_data[j].name) + strlen(properties->meta_data[j].value) + 2;
+    }
+
+    entry = (metadata_cache_entry *)malloc(memory);
+    if (entry == NULL) {
+        return NULL;
+    }
+    memset_s(entry, sizeof(metadata_cache_entry), 0, sizeof(metadata_cache_entry));
+    entry->memory = memory;
+    entry->hash = cache_request->hash;
+    entry->object_key_len = cache_request->object_key_len;
+    entry->expire_ms = metadata_cache_now_ms() + g_metadata_cache->config.ttl_ms;
+    entry->properties.content_length = properties->content_length;
+    entry->properties.last_modified = properties->last_modified;
+    entry->properties.use_server_side_encryption = properties->use_server_side_encryption;
+
+    meta_data = (obs_name_value *)(entry + 1);
+    cursor = (char *)(meta_data + meta_count);
+#define COPY_TO_ENTRY(dest, src) do {                                   \
+        size_t len_ = strlen(src) + 1;                                  \
+        memcpy_s(cursor, len_, (src), len_);                            \
+        (dest) = cursor;                                                \
+        cursor += len_;                                                 \
+    } while (0)
+
+    COPY_TO_ENTRY(entry->cache_key, cache_request->cache_key);
+    for (i = 0; i < field_count; i++) {
+        const char *value = CACHED_STRING_FIELD(properties, i);
+        if (value) {
+            COPY_TO_ENTRY(CACHED_STRING_FIELD(&entry->properties, i), value);
+        }
+    }
+    for (j = 0; j < meta_count; j++) {
+        COPY_TO_ENTRY(meta_data[j].name, properties->meta_data[j].name);
+        COPY_TO_ENTRY(meta_data[j].value, properties->meta_data[j].value);
+    }
+#undef COPY_TO_ENTRY
+    entry->properties.meta_data_count = meta_count;
+    entry->properties.meta_data = meta_count ? meta_data : NULL;
+    return entry;
+}
+
+static void metadata_cache_serve(metadata_cache_request *cache_request, metadata_cache_entry *entry)
+{
+    obs_status status = OBS_STATUS_OK;
+    if (cache_request->properties_callback) {
+        status = (*cache_request->properties_callback)(&entry->properties, cache_request->callback_data);
+    }
+    (*cache_request->complete_callback)(status, NULL, cache_request->callback_data);
+}
+
+/************************************************************************************
+ * 包装回调
+ ************************************************************************************/
+static obs_status metadata_cache_properties_callback(const obs_response_properties *properties,
+    void *callback_data)
+{
+    metadata_cache_request *cache_request = (metadata_cache_request *)callback_data;
+
+    if (cache_request->candidate == NULL) {
+        cache_request->candidate = entry_create(cache_request, properties);
+    }
+    if (cache_request->revalidating) {
+        // 304时改用缓存条目回调，结果确定前暂不转发
+        cache_request->pending_properties = properties;
+        return OBS_STATUS_OK;
+    }
+    if (cache_request->properties_callback) {
+        return (*cache_request->properties_callback)(properties, cache_request->callback_data);
+    }
+    return OBS_STATUS_OK;
+}
+
+static obs_status metadata_cache_data_callback(int buffer_size, const char *buffer, void *callback_data)
+{
+    metadata_cache_request *cache_request = (metadata_cache_request *)callback_data;
+    return (*cache_request->data_callback)(buffer_size, buffer, cache_request->callback_data);
+}
+
+static void metadata_cache_complete_callback(obs_status status, const obs_error_details *error,
+    void *callback_data)
+{
+    metadata_cache_request *cache_request = (metadata_cache_request *)callback_data;
+    metadata_cache_shard *shard = metadata_cache_get_shard(cache_request->hash);
+    metadata_cache_entry *stale = cache_request->stale;
+
+    if (cache_request->revalidating) {
+        if (status == OBS_STATUS_HttpErrorNotModified) {
+            shard_lock(shard);
+            if (stale->linked) {
+                stale->expire_ms = metadata_cache_now_ms() + g_metadata_cache->config.ttl_ms;
+                entry_lru_remove(shard, stale);
+                entry_lru_push_front(shard, stale);
+            }
+            shard->stats.not_modified++;
+            shard_unlock(shard);
+            metadata_cache_serve(cache_request, stale);
+            return;
+        }
+        if (cache_request->pending_properties && cache_request->properties_callback) {
+            obs_status properties_status = (*cache_request->properties_callback)(
+                cache_request->pending_properties, cache_request->callback_data);
+            if (status == OBS_STATUS_OK && properties_status != OBS_STATUS_OK) {
+                status = properties_status;
+            }
+        }
+    }
+
+    shard_lock(shard);
+    if (status == OBS_STATUS_OK && cache_request->candidate != NULL &&
+        shard->generation == cache_request->generation) {
+        shard_insert(shard, cache_request->candidate);
+        cache_request->candidate = NULL;
+    }
+    else if (status == OBS_STATUS_HttpErrorNotFound) {
+        metadata_cache_entry *entry = shard_find(shard, cache_request->hash, cache_request->cache_key);
+        if (entry != NULL) {
+            entry_unlink(shard, entry);
+            shard->stats.invalidations++;
+        }
+    }
+    shard_unlock(shard);
+
+    (*cache_request->complete_callback)(status, error, cache_request->callback_data);
+}
+
+/************************************************************************************
+ * 请求接口
+ ************************************************************************************/
+static int metadata_cache_prepare(metadata_cache_request *cache_request, const obs_options *options,
+    const char *key, const char *version_id, obs_response_handler *handler, void *callback_data)
+{
+    memset_s(cache_request, sizeof(metadata_cache_request), 0, sizeof(metadata_cache_request));
+    cache_request->conditions.if_modified_since = -1;
+    cache_request->conditions.if_not_modified_since = -1;
+    if (g_metadata_cache == NULL || key == NULL || key[0] == '\0' || options->temp_auth != NULL) {
+        return 0;
+    }
+    cache_request->cache_key = metadata_cache_make_key(&options->bucket_options, key, version_id, &cache_request->object_key_len);
+    if (cache_request->cache_key == NULL) {
+        return 0;
+    }
+    cache_request->hash = metadata_cache_hash(cache_request->cache_key, cache_request->object_key_len);
+    cache_request->properties_callback = handler->properties_callback;
+    cache_request->complete_callback = handler->complete_callback;
+    cache_request->callback_data = callback_data;
+    cache_request->active = 1;
+    return 1;
+}
+
+int metadata_cache_begin(metadata_cache_request *cache_request, const obs_options *options,
+    const char *key, const char *version_id, obs_response_handler *handler, void *callback_data)
+{
+    metadata_cache_shard *shard = NULL;
+    metadata_cache_entry *entry = NULL;
+
+    if (!metadata_cache_prepare(cache_request, options, key, version_id, handler, callback_data)) {
+        return 0;
+    }
+    shard = metadata_cache_get_shard(cache_request->hash);
+    shard_lock(shard);
+    cache_request->generation = shard->generation;
+    entry = shard_find(shard, cache_request->hash, cache_request->cache_key);
+    if (entry != NULL && metadata_cache_now_ms() < entry->expire_ms) {
+        entry->refs++;
+        entry_lru_remove(shard, entry);
+        entry_lru_push_front(shard, entry);
+        shard->stats.hits++;
+        shard_unlock(shard);
+
+        metadata_cache_serve(cache_request, entry);
+        entry_release(shard, entry);
+        metadata_cache_end(cache_request);
+        return 1;
+    }
+    shard->stats.misses++;
+    if (entry != NULL && g_metadata_cache->config.revalidate && entry->properties.etag != NULL) {
+        entry->refs++;
+        cache_request->stale = entry;
+        cache_request->revalidating = 1;
+        cache_request->conditions.if_not_match_etag = (char *)entry->properties.etag;
+        shard->stats.revalidations++;
+    }
+    else if (entry != NULL) {
+        entry_unlink(shard, entry);
+        shard->stats.expirations++;
+    }
+    shard_unlock(shard);
+    return 0;
+}
+
+void metadata_cache_begin_populate(metadata_cache_request *cache_request, const obs_options *options,
+    const char *key, const char *version_id, obs_response_handler *handler, void *callback_data)
+{
+    metadata_cache_shard *shard = NULL;
+    if (!metadata_cache_prepare(cache_request, options, key, version_id, handler, callback_data)) {
+        return;
+    }
+    shard = metadata_cache_get_shard(cache_request->hash);
+    shard_lock(shard);
+    cache_request->generation = shard->generation;
+    shard_unlock(shard);
+}
+
+void metadata_cache_wrap_params(metadata_cache_request *cache_request, request_params *params)
+{
+    if (!cache_request->active) {
+        return;
+    }
+    params->properties_callback = &metadata_cache_properties_callback;
+    params->complete_callback = &metadata_cache_complete_callback;
+    if (params->fromObsCallback) {
+        cache_request->data_callback = params->fromObsCallback;
+        params->fromObsCallback = &metadata_cache_data_callback;
+    }
+    params->callback_data = cache_request;
+    if (cache_request->revalidating) {
+        params->get_conditions = &cache_request->conditions;
+    }
+}
+
+void metadata_cache_end(metadata_cache_request *cache_request)
+{
+    if (cache_request->stale != NULL) {
+        entry_release(metadata_cache_get_shard(cache_request->hash), cache_request->stale);
+        cache_request->stale = NULL;
+    }
+    CHECK_NULL_FREE(cache_request->candidate);
+    CHECK_NULL_FREE(cache_request->cache_key);
+    cache_request->active = 0;
+}
+
+void metadata_cache_invalidate_object(const obs_bucket_context *bucket, const char *key)
+{
+    metadata_cache_shard *shard = NULL;
+    metadata_cache_entry *entry = NULL;
+    char *cache_key = NULL;
+    size_t object_key_len = 0;
+    uint64_t hash;
+
+    if (g_metadata_cache == NULL || bucket == NULL || key == NULL) {
+        return;
+    }
+    cache_key = metadata_cache_make_key(bucket, key, NULL, &object_key_len);
+    if (cache_key == NULL) {
+        return;
+    }
+    hash = metadata_cache_hash(cache_key, object_key_len);
+    shard = metadata_cache_get_shard(hash);
+
+    shard_lock(shard);
+    // 递增代数，使失效前已发出的请求不再写入旧数据
+    shard->generation++;
+    entry = shard->buckets[hash & shard->bucket_mask];
+    while (entry != NULL) {
+        metadata_cache_entry *next = entry->hash_next;
+        if (entry->hash == hash && entry->object_key_len == object_key_len &&
+            strncmp(entry->cache_key, cache_key, object_key_len) == 0) {
+            entry_unlink(shard, entry);
+            shard->stats.invalidations++;
+        }
+        entry = next;
+    }
+    shard_unlock(shard);
+    free(cache_key);
+}
+
+/************************************************************************************
+ * 公共接口
+ ************************************************************************************/
+static void metadata_cache_free(metadata_cache *cache, uint64_t shard_count)
+{
+    uint64_t i;
+    uint64_t j;
+    for (i = 0; i < shard_count; i++) {
+        metadata_cache_shard *shard = &cache->shards[i];
+        if (shard->buckets) {
+            for (j = 0; j <= shard->bucket_mask; j++) {
+                metadata_cache_entry *entry = shard->buckets[j];
+                while (entry) {
+                    metadata_cache_entry *next = entry->hash_next;
+                    free(entry);
+                    entry = next;
+                }
+            }
+            free(shard->buckets);
+        }
+#if defined __GNUC__ || defined LINUX
+        pthread_mutex_destroy(&shard->mutex);
+#else
+        DeleteCriticalSection(&shard->mutex);
+#endif
+    }
+    free(cache->shards);
+    free(cache);
+}
+
+void init_metadata_cache_config(obs_metadata_cache_config *config)
+{
+    memset_s(config, sizeof(obs_metadata_cache_config), 0, sizeof(obs_metadata_cache_config));
+    config->shard_count = METADATA_CACHE_DEFAULT_SHARDS;
+    config->max_entries = METADATA_CACHE_DEFAULT_ENTRIES;
+    config->ttl_ms = METADATA_CACHE_DEFAULT_TTL_MS;
+    config->revalidate = 1;
+}
+
+obs_status obs_metadata_cache_enable(const obs_metadata_cache_config *config)
+{
+    metadata_cache *cache = NULL;
+    uint64_t shard_count = 1;
+    uint64_t bucket_count = METADATA_CACHE_MIN_BUCKETS;
+    uint64_t i;
+
+    if (config == NULL || config->max_entries == 0 || config->ttl_ms == 0) {
+        COMMLOG(OBS_LOGERROR, "%s: invalid metadata cache config", __FUNCTION__);
+        return OBS_STATUS_InvalidParameter;
+    }
+    while (shard_count < config->shard_count && shard_count < METADATA_CACHE_MAX_SHARDS) {
+        shard_count <<= 1;
+    }
+    if (shard_count > config->max_entries) {
+        shard_count = 1;
+    }
+
+    cache = (metadata_cache *)malloc(sizeof(metadata_cache));
+    if (cache == NULL) {
+        return OBS_STATUS_OutOfMemory;
+    }
+    memset_s(cache, sizeof(metadata_cache), 0, sizeof(metadata_cache));
+    cache->config = *config;
+    cache->shard_mask = shard_count - 1;
+    cache->max_entries_per_shard = (config->max_entries + shard_count - 1) / shard_count;
+    cache->max_memory_per_shard = config->max_memory ? (config->max_memory + shard_count - 1) / shard_count : 0;
+    while (bucket_count < cache->max_entries_per_shard) {
+        bucket_count <<= 1;
+    }
+
+    cache->shards = (metadata_cache_shard *)calloc((size_t)shard_count, sizeof(metadata_cache_shard));
+    if (cache->shards == NULL) {
+        free(cache);
+        return OBS_STATUS_OutOfMemory;
+    }
+    for (i = 0; i < shard_count; i++) {
+        metadata_cache_shard *shard = &cache->shards[i];
+#if defined __GNUC__ || defined LINUX
+        pthread_mutex_init(&shard->mutex, NULL);
+#else
+        InitializeCriticalSection(&shard->mutex);
+#endif
+        shard->bucket_mask = bucket_count - 1;
+        shard->buckets = (metadata_cache_entry **)calloc((size_t)bucket_count, sizeof(metadata_cache_entry *));
+        if (shard->buckets == NULL) {
+            metadata_cache_free(cache, i + 1);
+            return OBS_STATUS_OutOfMemory;
+        }
+    }
+
+    obs_metadata_cache_disable();
+    g_metadata_cache = cache;
+    COMMLOG(OBS_LOGINFO, "%s: shards %llu, max entries %llu, ttl %u ms", __FUNCTION__,
+        (unsigned long long)shard_count, (unsigned long long)config->max_entries, config->ttl_ms);
+    return OBS_STATUS_OK;
+}
+
+void obs_metadata_cache_disable(void)
+{
+    metadata_cache *cache = g_metadata_cache;
+    if (cache == NULL) {
+        return;
+    }
+    g_metadata_cache = NULL;
+    metadata_cache_free(cache, cache->shard_mask + 1);
+}
+
+void obs_metadata_cache_invalidate(const obs_options *options, const char *key)
+{
+    if (options != NULL) {
+        metadata_cache_invalidate_object(&options->bucket_options, key);
+    }
+}
+
+void obs_metadata_cache_get_stats(obs_metadata_cache_stats *stats)
+{
+    uint64_t i;
+    if (stats == NULL) {
+        return;
+    }
+    memset_s(stats, sizeof(obs_metadata_cache_stats), 0, sizeof(obs_metadata_cache_stats));
+    if (g_metadata_cache == NULL) {
+        return;
+    }
+    for (i = 0; i <= g_metadata_cache->shard_mask; i++) {
+        metadata_cache_shard *shard = &g_metadata_cache->shards[i];
+        shard_lock(shard);
+        stats->hits += shard->stats.hits;
+        stats->misses += shard->stats.misses;
+        stats->revalidations += shard->stats.revalidations;
+        stats->not_modified += shard->stats.not_modified;
+        stats->insertions += shard->stats.insertions;
+        stats->evictions += shard->stats.evictions;
+        stats->expirations += shard->stats.expirations;
+        stats->invalidations += shard->stats.invalidations;
+        stats->entries += shard->entry_count;
+        stats->memory += shard->memory;
+        shard_unlock(shard);
+    }
+}
+
+void metadata_cache_deinitialize(void)
+{
+    obs_metadata_cache_disable();
+}
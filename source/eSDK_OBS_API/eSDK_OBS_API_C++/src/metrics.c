@@ -0,0 +1,731 @@
+/*********************************************************************************
+* Copyright 2024 Huawei Technologies Co.,Ltd.
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+* this file except in compliance with the License.  You may obtain a copy of the
+* License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed
+* under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+* CONDITIONS OF ANY KIND, either express or implied.  See the License for the
+* specific language governing permissions and limitations under the License.
+**********************************************************************************
+*/
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <curl/curl.h>
+#include "metrics.h"
+#include "securec.h"
+#include "log.h"
+
+#if defined __GNUC__ || defined LINUX
+#include <pthread.h>
+#else
+#include <windows.h>
+#endif
+
+#define METRICS_SUB_BUCKET_BITS     2
+#define METRICS_SUB_BUCKETS         (1 << METRICS_SUB_BUCKET_BITS)
+#define METRICS_MAX_MAJOR           36
+#define METRICS_LINE_SIZE           512
+/* Prometheus输出的le边界取2^k微秒，k在此范围内（约1ms~134s） */
+#define METRICS_PROM_MIN_MAJOR      9
+#define METRICS_PROM_MAX_MAJOR      26
+
+/**
+ * 计数器只由所属线程写入，读取快照的线程只读，单写者下无需加锁的原子指令
+ */
+#if defined __GNUC__ || defined LINUX
+#define METRICS_LOAD(field) __atomic_load_n(&(field), __ATOMIC_RELAXED)
+#define METRICS_ADD(field, value) \
+    __atomic_store_n(&(field), __atomic_load_n(&(field), __ATOMIC_RELAXED) + (value), __ATOMIC_RELAXED)
+#define METRICS_STORE(field, value) __atomic_store_n(&(field), (value), __ATOMIC_RELAXED)
+#else
+#define METRICS_LOAD(field) (*(volatile uint64_t *)&(field))
+#define METRICS_ADD(field, value) (*(volatile uint64_t *)&(field) += (value))
+#define METRICS_STORE(field, value) (*(volatile uint64_t *)&(field) = (value))
+#endif
+
+typedef struct metrics_thread_slot
+{
+    struct metrics_thread_slot *prev;
+    struct metrics_thread_slot *next;
+    obs_metrics_snapshot counters;
+    unsigned int retry;                       // 上层重试循环设置的当前重试序号
+} metrics_thread_slot;
+
+volatile int g_metrics_enabled = 0;
+obs_request_trace_callback *volatile g_request_trace_callback = NULL;
+static void *volatile g_request_trace_callback_data = NULL;
+static int g_metrics_initialized = 0;
+static metrics_thread_slot *g_metrics_slots = NULL;
+/* 已退出线程的计数器合并到这里 */
+static obs_metrics_snapshot g_metrics_retired;
+
+#if defined __GNUC__ || defined LINUX
+static pthread_mutex_t g_metrics_mutex;
+static pthread_key_t g_metrics_key;
+#else
+static CRITICAL_SECTION g_metrics_mutex;
+static DWORD g_metrics_key = FLS_OUT_OF_INDEXES;
+#endif
+
+static const char *g_metrics_operation_names[OBS_METRICS_OP_BUTT] = {
+    "get_object",
+    "head_object",
+    "put_object",
+    "copy_object",
+    "append_object",
+    "delete_object",
+    "batch_delete",
+    "initiate_multipart",
+    "upload_part",
+    "complete_multipart",
+    "abort_multipart",
+    "list_parts",
+    "list_objects",
+    "list_versions",
+    "list_multipart_uploads",
+    "list_buckets",
+    "create_bucket",
+    "head_bucket",
+    "delete_bucket",
+    "options",
+    "object_other",
+    "bucket_other"
+};
+
+static void metrics_lock(void)
+{
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_lock(&g_metrics_mutex);
+#else
+    EnterCriticalSection(&g_metrics_mutex);
+#endif
+}
+
+static void metrics_unlock(void)
+{
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_unlock(&g_metrics_mutex);
+#else
+    LeaveCriticalSection(&g_metrics_mutex);
+#endif
+}
+
+/**
+ * 将src累加到dst，max_us取较大值；src可能正被所属线程写入，逐字段原子读取
+ */
+static void metrics_merge(obs_metrics_snapshot *dst, obs_metrics_snapshot *src)
+{
+    uint64_t *dst_words = (uint64_t *)dst;
+    uint64_t *src_words = (uint64_t *)src;
+    size_t word_count = sizeof(obs_metrics_snapshot) / sizeof(uint64_t);
+    uint64_t dst_max[OBS_METRICS_OP_BUTT];
+    size_t i;
+
+    for (i = 0; i < OBS_METRICS_OP_BUTT; i++) {
+        dst_max[i] = dst->operations[i].latency.max_us;
+    }
+    for (i = 0; i < word_count; i++) {
+        dst_words[i] += METRICS_LOAD(src_words[i]);
+    }
+    for (i = 0; i < OBS_METRICS_OP_BUTT; i++) {
+        uint64_t src_max = METRICS_LOAD(src->operations[i].latency.max_us);
+        dst->operations[i].latency.max_us = dst_max[i] > src_max ? dst_max[i] : src_max;
+    }
+}
+
+#if defined __GNUC__ || defined LINUX
+static void metrics_thread_exit(void *data)
+#else
+static VOID WINAPI metrics_thread_exit(PVOID data)
+#endif
+{
+    metrics_thread_slot *slot = (metrics_thread_slot *)data;
+    if (slot == NULL) {
+        return;
+    }
+    metrics_lock();
+    metrics_merge(&g_metrics_retired, &slot->counters);
+    if (slot->prev) {
+        slot->prev->next = slot->next;
+    }
+    else {
+        g_metrics_slots = slot->next;
+    }
+    if (slot->next) {
+        slot->next->prev = slot->prev;
+    }
+    metrics_unlock();
+    free(slot);
+}
+
+void metrics_initialize(void)
+{
+    if (g_metrics_initialized) {
+        return;
+    }
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_init(&g_metrics_mutex, NULL);
+    if (pthread_key_create(&g_metrics_key, metrics_thread_exit) != 0) {
+        COMMLOG(OBS_LOGERROR, "%s pthread_key_create failed", __FUNCTION__);
+        pthread_mutex_destroy(&g_metrics_mutex);
+        return;
+    }
+#else
+    InitializeCriticalSection(&g_metrics_mutex);
+    g_metrics_key = FlsAlloc(metrics_thread_exit);
+    if (g_metrics_key == FLS_OUT_OF_INDEXES) {
+        COMMLOG(OBS_LOGERROR, "%s FlsAlloc failed", __FUNCTION__);
+        DeleteCriticalSection(&g_metrics_mutex);
+        return;
+    }
+#endif
+    memset_s(&g_metrics_retired, sizeof(g_metrics_retired), 0, sizeof(g_metrics_retired));
+    g_metrics_initialized = 1;
+}
+
+/**
+ * 取当前线程的槽位，首次使用时分配并登记到全局链表
+ */
+static metrics_thread_slot *metrics_thread_slot_get(void)
+{
+    metrics_thread_slot *slot = NULL;
+    if (!g_metrics_initialized) {
+        return NULL;
+    }
+#if defined __GNUC__ || defined LINUX
+    slot = (metrics_thread_slot *)pthread_getspecific(g_metrics_key);
+#else
+    slot = (metrics_thread_slot *)FlsGetValue(g_metrics_key);
+#endif
+    if (slot != NULL) {
+        return slot;
+    }
+    slot = (metrics_thread_slot *)malloc(sizeof(metrics_thread_slot));
+    if (slot == NULL) {
+        COMMLOG(OBS_LOGERROR, "%s malloc failed", __FUNCTION__);
+        return NULL;
+    }
+    memset_s(slot, sizeof(metrics_thread_slot), 0, sizeof(metrics_thread_slot));
+#if defined __GNUC__ || defined LINUX
+    if (pthread_setspecific(g_metrics_key, slot) != 0) {
+        free(slot);
+        return NULL;
+    }
+#else
+    if (!FlsSetValue(g_metrics_key, slot)) {
+        free(slot);
+        return NULL;
+    }
+#endif
+    metrics_lock();
+    slot->next = g_metrics_slots;
+    if (g_metrics_slots) {
+        g_metrics_slots->prev = slot;
+    }
+    g_metrics_slots = slot;
+    metrics_unlock();
+    return slot;
+}
+
+static obs_metrics_snapshot *metrics_thread_counters(void)
+{
+    metrics_thread_slot *slot = metrics_thread_slot_get();
+    return slot ? &slot->counters : NULL;
+}
+
+static int metrics_major(uint64_t value)
+{
+#if defined __GNUC__ || defined LINUX
+    return 63 - __builtin_clzll(value);
+#else
+    int major = 0;
+    while (value >>= 1) {
+        major++;
+    }
+    return major;
+#endif
+}
+
+static int metrics_bucket_index(uint64_t value_us)
+{
+    int major;
+    if (value_us < METRICS_SUB_BUCKETS) {
+        return (int)value_us;
+    }
+    major = metrics_major(value_us);
+    if (major > METRICS_MAX_MAJOR) {
+        return OBS_METRICS_HISTOGRAM_BUCKETS - 1;
+    }
+    return METRICS_SUB_BUCKETS + (major - METRICS_SUB_BUCKET_BITS) * METRICS_SUB_BUCKETS +
+        (int)((value_us >> (major - METRICS_SUB_BUCKET_BITS)) & (METRICS_SUB_BUCKETS - 1));
+}
+
+/**
+ * 桶的上界（不含）
+ */
+static uint64_t metrics_bucket_upper(int index)
+{
+    int major;
+    int sub;
+    if (index < METRICS_SUB_BUCKETS) {
+        return (uint64_t)index + 1;
+    }
+    major = (index - METRICS_SUB_BUCKETS) / METRICS_SUB_BUCKETS + METRICS_SUB_BUCKET_BITS;
+    sub = (index - METRICS_SUB_BUCKETS) % METRICS_SUB_BUCKETS;
+    return (uint64_t)(METRICS_SUB_BUCKETS + sub + 1) << (major - METRICS_SUB_BUCKET_BITS);
+}
+
+static int metrics_query_has(const char *query, const char *name)
+{
+    size_t len = strlen(name);
+    const char *p = query;
+    while (p && *p) {
+        if (!strncmp(p, name, len) && (p[len] == '=' || p[len] == '&' || p[len] == '\0')) {
+            return 1;
+        }
+        p = strchr(p, '&');
+        if (p) {
+            p++;
+        }
+    }
+    return 0;
+}
+
+obs_metrics_operation metrics_classify_operation(const request_params *params)
+{
+    const char *sub = params->subResource;
+    const char *query = params->queryParams;
+    int plain = (sub == NULL || sub[0] == '\0');
+
+    if (params->httpRequestType == http_request_type_options) {
+        return OBS_METRICS_OP_OPTIONS;
+    }
+    if (params->key && params->key[0]) {
+        switch (params->httpRequestType) {
+            case http_request_type_get:
+                if (metrics_query_has(query, "uploadId")) {
+                    return OBS_METRICS_OP_LIST_PARTS;
+                }
+                return plain ? OBS_METRICS_OP_GET_OBJECT : OBS_METRICS_OP_OBJECT_OTHER;
+            case http_request_type_head:
+                return OBS_METRICS_OP_HEAD_OBJECT;
+            case http_request_type_put:
+                if (metrics_query_has(query, "partNumber")) {
+                    return OBS_METRICS_OP_UPLOAD_PART;
+                }
+                return plain ? OBS_METRICS_OP_PUT_OBJECT : OBS_METRICS_OP_OBJECT_OTHER;
+            case http_request_type_copy:
+                if (metrics_query_has(query, "partNumber")) {
+                    return OBS_METRICS_OP_UPLOAD_PART;
+                }
+                return plain ? OBS_METRICS_OP_COPY_OBJECT : OBS_METRICS_OP_OBJECT_OTHER;
+            case http_request_type_delete:
+                if (metrics_query_has(query, "uploadId")) {
+                    return OBS_METRICS_OP_ABORT_MULTIPART;
+                }
+                return plain ? OBS_METRICS_OP_DELETE_OBJECT : OBS_METRICS_OP_OBJECT_OTHER;
+            case http_request_type_post:
+                if (!plain && !strcmp(sub, "uploads")) {
+                    return OBS_METRICS_OP_INITIATE_MULTIPART;
+                }
+                if (!plain && !strcmp(sub, "append")) {
+                    return OBS_METRICS_OP_APPEND_OBJECT;
+                }
+                if (metrics_query_has(query, "uploadId")) {
+                    return OBS_METRICS_OP_COMPLETE_MULTIPART;
+                }
+                return OBS_METRICS_OP_OBJECT_OTHER;
+            default:
+                return OBS_METRICS_OP_OBJECT_OTHER;
+        }
+    }
+    if (params->bucketContext.bucket_name == NULL || params->bucketContext.bucket_name[0] == '\0') {
+        return params->httpRequestType == http_request_type_get ?
+            OBS_METRICS_OP_LIST_BUCKETS : OBS_METRICS_OP_BUCKET_OTHER;
+    }
+    switch (params->httpRequestType) {
+        case http_request_type_get:
+            if (plain) {
+                return OBS_METRICS_OP_LIST_OBJECTS;
+            }
+            if (!strcmp(sub, "versions")) {
+                return OBS_METRICS_OP_LIST_VERSIONS;
+            }
+            if (!strcmp(sub, "uploads")) {
+                return OBS_METRICS_OP_LIST_MULTIPART_UPLOADS;
+            }
+            return OBS_METRICS_OP_BUCKET_OTHER;
+        case http_request_type_head:
+            return OBS_METRICS_OP_HEAD_BUCKET;
+        case http_request_type_put:
+            return plain ? OBS_METRICS_OP_CREATE_BUCKET : OBS_METRICS_OP_BUCKET_OTHER;
+        case http_request_type_delete:
+            return plain ? OBS_METRICS_OP_DELETE_BUCKET : OBS_METRICS_OP_BUCKET_OTHER;
+        case http_request_type_post:
+            return (!plain && !strcmp(sub, "delete")) ? OBS_METRICS_OP_BATCH_DELETE : OBS_METRICS_OP_BUCKET_OTHER;
+        default:
+            return OBS_METRICS_OP_BUCKET_OTHER;
+    }
+}
+
+void metrics_record_handle_pool(int hit)
+{
+    obs_metrics_snapshot *counters = NULL;
+    if (!g_metrics_enabled || (counters = metrics_thread_counters()) == NULL) {
+        return;
+    }
+    if (hit) {
+        METRICS_ADD(counters->handle_pool_hits, 1);
+    }
+    else {
+        METRICS_ADD(counters->handle_pool_misses, 1);
+    }
+}
+
+void metrics_record_retry(int operation)
+{
+    obs_metrics_snapshot *counters = NULL;
+    if (!g_metrics_enabled || operation < 0 || operation >= OBS_METRICS_OP_BUTT ||
+        (counters = metrics_thread_counters()) == NULL) {
+        return;
+    }
+    METRICS_ADD(counters->operations[operation].retries, 1);
+}
+
+void metrics_set_retry(int operation, unsigned int retry)
+{
+    metrics_thread_slot *slot = NULL;
+    if (!metrics_collecting() || (slot = metrics_thread_slot_get()) == NULL) {
+        return;
+    }
+    slot->retry = retry;
+    if (retry > 0) {
+        metrics_record_retry(operation);
+    }
+}
+
+int metrics_current_retry(void)
+{
+    metrics_thread_slot *slot = NULL;
+    if (!metrics_collecting() || (slot = metrics_thread_slot_get()) == NULL) {
+        return 0;
+    }
+    return (int)slot->retry;
+}
+
+static void metrics_fill_trace(http_request *request, obs_request_trace *trace)
+{
+    curl_off_t value = 0;
+    long header_size = 0;
+    memset_s(trace, sizeof(obs_request_trace), 0, sizeof(obs_request_trace));
+    trace->operation = (obs_metrics_operation)request->metrics_op;
+    trace->status = request->status;
+    trace->http_code = request->httpResponseCode;
+    trace->retry_count = request->retry_count;
+    trace->request_id = request->responseHeadersHandler.responseProperties.request_id ?
+        request->responseHeadersHandler.responseProperties.request_id : "";
+    trace->uri = request->uri;
+    if (request->curl == NULL) {
+        return;
+    }
+    if (curl_easy_getinfo(request->curl, CURLINFO_NAMELOOKUP_TIME_T, &value) == CURLE_OK) {
+        trace->namelookup_us = value;
+    }
+    if (curl_easy_getinfo(request->curl, CURLINFO_CONNECT_TIME_T, &value) == CURLE_OK) {
+        trace->connect_us = value;
+    }
+    if (curl_easy_getinfo(request->curl, CURLINFO_APPCONNECT_TIME_T, &value) == CURLE_OK) {
+        trace->appconnect_us = value;
+    }
+    if (curl_easy_getinfo(request->curl, CURLINFO_PRETRANSFER_TIME_T, &value) == CURLE_OK) {
+        trace->pretransfer_us = value;
+    }
+    if (curl_easy_getinfo(request->curl, CURLINFO_STARTTRANSFER_TIME_T, &value) == CURLE_OK) {
+        trace->starttransfer_us = value;
+    }
+    if (curl_easy_getinfo(request->curl, CURLINFO_TOTAL_TIME_T, &value) == CURLE_OK && value > 0) {
+        trace->total_us = value;
+    }
+    if (curl_easy_getinfo(request->curl, CURLINFO_SIZE_UPLOAD_T, &value) == CURLE_OK && value > 0) {
+        trace->bytes_sent = (uint64_t)value;
+    }
+    if (curl_easy_getinfo(request->curl, CURLINFO_SIZE_DOWNLOAD_T, &value) == CURLE_OK && value > 0) {
+        trace->bytes_received = (uint64_t)value;
+    }
+    if (curl_easy_getinfo(request->curl, CURLINFO_HEADER_SIZE, &header_size) == CURLE_OK && header_size > 0) {
+        trace->header_bytes_received = (uint64_t)header_size;
+    }
+    (void)curl_easy_getinfo(request->curl, CURLINFO_NUM_CONNECTS, &trace->new_connections);
+}
+
+static void metrics_count_request(obs_metrics_snapshot *counters, const obs_request_trace *trace)
+{
+    obs_metrics_operation_stats *op = &counters->operations[trace->operation];
+    int code = trace->http_code;
+    uint64_t total_us = (uint64_t)trace->total_us;
+
+    METRICS_ADD(op->requests, 1);
+    if (trace->status != OBS_STATUS_OK) {
+        METRICS_ADD(op->errors, 1);
+    }
+    METRICS_ADD(op->bytes_sent, trace->bytes_sent);
+    METRICS_ADD(op->bytes_received, trace->bytes_received);
+    METRICS_ADD(op->latency.count, 1);
+    METRICS_ADD(op->latency.sum_us, total_us);
+    METRICS_ADD(op->latency.buckets[metrics_bucket_index(total_us)], 1);
+    if (total_us > op->latency.max_us) {
+        METRICS_STORE(op->latency.max_us, total_us);
+    }
+
+    METRICS_ADD(counters->http_code_count[(code > 0 && code < OBS_METRICS_HTTP_CODE_MAX) ? code : 0], 1);
+    if ((int)trace->status >= 0 && trace->status < OBS_STATUS_BUTT) {
+        METRICS_ADD(counters->status_count[trace->status], 1);
+    }
+    if (trace->new_connections > 0) {
+        METRICS_ADD(counters->connections_created, (uint64_t)trace->new_connections);
+    }
+    else if (code > 0) {
+        METRICS_ADD(counters->connections_reused, 1);
+    }
+}
+
+void metrics_record_request(http_request *request)
+{
+    obs_request_trace trace;
+    obs_request_trace_callback *callback = g_request_trace_callback;
+    obs_metrics_snapshot *counters = NULL;
+
+    if (request->metrics_op < 0 || request->metrics_op >= OBS_METRICS_OP_BUTT ||
+        (!g_metrics_enabled && callback == NULL)) {
+        return;
+    }
+    metrics_fill_trace(request, &trace);
+    if (g_metrics_enabled && (counters = metrics_thread_counters()) != NULL) {
+        metrics_count_request(counters, &trace);
+    }
+    if (callback) {
+        callback(&trace, g_request_trace_callback_data);
+    }
+}
+
+void obs_metrics_enable(int enable)
+{
+    g_metrics_enabled = enable ? 1 : 0;
+}
+
+void obs_set_request_trace_callback(obs_request_trace_callback *callback, void *callback_data)
+{
+    g_request_trace_callback_data = callback_data;
+    g_request_trace_callback = callback;
+}
+
+void obs_get_metrics_snapshot(obs_metrics_snapshot *snapshot)
+{
+    metrics_thread_slot *slot = NULL;
+    if (snapshot == NULL) {
+        return;
+    }
+    memset_s(snapshot, sizeof(obs_metrics_snapshot), 0, sizeof(obs_metrics_snapshot));
+    if (!g_metrics_initialized) {
+        return;
+    }
+    metrics_lock();
+    metrics_merge(snapshot, &g_metrics_retired);
+    for (slot = g_metrics_slots; slot != NULL; slot = slot->next) {
+        metrics_merge(snapshot, &slot->counters);
+    }
+    metrics_unlock();
+}
+
+uint64_t obs_metrics_histogram_percentile(const obs_metrics_histogram *histogram, double percentile)
+{
+    uint64_t rank;
+    uint64_t seen = 0;
+    uint64_t upper;
+    int i;
+    if (histogram == NULL || histogram->count == 0) {
+        return 0;
+    }
+    if (percentile < 0) {
+        percentile = 0;
+    }
+    if (percentile > 100) {
+        percentile = 100;
+    }
+    rank = (uint64_t)(percentile / 100.0 * (double)histogram->count + 0.5);
+    if (rank == 0) {
+        rank = 1;
+    }
+    for (i = 0; i < OBS_METRICS_HISTOGRAM_BUCKETS; i++) {
+        seen += histogram->buckets[i];
+        if (seen >= rank) {
+            // 取桶内可能的最大值，不超过实际观测到的最大值
+            upper = metrics_bucket_upper(i) - 1;
+            return upper < histogram->max_us ? upper : histogram->max_us;
+        }
+    }
+    return histogram->max_us;
+}
+
+const char *obs_metrics_operation_name(obs_metrics_operation operation)
+{
+    if ((int)operation < 0 || operation >= OBS_METRICS_OP_BUTT) {
+        return "unknown";
+    }
+    return g_metrics_operation_names[operation];
+}
+
+typedef struct metrics_writer
+{
+    char *buffer;
+    int buffer_size;
+    int length;
+    int truncated;                            // 已有一行写不下，之后的行都不再写入
+} metrics_writer;
+
+/**
+ * 追加一行输出；缓冲区不足时只累计长度，以便调用方得到所需大小，
+ * 已写入的内容始终是完整输出的前若干整行
+ */
+static void metrics_write(metrics_writer *writer, const char *format, ...)
+{
+    char line[METRICS_LINE_SIZE];
+    va_list args;
+    int len;
+    va_start(args, format);
+    len = vsnprintf_s(line, sizeof(line), _TRUNCATE, format, args);
+    va_end(args);
+    if (len <= 0) {
+        return;
+    }
+    if (writer->buffer && !writer->truncated) {
+        int copy = len;
+        if (writer->length + len >= writer->buffer_size) {
+            // 一次写入可能含多行，写下其中放得下的整行后停止
+            writer->truncated = 1;
+            copy = writer->buffer_size - writer->length - 1;
+            while (copy > 0 && line[copy - 1] != '\n') {
+                copy--;
+            }
+        }
+        if (copy > 0 &&
+            memcpy_s(writer->buffer + writer->length, writer->buffer_size - writer->length, line, copy) == EOK) {
+            writer->buffer[writer->length + copy] = '\0';
+        }
+    }
+    writer->length += len;
+}
+
+static void metrics_write_histogram(metrics_writer *writer, const char *name, const obs_metrics_histogram *h)
+{
+    uint64_t cumulative = 0;
+    int bucket = 0;
+    int major;
+    for (major = METRICS_PROM_MIN_MAJOR; major <= METRICS_PROM_MAX_MAJOR; major++) {
+        // 2^(major+1)微秒对应的最后一个桶
+        int last = METRICS_SUB_BUCKETS + (major - METRICS_SUB_BUCKET_BITS) * METRICS_SUB_BUCKETS +
+            METRICS_SUB_BUCKETS - 1;
+        for (; bucket <= last; bucket++) {
+            cumulative += h->buckets[bucket];
+        }
+        metrics_write(writer, "obs_sdk_request_duration_seconds_bucket{op=\"%s\",le=\"%.6f\"} %llu\n",
+            name, (double)((uint64_t)1 << (major + 1)) / 1000000.0, (unsigned long long)cumulative);
+    }
+    metrics_write(writer, "obs_sdk_request_duration_seconds_bucket{op=\"%s\",le=\"+Inf\"} %llu\n",
+        name, (unsigned long long)h->count);
+    metrics_write(writer, "obs_sdk_request_duration_seconds_sum{op=\"%s\"} %.6f\n",
+        name, (double)h->sum_us / 1000000.0);
+    metrics_write(writer, "obs_sdk_request_duration_seconds_count{op=\"%s\"} %llu\n",
+        name, (unsigned long long)h->count);
+}
+
+static void metrics_write_op_counter(metrics_writer *writer, const obs_metrics_snapshot *snapshot,
+    const char *metric, const char *help, size_t offset)
+{
+    int i;
+    metrics_write(writer, "# HELP %s %s\n# TYPE %s counter\n", metric, help, metric);
+    for (i = 0; i < OBS_METRICS_OP_BUTT; i++) {
+        const obs_metrics_operation_stats *op = &snapshot->operations[i];
+        if (op->requests == 0) {
+            continue;
+        }
+        metrics_write(writer, "%s{op=\"%s\"} %llu\n", metric, g_metrics_operation_names[i],
+            (unsigned long long)*(const uint64_t *)((const char *)op + offset));
+    }
+}
+
+int obs_metrics_export_prometheus(char *buffer, int buffer_size)
+{
+    obs_metrics_snapshot *snapshot = NULL;
+    metrics_writer writer;
+    int i;
+
+    writer.buffer = (buffer_size > 0) ? buffer : NULL;
+    writer.buffer_size = buffer_size;
+    writer.length = 0;
+    writer.truncated = 0;
+    if (writer.buffer) {
+        writer.buffer[0] = '\0';
+    }
+    snapshot = (obs_metrics_snapshot *)malloc(sizeof(obs_metrics_snapshot));
+    if (snapshot == NULL) {
+        COMMLOG(OBS_LOGERROR, "%s malloc failed", __FUNCTION__);
+        return -1;
+    }
+    obs_get_metrics_snapshot(snapshot);
+
+    metrics_write_op_counter(&writer, snapshot, "obs_sdk_requests_total", "HTTP requests sent, per attempt.",
+        offsetof(obs_metrics_operation_stats, requests));
+    metrics_write_op_counter(&writer, snapshot, "obs_sdk_request_errors_total", "Requests that ended with an error.",
+        offsetof(obs_metrics_operation_stats, errors));
+    metrics_write_op_counter(&writer, snapshot, "obs_sdk_request_retries_total", "Requests retried by the SDK.",
+        offsetof(obs_metrics_operation_stats, retries));
+    metrics_write_op_counter(&writer, snapshot, "obs_sdk_sent_bytes_total", "Request body bytes sent.",
+        offsetof(obs_metrics_operation_stats, bytes_sent));
+    metrics_write_op_counter(&writer, snapshot, "obs_sdk_received_bytes_total", "Response body bytes received.",
+        offsetof(obs_metrics_operation_stats, bytes_received));
+
+    metrics_write(&writer, "# HELP obs_sdk_request_duration_seconds Request transfer time.\n"
+        "# TYPE obs_sdk_request_duration_seconds histogram\n");
+    for (i = 0; i < OBS_METRICS_OP_BUTT; i++) {
+        if (snapshot->operations[i].requests) {
+            metrics_write_histogram(&writer, g_metrics_operation_names[i], &snapshot->operations[i].latency);
+        }
+    }
+
+    metrics_write(&writer, "# HELP obs_sdk_http_responses_total Responses by HTTP status code, 0 means none.\n"
+        "# TYPE obs_sdk_http_responses_total counter\n");
+    for (i = 0; i < OBS_METRICS_HTTP_CODE_MAX; i++) {
+        if (snapshot->http_code_count[i]) {
+            metrics_write(&writer, "obs_sdk_http_responses_total{code=\"%d\"} %llu\n", i,
+                (unsigned long long)snapshot->http_code_count[i]);
+        }
+    }
+    metrics_write(&writer, "# HELP obs_sdk_status_total Requests by SDK status.\n"
+        "# TYPE obs_sdk_status_total counter\n");
+    for (i = 0; i < OBS_STATUS_BUTT; i++) {
+        if (snapshot->status_count[i]) {
+            metrics_write(&writer, "obs_sdk_status_total{status=\"%s\"} %llu\n",
+                obs_get_status_name((obs_status)i), (unsigned long long)snapshot->status_count[i]);
+        }
+    }
+    metrics_write(&writer, "# HELP obs_sdk_handle_pool_total Request handle pool lookups.\n"
+        "# TYPE obs_sdk_handle_pool_total counter\n"
+        "obs_sdk_handle_pool_total{result=\"hit\"} %llu\n"
+        "obs_sdk_handle_pool_total{result=\"miss\"} %llu\n",
+        (unsigned long long)snapshot->handle_pool_hits, (unsigned long long)snapshot->handle_pool_misses);
+    metrics_write(&writer, "# HELP obs_sdk_connections_total Connections reused by requests or newly created.\n"
+        "# TYPE obs_sdk_connections_total counter\n"
+        "obs_sdk_connections_total{kind=\"reused\"} %llu\n"
+        "obs_sdk_connections_total{kind=\"created\"} %llu\n",
+        (unsigned long long)snapshot->connections_reused, (unsigned long long)snapshot->connections_created);
+
+    free(snapshot);
+    return writer.length;
+}
@@ -16,6 +16,7 @@
 #include "request.h"
 #include "securec.h"
 #include "request_util.h"
+#include "metadata_cache.h"
 
 // only posix bucke use
 void modify_object(const obs_options *options, char *key, uint64_t content_length, uint64_t position,
@@ -62,5 +63,6 @@ void modify_object(const obs_options *options, char *key, uint64_t content_lengt
 	params.storageClassFormat = storage_class;
 	params.use_api = use_api;
 	request_perform(&params);
+	metadata_cache_invalidate_object(&params.bucketContext, key);
 	COMMLOG(OBS_LOGINFO, "Leave modify_object successfully !");
 }
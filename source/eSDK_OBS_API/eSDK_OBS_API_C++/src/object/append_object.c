@@ -70,5 +70,6 @@ void append_object(const obs_options *options, char *key, uint64_t content_lengt
     params.storageClassFormat = storage_class;
     params.use_api = use_api;
     request_perform(&params);
+    metadata_cache_invalidate_object(&params.bucketContext, key);
     COMMLOG(OBS_LOGINFO, "Leave append_object successfully !");
 }
\ No newline at end of file
@@ -146,27 +146,7 @@ static int deleteObjectDataToObsCallback(int buffer_size, char *buffer,
     void *callback_data)
 {
     delete_object_data *doData = (delete_object_data *)callback_data;
-    if (!doData->docLen) {
-        return 0;
-    }
-    int remaining = (doData->docLen - doData->docBytesWritten);
-    int toCopy = buffer_size > remaining ? remaining : buffer_size;
-    if (!toCopy) {
-        return 0;
-    }
-
-
-    errno_t err = EOK;
-    err = memcpy_s(buffer, buffer_size, &(doData->doc[doData->docBytesWritten]), toCopy);
-
-    if (err != EOK)
-    {
-        COMMLOG(OBS_LOGWARN, "deleteObjectDataToObsCallback: memcpy_s failed!\n");
-        return 0;
-    }
-
-    doData->docBytesWritten += toCopy;
-    return toCopy;
+    return xml_writer_read(&doData->writer, buffer, buffer_size);
 }
 
 static obs_status deleteObjectDataFromObsCallback(int buffer_size, const char *buffer,
@@ -212,42 +192,39 @@ static void deleteObjectCompleteCallback(obs_status requestStatus,
 }
 
 
-obs_status compose_del_xml(obs_object_info *object_info, obs_delete_object_info *delobj,
-    obs_delete_object_handler *handler, delete_object_data* doData, void *callback_data)
+/* 记录0为文档头，1~keys_number依次为各对象，其后为文档尾 */
+static int compose_del_xml_record(xml_writer *writer, unsigned int index, void *record_data)
 {
-    unsigned int uiIdx = 0;
-    (void)add_xml_element_in_bufflen(doData->doc, &doData->docLen, "Delete", NULL,
-        NOT_NEED_FORMALIZE, ADD_HEAD_ONLY, OBS_MAX_DELETE_OBJECT_DOC);
-    if (delobj->quiet)
-    {
-        (void)add_xml_element_in_bufflen(doData->doc, &doData->docLen, "Quiet", "true",
-            NOT_NEED_FORMALIZE, ADD_NAME_CONTENT, OBS_MAX_DELETE_OBJECT_DOC);
-    }
+    delete_object_data *doData = (delete_object_data *)record_data;
+    obs_object_info *object = NULL;
 
-    for (; uiIdx < delobj->keys_number; uiIdx++)
+    if (index == 0)
     {
-        (void)add_xml_element_in_bufflen(doData->doc, &doData->docLen, "Object", NULL,
-            NOT_NEED_FORMALIZE, ADD_HEAD_ONLY, OBS_MAX_DELETE_OBJECT_DOC);
-        (void)add_xml_element_in_bufflen(doData->doc, &doData->docLen, "Key", object_info[uiIdx].key,
-            NEED_FORMALIZE, ADD_NAME_CONTENT, OBS_MAX_DELETE_OBJECT_DOC);
-        if (NULL != object_info[uiIdx].version_id)
+        xml_writer_open(writer, "Delete");
+        if (doData->quiet)
         {
-            (void)add_xml_element_in_bufflen(doData->doc, &doData->docLen, "VersionId",
-                object_info[uiIdx].version_id, NOT_NEED_FORMALIZE, ADD_NAME_CONTENT, OBS_MAX_DELETE_OBJECT_DOC);
+            xml_writer_element(writer, "Quiet", "true", NOT_NEED_FORMALIZE);
         }
-
-        (void)add_xml_element_in_bufflen(doData->doc, &doData->docLen, "Object", NULL,
-            NOT_NEED_FORMALIZE, ADD_TAIL_ONLY, OBS_MAX_DELETE_OBJECT_DOC);
-
-        if ((doData->docLen >= OBS_MAX_DELETE_OBJECT_DOC) && (uiIdx != (delobj->keys_number - 1)))
+        return 1;
+    }
+    if (index <= doData->keys_number)
+    {
+        object = &doData->object_info[index - 1];
+        xml_writer_open(writer, "Object");
+        xml_writer_element(writer, "Key", object->key, NEED_FORMALIZE);
+        if (NULL != object->version_id)
         {
-            (void)(*(handler->response_handler.complete_callback))(OBS_STATUS_OutOfMemory, 0, callback_data);
-            return OBS_STATUS_OutOfMemory;
+            xml_writer_element(writer, "VersionId", object->version_id, NOT_NEED_FORMALIZE);
         }
+        xml_writer_close(writer, "Object");
+        return 1;
     }
-    (void)add_xml_element_in_bufflen(doData->doc, &doData->docLen, "Delete", NULL,
-        NOT_NEED_FORMALIZE, ADD_TAIL_ONLY, OBS_MAX_DELETE_OBJECT_DOC);
-    return OBS_STATUS_OK;
+    if (index == doData->keys_number + 1)
+    {
+        xml_writer_close(writer, "Delete");
+        return 1;
+    }
+    return 0;
 }
 
 
@@ -261,6 +238,7 @@ void batch_delete_objects(const obs_options *options, obs_object_info *object_in
     obs_put_properties  properties;
     unsigned char doc_md5[16] = { 0 };
     char base64_md5[64] = { 0 };
+    unsigned int i;
 
     COMMLOG(OBS_LOGINFO, "Enter batch_delete_objects successfully !");
     if (put_properties == NULL)
@@ -296,18 +274,11 @@ void batch_delete_objects(const obs_options *options, obs_object_info *object_in
     doData->responseCompleteCallback = handler->response_handler.complete_callback;
     doData->delete_object_data_callback = handler->delete_object_data_callback;
     doData->callback_data = callback_data;
-    doData->docLen = 0;
-    doData->docBytesWritten = 0;
-    if (OBS_STATUS_OK != compose_del_xml(object_info, delobj, handler, doData, callback_data))
-    {
-        free(doData);
-        doData = NULL;
-        return;
-    }
-
-    COMMLOG(OBS_LOGDEBUG, "batch_delete_objects doc = %s!", doData->doc);
-
-    MD5((unsigned char*)doData->doc, (size_t)doData->docLen, doc_md5);
+    doData->object_info = object_info;
+    doData->keys_number = delobj->keys_number;
+    doData->quiet = delobj->quiet;
+    xml_writer_initialize(&doData->writer, &compose_del_xml_record, doData);
+    int64_t docLen = xml_writer_measure(&doData->writer, doc_md5);
     base64Encode(doc_md5, sizeof(doc_md5), base64_md5);
     properties.md5 = base64_md5;
 
@@ -327,12 +298,15 @@ void batch_delete_objects(const obs_options *options, obs_object_info *object_in
     params.properties_callback = &deleteObjectPropertiesCallback;
     params.complete_callback = &deleteObjectCompleteCallback;
     params.toObsCallback = &deleteObjectDataToObsCallback;
-    params.toObsCallbackTotalSize = doData->docLen;
+    params.toObsCallbackTotalSize = docLen;
     params.fromObsCallback = &deleteObjectDataFromObsCallback;
     params.callback_data = doData;
     params.isCheckCA = is_check_ca(options);
     params.storageClassFormat = no_need_storage_class;
     params.use_api = use_api;
     request_perform(&params);
+    for (i = 0; i < delobj->keys_number; i++) {
+        metadata_cache_invalidate_object(&params.bucketContext, object_info[i].key);
+    }
     COMMLOG(OBS_LOGINFO, "Leave batch_delete_objects successfully !");
 }
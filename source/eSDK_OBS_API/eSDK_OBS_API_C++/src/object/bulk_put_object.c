@@ -0,0 +1,449 @@
+/*********************************************************************************
+* Copyright 2024 Huawei Technologies Co.,Ltd.
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+* this file except in compliance with the License.  You may obtain a copy of the
+* License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed
+* under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+* CONDITIONS OF ANY KIND, either express or implied.  See the License for the
+* specific language governing permissions and limitations under the License.
+**********************************************************************************
+*/
+#include "object.h"
+#include "request_util.h"
+#include "metrics.h"
+
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if defined __GNUC__ || defined LINUX
+#include <unistd.h>
+#endif
+
+#define BULK_PUT_DEFAULT_CONNECTIONS  16
+#define BULK_PUT_MAX_CONNECTIONS      1024
+#define BULK_PUT_WAIT_MS              1000
+
+struct bulk_put_engine;
+
+/**
+ * 一个持久的上传槽位：持有自己的curl句柄和computed values，
+ * 在multi句柄的连接池上依次执行多个对象的PUT请求
+ */
+typedef struct bulk_put_slot
+{
+    http_request request;
+    request_computed_values *values;
+    request_params params;
+    obs_bulk_put_item item;
+    struct bulk_put_engine *engine;
+    int busy;
+    int fd;
+    uint64_t content_length;
+    uint64_t buffer_offset;
+    unsigned int attempts;
+    obs_status status;
+    char etag[MAX_SIZE_ETAG + 1];
+} bulk_put_slot;
+
+typedef struct bulk_put_engine
+{
+    CURLM *curlm;
+    bulk_put_slot *slots;
+    unsigned int slot_count;
+    unsigned int active_count;
+    unsigned int next_index;
+    int source_done;
+    request_params params_template;
+    obs_bulk_put_params *bulk_params;
+    obs_bulk_put_summary *summary;
+} bulk_put_engine;
+
+static int bulk_put_next_item(bulk_put_engine *engine, obs_bulk_put_item *item)
+{
+    obs_bulk_put_params *bulk_params = engine->bulk_params;
+    if (engine->source_done) {
+        return 0;
+    }
+    if (bulk_params->next_item_callback) {
+        memset_s(item, sizeof(obs_bulk_put_item), 0, sizeof(obs_bulk_put_item));
+        if (bulk_params->next_item_callback(item, bulk_params->callback_data)) {
+            return 1;
+        }
+    }
+    else if (engine->next_index < bulk_params->item_count) {
+        *item = bulk_params->items[engine->next_index++];
+        return 1;
+    }
+    engine->source_done = 1;
+    return 0;
+}
+
+static int bulk_put_data_callback(int buffer_size, char *buffer, void *callback_data)
+{
+    bulk_put_slot *slot = (bulk_put_slot *)callback_data;
+    if (slot->fd != -1) {
+        int ret = (int)read(slot->fd, buffer, buffer_size);
+        if (ret < 0) {
+            checkAndLogStrError(SYMBOL_NAME_STR(read), __FUNCTION__, __LINE__);
+        }
+        return ret;
+    }
+
+    uint64_t remaining = slot->content_length - slot->buffer_offset;
+    int to_copy = (remaining < (uint64_t)buffer_size) ? (int)remaining : buffer_size;
+    if (to_copy > 0) {
+        errno_t err = memcpy_s(buffer, buffer_size, slot->item.buffer + slot->buffer_offset, to_copy);
+        if (err != EOK) {
+            COMMLOG(OBS_LOGERROR, "%s(%d): memcpy_s failed!(%d)", __FUNCTION__, __LINE__, err);
+            return -1;
+        }
+        slot->buffer_offset += to_copy;
+    }
+    return to_copy;
+}
+
+static obs_status bulk_put_properties_callback(const obs_response_properties *properties, void *callback_data)
+{
+    bulk_put_slot *slot = (bulk_put_slot *)callback_data;
+    if (properties->etag) {
+        int ret = snprintf_s(slot->etag, sizeof(slot->etag), _TRUNCATE, "%s", properties->etag);
+        CheckAndLogNeg(ret, "snprintf_s", __FUNCTION__, __LINE__);
+    }
+    return OBS_STATUS_OK;
+}
+
+static void bulk_put_complete_callback(obs_status status, const obs_error_details *error, void *callback_data)
+{
+    (void)error;
+    bulk_put_slot *slot = (bulk_put_slot *)callback_data;
+    slot->status = status;
+}
+
+static void bulk_put_close_source(bulk_put_slot *slot)
+{
+    if (slot->fd != -1) {
+        close(slot->fd);
+        slot->fd = -1;
+    }
+}
+
+/**
+ * 打开数据源并重置读取位置，重试时也调用此函数
+ */
+static obs_status bulk_put_open_source(bulk_put_slot *slot)
+{
+    slot->buffer_offset = 0;
+    if (slot->item.file_name == NULL) {
+        if (slot->item.buffer == NULL && slot->item.buffer_size > 0) {
+            COMMLOG(OBS_LOGERROR, "bulk put item %s has neither file nor buffer", slot->item.key);
+            return OBS_STATUS_InvalidParameter;
+        }
+        slot->content_length = slot->item.buffer_size;
+        return OBS_STATUS_OK;
+    }
+
+    if (slot->fd == -1) {
+        struct stat st;
+        slot->fd = open(slot->item.file_name, O_RDONLY);
+        if (slot->fd == -1) {
+            COMMLOG(OBS_LOGERROR, "open bulk put file %s failed", slot->item.file_name);
+            checkAndLogStrError(SYMBOL_NAME_STR(open), __FUNCTION__, __LINE__);
+            return OBS_STATUS_OpenFileFailed;
+        }
+        if (fstat(slot->fd, &st) != 0) {
+            bulk_put_close_source(slot);
+            return OBS_STATUS_OpenFileFailed;
+        }
+        slot->content_length = (uint64_t)st.st_size;
+    }
+    else if (lseek(slot->fd, 0, SEEK_SET) != 0) {
+        bulk_put_close_source(slot);
+        return OBS_STATUS_OpenFileFailed;
+    }
+    return OBS_STATUS_OK;
+}
+
+/**
+ * 汇总单个对象的结果并回调调用者，调用者要求停止时不再提交新的对象
+ */
+static void bulk_put_report(bulk_put_engine *engine, bulk_put_slot *slot, const obs_error_details *error)
+{
+    obs_bulk_put_summary *summary = engine->summary;
+    obs_bulk_put_params *bulk_params = engine->bulk_params;
+    obs_status status = slot->status;
+
+    metadata_cache_invalidate_object(&slot->params.bucketContext, slot->item.key);
+    summary->total_count++;
+    if ((int)status >= 0 && status < OBS_STATUS_BUTT) {
+        summary->status_count[status]++;
+    }
+    if (status == OBS_STATUS_OK) {
+        summary->success_count++;
+        summary->total_bytes += slot->content_length;
+    }
+    else {
+        summary->failed_count++;
+        if (summary->first_error_status == OBS_STATUS_OK) {
+            summary->first_error_status = status;
+            int ret = snprintf_s(summary->first_error_key, sizeof(summary->first_error_key), _TRUNCATE,
+                "%s", slot->item.key ? slot->item.key : "");
+            CheckAndLogNeg(ret, "snprintf_s", __FUNCTION__, __LINE__);
+        }
+        COMMLOG(OBS_LOGWARN, "bulk put object %s failed, status: %s", slot->item.key ? slot->item.key : "",
+            obs_get_status_name(status));
+    }
+
+    if (bulk_params->item_complete_callback) {
+        obs_status cb_status = bulk_params->item_complete_callback(status, &slot->item,
+            (status == OBS_STATUS_OK) ? slot->etag : NULL, error, bulk_params->callback_data);
+        if (cb_status != OBS_STATUS_OK) {
+            COMMLOG(OBS_LOGWARN, "bulk put stopped by item complete callback, status: %s",
+                obs_get_status_name(cb_status));
+            engine->source_done = 1;
+        }
+    }
+}
+
+/**
+ * 在槽位上发起当前对象的请求：签名、设置curl并加入multi句柄
+ */
+static obs_status bulk_put_start(bulk_put_engine *engine, bulk_put_slot *slot)
+{
+    obs_status status = bulk_put_open_source(slot);
+    if (status != OBS_STATUS_OK) {
+        return status;
+    }
+
+    slot->etag[0] = '\0';
+    slot->status = OBS_STATUS_OK;
+    slot->params = engine->params_template;
+    slot->params.key = slot->item.key;
+    slot->params.put_properties = slot->item.put_properties;
+    slot->params.toObsCallbackTotalSize = (int64_t)slot->content_length;
+    slot->params.callback_data = slot;
+
+    status = request_prepare_reusable(&slot->params, slot->values, &slot->request);
+    if (status != OBS_STATUS_OK) {
+        return status;
+    }
+    // 多个对象在同一线程上交替发送，重试序号直接记在各自的请求上
+    slot->request.retry_count = (int)slot->attempts;
+    if (curl_multi_add_handle(engine->curlm, slot->request.curl) != CURLM_OK) {
+        return OBS_STATUS_InternalError;
+    }
+    slot->busy = 1;
+    engine->active_count++;
+    return OBS_STATUS_OK;
+}
+
+static void bulk_put_fill_slots(bulk_put_engine *engine)
+{
+    unsigned int i;
+    for (i = 0; i < engine->slot_count && !engine->source_done; i++) {
+        bulk_put_slot *slot = &engine->slots[i];
+        while (!slot->busy && bulk_put_next_item(engine, &slot->item)) {
+            slot->attempts = 0;
+            obs_status status = OBS_STATUS_InvalidParameter;
+            if (slot->item.key && slot->item.key[0]) {
+                status = bulk_put_start(engine, slot);
+            }
+            if (status != OBS_STATUS_OK) {
+                slot->status = status;
+                slot->content_length = 0;
+                bulk_put_close_source(slot);
+                bulk_put_report(engine, slot, NULL);
+            }
+        }
+    }
+}
+
+static int bulk_put_should_retry(const bulk_put_engine *engine, const bulk_put_slot *slot)
+{
+    if (slot->attempts >= engine->bulk_params->max_retries) {
+        return 0;
+    }
+    if (slot->item.file_name == NULL && slot->item.buffer == NULL && slot->item.buffer_size > 0) {
+        return 0;
+    }
+    return obs_status_is_retryable(slot->status) || slot->request.httpResponseCode == 408 ||
+        slot->request.httpResponseCode > 499;
+}
+
+static void bulk_put_drain_messages(bulk_put_engine *engine)
+{
+    CURLMsg *msg = NULL;
+    int junk = 0;
+    while ((msg = curl_multi_info_read(engine->curlm, &junk)) != NULL) {
+        if (msg->msg != CURLMSG_DONE) {
+            continue;
+        }
+        bulk_put_slot *slot = NULL;
+        if (curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **)(char *)&slot) != CURLE_OK ||
+            slot == NULL) {
+            COMMLOG(OBS_LOGERROR, "get private of easy handle failed in function: %s", __FUNCTION__);
+            curl_multi_remove_handle(engine->curlm, msg->easy_handle);
+            continue;
+        }
+        // CURLOPT_PRIVATE指向slot->request，request是slot的第一个成员
+        if ((msg->data.result != CURLE_OK) && (slot->request.status == OBS_STATUS_OK)) {
+            slot->request.status = request_curl_code_to_status(msg->data.result);
+        }
+        curl_multi_remove_handle(engine->curlm, msg->easy_handle);
+        request_finish_reusable(&slot->request);
+        slot->busy = 0;
+        engine->active_count--;
+
+        if (slot->status != OBS_STATUS_OK && bulk_put_should_retry(engine, slot)) {
+            slot->attempts++;
+            engine->summary->retry_count++;
+            metrics_record_retry(OBS_METRICS_OP_PUT_OBJECT);
+            COMMLOG(OBS_LOGINFO, "retry bulk put object %s, attempt %u", slot->item.key, slot->attempts);
+            if (bulk_put_start(engine, slot) == OBS_STATUS_OK) {
+                continue;
+            }
+        }
+        bulk_put_report(engine, slot, &slot->request.errorParser.obsErrorDetails);
+        bulk_put_close_source(slot);
+    }
+}
+
+static void bulk_put_engine_destroy(bulk_put_engine *engine)
+{
+    unsigned int i;
+    if (engine->slots) {
+        for (i = 0; i < engine->slot_count; i++) {
+            bulk_put_slot *slot = &engine->slots[i];
+            if (slot->busy) {
+                curl_multi_remove_handle(engine->curlm, slot->request.curl);
+            }
+            bulk_put_close_source(slot);
+            request_destroy_reusable(&slot->request);
+            CHECK_NULL_FREE(slot->values);
+        }
+        CHECK_NULL_FREE(engine->slots);
+    }
+    if (engine->curlm) {
+        curl_multi_cleanup(engine->curlm);
+        engine->curlm = NULL;
+    }
+}
+
+static obs_status bulk_put_engine_init(bulk_put_engine *engine, const obs_options *options,
+    obs_bulk_put_params *params, obs_bulk_put_summary *summary)
+{
+    unsigned int i;
+    obs_use_api use_api = OBS_USE_API_S3;
+
+    memset_s(engine, sizeof(bulk_put_engine), 0, sizeof(bulk_put_engine));
+    engine->bulk_params = params;
+    engine->summary = summary;
+
+    // 协议探测只做一次，所有对象共用
+    set_use_api_switch(options, &use_api);
+
+    request_params *tpl = &engine->params_template;
+    errno_t err = memcpy_s(&tpl->bucketContext, sizeof(obs_bucket_context), &options->bucket_options,
+        sizeof(obs_bucket_context));
+    CheckAndLogNoneZero(err, "memcpy_s", __FUNCTION__, __LINE__);
+    err = memcpy_s(&tpl->request_option, sizeof(obs_http_request_option), &options->request_options,
+        sizeof(obs_http_request_option));
+    CheckAndLogNoneZero(err, "memcpy_s", __FUNCTION__, __LINE__);
+    tpl->httpRequestType = http_request_type_put;
+    tpl->toObsCallback = &bulk_put_data_callback;
+    tpl->properties_callback = &bulk_put_properties_callback;
+    tpl->complete_callback = &bulk_put_complete_callback;
+    tpl->isCheckCA = is_check_ca(options);
+    tpl->storageClassFormat = storage_class;
+    tpl->use_api = use_api;
+
+    engine->slot_count = params->max_connections ? params->max_connections : BULK_PUT_DEFAULT_CONNECTIONS;
+    if (engine->slot_count > BULK_PUT_MAX_CONNECTIONS) {
+        engine->slot_count = BULK_PUT_MAX_CONNECTIONS;
+    }
+    if (params->next_item_callback == NULL && engine->slot_count > params->item_count) {
+        engine->slot_count = params->item_count;
+    }
+
+    if ((engine->curlm = curl_multi_init()) == NULL) {
+        return OBS_STATUS_OutOfMemory;
+    }
+    curl_multi_setopt(engine->curlm, CURLMOPT_MAXCONNECTS, (long)engine->slot_count);
+    curl_multi_setopt(engine->curlm, CURLMOPT_MAX_TOTAL_CONNECTIONS, (long)engine->slot_count);
+
+    engine->slots = (bulk_put_slot *)malloc(sizeof(bulk_put_slot) * engine->slot_count);
+    if (engine->slots == NULL) {
+        COMMLOG(OBS_LOGERROR, "malloc failed in function: %s, line: %d", __FUNCTION__, __LINE__);
+        return OBS_STATUS_OutOfMemory;
+    }
+    memset_s(engine->slots, sizeof(bulk_put_slot) * engine->slot_count, 0,
+        sizeof(bulk_put_slot) * engine->slot_count);
+    for (i = 0; i < engine->slot_count; i++) {
+        engine->slots[i].fd = -1;
+        engine->slots[i].engine = engine;
+        engine->slots[i].values = (request_computed_values *)malloc(sizeof(request_computed_values));
+        if (engine->slots[i].values == NULL) {
+            COMMLOG(OBS_LOGERROR, "malloc failed in function: %s, line: %d", __FUNCTION__, __LINE__);
+            return OBS_STATUS_OutOfMemory;
+        }
+    }
+    return OBS_STATUS_OK;
+}
+
+obs_status bulk_put_object(const obs_options *options, obs_bulk_put_params *params,
+    obs_bulk_put_summary *summary)
+{
+    bulk_put_engine engine;
+    obs_status status = OBS_STATUS_OK;
+    int running = 0;
+
+    COMMLOG(OBS_LOGINFO, "Enter %s successfully !", __FUNCTION__);
+    if (options == NULL || params == NULL || summary == NULL) {
+        COMMLOG(OBS_LOGERROR, "Invalid parameters in %s", __FUNCTION__);
+        return OBS_STATUS_InvalidParameter;
+    }
+    memset_s(summary, sizeof(obs_bulk_put_summary), 0, sizeof(obs_bulk_put_summary));
+    if (params->next_item_callback == NULL && (params->items == NULL || params->item_count == 0)) {
+        COMMLOG(OBS_LOGERROR, "items or next_item_callback is required in %s", __FUNCTION__);
+        return OBS_STATUS_InvalidParameter;
+    }
+    if (!options->bucket_options.bucket_name) {
+        COMMLOG(OBS_LOGERROR, "bucket_name is NULL.");
+        return OBS_STATUS_InvalidBucketName;
+    }
+    if (options->temp_auth) {
+        COMMLOG(OBS_LOGERROR, "%s does not support temp_auth", __FUNCTION__);
+        return OBS_STATUS_InvalidParameter;
+    }
+
+    status = bulk_put_engine_init(&engine, options, params, summary);
+    if (status == OBS_STATUS_OK) {
+        bulk_put_fill_slots(&engine);
+        while (engine.active_count > 0) {
+            CURLMcode mcode = curl_multi_perform(engine.curlm, &running);
+            if (mcode != CURLM_OK) {
+                COMMLOG(OBS_LOGERROR, "curl_multi_perform failed in %s, CURLMcode = %d", __FUNCTION__, mcode);
+                status = (mcode == CURLM_OUT_OF_MEMORY) ? OBS_STATUS_OutOfMemory : OBS_STATUS_InternalError;
+                break;
+            }
+            bulk_put_drain_messages(&engine);
+            bulk_put_fill_slots(&engine);
+            if (engine.active_count > 0) {
+                curl_multi_wait(engine.curlm, NULL, 0, BULK_PUT_WAIT_MS, NULL);
+            }
+        }
+    }
+    bulk_put_engine_destroy(&engine);
+
+    if (status == OBS_STATUS_OK) {
+        status = summary->first_error_status;
+    }
+    COMMLOG(OBS_LOGINFO, "Leave %s, total: %llu, succeeded: %llu, failed: %llu, retried: %llu",
+        __FUNCTION__, (unsigned long long)summary->total_count, (unsigned long long)summary->success_count,
+        (unsigned long long)summary->failed_count, (unsigned long long)summary->retry_count);
+    return status;
+}
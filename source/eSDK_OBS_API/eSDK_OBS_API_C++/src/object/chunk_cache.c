@@ -0,0 +1,739 @@
+/*********************************************************************************
+* Copyright 2024 Huawei Technologies Co.,Ltd.
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+* this file except in compliance with the License.  You may obtain a copy of the
+* License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed
+* under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+* CONDITIONS OF ANY KIND, either express or implied.  See the License for the
+* specific language governing permissions and limitations under the License.
+**********************************************************************************
+*/
+#include "object.h"
+#include "request_util.h"
+#include "file_utils.h"
+#include "chunk_cache.h"
+#include "compression.h"
+
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if defined __GNUC__ || defined LINUX
+#include <unistd.h>
+#include <pthread.h>
+#endif
+
+#define CHUNK_CACHE_DEFAULT_CHUNK_SIZE  (1024 * 1024)
+#define CHUNK_CACHE_MAX_CHUNK_SIZE      (64 * 1024 * 1024)
+#define CHUNK_CACHE_SLAB_NAME           "obs_chunk_cache.slab"
+#define CHUNK_NONE                      (-1)
+
+/**
+ * 磁盘slab中的一个块槽位，空闲槽位通过hash_next串成空闲链表
+ */
+typedef struct chunk_slot
+{
+    char *object_id;
+    uint64_t hash;
+    uint64_t chunk_index;
+    uint32_t length;
+    int pins;
+    int ready;
+    int32_t hash_next;
+    int32_t lru_prev;
+    int32_t lru_next;
+} chunk_slot;
+
+typedef struct chunk_cache
+{
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_t mutex;
+#else
+    CRITICAL_SECTION mutex;
+#endif
+    int fd;
+    char slab_file[OBS_MAX_KEY_SIZE + 1];
+    uint64_t chunk_size;
+    int32_t slot_count;
+    chunk_slot *slots;
+    int32_t *buckets;
+    uint64_t bucket_mask;
+    int32_t lru_head;
+    int32_t lru_tail;
+    int32_t free_head;
+    obs_chunk_cache_stats stats;
+} chunk_cache;
+
+static chunk_cache *g_chunk_cache = NULL;
+
+/**
+ * 一次范围读取的状态
+ */
+typedef struct chunk_read_context
+{
+    const obs_options *options;
+    obs_object_info *object_info;
+    obs_get_object_handler *handler;
+    void *callback_data;
+    char *object_id;
+    uint64_t object_hash;
+    char etag[MAX_SIZE_ETAG + 3];
+    uint64_t object_size;
+    uint64_t range_start;
+    uint64_t range_end;
+    uint64_t range_start_request;
+    uint64_t range_count_request;
+    char *buffer;
+    uint64_t current_chunk;
+    uint64_t last_fetch_chunk;
+    uint64_t buffer_fill;
+    obs_status status;
+    int completed;
+    int allow_compressed_range;
+} chunk_read_context;
+
+static void cache_lock(void)
+{
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_lock(&g_chunk_cache->mutex);
+#else
+    EnterCriticalSection(&g_chunk_cache->mutex);
+#endif
+}
+
+static void cache_unlock(void)
+{
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_unlock(&g_chunk_cache->mutex);
+#else
+    LeaveCriticalSection(&g_chunk_cache->mutex);
+#endif
+}
+
+static int slab_pread(char *buffer, uint64_t length, uint64_t offset)
+{
+#if defined __GNUC__ || defined LINUX
+    ssize_t ret = pread(g_chunk_cache->fd, buffer, (size_t)length, (off_t)offset);
+    return ret == (ssize_t)length ? 0 : -1;
+#else
+    int ret;
+    cache_lock();
+    ret = (_lseeki64(g_chunk_cache->fd, (__int64)offset, SEEK_SET) < 0 ||
+        _read(g_chunk_cache->fd, buffer, (unsigned int)length) != (int)length) ? -1 : 0;
+    cache_unlock();
+    return ret;
+#endif
+}
+
+static int slab_pwrite(const char *buffer, uint64_t length, uint64_t offset)
+{
+#if defined __GNUC__ || defined LINUX
+    ssize_t ret = pwrite(g_chunk_cache->fd, buffer, (size_t)length, (off_t)offset);
+    return ret == (ssize_t)length ? 0 : -1;
+#else
+    int ret;
+    cache_lock();
+    ret = (_lseeki64(g_chunk_cache->fd, (__int64)offset, SEEK_SET) < 0 ||
+        _write(g_chunk_cache->fd, buffer, (unsigned int)length) != (int)length) ? -1 : 0;
+    cache_unlock();
+    return ret;
+#endif
+}
+
+static uint64_t chunk_hash(uint64_t object_hash, uint64_t chunk_index)
+{
+    uint64_t hash = object_hash ^ (chunk_index * 0x9E3779B97F4A7C15ULL);
+    hash ^= hash >> 31;
+    return hash;
+}
+
+/************************************************************************************
+ * 槽位索引，调用方持有锁
+ ************************************************************************************/
+static void slot_lru_remove(int32_t index)
+{
+    chunk_slot *slot = &g_chunk_cache->slots[index];
+    if (slot->lru_prev != CHUNK_NONE) {
+        g_chunk_cache->slots[slot->lru_prev].lru_next = slot->lru_next;
+    }
+    else {
+        g_chunk_cache->lru_head = slot->lru_next;
+    }
+    if (slot->lru_next != CHUNK_NONE) {
+        g_chunk_cache->slots[slot->lru_next].lru_prev = slot->lru_prev;
+    }
+    else {
+        g_chunk_cache->lru_tail = slot->lru_prev;
+    }
+    slot->lru_prev = CHUNK_NONE;
+    slot->lru_next = CHUNK_NONE;
+}
+
+static void slot_lru_push_front(int32_t index)
+{
+    chunk_slot *slot = &g_chunk_cache->slots[index];
+    slot->lru_prev = CHUNK_NONE;
+    slot->lru_next = g_chunk_cache->lru_head;
+    if (g_chunk_cache->lru_head != CHUNK_NONE) {
+        g_chunk_cache->slots[g_chunk_cache->lru_head].lru_prev = index;
+    }
+    g_chunk_cache->lru_head = index;
+    if (g_chunk_cache->lru_tail == CHUNK_NONE) {
+        g_chunk_cache->lru_tail = index;
+    }
+}
+
+static int32_t slot_find(const char *object_id, uint64_t hash, uint64_t chunk_index)
+{
+    int32_t index = g_chunk_cache->buckets[hash & g_chunk_cache->bucket_mask];
+    while (index != CHUNK_NONE) {
+        chunk_slot *slot = &g_chunk_cache->slots[index];
+        if (slot->hash == hash && slot->chunk_index == chunk_index && strcmp(slot->object_id, object_id) == 0) {
+            return index;
+        }
+        index = slot->hash_next;
+    }
+    return CHUNK_NONE;
+}
+
+static void slot_unindex(int32_t index)
+{
+    chunk_slot *slot = &g_chunk_cache->slots[index];
+    int32_t *link = &g_chunk_cache->buckets[slot->hash & g_chunk_cache->bucket_mask];
+    while (*link != CHUNK_NONE && *link != index) {
+        link = &g_chunk_cache->slots[*link].hash_next;
+    }
+    if (*link == index) {
+        *link = slot->hash_next;
+    }
+    slot_lru_remove(index);
+    CHECK_NULL_FREE(slot->object_id);
+    slot->ready = 0;
+    slot->hash_next = CHUNK_NONE;
+    g_chunk_cache->stats.chunks--;
+    g_chunk_cache->stats.disk_usage -= slot->length;
+}
+
+static void slot_free(int32_t index)
+{
+    g_chunk_cache->slots[index].hash_next = g_chunk_cache->free_head;
+    g_chunk_cache->free_head = index;
+}
+
+/**
+ * 取一个可写入的槽位：优先使用空闲槽位，否则淘汰最久未使用且未被读取的块
+ */
+static int32_t slot_allocate(void)
+{
+    int32_t index;
+    cache_lock();
+    index = g_chunk_cache->free_head;
+    if (index != CHUNK_NONE) {
+        g_chunk_cache->free_head = g_chunk_cache->slots[index].hash_next;
+        g_chunk_cache->slots[index].hash_next = CHUNK_NONE;
+    }
+    else {
+        index = g_chunk_cache->lru_tail;
+        while (index != CHUNK_NONE && g_chunk_cache->slots[index].pins > 0) {
+            index = g_chunk_cache->slots[index].lru_prev;
+        }
+        if (index != CHUNK_NONE) {
+            slot_unindex(index);
+            g_chunk_cache->stats.evictions++;
+        }
+    }
+    cache_unlock();
+    return index;
+}
+
+static void slot_publish(int32_t index, const chunk_read_context *context, uint64_t chunk_index, uint32_t length)
+{
+    chunk_slot *slot = &g_chunk_cache->slots[index];
+    uint64_t hash = chunk_hash(context->object_hash, chunk_index);
+    size_t id_len = strlen(context->object_id) + 1;
+    char *object_id = (char *)malloc(id_len);
+
+    cache_lock();
+    // 并发读取可能已写入同一块
+    if (object_id == NULL || slot_find(context->object_id, hash, chunk_index) != CHUNK_NONE) {
+        CHECK_NULL_FREE(object_id);
+        slot_free(index);
+        cache_unlock();
+        return;
+    }
+    memcpy_s(object_id, id_len, context->object_id, id_len);
+    slot->object_id = object_id;
+    slot->hash = hash;
+    slot->chunk_index = chunk_index;
+    slot->length = length;
+    slot->pins = 0;
+    slot->ready = 1;
+    slot->hash_next = g_chunk_cache->buckets[hash & g_chunk_cache->bucket_mask];
+    g_chunk_cache->buckets[hash & g_chunk_cache->bucket_mask] = index;
+    slot_lru_push_front(index);
+    g_chunk_cache->stats.chunks++;
+    g_chunk_cache->stats.disk_usage += length;
+    cache_unlock();
+}
+
+static int chunk_contains(const chunk_read_context *context, uint64_t chunk_index)
+{
+    int32_t index;
+    cache_lock();
+    index = slot_find(context->object_id, chunk_hash(context->object_hash, chunk_index), chunk_index);
+    cache_unlock();
+    return index != CHUNK_NONE;
+}
+
+/************************************************************************************
+ * 范围读取
+ ************************************************************************************/
+static uint64_t chunk_length(const chunk_read_context *context, uint64_t chunk_index)
+{
+    uint64_t chunk_start = chunk_index * g_chunk_cache->chunk_size;
+    uint64_t remain = context->object_size - chunk_start;
+    return remain < g_chunk_cache->chunk_size ? remain : g_chunk_cache->chunk_size;
+}
+
+/**
+ * 把块中与请求范围重叠的部分交给调用者的数据回调
+ */
+static obs_status chunk_deliver(chunk_read_context *context, uint64_t chunk_index, const char *data,
+    uint64_t length)
+{
+    uint64_t chunk_start = chunk_index * g_chunk_cache->chunk_size;
+    uint64_t begin = context->range_start > chunk_start ? context->range_start : chunk_start;
+    uint64_t end = context->range_end < chunk_start + length ? context->range_end : chunk_start + length;
+    if (begin >= end || context->handler->get_object_data_callback == NULL) {
+        return OBS_STATUS_OK;
+    }
+    return (*context->handler->get_object_data_callback)((int)(end - begin), data + (begin - chunk_start),
+        context->callback_data);
+}
+
+static void chunk_store(chunk_read_context *context, uint64_t chunk_index, uint64_t length)
+{
+    int32_t index = slot_allocate();
+    if (index == CHUNK_NONE) {
+        return;
+    }
+    if (slab_pwrite(context->buffer, length, (uint64_t)index * g_chunk_cache->chunk_size) != 0) {
+        COMMLOG(OBS_LOGWARN, "%s: write chunk cache slab failed", __FUNCTION__);
+        cache_lock();
+        slot_free(index);
+        cache_unlock();
+        return;
+    }
+    slot_publish(index, context, chunk_index, (uint32_t)length);
+}
+
+/**
+ * 命中时从slab读出块并交付，返回0表示未命中
+ */
+static int chunk_read_cached(chunk_read_context *context, uint64_t chunk_index, obs_status *status)
+{
+    uint64_t hash = chunk_hash(context->object_hash, chunk_index);
+    uint32_t length = 0;
+    int32_t index;
+
+    cache_lock();
+    index = slot_find(context->object_id, hash, chunk_index);
+    if (index == CHUNK_NONE) {
+        g_chunk_cache->stats.misses++;
+        cache_unlock();
+        return 0;
+    }
+    g_chunk_cache->slots[index].pins++;
+    length = g_chunk_cache->slots[index].length;
+    slot_lru_remove(index);
+    slot_lru_push_front(index);
+    g_chunk_cache->stats.hits++;
+    g_chunk_cache->stats.bytes_from_cache += length;
+    cache_unlock();
+
+    if (slab_pread(context->buffer, length, (uint64_t)index * g_chunk_cache->chunk_size) != 0) {
+        cache_lock();
+        g_chunk_cache->slots[index].pins--;
+        cache_unlock();
+        return 0;
+    }
+    cache_lock();
+    g_chunk_cache->slots[index].pins--;
+    cache_unlock();
+    *status = chunk_deliver(context, chunk_index, context->buffer, length);
+    return 1;
+}
+
+static obs_status chunk_head_check_properties(chunk_read_context *context,
+    const obs_response_properties *properties)
+{
+    obs_response_properties range_properties;
+    uint64_t end;
+
+    if (properties->etag == NULL) {
+        return OBS_STATUS_InternalError;
+    }
+    // 与不经缓存的范围读取一致，压缩对象的片段无法单独解压
+    if (!context->allow_compressed_range && compression_from_metadata(properties, NULL) != OBS_COMPRESSION_NONE) {
+        COMMLOG(OBS_LOGERROR, "range read of a compressed object is not supported");
+        return OBS_STATUS_InvalidRange;
+    }
+    if (snprintf_s(context->etag, sizeof(context->etag), _TRUNCATE, "%s", properties->etag) < 0) {
+        return OBS_STATUS_IfMatchEtagTooLong;
+    }
+    context->object_size = properties->content_length;
+    context->range_start = context->range_start_request;
+    end = context->range_count_request ? context->range_start_request + context->range_count_request
+        : context->object_size;
+    context->range_end = end < context->object_size ? end : context->object_size;
+    if (context->range_start >= context->range_end) {
+        return OBS_STATUS_InvalidRange;
+    }
+
+    if (context->handler->response_handler.properties_callback == NULL) {
+        return OBS_STATUS_OK;
+    }
+    range_properties = *properties;
+    range_properties.content_length = context->range_end - context->range_start;
+    return (*context->handler->response_handler.properties_callback)(&range_properties, context->callback_data);
+}
+
+static obs_status chunk_head_properties_callback(const obs_response_properties *properties, void *callback_data)
+{
+    chunk_read_context *context = (chunk_read_context *)callback_data;
+    context->status = chunk_head_check_properties(context, properties);
+    return context->status;
+}
+
+static void chunk_head_complete_callback(obs_status status, const obs_error_details *error, void *callback_data)
+{
+    chunk_read_context *context = (chunk_read_context *)callback_data;
+    // HEAD没有响应体，属性回调的拒绝不一定反映到完成状态，未处理时range_end无效
+    if (status == OBS_STATUS_OK && context->status != OBS_STATUS_OK) {
+        status = context->status;
+    }
+    context->status = status;
+    if (status != OBS_STATUS_OK) {
+        (*context->handler->response_handler.complete_callback)(status, error, context->callback_data);
+        context->completed = 1;
+    }
+}
+
+static obs_status chunk_fetch_properties_callback(const obs_response_properties *properties, void *callback_data)
+{
+    (void)properties;
+    (void)callback_data;
+    return OBS_STATUS_OK;
+}
+
+static obs_status chunk_fetch_data_callback(int buffer_size, const char *buffer, void *callback_data)
+{
+    chunk_read_context *context = (chunk_read_context *)callback_data;
+    uint64_t offset = 0;
+
+    while (offset < (uint64_t)buffer_size) {
+        uint64_t length = chunk_length(context, context->current_chunk);
+        uint64_t copy = length - context->buffer_fill;
+        obs_status status;
+        if (context->current_chunk > context->last_fetch_chunk) {
+            return OBS_STATUS_InternalError;
+        }
+        if (copy > (uint64_t)buffer_size - offset) {
+            copy = (uint64_t)buffer_size - offset;
+        }
+        memcpy_s(context->buffer + context->buffer_fill, (size_t)(g_chunk_cache->chunk_size - context->buffer_fill),
+            buffer + offset, (size_t)copy);
+        context->buffer_fill += copy;
+        offset += copy;
+        if (context->buffer_fill < length) {
+            break;
+        }
+        chunk_store(context, context->current_chunk, length);
+        status = chunk_deliver(context, context->current_chunk, context->buffer, length);
+        context->current_chunk++;
+        context->buffer_fill = 0;
+        if (status != OBS_STATUS_OK) {
+            return status;
+        }
+    }
+    return OBS_STATUS_OK;
+}
+
+static void chunk_fetch_complete_callback(obs_status status, const obs_error_details *error, void *callback_data)
+{
+    chunk_read_context *context = (chunk_read_context *)callback_data;
+    if (status == OBS_STATUS_OK && context->current_chunk <= context->last_fetch_chunk) {
+        status = OBS_STATUS_PartialFile;
+    }
+    context->status = status;
+    if (status != OBS_STATUS_OK) {
+        if (status == OBS_STATUS_PreconditionFailed) {
+            // 对象在HEAD之后被覆盖，清理元数据缓存以便重试时取到新的etag
+            metadata_cache_invalidate_object(&context->options->bucket_options, context->object_info->key);
+        }
+        (*context->handler->response_handler.complete_callback)(status, error, context->callback_data);
+        context->completed = 1;
+    }
+}
+
+/**
+ * 将连续未命中的块合并为一次对齐的范围请求，并用If-Match保证与HEAD得到的版本一致
+ */
+static obs_status chunk_fetch_run(chunk_read_context *context, uint64_t first_chunk, uint64_t last_chunk)
+{
+    obs_get_object_handler fetch_handler = {
+        {&chunk_fetch_properties_callback, &chunk_fetch_complete_callback},
+        &chunk_fetch_data_callback
+    };
+    obs_get_conditions conditions;
+    uint64_t fetch_start = first_chunk * g_chunk_cache->chunk_size;
+    uint64_t fetch_end = (last_chunk + 1) * g_chunk_cache->chunk_size;
+
+    if (fetch_end > context->object_size) {
+        fetch_end = context->object_size;
+    }
+    init_get_properties(&conditions);
+    conditions.start_byte = fetch_start;
+    conditions.byte_count = fetch_end - fetch_start;
+    conditions.if_match_etag = context->etag;
+
+    context->current_chunk = first_chunk;
+    context->last_fetch_chunk = last_chunk;
+    context->buffer_fill = 0;
+
+    cache_lock();
+    g_chunk_cache->stats.fetches++;
+    g_chunk_cache->stats.bytes_from_server += fetch_end - fetch_start;
+    cache_unlock();
+
+    // 压缩对象已在HEAD时按需拒绝，缓存中保存的是服务端的原始数据
+    get_object_internal(context->options, context->object_info, &conditions, NULL, &fetch_handler, context, 1);
+    return context->status;
+}
+
+static int chunk_cache_eligible(const obs_options *options, obs_object_info *object_info,
+    obs_get_conditions *get_conditions, server_side_encryption_params *encryption_params)
+{
+    if (g_chunk_cache == NULL || get_conditions == NULL || encryption_params != NULL ||
+        options->temp_auth != NULL || object_info == NULL || object_info->key == NULL) {
+        return 0;
+    }
+    if (get_conditions->start_byte == 0 && get_conditions->byte_count == 0) {
+        return 0;
+    }
+    // 带条件或图片处理的请求不经过缓存，块缓存自身的回源请求也带If-Match，不会递归
+    return get_conditions->image_process_config == NULL && get_conditions->if_match_etag == NULL &&
+        get_conditions->if_not_match_etag == NULL && get_conditions->if_modified_since < 0 &&
+        get_conditions->if_not_modified_since < 0;
+}
+
+int chunk_cache_get_object(const obs_options *options, obs_object_info *object_info,
+    obs_get_conditions *get_conditions, server_side_encryption_params *encryption_params,
+    obs_get_object_handler *handler, void *callback_data, int allow_compressed_range)
+{
+    obs_response_handler head_handler = {&chunk_head_properties_callback, &chunk_head_complete_callback};
+    chunk_read_context context;
+    obs_status status = OBS_STATUS_OK;
+    uint64_t chunk_index;
+    uint64_t last_chunk;
+    size_t id_len;
+    int ret;
+
+    if (!chunk_cache_eligible(options, object_info, get_conditions, encryption_params)) {
+        return 0;
+    }
+    memset_s(&context, sizeof(context), 0, sizeof(context));
+    context.options = options;
+    context.object_info = object_info;
+    context.handler = handler;
+    context.callback_data = callback_data;
+    context.range_start_request = get_conditions->start_byte;
+    context.range_count_request = get_conditions->byte_count;
+    context.allow_compressed_range = allow_compressed_range;
+
+    // 先取对象当前的etag与大小，启用元数据缓存时通常无需访问服务端
+    get_object_metadata(options, object_info, NULL, &head_handler, &context);
+    if (context.completed) {
+        return 1;
+    }
+
+    id_len = strlen(options->bucket_options.host_name ? options->bucket_options.host_name : "") +
+        strlen(options->bucket_options.bucket_name) + strlen(object_info->key) +
+        (object_info->version_id ? strlen(object_info->version_id) : 0) + strlen(context.etag) + 5;
+    context.object_id = (char *)malloc(id_len);
+    context.buffer = (char *)malloc((size_t)g_chunk_cache->chunk_size);
+    if (context.object_id == NULL || context.buffer == NULL) {
+        CHECK_NULL_FREE(context.object_id);
+        CHECK_NULL_FREE(context.buffer);
+        (*handler->response_handler.complete_callback)(OBS_STATUS_OutOfMemory, 0, callback_data);
+        return 1;
+    }
+    ret = snprintf_s(context.object_id, id_len, _TRUNCATE, "%s\n%s\n%s\n%s\n%s",
+        options->bucket_options.host_name ? options->bucket_options.host_name : "",
+        options->bucket_options.bucket_name, object_info->key,
+        object_info->version_id ? object_info->version_id : "", context.etag);
+    CheckAndLogNeg(ret, "snprintf_s", __FUNCTION__, __LINE__);
+    context.object_hash = 14695981039346656037ULL;
+    for (ret = 0; context.object_id[ret]; ret++) {
+        context.object_hash ^= (unsigned char)context.object_id[ret];
+        context.object_hash *= 1099511628211ULL;
+    }
+
+    last_chunk = (context.range_end - 1) / g_chunk_cache->chunk_size;
+    for (chunk_index = context.range_start / g_chunk_cache->chunk_size;
+        chunk_index <= last_chunk && status == OBS_STATUS_OK; chunk_index++) {
+        uint64_t run_end = chunk_index;
+        if (chunk_read_cached(&context, chunk_index, &status)) {
+            continue;
+        }
+        while (run_end < last_chunk && !chunk_contains(&context, run_end + 1)) {
+            run_end++;
+        }
+        status = chunk_fetch_run(&context, chunk_index, run_end);
+        chunk_index = run_end;
+    }
+
+    if (!context.completed) {
+        (*handler->response_handler.complete_callback)(status, 0, callback_data);
+    }
+    free(context.object_id);
+    free(context.buffer);
+    return 1;
+}
+
+/************************************************************************************
+ * 公共接口
+ ************************************************************************************/
+obs_status obs_chunk_cache_enable(const obs_chunk_cache_config *config)
+{
+    chunk_cache *cache = NULL;
+    uint64_t chunk_size;
+    uint64_t slot_count;
+    uint64_t bucket_count = 16;
+    uint64_t i;
+    int ret;
+
+    if (config == NULL || config->cache_dir == NULL || config->max_disk_size == 0) {
+        COMMLOG(OBS_LOGERROR, "%s: invalid chunk cache config", __FUNCTION__);
+        return OBS_STATUS_InvalidParameter;
+    }
+    chunk_size = config->chunk_size ? config->chunk_size : CHUNK_CACHE_DEFAULT_CHUNK_SIZE;
+    slot_count = config->max_disk_size / chunk_size;
+    if (chunk_size > CHUNK_CACHE_MAX_CHUNK_SIZE || slot_count == 0 || slot_count > INT32_MAX) {
+        COMMLOG(OBS_LOGERROR, "%s: invalid chunk size %llu or disk size %llu", __FUNCTION__,
+            (unsigned long long)chunk_size, (unsigned long long)config->max_disk_size);
+        return OBS_STATUS_InvalidParameter;
+    }
+    while (bucket_count < slot_count) {
+        bucket_count <<= 1;
+    }
+
+    cache = (chunk_cache *)malloc(sizeof(chunk_cache));
+    if (cache == NULL) {
+        return OBS_STATUS_OutOfMemory;
+    }
+    memset_s(cache, sizeof(chunk_cache), 0, sizeof(chunk_cache));
+    cache->slots = (chunk_slot *)calloc((size_t)slot_count, sizeof(chunk_slot));
+    cache->buckets = (int32_t *)malloc(sizeof(int32_t) * (size_t)bucket_count);
+    ret = snprintf_s(cache->slab_file, sizeof(cache->slab_file), _TRUNCATE, "%s/%s", config->cache_dir,
+        CHUNK_CACHE_SLAB_NAME);
+    if (cache->slots == NULL || cache->buckets == NULL || ret < 0) {
+        CHECK_NULL_FREE(cache->slots);
+        CHECK_NULL_FREE(cache->buckets);
+        free(cache);
+        return ret < 0 ? OBS_STATUS_InvalidParameter : OBS_STATUS_OutOfMemory;
+    }
+
+    // 每次启用都重建slab，稀疏文件只在写入块时占用磁盘
+#if defined __GNUC__ || defined LINUX
+    cache->fd = open(cache->slab_file, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    ret = (cache->fd == -1) ? -1 : ftruncate(cache->fd, (off_t)(slot_count * chunk_size));
+#else
+    cache->fd = -1;
+    (void)file_sopen_s(&cache->fd, cache->slab_file, _O_BINARY | _O_RDWR | _O_CREAT | _O_TRUNC,
+        _SH_DENYNO, _S_IREAD | _S_IWRITE);
+    ret = (cache->fd == -1) ? -1 : _chsize_s(cache->fd, (__int64)(slot_count * chunk_size));
+#endif
+    if (ret != 0) {
+        checkAndLogStrError(SYMBOL_NAME_STR(open), __FUNCTION__, __LINE__);
+        if (cache->fd != -1) {
+            close(cache->fd);
+        }
+        free(cache->slots);
+        free(cache->buckets);
+        free(cache);
+        return OBS_STATUS_OpenFileFailed;
+    }
+
+    cache->chunk_size = chunk_size;
+    cache->slot_count = (int32_t)slot_count;
+    cache->bucket_mask = bucket_count - 1;
+    cache->lru_head = CHUNK_NONE;
+    cache->lru_tail = CHUNK_NONE;
+    for (i = 0; i < bucket_count; i++) {
+        cache->buckets[i] = CHUNK_NONE;
+    }
+    for (i = 0; i < slot_count; i++) {
+        cache->slots[i].lru_prev = CHUNK_NONE;
+        cache->slots[i].lru_next = CHUNK_NONE;
+        cache->slots[i].hash_next = (i + 1 < slot_count) ? (int32_t)(i + 1) : CHUNK_NONE;
+    }
+    cache->free_head = 0;
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_init(&cache->mutex, NULL);
+#else
+    InitializeCriticalSection(&cache->mutex);
+#endif
+
+    obs_chunk_cache_disable();
+    g_chunk_cache = cache;
+    COMMLOG(OBS_LOGINFO, "%s: slab %s, chunk size %llu, chunks %llu", __FUNCTION__, cache->slab_file,
+        (unsigned long long)chunk_size, (unsigned long long)slot_count);
+    return OBS_STATUS_OK;
+}
+
+void obs_chunk_cache_disable(void)
+{
+    chunk_cache *cache = g_chunk_cache;
+    int32_t i;
+    if (cache == NULL) {
+        return;
+    }
+    g_chunk_cache = NULL;
+    for (i = 0; i < cache->slot_count; i++) {
+        CHECK_NULL_FREE(cache->slots[i].object_id);
+    }
+    close(cache->fd);
+    (void)remove_file(cache->slab_file);
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_destroy(&cache->mutex);
+#else
+    DeleteCriticalSection(&cache->mutex);
+#endif
+    free(cache->slots);
+    free(cache->buckets);
+    free(cache);
+}
+
+void obs_chunk_cache_get_stats(obs_chunk_cache_stats *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+    memset_s(stats, sizeof(obs_chunk_cache_stats), 0, sizeof(obs_chunk_cache_stats));
+    if (g_chunk_cache == NULL) {
+        return;
+    }
+    cache_lock();
+    *stats = g_chunk_cache->stats;
+    cache_unlock();
+}
+
+void chunk_cache_deinitialize(void)
+{
+    obs_chunk_cache_disable();
+}
@@ -104,60 +104,44 @@ static obs_status complete_multi_part_upload_xml_callback(const char *elementPat
     return OBS_STATUS_OK;
 }
 
-static void compose_complete_multi_part_upload_data(complete_multi_part_upload_data* cmuData,
-    unsigned int part_number, obs_complete_upload_Info *complete_upload_Info,
-    int buffer_len)
+/* 记录0为文档头，1~part_number依次为各段，其后为文档尾 */
+static int complete_multi_part_upload_xml_record(xml_writer *writer, unsigned int index,
+    void *record_data)
 {
-    unsigned int uiIdx = 0;
-    (void)add_xml_element_in_bufflen(cmuData->doc, &cmuData->docLen, "CompleteMultipartUpload",
-        NULL, NOT_NEED_FORMALIZE, ADD_HEAD_ONLY, buffer_len);
-    for (; uiIdx < part_number; uiIdx++)
+    complete_multi_part_upload_data *cmuData = (complete_multi_part_upload_data *)record_data;
+    obs_complete_upload_Info *info = NULL;
+
+    if (index == 0)
+    {
+        xml_writer_open(writer, "CompleteMultipartUpload");
+        return 1;
+    }
+    if (index <= cmuData->part_number)
     {
-        if (NULL == complete_upload_Info[uiIdx].etag)
+        info = &cmuData->complete_upload_Info[index - 1];
+        if (NULL == info->etag)
         {
-            continue;
+            return 1;
         }
-        (void)add_xml_element_in_bufflen(cmuData->doc, &cmuData->docLen, "Part",
-            NULL, NOT_NEED_FORMALIZE, ADD_HEAD_ONLY, buffer_len);
-        cmuData->docLen += snprintf_s(cmuData->doc + cmuData->docLen,
-            256 * part_number - cmuData->docLen, _TRUNCATE,
-            "<PartNumber>%u</PartNumber>", complete_upload_Info[uiIdx].part_number);
-        (void)add_xml_element_in_bufflen(cmuData->doc, &cmuData->docLen, "ETag", complete_upload_Info[uiIdx].etag,
-            NEED_FORMALIZE, ADD_NAME_CONTENT, buffer_len);
-        (void)add_xml_element_in_bufflen(cmuData->doc, &cmuData->docLen, "Part",
-            NULL, NOT_NEED_FORMALIZE, ADD_TAIL_ONLY, buffer_len);
+        xml_writer_open(writer, "Part");
+        xml_writer_element_uint(writer, "PartNumber", info->part_number);
+        xml_writer_element(writer, "ETag", info->etag, NEED_FORMALIZE);
+        xml_writer_close(writer, "Part");
+        return 1;
     }
-    (void)add_xml_element_in_bufflen(cmuData->doc, &cmuData->docLen, "CompleteMultipartUpload",
-        NULL, NOT_NEED_FORMALIZE, ADD_TAIL_ONLY, buffer_len);
-    return;
+    if (index == cmuData->part_number + 1)
+    {
+        xml_writer_close(writer, "CompleteMultipartUpload");
+        return 1;
+    }
+    return 0;
 }
 
 static int complete_multi_part_upload_data_to_obs_callback(int buffer_size, char *buffer,
     void *callback_data)
 {
     complete_multi_part_upload_data *cmuData = (complete_multi_part_upload_data *)callback_data;
-
-    if (!cmuData->docLen) {
-        return 0;
-    }
-    int remaining = (cmuData->docLen - cmuData->docBytesWritten);
-
-    int toCopy = buffer_size > remaining ? remaining : buffer_size;
-
-    if (!toCopy) {
-        return 0;
-    }
-
-    errno_t err = EOK;
-    err = memcpy_s(buffer, buffer_size, &(cmuData->doc[cmuData->docBytesWritten]), toCopy);
-    if (err != EOK)
-    {
-        COMMLOG(OBS_LOGWARN, "complete_multi_part_upload_data_to_obs_callback: memcpy_s failed!\n");
-        return 0;
-    }
-
-    cmuData->docBytesWritten += toCopy;
-    return toCopy;
+    return xml_writer_read(&cmuData->writer, buffer, buffer_size);
 }
 
 static obs_status complete_multi_part_upload_data_from_obs_callback(int buffer_size, const char *buffer,
@@ -218,11 +202,6 @@ static void complete_multi_part_upload_complete_callback(obs_status requestStatu
     (*(cmuData->responseCompleteCallback))
         (requestStatus, s3ErrorDetails, cmuData->callback_data);
     simplexml_deinitialize(&(cmuData->simpleXml));
-    if (NULL != cmuData->doc)
-    {
-        free(cmuData->doc);
-        cmuData->doc = NULL;
-    }
     free(cmuData);
     cmuData = NULL;
     COMMLOG(OBS_LOGINFO, "Leave %s successfully !", __FUNCTION__);
@@ -278,16 +257,6 @@ void complete_multi_part_upload(const obs_options *options, char *key, const cha
         return;
     }
     memset_s(cmuData, sizeof(complete_multi_part_upload_data), 0, sizeof(complete_multi_part_upload_data));
-    cmuData->doc = (char*)malloc(ONE_PART_REQUEST_XML_LEN * part_number);
-    if (NULL == cmuData->doc) {
-        COMMLOG(OBS_LOGERROR, "Malloc cmuData->doc failed !");
-        (void)(*(handler->response_handler.complete_callback))(OBS_STATUS_OutOfMemory, 0, callback_data);
-        free(cmuData);
-        cmuData = NULL;
-        return;
-    }
-
-    memset_s(cmuData->doc, ONE_PART_REQUEST_XML_LEN * part_number, 0, ONE_PART_REQUEST_XML_LEN * part_number);
 
     simplexml_initialize(&(cmuData->simpleXml), &complete_multi_part_upload_xml_callback, cmuData);
     cmuData->responsePropertiesCallback = handler->response_handler.properties_callback;
@@ -296,10 +265,11 @@ void complete_multi_part_upload(const obs_options *options, char *key, const cha
     cmuData->callback_data = callback_data;
     cmuData->server_callback = false;
 
-    cmuData->docLen = 0;
-    cmuData->docBytesWritten = 0;
-    compose_complete_multi_part_upload_data(cmuData, part_number, complete_upload_Info,
-        256 * part_number);
+    // 请求体在发送时按段生成，不再预先分配整份文档
+    cmuData->part_number = part_number;
+    cmuData->complete_upload_Info = complete_upload_Info;
+    xml_writer_initialize(&cmuData->writer, &complete_multi_part_upload_xml_record, cmuData);
+    int64_t docLen = xml_writer_measure(&cmuData->writer, NULL);
     memset_s(&params, sizeof(request_params), 0, sizeof(request_params));
     errno_t err = EOK;
     err = memcpy_s(&params.bucketContext, sizeof(obs_bucket_context), &options->bucket_options,
@@ -317,12 +287,13 @@ void complete_multi_part_upload(const obs_options *options, char *key, const cha
     params.properties_callback = &complete_multi_part_upload_properties_callback;
     params.complete_callback = &complete_multi_part_upload_complete_callback;
     params.toObsCallback = &complete_multi_part_upload_data_to_obs_callback;
-    params.toObsCallbackTotalSize = cmuData->docLen;
+    params.toObsCallbackTotalSize = docLen;
     params.fromObsCallback = &complete_multi_part_upload_data_from_obs_callback;
     params.callback_data = cmuData;
     params.isCheckCA = is_check_ca(options);
     params.storageClassFormat = no_need_storage_class;
     params.use_api = use_api;
     request_perform(&params);
+    metadata_cache_invalidate_object(&params.bucketContext, key);
     COMMLOG(OBS_LOGINFO, "Leave complete_multi_part_upload successfully !");
 }
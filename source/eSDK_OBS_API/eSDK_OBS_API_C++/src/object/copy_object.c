@@ -103,8 +103,6 @@ static void copyObjectCompleteCallback(obs_status requestStatus,
         time_t last_modified = -1;
         if (coData->last_modifiedLen) {
             last_modified = parseIso8601Time(coData->last_modified);
-            int nTimeZone = getTimeZone();
-            last_modified += nTimeZone * SECONDS_TO_AN_HOUR;
         }
 
         *(coData->last_modified_return) = last_modified;
@@ -201,6 +199,7 @@ void copy_object(const obs_options *options, char *key, const char *version_id,
     params.storageClassFormat = storage_class;
     params.use_api = use_api;
     request_perform(&params);
+    metadata_cache_invalidate_object(&params.bucketContext, object_info->destination_key);
     COMMLOG(OBS_LOGINFO, "Leave copy_object successfully !");
 
 }
\ No newline at end of file
@@ -103,8 +103,6 @@ static void CopyPartCompleteCallback(obs_status requestStatus,
         time_t last_modified = -1;
         if (cpData->last_modifiedLen) {
             last_modified = parseIso8601Time(cpData->last_modified);
-            int nTimeZone = getTimeZone();
-            last_modified += nTimeZone * SECONDS_TO_AN_HOUR;
         }
 
         *(cpData->last_modified_return) = last_modified;
@@ -50,5 +50,6 @@ void delete_object(const obs_options *options, obs_object_info *object_info,
     params.storageClassFormat = no_need_storage_class;
     params.use_api = use_api;
     request_perform(&params);
+    metadata_cache_invalidate_object(&params.bucketContext, object_info->key);
     COMMLOG(OBS_LOGINFO, "Leave delete_object successfully !");
 }
\ No newline at end of file
@@ -86,6 +86,18 @@ static obs_status GetObjectMetadataPropertiesCallback_Intern
         pstFileInfo->storage_class = getStorageClassEnum(properties->storage_class);
     }
 
+    //the parts are stored with their tags, the file length is the plaintext one
+    if (cb->clientEncryptionParams)
+    {
+        cb->clientEncryptionStatus = client_encryption_from_metadata(cb->clientEncryptionParams, properties,
+            cb->clientEncryption);
+        if (cb->clientEncryptionStatus == OBS_STATUS_OK)
+        {
+            pstFileInfo->objectLength = client_encryption_plain_size(cb->clientEncryption,
+                properties->content_length);
+        }
+    }
+
     return OBS_STATUS_OK;
 }
 
@@ -100,7 +112,8 @@ static void GetObjectMetadataCompleteCallback_Intern(obs_status status,
 
 obs_status getObjectInfo(download_file_summary * downloadFileInfo,
     const obs_options *options, char *key, char* version_id,
-    server_side_encryption_params *encryption_params)
+    server_side_encryption_params *encryption_params,
+    const obs_client_encryption_params *client_encryption_params, client_encryption_context *client_encryption)
 {
     get_object_metadata_callback_data stGetObjectMetadataCallBackData;
 
@@ -112,6 +125,8 @@ obs_status getObjectInfo(download_file_summary * downloadFileInfo,
         0, sizeof(get_object_metadata_callback_data));
 
     stGetObjectMetadataCallBackData.pstFileInfo = downloadFileInfo;
+    stGetObjectMetadataCallBackData.clientEncryptionParams = client_encryption_params;
+    stGetObjectMetadataCallBackData.clientEncryption = client_encryption;
 
     obs_object_info object_info;
     memset_s(&object_info, sizeof(obs_object_info), 0, sizeof(obs_object_info));
@@ -120,6 +135,10 @@ obs_status getObjectInfo(download_file_summary * downloadFileInfo,
     get_object_metadata(options, &object_info, encryption_params,
         &getObjMetadataHandler, &stGetObjectMetadataCallBackData);
 
+    if (stGetObjectMetadataCallBackData.retStatus == OBS_STATUS_OK && client_encryption_params)
+    {
+        return stGetObjectMetadataCallBackData.clientEncryptionStatus;
+    }
     return stGetObjectMetadataCallBackData.retStatus;
 }
 
@@ -861,12 +880,39 @@ static obs_status DownloadPartCompletePropertiesCallback
     return OBS_STATUS_OK;
 }
 
+//move the decrypted part to the part file once its tag is verified, the part file
+//never holds unauthenticated plaintext
+static obs_status commitDecryptedPart(download_file_callback_data *cbd)
+{
+    close(cbd->fdStorefile);
+    cbd->fdStorefile = -1;
+#if defined WIN32
+    (void)remove_file(cbd->partFileName);
+#endif
+    if (rename_file(cbd->stagingFileName, cbd->partFileName) != 0)
+    {
+        COMMLOG(OBS_LOGERROR, "move decrypted part %d failed", cbd->pstDownloadFilePartInfo->part_num);
+        return OBS_STATUS_OpenFileFailed;
+    }
+    return OBS_STATUS_OK;
+}
+
 static void  downloadPartCompleteCallback(obs_status status,
     const obs_error_details *error,
     void *callback_data)
 {
     download_file_callback_data * cbd = (download_file_callback_data *)callback_data;
 
+    //the part is only usable when its tag is verified
+    if (status == OBS_STATUS_OK && cbd->cipher)
+    {
+        status = client_encryption_part_finish(cbd->cipher);
+        if (status == OBS_STATUS_OK)
+        {
+            status = commitDecryptedPart(cbd);
+        }
+    }
+
     if (status == OBS_STATUS_OK)
     {
         cbd->pstDownloadFilePartInfo->downloadStatus = DOWNLOAD_SUCCESS;
@@ -925,11 +971,26 @@ static void  downloadPartCompleteCallback(obs_status status,
     return;
 }
 
+static obs_status writePartData(const char *buffer, int buffer_size, void *callback_data)
+{
+    download_file_callback_data * cbd = (download_file_callback_data *)callback_data;
+
+    size_t wrote = write(cbd->fdStorefile, buffer, buffer_size);
+
+    return ((wrote < (size_t)buffer_size) ?
+        OBS_STATUS_AbortedByCallback : OBS_STATUS_OK);
+}
+
 static obs_status getObjectPartDataCallback(int buffer_size, const char *buffer,
     void *callback_data)
 {
     download_file_callback_data * cbd = (download_file_callback_data *)callback_data;
 
+    if (cbd->cipher)
+    {
+        return client_encryption_part_decrypt(cbd->cipher, buffer, buffer_size, &writePartData, cbd);
+    }
+
     int fd = cbd->fdStorefile;
 
     size_t wrote = write(fd, buffer, buffer_size);
@@ -938,6 +999,21 @@ static obs_status getObjectPartDataCallback(int buffer_size, const char *buffer,
         OBS_STATUS_AbortedByCallback : OBS_STATUS_OK);
 }
 
+//the stored part i holds the plaintext part i and its tag
+static obs_status setDownloadPartClientEncryption(download_params *pstDownloadParams, int part_num,
+    uint64_t part_size, client_encryption_part *cipherPart, obs_get_conditions *get_conditions)
+{
+    client_encryption_context *clientEncryption = pstDownloadParams->client_encryption;
+    if (clientEncryption == NULL)
+    {
+        return OBS_STATUS_OK;
+    }
+    get_conditions->start_byte = (uint64_t)part_num * (clientEncryption->part_size + OBS_CLIENT_ENCRYPTION_TAG_SIZE);
+    get_conditions->byte_count = part_size + OBS_CLIENT_ENCRYPTION_TAG_SIZE;
+    return client_encryption_part_begin(clientEncryption, cipherPart, (unsigned int)part_num, part_size,
+        pstDownloadParams->objectLength, 0);
+}
+
 #if defined (WIN32)
 unsigned __stdcall DownloadThreadProc_win32(void* param)
 {
@@ -948,23 +1024,36 @@ unsigned __stdcall DownloadThreadProc_win32(void* param)
     server_side_encryption_params * pstEncrypParam = NULL;
     char strPartNum[16] = { 0 };
     download_file_callback_data  data;
+    client_encryption_part cipherPart;
     data.fdStorefile = -1;
     int fd = -1;
-	size_t fileNameTempLen = file_path_strlen(storeFileName) + 10;
+	size_t fileNameTempLen = file_path_strlen(storeFileName) + 16;
     char * fileNameTemp = getPathBuffer(fileNameTempLen);
+    char * fileNameStaging = getPathBuffer(fileNameTempLen);
 
-    if(fileNameTemp == NULL){
+    if(fileNameTemp == NULL || fileNameStaging == NULL){
         COMMLOG(OBS_LOGERROR, "malloc failed in function: %s,line %d", __FUNCTION__, __LINE__);
+        CHECK_NULL_FREE(fileNameTemp);
+        CHECK_NULL_FREE(fileNameStaging);
         return 1;
     }
 
 	int ret = temp_part_file_path_printf(fileNameTemp, fileNameTempLen, storeFileName, part_num);
     CheckAndLogNeg(ret, "sprintf_s", __FUNCTION__, __LINE__);
+    ret = staging_part_file_path_printf(fileNameStaging, fileNameTempLen, storeFileName, part_num);
+    CheckAndLogNeg(ret, "sprintf_s", __FUNCTION__, __LINE__);
 
-    (void)file_sopen_s(&fd, fileNameTemp, _O_BINARY | _O_RDWR | _O_CREAT,
-        _SH_DENYNO, _S_IREAD | _S_IWRITE);
-
-	CHECK_NULL_FREE(fileNameTemp);
+    //a client encrypted part is decrypted into the staging file until its tag is verified
+    if (pstPara->pstDownloadParams->client_encryption)
+    {
+        (void)file_sopen_s(&fd, fileNameStaging, _O_BINARY | _O_RDWR | _O_CREAT | _O_TRUNC,
+            _SH_DENYNO, _S_IREAD | _S_IWRITE);
+    }
+    else
+    {
+        (void)file_sopen_s(&fd, fileNameTemp, _O_BINARY | _O_RDWR | _O_CREAT,
+            _SH_DENYNO, _S_IREAD | _S_IWRITE);
+    }
 
     if (fd == -1)
     {
@@ -992,6 +1081,9 @@ unsigned __stdcall DownloadThreadProc_win32(void* param)
         data.taskHandler = 0;
         data.pstDownloadFilePartInfo = pstPara->pstDownloadFilePartInfo;
         data.xmlWriteMutex = pstPara->xmlWriteMutex;
+        data.partFileName = fileNameTemp;
+        data.stagingFileName = fileNameStaging;
+        memset_s(&cipherPart, sizeof(client_encryption_part), 0, sizeof(client_encryption_part));
 
         pstEncrypParam = pstPara->pstDownloadParams->pstServerSideEncryptionParams;
 
@@ -1019,17 +1111,36 @@ unsigned __stdcall DownloadThreadProc_win32(void* param)
         obs_get_conditions get_conditions = *(pstPara->pstDownloadParams->get_conditions);
         get_conditions.start_byte = pstPara->pstDownloadFilePartInfo->start_byte;
         get_conditions.byte_count = part_size;
-        COMMLOG(OBS_LOGINFO, "get_object partnum[%d] start:%ld size:%ld", part_num, get_conditions.start_byte, get_conditions.byte_count);
-        get_object(pstPara->pstDownloadParams->options, &object_info, &get_conditions,
-            pstPara->pstDownloadParams->pstServerSideEncryptionParams, &getObjectHandler, &data);
+        if (setDownloadPartClientEncryption(pstPara->pstDownloadParams, part_num, part_size,
+            &cipherPart, &get_conditions) != OBS_STATUS_OK)
+        {
+            downloadPartCompleteCallback(OBS_STATUS_InternalError, NULL, &data);
+        }
+        else
+        {
+            data.cipher = pstPara->pstDownloadParams->client_encryption ? &cipherPart : NULL;
+            COMMLOG(OBS_LOGINFO, "get_object partnum[%d] start:%ld size:%ld", part_num, get_conditions.start_byte, get_conditions.byte_count);
+            // 各分段拼出整个对象，压缩对象按原始数据下载，与不带范围的get_object一致
+            get_object_internal(pstPara->pstDownloadParams->options, &object_info, &get_conditions,
+                pstPara->pstDownloadParams->pstServerSideEncryptionParams, &getObjectHandler, &data, 1);
+        }
+        client_encryption_part_end(&cipherPart);
+
+        //the store file has been closed if the decrypted part was moved to the part file
+        if (data.fdStorefile != -1)
+        {
+            close(data.fdStorefile);
+            data.fdStorefile = -1;
+        }
+        if (pstPara->pstDownloadParams->client_encryption &&
+            pstPara->pstDownloadFilePartInfo->downloadStatus != DOWNLOAD_SUCCESS)
+        {
+            (void)remove_file(fileNameStaging);
+        }
     }
 
-	if (fd != -1)
-	{
-		close(fd);
-		fd = -1;
-		data.fdStorefile = -1;
-	}
+	CHECK_NULL_FREE(fileNameTemp);
+	CHECK_NULL_FREE(fileNameStaging);
 
     return 1;
 }
@@ -1044,22 +1155,20 @@ void * DownloadThreadProc_linux(void* param)
     int part_num = pstPara->pstDownloadFilePartInfo->part_num;
     char strPartNum[16] = { 0 };
     download_file_callback_data  data;
+    client_encryption_part cipherPart;
     data.fdStorefile = -1;
     int fd = -1;
-    char * fileNameTemp = (char*)malloc(1024);
-
-    if (fileNameTemp == NULL)
-    {
-        COMMLOG(OBS_LOGERROR, "malloc failed in function: %s,line %d", __FUNCTION__, __LINE__);
-        return NULL;
-    }
+    char fileNameTemp[1024];
+    char fileNameStaging[1024];
 
     int ret = sprintf_s(fileNameTemp, 1024, "%s.%d", storeFileName, part_num);
     CheckAndLogNeg(ret, "sprintf_s", __FUNCTION__, __LINE__);
+    ret = sprintf_s(fileNameStaging, 1024, "%s.%d.tmp", storeFileName, part_num);
+    CheckAndLogNeg(ret, "sprintf_s", __FUNCTION__, __LINE__);
 
-    fd = open(fileNameTemp, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
-    free(fileNameTemp);
-    fileNameTemp = NULL;
+    //a client encrypted part is decrypted into the staging file until its tag is verified
+    fd = open(pstPara->pstDownloadParams->client_encryption ? fileNameStaging : fileNameTemp,
+        O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
 
     if (fd == -1)
     {
@@ -1089,6 +1198,9 @@ void * DownloadThreadProc_linux(void* param)
         data.taskHandler = 0;
         data.pstDownloadFilePartInfo = pstPara->pstDownloadFilePartInfo;
         data.xmlWriteMutex = pstPara->xmlWriteMutex;
+        data.partFileName = fileNameTemp;
+        data.stagingFileName = fileNameStaging;
+        memset_s(&cipherPart, sizeof(client_encryption_part), 0, sizeof(client_encryption_part));
 
 
         if (data.enableCheckPoint == 1)
@@ -1116,17 +1228,33 @@ void * DownloadThreadProc_linux(void* param)
         obs_get_conditions get_conditions = *(pstPara->pstDownloadParams->get_conditions);
         get_conditions.start_byte = pstPara->pstDownloadFilePartInfo->start_byte;
         get_conditions.byte_count = part_size;
-        COMMLOG(OBS_LOGINFO, "get_object partnum[%d] start:%ld size:%ld", part_num, get_conditions.start_byte, get_conditions.byte_count);
-        get_object(pstPara->pstDownloadParams->options, &object_info, &get_conditions,
-            pstPara->pstDownloadParams->pstServerSideEncryptionParams, &getObjectHandler, &data);
+        if (setDownloadPartClientEncryption(pstPara->pstDownloadParams, part_num, part_size,
+            &cipherPart, &get_conditions) != OBS_STATUS_OK)
+        {
+            downloadPartCompleteCallback(OBS_STATUS_InternalError, NULL, &data);
+        }
+        else
+        {
+            data.cipher = pstPara->pstDownloadParams->client_encryption ? &cipherPart : NULL;
+            COMMLOG(OBS_LOGINFO, "get_object partnum[%d] start:%ld size:%ld", part_num, get_conditions.start_byte, get_conditions.byte_count);
+            // 各分段拼出整个对象，压缩对象按原始数据下载，与不带范围的get_object一致
+            get_object_internal(pstPara->pstDownloadParams->options, &object_info, &get_conditions,
+                pstPara->pstDownloadParams->pstServerSideEncryptionParams, &getObjectHandler, &data, 1);
+        }
+        client_encryption_part_end(&cipherPart);
     }
 
-    if (fd != -1)
+    //the store file has been closed if the decrypted part was moved to the part file
+    if (data.fdStorefile != -1)
     {
-        close(fd);
-        fd = -1;
+        close(data.fdStorefile);
         data.fdStorefile = -1;
     }
+    if (pstPara->pstDownloadParams->client_encryption &&
+        pstPara->pstDownloadFilePartInfo->downloadStatus != DOWNLOAD_SUCCESS)
+    {
+        (void)remove(fileNameStaging);
+    }
 
     return NULL;
 }
@@ -1875,11 +2003,14 @@ void download_file(const obs_options *options, char *key, char* version_id,
 
 
     download_params stDownloadParams;
+    client_encryption_context clientEncryption;
     COMMLOG(OBS_LOGERROR, "in DownloadFile download_file_config: partsize=%d ", download_file_config->part_size);
 
     memset_s(&downLoadFileInfo, sizeof(download_file_summary), 0, sizeof(download_file_summary));
+    memset_s(&clientEncryption, sizeof(client_encryption_context), 0, sizeof(client_encryption_context));
     //get the info of the object
-    obs_status ret_status = getObjectInfo(&downLoadFileInfo, options, key, version_id, encryption_params);
+    obs_status ret_status = getObjectInfo(&downLoadFileInfo, options, key, version_id, encryption_params,
+        download_file_config->client_encryption, &clientEncryption);
     if (OBS_STATUS_OK != ret_status)
     {
         COMMLOG(OBS_LOGERROR, "in DownloadFile Get object metadata failed(%d),bucket=%s, key=%s,version_id=%s",
@@ -1889,6 +2020,7 @@ void download_file(const obs_options *options, char *key, char* version_id,
         (void)(*(handler->response_handler.complete_callback))(ret_status, 0, callback_data);
 		CHECK_NULL_FREE(storeFile);
 		CHECK_NULL_FREE(checkpointFile);
+        client_encryption_clear(&clientEncryption);
         return;
     }
     //if the storage is glacier, restore the object firstly
@@ -1901,6 +2033,7 @@ void download_file(const obs_options *options, char *key, char* version_id,
             (void)(*(handler->response_handler.complete_callback))(ret_status, 0, callback_data);
 			CHECK_NULL_FREE(storeFile);
 			CHECK_NULL_FREE(checkpointFile);
+            client_encryption_clear(&clientEncryption);
             return;
         } 
     }
@@ -1910,6 +2043,8 @@ void download_file(const obs_options *options, char *key, char* version_id,
 		bool part_size_illegal = ((download_file_config->part_size == 0)
 			|| (download_file_config->part_size > MAX_PART_SIZE));
 		part_size = part_size_illegal ? DEFAULT_PART_SIZE : download_file_config->part_size;
+		//the parts must match the encrypted parts of the upload
+		part_size = download_file_config->client_encryption ? clientEncryption.part_size : part_size;
 		part_size = part_size > downLoadFileInfo.objectLength ? downLoadFileInfo.objectLength : part_size;
 		download_file_part_info_mem_size = get_malloc_size_for_download_file_part_info(&downLoadFileInfo, part_size);
 		
@@ -1940,6 +2075,7 @@ void download_file(const obs_options *options, char *key, char* version_id,
 			CHECK_NULL_FREE(storeFile);
 			CHECK_NULL_FREE(checkpointFile);
 			checkAndXmlFreeDoc(&doc);
+			client_encryption_clear(&clientEncryption);
 			return;
 		}
 		errno_t err = memset_s(pstDownloadFilePartInfoListOrigin, download_file_part_info_mem_size, 0, download_file_part_info_mem_size);
@@ -1950,6 +2086,7 @@ void download_file(const obs_options *options, char *key, char* version_id,
 			CHECK_NULL_FREE(checkpointFile);
 			CHECK_NULL_FREE(pstDownloadFilePartInfoListOrigin);
 			checkAndXmlFreeDoc(&doc);
+			client_encryption_clear(&clientEncryption);
 			return;
 		}
 
@@ -1976,6 +2113,7 @@ void download_file(const obs_options *options, char *key, char* version_id,
 			CHECK_NULL_FREE(storeFile);
 			CHECK_NULL_FREE(checkpointFile);
 			CHECK_NULL_FREE(pstDownloadFilePartInfoListOrigin);
+			client_encryption_clear(&clientEncryption);
 			return;
 		}
 		retVal = setDownloadpartList(&downLoadFileInfo, part_size, &pstDownloadFilePartInfoList, &partCount);
@@ -1988,6 +2126,7 @@ void download_file(const obs_options *options, char *key, char* version_id,
 			CHECK_NULL_FREE(storeFile);
 			CHECK_NULL_FREE(checkpointFile);
 			CHECK_NULL_FREE(pstDownloadFilePartInfoListOrigin);
+			client_encryption_clear(&clientEncryption);
 			return;
 		}
     }
@@ -2014,6 +2153,8 @@ void download_file(const obs_options *options, char *key, char* version_id,
     stDownloadParams.pstServerSideEncryptionParams = encryption_params;
     stDownloadParams.response_handler = &(handler->response_handler);
     stDownloadParams.get_conditions = get_conditions;
+    stDownloadParams.client_encryption = download_file_config->client_encryption ? &clientEncryption : NULL;
+    stDownloadParams.objectLength = downLoadFileInfo.objectLength;
     download_file_config->task_num = download_file_config->task_num == 0 ? MAX_THREAD_NUM :
         download_file_config->task_num;
     partCountToProc = 0;
@@ -2027,6 +2168,7 @@ void download_file(const obs_options *options, char *key, char* version_id,
     partCountToProc = download_file_linux(download_file_config, pstPartInfoListDone, pstPartInfoListNotDone,
         stDownloadParams, partCountToProc, checkpointFile, handler, callback_data, storeFile, partCount);
 #endif
+    client_encryption_clear(&clientEncryption);
 	CHECK_NULL_FREE(storeFile);
 	CHECK_NULL_FREE(checkpointFile);
 	CHECK_NULL_FREE(pstDownloadFilePartInfoListOrigin);
@@ -0,0 +1,1070 @@
+/*********************************************************************************
+* Copyright 2024 Huawei Technologies Co.,Ltd.
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+* this file except in compliance with the License.  You may obtain a copy of the
+* License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed
+* under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+* CONDITIONS OF ANY KIND, either express or implied.  See the License for the
+* specific language governing permissions and limitations under the License.
+**********************************************************************************
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "eSDKOBS.h"
+#include "securec.h"
+#include "object.h"
+#include "request_util.h"
+#include "metrics.h"
+#include "file_utils.h"
+
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if defined WIN32
+#include <io.h>
+#include <process.h>
+#endif
+
+#if defined __GNUC__ || defined LINUX
+#include <unistd.h>
+#include <pthread.h>
+#endif
+
+#define DLM_DEFAULT_PART_SIZE       (8 * 1024 * 1024)
+#define DLM_DEFAULT_TASK_NUM        8
+#define DLM_MAX_TASK_NUM            64
+#define DLM_RETRY_BASE_MS           100
+#define DLM_RETRY_MAX_MS            3200
+#define DLM_TEMP_SUFFIX             ".obsdl"
+#define DLM_PATH_SIZE               (OBS_MAX_KEY_SIZE + 16)
+#define DLM_JOURNAL_HEADER          "#obs-download-journal v1"
+#define DLM_JOURNAL_LINE_SIZE       (OBS_MAX_KEY_SIZE + 128)
+
+#define DLM_STATE_PENDING           0         // 等待HEAD获取大小
+#define DLM_STATE_READY             1         // 大小已知，等待下载分段
+#define DLM_STATE_DONE              2
+#define DLM_STATE_FAILED            3
+
+#define DLM_PHASE_HEAD              0
+#define DLM_PHASE_PART              1
+
+/**
+ * 单个对象的下载状态，分段写入目标文件旁的临时文件，全部完成后rename
+ */
+typedef struct dlm_object
+{
+    uint64_t size;
+    uint64_t part_count;
+    uint64_t parts_left;                      // 尚未写入的分段数
+    unsigned char *part_done;                 // 日志中已完成分段的位图，没有时为NULL
+    char etag[MAX_SIZE_ETAG];                 // 分段请求携带If-Match，防止对象在续传之间被覆盖
+    int state;
+    int journaled;                            // 日志中已有该对象的大小记录
+} dlm_object;
+
+/**
+ * 调度顺序，按对象大小升序，小对象先完成以重叠请求时延
+ */
+typedef struct dlm_order
+{
+    uint64_t size;
+    unsigned int index;
+} dlm_order;
+
+typedef struct dlm_context
+{
+    const obs_options *options;
+    obs_download_objects_configuration *config;
+    obs_download_objects_summary *summary;
+    uint64_t part_size;
+    dlm_object *objects;
+    dlm_order *order;
+    unsigned int order_count;
+    unsigned int next_order;
+    uint64_t next_part;
+    int phase;
+    uint64_t done_bytes;
+    uint64_t done_count;
+    FILE *journal;
+    char journal_tmp_file[DLM_PATH_SIZE];
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_t mutex;
+#else
+    CRITICAL_SECTION mutex;
+#endif
+} dlm_context;
+
+/**
+ * 单次请求的回调数据
+ */
+typedef struct dlm_call
+{
+    int fd;
+    uint64_t expected;
+    uint64_t offset;
+    obs_status status;
+    obs_status write_status;
+    uint64_t content_length;
+    char etag[MAX_SIZE_ETAG];
+} dlm_call;
+
+static void dlm_lock(dlm_context *context)
+{
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_lock(&context->mutex);
+#else
+    EnterCriticalSection(&context->mutex);
+#endif
+}
+
+static void dlm_unlock(dlm_context *context)
+{
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_unlock(&context->mutex);
+#else
+    LeaveCriticalSection(&context->mutex);
+#endif
+}
+
+static int dlm_part_done(const dlm_object *object, uint64_t part)
+{
+    return object->part_done != NULL && (object->part_done[part / 8] & (1u << (part % 8))) != 0;
+}
+
+static void dlm_set_size(dlm_object *object, uint64_t size, uint64_t part_size)
+{
+    object->size = size;
+    object->part_count = size > part_size ? (size + part_size - 1) / part_size : 1;
+    object->parts_left = object->part_count;
+    CHECK_NULL_FREE(object->part_done);
+}
+
+static uint64_t dlm_part_length(const dlm_object *object, uint64_t part, uint64_t part_size)
+{
+    uint64_t start = part * part_size;
+    return object->size - start < part_size ? object->size - start : part_size;
+}
+
+static int dlm_temp_path(const obs_download_object_item *item, char *path)
+{
+    return snprintf_s(path, DLM_PATH_SIZE, _TRUNCATE, "%s%s", item->file_name, DLM_TEMP_SUFFIX) < 0 ? -1 : 0;
+}
+
+/* 数据落盘后才能记入日志或rename，否则掉电后续传会跳过内容丢失的分段 */
+static int dlm_sync_fd(int fd)
+{
+#if defined WIN32
+    return _commit(fd);
+#else
+    return fsync(fd);
+#endif
+}
+
+static int dlm_sync_file(FILE *fp)
+{
+    if (fflush(fp) != 0) {
+        return -1;
+    }
+#if defined WIN32
+    return dlm_sync_fd(_fileno(fp));
+#else
+    return dlm_sync_fd(fileno(fp));
+#endif
+}
+
+/************************************************************************************
+ * 续传日志
+ ************************************************************************************/
+/**
+ * 日志每行一条记录，追加写入：
+ * O index size etag key  对象大小已知，之后的分段以此为准
+ * P index part           分段已写入临时文件
+ * D index                对象已完成
+ * X index                对象已失效，丢弃之前的记录
+ */
+static void dlm_journal_apply(dlm_context *context, char *line)
+{
+    obs_download_objects_configuration *config = context->config;
+    char type = line[0];
+    char *cursor = line + 1;
+    char *end = NULL;
+    unsigned long long index;
+    dlm_object *object;
+
+    if (type == '\0' || *cursor != ' ') {
+        return;
+    }
+    cursor++;
+    index = strtoull(cursor, &end, 10);
+    if (end == cursor || index >= config->item_count) {
+        return;
+    }
+    object = &context->objects[index];
+    cursor = end;
+
+    if (type == 'O') {
+        unsigned long long size;
+        char *etag;
+        size_t etag_len;
+        if (*cursor != ' ') {
+            return;
+        }
+        cursor++;
+        size = strtoull(cursor, &end, 10);
+        if (end == cursor || *end != ' ') {
+            return;
+        }
+        etag = end + 1;
+        cursor = strchr(etag, ' ');
+        if (cursor == NULL) {
+            return;
+        }
+        etag_len = (size_t)(cursor - etag);
+        if (etag_len >= MAX_SIZE_ETAG || strcmp(cursor + 1, config->items[index].key) != 0) {
+            return;
+        }
+        dlm_set_size(object, (uint64_t)size, context->part_size);
+        memcpy_s(object->etag, MAX_SIZE_ETAG, etag, etag_len);
+        object->etag[etag_len] = '\0';
+        if (etag_len == 1 && etag[0] == '-') {
+            object->etag[0] = '\0';
+        }
+        object->state = DLM_STATE_READY;
+        object->journaled = 1;
+    }
+    else if (type == 'P' && object->journaled && object->state == DLM_STATE_READY) {
+        unsigned long long part;
+        if (*cursor != ' ') {
+            return;
+        }
+        cursor++;
+        part = strtoull(cursor, &end, 10);
+        if (end == cursor || part >= object->part_count || dlm_part_done(object, part)) {
+            return;
+        }
+        if (object->part_done == NULL) {
+            object->part_done = (unsigned char *)calloc((size_t)(object->part_count / 8 + 1), 1);
+            if (object->part_done == NULL) {
+                return;
+            }
+        }
+        object->part_done[part / 8] |= (unsigned char)(1u << (part % 8));
+        object->parts_left--;
+    }
+    else if (type == 'D' && object->journaled) {
+        object->state = DLM_STATE_DONE;
+    }
+    else if (type == 'X') {
+        CHECK_NULL_FREE(object->part_done);
+        memset_s(object, sizeof(dlm_object), 0, sizeof(dlm_object));
+    }
+}
+
+static void dlm_journal_load(dlm_context *context)
+{
+    FILE *fp = NULL;
+    char *line = NULL;
+
+    if (file_fopen_s(&fp, context->config->journal_file, "r") != 0 || fp == NULL) {
+        return;
+    }
+    line = (char *)malloc(DLM_JOURNAL_LINE_SIZE);
+    if (line == NULL) {
+        fclose(fp);
+        return;
+    }
+    // 首行记录分段大小，续传必须沿用，否则日志中的分段编号无意义
+    if (fgets(line, DLM_JOURNAL_LINE_SIZE, fp) == NULL ||
+        strncmp(line, DLM_JOURNAL_HEADER " ", strlen(DLM_JOURNAL_HEADER) + 1) != 0) {
+        COMMLOG(OBS_LOGWARN, "%s: journal[%s] is invalid, ignored", __FUNCTION__, context->config->journal_file);
+        free(line);
+        fclose(fp);
+        return;
+    }
+    {
+        uint64_t part_size = strtoull(line + strlen(DLM_JOURNAL_HEADER) + 1, NULL, 10);
+        if (part_size > 0 && part_size <= MAX_PART_SIZE) {
+            context->part_size = part_size;
+        }
+    }
+    while (fgets(line, DLM_JOURNAL_LINE_SIZE, fp) != NULL) {
+        size_t line_len = strlen(line);
+        // 末尾不完整的行说明上次写日志时中断，丢弃
+        if (line_len == 0 || line[line_len - 1] != '\n') {
+            break;
+        }
+        while (line_len > 0 && (line[line_len - 1] == '\n' || line[line_len - 1] == '\r')) {
+            line[--line_len] = '\0';
+        }
+        dlm_journal_apply(context, line);
+    }
+    free(line);
+    fclose(fp);
+}
+
+static int dlm_journal_write_object(FILE *fp, const dlm_context *context, unsigned int index)
+{
+    const dlm_object *object = &context->objects[index];
+    uint64_t part;
+
+    if (!object->journaled) {
+        return 0;
+    }
+    if (fprintf(fp, "O %u %llu %s %s\n", index, (unsigned long long)object->size,
+        object->etag[0] ? object->etag : "-", context->config->items[index].key) < 0) {
+        return -1;
+    }
+    if (object->state == DLM_STATE_DONE) {
+        return fprintf(fp, "D %u\n", index) < 0 ? -1 : 0;
+    }
+    for (part = 0; object->part_done != NULL && part < object->part_count; part++) {
+        if (dlm_part_done(object, part) && fprintf(fp, "P %u %llu\n", index, (unsigned long long)part) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * 按当前状态重写紧凑的日志后以追加方式打开，先写临时文件再rename
+ */
+static obs_status dlm_journal_open(dlm_context *context)
+{
+    const char *journal_file = context->config->journal_file;
+    FILE *fp = NULL;
+    unsigned int i;
+    int ret = 0;
+
+    if (snprintf_s(context->journal_tmp_file, sizeof(context->journal_tmp_file), _TRUNCATE, "%s.tmp",
+        journal_file) < 0) {
+        return OBS_STATUS_InvalidParameter;
+    }
+    make_parent_dirs(context->journal_tmp_file);
+    if (file_fopen_s(&fp, context->journal_tmp_file, "w") != 0 || fp == NULL) {
+        COMMLOG(OBS_LOGERROR, "%s: open journal[%s] failed", __FUNCTION__, context->journal_tmp_file);
+        return OBS_STATUS_OpenFileFailed;
+    }
+    if (fprintf(fp, "%s %llu\n", DLM_JOURNAL_HEADER, (unsigned long long)context->part_size) < 0) {
+        ret = -1;
+    }
+    for (i = 0; i < context->config->item_count && ret == 0; i++) {
+        ret = dlm_journal_write_object(fp, context, i);
+    }
+    if (ret == 0 && dlm_sync_file(fp) != 0) {
+        ret = -1;
+    }
+    if (fclose(fp) != 0) {
+        ret = -1;
+    }
+    if (ret == 0) {
+#if defined WIN32
+        (void)remove_file(journal_file);
+#endif
+        ret = rename(context->journal_tmp_file, journal_file);
+    }
+    if (ret == 0 && (file_fopen_s(&context->journal, journal_file, "a") != 0 || context->journal == NULL)) {
+        ret = -1;
+    }
+    if (ret != 0) {
+        COMMLOG(OBS_LOGERROR, "%s: write journal[%s] failed", __FUNCTION__, journal_file);
+        (void)remove_file(context->journal_tmp_file);
+        return OBS_STATUS_OpenFileFailed;
+    }
+    return OBS_STATUS_OK;
+}
+
+/* 追加一条记录，调用时需持有锁 */
+static void dlm_journal_append(dlm_context *context, char type, unsigned int index, uint64_t value)
+{
+    dlm_object *object = &context->objects[index];
+    int ret;
+
+    if (context->journal == NULL) {
+        return;
+    }
+    if (type == 'O') {
+        ret = fprintf(context->journal, "O %u %llu %s %s\n", index, (unsigned long long)object->size,
+            object->etag[0] ? object->etag : "-", context->config->items[index].key);
+    }
+    else if (type == 'P') {
+        ret = fprintf(context->journal, "P %u %llu\n", index, (unsigned long long)value);
+    }
+    else {
+        ret = fprintf(context->journal, "%c %u\n", type, index);
+    }
+    if (ret < 0 || dlm_sync_file(context->journal) != 0) {
+        COMMLOG(OBS_LOGWARN, "%s: append journal failed, resume may download again", __FUNCTION__);
+    }
+}
+
+/************************************************************************************
+ * 请求
+ ************************************************************************************/
+static int dlm_should_retry(dlm_context *context, obs_status status, unsigned int attempts)
+{
+    if (attempts > context->config->max_retries) {
+        return 0;
+    }
+    return obs_status_is_retryable(status) || status == OBS_STATUS_SlowDown ||
+        status == OBS_STATUS_ServiceUnavailable;
+}
+
+static void dlm_backoff(dlm_context *context, unsigned int attempts)
+{
+    unsigned int wait_ms = DLM_RETRY_BASE_MS << (attempts < 6 ? attempts - 1 : 5);
+    if (wait_ms > DLM_RETRY_MAX_MS) {
+        wait_ms = DLM_RETRY_MAX_MS;
+    }
+    dlm_lock(context);
+    context->summary->retry_count++;
+    dlm_unlock(context);
+#if defined WIN32
+    Sleep(wait_ms);
+#else
+    usleep(wait_ms * 1000);
+#endif
+}
+
+static obs_status dlm_properties_callback(const obs_response_properties *properties, void *callback_data)
+{
+    dlm_call *call = (dlm_call *)callback_data;
+    call->content_length = properties->content_length;
+    if (properties->etag != NULL) {
+        int ret = snprintf_s(call->etag, sizeof(call->etag), _TRUNCATE, "%s", properties->etag);
+        CheckAndLogNeg(ret, "snprintf_s", __FUNCTION__, __LINE__);
+    }
+    return OBS_STATUS_OK;
+}
+
+static void dlm_complete_callback(obs_status status, const obs_error_details *error, void *callback_data)
+{
+    dlm_call *call = (dlm_call *)callback_data;
+    (void)error;
+    call->status = status;
+}
+
+static obs_status dlm_data_callback(int buffer_size, const char *buffer, void *callback_data)
+{
+    dlm_call *call = (dlm_call *)callback_data;
+    if ((uint64_t)buffer_size > call->expected - call->offset) {
+        COMMLOG(OBS_LOGERROR, "%s: response is longer than %llu bytes", __FUNCTION__,
+            (unsigned long long)call->expected);
+        call->write_status = OBS_STATUS_InvalidRange;
+        return call->write_status;
+    }
+    while (buffer_size > 0) {
+        int ret;
+#if defined WIN32
+        ret = _write(call->fd, buffer, (unsigned int)buffer_size);
+#else
+        ret = (int)write(call->fd, buffer, (size_t)buffer_size);
+#endif
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret <= 0) {
+            COMMLOG(OBS_LOGERROR, "%s: write failed, errno %d", __FUNCTION__, errno);
+            call->write_status = OBS_STATUS_OpenFileFailed;
+            return call->write_status;
+        }
+        buffer += ret;
+        buffer_size -= ret;
+        call->offset += (uint64_t)ret;
+    }
+    return OBS_STATUS_OK;
+}
+
+static obs_status dlm_head(dlm_context *context, unsigned int index)
+{
+    obs_download_object_item *item = &context->config->items[index];
+    dlm_object *object = &context->objects[index];
+    obs_response_handler handler = {&dlm_properties_callback, &dlm_complete_callback};
+    obs_object_info object_info = {item->key, item->version_id};
+    dlm_call call;
+    unsigned int attempts = 0;
+
+    for (;;) {
+        memset_s(&call, sizeof(call), 0, sizeof(call));
+        call.status = OBS_STATUS_BUTT;
+        attempts++;
+        // 取到的ETag用作分段GET的If-Match，不能来自可能过期的元数据缓存
+        get_object_metadata_internal(context->options, &object_info, context->config->encryption_params, &handler,
+            &call, 0);
+        if (call.status == OBS_STATUS_OK || !dlm_should_retry(context, call.status, attempts)) {
+            break;
+        }
+        dlm_backoff(context, attempts);
+    }
+    if (call.status == OBS_STATUS_OK) {
+        dlm_set_size(object, call.content_length, context->part_size);
+        memcpy_s(object->etag, MAX_SIZE_ETAG, call.etag, sizeof(call.etag));
+    }
+    return call.status;
+}
+
+/**
+ * 下载第part段写入临时文件的对应位置，不超过一段的对象不带Range请求
+ */
+static obs_status dlm_fetch_part(dlm_context *context, unsigned int index, uint64_t part, const char *temp_path)
+{
+    obs_download_object_item *item = &context->config->items[index];
+    dlm_object *object = &context->objects[index];
+    obs_get_object_handler handler = {
+        {&dlm_properties_callback, &dlm_complete_callback}, &dlm_data_callback
+    };
+    obs_object_info object_info = {item->key, item->version_id};
+    obs_get_conditions conditions;
+    uint64_t start = part * context->part_size;
+    uint64_t length = dlm_part_length(object, part, context->part_size);
+    dlm_call call;
+    unsigned int attempts = 0;
+    int fd = -1;
+
+#if defined __GNUC__ || defined LINUX
+    fd = open(temp_path, O_WRONLY | O_CREAT, S_IRUSR | S_IWUSR);
+#else
+    (void)file_sopen_s(&fd, temp_path, _O_BINARY | _O_WRONLY | _O_CREAT, _SH_DENYNO, _S_IREAD | _S_IWRITE);
+#endif
+    if (fd == -1) {
+        COMMLOG(OBS_LOGERROR, "%s: open file[%s] failed, errno %d", __FUNCTION__, temp_path, errno);
+        return OBS_STATUS_OpenFileFailed;
+    }
+    if (length == 0) {
+        close(fd);
+        return OBS_STATUS_OK;
+    }
+    init_get_properties(&conditions);
+    if (object->part_count > 1) {
+        conditions.start_byte = start;
+        conditions.byte_count = length;
+    }
+    if (object->etag[0] != '\0') {
+        conditions.if_match_etag = object->etag;
+    }
+    for (;;) {
+        memset_s(&call, sizeof(call), 0, sizeof(call));
+        call.fd = fd;
+        call.expected = length;
+        call.status = OBS_STATUS_BUTT;
+        attempts++;
+#if defined WIN32
+        if (_lseeki64(fd, (long long)start, SEEK_SET) < 0) {
+#else
+        if (lseek(fd, (off_t)start, SEEK_SET) < 0) {
+#endif
+            call.status = OBS_STATUS_OpenFileFailed;
+            break;
+        }
+        metrics_set_retry(OBS_METRICS_OP_GET_OBJECT, attempts - 1);
+        // 分段拼出整个对象，压缩对象按HEAD得到的大小下载原始数据
+        get_object_internal(context->options, &object_info, &conditions, context->config->encryption_params,
+            &handler, &call, 1);
+        if (call.write_status != OBS_STATUS_OK) {
+            call.status = call.write_status;
+            break;
+        }
+        if (call.status == OBS_STATUS_OK && call.offset != length) {
+            call.status = OBS_STATUS_PartialFile;
+        }
+        if (call.status == OBS_STATUS_OK || !dlm_should_retry(context, call.status, attempts)) {
+            break;
+        }
+        COMMLOG(OBS_LOGWARN, "%s: retry %s part %llu, status %s", __FUNCTION__, item->key,
+            (unsigned long long)part, obs_get_status_name(call.status));
+        dlm_backoff(context, attempts);
+    }
+    metrics_set_retry(OBS_METRICS_OP_GET_OBJECT, 0);
+    // 分段记入日志前必须已落盘
+    if (call.status == OBS_STATUS_OK && dlm_sync_fd(fd) != 0) {
+        COMMLOG(OBS_LOGERROR, "%s: sync file[%s] failed, errno %d", __FUNCTION__, temp_path, errno);
+        call.status = OBS_STATUS_OpenFileFailed;
+    }
+    close(fd);
+    if (call.status == OBS_STATUS_OK) {
+        dlm_lock(context);
+        context->summary->downloaded_bytes += length;
+        context->summary->part_count++;
+        context->done_bytes += length;
+        dlm_unlock(context);
+    }
+    return call.status;
+}
+
+/************************************************************************************
+ * 调度
+ ************************************************************************************/
+static void dlm_report(dlm_context *context, unsigned int index, obs_status status)
+{
+    obs_download_objects_configuration *config = context->config;
+    uint64_t done_bytes;
+    uint64_t total_bytes;
+    uint64_t done_count;
+
+    dlm_lock(context);
+    done_bytes = context->done_bytes;
+    total_bytes = context->summary->total_bytes;
+    done_count = context->done_count;
+    dlm_unlock(context);
+    if (index < config->item_count && config->complete_callback) {
+        config->complete_callback(status, &config->items[index], config->callback_data);
+    }
+    if (config->progress_callback) {
+        config->progress_callback(done_bytes, total_bytes, done_count, config->item_count,
+            config->callback_data);
+    }
+}
+
+/**
+ * 对象失败只记录一次，其余进行中的分段完成后被忽略
+ */
+static void dlm_fail_object(dlm_context *context, unsigned int index, obs_status status)
+{
+    dlm_object *object = &context->objects[index];
+    obs_download_objects_summary *summary = context->summary;
+    int report = 0;
+
+    dlm_lock(context);
+    if (object->state != DLM_STATE_FAILED) {
+        object->state = DLM_STATE_FAILED;
+        summary->failed_count++;
+        context->done_count++;
+        if (summary->first_error_status == OBS_STATUS_OK) {
+            summary->first_error_status = status;
+            (void)snprintf_s(summary->first_error_key, sizeof(summary->first_error_key), _TRUNCATE, "%s",
+                context->config->items[index].key);
+        }
+        if (status == OBS_STATUS_PreconditionFailed) {
+            // 对象已被覆盖，已下载的分段不再可用
+            dlm_journal_append(context, 'X', index, 0);
+        }
+        report = 1;
+    }
+    dlm_unlock(context);
+    if (report) {
+        COMMLOG(OBS_LOGERROR, "%s: download %s failed, status %s", __FUNCTION__, context->config->items[index].key,
+            obs_get_status_name(status));
+        dlm_report(context, index, status);
+    }
+}
+
+static obs_status dlm_finish_object(dlm_context *context, unsigned int index, const char *temp_path)
+{
+    obs_download_object_item *item = &context->config->items[index];
+    dlm_object *object = &context->objects[index];
+    int fd = -1;
+
+    // rename前再落盘一次，覆盖空对象及续传时由上次进程写入的分段；临时文件缺失时不能创建空文件顶替
+#if defined __GNUC__ || defined LINUX
+    fd = open(temp_path, O_WRONLY);
+#else
+    (void)file_sopen_s(&fd, temp_path, _O_BINARY | _O_WRONLY, _SH_DENYNO, _S_IREAD | _S_IWRITE);
+#endif
+    if (fd == -1 || dlm_sync_fd(fd) != 0) {
+        COMMLOG(OBS_LOGERROR, "%s: sync file[%s] failed, errno %d", __FUNCTION__, temp_path, errno);
+        if (fd != -1) {
+            close(fd);
+        }
+        return OBS_STATUS_OpenFileFailed;
+    }
+    close(fd);
+#if defined WIN32
+    (void)remove_file(item->file_name);
+#endif
+    if (rename(temp_path, item->file_name) != 0) {
+        COMMLOG(OBS_LOGERROR, "%s: rename to %s failed, errno %d", __FUNCTION__, item->file_name, errno);
+        return OBS_STATUS_OpenFileFailed;
+    }
+    dlm_lock(context);
+    object->state = DLM_STATE_DONE;
+    context->summary->success_count++;
+    context->done_count++;
+    dlm_journal_append(context, 'D', index, 0);
+    dlm_unlock(context);
+    dlm_report(context, index, OBS_STATUS_OK);
+    return OBS_STATUS_OK;
+}
+
+static void dlm_run_head(dlm_context *context, unsigned int index, char *temp_path)
+{
+    dlm_object *object = &context->objects[index];
+    obs_status status = dlm_head(context, index);
+
+    if (status == OBS_STATUS_OK && dlm_temp_path(&context->config->items[index], temp_path) != 0) {
+        status = OBS_STATUS_UriTooLong;
+    }
+    if (status != OBS_STATUS_OK) {
+        dlm_fail_object(context, index, status);
+        return;
+    }
+    // 新开始的对象丢弃之前残留的临时文件
+    make_parent_dirs(temp_path);
+    (void)remove(temp_path);
+    dlm_lock(context);
+    object->state = DLM_STATE_READY;
+    object->journaled = 1;
+    context->summary->total_bytes += object->size;
+    dlm_journal_append(context, 'O', index, 0);
+    dlm_unlock(context);
+}
+
+static void dlm_run_part(dlm_context *context, unsigned int index, uint64_t part, char *temp_path)
+{
+    dlm_object *object = &context->objects[index];
+    obs_status status = OBS_STATUS_OK;
+    int last = 0;
+
+    if (dlm_temp_path(&context->config->items[index], temp_path) != 0) {
+        status = OBS_STATUS_UriTooLong;
+    }
+    else {
+        status = dlm_fetch_part(context, index, part, temp_path);
+    }
+    if (status != OBS_STATUS_OK) {
+        dlm_fail_object(context, index, status);
+        return;
+    }
+    dlm_lock(context);
+    // 对象其他分段失败时已写入的分段仍可续传，对象失效时之前的X记录会使其被忽略
+    dlm_journal_append(context, 'P', index, part);
+    if (object->state == DLM_STATE_READY) {
+        object->parts_left--;
+        last = object->parts_left == 0;
+    }
+    dlm_unlock(context);
+    if (last) {
+        status = dlm_finish_object(context, index, temp_path);
+        if (status != OBS_STATUS_OK) {
+            dlm_fail_object(context, index, status);
+        }
+    }
+}
+
+/**
+ * 取下一个任务，HEAD阶段返回对象，分段阶段按order依次返回未完成对象的未完成分段
+ */
+static int dlm_next_task(dlm_context *context, unsigned int *index, uint64_t *part)
+{
+    int found = 0;
+    dlm_lock(context);
+    while (!found && context->next_order < context->order_count) {
+        unsigned int current = context->order[context->next_order].index;
+        dlm_object *object = &context->objects[current];
+        if (context->phase == DLM_PHASE_HEAD) {
+            context->next_order++;
+            if (object->state == DLM_STATE_PENDING) {
+                *index = current;
+                found = 1;
+            }
+            continue;
+        }
+        if (object->state != DLM_STATE_READY || context->next_part >= object->part_count) {
+            context->next_order++;
+            context->next_part = 0;
+            continue;
+        }
+        if (!dlm_part_done(object, context->next_part)) {
+            *index = current;
+            *part = context->next_part;
+            found = 1;
+        }
+        context->next_part++;
+    }
+    dlm_unlock(context);
+    return found;
+}
+
+static void dlm_worker(dlm_context *context)
+{
+    char *temp_path = (char *)malloc(DLM_PATH_SIZE);
+    unsigned int index = 0;
+    uint64_t part = 0;
+
+    if (temp_path == NULL) {
+        return;
+    }
+    while (dlm_next_task(context, &index, &part)) {
+        if (context->phase == DLM_PHASE_HEAD) {
+            dlm_run_head(context, index, temp_path);
+        }
+        else {
+            dlm_run_part(context, index, part, temp_path);
+        }
+    }
+    free(temp_path);
+}
+
+#if defined __GNUC__ || defined LINUX
+static void *dlm_worker_linux(void *arg)
+{
+    dlm_worker((dlm_context *)arg);
+    return NULL;
+}
+#else
+static unsigned __stdcall dlm_worker_win32(void *arg)
+{
+    dlm_worker((dlm_context *)arg);
+    return 0;
+}
+#endif
+
+static void dlm_run_phase(dlm_context *context, int phase, int task_num)
+{
+    int started = 0;
+    int i;
+
+    context->phase = phase;
+    context->next_order = 0;
+    context->next_part = 0;
+#if defined __GNUC__ || defined LINUX
+    pthread_t threads[DLM_MAX_TASK_NUM];
+    for (i = 0; i < task_num; i++) {
+        if (pthread_create(&threads[started], NULL, dlm_worker_linux, context) == 0) {
+            started++;
+        }
+    }
+    if (started == 0) {
+        dlm_worker(context);
+    }
+    for (i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+#else
+    HANDLE threads[DLM_MAX_TASK_NUM];
+    for (i = 0; i < task_num; i++) {
+        threads[started] = (HANDLE)_beginthreadex(NULL, 0, dlm_worker_win32, context, 0, NULL);
+        if (threads[started] != 0) {
+            started++;
+        }
+    }
+    if (started == 0) {
+        dlm_worker(context);
+    }
+    for (i = 0; i < started; i++) {
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+    }
+#endif
+}
+
+static int dlm_order_compare(const void *left, const void *right)
+{
+    const dlm_order *a = (const dlm_order *)left;
+    const dlm_order *b = (const dlm_order *)right;
+    if (a->size != b->size) {
+        return a->size < b->size ? -1 : 1;
+    }
+    return a->index < b->index ? -1 : (a->index > b->index ? 1 : 0);
+}
+
+/**
+ * 核对日志恢复的对象：已完成的确认目标文件存在，未完成的确认临时文件仍在，否则重新下载
+ */
+static void dlm_check_resumed(dlm_context *context, char *temp_path)
+{
+    obs_download_objects_summary *summary = context->summary;
+    unsigned int i;
+
+    for (i = 0; i < context->config->item_count; i++) {
+        obs_download_object_item *item = &context->config->items[i];
+        dlm_object *object = &context->objects[i];
+        struct stat st;
+        uint64_t part;
+
+        if (!object->journaled) {
+            continue;
+        }
+        if (object->state == DLM_STATE_DONE) {
+            if (stat(item->file_name, &st) == 0 && (uint64_t)st.st_size == object->size) {
+                summary->resumed_count++;
+                summary->success_count++;
+                summary->total_bytes += object->size;
+                context->done_bytes += object->size;
+                context->done_count++;
+                continue;
+            }
+            object->state = DLM_STATE_READY;
+        }
+        if (object->part_done != NULL &&
+            (dlm_temp_path(item, temp_path) != 0 || stat(temp_path, &st) != 0)) {
+            CHECK_NULL_FREE(object->part_done);
+        }
+        if (object->part_done == NULL) {
+            object->parts_left = object->part_count;
+        }
+        summary->total_bytes += object->size;
+        for (part = 0; object->part_done != NULL && part < object->part_count; part++) {
+            if (dlm_part_done(object, part)) {
+                context->done_bytes += dlm_part_length(object, part, context->part_size);
+            }
+        }
+    }
+}
+
+/* 日志记录分段都已完成但未rename的对象，直接完成 */
+static void dlm_finish_resumed(dlm_context *context, char *temp_path)
+{
+    unsigned int i;
+    for (i = 0; i < context->config->item_count; i++) {
+        dlm_object *object = &context->objects[i];
+        if (object->state == DLM_STATE_READY && object->parts_left == 0 &&
+            dlm_temp_path(&context->config->items[i], temp_path) == 0) {
+            if (dlm_finish_object(context, i, temp_path) != OBS_STATUS_OK) {
+                dlm_fail_object(context, i, OBS_STATUS_OpenFileFailed);
+            }
+        }
+    }
+}
+
+static void dlm_build_order(dlm_context *context)
+{
+    unsigned int i;
+    context->order_count = 0;
+    for (i = 0; i < context->config->item_count; i++) {
+        if (context->objects[i].state == DLM_STATE_PENDING || context->objects[i].state == DLM_STATE_READY) {
+            context->order[context->order_count].size = context->objects[i].size;
+            context->order[context->order_count].index = i;
+            context->order_count++;
+        }
+    }
+}
+
+static obs_status dlm_download(dlm_context *context, char *temp_path)
+{
+    obs_download_objects_configuration *config = context->config;
+    int task_num = config->task_num > 0 ? config->task_num : DLM_DEFAULT_TASK_NUM;
+    obs_status status;
+
+    if (task_num > DLM_MAX_TASK_NUM) {
+        task_num = DLM_MAX_TASK_NUM;
+    }
+    if (config->journal_file != NULL) {
+        dlm_journal_load(context);
+        dlm_check_resumed(context, temp_path);
+        status = dlm_journal_open(context);
+        if (status != OBS_STATUS_OK) {
+            return status;
+        }
+    }
+    dlm_finish_resumed(context, temp_path);
+
+    dlm_build_order(context);
+    dlm_run_phase(context, DLM_PHASE_HEAD, task_num);
+
+    dlm_build_order(context);
+    qsort(context->order, context->order_count, sizeof(dlm_order), dlm_order_compare);
+    COMMLOG(OBS_LOGINFO, "%s: %u objects, %llu bytes, %u to download", __FUNCTION__, config->item_count,
+        (unsigned long long)context->summary->total_bytes, context->order_count);
+    dlm_run_phase(context, DLM_PHASE_PART, task_num);
+    return context->summary->first_error_status;
+}
+
+void init_download_objects_configuration(obs_download_objects_configuration *config)
+{
+    if (config == NULL) {
+        return;
+    }
+    memset_s(config, sizeof(obs_download_objects_configuration), 0, sizeof(obs_download_objects_configuration));
+    config->max_retries = 3;
+}
+
+obs_status download_objects(const obs_options *options, obs_download_objects_configuration *config,
+    obs_download_objects_summary *summary)
+{
+    dlm_context *context = NULL;
+    char *temp_path = NULL;
+    obs_status status;
+    unsigned int i;
+
+    if (options == NULL || config == NULL || summary == NULL || (config->items == NULL && config->item_count > 0)) {
+        COMMLOG(OBS_LOGERROR, "%s: invalid parameter", __FUNCTION__);
+        return OBS_STATUS_InvalidParameter;
+    }
+    for (i = 0; i < config->item_count; i++) {
+        if (config->items[i].key == NULL || config->items[i].file_name == NULL) {
+            COMMLOG(OBS_LOGERROR, "%s: item %u has no key or file_name", __FUNCTION__, i);
+            return OBS_STATUS_InvalidParameter;
+        }
+    }
+    if (config->part_size > MAX_PART_SIZE) {
+        COMMLOG(OBS_LOGERROR, "%s: invalid part_size %llu", __FUNCTION__, (unsigned long long)config->part_size);
+        return OBS_STATUS_InvalidParameter;
+    }
+    memset_s(summary, sizeof(obs_download_objects_summary), 0, sizeof(obs_download_objects_summary));
+    summary->total_count = config->item_count;
+    if (config->item_count == 0) {
+        return OBS_STATUS_OK;
+    }
+
+    context = (dlm_context *)malloc(sizeof(dlm_context));
+    temp_path = (char *)malloc(DLM_PATH_SIZE);
+    if (context == NULL || temp_path == NULL) {
+        CHECK_NULL_FREE(context);
+        CHECK_NULL_FREE(temp_path);
+        return OBS_STATUS_OutOfMemory;
+    }
+    memset_s(context, sizeof(dlm_context), 0, sizeof(dlm_context));
+    context->options = options;
+    context->config = config;
+    context->summary = summary;
+    context->part_size = config->part_size > 0 ? config->part_size : DLM_DEFAULT_PART_SIZE;
+    context->objects = (dlm_object *)calloc(config->item_count, sizeof(dlm_object));
+    context->order = (dlm_order *)malloc(sizeof(dlm_order) * config->item_count);
+    if (context->objects == NULL || context->order == NULL) {
+        CHECK_NULL_FREE(context->objects);
+        CHECK_NULL_FREE(context->order);
+        free(context);
+        free(temp_path);
+        return OBS_STATUS_OutOfMemory;
+    }
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_init(&context->mutex, NULL);
+#else
+    InitializeCriticalSection(&context->mutex);
+#endif
+
+    status = dlm_download(context, temp_path);
+    if (context->journal != NULL) {
+        fclose(context->journal);
+        // 全部完成后日志不再需要
+        if (status == OBS_STATUS_OK && summary->failed_count == 0) {
+            (void)remove_file(config->journal_file);
+        }
+    }
+    else {
+        // 没有日志时无法续传，清理失败对象的临时文件
+        for (i = 0; i < config->item_count; i++) {
+            if (context->objects[i].state == DLM_STATE_FAILED && dlm_temp_path(&config->items[i], temp_path) == 0) {
+                (void)remove(temp_path);
+            }
+        }
+    }
+    if (status == OBS_STATUS_OK && summary->success_count + summary->failed_count < summary->total_count) {
+        status = OBS_STATUS_InternalError;
+    }
+    summary->first_error_status = status;
+    COMMLOG(OBS_LOGINFO, "%s: %llu succeeded (%llu resumed), %llu failed, %llu bytes, status %s", __FUNCTION__,
+        (unsigned long long)summary->success_count, (unsigned long long)summary->resumed_count,
+        (unsigned long long)summary->failed_count, (unsigned long long)summary->downloaded_bytes,
+        obs_get_status_name(status));
+
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_destroy(&context->mutex);
+#else
+    DeleteCriticalSection(&context->mutex);
+#endif
+    for (i = 0; i < config->item_count; i++) {
+        CHECK_NULL_FREE(context->objects[i].part_done);
+    }
+    free(context->objects);
+    free(context->order);
+    free(context);
+    free(temp_path);
+    return status;
+}
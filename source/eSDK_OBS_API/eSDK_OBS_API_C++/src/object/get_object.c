@@ -14,6 +14,8 @@
 */
 #include "object.h"
 #include "request_util.h"
+#include "chunk_cache.h"
+#include "compression.h"
 #include <openssl/md5.h> 
 
 #include <fcntl.h>
@@ -49,8 +51,17 @@ void get_object(const obs_options *options, obs_object_info *object_info,
     server_side_encryption_params *encryption_params,
     obs_get_object_handler *handler, void *callback_data)
 {
+    get_object_internal(options, object_info, get_conditions, encryption_params, handler, callback_data, 0);
+}
+
+void get_object_internal(const obs_options *options, obs_object_info *object_info,
+    obs_get_conditions *get_conditions, server_side_encryption_params *encryption_params,
+    obs_get_object_handler *handler, void *callback_data, int allow_compressed_range)
+{
 
     request_params params;
+    metadata_cache_request cache_request;
+    compression_range_guard range_guard;
     obs_use_api use_api = OBS_USE_API_S3;
     set_use_api_switch(options, &use_api);
 
@@ -61,6 +72,11 @@ void get_object(const obs_options *options, obs_object_info *object_info,
         (void)(*(handler->response_handler.complete_callback))(OBS_STATUS_InvalidBucketName, 0, callback_data);
         return;
     }
+    if (chunk_cache_get_object(options, object_info, get_conditions, encryption_params, handler, callback_data,
+        allow_compressed_range)) {
+        COMMLOG(OBS_LOGINFO, "Leave get_object through chunk cache");
+        return;
+    }
     string_buffer(queryParams, QUERY_STRING_LEN);
     string_buffer_initialize(queryParams);
 
@@ -108,6 +124,22 @@ void get_object(const obs_options *options, obs_object_info *object_info,
     params.isCheckCA = is_check_ca(options);
     params.storageClassFormat = no_need_storage_class;
     params.use_api = use_api;
+    // 仅完整读取对象时响应头描述的是整个对象，此时才填充元数据缓存
+    memset_s(&cache_request, sizeof(cache_request), 0, sizeof(cache_request));
+    if (encryption_params == NULL && (get_conditions == NULL || (get_conditions->start_byte == 0 &&
+        get_conditions->byte_count == 0 && get_conditions->image_process_config == NULL &&
+        get_conditions->if_modified_since < 0 && get_conditions->if_not_modified_since < 0 &&
+        get_conditions->if_match_etag == NULL && get_conditions->if_not_match_etag == NULL))) {
+        metadata_cache_begin_populate(&cache_request, options, object_info->key, object_info->version_id,
+            &handler->response_handler, callback_data);
+        metadata_cache_wrap_params(&cache_request, &params);
+    }
+    // 压缩对象的片段无法单独解压，范围读取时拒绝
+    if (!allow_compressed_range && get_conditions != NULL &&
+        (get_conditions->start_byte != 0 || get_conditions->byte_count != 0)) {
+        compression_range_guard_wrap(&range_guard, &params);
+    }
     request_perform(&params);
+    metadata_cache_end(&cache_request);
     COMMLOG(OBS_LOGINFO, "Leave get_object successfully!");
 }
\ No newline at end of file
@@ -23,8 +23,16 @@
 void get_object_metadata(const obs_options *options, obs_object_info *object_info,
     server_side_encryption_params *encryption_params,
     obs_response_handler *handler, void *callback_data)
+{
+    get_object_metadata_internal(options, object_info, encryption_params, handler, callback_data, 1);
+}
+
+void get_object_metadata_internal(const obs_options *options, obs_object_info *object_info,
+    server_side_encryption_params *encryption_params,
+    obs_response_handler *handler, void *callback_data, int use_cache)
 {
     request_params params;
+    metadata_cache_request cache_request;
     obs_use_api use_api = OBS_USE_API_S3;
     set_use_api_switch(options, &use_api);
     COMMLOG(OBS_LOGINFO, "Enter get_object_metadata successfully !");
@@ -67,6 +75,15 @@ void get_object_metadata(const obs_options *options, obs_object_info *object_inf
     params.storageClassFormat = no_need_storage_class;
     params.use_api = use_api;
 
+    // SSE-C对象的元数据依赖请求携带的密钥，不使用缓存
+    memset_s(&cache_request, sizeof(cache_request), 0, sizeof(cache_request));
+    if (use_cache && encryption_params == NULL && metadata_cache_begin(&cache_request, options, object_info->key,
+        object_info->version_id, handler, callback_data)) {
+        COMMLOG(OBS_LOGINFO, "get_object_metadata served from metadata cache");
+        return;
+    }
+    metadata_cache_wrap_params(&cache_request, &params);
     request_perform(&params);
+    metadata_cache_end(&cache_request);
 	COMMLOG(OBS_LOGINFO, "Leave %s successfully !", __FUNCTION__);
 }
\ No newline at end of file
@@ -0,0 +1,608 @@
+/*********************************************************************************
+* Copyright 2024 Huawei Technologies Co.,Ltd.
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+* this file except in compliance with the License.  You may obtain a copy of the
+* License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed
+* under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+* CONDITIONS OF ANY KIND, either express or implied.  See the License for the
+* specific language governing permissions and limitations under the License.
+**********************************************************************************
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "eSDKOBS.h"
+#include "securec.h"
+#include "object.h"
+#include "request_util.h"
+#include "metrics.h"
+#include "compression.h"
+
+#if defined WIN32
+#include <io.h>
+#include <process.h>
+#endif
+
+#if defined __GNUC__ || defined LINUX
+#include <unistd.h>
+#include <pthread.h>
+#endif
+
+#define RANGE_DEFAULT_PART_SIZE     (8 * 1024 * 1024)
+#define RANGE_DEFAULT_TASK_NUM      4
+#define RANGE_MAX_BUFFER_NUM        64
+#define RANGE_WRITE_ONCE            (1024 * 1024)
+#define RANGE_RETRY_BASE_MS         100
+#define RANGE_RETRY_MAX_MS          3200
+
+#define RANGE_SLOT_FREE             0
+#define RANGE_SLOT_FETCHING         1
+#define RANGE_SLOT_READY            2         // 已下载完整，等待按序交付
+
+/**
+ * 重排缓冲区，第n个范围固定使用第n % buffer_count个槽位，
+ * 槽位在前一个范围交付后才空闲，从而对下载线程形成反压
+ */
+typedef struct range_slot
+{
+    char *data;
+    uint64_t length;
+    int state;
+} range_slot;
+
+typedef struct range_context
+{
+    const obs_options *options;
+    char *key;
+    obs_get_object_stream_configuration *config;
+    obs_get_object_stream_summary *summary;
+    uint64_t part_size;
+    uint64_t object_size;
+    uint64_t range_count;
+    uint64_t next_fetch;
+    uint64_t next_deliver;
+    int buffer_count;
+    range_slot slots[RANGE_MAX_BUFFER_NUM];
+    char etag[MAX_SIZE_ETAG];                 // 各范围请求携带If-Match，防止下载期间对象被覆盖
+    int failed;
+    obs_compression_type compression;
+    uint64_t original_size;
+    compression_writer *decompressor;         // 不解压时为NULL
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+#else
+    CRITICAL_SECTION mutex;
+    CONDITION_VARIABLE cond;
+#endif
+} range_context;
+
+/**
+ * 单次请求的回调数据，slot为NULL时直接交给调用者
+ */
+typedef struct range_call
+{
+    range_context *context;
+    range_slot *slot;
+    uint64_t expected;
+    uint64_t offset;
+    obs_status status;
+    obs_status write_status;
+    uint64_t content_length;
+    char etag[MAX_SIZE_ETAG];
+    obs_compression_type compression;
+    uint64_t original_size;
+} range_call;
+
+static void range_lock(range_context *context)
+{
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_lock(&context->mutex);
+#else
+    EnterCriticalSection(&context->mutex);
+#endif
+}
+
+static void range_unlock(range_context *context)
+{
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_unlock(&context->mutex);
+#else
+    LeaveCriticalSection(&context->mutex);
+#endif
+}
+
+static void range_wait(range_context *context)
+{
+#if defined __GNUC__ || defined LINUX
+    pthread_cond_wait(&context->cond, &context->mutex);
+#else
+    SleepConditionVariableCS(&context->cond, &context->mutex, INFINITE);
+#endif
+}
+
+static void range_wake_all(range_context *context)
+{
+#if defined __GNUC__ || defined LINUX
+    pthread_cond_broadcast(&context->cond);
+#else
+    WakeAllConditionVariable(&context->cond);
+#endif
+}
+
+/* 记录第一个错误并通知交付方和下载线程停止，调用时需持有锁 */
+static void range_set_failed(range_context *context, obs_status status)
+{
+    if (!context->failed) {
+        context->failed = 1;
+        context->summary->first_error_status = status;
+    }
+    range_wake_all(context);
+}
+
+static int range_should_retry(range_context *context, obs_status status, unsigned int attempts)
+{
+    if (attempts > context->config->max_retries) {
+        return 0;
+    }
+    return obs_status_is_retryable(status) || status == OBS_STATUS_SlowDown ||
+        status == OBS_STATUS_ServiceUnavailable;
+}
+
+/* 重试前按指数退避等待 */
+static void range_backoff(unsigned int attempts)
+{
+    unsigned int wait_ms = RANGE_RETRY_BASE_MS << (attempts < 6 ? attempts - 1 : 5);
+    if (wait_ms > RANGE_RETRY_MAX_MS) {
+        wait_ms = RANGE_RETRY_MAX_MS;
+    }
+#if defined WIN32
+    Sleep(wait_ms);
+#else
+    usleep(wait_ms * 1000);
+#endif
+}
+
+/************************************************************************************
+ * 交付给调用者
+ ************************************************************************************/
+static obs_status range_output(const char *buffer, uint64_t length, void *sink_data)
+{
+    range_context *context = (range_context *)sink_data;
+    obs_get_object_stream_configuration *config = context->config;
+    while (length > 0) {
+        int chunk = length < RANGE_WRITE_ONCE ? (int)length : RANGE_WRITE_ONCE;
+        if (config->write_callback != NULL) {
+            obs_status status = config->write_callback(chunk, buffer, config->callback_data);
+            if (status != OBS_STATUS_OK) {
+                return status;
+            }
+        }
+        else {
+            int ret;
+            do {
+#if defined WIN32
+                ret = _write(config->fd, buffer, (unsigned int)chunk);
+#else
+                ret = (int)write(config->fd, buffer, (size_t)chunk);
+#endif
+            } while (ret < 0 && errno == EINTR);
+            if (ret <= 0) {
+                COMMLOG(OBS_LOGERROR, "%s: write fd %d failed, errno %d", __FUNCTION__, config->fd, errno);
+                return OBS_STATUS_OpenFileFailed;
+            }
+            chunk = ret;
+        }
+        buffer += chunk;
+        length -= (uint64_t)chunk;
+        context->summary->total_bytes += (uint64_t)chunk;
+    }
+    return OBS_STATUS_OK;
+}
+
+/* 按对象顺序交付，需要解压时先经过解压器 */
+static obs_status range_write(range_context *context, const char *buffer, uint64_t length)
+{
+    if (context->decompressor != NULL) {
+        return compression_writer_write(context->decompressor, buffer, length);
+    }
+    return range_output(buffer, length, context);
+}
+
+/************************************************************************************
+ * 请求回调
+ ************************************************************************************/
+static obs_status range_properties_callback(const obs_response_properties *properties, void *callback_data)
+{
+    range_call *call = (range_call *)callback_data;
+    call->content_length = properties->content_length;
+    if (properties->etag != NULL) {
+        int ret = snprintf_s(call->etag, sizeof(call->etag), _TRUNCATE, "%s", properties->etag);
+        CheckAndLogNeg(ret, "snprintf_s", __FUNCTION__, __LINE__);
+    }
+    call->compression = compression_from_metadata(properties, &call->original_size);
+    return OBS_STATUS_OK;
+}
+
+static void range_complete_callback(obs_status status, const obs_error_details *error, void *callback_data)
+{
+    range_call *call = (range_call *)callback_data;
+    (void)error;
+    call->status = status;
+}
+
+static obs_status range_data_callback(int buffer_size, const char *buffer, void *callback_data)
+{
+    range_call *call = (range_call *)callback_data;
+    if (call->slot == NULL) {
+        call->write_status = range_write(call->context, buffer, (uint64_t)buffer_size);
+        call->offset += (uint64_t)buffer_size;
+        return call->write_status;
+    }
+    if ((uint64_t)buffer_size > call->expected - call->offset) {
+        COMMLOG(OBS_LOGERROR, "%s: range returned more than %llu bytes", __FUNCTION__,
+            (unsigned long long)call->expected);
+        return OBS_STATUS_InvalidRange;
+    }
+    errno_t err = memcpy_s(call->slot->data + call->offset, (size_t)(call->expected - call->offset),
+        buffer, (size_t)buffer_size);
+    if (err != EOK) {
+        return OBS_STATUS_Security_Function_Failed;
+    }
+    call->offset += (uint64_t)buffer_size;
+    return OBS_STATUS_OK;
+}
+
+/************************************************************************************
+ * 下载
+ ************************************************************************************/
+/**
+ * 下载[start, start + length)，slot为NULL时边下载边交付，已交付数据后不再重试
+ */
+static obs_status range_fetch(range_context *context, range_slot *slot, uint64_t start, uint64_t length)
+{
+    obs_get_object_handler handler = {
+        {&range_properties_callback, &range_complete_callback}, &range_data_callback
+    };
+    obs_object_info object_info = {context->key, context->config->version_id};
+    obs_get_conditions conditions;
+    range_call call;
+    unsigned int attempts = 0;
+
+    init_get_properties(&conditions);
+    if (slot != NULL) {
+        conditions.start_byte = start;
+        conditions.byte_count = length;
+    }
+    if (context->etag[0] != '\0') {
+        conditions.if_match_etag = context->etag;
+    }
+    for (;;) {
+        memset_s(&call, sizeof(call), 0, sizeof(call));
+        call.context = context;
+        call.slot = slot;
+        call.expected = length;
+        call.status = OBS_STATUS_BUTT;
+        attempts++;
+        metrics_set_retry(OBS_METRICS_OP_GET_OBJECT, attempts - 1);
+        get_object_internal(context->options, &object_info, &conditions, context->config->encryption_params,
+            &handler, &call, 1);
+        if (call.write_status != OBS_STATUS_OK) {
+            call.status = call.write_status;
+            break;
+        }
+        if (call.status == OBS_STATUS_OK && call.offset != length) {
+            call.status = OBS_STATUS_PartialFile;
+        }
+        if (call.status == OBS_STATUS_OK || (slot == NULL && call.offset > 0) ||
+            !range_should_retry(context, call.status, attempts)) {
+            break;
+        }
+        COMMLOG(OBS_LOGWARN, "%s: retry range %llu, status %s", __FUNCTION__, (unsigned long long)start,
+            obs_get_status_name(call.status));
+        range_lock(context);
+        context->summary->retry_count++;
+        range_unlock(context);
+        range_backoff(attempts);
+    }
+    metrics_set_retry(OBS_METRICS_OP_GET_OBJECT, 0);
+    if (call.status != OBS_STATUS_OK) {
+        COMMLOG(OBS_LOGERROR, "%s: get range %llu failed, status %s", __FUNCTION__, (unsigned long long)start,
+            obs_get_status_name(call.status));
+    }
+    return call.status;
+}
+
+static void range_worker(range_context *context)
+{
+    for (;;) {
+        range_slot *slot = NULL;
+        uint64_t index;
+        uint64_t start;
+        uint64_t length;
+        obs_status status = OBS_STATUS_OK;
+
+        range_lock(context);
+        while (!context->failed && context->next_fetch < context->range_count &&
+            context->next_fetch >= context->next_deliver + (uint64_t)context->buffer_count) {
+            range_wait(context);
+        }
+        if (context->failed || context->next_fetch >= context->range_count) {
+            range_unlock(context);
+            break;
+        }
+        index = context->next_fetch++;
+        slot = &context->slots[index % (uint64_t)context->buffer_count];
+        slot->state = RANGE_SLOT_FETCHING;
+        range_unlock(context);
+
+        start = index * context->part_size;
+        length = context->object_size - start < context->part_size ? context->object_size - start :
+            context->part_size;
+        if (slot->data == NULL) {
+            slot->data = (char *)malloc((size_t)context->part_size);
+            if (slot->data == NULL) {
+                status = OBS_STATUS_OutOfMemory;
+            }
+        }
+        if (status == OBS_STATUS_OK) {
+            status = range_fetch(context, slot, start, length);
+        }
+
+        range_lock(context);
+        if (status == OBS_STATUS_OK) {
+            slot->length = length;
+            slot->state = RANGE_SLOT_READY;
+            range_wake_all(context);
+        }
+        else {
+            slot->state = RANGE_SLOT_FREE;
+            range_set_failed(context, status);
+        }
+        range_unlock(context);
+    }
+}
+
+#if defined __GNUC__ || defined LINUX
+static void *range_worker_linux(void *arg)
+{
+    range_worker((range_context *)arg);
+    return NULL;
+}
+#else
+static unsigned __stdcall range_worker_win32(void *arg)
+{
+    range_worker((range_context *)arg);
+    return 0;
+}
+#endif
+
+/**
+ * 在调用线程中按范围顺序交付已下载的槽位
+ */
+static void range_deliver(range_context *context)
+{
+    while (context->next_deliver < context->range_count) {
+        range_slot *slot = &context->slots[context->next_deliver % (uint64_t)context->buffer_count];
+        obs_status status;
+
+        range_lock(context);
+        while (!context->failed && slot->state != RANGE_SLOT_READY) {
+            range_wait(context);
+        }
+        if (context->failed) {
+            range_unlock(context);
+            break;
+        }
+        range_unlock(context);
+
+        status = range_write(context, slot->data, slot->length);
+
+        range_lock(context);
+        if (status != OBS_STATUS_OK) {
+            range_set_failed(context, status);
+            range_unlock(context);
+            break;
+        }
+        slot->state = RANGE_SLOT_FREE;
+        context->next_deliver++;
+        range_wake_all(context);
+        range_unlock(context);
+    }
+}
+
+static void range_run(range_context *context, int task_num)
+{
+    int started = 0;
+    int i;
+#if defined __GNUC__ || defined LINUX
+    pthread_t threads[RANGE_MAX_BUFFER_NUM];
+    for (i = 0; i < task_num; i++) {
+        if (pthread_create(&threads[started], NULL, range_worker_linux, context) == 0) {
+            started++;
+        }
+    }
+#else
+    HANDLE threads[RANGE_MAX_BUFFER_NUM];
+    for (i = 0; i < task_num; i++) {
+        threads[started] = (HANDLE)_beginthreadex(NULL, 0, range_worker_win32, context, 0, NULL);
+        if (threads[started] != 0) {
+            started++;
+        }
+    }
+#endif
+    if (started == 0) {
+        COMMLOG(OBS_LOGERROR, "%s: create download thread failed", __FUNCTION__);
+        range_lock(context);
+        range_set_failed(context, OBS_STATUS_InternalError);
+        range_unlock(context);
+        return;
+    }
+    range_deliver(context);
+#if defined __GNUC__ || defined LINUX
+    for (i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+#else
+    for (i = 0; i < started; i++) {
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+    }
+#endif
+}
+
+static obs_status range_head(range_context *context)
+{
+    obs_response_handler handler = {&range_properties_callback, &range_complete_callback};
+    obs_object_info object_info = {context->key, context->config->version_id};
+    range_call call;
+    unsigned int attempts = 0;
+
+    for (;;) {
+        memset_s(&call, sizeof(call), 0, sizeof(call));
+        call.status = OBS_STATUS_BUTT;
+        attempts++;
+        metrics_set_retry(OBS_METRICS_OP_HEAD_OBJECT, attempts - 1);
+        // 取到的ETag用作后续范围GET的If-Match，不能来自可能过期的元数据缓存
+        get_object_metadata_internal(context->options, &object_info, context->config->encryption_params, &handler,
+            &call, 0);
+        if (call.status == OBS_STATUS_OK || !range_should_retry(context, call.status, attempts)) {
+            break;
+        }
+        context->summary->retry_count++;
+        range_backoff(attempts);
+    }
+    metrics_set_retry(OBS_METRICS_OP_HEAD_OBJECT, 0);
+    if (call.status == OBS_STATUS_OK) {
+        context->object_size = call.content_length;
+        context->compression = call.compression;
+        context->original_size = call.original_size;
+        memcpy_s(context->etag, sizeof(context->etag), call.etag, sizeof(call.etag));
+    }
+    return call.status;
+}
+
+static obs_status range_download(range_context *context)
+{
+    obs_status status = range_head(context);
+    int task_num;
+
+    if (status != OBS_STATUS_OK) {
+        COMMLOG(OBS_LOGERROR, "%s: head object failed, status %s", __FUNCTION__, obs_get_status_name(status));
+        return status;
+    }
+    context->summary->object_size = context->object_size;
+    context->summary->compression = context->compression;
+    context->summary->original_size = context->original_size;
+    memcpy_s(context->summary->etag, sizeof(context->summary->etag), context->etag, sizeof(context->etag));
+    if (context->config->decompress && context->compression != OBS_COMPRESSION_NONE) {
+        status = compression_writer_create(context->compression, &range_output, context, &context->decompressor);
+        if (status != OBS_STATUS_OK) {
+            COMMLOG(OBS_LOGERROR, "%s: cannot decompress %s object", __FUNCTION__,
+                compression_codec_name(context->compression));
+            return status;
+        }
+    }
+    if (context->object_size <= context->part_size) {
+        // 一个范围即可完成，直接边下载边交付
+        return range_fetch(context, NULL, 0, context->object_size);
+    }
+
+    context->range_count = (context->object_size + context->part_size - 1) / context->part_size;
+    context->summary->range_count = (unsigned int)context->range_count;
+    task_num = context->config->task_num > 0 ? context->config->task_num : RANGE_DEFAULT_TASK_NUM;
+    if (task_num > context->buffer_count) {
+        task_num = context->buffer_count;
+    }
+    if ((uint64_t)task_num > context->range_count) {
+        task_num = (int)context->range_count;
+    }
+    range_run(context, task_num);
+    return context->failed ? context->summary->first_error_status : OBS_STATUS_OK;
+}
+
+void init_get_object_stream_configuration(obs_get_object_stream_configuration *config)
+{
+    if (config == NULL) {
+        return;
+    }
+    memset_s(config, sizeof(obs_get_object_stream_configuration), 0, sizeof(obs_get_object_stream_configuration));
+    config->fd = -1;
+    config->max_retries = 3;
+}
+
+obs_status get_object_stream(const obs_options *options, char *key, obs_get_object_stream_configuration *config,
+    obs_get_object_stream_summary *summary)
+{
+    range_context *context = NULL;
+    obs_status status;
+    int i;
+
+    if (options == NULL || key == NULL || config == NULL || summary == NULL ||
+        (config->write_callback == NULL && config->fd < 0)) {
+        COMMLOG(OBS_LOGERROR, "%s: invalid parameter", __FUNCTION__);
+        return OBS_STATUS_InvalidParameter;
+    }
+    if (config->part_size > MAX_PART_SIZE || config->buffer_count < 0 ||
+        config->buffer_count > RANGE_MAX_BUFFER_NUM || config->task_num > RANGE_MAX_BUFFER_NUM) {
+        COMMLOG(OBS_LOGERROR, "%s: invalid part_size %llu or buffer_count %d", __FUNCTION__,
+            (unsigned long long)config->part_size, config->buffer_count);
+        return OBS_STATUS_InvalidParameter;
+    }
+    memset_s(summary, sizeof(obs_get_object_stream_summary), 0, sizeof(obs_get_object_stream_summary));
+
+    context = (range_context *)malloc(sizeof(range_context));
+    if (context == NULL) {
+        return OBS_STATUS_OutOfMemory;
+    }
+    memset_s(context, sizeof(range_context), 0, sizeof(range_context));
+    context->options = options;
+    context->key = key;
+    context->config = config;
+    context->summary = summary;
+    context->part_size = config->part_size > 0 ? config->part_size : RANGE_DEFAULT_PART_SIZE;
+    if (config->buffer_count > 0) {
+        context->buffer_count = config->buffer_count;
+    }
+    else {
+        // 默认每个下载线程两个槽位，慢范围阻塞交付时其余线程仍可继续下载
+        context->buffer_count = (config->task_num > 0 ? config->task_num : RANGE_DEFAULT_TASK_NUM) * 2;
+        if (context->buffer_count > RANGE_MAX_BUFFER_NUM) {
+            context->buffer_count = RANGE_MAX_BUFFER_NUM;
+        }
+    }
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_init(&context->mutex, NULL);
+    pthread_cond_init(&context->cond, NULL);
+#else
+    InitializeCriticalSection(&context->mutex);
+    InitializeConditionVariable(&context->cond);
+#endif
+
+    status = range_download(context);
+    if (status == OBS_STATUS_OK && context->decompressor != NULL) {
+        status = compression_writer_finish(context->decompressor);
+    }
+    compression_writer_destroy(context->decompressor);
+    summary->first_error_status = status;
+    COMMLOG(OBS_LOGINFO, "%s: key %s, %llu of %llu bytes, %u ranges, status %s", __FUNCTION__, key,
+        (unsigned long long)summary->total_bytes, (unsigned long long)summary->object_size,
+        summary->range_count, obs_get_status_name(status));
+
+#if defined __GNUC__ || defined LINUX
+    pthread_cond_destroy(&context->cond);
+    pthread_mutex_destroy(&context->mutex);
+#else
+    DeleteCriticalSection(&context->mutex);
+#endif
+    for (i = 0; i < context->buffer_count; i++) {
+        CHECK_NULL_FREE(context->slots[i].data);
+    }
+    free(context);
+    return status;
+}
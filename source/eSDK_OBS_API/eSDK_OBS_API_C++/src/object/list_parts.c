@@ -53,8 +53,6 @@ static obs_status make_list_parts_callback(list_parts_data *lpData)
 
         partsDest->last_modified =
             parseIso8601Time(partsSrc->last_modified);
-        int nTimeZone = getTimeZone();
-        partsDest->last_modified += nTimeZone * SECONDS_TO_AN_HOUR;
         partsDest->etag = partsSrc->etag;
         partsDest->size = parseUnsignedInt(partsSrc->size);
 
@@ -144,11 +142,11 @@ int parse_xmlnode_list_parts_notPart(list_parts_data *lpData, const char *elemen
     {
         string_buffer_append(lpData->storage_class, data, dataLen, fit);
     }
-    else if (!strcmp(elementPath, "ListPartResult/NextPartNumberMarker"))
+    else if (!strcmp(elementPath, "ListPartsResult/NextPartNumberMarker"))
     {
         lpData->nextpart_number_marker = atoi(data);
     }
-    else if (!strcmp(elementPath, "ListPartResult/IsTruncated"))
+    else if (!strcmp(elementPath, "ListPartsResult/IsTruncated"))
     {
         string_buffer_append(lpData->is_truncated, data, dataLen, fit);
     }
@@ -128,11 +128,21 @@ int updateCheckPoint(char * elementPath, const char * content, const char * file
     char strArry[MAX_XML_DEPTH][32] = { {0} };
     unsigned int strNum = 0;
 
-    char* p = strtok(strToParse, "/");
+    char *context = NULL;
+    // transfers update their own checkpoint files concurrently, strtok is not reentrant
+#if defined __GNUC__ || defined LINUX
+    char* p = strtok_r(strToParse, "/", &context);
+#else
+    char* p = strtok_s(strToParse, "/", &context);
+#endif
     while (p != NULL && strNum < MAX_XML_DEPTH) {
         int ret = strncpy_s(strArry[strNum], ARRAY_LENGTH_32, p, strlen(p) + 1);
         CheckAndLogNoneZero(ret, "strncpy_s", __FUNCTION__, __LINE__);
-        p = strtok(NULL, "/");
+#if defined __GNUC__ || defined LINUX
+        p = strtok_r(NULL, "/", &context);
+#else
+        p = strtok_s(NULL, "/", &context);
+#endif
         strNum++;
     }
 
@@ -23,6 +23,7 @@
 void obs_head_object(const obs_options *options, char *key, obs_response_handler *handler, void *callback_data)
 {
     request_params params;
+    metadata_cache_request cache_request;
 
     obs_use_api use_api = OBS_USE_API_S3;
     set_use_api_switch(options, &use_api);
@@ -50,6 +51,12 @@ void obs_head_object(const obs_options *options, char *key, obs_response_handler
     params.storageClassFormat = no_need_storage_class;
     params.callback_data = callback_data;
     params.use_api = use_api;
+    if (metadata_cache_begin(&cache_request, options, key, NULL, handler, callback_data)) {
+        COMMLOG(OBS_LOGINFO, "obs_head_object served from metadata cache");
+        return;
+    }
+    metadata_cache_wrap_params(&cache_request, &params);
     request_perform(&params);
+    metadata_cache_end(&cache_request);
     COMMLOG(OBS_LOGINFO, "Leave obs_head_object Successfully!");
 }
\ No newline at end of file
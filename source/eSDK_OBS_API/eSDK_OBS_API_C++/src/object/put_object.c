@@ -47,5 +47,6 @@ void put_object(const obs_options *options, char *key, uint64_t content_length,
     params.storageClassFormat = storage_class;
     params.use_api = use_api;
     request_perform(&params);
+    metadata_cache_invalidate_object(&params.bucketContext, key);
     COMMLOG(OBS_LOGINFO, "Leave put_object successfully !");
 }
\ No newline at end of file
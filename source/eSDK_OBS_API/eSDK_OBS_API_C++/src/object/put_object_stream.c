@@ -0,0 +1,871 @@
+/*********************************************************************************
+* Copyright 2024 Huawei Technologies Co.,Ltd.
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+* this file except in compliance with the License.  You may obtain a copy of the
+* License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed
+* under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+* CONDITIONS OF ANY KIND, either express or implied.  See the License for the
+* specific language governing permissions and limitations under the License.
+**********************************************************************************
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "eSDKOBS.h"
+#include "securec.h"
+#include "object.h"
+#include "request_util.h"
+#include "metrics.h"
+#include "compression.h"
+
+#if defined WIN32
+#include <io.h>
+#include <process.h>
+#endif
+
+#if defined __GNUC__ || defined LINUX
+#include <unistd.h>
+#include <pthread.h>
+#endif
+
+#define STREAM_DEFAULT_PART_SIZE    (8 * 1024 * 1024)
+#define STREAM_MIN_PART_SIZE        (100 * 1024)
+#define STREAM_DEFAULT_TASK_NUM     4
+#define STREAM_MAX_BUFFER_NUM       64
+#define STREAM_MAX_PART_NUM         10000
+#define STREAM_READ_ONCE            (1024 * 1024)
+#define STREAM_RETRY_BASE_MS        100
+#define STREAM_RETRY_MAX_MS         3200
+#define STREAM_SIZE_LEN             32
+
+#define STREAM_BUFFER_FREE          0
+#define STREAM_BUFFER_FILLING       1         // 生产者正在写入
+#define STREAM_BUFFER_FILLED        2         // 等待上传
+#define STREAM_BUFFER_UPLOADING     3
+
+/**
+ * 段缓冲区，data首次使用时分配，上传完成后回到FREE状态供生产者复用
+ */
+typedef struct stream_buffer
+{
+    char *data;
+    uint64_t length;
+    unsigned int part_number;
+    int state;
+} stream_buffer;
+
+typedef struct stream_context
+{
+    const obs_options *options;
+    char *key;
+    obs_put_object_stream_configuration *config;
+    obs_put_object_stream_summary *summary;
+    uint64_t part_size;
+    int buffer_count;
+    stream_buffer buffers[STREAM_MAX_BUFFER_NUM];
+    char (*etags)[MAX_SIZE_ETAG];             // 按段号-1索引
+    unsigned int etag_capacity;
+    unsigned int part_count;
+    char upload_id[MAX_SIZE_UPLOADID];
+    int eof;                                  // 生产者已结束，不再产生新的段
+    int failed;
+    compression_reader *compressor;           // 不压缩时为NULL
+    obs_put_properties *put_properties;       // 实际发送的属性，压缩时为properties
+    obs_put_properties properties;
+    obs_name_value *meta_data;
+    char original_size[STREAM_SIZE_LEN];
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+#else
+    CRITICAL_SECTION mutex;
+    CONDITION_VARIABLE cond;
+#endif
+} stream_context;
+
+/**
+ * 单次请求的回调数据
+ */
+typedef struct stream_call
+{
+    const stream_buffer *buffer;
+    uint64_t offset;
+    obs_status status;
+    char etag[MAX_SIZE_ETAG];
+} stream_call;
+
+static void stream_lock(stream_context *context)
+{
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_lock(&context->mutex);
+#else
+    EnterCriticalSection(&context->mutex);
+#endif
+}
+
+static void stream_unlock(stream_context *context)
+{
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_unlock(&context->mutex);
+#else
+    LeaveCriticalSection(&context->mutex);
+#endif
+}
+
+static void stream_wait(stream_context *context)
+{
+#if defined __GNUC__ || defined LINUX
+    pthread_cond_wait(&context->cond, &context->mutex);
+#else
+    SleepConditionVariableCS(&context->cond, &context->mutex, INFINITE);
+#endif
+}
+
+static void stream_wake_all(stream_context *context)
+{
+#if defined __GNUC__ || defined LINUX
+    pthread_cond_broadcast(&context->cond);
+#else
+    WakeAllConditionVariable(&context->cond);
+#endif
+}
+
+/* 记录第一个错误并通知生产者和上传线程停止，调用时需持有锁 */
+static void stream_set_failed(stream_context *context, obs_status status)
+{
+    if (!context->failed) {
+        context->failed = 1;
+        context->summary->first_error_status = status;
+    }
+    stream_wake_all(context);
+}
+
+/************************************************************************************
+ * 请求回调
+ ************************************************************************************/
+static obs_status stream_properties_callback(const obs_response_properties *properties, void *callback_data)
+{
+    stream_call *call = (stream_call *)callback_data;
+    if (properties->etag != NULL) {
+        int ret = snprintf_s(call->etag, sizeof(call->etag), _TRUNCATE, "%s", properties->etag);
+        CheckAndLogNeg(ret, "snprintf_s", __FUNCTION__, __LINE__);
+    }
+    return OBS_STATUS_OK;
+}
+
+static void stream_complete_callback(obs_status status, const obs_error_details *error, void *callback_data)
+{
+    stream_call *call = (stream_call *)callback_data;
+    (void)error;
+    call->status = status;
+}
+
+static int stream_data_callback(int buffer_size, char *buffer, void *callback_data)
+{
+    stream_call *call = (stream_call *)callback_data;
+    uint64_t remain = call->buffer->length - call->offset;
+    int to_copy = (uint64_t)buffer_size < remain ? buffer_size : (int)remain;
+    if (to_copy <= 0) {
+        return 0;
+    }
+    errno_t err = memcpy_s(buffer, buffer_size, call->buffer->data + call->offset, to_copy);
+    if (err != EOK) {
+        COMMLOG(OBS_LOGERROR, "%s: memcpy_s failed", __FUNCTION__);
+        return -1;
+    }
+    call->offset += to_copy;
+    return to_copy;
+}
+
+static obs_status stream_complete_upload_callback(const char *location, const char *bucket, const char *key,
+    const char *etag, void *callback_data)
+{
+    stream_call *call = (stream_call *)callback_data;
+    (void)location;
+    (void)bucket;
+    (void)key;
+    if (etag != NULL) {
+        int ret = snprintf_s(call->etag, sizeof(call->etag), _TRUNCATE, "%s", etag);
+        CheckAndLogNeg(ret, "snprintf_s", __FUNCTION__, __LINE__);
+    }
+    return OBS_STATUS_OK;
+}
+
+/************************************************************************************
+ * 数据读取
+ ************************************************************************************/
+static int stream_read_raw(stream_context *context, char *buffer, int buffer_size)
+{
+    obs_put_object_stream_configuration *config = context->config;
+    int ret;
+    if (config->read_callback != NULL) {
+        return config->read_callback(buffer_size, buffer, config->callback_data);
+    }
+    do {
+#if defined WIN32
+        ret = _read(config->fd, buffer, (unsigned int)buffer_size);
+#else
+        ret = (int)read(config->fd, buffer, (size_t)buffer_size);
+#endif
+    } while (ret < 0 && errno == EINTR);
+    return ret;
+}
+
+/* 压缩线程读取原始数据的入口 */
+static int stream_source_callback(int buffer_size, char *buffer, void *callback_data)
+{
+    return stream_read_raw((stream_context *)callback_data, buffer, buffer_size);
+}
+
+static int stream_read(stream_context *context, char *buffer, int buffer_size)
+{
+    if (context->compressor != NULL) {
+        return compression_reader_read(buffer_size, buffer, context->compressor);
+    }
+    return stream_read_raw(context, buffer, buffer_size);
+}
+
+/**
+ * 读满一个段或读到数据结束，读到结束时置*eof
+ */
+static obs_status stream_fill(stream_context *context, stream_buffer *buffer, int *eof)
+{
+    buffer->length = 0;
+    while (buffer->length < context->part_size) {
+        uint64_t remain = context->part_size - buffer->length;
+        int want = remain < STREAM_READ_ONCE ? (int)remain : STREAM_READ_ONCE;
+        int ret = stream_read(context, buffer->data + buffer->length, want);
+        if (ret < 0) {
+            COMMLOG(OBS_LOGERROR, "%s: read stream data failed, ret %d", __FUNCTION__, ret);
+            if (context->compressor != NULL &&
+                compression_reader_status(context->compressor) != OBS_STATUS_AbortedByCallback) {
+                return compression_reader_status(context->compressor);
+            }
+            return context->config->read_callback != NULL ? OBS_STATUS_AbortedByCallback :
+                OBS_STATUS_OpenFileFailed;
+        }
+        if (ret == 0) {
+            *eof = 1;
+            break;
+        }
+        if (ret > want) {
+            COMMLOG(OBS_LOGERROR, "%s: read callback returned %d, more than %d", __FUNCTION__, ret, want);
+            return OBS_STATUS_AbortedByCallback;
+        }
+        buffer->length += (uint64_t)ret;
+    }
+    return OBS_STATUS_OK;
+}
+
+/************************************************************************************
+ * 段上传
+ ************************************************************************************/
+static int stream_should_retry(stream_context *context, obs_status status, unsigned int attempts)
+{
+    if (attempts > context->config->max_retries) {
+        return 0;
+    }
+    return obs_status_is_retryable(status) || status == OBS_STATUS_SlowDown ||
+        status == OBS_STATUS_ServiceUnavailable;
+}
+
+/* 重试前按指数退避等待，SlowDown时避免立即重发 */
+static void stream_backoff(unsigned int attempts)
+{
+    unsigned int wait_ms = STREAM_RETRY_BASE_MS << (attempts < 6 ? attempts - 1 : 5);
+    if (wait_ms > STREAM_RETRY_MAX_MS) {
+        wait_ms = STREAM_RETRY_MAX_MS;
+    }
+#if defined WIN32
+    Sleep(wait_ms);
+#else
+    usleep(wait_ms * 1000);
+#endif
+}
+
+static obs_status stream_upload_part(stream_context *context, const stream_buffer *buffer, char *etag)
+{
+    obs_upload_handler handler = {
+        {&stream_properties_callback, &stream_complete_callback}, &stream_data_callback, NULL
+    };
+    obs_upload_part_info part_info;
+    stream_call call;
+    unsigned int attempts = 0;
+
+    memset_s(&part_info, sizeof(part_info), 0, sizeof(part_info));
+    part_info.part_number = buffer->part_number;
+    part_info.upload_id = context->upload_id;
+    for (;;) {
+        memset_s(&call, sizeof(call), 0, sizeof(call));
+        call.buffer = buffer;
+        call.status = OBS_STATUS_BUTT;
+        attempts++;
+        metrics_set_retry(OBS_METRICS_OP_UPLOAD_PART, attempts - 1);
+        upload_part(context->options, context->key, &part_info, buffer->length, NULL,
+            context->config->encryption_params, &handler, &call);
+        if (call.status == OBS_STATUS_OK && call.etag[0] == '\0') {
+            call.status = OBS_STATUS_InvalidPart;
+        }
+        if (call.status == OBS_STATUS_OK || !stream_should_retry(context, call.status, attempts)) {
+            break;
+        }
+        COMMLOG(OBS_LOGWARN, "%s: retry part %u, status %s", __FUNCTION__, buffer->part_number,
+            obs_get_status_name(call.status));
+        stream_lock(context);
+        context->summary->retry_count++;
+        stream_unlock(context);
+        stream_backoff(attempts);
+    }
+    metrics_set_retry(OBS_METRICS_OP_UPLOAD_PART, 0);
+    if (call.status == OBS_STATUS_OK) {
+        memcpy_s(etag, MAX_SIZE_ETAG, call.etag, sizeof(call.etag));
+    }
+    else {
+        COMMLOG(OBS_LOGERROR, "%s: upload part %u failed, status %s", __FUNCTION__, buffer->part_number,
+            obs_get_status_name(call.status));
+    }
+    return call.status;
+}
+
+/* 取出段号最小的待上传段，没有时返回NULL，调用时需持有锁 */
+static stream_buffer *stream_next_filled(stream_context *context)
+{
+    stream_buffer *next = NULL;
+    int i;
+    for (i = 0; i < context->buffer_count; i++) {
+        stream_buffer *buffer = &context->buffers[i];
+        if (buffer->state == STREAM_BUFFER_FILLED &&
+            (next == NULL || buffer->part_number < next->part_number)) {
+            next = buffer;
+        }
+    }
+    return next;
+}
+
+static void stream_worker(stream_context *context)
+{
+    char etag[MAX_SIZE_ETAG];
+    for (;;) {
+        stream_buffer *buffer = NULL;
+        obs_status status;
+
+        stream_lock(context);
+        while (!context->failed && (buffer = stream_next_filled(context)) == NULL && !context->eof) {
+            stream_wait(context);
+        }
+        if (context->failed || buffer == NULL) {
+            stream_unlock(context);
+            break;
+        }
+        buffer->state = STREAM_BUFFER_UPLOADING;
+        stream_unlock(context);
+
+        status = stream_upload_part(context, buffer, etag);
+
+        stream_lock(context);
+        if (status == OBS_STATUS_OK) {
+            memcpy_s(context->etags[buffer->part_number - 1], MAX_SIZE_ETAG, etag, MAX_SIZE_ETAG);
+        }
+        else {
+            stream_set_failed(context, status);
+        }
+        buffer->state = STREAM_BUFFER_FREE;
+        stream_wake_all(context);
+        stream_unlock(context);
+    }
+}
+
+#if defined __GNUC__ || defined LINUX
+static void *stream_worker_linux(void *arg)
+{
+    stream_worker((stream_context *)arg);
+    return NULL;
+}
+#else
+static unsigned __stdcall stream_worker_win32(void *arg)
+{
+    stream_worker((stream_context *)arg);
+    return 0;
+}
+#endif
+
+/************************************************************************************
+ * 生产者
+ ************************************************************************************/
+/**
+ * 等待一个空闲缓冲区并标记为FILLING，上传失败时返回NULL
+ */
+static stream_buffer *stream_acquire(stream_context *context)
+{
+    stream_buffer *buffer = NULL;
+    int i;
+    stream_lock(context);
+    while (!context->failed && buffer == NULL) {
+        for (i = 0; i < context->buffer_count; i++) {
+            if (context->buffers[i].state == STREAM_BUFFER_FREE) {
+                buffer = &context->buffers[i];
+                break;
+            }
+        }
+        if (buffer == NULL) {
+            stream_wait(context);
+        }
+    }
+    if (buffer != NULL) {
+        buffer->state = STREAM_BUFFER_FILLING;
+    }
+    stream_unlock(context);
+    if (buffer != NULL && buffer->data == NULL) {
+        buffer->data = (char *)malloc((size_t)context->part_size);
+        if (buffer->data == NULL) {
+            stream_lock(context);
+            buffer->state = STREAM_BUFFER_FREE;
+            stream_set_failed(context, OBS_STATUS_OutOfMemory);
+            stream_unlock(context);
+            return NULL;
+        }
+    }
+    return buffer;
+}
+
+/**
+ * 为已填充的缓冲区分配段号并交给上传线程，段号表按需扩容
+ */
+static obs_status stream_submit(stream_context *context, stream_buffer *buffer)
+{
+    obs_status status = OBS_STATUS_OK;
+    stream_lock(context);
+    if (context->part_count >= STREAM_MAX_PART_NUM) {
+        COMMLOG(OBS_LOGERROR, "%s: part count exceeds %d, part size %llu is too small", __FUNCTION__,
+            STREAM_MAX_PART_NUM, (unsigned long long)context->part_size);
+        status = OBS_STATUS_InvalidPart;
+    }
+    else if (context->part_count == context->etag_capacity) {
+        unsigned int capacity = context->etag_capacity == 0 ? 64 : context->etag_capacity * 2;
+        char (*etags)[MAX_SIZE_ETAG] = NULL;
+        if (capacity > STREAM_MAX_PART_NUM) {
+            capacity = STREAM_MAX_PART_NUM;
+        }
+        etags = (char (*)[MAX_SIZE_ETAG])malloc((size_t)capacity * MAX_SIZE_ETAG);
+        if (etags == NULL) {
+            status = OBS_STATUS_OutOfMemory;
+        }
+        else {
+            if (context->etags != NULL) {
+                memcpy_s(etags, (size_t)capacity * MAX_SIZE_ETAG, context->etags,
+                    (size_t)context->etag_capacity * MAX_SIZE_ETAG);
+                free(context->etags);
+            }
+            context->etags = etags;
+            context->etag_capacity = capacity;
+        }
+    }
+    if (status == OBS_STATUS_OK) {
+        buffer->part_number = ++context->part_count;
+        buffer->state = STREAM_BUFFER_FILLED;
+        context->summary->total_bytes += buffer->length;
+        stream_wake_all(context);
+    }
+    else {
+        buffer->state = STREAM_BUFFER_FREE;
+        stream_set_failed(context, status);
+    }
+    stream_unlock(context);
+    return status;
+}
+
+static void stream_produce(stream_context *context)
+{
+    int eof = 0;
+    while (!eof) {
+        stream_buffer *buffer = stream_acquire(context);
+        obs_status status;
+        if (buffer == NULL) {
+            break;
+        }
+        status = stream_fill(context, buffer, &eof);
+        if (status != OBS_STATUS_OK) {
+            stream_lock(context);
+            buffer->state = STREAM_BUFFER_FREE;
+            stream_set_failed(context, status);
+            stream_unlock(context);
+            break;
+        }
+        if (buffer->length == 0) {
+            // 数据长度正好是段大小的整数倍
+            stream_lock(context);
+            buffer->state = STREAM_BUFFER_FREE;
+            stream_unlock(context);
+            break;
+        }
+        if (stream_submit(context, buffer) != OBS_STATUS_OK) {
+            break;
+        }
+    }
+    stream_lock(context);
+    context->eof = 1;
+    stream_wake_all(context);
+    stream_unlock(context);
+}
+
+static void stream_run(stream_context *context, int task_num)
+{
+    int started = 0;
+    int i;
+#if defined __GNUC__ || defined LINUX
+    pthread_t threads[STREAM_MAX_BUFFER_NUM];
+    for (i = 0; i < task_num; i++) {
+        if (pthread_create(&threads[started], NULL, stream_worker_linux, context) == 0) {
+            started++;
+        }
+    }
+#else
+    HANDLE threads[STREAM_MAX_BUFFER_NUM];
+    for (i = 0; i < task_num; i++) {
+        threads[started] = (HANDLE)_beginthreadex(NULL, 0, stream_worker_win32, context, 0, NULL);
+        if (threads[started] != 0) {
+            started++;
+        }
+    }
+#endif
+    if (started == 0) {
+        COMMLOG(OBS_LOGERROR, "%s: create upload thread failed", __FUNCTION__);
+        stream_lock(context);
+        stream_set_failed(context, OBS_STATUS_InternalError);
+        stream_unlock(context);
+        return;
+    }
+    stream_produce(context);
+#if defined __GNUC__ || defined LINUX
+    for (i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+#else
+    for (i = 0; i < started; i++) {
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+    }
+#endif
+}
+
+/************************************************************************************
+ * 单次PUT与分段上传
+ ************************************************************************************/
+static obs_status stream_put_single(stream_context *context, const stream_buffer *buffer)
+{
+    obs_put_object_handler handler = {
+        {&stream_properties_callback, &stream_complete_callback}, &stream_data_callback, NULL
+    };
+    obs_put_object_stream_configuration *config = context->config;
+    stream_call call;
+    unsigned int attempts = 0;
+
+    for (;;) {
+        memset_s(&call, sizeof(call), 0, sizeof(call));
+        call.buffer = buffer;
+        call.status = OBS_STATUS_BUTT;
+        attempts++;
+        metrics_set_retry(OBS_METRICS_OP_PUT_OBJECT, attempts - 1);
+        put_object(context->options, context->key, buffer->length, context->put_properties,
+            config->encryption_params, &handler, &call);
+        if (call.status == OBS_STATUS_OK || !stream_should_retry(context, call.status, attempts)) {
+            break;
+        }
+        context->summary->retry_count++;
+        stream_backoff(attempts);
+    }
+    metrics_set_retry(OBS_METRICS_OP_PUT_OBJECT, 0);
+    if (call.status == OBS_STATUS_OK) {
+        context->summary->total_bytes = buffer->length;
+        memcpy_s(context->summary->etag, sizeof(context->summary->etag), call.etag, sizeof(call.etag));
+    }
+    return call.status;
+}
+
+static obs_status stream_initiate(stream_context *context)
+{
+    obs_response_handler handler = {&stream_properties_callback, &stream_complete_callback};
+    stream_call call;
+
+    memset_s(&call, sizeof(call), 0, sizeof(call));
+    call.status = OBS_STATUS_BUTT;
+    initiate_multi_part_upload(context->options, context->key, MAX_SIZE_UPLOADID, context->upload_id,
+        context->put_properties, context->config->encryption_params, &handler, &call);
+    if (call.status == OBS_STATUS_OK && context->upload_id[0] == '\0') {
+        call.status = OBS_STATUS_InvalidArgument;
+    }
+    return call.status;
+}
+
+static obs_status stream_complete(stream_context *context)
+{
+    obs_complete_multi_part_upload_handler handler = {
+        {&stream_properties_callback, &stream_complete_callback}, &stream_complete_upload_callback
+    };
+    obs_complete_upload_Info *infos = NULL;
+    stream_call call;
+    unsigned int i;
+
+    infos = (obs_complete_upload_Info *)malloc(sizeof(obs_complete_upload_Info) * context->part_count);
+    if (infos == NULL) {
+        return OBS_STATUS_OutOfMemory;
+    }
+    for (i = 0; i < context->part_count; i++) {
+        infos[i].part_number = i + 1;
+        infos[i].etag = context->etags[i];
+    }
+    memset_s(&call, sizeof(call), 0, sizeof(call));
+    call.status = OBS_STATUS_BUTT;
+    complete_multi_part_upload(context->options, context->key, context->upload_id, context->part_count, infos,
+        NULL, &handler, &call);
+    free(infos);
+    if (call.status == OBS_STATUS_OK) {
+        memcpy_s(context->summary->etag, sizeof(context->summary->etag), call.etag, sizeof(call.etag));
+    }
+    return call.status;
+}
+
+static void stream_abort(stream_context *context)
+{
+    obs_response_handler handler = {&stream_properties_callback, &stream_complete_callback};
+    stream_call call;
+
+    memset_s(&call, sizeof(call), 0, sizeof(call));
+    abort_multi_part_upload(context->options, context->key, context->upload_id, &handler, &call);
+    if (call.status != OBS_STATUS_OK) {
+        COMMLOG(OBS_LOGWARN, "%s: abort upload %s failed, status %s", __FUNCTION__, context->upload_id,
+            obs_get_status_name(call.status));
+    }
+}
+
+/************************************************************************************
+ * 压缩属性
+ ************************************************************************************/
+/**
+ * 在用户属性上追加Content-Encoding和编码元数据，with_size时追加原始大小
+ */
+static obs_status stream_prepare_properties(stream_context *context, int with_size)
+{
+    obs_put_properties *user = context->config->put_properties;
+    const char *codec = compression_codec_name(context->config->compression);
+    int count = 0;
+
+    if (context->compressor == NULL) {
+        context->put_properties = user;
+        return OBS_STATUS_OK;
+    }
+    if (user != NULL) {
+        memcpy_s(&context->properties, sizeof(obs_put_properties), user, sizeof(obs_put_properties));
+    }
+    else {
+        init_put_properties(&context->properties);
+    }
+    if (context->properties.content_encoding == NULL) {
+        context->properties.content_encoding = (char *)codec;
+    }
+    CHECK_NULL_FREE(context->meta_data);
+    context->meta_data = (obs_name_value *)malloc(sizeof(obs_name_value) * (context->properties.meta_data_count + 2));
+    if (context->meta_data == NULL) {
+        return OBS_STATUS_OutOfMemory;
+    }
+    if (user != NULL && user->meta_data_count > 0) {
+        memcpy_s(context->meta_data, sizeof(obs_name_value) * (context->properties.meta_data_count + 2),
+            user->meta_data, sizeof(obs_name_value) * user->meta_data_count);
+        count = user->meta_data_count;
+    }
+    context->meta_data[count].name = OBS_COMPRESSION_META_CODEC;
+    context->meta_data[count].value = (char *)codec;
+    count++;
+    if (with_size) {
+        snprintf_s(context->original_size, sizeof(context->original_size), _TRUNCATE, "%llu",
+            (unsigned long long)compression_reader_input_bytes(context->compressor));
+        context->meta_data[count].name = OBS_COMPRESSION_META_ORIGINAL_SIZE;
+        context->meta_data[count].value = context->original_size;
+        count++;
+    }
+    context->properties.meta_data = context->meta_data;
+    context->properties.meta_data_count = count;
+    context->put_properties = &context->properties;
+    return OBS_STATUS_OK;
+}
+
+/**
+ * 分段上传开始时原始大小未知，合并后补写；失败只记录日志，下载时按流结束处理
+ */
+static void stream_set_original_size(stream_context *context)
+{
+    obs_response_handler handler = {&stream_properties_callback, &stream_complete_callback};
+    obs_put_properties properties;
+    obs_name_value meta;
+    obs_object_info object_info;
+    stream_call call;
+
+    init_put_properties(&properties);
+    snprintf_s(context->original_size, sizeof(context->original_size), _TRUNCATE, "%llu",
+        (unsigned long long)compression_reader_input_bytes(context->compressor));
+    meta.name = OBS_COMPRESSION_META_ORIGINAL_SIZE;
+    meta.value = context->original_size;
+    properties.meta_data = &meta;
+    properties.meta_data_count = 1;
+    properties.content_encoding = context->properties.content_encoding;
+    properties.metadata_action = OBS_REPLACE_NEW;
+    object_info.key = context->key;
+    object_info.version_id = NULL;
+    memset_s(&call, sizeof(call), 0, sizeof(call));
+    call.status = OBS_STATUS_BUTT;
+    set_object_metadata(context->options, &object_info, &properties, NULL, &handler, &call);
+    if (call.status != OBS_STATUS_OK) {
+        COMMLOG(OBS_LOGWARN, "%s: set original size of %s failed, status %s", __FUNCTION__, context->key,
+            obs_get_status_name(call.status));
+    }
+}
+
+static obs_status stream_upload(stream_context *context)
+{
+    stream_buffer *first = stream_acquire(context);
+    obs_status status;
+    int task_num;
+    int eof = 0;
+
+    if (first == NULL) {
+        return context->summary->first_error_status;
+    }
+    status = stream_fill(context, first, &eof);
+    if (status != OBS_STATUS_OK) {
+        return status;
+    }
+    status = stream_prepare_properties(context, eof);
+    if (status != OBS_STATUS_OK) {
+        return status;
+    }
+    if (eof) {
+        // 总长度小于段大小，不需要分段
+        return stream_put_single(context, first);
+    }
+
+    status = stream_initiate(context);
+    if (status != OBS_STATUS_OK) {
+        COMMLOG(OBS_LOGERROR, "%s: initiate multipart upload failed, status %s", __FUNCTION__,
+            obs_get_status_name(status));
+        return status;
+    }
+    if (stream_submit(context, first) == OBS_STATUS_OK) {
+        task_num = context->config->task_num > 0 ? context->config->task_num : STREAM_DEFAULT_TASK_NUM;
+        if (task_num > context->buffer_count) {
+            task_num = context->buffer_count;
+        }
+        stream_run(context, task_num);
+    }
+    if (!context->failed) {
+        status = stream_complete(context);
+        context->summary->part_count = context->part_count;
+    }
+    else {
+        status = context->summary->first_error_status;
+    }
+    if (status != OBS_STATUS_OK) {
+        stream_abort(context);
+    }
+    else if (context->compressor != NULL) {
+        stream_set_original_size(context);
+    }
+    return status;
+}
+
+void init_put_object_stream_configuration(obs_put_object_stream_configuration *config)
+{
+    if (config == NULL) {
+        return;
+    }
+    memset_s(config, sizeof(obs_put_object_stream_configuration), 0, sizeof(obs_put_object_stream_configuration));
+    config->fd = -1;
+    config->max_retries = 3;
+}
+
+obs_status put_object_stream(const obs_options *options, char *key, obs_put_object_stream_configuration *config,
+    obs_put_object_stream_summary *summary)
+{
+    stream_context *context = NULL;
+    obs_status status;
+    int i;
+
+    if (options == NULL || key == NULL || config == NULL || summary == NULL ||
+        (config->read_callback == NULL && config->fd < 0)) {
+        COMMLOG(OBS_LOGERROR, "%s: invalid parameter", __FUNCTION__);
+        return OBS_STATUS_InvalidParameter;
+    }
+    if ((config->part_size != 0 && (config->part_size < STREAM_MIN_PART_SIZE ||
+        config->part_size > MAX_PART_SIZE)) || config->buffer_count == 1 ||
+        config->buffer_count > STREAM_MAX_BUFFER_NUM || config->task_num > STREAM_MAX_BUFFER_NUM) {
+        COMMLOG(OBS_LOGERROR, "%s: invalid part_size %llu or buffer_count %d", __FUNCTION__,
+            (unsigned long long)config->part_size, config->buffer_count);
+        return OBS_STATUS_InvalidParameter;
+    }
+    if (config->compression != OBS_COMPRESSION_NONE && !compression_supported(config->compression)) {
+        COMMLOG(OBS_LOGERROR, "%s: compression %d is not supported", __FUNCTION__, config->compression);
+        return OBS_STATUS_InvalidParameter;
+    }
+    memset_s(summary, sizeof(obs_put_object_stream_summary), 0, sizeof(obs_put_object_stream_summary));
+
+    context = (stream_context *)malloc(sizeof(stream_context));
+    if (context == NULL) {
+        return OBS_STATUS_OutOfMemory;
+    }
+    memset_s(context, sizeof(stream_context), 0, sizeof(stream_context));
+    context->options = options;
+    context->key = key;
+    context->config = config;
+    context->summary = summary;
+    context->part_size = config->part_size > 0 ? config->part_size : STREAM_DEFAULT_PART_SIZE;
+    if (config->buffer_count > 0) {
+        context->buffer_count = config->buffer_count;
+    }
+    else {
+        // 默认比上传线程多一个缓冲区，生产者在所有线程上传时仍可继续读取
+        context->buffer_count = (config->task_num > 0 ? config->task_num : STREAM_DEFAULT_TASK_NUM) + 1;
+        if (context->buffer_count > STREAM_MAX_BUFFER_NUM) {
+            context->buffer_count = STREAM_MAX_BUFFER_NUM;
+        }
+    }
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_init(&context->mutex, NULL);
+    pthread_cond_init(&context->cond, NULL);
+#else
+    InitializeCriticalSection(&context->mutex);
+    InitializeConditionVariable(&context->cond);
+#endif
+
+    status = OBS_STATUS_OK;
+    if (config->compression != OBS_COMPRESSION_NONE) {
+        status = compression_reader_create(config->compression, config->compression_level, config->task_num,
+            &stream_source_callback, context, &context->compressor);
+    }
+    if (status == OBS_STATUS_OK) {
+        status = stream_upload(context);
+    }
+    summary->original_bytes = context->compressor != NULL ? compression_reader_input_bytes(context->compressor) :
+        summary->total_bytes;
+    compression_reader_destroy(context->compressor);
+    summary->first_error_status = status;
+    COMMLOG(OBS_LOGINFO, "%s: key %s, %llu bytes, %u parts, status %s", __FUNCTION__, key,
+        (unsigned long long)summary->total_bytes, summary->part_count, obs_get_status_name(status));
+
+#if defined __GNUC__ || defined LINUX
+    pthread_cond_destroy(&context->cond);
+    pthread_mutex_destroy(&context->mutex);
+#else
+    DeleteCriticalSection(&context->mutex);
+#endif
+    for (i = 0; i < context->buffer_count; i++) {
+        CHECK_NULL_FREE(context->buffers[i].data);
+    }
+    CHECK_NULL_FREE(context->etags);
+    CHECK_NULL_FREE(context->meta_data);
+    free(context);
+    return status;
+}
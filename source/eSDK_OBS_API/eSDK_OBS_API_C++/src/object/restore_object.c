@@ -253,5 +253,6 @@ void restore_object(const obs_options *options, obs_object_info *object_info, co
     params.storageClassFormat = no_need_storage_class;
     params.use_api = use_api;
     request_perform(&params);
+    metadata_cache_invalidate_object(&params.bucketContext, object_info->key);
     COMMLOG(OBS_LOGINFO, "Leave restore_object successfully !");
 }
\ No newline at end of file
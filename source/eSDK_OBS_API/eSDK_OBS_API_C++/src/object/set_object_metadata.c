@@ -79,5 +79,6 @@ void set_object_metadata(const obs_options *options, obs_object_info *object_inf
     params.use_api = use_api;
 
     request_perform(&params);
+    metadata_cache_invalidate_object(&params.bucketContext, object_info->key);
     COMMLOG(OBS_LOGINFO, "Leave set_object_metadata successfully !");
 }
\ No newline at end of file
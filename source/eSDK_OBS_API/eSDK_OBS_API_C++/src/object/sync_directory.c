@@ -0,0 +1,1169 @@
+/*********************************************************************************
+* Copyright 2024 Huawei Technologies Co.,Ltd.
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+* this file except in compliance with the License.  You may obtain a copy of the
+* License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed
+* under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+* CONDITIONS OF ANY KIND, either express or implied.  See the License for the
+* specific language governing permissions and limitations under the License.
+**********************************************************************************
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <ctype.h>
+#include "eSDKOBS.h"
+#include "securec.h"
+#include "object.h"
+#include "request_util.h"
+#include "file_utils.h"
+#include <openssl/md5.h>
+
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if defined WIN32
+#include <io.h>
+#include <direct.h>
+#include <process.h>
+#endif
+
+#if defined __GNUC__ || defined LINUX
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#endif
+
+#define SYNC_DEFAULT_TASK_NUM       4
+#define SYNC_MAX_TASK_NUM           64
+#define SYNC_DEFAULT_PART_SIZE      (16 * 1024 * 1024)
+#define SYNC_LIST_MAX_KEYS          1000
+#define SYNC_ETAG_SIZE              48
+#define SYNC_HASH_INIT_BUCKETS      1024
+#define SYNC_READ_BUFFER_SIZE       (64 * 1024)
+#define SYNC_MANIFEST_NAME          ".obs_sync_manifest"
+#define SYNC_MANIFEST_HEADER        "#obs-sync-manifest v1"
+#define SYNC_MANIFEST_LINE_SIZE     (OBS_MAX_KEY_SIZE + 128)
+
+#define SYNC_HAS_MANIFEST           0x01
+#define SYNC_HAS_REMOTE             0x02
+#define SYNC_HAS_LOCAL              0x04
+#define SYNC_ETAG_MATCH             0x08    // 清单中记录的etag与服务端一致
+#define SYNC_DONE                   0x10    // 同步完成，需要写回清单
+
+/**
+ * 同步条目：按相对路径合并清单、服务端列举与本地扫描三方的信息
+ */
+typedef struct sync_entry
+{
+    struct sync_entry *next;
+    uint64_t hash;
+    uint64_t manifest_size;
+    int64_t manifest_mtime;
+    uint64_t local_size;
+    int64_t local_mtime;
+    uint64_t remote_size;
+    unsigned int flags;
+    char etag[SYNC_ETAG_SIZE];
+    char path[1];
+} sync_entry;
+
+typedef struct sync_table
+{
+    sync_entry **buckets;
+    uint64_t bucket_count;
+    uint64_t entry_count;
+} sync_table;
+
+typedef struct sync_job
+{
+    sync_entry *entry;
+    int need_hash;
+} sync_job;
+
+typedef struct sync_context
+{
+    const obs_options *options;
+    obs_sync_directory_configuration *config;
+    obs_sync_directory_summary *summary;
+    sync_table table;
+    char local_dir[OBS_MAX_KEY_SIZE + 1];
+    char prefix[OBS_MAX_KEY_SIZE + 1];
+    size_t prefix_len;
+    char manifest_file[OBS_MAX_KEY_SIZE + 1];
+    char manifest_tmp_file[OBS_MAX_KEY_SIZE + 1];
+    sync_job *jobs;
+    uint64_t job_count;
+    uint64_t next_job;
+    obs_status list_status;
+    int list_truncated;
+    char last_key[OBS_MAX_KEY_SIZE + 1];
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_t mutex;
+#else
+    CRITICAL_SECTION mutex;
+#endif
+} sync_context;
+
+static void sync_lock(sync_context *context)
+{
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_lock(&context->mutex);
+#else
+    EnterCriticalSection(&context->mutex);
+#endif
+}
+
+static void sync_unlock(sync_context *context)
+{
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_unlock(&context->mutex);
+#else
+    LeaveCriticalSection(&context->mutex);
+#endif
+}
+
+/************************************************************************************
+ * 条目哈希表
+ ************************************************************************************/
+static uint64_t sync_hash(const char *path)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    while (*path) {
+        hash ^= (unsigned char)*path++;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static int sync_table_init(sync_table *table)
+{
+    table->bucket_count = SYNC_HASH_INIT_BUCKETS;
+    table->entry_count = 0;
+    table->buckets = (sync_entry **)calloc((size_t)table->bucket_count, sizeof(sync_entry *));
+    return table->buckets == NULL ? -1 : 0;
+}
+
+static void sync_table_free(sync_table *table)
+{
+    uint64_t i;
+    if (table->buckets == NULL) {
+        return;
+    }
+    for (i = 0; i < table->bucket_count; i++) {
+        sync_entry *entry = table->buckets[i];
+        while (entry) {
+            sync_entry *next = entry->next;
+            free(entry);
+            entry = next;
+        }
+    }
+    free(table->buckets);
+    table->buckets = NULL;
+}
+
+static void sync_table_grow(sync_table *table)
+{
+    uint64_t new_count = table->bucket_count * 2;
+    uint64_t i;
+    sync_entry **new_buckets = (sync_entry **)calloc((size_t)new_count, sizeof(sync_entry *));
+    if (new_buckets == NULL) {
+        // 扩容失败时沿用原表，只是链更长
+        return;
+    }
+    for (i = 0; i < table->bucket_count; i++) {
+        sync_entry *entry = table->buckets[i];
+        while (entry) {
+            sync_entry *next = entry->next;
+            uint64_t index = entry->hash & (new_count - 1);
+            entry->next = new_buckets[index];
+            new_buckets[index] = entry;
+            entry = next;
+        }
+    }
+    free(table->buckets);
+    table->buckets = new_buckets;
+    table->bucket_count = new_count;
+}
+
+/**
+ * 查找相对路径对应的条目，不存在时创建
+ */
+static sync_entry *sync_table_get(sync_table *table, const char *path)
+{
+    uint64_t hash = sync_hash(path);
+    uint64_t index = hash & (table->bucket_count - 1);
+    sync_entry *entry = table->buckets[index];
+    size_t path_len;
+
+    for (; entry != NULL; entry = entry->next) {
+        if (entry->hash == hash && strcmp(entry->path, path) == 0) {
+            return entry;
+        }
+    }
+
+    path_len = strlen(path);
+    entry = (sync_entry *)malloc(sizeof(sync_entry) + path_len);
+    if (entry == NULL) {
+        return NULL;
+    }
+    memset_s(entry, sizeof(sync_entry), 0, sizeof(sync_entry));
+    memcpy_s(entry->path, path_len + 1, path, path_len + 1);
+    entry->hash = hash;
+    entry->next = table->buckets[index];
+    table->buckets[index] = entry;
+    table->entry_count++;
+    if (table->entry_count > table->bucket_count) {
+        sync_table_grow(table);
+    }
+    return entry;
+}
+
+/************************************************************************************
+ * 本地清单
+ ************************************************************************************/
+static void sync_manifest_load(sync_context *context)
+{
+    FILE *fp = NULL;
+    char *line = NULL;
+    uint64_t count = 0;
+
+    if (file_fopen_s(&fp, context->manifest_file, "r") != 0 || fp == NULL) {
+        COMMLOG(OBS_LOGINFO, "%s: no manifest file[%s], full compare", __FUNCTION__, context->manifest_file);
+        return;
+    }
+    line = (char *)malloc(SYNC_MANIFEST_LINE_SIZE);
+    if (line == NULL) {
+        fclose(fp);
+        return;
+    }
+    if (fgets(line, SYNC_MANIFEST_LINE_SIZE, fp) == NULL ||
+        strncmp(line, SYNC_MANIFEST_HEADER, strlen(SYNC_MANIFEST_HEADER)) != 0) {
+        COMMLOG(OBS_LOGWARN, "%s: manifest file[%s] is invalid, ignored", __FUNCTION__, context->manifest_file);
+        free(line);
+        fclose(fp);
+        return;
+    }
+
+    // 每行格式：size mtime etag|- relative_path
+    while (fgets(line, SYNC_MANIFEST_LINE_SIZE, fp) != NULL) {
+        char *cursor = line;
+        char *end = NULL;
+        char *etag = NULL;
+        size_t etag_len;
+        size_t line_len = strlen(line);
+        uint64_t size;
+        int64_t mtime;
+        sync_entry *entry;
+
+        while (line_len > 0 && (line[line_len - 1] == '\n' || line[line_len - 1] == '\r')) {
+            line[--line_len] = '\0';
+        }
+        size = strtoull(cursor, &end, 10);
+        if (end == cursor || *end != ' ') {
+            continue;
+        }
+        cursor = end + 1;
+        mtime = strtoll(cursor, &end, 10);
+        if (end == cursor || *end != ' ') {
+            continue;
+        }
+        etag = end + 1;
+        cursor = strchr(etag, ' ');
+        if (cursor == NULL || cursor[1] == '\0') {
+            continue;
+        }
+        etag_len = (size_t)(cursor - etag);
+        if (etag_len >= SYNC_ETAG_SIZE) {
+            continue;
+        }
+        entry = sync_table_get(&context->table, cursor + 1);
+        if (entry == NULL) {
+            break;
+        }
+        entry->manifest_size = size;
+        entry->manifest_mtime = mtime;
+        entry->flags |= SYNC_HAS_MANIFEST;
+        if (!(etag_len == 1 && etag[0] == '-')) {
+            memcpy_s(entry->etag, SYNC_ETAG_SIZE, etag, etag_len);
+            entry->etag[etag_len] = '\0';
+        }
+        count++;
+    }
+    free(line);
+    fclose(fp);
+    COMMLOG(OBS_LOGINFO, "%s: loaded %llu entries from manifest[%s]", __FUNCTION__,
+        (unsigned long long)count, context->manifest_file);
+}
+
+/**
+ * 先写临时文件再rename，避免中途失败留下残缺的清单
+ */
+static int sync_manifest_save(sync_context *context)
+{
+    FILE *fp = NULL;
+    uint64_t i;
+    int ret = 0;
+
+    if (file_fopen_s(&fp, context->manifest_tmp_file, "w") != 0 || fp == NULL) {
+        COMMLOG(OBS_LOGERROR, "%s: open manifest file[%s] failed", __FUNCTION__, context->manifest_tmp_file);
+        return -1;
+    }
+    if (fprintf(fp, "%s\n", SYNC_MANIFEST_HEADER) < 0) {
+        ret = -1;
+    }
+    for (i = 0; i < context->table.bucket_count && ret == 0; i++) {
+        sync_entry *entry = context->table.buckets[i];
+        for (; entry != NULL; entry = entry->next) {
+            if (!(entry->flags & SYNC_DONE)) {
+                continue;
+            }
+            if (fprintf(fp, "%llu %lld %s %s\n", (unsigned long long)entry->local_size,
+                (long long)entry->local_mtime, entry->etag[0] ? entry->etag : "-", entry->path) < 0) {
+                ret = -1;
+                break;
+            }
+        }
+    }
+    if (fclose(fp) != 0) {
+        ret = -1;
+    }
+    if (ret == 0) {
+#if defined WIN32
+        (void)remove_file(context->manifest_file);
+#endif
+        if (rename(context->manifest_tmp_file, context->manifest_file) != 0) {
+            ret = -1;
+        }
+    }
+    if (ret != 0) {
+        COMMLOG(OBS_LOGERROR, "%s: write manifest file[%s] failed", __FUNCTION__, context->manifest_file);
+        (void)remove_file(context->manifest_tmp_file);
+    }
+    return ret;
+}
+
+/************************************************************************************
+ * 服务端列举
+ ************************************************************************************/
+static obs_status sync_list_properties_callback(const obs_response_properties *properties, void *callback_data)
+{
+    (void)properties;
+    (void)callback_data;
+    return OBS_STATUS_OK;
+}
+
+static void sync_list_complete_callback(obs_status status, const obs_error_details *error, void *callback_data)
+{
+    sync_context *context = (sync_context *)callback_data;
+    (void)error;
+    context->list_status = status;
+}
+
+/* 去掉etag两侧的引号后复制，过长时记为空 */
+static void sync_copy_etag(char *dest, const char *etag)
+{
+    size_t etag_len;
+    if (etag == NULL) {
+        etag = "";
+    }
+    if (etag[0] == '"') {
+        etag++;
+    }
+    etag_len = strlen(etag);
+    if (etag_len > 0 && etag[etag_len - 1] == '"') {
+        etag_len--;
+    }
+    if (etag_len >= SYNC_ETAG_SIZE) {
+        etag_len = 0;
+    }
+    memcpy_s(dest, SYNC_ETAG_SIZE, etag, etag_len);
+    dest[etag_len] = '\0';
+}
+
+static int sync_is_separator(char c)
+{
+#if defined WIN32
+    return c == '/' || c == '\\';
+#else
+    return c == '/';
+#endif
+}
+
+/**
+ * 下载时相对路径直接拼接在本地目录之后，拒绝绝对路径以及空、"."、".."路径段，
+ * 避免对象名将文件写到同步目录之外
+ */
+static int sync_is_safe_path(const char *path)
+{
+    const char *segment = path;
+    const char *cursor = path;
+#if defined WIN32
+    if (strchr(path, ':') != NULL) {
+        return 0;
+    }
+#endif
+    for (;; cursor++) {
+        if (*cursor != '\0' && !sync_is_separator(*cursor)) {
+            continue;
+        }
+        size_t len = (size_t)(cursor - segment);
+        if (len == 0 || (len == 1 && segment[0] == '.') ||
+            (len == 2 && segment[0] == '.' && segment[1] == '.')) {
+            return 0;
+        }
+        if (*cursor == '\0') {
+            return 1;
+        }
+        segment = cursor + 1;
+    }
+}
+
+static void sync_reject_key(sync_context *context, const char *relative_path)
+{
+    COMMLOG(OBS_LOGWARN, "%s: object key [%s%s] is not a safe relative path, skipped", __FUNCTION__,
+        context->prefix, relative_path);
+    if (context->config->direction != OBS_SYNC_FROM_BUCKET) {
+        return;
+    }
+    context->summary->failed_count++;
+    if (context->summary->first_error_status == OBS_STATUS_OK) {
+        context->summary->first_error_status = OBS_STATUS_InvalidKey;
+    }
+    if (context->config->file_callback) {
+        context->config->file_callback(relative_path, OBS_STATUS_InvalidKey, context->config->callback_data);
+    }
+}
+
+static obs_status sync_list_objects_callback(int is_truncated, const char *next_marker, int contents_count,
+    const obs_list_objects_content *contents, int common_prefixes_count, const char **common_prefixes,
+    void *callback_data)
+{
+    sync_context *context = (sync_context *)callback_data;
+    int i;
+    (void)next_marker;
+    (void)common_prefixes_count;
+    (void)common_prefixes;
+
+    for (i = 0; i < contents_count; i++) {
+        const char *key = contents[i].key;
+        size_t key_len = strlen(key);
+        sync_entry *entry;
+        char etag[SYNC_ETAG_SIZE];
+
+        // 每页结束后用最后一个key作为下一次列举的marker
+        if (snprintf_s(context->last_key, sizeof(context->last_key), _TRUNCATE, "%s", key) < 0) {
+            return OBS_STATUS_UriTooLong;
+        }
+        if (key_len <= context->prefix_len || key[key_len - 1] == '/') {
+            continue;
+        }
+        if (!sync_is_safe_path(key + context->prefix_len)) {
+            sync_reject_key(context, key + context->prefix_len);
+            continue;
+        }
+        entry = sync_table_get(&context->table, key + context->prefix_len);
+        if (entry == NULL) {
+            return OBS_STATUS_OutOfMemory;
+        }
+        sync_copy_etag(etag, contents[i].etag);
+        if ((entry->flags & SYNC_HAS_MANIFEST) && entry->etag[0] != '\0' && strcmp(entry->etag, etag) == 0) {
+            entry->flags |= SYNC_ETAG_MATCH;
+        }
+        memcpy_s(entry->etag, SYNC_ETAG_SIZE, etag, strlen(etag) + 1);
+        entry->remote_size = contents[i].size;
+        entry->flags |= SYNC_HAS_REMOTE;
+        context->summary->remote_object_count++;
+    }
+    context->list_truncated = is_truncated;
+    return OBS_STATUS_OK;
+}
+
+static obs_status sync_list_remote(sync_context *context)
+{
+    obs_list_objects_handler handler = {
+        {&sync_list_properties_callback, &sync_list_complete_callback},
+        &sync_list_objects_callback
+    };
+    char marker[OBS_MAX_KEY_SIZE + 1] = {0};
+
+    for (;;) {
+        context->list_status = OBS_STATUS_InternalError;
+        context->list_truncated = 0;
+        context->last_key[0] = '\0';
+        list_bucket_objects(context->options, context->prefix, marker[0] ? marker : NULL, NULL,
+            SYNC_LIST_MAX_KEYS, &handler, context);
+        if (context->list_status != OBS_STATUS_OK) {
+            COMMLOG(OBS_LOGERROR, "%s: list objects with prefix[%s] failed, status = %d", __FUNCTION__,
+                context->prefix, context->list_status);
+            return context->list_status;
+        }
+        if (!context->list_truncated || context->last_key[0] == '\0' || strcmp(context->last_key, marker) == 0) {
+            return OBS_STATUS_OK;
+        }
+        memcpy_s(marker, sizeof(marker), context->last_key, strlen(context->last_key) + 1);
+    }
+}
+
+/************************************************************************************
+ * 本地目录扫描
+ ************************************************************************************/
+static int sync_is_manifest_path(sync_context *context, const char *full_path)
+{
+    return strcmp(full_path, context->manifest_file) == 0 || strcmp(full_path, context->manifest_tmp_file) == 0;
+}
+
+static obs_status sync_record_local(sync_context *context, const char *relative_path,
+    uint64_t size, int64_t mtime)
+{
+    sync_entry *entry = sync_table_get(&context->table, relative_path);
+    if (entry == NULL) {
+        return OBS_STATUS_OutOfMemory;
+    }
+    entry->local_size = size;
+    entry->local_mtime = mtime;
+    entry->flags |= SYNC_HAS_LOCAL;
+    context->summary->local_file_count++;
+    return OBS_STATUS_OK;
+}
+
+#if defined __GNUC__ || defined LINUX
+static obs_status sync_walk_local(sync_context *context, char *full_path, size_t full_len)
+{
+    DIR *dir = opendir(full_path);
+    struct dirent *item = NULL;
+    size_t base_len = strlen(context->local_dir) + 1;
+    obs_status status = OBS_STATUS_OK;
+
+    if (dir == NULL) {
+        COMMLOG(OBS_LOGERROR, "%s: open dir[%s] failed, errno = %d", __FUNCTION__, full_path, errno);
+        return OBS_STATUS_OpenFileFailed;
+    }
+    while (status == OBS_STATUS_OK && (item = readdir(dir)) != NULL) {
+        struct stat statbuf;
+        if (strcmp(item->d_name, ".") == 0 || strcmp(item->d_name, "..") == 0) {
+            continue;
+        }
+        if (snprintf_s(full_path + full_len, OBS_MAX_KEY_SIZE + 1 - full_len, _TRUNCATE,
+            "/%s", item->d_name) < 0) {
+            COMMLOG(OBS_LOGWARN, "%s: path too long under [%s], skipped", __FUNCTION__, full_path);
+            full_path[full_len] = '\0';
+            continue;
+        }
+        // 不跟随符号链接，避免目录链接成环时无限递归
+        if (lstat(full_path, &statbuf) != 0 || S_ISLNK(statbuf.st_mode)) {
+            full_path[full_len] = '\0';
+            continue;
+        }
+        if (S_ISDIR(statbuf.st_mode)) {
+            status = sync_walk_local(context, full_path, strlen(full_path));
+        }
+        else if (S_ISREG(statbuf.st_mode) && !sync_is_manifest_path(context, full_path)) {
+            status = sync_record_local(context, full_path + base_len,
+                (uint64_t)statbuf.st_size, (int64_t)statbuf.st_mtime);
+        }
+        full_path[full_len] = '\0';
+    }
+    closedir(dir);
+    return status;
+}
+#else
+static obs_status sync_walk_local(sync_context *context, char *full_path, size_t full_len)
+{
+    struct _finddata64_t item;
+    intptr_t handle;
+    size_t base_len = strlen(context->local_dir) + 1;
+    obs_status status = OBS_STATUS_OK;
+
+    if (snprintf_s(full_path + full_len, OBS_MAX_KEY_SIZE + 1 - full_len, _TRUNCATE, "/*") < 0) {
+        return OBS_STATUS_UriTooLong;
+    }
+    handle = _findfirst64(full_path, &item);
+    full_path[full_len] = '\0';
+    if (handle == -1) {
+        COMMLOG(OBS_LOGERROR, "%s: open dir[%s] failed", __FUNCTION__, full_path);
+        return OBS_STATUS_OpenFileFailed;
+    }
+    do {
+        if (strcmp(item.name, ".") == 0 || strcmp(item.name, "..") == 0) {
+            continue;
+        }
+        if (snprintf_s(full_path + full_len, OBS_MAX_KEY_SIZE + 1 - full_len, _TRUNCATE,
+            "/%s", item.name) < 0) {
+            full_path[full_len] = '\0';
+            continue;
+        }
+        // 跳过符号链接和目录联接
+        DWORD attributes = GetFileAttributesA(full_path);
+        if (attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_REPARSE_POINT)) {
+            full_path[full_len] = '\0';
+            continue;
+        }
+        if (item.attrib & _A_SUBDIR) {
+            status = sync_walk_local(context, full_path, strlen(full_path));
+        }
+        else if (!sync_is_manifest_path(context, full_path)) {
+            status = sync_record_local(context, full_path + base_len,
+                (uint64_t)item.size, (int64_t)item.time_write);
+        }
+        full_path[full_len] = '\0';
+    } while (status == OBS_STATUS_OK && _findnext64(handle, &item) == 0);
+    _findclose(handle);
+    return status;
+}
+#endif
+
+/************************************************************************************
+ * 单个文件的比对与传输
+ ************************************************************************************/
+static int sync_local_stat(const char *path, uint64_t *size, int64_t *mtime)
+{
+#if defined __GNUC__ || defined LINUX
+    struct stat statbuf;
+    if (stat(path, &statbuf) != 0) {
+        return -1;
+    }
+#else
+    struct __stat64 statbuf;
+    if (file_stati64(path, &statbuf) != 0) {
+        return -1;
+    }
+#endif
+    *size = (uint64_t)statbuf.st_size;
+    *mtime = (int64_t)statbuf.st_mtime;
+    return 0;
+}
+
+/**
+ * 计算本地文件的MD5并与服务端etag比较，分段上传的etag不是内容MD5，此时视为不一致
+ */
+static int sync_md5_equal(const char *path, const char *etag)
+{
+    static const char hex[] = "0123456789abcdef";
+    unsigned char digest[MD5_DIGEST_LENGTH];
+    char digest_hex[MD5_DIGEST_LENGTH * 2 + 1];
+    unsigned char *buffer = NULL;
+    FILE *fp = NULL;
+    MD5_CTX md5;
+    size_t read_len;
+    int i;
+
+    if (strlen(etag) != MD5_DIGEST_LENGTH * 2) {
+        return 0;
+    }
+    if (file_fopen_s(&fp, path, "rb") != 0 || fp == NULL) {
+        return 0;
+    }
+    buffer = (unsigned char *)malloc(SYNC_READ_BUFFER_SIZE);
+    if (buffer == NULL) {
+        fclose(fp);
+        return 0;
+    }
+    MD5_Init(&md5);
+    while ((read_len = fread(buffer, 1, SYNC_READ_BUFFER_SIZE, fp)) > 0) {
+        MD5_Update(&md5, buffer, read_len);
+    }
+    MD5_Final(digest, &md5);
+    free(buffer);
+    fclose(fp);
+
+    for (i = 0; i < MD5_DIGEST_LENGTH; i++) {
+        digest_hex[i * 2] = hex[digest[i] >> 4];
+        digest_hex[i * 2 + 1] = hex[digest[i] & 0x0F];
+    }
+    digest_hex[MD5_DIGEST_LENGTH * 2] = '\0';
+    for (i = 0; i < MD5_DIGEST_LENGTH * 2; i++) {
+        if (digest_hex[i] != tolower((unsigned char)etag[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+typedef struct sync_transfer_data
+{
+    obs_status status;
+    obs_status complete_status;
+    int callback_made;
+} sync_transfer_data;
+
+static obs_status sync_transfer_properties_callback(const obs_response_properties *properties,
+    void *callback_data)
+{
+    (void)properties;
+    (void)callback_data;
+    return OBS_STATUS_OK;
+}
+
+static void sync_transfer_complete_callback(obs_status status, const obs_error_details *error,
+    void *callback_data)
+{
+    sync_transfer_data *data = (sync_transfer_data *)callback_data;
+    (void)error;
+    if (status != OBS_STATUS_OK && data->complete_status == OBS_STATUS_OK) {
+        data->complete_status = status;
+    }
+}
+
+static void sync_upload_file_callback(obs_status status, char *result_message, int part_count_return,
+    obs_upload_file_part_info *upload_info_list, void *callback_data)
+{
+    sync_transfer_data *data = (sync_transfer_data *)callback_data;
+    (void)result_message;
+    (void)part_count_return;
+    (void)upload_info_list;
+    data->status = status;
+    data->callback_made = 1;
+}
+
+static void sync_download_file_callback(obs_status status, char *result_message, int part_count_return,
+    obs_download_file_part_info *download_info_list, void *callback_data)
+{
+    sync_transfer_data *data = (sync_transfer_data *)callback_data;
+    (void)result_message;
+    (void)part_count_return;
+    (void)download_info_list;
+    data->status = status;
+    data->callback_made = 1;
+}
+
+static obs_status sync_transfer_result(const sync_transfer_data *data)
+{
+    if (data->callback_made && data->status != OBS_STATUS_OK) {
+        return data->status;
+    }
+    if (data->complete_status != OBS_STATUS_OK) {
+        return data->complete_status;
+    }
+    return data->callback_made ? OBS_STATUS_OK : OBS_STATUS_InternalError;
+}
+
+static obs_status sync_upload_one(sync_context *context, char *local_path, char *key)
+{
+    obs_sync_directory_configuration *config = context->config;
+    obs_upload_file_configuration upload_config;
+    obs_upload_file_server_callback server_callback;
+    obs_upload_file_response_handler handler = {
+        {&sync_transfer_properties_callback, &sync_transfer_complete_callback},
+        &sync_upload_file_callback,
+        NULL
+    };
+    sync_transfer_data data = {OBS_STATUS_OK, OBS_STATUS_OK, 0};
+    int pause_flag = 0;
+
+    memset_s(&upload_config, sizeof(upload_config), 0, sizeof(upload_config));
+    memset_s(&server_callback, sizeof(server_callback), 0, sizeof(server_callback));
+    upload_config.upload_file = local_path;
+    upload_config.part_size = config->part_size ? config->part_size : SYNC_DEFAULT_PART_SIZE;
+    upload_config.enable_check_point = 0;
+    upload_config.task_num = 1;
+    upload_config.pause_upload_flag = &pause_flag;
+
+    upload_file(context->options, key, NULL, &upload_config, server_callback, &handler, &data);
+    return sync_transfer_result(&data);
+}
+
+typedef struct sync_head_data
+{
+    obs_status status;
+    char etag[SYNC_ETAG_SIZE];
+} sync_head_data;
+
+static obs_status sync_head_properties_callback(const obs_response_properties *properties, void *callback_data)
+{
+    sync_head_data *data = (sync_head_data *)callback_data;
+    sync_copy_etag(data->etag, properties->etag);
+    return OBS_STATUS_OK;
+}
+
+static void sync_head_complete_callback(obs_status status, const obs_error_details *error, void *callback_data)
+{
+    sync_head_data *data = (sync_head_data *)callback_data;
+    (void)error;
+    data->status = status;
+}
+
+/**
+ * 读取上传后对象的etag记入清单，使下次同步能发现服务端的同大小覆盖；
+ * 分段上传的etag只能从服务端获取，且不能使用元数据缓存中的旧值
+ */
+static void sync_fetch_etag(sync_context *context, char *key, char *etag)
+{
+    obs_object_info object_info = {key, NULL};
+    obs_response_handler handler = {&sync_head_properties_callback, &sync_head_complete_callback};
+    sync_head_data data;
+
+    memset_s(&data, sizeof(data), 0, sizeof(data));
+    data.status = OBS_STATUS_InternalError;
+    get_object_metadata_internal(context->options, &object_info, NULL, &handler, &data, 0);
+    if (data.status != OBS_STATUS_OK) {
+        COMMLOG(OBS_LOGWARN, "%s: head object [%s] failed, status = %d", __FUNCTION__, key, data.status);
+        data.etag[0] = '\0';
+    }
+    memcpy_s(etag, SYNC_ETAG_SIZE, data.etag, strlen(data.etag) + 1);
+}
+
+static obs_status sync_download_one(sync_context *context, char *local_path, char *key)
+{
+    obs_sync_directory_configuration *config = context->config;
+    obs_download_file_configuration download_config;
+    obs_download_file_response_handler handler = {
+        {&sync_transfer_properties_callback, &sync_transfer_complete_callback},
+        &sync_download_file_callback
+    };
+    sync_transfer_data data = {OBS_STATUS_OK, OBS_STATUS_OK, 0};
+    obs_get_conditions get_conditions;
+
+    init_get_properties(&get_conditions);
+    memset_s(&download_config, sizeof(download_config), 0, sizeof(download_config));
+    download_config.downLoad_file = local_path;
+    download_config.part_size = config->part_size ? config->part_size : SYNC_DEFAULT_PART_SIZE;
+    download_config.enable_check_point = 0;
+    download_config.task_num = 1;
+
+    // download_file不会截断已存在的文件，先删除旧文件
+    make_parent_dirs(local_path);
+    (void)remove_file(local_path);
+    download_file(context->options, key, NULL, &get_conditions, NULL, &download_config, &handler, &data);
+    return sync_transfer_result(&data);
+}
+
+static void sync_run_job(sync_context *context, sync_job *job, char *local_path, char *key)
+{
+    sync_entry *entry = job->entry;
+    obs_sync_directory_summary *summary = context->summary;
+    int upload = context->config->direction == OBS_SYNC_TO_BUCKET;
+    obs_status status = OBS_STATUS_OK;
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    int skipped = 0;
+
+    if (snprintf_s(local_path, OBS_MAX_KEY_SIZE + 1, _TRUNCATE, "%s/%s", context->local_dir, entry->path) < 0 ||
+        snprintf_s(key, OBS_MAX_KEY_SIZE + 1, _TRUNCATE, "%s%s", context->prefix, entry->path) < 0) {
+        status = OBS_STATUS_UriTooLong;
+    }
+    else if (job->need_hash && sync_md5_equal(local_path, entry->etag)) {
+        skipped = 1;
+    }
+    else if (upload) {
+        status = sync_upload_one(context, local_path, key);
+    }
+    else {
+        status = sync_download_one(context, local_path, key);
+    }
+
+    if (status == OBS_STATUS_OK) {
+        if (upload) {
+            if (!skipped) {
+                sync_fetch_etag(context, key, entry->etag);
+            }
+        }
+        else if (sync_local_stat(local_path, &size, &mtime) == 0) {
+            entry->local_size = size;
+            entry->local_mtime = mtime;
+        }
+        else {
+            status = OBS_STATUS_OpenFileFailed;
+        }
+    }
+
+    sync_lock(context);
+    if (job->need_hash) {
+        summary->hashed_count++;
+    }
+    if (status != OBS_STATUS_OK) {
+        summary->failed_count++;
+        if (summary->first_error_status == OBS_STATUS_OK) {
+            summary->first_error_status = status;
+        }
+    }
+    else if (skipped) {
+        summary->skipped_count++;
+        entry->flags |= SYNC_DONE;
+    }
+    else {
+        summary->transferred_count++;
+        summary->transferred_bytes += upload ? entry->local_size : entry->remote_size;
+        entry->flags |= SYNC_DONE;
+    }
+    sync_unlock(context);
+
+    if (!skipped && context->config->file_callback) {
+        context->config->file_callback(entry->path, status, context->config->callback_data);
+    }
+}
+
+static void sync_worker(sync_context *context)
+{
+    char *local_path = (char *)malloc(OBS_MAX_KEY_SIZE + 1);
+    char *key = (char *)malloc(OBS_MAX_KEY_SIZE + 1);
+    if (local_path == NULL || key == NULL) {
+        CHECK_NULL_FREE(local_path);
+        CHECK_NULL_FREE(key);
+        return;
+    }
+    for (;;) {
+        sync_job *job = NULL;
+        sync_lock(context);
+        if (context->next_job < context->job_count) {
+            job = &context->jobs[context->next_job++];
+        }
+        sync_unlock(context);
+        if (job == NULL) {
+            break;
+        }
+        sync_run_job(context, job, local_path, key);
+    }
+    free(local_path);
+    free(key);
+}
+
+#if defined __GNUC__ || defined LINUX
+static void *sync_worker_linux(void *arg)
+{
+    sync_worker((sync_context *)arg);
+    return NULL;
+}
+#else
+static unsigned __stdcall sync_worker_win32(void *arg)
+{
+    sync_worker((sync_context *)arg);
+    return 0;
+}
+#endif
+
+static void sync_run_jobs(sync_context *context, int task_num)
+{
+    int started = 0;
+    int i;
+#if defined __GNUC__ || defined LINUX
+    pthread_t threads[SYNC_MAX_TASK_NUM];
+    for (i = 0; i < task_num; i++) {
+        if (pthread_create(&threads[started], NULL, sync_worker_linux, context) == 0) {
+            started++;
+        }
+    }
+    if (started == 0) {
+        sync_worker(context);
+    }
+    for (i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+#else
+    HANDLE threads[SYNC_MAX_TASK_NUM];
+    for (i = 0; i < task_num; i++) {
+        threads[started] = (HANDLE)_beginthreadex(NULL, 0, sync_worker_win32, context, 0, NULL);
+        if (threads[started] != 0) {
+            started++;
+        }
+    }
+    if (started == 0) {
+        sync_worker(context);
+    }
+    for (i = 0; i < started; i++) {
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+    }
+#endif
+}
+
+/************************************************************************************
+ * 比对计划
+ ************************************************************************************/
+/**
+ * 判断条目是否需要同步；清单中的size/mtime与本地一致时直接信任清单，无需读取文件内容
+ * 返回0表示跳过，1表示需要传输，2表示大小一致需计算MD5确认
+ */
+static int sync_plan_entry(sync_context *context, sync_entry *entry)
+{
+    unsigned int flags = entry->flags;
+    int local_unchanged = (flags & SYNC_HAS_MANIFEST) && (flags & SYNC_HAS_LOCAL) &&
+        entry->manifest_size == entry->local_size && entry->manifest_mtime == entry->local_mtime;
+    int same_size = (flags & SYNC_HAS_REMOTE) && (flags & SYNC_HAS_LOCAL) &&
+        entry->remote_size == entry->local_size;
+
+    if (context->config->direction == OBS_SYNC_TO_BUCKET) {
+        if (!(flags & SYNC_HAS_LOCAL)) {
+            return 0;
+        }
+    }
+    else if (!(flags & SYNC_HAS_REMOTE)) {
+        return 0;
+    }
+
+    if (same_size && local_unchanged && (flags & SYNC_ETAG_MATCH)) {
+        return 0;
+    }
+    // 本地有变化，或清单中没有可比对的etag而服务端可能已被同大小的内容覆盖
+    if (same_size) {
+        return 2;
+    }
+    return 1;
+}
+
+static obs_status sync_build_jobs(sync_context *context)
+{
+    uint64_t capacity = context->table.entry_count;
+    uint64_t i;
+
+    context->jobs = (sync_job *)malloc(sizeof(sync_job) * (size_t)(capacity ? capacity : 1));
+    if (context->jobs == NULL) {
+        return OBS_STATUS_OutOfMemory;
+    }
+    for (i = 0; i < context->table.bucket_count; i++) {
+        sync_entry *entry = context->table.buckets[i];
+        for (; entry != NULL; entry = entry->next) {
+            int plan = sync_plan_entry(context, entry);
+            if (plan == 0) {
+                if ((context->config->direction == OBS_SYNC_TO_BUCKET && (entry->flags & SYNC_HAS_LOCAL)) ||
+                    (context->config->direction == OBS_SYNC_FROM_BUCKET && (entry->flags & SYNC_HAS_REMOTE))) {
+                    context->summary->skipped_count++;
+                    entry->flags |= SYNC_DONE;
+                }
+                continue;
+            }
+            context->jobs[context->job_count].entry = entry;
+            context->jobs[context->job_count].need_hash = (plan == 2);
+            context->job_count++;
+        }
+    }
+    return OBS_STATUS_OK;
+}
+
+static obs_status sync_init_context(sync_context *context, const obs_options *options,
+    obs_sync_directory_configuration *config, obs_sync_directory_summary *summary)
+{
+    size_t len;
+    const char *prefix = config->prefix ? config->prefix : "";
+
+    memset_s(context, sizeof(sync_context), 0, sizeof(sync_context));
+    context->options = options;
+    context->config = config;
+    context->summary = summary;
+
+    if (snprintf_s(context->local_dir, sizeof(context->local_dir), _TRUNCATE, "%s", config->local_dir) < 0) {
+        return OBS_STATUS_InvalidParameter;
+    }
+    len = strlen(context->local_dir);
+    while (len > 1 && (context->local_dir[len - 1] == '/' || context->local_dir[len - 1] == '\\')) {
+        context->local_dir[--len] = '\0';
+    }
+    len = strlen(prefix);
+    if (snprintf_s(context->prefix, sizeof(context->prefix), _TRUNCATE, "%s%s", prefix,
+        (len > 0 && prefix[len - 1] != '/') ? "/" : "") < 0) {
+        return OBS_STATUS_InvalidParameter;
+    }
+    context->prefix_len = strlen(context->prefix);
+
+    if (config->manifest_file) {
+        if (snprintf_s(context->manifest_file, sizeof(context->manifest_file), _TRUNCATE, "%s",
+            config->manifest_file) < 0) {
+            return OBS_STATUS_InvalidParameter;
+        }
+    }
+    else if (snprintf_s(context->manifest_file, sizeof(context->manifest_file), _TRUNCATE, "%s/%s",
+        context->local_dir, SYNC_MANIFEST_NAME) < 0) {
+        return OBS_STATUS_InvalidParameter;
+    }
+    if (snprintf_s(context->manifest_tmp_file, sizeof(context->manifest_tmp_file), _TRUNCATE, "%s.tmp",
+        context->manifest_file) < 0) {
+        return OBS_STATUS_InvalidParameter;
+    }
+    if (sync_table_init(&context->table) != 0) {
+        return OBS_STATUS_OutOfMemory;
+    }
+    return OBS_STATUS_OK;
+}
+
+obs_status obs_sync_directory(const obs_options *options, obs_sync_directory_configuration *config,
+    obs_sync_directory_summary *summary)
+{
+    sync_context *context = NULL;
+    obs_status status;
+    char *walk_path = NULL;
+    int task_num;
+
+    if (options == NULL || config == NULL || summary == NULL || config->local_dir == NULL ||
+        config->local_dir[0] == '\0') {
+        COMMLOG(OBS_LOGERROR, "%s: invalid parameter", __FUNCTION__);
+        return OBS_STATUS_InvalidParameter;
+    }
+    if (config->direction != OBS_SYNC_TO_BUCKET && config->direction != OBS_SYNC_FROM_BUCKET) {
+        COMMLOG(OBS_LOGERROR, "%s: invalid direction %d", __FUNCTION__, config->direction);
+        return OBS_STATUS_InvalidParameter;
+    }
+    memset_s(summary, sizeof(obs_sync_directory_summary), 0, sizeof(obs_sync_directory_summary));
+
+    context = (sync_context *)malloc(sizeof(sync_context));
+    walk_path = (char *)malloc(OBS_MAX_KEY_SIZE + 1);
+    if (context == NULL || walk_path == NULL) {
+        CHECK_NULL_FREE(context);
+        CHECK_NULL_FREE(walk_path);
+        return OBS_STATUS_OutOfMemory;
+    }
+    status = sync_init_context(context, options, config, summary);
+    if (status != OBS_STATUS_OK) {
+        sync_table_free(&context->table);
+        free(context);
+        free(walk_path);
+        return status;
+    }
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_init(&context->mutex, NULL);
+#else
+    InitializeCriticalSection(&context->mutex);
+#endif
+
+    sync_manifest_load(context);
+    status = sync_list_remote(context);
+    if (status == OBS_STATUS_OK) {
+        memcpy_s(walk_path, OBS_MAX_KEY_SIZE + 1, context->local_dir, strlen(context->local_dir) + 1);
+        status = sync_walk_local(context, walk_path, strlen(walk_path));
+        if (status == OBS_STATUS_OpenFileFailed && config->direction == OBS_SYNC_FROM_BUCKET) {
+            // 下载到尚不存在的目录
+            status = OBS_STATUS_OK;
+        }
+    }
+    if (status == OBS_STATUS_OK) {
+        status = sync_build_jobs(context);
+    }
+    if (status == OBS_STATUS_OK) {
+        COMMLOG(OBS_LOGINFO, "%s: local %llu, remote %llu, to sync %llu", __FUNCTION__,
+            (unsigned long long)summary->local_file_count, (unsigned long long)summary->remote_object_count,
+            (unsigned long long)context->job_count);
+        task_num = config->task_num > 0 ? config->task_num : SYNC_DEFAULT_TASK_NUM;
+        if (task_num > SYNC_MAX_TASK_NUM) {
+            task_num = SYNC_MAX_TASK_NUM;
+        }
+        if ((uint64_t)task_num > context->job_count) {
+            task_num = (int)context->job_count;
+        }
+        if (task_num > 0) {
+            sync_run_jobs(context, task_num);
+        }
+        if (config->direction == OBS_SYNC_FROM_BUCKET) {
+            make_parent_dirs(context->manifest_file);
+        }
+        if (sync_manifest_save(context) != 0 && summary->first_error_status == OBS_STATUS_OK) {
+            summary->first_error_status = OBS_STATUS_OpenFileFailed;
+        }
+        status = summary->first_error_status;
+    }
+
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_destroy(&context->mutex);
+#else
+    DeleteCriticalSection(&context->mutex);
+#endif
+    CHECK_NULL_FREE(context->jobs);
+    sync_table_free(&context->table);
+    free(context);
+    free(walk_path);
+    return status;
+}
@@ -21,13 +21,12 @@
 #include "request_util.h"
 #include "file_utils.h"
 #include <openssl/md5.h> 
+#include <ctype.h>
 
 #if defined WIN32
 #include <io.h>
 #include <share.h>
 #include <process.h>
-CRITICAL_SECTION  g_csThreadCheckpoint;
-CRITICAL_SECTION  g_csThreadCheckpoint_download;
 #endif
 
 #include <fcntl.h>
@@ -37,36 +36,22 @@ CRITICAL_SECTION  g_csThreadCheckpoint_download;
 #if defined __GNUC__ || defined LINUX
 #include <unistd.h>
 #include <pthread.h>
-pthread_mutex_t g_mutexThreadCheckpoint;
-pthread_mutex_t g_mutexThreadCheckpoint_download;
 #endif
 
 #include <libxml/parser.h>
 #include <libxml/tree.h>
 
 #define OBS_MAX_PARTCOUNT_SIZE 65536
+#define RESUME_LIST_PAGE_SIZE 1000
+#define RESUME_VERIFY_BUFFER_SIZE (1024 * 1024)
 
+//checkpoint files are locked per transfer now, these are kept for compatibility
 void initialize_break_point_lock(void)
 {
-#if defined __GNUC__ || defined LINUX
-    pthread_mutex_init(&g_mutexThreadCheckpoint_download, NULL);
-    pthread_mutex_init(&g_mutexThreadCheckpoint, NULL);
-#else
-    InitializeCriticalSection(&g_csThreadCheckpoint_download);
-    InitializeCriticalSection(&g_csThreadCheckpoint);
-#endif
 }
 
 void deinitialize_break_point_lock(void)
 {
-#if defined __GNUC__ || defined LINUX
-    pthread_mutex_destroy(&g_mutexThreadCheckpoint_download);
-    pthread_mutex_destroy(&g_mutexThreadCheckpoint);
-#else
-    DeleteCriticalSection(&g_csThreadCheckpoint_download);
-    DeleteCriticalSection(&g_csThreadCheckpoint);
-#endif
-
 }
 
 
@@ -166,6 +151,16 @@ errno_t parse_xmlnode_fileinfo_paramCpy(upload_file_summary *pstUploadFileSummar
     {
         err = memcpy_s(pstUploadFileSummary->key, MAX_KEY_SIZE, nodeContent, strlen((char*)nodeContent) + 1);
     }
+    else if (!xmlStrcmp(fileinfoNode->name, (xmlChar *)"encryptionkey"))
+    {
+        err = memcpy_s(pstUploadFileSummary->encryptionKey, CLIENT_ENCRYPTION_TEXT_SIZE, nodeContent,
+            strlen((char*)nodeContent) + 1);
+    }
+    else if (!xmlStrcmp(fileinfoNode->name, (xmlChar *)"encryptioniv"))
+    {
+        err = memcpy_s(pstUploadFileSummary->encryptionIv, CLIENT_ENCRYPTION_TEXT_SIZE, nodeContent,
+            strlen((char*)nodeContent) + 1);
+    }
     return err;
 }
 
@@ -409,7 +404,7 @@ int checkUploadFileInfo(upload_file_summary * pstUploadInfo, const obs_options *
     }
     list_part_info listpart;
     memset_s(&listpart, sizeof(list_part_info), 0, sizeof(list_part_info));
-    listpart.max_parts = 100;
+    listpart.max_parts = 1;
     listpart.upload_id = pstUploadInfo->upload_id;
     //call list parts here
     list_parts(options, (char *)pstUploadInfo->key, &listpart, &listPartsHandler, &stListPartResult);
@@ -627,6 +622,13 @@ int writeCheckpointFile(upload_file_summary * pstUploadFileSummary,
     //add <key> under <fileinfo>  
     xmlNewTextChild(node_fileinfo, NULL, BAD_CAST "key", BAD_CAST pstUploadFileSummary->key);
 
+    //add <encryptionkey> and <encryptioniv> under <fileinfo> if client encrypted
+    if (pstUploadFileSummary->encryptionKey[0] != '\0')
+    {
+        xmlNewTextChild(node_fileinfo, NULL, BAD_CAST "encryptionkey", BAD_CAST pstUploadFileSummary->encryptionKey);
+        xmlNewTextChild(node_fileinfo, NULL, BAD_CAST "encryptioniv", BAD_CAST pstUploadFileSummary->encryptionIv);
+    }
+
     //add <partsinfo> under <uploadinfo>
     xmlAddChild(root_node, node_partsinfo);
 
@@ -896,22 +898,22 @@ static obs_status uploadPartCompletePropertiesCallback
             int ret = sprintf_s(pathToUpdate, ARRAY_LENGTH_1024, "%s%d/%s", "uploadinfo/partsinfo/part", cbd->part_num + 1, "etag");
             CheckAndLogNeg(ret, "sprintf_s", __FUNCTION__, __LINE__);
 #if defined(WIN32)
-            EnterCriticalSection(&g_csThreadCheckpoint);
+            EnterCriticalSection((CRITICAL_SECTION *)cbd->xmlWriteMutex);
 #endif
 
 #if defined __GNUC__ || defined LINUX
-            pthread_mutex_lock(&g_mutexThreadCheckpoint);
+            pthread_mutex_lock((pthread_mutex_t *)cbd->xmlWriteMutex);
 #endif
             ret = updateCheckPoint(pathToUpdate, properties->etag, cbd->checkpointFilename);
             if (ret == -1) {
                 COMMLOG(OBS_LOGWARN, "Failed to update checkpoint in function: %s.", __FUNCTION__);
             }
 #if defined(WIN32)
-            LeaveCriticalSection(&g_csThreadCheckpoint);
+            LeaveCriticalSection((CRITICAL_SECTION *)cbd->xmlWriteMutex);
 #endif
 
 #if defined __GNUC__ || defined LINUX
-            pthread_mutex_unlock(&g_mutexThreadCheckpoint);
+            pthread_mutex_unlock((pthread_mutex_t *)cbd->xmlWriteMutex);
 #endif
         }
     }
@@ -957,11 +959,11 @@ static void  uploadPartCompleteCallback(obs_status status,
             CheckAndLogNeg(ret, "sprintf_s", __FUNCTION__, __LINE__);
         }
 #if defined(WIN32)
-        EnterCriticalSection(&g_csThreadCheckpoint);
+        EnterCriticalSection((CRITICAL_SECTION *)cbd->xmlWriteMutex);
 #endif
 
 #if defined __GNUC__ || defined LINUX
-        pthread_mutex_lock(&g_mutexThreadCheckpoint);
+        pthread_mutex_lock((pthread_mutex_t *)cbd->xmlWriteMutex);
 #endif
 
         ret = updateCheckPoint(pathToUpdate, contentToSet, cbd->checkpointFilename);
@@ -969,11 +971,11 @@ static void  uploadPartCompleteCallback(obs_status status,
             COMMLOG(OBS_LOGWARN, "Failed to update checkpoint in function: %s.", __FUNCTION__);
         }
 #if defined(WIN32)
-        LeaveCriticalSection(&g_csThreadCheckpoint);
+        LeaveCriticalSection((CRITICAL_SECTION *)cbd->xmlWriteMutex);
 #endif
 
 #if defined __GNUC__ || defined LINUX
-        pthread_mutex_unlock(&g_mutexThreadCheckpoint);
+        pthread_mutex_unlock((pthread_mutex_t *)cbd->xmlWriteMutex);
 #endif
 
     }
@@ -1009,6 +1011,17 @@ static int  uploadPartCallback(int buffer_size, char * buffer, void *callback_da
 			else {
 				cbd->bytesRemaining -= bytesRead; 
 			}
+            //client encryption is done in place on the buffer curl sends
+            if (bytesRead > 0 && cbd->cipher != NULL &&
+                client_encryption_part_encrypt(cbd->cipher, buffer, bytesRead) != OBS_STATUS_OK)
+            {
+                COMMLOG(OBS_LOGERROR, "encrypt part %d failed", cbd->part_num);
+                return -1;
+            }
+        }
+        else if (cbd->cipher != NULL)
+        {
+            bytesRead = client_encryption_part_read_tag(cbd->cipher, buffer, buffer_size);
         }
     }
     return bytesRead;
@@ -1064,6 +1077,9 @@ unsigned __stdcall UploadThreadProc_win32(void* param)
     int part_num = pstPara->stUploadFilePartInfo->part_num;
     server_side_encryption_params * pstEncrypParam = NULL;
     char *szUpload = NULL;
+    uint64_t content_length = part_size;
+    client_encryption_part cipherPart;
+    memset_s(&cipherPart, sizeof(client_encryption_part), 0, sizeof(client_encryption_part));
     pstPara->thread_start = 1;
 
     int fd = -1;
@@ -1117,6 +1133,7 @@ unsigned __stdcall UploadThreadProc_win32(void* param)
                 data.stUploadFilePartInfo = pstPara->stUploadFilePartInfo;
                 data.progressCallback = pstPara->stUploadParams->progress_callback;
                 data.progressInfo = &pstPara->stUploadProgressInfo;
+                data.xmlWriteMutex = pstPara->stUploadParams->xmlWriteMutex;
 
                 pstEncrypParam = pstPara->stUploadParams->pstServerSideEncryptionParams;
                 if (data.enableCheckPoint == 1)
@@ -1134,9 +1151,9 @@ unsigned __stdcall UploadThreadProc_win32(void* param)
                         COMMLOG(OBS_LOGWARN, "sprintf_s  failed in function: %s, line: %d", __FUNCTION__, __LINE__);
                     } else {
                     }
-                    EnterCriticalSection(&g_csThreadCheckpoint);
+                    EnterCriticalSection((CRITICAL_SECTION *)pstPara->stUploadParams->xmlWriteMutex);
                     updateCheckPoint(pathToUpdate, contentToSet, pstPara->stUploadParams->fileNameCheckpoint);
-                    LeaveCriticalSection(&g_csThreadCheckpoint);
+                    LeaveCriticalSection((CRITICAL_SECTION *)pstPara->stUploadParams->xmlWriteMutex);
                 }
                 memset_s(&stPutProperties, sizeof(obs_put_properties), 0, sizeof(obs_put_properties));
 
@@ -1154,8 +1171,27 @@ unsigned __stdcall UploadThreadProc_win32(void* param)
                 upload_part_info.part_number = part_num + 1;
                 upload_part_info.upload_id = szUpload;
                 upload_part_info.arrEvent = arrEvent;
-                upload_part(pstPara->stUploadParams->options, pstPara->stUploadParams->objectName,
-                    &upload_part_info, part_size, &stPutProperties, pstEncrypParam, &uploadResponseHandler, &data);
+                if (pstPara->stUploadParams->client_encryption != NULL)
+                {
+                    //the encrypted part carries its authentication tag at the end
+                    if (client_encryption_part_begin(pstPara->stUploadParams->client_encryption, &cipherPart, part_num,
+                        part_size, pstPara->stUploadParams->totalFileSize, 1) != OBS_STATUS_OK)
+                    {
+                        pstPara->stUploadFilePartInfo->uploadStatus = UPLOAD_FAILED;
+                        content_length = 0;
+                    }
+                    else
+                    {
+                        data.cipher = &cipherPart;
+                        content_length = part_size + OBS_CLIENT_ENCRYPTION_TAG_SIZE;
+                    }
+                }
+                if (pstPara->stUploadFilePartInfo->uploadStatus == UPLOADING)
+                {
+                    upload_part(pstPara->stUploadParams->options, pstPara->stUploadParams->objectName,
+                        &upload_part_info, content_length, &stPutProperties, pstEncrypParam, &uploadResponseHandler, &data);
+                }
+                client_encryption_part_end(&cipherPart);
             }
             if (fd != -1)
             {
@@ -1183,6 +1219,11 @@ void cleanup_fd(void *arg)
     }
 }
 
+void cleanup_cipher_part(void *arg)
+{
+    client_encryption_part_end((client_encryption_part *)arg);
+}
+
 void *UploadThreadProc_linux(void* param)
 {
     int oldstate = 0;
@@ -1195,11 +1236,15 @@ void *UploadThreadProc_linux(void* param)
     int part_num = pstPara->stUploadFilePartInfo->part_num;
     server_side_encryption_params * pstEncrypParam = NULL;
     char *szUpload = NULL;
+    uint64_t content_length = part_size;
+    client_encryption_part cipherPart;
+    memset_s(&cipherPart, sizeof(client_encryption_part), 0, sizeof(client_encryption_part));
     pstPara->thread_start = 1;
 
     int fd = -1;
-    pthread_cleanup_push((void (*)(void*))pthread_mutex_unlock, (void*)&g_mutexThreadCheckpoint);
+    pthread_cleanup_push((void (*)(void*))pthread_mutex_unlock, pstPara->stUploadParams->xmlWriteMutex);
     pthread_cleanup_push(cleanup_fd, (void*)&fd);
+    pthread_cleanup_push(cleanup_cipher_part, (void*)&cipherPart);
     pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &oldstate);
     pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldtype);
 
@@ -1239,6 +1284,7 @@ void *UploadThreadProc_linux(void* param)
         data.stUploadFilePartInfo = pstPara->stUploadFilePartInfo;
         data.progressCallback = pstPara->stUploadParams->progress_callback;
         data.progressInfo = &pstPara->stUploadProgressInfo;
+        data.xmlWriteMutex = pstPara->stUploadParams->xmlWriteMutex;
 
         pstEncrypParam = pstPara->stUploadParams->pstServerSideEncryptionParams;
 
@@ -1257,9 +1303,9 @@ void *UploadThreadProc_linux(void* param)
                 COMMLOG(OBS_LOGWARN, "sprintf_s failed in function: %s, line: %d", __FUNCTION__, __LINE__);
             } else {
             }
-            pthread_mutex_lock(&g_mutexThreadCheckpoint);
+            pthread_mutex_lock((pthread_mutex_t *)pstPara->stUploadParams->xmlWriteMutex);
             updateCheckPoint(pathToUpdate, contentToSet, pstPara->stUploadParams->fileNameCheckpoint);
-            pthread_mutex_unlock(&g_mutexThreadCheckpoint);
+            pthread_mutex_unlock((pthread_mutex_t *)pstPara->stUploadParams->xmlWriteMutex);
 
         }
         memset_s(&stPutProperties, sizeof(obs_put_properties), 0, sizeof(obs_put_properties));
@@ -1278,8 +1324,27 @@ void *UploadThreadProc_linux(void* param)
 
         upload_part_info.part_number = part_num + 1;
         upload_part_info.upload_id = szUpload;
-        upload_part(pstPara->stUploadParams->options, pstPara->stUploadParams->objectName,
-            &upload_part_info, part_size, &stPutProperties, pstEncrypParam, &uploadResponseHandler, &data);
+        if (pstPara->stUploadParams->client_encryption != NULL)
+        {
+            //the encrypted part carries its authentication tag at the end
+            if (client_encryption_part_begin(pstPara->stUploadParams->client_encryption, &cipherPart, part_num,
+                part_size, pstPara->stUploadParams->totalFileSize, 1) != OBS_STATUS_OK)
+            {
+                pstPara->stUploadFilePartInfo->uploadStatus = UPLOAD_FAILED;
+                content_length = 0;
+            }
+            else
+            {
+                data.cipher = &cipherPart;
+                content_length = part_size + OBS_CLIENT_ENCRYPTION_TAG_SIZE;
+            }
+        }
+        if (pstPara->stUploadFilePartInfo->uploadStatus == UPLOADING)
+        {
+            upload_part(pstPara->stUploadParams->options, pstPara->stUploadParams->objectName,
+                &upload_part_info, content_length, &stPutProperties, pstEncrypParam, &uploadResponseHandler, &data);
+        }
+        client_encryption_part_end(&cipherPart);
     }
 
     if (fd != -1)
@@ -1290,6 +1355,7 @@ void *UploadThreadProc_linux(void* param)
     pstPara->thread_end = 1;
     pthread_cleanup_pop(0);
     pthread_cleanup_pop(0);
+    pthread_cleanup_pop(0);
 
     return NULL;
 }
@@ -1377,9 +1443,9 @@ void startUploadThreads_win32(upload_file_proc_data * uploadFileProcDataList,
                     CheckAndLogNeg(ret, "sprintf_s", __FUNCTION__, __LINE__);
                     ret = sprintf_s(contentToSet,ARRAY_LENGTH_32,"%s","UPLOAD_FAILED");
                     CheckAndLogNeg(ret, "sprintf_s", __FUNCTION__, __LINE__);
-                    EnterCriticalSection(&g_csThreadCheckpoint);
+                    EnterCriticalSection((CRITICAL_SECTION *)uploadFileProcDataList[i].stUploadParams->xmlWriteMutex);
                     updateCheckPoint(pathToUpdate, contentToSet, uploadFileProcDataList[i].stUploadParams->fileNameCheckpoint);
-                    LeaveCriticalSection(&g_csThreadCheckpoint);
+                    LeaveCriticalSection((CRITICAL_SECTION *)uploadFileProcDataList[i].stUploadParams->xmlWriteMutex);
                 }
 
                 uploadFileProcDataList[i].stUploadFilePartInfo->uploadStatus = UPLOAD_FAILED;
@@ -1455,9 +1521,9 @@ void startUpload_pthreads(upload_params * pstUploadParams, int partCount, void*
     for (i = 0; i < partCount; i++) {
         while (1) {
             if(*(pstUploadParams->pause_upload_flag) == 1) {
-                pthread_mutex_lock(&g_mutexThreadCheckpoint);
+                pthread_mutex_lock((pthread_mutex_t *)pstUploadParams->xmlWriteMutex);
                 err = pthread_cancel(arrThread[i]);
-                pthread_mutex_unlock(&g_mutexThreadCheckpoint);
+                pthread_mutex_unlock((pthread_mutex_t *)pstUploadParams->xmlWriteMutex);
                 if(err != 0) {
                     COMMLOG(OBS_LOGINFO, "cancel thread failed i[%d]\n",i);
                 }
@@ -1474,12 +1540,12 @@ void startUpload_pthreads(upload_params * pstUploadParams, int partCount, void*
                     CheckAndLogNeg(ret, "sprintf_s", __FUNCTION__, __LINE__);
                     ret = sprintf_s(contentToSet,ARRAY_LENGTH_32,"%s","UPLOAD_FAILED");
                     CheckAndLogNeg(ret, "sprintf_s", __FUNCTION__, __LINE__);
-                    pthread_mutex_lock(&g_mutexThreadCheckpoint);
+                    pthread_mutex_lock((pthread_mutex_t *)pstUploadParams->xmlWriteMutex);
                     ret = updateCheckPoint(pathToUpdate, contentToSet, uploadFileProcDataList[i].stUploadParams->fileNameCheckpoint);
                     if (ret == -1) {
                         COMMLOG(OBS_LOGWARN, "Failed to update checkpoint in function: %s.", __FUNCTION__);
                     }
-                    pthread_mutex_unlock(&g_mutexThreadCheckpoint);
+                    pthread_mutex_unlock((pthread_mutex_t *)pstUploadParams->xmlWriteMutex);
                 }
  
                 uploadFileProcDataList[i].stUploadFilePartInfo->uploadStatus = UPLOAD_FAILED;
@@ -1723,6 +1789,371 @@ int set_isFirstTimeSuccess(const obs_options *options, char *key, int isFirstTim
 }
 
 
+typedef struct resume_upload_data
+{
+    lisPartResult result;                 // must be the first member, see ListPartsCompleteCallback_Intern
+    upload_file_part_info *partList;
+    int partCount;
+    int isTruncated;
+    unsigned int nextMarker;
+    int reusedCount;
+} resume_upload_data;
+
+typedef struct find_upload_id_data
+{
+    obs_status status;
+    const char *key;
+    char *uploadId;
+    int64_t initiated;
+    int isTruncated;
+    char nextMarker[MAX_KEY_SIZE];
+    char nextUploadIdMarker[MAX_SIZE_UPLOADID];
+} find_upload_id_data;
+
+static obs_status findUploadIdCallback(int is_truncated, const char *next_marker,
+    const char *next_uploadId_marker, int uploads_count, const obs_list_multipart_upload *uploads,
+    int common_prefixes_count, const char **common_prefixes, void *callback_data)
+{
+    find_upload_id_data *data = (find_upload_id_data *)callback_data;
+    int i = 0;
+    (void)common_prefixes_count;
+    (void)common_prefixes;
+
+    for (i = 0; i < uploads_count; i++)
+    {
+        if (uploads[i].key == NULL || uploads[i].upload_id == NULL || strcmp(uploads[i].key, data->key)
+            || (data->uploadId[0] != '\0' && uploads[i].initiated <= data->initiated))
+        {
+            continue;
+        }
+        errno_t err = strcpy_s(data->uploadId, MAX_SIZE_UPLOADID, uploads[i].upload_id);
+        CheckAndLogNoneZero(err, "strcpy_s", __FUNCTION__, __LINE__);
+        data->initiated = uploads[i].initiated;
+    }
+    data->isTruncated = is_truncated;
+    (void)strcpy_s(data->nextMarker, sizeof(data->nextMarker), next_marker ? next_marker : "");
+    (void)strcpy_s(data->nextUploadIdMarker, sizeof(data->nextUploadIdMarker),
+        next_uploadId_marker ? next_uploadId_marker : "");
+    return OBS_STATUS_OK;
+}
+
+static void findUploadIdCompleteCallback(obs_status status, const obs_error_details *error, void *callback_data)
+{
+    (void)error;
+    ((find_upload_id_data *)callback_data)->status = status;
+}
+
+//the latest multipart upload initiated for the key, 0 if there is one
+static int findUploadIdByKey(const obs_options *options, const char *key, char *uploadId)
+{
+    obs_list_multipart_uploads_handler handler =
+    {
+        { &ListPartsPropertiesCallback_Intern, &findUploadIdCompleteCallback }, &findUploadIdCallback
+    };
+    find_upload_id_data data;
+    memset_s(&data, sizeof(data), 0, sizeof(data));
+    data.key = key;
+    data.uploadId = uploadId;
+    uploadId[0] = '\0';
+
+    do
+    {
+        data.isTruncated = 0;
+        data.status = OBS_STATUS_BUTT;
+        list_multipart_uploads(options, key, data.nextMarker[0] ? data.nextMarker : NULL, NULL,
+            data.nextUploadIdMarker[0] ? data.nextUploadIdMarker : NULL, RESUME_LIST_PAGE_SIZE, &handler, &data);
+        if (data.status != OBS_STATUS_OK)
+        {
+            COMMLOG(OBS_LOGWARN, "list multipart uploads for %s failed: %d", key, data.status);
+            return -1;
+        }
+    } while (data.isTruncated && data.nextMarker[0] != '\0');
+
+    return uploadId[0] != '\0' ? 0 : -1;
+}
+
+static obs_status resumeListPartsCallback(obs_uploaded_parts_total_info* uploaded_parts,
+    obs_list_parts *parts, void *callback_data)
+{
+    resume_upload_data *data = (resume_upload_data *)callback_data;
+    int i = 0;
+
+    for (i = 0; i < uploaded_parts->parts_count; i++)
+    {
+        unsigned int partNumber = parts[i].part_number;
+        if (partNumber > data->nextMarker)
+        {
+            data->nextMarker = partNumber;
+        }
+        if (partNumber == 0 || partNumber > (unsigned int)data->partCount || parts[i].etag == NULL
+            || parts[i].etag[0] == '\0')
+        {
+            continue;
+        }
+        upload_file_part_info *partInfo = data->partList + (partNumber - 1);
+        if (parts[i].size != partInfo->part_size || partInfo->uploadStatus == UPLOAD_SUCCESS)
+        {
+            continue;
+        }
+        if (strcpy_s(partInfo->etag, sizeof(partInfo->etag), parts[i].etag) != EOK)
+        {
+            continue;
+        }
+        partInfo->uploadStatus = UPLOAD_SUCCESS;
+        data->reusedCount++;
+    }
+    data->isTruncated = uploaded_parts->is_truncated;
+    if (uploaded_parts->nextpart_number_marker > data->nextMarker)
+    {
+        data->nextMarker = uploaded_parts->nextpart_number_marker;
+    }
+    return OBS_STATUS_OK;
+}
+
+//compare the md5 of the local part with the etag returned by the server
+static int isUploadedPartSame(int fd, const upload_file_part_info *partInfo, char *buffer, int bufferSize)
+{
+    static const char hex[] = "0123456789abcdef";
+    unsigned char digest[MD5_DIGEST_LENGTH];
+    const char *etag = partInfo->etag;
+    uint64_t remain = partInfo->part_size;
+    MD5_CTX md5;
+    int i = 0;
+
+    if (*etag == '"')
+    {
+        etag++;
+    }
+    if (strlen(etag) < MD5_DIGEST_LENGTH * 2)
+    {
+        return 0;
+    }
+#if defined WIN32
+    if (_lseeki64(fd, (__int64)partInfo->start_byte, SEEK_SET) < 0)
+#else
+    if (lseek(fd, (off_t)partInfo->start_byte, SEEK_SET) < 0)
+#endif
+    {
+        return 0;
+    }
+    MD5_Init(&md5);
+    while (remain > 0)
+    {
+        int toRead = remain > (uint64_t)bufferSize ? bufferSize : (int)remain;
+        int bytesRead = read(fd, buffer, toRead);
+        if (bytesRead <= 0)
+        {
+            return 0;
+        }
+        MD5_Update(&md5, buffer, bytesRead);
+        remain -= bytesRead;
+    }
+    MD5_Final(digest, &md5);
+    for (i = 0; i < MD5_DIGEST_LENGTH; i++)
+    {
+        if (tolower((unsigned char)etag[i * 2]) != hex[digest[i] >> 4]
+            || tolower((unsigned char)etag[i * 2 + 1]) != hex[digest[i] & 0x0F])
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void verifyUploadedParts(const char *uploadFileName, upload_file_part_info *partList, int partCount,
+    int *reusedCount)
+{
+    int fd = -1;
+    int i = 0;
+    char *buffer = (char *)malloc(RESUME_VERIFY_BUFFER_SIZE);
+#if defined WIN32
+    (void)file_sopen_s(&fd, uploadFileName, _O_RDONLY | _O_BINARY, _SH_DENYWR, _S_IREAD);
+#else
+    fd = open(uploadFileName, O_RDONLY);
+#endif
+
+    for (i = 0; i < partCount; i++)
+    {
+        upload_file_part_info *partInfo = partList + i;
+        if (partInfo->uploadStatus != UPLOAD_SUCCESS)
+        {
+            continue;
+        }
+        if (fd == -1 || buffer == NULL || !isUploadedPartSame(fd, partInfo, buffer, RESUME_VERIFY_BUFFER_SIZE))
+        {
+            COMMLOG(OBS_LOGWARN, "part %d on the server does not match the local file, upload it again",
+                partInfo->part_num + 1);
+            partInfo->uploadStatus = UPLOAD_NOTSTART;
+            memset_s(partInfo->etag, sizeof(partInfo->etag), 0, sizeof(partInfo->etag));
+            (*reusedCount)--;
+        }
+    }
+    CHECK_NULL_FREE(buffer);
+    if (fd != -1)
+    {
+#if defined WIN32
+        _close(fd);
+#else
+        close(fd);
+#endif
+    }
+}
+
+//resume without the checkpoint file: mark the parts the server already has as done,
+//returns the count of them, or -1 if there is no upload to resume
+static int resumeUploadFromServer(const obs_options *options, char *key,
+    obs_upload_file_configuration *upload_file_config, upload_file_summary *pstUploadFileSum,
+    upload_file_part_info *pstUploadPartList, int partCount)
+{
+    obs_list_parts_handler listPartsHandler =
+    {
+        { &ListPartsPropertiesCallback_Intern, &ListPartsCompleteCallback_Intern }, &resumeListPartsCallback
+    };
+    char uploadId[MAX_SIZE_UPLOADID] = {0};
+    resume_upload_data data;
+    list_part_info listpart;
+    unsigned int lastMarker = 0;
+    int autoPicked = 0;
+    errno_t err = EOK;
+
+    if (upload_file_config->resume_upload_id != NULL && upload_file_config->resume_upload_id[0] != '\0')
+    {
+        err = strcpy_s(uploadId, sizeof(uploadId), upload_file_config->resume_upload_id);
+        if (err != EOK)
+        {
+            COMMLOG(OBS_LOGERROR, "resume_upload_id is too long");
+            return -1;
+        }
+    }
+    else if (findUploadIdByKey(options, key, uploadId) != 0)
+    {
+        COMMLOG(OBS_LOGINFO, "no multipart upload of %s to resume", key);
+        return -1;
+    }
+    else
+    {
+        //the latest upload of the key may belong to another writer, sizes alone can not tell
+        autoPicked = 1;
+    }
+
+    memset_s(&data, sizeof(data), 0, sizeof(data));
+    data.partList = pstUploadPartList;
+    data.partCount = partCount;
+    memset_s(&listpart, sizeof(listpart), 0, sizeof(listpart));
+    listpart.upload_id = uploadId;
+    listpart.max_parts = RESUME_LIST_PAGE_SIZE;
+    do
+    {
+        lastMarker = data.nextMarker;
+        listpart.part_number_marker = data.nextMarker;
+        data.isTruncated = 0;
+        data.result.retStatus = OBS_STATUS_BUTT;
+        list_parts(options, key, &listpart, &listPartsHandler, &data);
+        if (data.result.retStatus != OBS_STATUS_OK)
+        {
+            COMMLOG(OBS_LOGWARN, "list parts of upload %s failed: %d, upload the file again",
+                uploadId, data.result.retStatus);
+            return -1;
+        }
+    } while (data.isTruncated && data.nextMarker > lastMarker);
+
+    if ((upload_file_config->verify_uploaded_parts || autoPicked) && data.reusedCount > 0)
+    {
+        verifyUploadedParts(upload_file_config->upload_file, pstUploadPartList, partCount, &data.reusedCount);
+    }
+    if (autoPicked && data.reusedCount == 0)
+    {
+        COMMLOG(OBS_LOGINFO, "no part of upload %s matches the local file, start a new upload", uploadId);
+        return -1;
+    }
+    err = strcpy_s(pstUploadFileSum->upload_id, MAX_SIZE_UPLOADID, uploadId);
+    CheckAndLogNoneZero(err, "strcpy_s", __FUNCTION__, __LINE__);
+    COMMLOG(OBS_LOGINFO, "resume upload %s of %s, %d of %d parts are on the server already",
+        uploadId, key, data.reusedCount, partCount);
+    return data.reusedCount;
+}
+
+
+//the part size recorded in the object meta, an empty file still needs a non-zero one
+static uint64_t getClientEncryptionPartSize(uint64_t partSize)
+{
+    return partSize != 0 ? partSize : MAX_PART_SIZE;
+}
+
+//prepare the data key: reuse the one in the checkpoint when resuming, or the uploaded parts
+//can not be decrypted; restart the upload if it is not usable any more
+static obs_status setUploadFileClientEncryption(const obs_options *options, char *key,
+    obs_upload_file_configuration *upload_file_config, upload_file_summary *pstUploadFileSum,
+    upload_file_part_info *pstUploadPartList, uint64_t uploadPartSize, const char *checkpointFilename,
+    int *isFirstTime, int *partCount, client_encryption_context *clientEncryption)
+{
+    const obs_client_encryption_params *params = upload_file_config->client_encryption;
+    obs_status status = OBS_STATUS_OK;
+    errno_t err = EOK;
+
+    if (*isFirstTime == 0)
+    {
+        uint64_t partSize = (pstUploadPartList != NULL) ? pstUploadPartList->part_size : uploadPartSize;
+        status = client_encryption_open(params, params->algorithm, pstUploadFileSum->encryptionKey,
+            pstUploadFileSum->encryptionIv, getClientEncryptionPartSize(partSize), clientEncryption);
+        if (status == OBS_STATUS_OK)
+        {
+            return status;
+        }
+        COMMLOG(OBS_LOGWARN, "the data key in checkpoint file is not usable, upload the file again");
+        abortMultipartUploadAndFree(options, key, pstUploadFileSum->upload_id, checkpointFilename, CLEAN_FILE);
+        pstUploadFileSum->upload_id[0] = '\0';
+        *isFirstTime = 1;
+        *partCount = 0;
+    }
+
+    status = client_encryption_create(params, getClientEncryptionPartSize(uploadPartSize), clientEncryption);
+    if (status != OBS_STATUS_OK)
+    {
+        return status;
+    }
+    err = strcpy_s(pstUploadFileSum->encryptionKey, CLIENT_ENCRYPTION_TEXT_SIZE, clientEncryption->wrapped_key);
+    CheckAndLogNoneZero(err, "strcpy_s", __FUNCTION__, __LINE__);
+    err = strcpy_s(pstUploadFileSum->encryptionIv, CLIENT_ENCRYPTION_TEXT_SIZE, clientEncryption->iv_text);
+    CheckAndLogNoneZero(err, "strcpy_s", __FUNCTION__, __LINE__);
+    return status;
+}
+
+//the user meta plus the encryption meta, used to initiate the multipart upload
+static obs_status setClientEncryptionPutProperties(const obs_put_properties *userProperties,
+    const client_encryption_context *clientEncryption, obs_put_properties *putProperties,
+    obs_name_value **metaData)
+{
+    int count = 0;
+    int userCount = (userProperties != NULL && userProperties->meta_data_count > 0) ?
+        userProperties->meta_data_count : 0;
+
+    if (userProperties != NULL)
+    {
+        memcpy_s(putProperties, sizeof(obs_put_properties), userProperties, sizeof(obs_put_properties));
+    }
+    else
+    {
+        init_put_properties(putProperties);
+    }
+    *metaData = (obs_name_value *)malloc(sizeof(obs_name_value) * (userCount + CLIENT_ENCRYPTION_META_COUNT));
+    if (*metaData == NULL)
+    {
+        return OBS_STATUS_OutOfMemory;
+    }
+    if (userCount > 0)
+    {
+        memcpy_s(*metaData, sizeof(obs_name_value) * (userCount + CLIENT_ENCRYPTION_META_COUNT),
+            userProperties->meta_data, sizeof(obs_name_value) * userCount);
+        count = userCount;
+    }
+    count += client_encryption_fill_metadata(clientEncryption, *metaData + count);
+    putProperties->meta_data = *metaData;
+    putProperties->meta_data_count = count;
+    return OBS_STATUS_OK;
+}
+
+
 int get_uploadId_for_uploadFile_initUpload(const obs_options *options, char *key, obs_upload_file_configuration *upload_file_config,
     char *upload_id, upload_params *pstUploadParams, upload_file_part_info *pstUploadPartList,
     obs_response_handler *commonHandler, char *checkpointFilename, int isFirstTime)
@@ -1836,7 +2267,7 @@ void upload_complete_handle_allSuccess(const obs_options *options, char *key, ob
         resultInfo = NULL;
     }
     is_true = (((isAllSuccess == 0) || (retComplete != 0))
-        && (upload_file_config->enable_check_point == 0));
+        && (upload_file_config->enable_check_point == 0) && (upload_file_config->resume_from_server == 0));
     if (is_true)
     {
         abortMultipartUploadAndFree(options, key, upload_id, NULL, DO_NOTHING);
@@ -1860,7 +2291,7 @@ void upload_complete_handle(const obs_options *options, char *key, obs_upload_fi
     }
 
     upload_file_part_info * printNode = pstUploadPartList;
-    if (!upload_file_config->enable_check_point)
+    if (!upload_file_config->enable_check_point && !upload_file_config->resume_from_server)
     {
         abortMultipartUploadAndFree(options, key, upload_id, NULL, DO_NOTHING);
     }
@@ -2098,8 +2529,52 @@ void upload_file(const obs_options *options, char *key, server_side_encryption_p
 		return;
 	}
 
+    client_encryption_context clientEncryption;
+    obs_put_properties encryptionPutProperties;
+    obs_name_value *encryptionMetaData = NULL;
+    obs_put_properties *configPutProperties = upload_file_config->put_properties;
+    memset_s(&clientEncryption, sizeof(client_encryption_context), 0, sizeof(client_encryption_context));
+    if (upload_file_config->client_encryption != NULL)
+    {
+        obs_status encryptionStatus = setUploadFileClientEncryption(options, key, upload_file_config,
+            &stUploadFileSum, pstUploadPartList, uploadPartSize, checkpointFilename, &isFirstTime, &partCount,
+            &clientEncryption);
+        if (encryptionStatus == OBS_STATUS_OK)
+        {
+            encryptionStatus = setClientEncryptionPutProperties(configPutProperties, &clientEncryption,
+                &encryptionPutProperties, &encryptionMetaData);
+        }
+        if (encryptionStatus != OBS_STATUS_OK)
+        {
+            COMMLOG(OBS_LOGERROR, "prepare client encryption failed: %d", encryptionStatus);
+            client_encryption_clear(&clientEncryption);
+            CHECK_NULL_FREE(encryptionMetaData);
+            CHECK_NULL_FREE(checkpointFilename);
+            upload_file_config->check_point_file = configCheckPointFileName;
+            CHECK_NULL_FREE(pstUploadPartListOrigin);
+            (void)(*(handler->response_handler.complete_callback))(encryptionStatus, 0, callback_data);
+            return;
+        }
+        upload_file_config->put_properties = &encryptionPutProperties;
+        stUploadParams.client_encryption = &clientEncryption;
+    }
+
     //set the part list to upload
     retVal = setPartList(&stUploadFileSum, uploadPartSize, &pstUploadPartList, &partCount, isFirstTime);
+    int resumedFromServer = 0;
+    if (upload_file_config->resume_from_server && (isFirstTime == 1) && (retVal == 0))
+    {
+        if (upload_file_config->client_encryption != NULL)
+        {
+            COMMLOG(OBS_LOGWARN, "the data key is not on the server, can not resume a client encrypted upload");
+        }
+        else if (resumeUploadFromServer(options, key, upload_file_config, &stUploadFileSum,
+            pstUploadPartList, partCount) >= 0)
+        {
+            resumedFromServer = 1;
+            isFirstTime = 0;
+        }
+    }
     stUploadParams.upload_id = stUploadFileSum.upload_id;
     stUploadParams.totalFileSize = stUploadFileSum.fileSize;
     stUploadParams.pause_upload_flag = upload_file_config->pause_upload_flag;
@@ -2108,8 +2583,11 @@ void upload_file(const obs_options *options, char *key, server_side_encryption_p
 
     retVal = get_uploadId_for_uploadFile(options, key, upload_file_config, upload_id, &stUploadParams,
         pstUploadPartList, retVal, &(handler->response_handler), checkpointFilename, isFirstTime);
+    upload_file_config->put_properties = configPutProperties;
+    CHECK_NULL_FREE(encryptionMetaData);
     if (-1 == retVal)
     {
+        client_encryption_clear(&clientEncryption);
         CHECK_NULL_FREE(checkpointFilename);
 		upload_file_config->check_point_file = configCheckPointFileName;
 		CHECK_NULL_FREE(pstUploadPartListOrigin);
@@ -2119,7 +2597,7 @@ void upload_file(const obs_options *options, char *key, server_side_encryption_p
         return;
     }
     is_ture = upload_file_setParams(&stUploadFileSum, options, key, upload_id, encryption_params, checkpointFilename,
-        upload_file_config, handler, callback_data, err, isFirstTime, is_ture, partCount, pstUploadPartList,
+        upload_file_config, handler, callback_data, err, resumedFromServer ? 1 : isFirstTime, is_ture, partCount, pstUploadPartList,
         &stUploadParams);
 
     (void)DividUploadPartList(pstUploadPartList, &pstUploadPartListDone, &pstUploadPartListNotDone);
@@ -2130,6 +2608,15 @@ void upload_file(const obs_options *options, char *key, server_side_encryption_p
     //start upload part threads now
     partCountToProc = 0;
     upload_file_config->task_num = (upload_file_config->task_num == 0) ? MAX_THREAD_NUM : upload_file_config->task_num;
+    //the checkpoint lock of this transfer, other transfers do not wait for it
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_t mutexThreadCheckpoint;
+    pthread_mutex_init(&mutexThreadCheckpoint, NULL);
+#else
+    CRITICAL_SECTION mutexThreadCheckpoint;
+    InitializeCriticalSection(&mutexThreadCheckpoint);
+#endif
+    stUploadParams.xmlWriteMutex = &mutexThreadCheckpoint;
     while (pstUploadPartListNotDone)
     {
 #if defined (WIN32)
@@ -2152,11 +2639,17 @@ void upload_file(const obs_options *options, char *key, server_side_encryption_p
         startUploadThreads(&stUploadParams, pstUploadPartListNotDone, partCountToProc, callback_data);
         calcTotalUploadedSize(&stUploadParams, pstUploadPartListNotDone, partCountToProc);
     }
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_destroy(&mutexThreadCheckpoint);
+#else
+    DeleteCriticalSection(&mutexThreadCheckpoint);
+#endif
+    stUploadParams.xmlWriteMutex = NULL;
     pstUploadPartList = pstUploadPartListDone;
     upload_complete_handle(options, key, handler, pstUploadPartList, partCount, upload_id,
         upload_file_config, server_callback, checkpointFilename, callback_data);
 
-
+    client_encryption_clear(&clientEncryption);
 	CHECK_NULL_FREE(pstUploadPartListOrigin);
 	CHECK_NULL_FREE(checkpointFilename);
 	upload_file_config->check_point_file = configCheckPointFileName;
@@ -1,6 +1,9 @@
 #include <time.h>
 #include "obs_time_util.h"
 #include "securec.h"
+#if !defined __GNUC__ && !defined LINUX
+#include <windows.h>
+#endif
 #define MAX_BUFFER_SIZE 256
 #define RFC1123_DATE_SIZE 32
 bool check_before_rfc1123_date_format(const struct tm *tm) {
@@ -42,4 +45,166 @@ void rfc1123_date_format(char *time_buffer, size_t time_buffer_size, const struc
 	}
 	CheckAndLogNeg(ret, "snprintf_s", __FUNCTION__, __LINE__);
 	time_buffer[time_buffer_size - 1] = '\0';
-}
\ No newline at end of file
+}
+int64_t obs_days_from_civil(int64_t year, int month, int day) {
+	year -= month <= 2;
+	int64_t era = (year >= 0 ? year : year - 399) / 400;
+	int64_t year_of_era = year - era * 400;
+	int64_t day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+	int64_t day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+	return era * 146097 + day_of_era - 719468;
+}
+
+struct tm *obs_gmtime(int64_t seconds, struct tm *result) {
+	int64_t days = seconds / 86400;
+	int64_t rem = seconds % 86400;
+	if (rem < 0) {
+		rem += 86400;
+		days--;
+	}
+	memset_s(result, sizeof(*result), 0, sizeof(*result));
+	result->tm_hour = (int)(rem / 3600);
+	result->tm_min = (int)(rem % 3600 / 60);
+	result->tm_sec = (int)(rem % 60);
+	/* 1970-01-01为星期四 */
+	result->tm_wday = (int)((days % 7 + 11) % 7);
+
+	int64_t z = days + 719468;
+	int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+	int64_t day_of_era = z - era * 146097;
+	int64_t year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+	int64_t day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+	int64_t mp = (5 * day_of_year + 2) / 153;
+	int month = (int)(mp < 10 ? mp + 3 : mp - 9);
+	int64_t year = year_of_era + era * 400 + (month <= 2);
+
+	result->tm_mday = (int)(day_of_year - (153 * mp + 2) / 5 + 1);
+	result->tm_mon = month - 1;
+	result->tm_year = (int)(year - 1900);
+	result->tm_yday = (int)(days - obs_days_from_civil(year, 1, 1));
+	return result;
+}
+
+/**
+ * 按秒缓存的时间文本，seq为奇数表示正在更新。写者抢不到seq时放弃缓存，
+ * 读者发现seq变化或秒数不符时自行格式化，因此读写两侧都不会阻塞
+ */
+typedef struct obs_time_cache {
+	volatile long seq;
+	int64_t second;
+	char text[32];
+} obs_time_cache;
+
+#if defined __GNUC__ || defined LINUX
+#define TIME_CACHE_LOAD(v) __atomic_load_n(&(v), __ATOMIC_ACQUIRE)
+#define TIME_CACHE_TRY_LOCK(v, expect) \
+	__atomic_compare_exchange_n(&(v), &(expect), (expect) + 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)
+#define TIME_CACHE_UNLOCK(v, value) __atomic_store_n(&(v), (value), __ATOMIC_RELEASE)
+#define TIME_CACHE_READ_FENCE() __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#else
+#define TIME_CACHE_LOAD(v) InterlockedCompareExchange(&(v), 0, 0)
+#define TIME_CACHE_TRY_LOCK(v, expect) (InterlockedCompareExchange(&(v), (expect) + 1, (expect)) == (expect))
+#define TIME_CACHE_UNLOCK(v, value) InterlockedExchange(&(v), (value))
+#define TIME_CACHE_READ_FENCE() MemoryBarrier()
+#endif
+
+static obs_time_cache g_rfc1123_date_cache = { 0, -1, { 0 } };
+static obs_time_cache g_local_time_cache = { 0, -1, { 0 } };
+
+static int time_cache_read(obs_time_cache *cache, int64_t second, char *buffer, size_t buffer_size, size_t len) {
+	long seq = TIME_CACHE_LOAD(cache->seq);
+	if ((seq & 1) || cache->second != second) {
+		return 0;
+	}
+	memcpy_s(buffer, buffer_size, cache->text, len);
+	TIME_CACHE_READ_FENCE();
+	return TIME_CACHE_LOAD(cache->seq) == seq;
+}
+
+static void time_cache_store(obs_time_cache *cache, int64_t second, const char *text, size_t len) {
+	long seq = TIME_CACHE_LOAD(cache->seq);
+	if ((seq & 1) || !TIME_CACHE_TRY_LOCK(cache->seq, seq)) {
+		return;
+	}
+	cache->second = second;
+	memcpy_s(cache->text, sizeof(cache->text), text, len);
+	TIME_CACHE_UNLOCK(cache->seq, seq + 2);
+}
+
+static void put_2digits(char *p, int value) {
+	p[0] = (char)('0' + value / 10 % 10);
+	p[1] = (char)('0' + value % 10);
+}
+
+void obs_current_rfc1123_date(char *buffer, size_t buffer_size) {
+	static const char weekdays[] = "SunMonTueWedThuFriSat";
+	static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+	int64_t now = (int64_t)time(NULL);
+	if (buffer_size <= OBS_RFC1123_DATE_LEN) {
+		if (buffer_size > 0) {
+			buffer[0] = '\0';
+		}
+		return;
+	}
+	if (time_cache_read(&g_rfc1123_date_cache, now, buffer, buffer_size, OBS_RFC1123_DATE_LEN + 1)) {
+		return;
+	}
+
+	struct tm tm;
+	obs_gmtime(now, &tm);
+	int year = tm.tm_year + 1900;
+	memcpy_s(buffer, buffer_size, &weekdays[tm.tm_wday * 3], 3);
+	buffer[3] = ',';
+	buffer[4] = ' ';
+	put_2digits(buffer + 5, tm.tm_mday);
+	buffer[7] = ' ';
+	memcpy_s(buffer + 8, buffer_size - 8, &months[tm.tm_mon * 3], 3);
+	buffer[11] = ' ';
+	put_2digits(buffer + 12, year / 100);
+	put_2digits(buffer + 14, year % 100);
+	buffer[16] = ' ';
+	put_2digits(buffer + 17, tm.tm_hour);
+	buffer[19] = ':';
+	put_2digits(buffer + 20, tm.tm_min);
+	buffer[22] = ':';
+	put_2digits(buffer + 23, tm.tm_sec);
+	memcpy_s(buffer + 25, buffer_size - 25, " GMT", 5);
+	time_cache_store(&g_rfc1123_date_cache, now, buffer, OBS_RFC1123_DATE_LEN + 1);
+}
+
+void obs_local_time_format(int64_t seconds, char *buffer, size_t buffer_size) {
+	if (buffer_size <= OBS_LOCAL_TIME_LEN) {
+		if (buffer_size > 0) {
+			buffer[0] = '\0';
+		}
+		return;
+	}
+	if (time_cache_read(&g_local_time_cache, seconds, buffer, buffer_size, OBS_LOCAL_TIME_LEN + 1)) {
+		return;
+	}
+
+	time_t t = (time_t)seconds;
+	struct tm tm;
+#if defined __GNUC__ || defined LINUX
+	if (localtime_r(&t, &tm) == NULL) {
+#else
+	if (localtime_s(&tm, &t) != 0) {
+#endif
+		obs_gmtime(seconds, &tm);
+	}
+	int year = tm.tm_year + 1900;
+	put_2digits(buffer, year / 100);
+	put_2digits(buffer + 2, year % 100);
+	buffer[4] = '-';
+	put_2digits(buffer + 5, tm.tm_mon + 1);
+	buffer[7] = '-';
+	put_2digits(buffer + 8, tm.tm_mday);
+	buffer[10] = ' ';
+	put_2digits(buffer + 11, tm.tm_hour);
+	buffer[13] = ':';
+	put_2digits(buffer + 14, tm.tm_min);
+	buffer[16] = ':';
+	put_2digits(buffer + 17, tm.tm_sec);
+	buffer[19] = '\0';
+	time_cache_store(&g_local_time_cache, seconds, buffer, OBS_LOCAL_TIME_LEN + 1);
+}
@@ -0,0 +1,238 @@
+/*********************************************************************************
+* Copyright 2024 Huawei Technologies Co.,Ltd.
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+* this file except in compliance with the License.  You may obtain a copy of the
+* License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed
+* under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+* CONDITIONS OF ANY KIND, either express or implied.  See the License for the
+* specific language governing permissions and limitations under the License.
+**********************************************************************************
+*/
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "prewarm.h"
+#include "request.h"
+#include "request_util.h"
+#include "securec.h"
+#include "log.h"
+
+#if defined __GNUC__ || defined LINUX
+#include <pthread.h>
+#include <sys/time.h>
+#else
+#include <windows.h>
+#include <process.h>
+#endif
+
+static int g_prewarm_initialized = 0;
+static int g_prewarm_stop = 0;
+static int g_prewarm_worker_started = 0;
+/* 保活线程使用的请求参数，字符串仍指向调用者的options */
+static obs_options g_prewarm_options;
+static unsigned int g_prewarm_count = 0;
+static unsigned int g_prewarm_interval_ms = 0;
+
+#if defined __GNUC__ || defined LINUX
+static pthread_mutex_t g_prewarm_mutex;
+static pthread_cond_t g_prewarm_cond;
+static pthread_t g_prewarm_worker;
+#else
+static CRITICAL_SECTION g_prewarm_mutex;
+static CONDITION_VARIABLE g_prewarm_cond;
+static HANDLE g_prewarm_worker = NULL;
+#endif
+
+static void prewarm_lock(void)
+{
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_lock(&g_prewarm_mutex);
+#else
+    EnterCriticalSection(&g_prewarm_mutex);
+#endif
+}
+
+static void prewarm_unlock(void)
+{
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_unlock(&g_prewarm_mutex);
+#else
+    LeaveCriticalSection(&g_prewarm_mutex);
+#endif
+}
+
+static void prewarm_wait(unsigned int timeout_ms)
+{
+#if defined __GNUC__ || defined LINUX
+    struct timeval now;
+    struct timespec deadline;
+    gettimeofday(&now, NULL);
+    deadline.tv_sec = now.tv_sec + timeout_ms / 1000;
+    deadline.tv_nsec = now.tv_usec * 1000L + (long)(timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    pthread_cond_timedwait(&g_prewarm_cond, &g_prewarm_mutex, &deadline);
+#else
+    SleepConditionVariableCS(&g_prewarm_cond, &g_prewarm_mutex, timeout_ms);
+#endif
+}
+
+/**
+ * 预热请求为对桶域名的HEAD ?apiversion，与get_api_version探测的是同一资源，
+ * 响应码不影响连接的建立
+ */
+static obs_status prewarm_perform(const obs_options *options, unsigned int count)
+{
+    request_params params;
+    unsigned int warmed = 0;
+    obs_use_api use_api = OBS_USE_API_S3;
+    set_use_api_switch(options, &use_api);
+
+    memset_s(&params, sizeof(request_params), 0, sizeof(request_params));
+    errno_t err = memcpy_s(&params.bucketContext, sizeof(obs_bucket_context), &options->bucket_options,
+        sizeof(obs_bucket_context));
+    CheckAndLogNoneZero(err, "memcpy_s", __FUNCTION__, __LINE__);
+    err = memcpy_s(&params.request_option, sizeof(obs_http_request_option), &options->request_options,
+        sizeof(obs_http_request_option));
+    CheckAndLogNoneZero(err, "memcpy_s", __FUNCTION__, __LINE__);
+    params.httpRequestType = http_request_type_head;
+    params.subResource = "apiversion";
+    params.isCheckCA = is_check_ca(options);
+    params.storageClassFormat = no_need_storage_class;
+    params.use_api = use_api;
+
+    obs_status status = request_prewarm(&params, count, &warmed);
+    COMMLOG(OBS_LOGINFO, "%s: %u of %u connections warmed, status = %s", __FUNCTION__, warmed, count,
+        obs_get_status_name(status));
+    return status;
+}
+
+static void prewarm_worker(void)
+{
+    prewarm_lock();
+    while (!g_prewarm_stop) {
+        prewarm_wait(g_prewarm_interval_ms);
+        if (g_prewarm_stop) {
+            break;
+        }
+        prewarm_unlock();
+        // 句柄池后进先出，探测取到的正是最近放回、最可能被复用的连接
+        (void)prewarm_perform(&g_prewarm_options, g_prewarm_count);
+        prewarm_lock();
+    }
+    prewarm_unlock();
+}
+
+#if defined __GNUC__ || defined LINUX
+static void *prewarm_worker_linux(void *arg)
+{
+    (void)arg;
+    prewarm_worker();
+    return NULL;
+}
+#else
+static unsigned __stdcall prewarm_worker_win32(void *arg)
+{
+    (void)arg;
+    prewarm_worker();
+    return 0;
+}
+#endif
+
+void prewarm_initialize(void)
+{
+    if (g_prewarm_initialized) {
+        return;
+    }
+#if defined __GNUC__ || defined LINUX
+    pthread_mutex_init(&g_prewarm_mutex, NULL);
+    pthread_cond_init(&g_prewarm_cond, NULL);
+#else
+    InitializeCriticalSection(&g_prewarm_mutex);
+    InitializeConditionVariable(&g_prewarm_cond);
+#endif
+    g_prewarm_initialized = 1;
+}
+
+void prewarm_deinitialize(void)
+{
+    if (!g_prewarm_initialized) {
+        return;
+    }
+    obs_prewarm_keepalive_stop();
+}
+
+obs_status obs_prewarm_connections(const obs_options *options, unsigned int count)
+{
+    if (!g_prewarm_initialized) {
+        COMMLOG(OBS_LOGERROR, "%s obs_initialize has not been called", __FUNCTION__);
+        return OBS_STATUS_InitCurlFailed;
+    }
+    if (options == NULL || count == 0) {
+        COMMLOG(OBS_LOGERROR, "%s: invalid parameter", __FUNCTION__);
+        return OBS_STATUS_InvalidParameter;
+    }
+    return prewarm_perform(options, count);
+}
+
+obs_status obs_prewarm_keepalive_start(const obs_options *options, unsigned int count,
+    unsigned int interval_ms)
+{
+    int started = 0;
+    if (!g_prewarm_initialized) {
+        COMMLOG(OBS_LOGERROR, "%s obs_initialize has not been called", __FUNCTION__);
+        return OBS_STATUS_InitCurlFailed;
+    }
+    if (options == NULL || count == 0 || interval_ms == 0) {
+        COMMLOG(OBS_LOGERROR, "%s: invalid parameter", __FUNCTION__);
+        return OBS_STATUS_InvalidParameter;
+    }
+    obs_prewarm_keepalive_stop();
+    prewarm_lock();
+    g_prewarm_options = *options;
+    g_prewarm_count = count;
+    g_prewarm_interval_ms = interval_ms;
+    g_prewarm_stop = 0;
+    prewarm_unlock();
+#if defined __GNUC__ || defined LINUX
+    started = pthread_create(&g_prewarm_worker, NULL, prewarm_worker_linux, NULL) == 0;
+#else
+    g_prewarm_worker = (HANDLE)_beginthreadex(NULL, 0, prewarm_worker_win32, NULL, 0, NULL);
+    started = g_prewarm_worker != 0;
+#endif
+    if (!started) {
+        COMMLOG(OBS_LOGERROR, "%s: create keepalive thread failed", __FUNCTION__);
+        return OBS_STATUS_InternalError;
+    }
+    g_prewarm_worker_started = 1;
+    return OBS_STATUS_OK;
+}
+
+void obs_prewarm_keepalive_stop(void)
+{
+    if (!g_prewarm_initialized || !g_prewarm_worker_started) {
+        return;
+    }
+    prewarm_lock();
+    g_prewarm_stop = 1;
+#if defined __GNUC__ || defined LINUX
+    pthread_cond_signal(&g_prewarm_cond);
+#else
+    WakeConditionVariable(&g_prewarm_cond);
+#endif
+    prewarm_unlock();
+#if defined __GNUC__ || defined LINUX
+    pthread_join(g_prewarm_worker, NULL);
+#else
+    WaitForSingleObject(g_prewarm_worker, INFINITE);
+    CloseHandle(g_prewarm_worker);
+    g_prewarm_worker = NULL;
+#endif
+    g_prewarm_worker_started = 0;
+}
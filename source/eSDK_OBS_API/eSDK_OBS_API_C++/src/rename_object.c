@@ -16,6 +16,7 @@
 #include "request.h"
 #include "securec.h"
 #include "request_util.h"
+#include "metadata_cache.h"
 
 // only posix bucke use
 void rename_object(const obs_options *options, char *key, char *new_object_name,
@@ -59,5 +60,7 @@ void rename_object(const obs_options *options, char *key, char *new_object_name,
 	params.storageClassFormat = storage_class;
 	params.use_api = use_api;
 	request_perform(&params);
+	metadata_cache_invalidate_object(&params.bucketContext, key);
+	metadata_cache_invalidate_object(&params.bucketContext, new_object_name);
 	COMMLOG(OBS_LOGINFO, "Leave truncate_object successfully !");
 }
\ No newline at end of file
@@ -15,22 +15,31 @@
 
 #include <ctype.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 #include "request.h"
 #include "request_context.h"
 #include "response_headers_handler.h"
 #include "util.h"
 #include "request_util.h"
+#include "metrics.h"
+#include "hedging.h"
+#include "endpoint_pool.h"
+#include "dns_cache.h"
+#include "ca_store.h"
 #include "pcre.h"
 #include <openssl/ssl.h>
 #include "eSDKOBS.h"
 #if defined __GNUC__ || defined LINUX
 #include <sys/utsname.h>
 #include <pthread.h>
+#else
+#include <process.h>
 #endif
 #define countof(array) (sizeof(array)/sizeof(array[0]))
 #define REQUEST_STACK_SIZE 100
 #define ARRAY_LENGTH_1024 1024
+#define REQUEST_HEDGING_POLL_MS 100
 
 int API_STACK_SIZE = 100;
 static char userAgentG[256];
@@ -66,11 +75,21 @@ static int sockopt_callback(const void *clientp, curl_socket_t curlfd, curlsockt
     return CURL_SOCKOPT_OK;
 }
 
-static void request_deinitialize(http_request *request)
+static void request_free_lists(http_request *request)
 {
     if (request->headers) {
         curl_slist_free_all(request->headers);
+        request->headers = NULL;
+    }
+    if (request->resolve) {
+        curl_slist_free_all(request->resolve);
+        request->resolve = NULL;
     }
+}
+
+static void request_deinitialize(http_request *request)
+{
+    request_free_lists(request);
 
     request->pause_handle = NULL;
     error_parser_deinitialize(&(request->errorParser));
@@ -674,6 +693,22 @@ static obs_status setup_curl(http_request *request,
     curl_easy_setopt_safe(CURLOPT_HTTPHEADER, request->headers);
     COMMLOG(OBS_LOGINFO, "%s request_perform setup_url: uri request_get = %s", __FUNCTION__,request->uri);
     curl_easy_setopt_safe(CURLOPT_URL, request->uri);
+    if (params->request_option.ip_preference == OBS_IP_PREFER_V4_ONLY) {
+        curl_easy_setopt_safe(CURLOPT_IPRESOLVE, CURL_IPRESOLVE_V4);
+    }
+    else if (params->request_option.ip_preference == OBS_IP_PREFER_V6_ONLY) {
+        curl_easy_setopt_safe(CURLOPT_IPRESOLVE, CURL_IPRESOLVE_V6);
+    }
+    if (params->request_option.happy_eyeballs_timeout_ms > 0) {
+        curl_easy_setopt_safe(CURLOPT_HAPPY_EYEBALLS_TIMEOUT_MS, params->request_option.happy_eyeballs_timeout_ms);
+    }
+    // 经代理时由代理解析目标域名
+    if (g_dns_cache_enabled && params->request_option.proxy_host == NULL) {
+        request->resolve = dns_cache_resolve_list(request->uri, params->request_option.ip_preference);
+        if (request->resolve != NULL) {
+            curl_easy_setopt_safe(CURLOPT_RESOLVE, request->resolve);
+        }
+    }
     int recvbuffersize = 256 * 1024;
     if( params->request_option.bbr_switch == OBS_BBR_OPEN ) {
         curl_easy_setopt_safe( CURLOPT_SOCKOPTFUNCTION, sockopt_callback );
@@ -706,12 +741,21 @@ static void release_token(void)
 #endif
 }
 
+static void release_endpoint(endpoint_pool_entry *endpoint)
+{
+    if (endpoint != NULL) {
+        endpoint_pool_release(endpoint, ENDPOINT_OUTCOME_NEUTRAL, 0);
+    }
+}
+
 static obs_status request_get(const request_params *params,
                             const request_computed_values *values,
                             http_request **reqReturn,
                             temp_auth_info *stTempAuthInfo)
 {
     http_request *request = 0;
+    endpoint_pool_entry *endpoint = NULL;
+    obs_bucket_context bucket_context = params->bucketContext;
     int temp_auth_flag = 0;
     int is_no_token = 0;
     if (params->temp_auth)
@@ -727,7 +771,7 @@ static obs_status request_get(const request_params *params,
         is_no_token = 1;
     }else {
          current_request_cnt++;
-        if (requestStackCountG) {
+        if (requestStackCountG && params->bucketContext.endpoint_pool == NULL) {
             request = requestStackG[--requestStackCountG];
         }
     }
@@ -742,12 +786,32 @@ static obs_status request_get(const request_params *params,
         COMMLOG(OBS_LOGWARN, "request is no token,cur token num=%u", current_request_cnt);
         return OBS_STATUS_NoToken;
     }
+
+    if (params->bucketContext.endpoint_pool != NULL) {
+        // 连接的端点由端点池选择，句柄也从该端点的句柄池中取，使连接按端点复用
+        endpoint = endpoint_pool_acquire(params->bucketContext.endpoint_pool);
+        bucket_context.host_name = (char *)endpoint_pool_host_name(endpoint);
+        request = endpoint_pool_take_handle(endpoint);
+    }
     
+    metrics_record_handle_pool(request != NULL);
     if (request) {
         request_deinitialize(request);
+        if (params->bucketContext.certificate_info &&
+            request->ca_generation != ca_store_generation(params->bucketContext.certificate_info)) {
+            // 证书文件重新加载后，curl为该句柄缓存的证书库里仍有旧的证书，需重建curl句柄
+            curl_easy_cleanup(request->curl);
+            if ((request->curl = curl_easy_init()) == NULL) {
+                free(request);
+                release_endpoint(endpoint);
+                release_token();
+                return OBS_STATUS_FailedToIInitializeRequest;
+            }
+        }
     }
     else {
         if ((request = (http_request *) malloc(sizeof(http_request))) == NULL) {
+            release_endpoint(endpoint);
             release_token();
             return OBS_STATUS_OutOfMemory;
         }
@@ -755,6 +819,7 @@ static obs_status request_get(const request_params *params,
         if ((request->curl = curl_easy_init()) == NULL) {
             free(request);  
             request = NULL; 
+            release_endpoint(endpoint);
             release_token();
             return OBS_STATUS_FailedToIInitializeRequest;
         }
@@ -763,21 +828,27 @@ static obs_status request_get(const request_params *params,
     request->prev = 0;
     request->next = 0;
     request->status = OBS_STATUS_OK;
+    request->httpResponseCode = 0;
     obs_status status = OBS_STATUS_OK;
     request->headers = 0;
     if ((status = compose_uri(request->uri, sizeof(request->uri),
-          &(params->bucketContext), values->urlEncodedKey,
+          &bucket_context, values->urlEncodedKey,
           params->subResource, params->queryParams, stTempAuthInfo, temp_auth_flag)) != OBS_STATUS_OK) {
+        request_free_lists(request);
         curl_easy_cleanup(request->curl);
         free(request); 
         request = NULL;
+        release_endpoint(endpoint);
         release_token();
         return status;
     }
     if ((status = setup_curl(request, params, values)) != OBS_STATUS_OK) {
+        // setup_curl中途失败时头部和DNS解析列表可能已经创建
+        request_free_lists(request);
         curl_easy_cleanup(request->curl);
         free(request); 
         request = NULL;
+        release_endpoint(endpoint);
         release_token();
         return status;
     }
@@ -792,7 +863,14 @@ static obs_status request_get(const request_params *params,
     response_headers_handler_initialize(&(request->responseHeadersHandler));
     request->propertiesCallbackMade = 0;
     request->pause_handle = params->pause_handle;
+    request->metrics_op = metrics_collecting() ? (int)metrics_classify_operation(params) : -1;
+    request->retry_count = metrics_collecting() ? metrics_current_retry() : 0;
+    request->hedge = NULL;
+    request->endpoint = endpoint;
+    request->ca_generation = ca_store_generation(params->bucketContext.certificate_info);
     error_parser_initialize(&(request->errorParser));
+    bandwidth_transfer_begin(&request->bandwidth, params->bucketContext.bucket_name,
+        params->request_option.bandwidth_priority);
     *reqReturn = request;
     return OBS_STATUS_OK;
 }
@@ -971,9 +1049,46 @@ static obs_status compose_auth_header(const request_params *params,
 
 
 
+/**
+ * 网络错误和5xx计为端点失败，未收到响应也没有出错的请求（如对冲中被取消）不影响健康度
+ */
+static endpoint_outcome request_endpoint_outcome(const http_request *request)
+{
+    if (request->httpResponseCode >= 500) {
+        return ENDPOINT_OUTCOME_FAILURE;
+    }
+    if (request->httpResponseCode > 0) {
+        return ENDPOINT_OUTCOME_SUCCESS;
+    }
+    return request->status == OBS_STATUS_OK ? ENDPOINT_OUTCOME_NEUTRAL : ENDPOINT_OUTCOME_FAILURE;
+}
+
+/**
+ * 按请求结果和首字节时延归还端点，返回该端点供调用者继续放回句柄
+ */
+static endpoint_pool_entry *request_release_endpoint(http_request *request)
+{
+    endpoint_pool_entry *endpoint = request->endpoint;
+    curl_off_t latency_us = 0;
+    if (curl_easy_getinfo(request->curl, CURLINFO_STARTTRANSFER_TIME_T, &latency_us) != CURLE_OK) {
+        latency_us = 0;
+    }
+    request->endpoint = NULL;
+    endpoint_pool_release(endpoint, request_endpoint_outcome(request), (uint64_t)latency_us);
+    return endpoint;
+}
+
 static void request_release(http_request **p_request)
 {
     http_request *request = *p_request;
+    bandwidth_transfer_end(&request->bandwidth);
+    if (request->endpoint != NULL) {
+        endpoint_pool_entry *endpoint = request_release_endpoint(request);
+        if (request->status == OBS_STATUS_OK && endpoint_pool_park_handle(endpoint, request)) {
+            release_token();
+            return;
+        }
+    }
 #if defined __GNUC__ || defined LINUX
     pthread_mutex_lock(&requestStackMutexG);
 #else
@@ -1176,9 +1291,8 @@ int is_retry(http_request *request, int is_retry)
     return is_retry;
 }
 
-void request_finish(http_request **p_request)
+static void request_finish_callback(http_request *request)
 {
-    http_request *request= *p_request;
     request_headers_done(request);
     OBS_LOGLEVEL logLevel;
     int is_true = 0;
@@ -1209,9 +1323,15 @@ void request_finish(http_request **p_request)
             request->status = response_to_status(request);
         }
     }
+    metrics_record_request(request);
     (*(request->complete_callback))
         (request->status, &(request->errorParser.obsErrorDetails),
          request->callback_data);
+}
+
+void request_finish(http_request **p_request)
+{
+    request_finish_callback(*p_request);
     request_release(p_request);
     *p_request = NULL;
 }
@@ -1346,6 +1466,148 @@ obs_status checkParameters(const request_params *params) {
 	return status;
 }
 
+/**
+ * 发出对冲请求，预算不足、无令牌或加入multi失败时返回NULL，只用原请求继续
+ */
+static http_request *request_start_hedge(CURLM *multi, const request_params *params,
+    const request_computed_values *values, temp_auth_info *stTempInfo,
+    char *errorBuffer, size_t errorBufferSize, hedge_group *group)
+{
+    http_request *hedge = NULL;
+    if (!hedging_acquire_budget()) {
+        return NULL;
+    }
+    if (request_get(params, values, &hedge, stTempInfo) != OBS_STATUS_OK) {
+        return NULL;
+    }
+    hedge->hedge = group;
+    setCurlErrorBuffer(hedge->curl, errorBuffer, errorBufferSize);
+    request_set_opt_for_progress(hedge);
+    if (curl_multi_add_handle(multi, hedge->curl) != CURLM_OK) {
+        hedge->hedge = NULL;
+        request_release(&hedge);
+        return NULL;
+    }
+    COMMLOG(OBS_LOGINFO, "%s hedging request %s", __FUNCTION__, hedge->uri);
+    return hedge;
+}
+
+/**
+ * 从multi中移出并直接归还请求，不触发任何回调
+ */
+static void request_cancel_hedged(CURLM *multi, http_request **p_request)
+{
+    curl_multi_remove_handle(multi, (*p_request)->curl);
+    (*p_request)->hedge = NULL;
+    request_release(p_request);
+    *p_request = NULL;
+}
+
+/**
+ * 在当前线程的multi句柄上执行可对冲的GET/HEAD：原请求超过对冲延迟仍未收到响应头时
+ * 在另一条连接上发出相同请求，先收到响应头者为winner，另一个立即被中止并归还。
+ * 返回winner的CURLcode并将*p_request替换为winner
+ */
+static CURLcode request_perform_hedged(const request_params *params,
+    const request_computed_values *values, temp_auth_info *stTempInfo,
+    char *errorBuffer, size_t errorBufferSize, http_request **p_request)
+{
+    http_request *primary = *p_request;
+    http_request *hedge = NULL;
+    CURLM *multi = hedging_thread_multi();
+    CURLcode primary_code = CURLE_OK;
+    CURLcode hedge_code = CURLE_OK;
+    int primary_done = 0;
+    int hedge_done = 0;
+    int hedged = 0;
+    uint64_t start = hedging_now_ms();
+    uint64_t delay_ms = hedging_delay_ms();
+    hedge_group group;
+
+    group.winner = NULL;
+    if (multi == NULL || curl_multi_add_handle(multi, primary->curl) != CURLM_OK) {
+        return curl_easy_perform(primary->curl);
+    }
+    primary->hedge = &group;
+    for (;;) {
+        int running = 0;
+        int msgs = 0;
+        int timeout_ms = REQUEST_HEDGING_POLL_MS;
+        uint64_t elapsed = 0;
+        CURLMsg *msg = NULL;
+        CURLMcode mcode = curl_multi_perform(multi, &running);
+        if (mcode != CURLM_OK) {
+            COMMLOG(OBS_LOGERROR, "%s curl_multi_perform failed, CURLMcode = %d", __FUNCTION__, mcode);
+            primary_code = primary_done ? primary_code : CURLE_FAILED_INIT;
+            hedge_code = hedge_done ? hedge_code : CURLE_FAILED_INIT;
+            break;
+        }
+        while ((msg = curl_multi_info_read(multi, &msgs)) != NULL) {
+            if (msg->msg != CURLMSG_DONE) {
+                continue;
+            }
+            if (primary != NULL && msg->easy_handle == primary->curl) {
+                primary_done = 1;
+                primary_code = msg->data.result;
+            }
+            else if (hedge != NULL && msg->easy_handle == hedge->curl) {
+                hedge_done = 1;
+                hedge_code = msg->data.result;
+            }
+        }
+        elapsed = hedging_now_ms() - start;
+        if (group.winner != NULL && primary != NULL && hedge != NULL) {
+            // 对冲胜出时原请求的实际时延只知下界，按下界计入
+            hedging_record_latency(elapsed);
+            request_cancel_hedged(multi, group.winner == primary ? &hedge : &primary);
+        }
+        else if (group.winner != NULL && !hedged && primary != NULL && primary->hedge == &group) {
+            hedging_record_latency(elapsed);
+            primary->hedge = NULL;
+        }
+        if (group.winner != NULL) {
+            if ((primary != NULL && primary_done) || (hedge != NULL && hedge_done)) {
+                break;
+            }
+        }
+        else if (primary_done && (hedge == NULL || hedge_done)) {
+            break;
+        }
+        if (!hedged && group.winner == NULL && !primary_done) {
+            if (elapsed >= delay_ms) {
+                hedge = request_start_hedge(multi, params, values, stTempInfo, errorBuffer, errorBufferSize, &group);
+                hedged = (hedge != NULL);
+                delay_ms = UINT64_MAX;
+                continue;
+            }
+            if (delay_ms - elapsed < (uint64_t)timeout_ms) {
+                timeout_ms = (int)(delay_ms - elapsed);
+            }
+        }
+#if LIBCURL_VERSION_NUM >= 0x074200
+        // 没有可等待的描述符（如仍在解析域名）时也会等到超时，避免空转
+        curl_multi_poll(multi, NULL, 0, timeout_ms, NULL);
+#else
+        curl_multi_wait(multi, NULL, 0, timeout_ms, NULL);
+#endif
+    }
+
+    hedging_record_outcome(hedged, primary == NULL);
+    if (primary == NULL) {
+        curl_multi_remove_handle(multi, hedge->curl);
+        hedge->hedge = NULL;
+        *p_request = hedge;
+        return hedge_code;
+    }
+    if (hedge != NULL) {
+        // 两者都未收到响应头就结束，以原请求的结果为准
+        request_cancel_hedged(multi, &hedge);
+    }
+    curl_multi_remove_handle(multi, primary->curl);
+    primary->hedge = NULL;
+    return primary_code;
+}
+
 void request_perform(const request_params *params)
 {
     COMMLOG(OBS_LOGINFO, "enter request perform!!!");
@@ -1435,7 +1697,9 @@ void request_perform(const request_params *params)
     while (retry > 0)
     {
 		COMMLOG(OBS_LOGINFO, "%s start curl_easy_perform now", __FUNCTION__);
-        CURLcode code = curl_easy_perform(request->curl);
+        CURLcode code = hedging_eligible(params) ?
+            request_perform_hedged(params, &computed, &stTempInfo, errorBuffer, errorBufferSize, &request) :
+            curl_easy_perform(request->curl);
 		COMMLOG(OBS_LOGINFO, "%s end curl_easy_perform.", __FUNCTION__);
         is_true = ((code != CURLE_OK) && (request->status == OBS_STATUS_OK));
         if (is_true) {
@@ -1457,6 +1721,278 @@ void request_perform(const request_params *params)
     CHECK_NULL_FREE(errorBuffer);
 }
 
+/**
+ * 重置调用者持有的computed values，只清空会被读取的字段，
+ * 避免每个请求都清零约100KB的头部缓冲区
+ */
+static void request_computed_values_reset(request_computed_values *values)
+{
+    size_t head = offsetof(request_computed_values, urlEncodedKey);
+    memset_s(values->amzHeaders, sizeof(values->amzHeaders), 0, sizeof(values->amzHeaders));
+    values->amzHeadersCount = 0;
+    values->amzHeadersRaw[0] = 0;
+    values->canonicalizedAmzHeaders[0] = 0;
+    values->canonicalizedAmzHeadersSize = 0;
+    memset_s((char *)values + head, sizeof(request_computed_values) - head, 0,
+        sizeof(request_computed_values) - head);
+}
+
+obs_status request_prepare_reusable(const request_params *params,
+    request_computed_values *values, http_request *request)
+{
+    obs_status status = OBS_STATUS_OK;
+    endpoint_pool_entry *endpoint = NULL;
+    obs_bucket_context bucket_context = params->bucketContext;
+    if ((status = checkParameters(params)) != OBS_STATUS_OK) {
+        return status;
+    }
+    if (params->temp_auth) {
+        COMMLOG(OBS_LOGERROR, "%s does not support temp_auth", __FUNCTION__);
+        return OBS_STATUS_InvalidParameter;
+    }
+
+    request_computed_values_reset(values);
+    if ((status = compose_headers(params, values)) != OBS_STATUS_OK) {
+        COMMLOG(OBS_LOGERROR, "compose_headers failed in function: %s, line: %d", __FUNCTION__, __LINE__);
+        return status;
+    }
+    canonicalize_obs_headers(values, params->use_api);
+    canonicalize_resource(params, values->urlEncodedKey, values->canonicalizedResource,
+        sizeof(values->canonicalizedResource));
+    char signbuf[17 + 129 + 129 + 1 +
+        (sizeof(values->canonicalizedAmzHeaders) - 1) +
+        (sizeof(values->canonicalizedResource) - 1) + 1];
+    if ((status = compose_auth_header(params, values, signbuf, sizeof(signbuf))) != OBS_STATUS_OK) {
+        return status;
+    }
+
+    if (request->endpoint != NULL) {
+        // 上次准备后未执行完成的请求，端点按中性结果归还
+        release_endpoint(request->endpoint);
+        request->endpoint = NULL;
+    }
+    if (request->curl != NULL) {
+        request_deinitialize(request);
+        if (params->bucketContext.certificate_info &&
+            request->ca_generation != ca_store_generation(params->bucketContext.certificate_info)) {
+            // 与request_get相同，证书文件重新加载后需重建curl句柄
+            curl_easy_cleanup(request->curl);
+            request->curl = NULL;
+        }
+    }
+    if (request->curl == NULL) {
+        if ((request->curl = curl_easy_init()) == NULL) {
+            return OBS_STATUS_FailedToIInitializeRequest;
+        }
+    }
+    response_headers_handler_initialize(&(request->responseHeadersHandler));
+    error_parser_initialize(&(request->errorParser));
+    request->prev = 0;
+    request->next = 0;
+    request->status = OBS_STATUS_OK;
+    request->httpResponseCode = 0;
+    request->headers = 0;
+    if (params->bucketContext.endpoint_pool != NULL) {
+        // 每次准备都从端点池选择端点，curl句柄仍由调用者持有，不放回端点的句柄池
+        endpoint = endpoint_pool_acquire(params->bucketContext.endpoint_pool);
+        bucket_context.host_name = (char *)endpoint_pool_host_name(endpoint);
+    }
+    if ((status = compose_uri(request->uri, sizeof(request->uri),
+          &bucket_context, values->urlEncodedKey,
+          params->subResource, params->queryParams, NULL, 0)) != OBS_STATUS_OK) {
+        release_endpoint(endpoint);
+        return status;
+    }
+    if ((status = setup_curl(request, params, values)) != OBS_STATUS_OK) {
+        release_endpoint(endpoint);
+        return status;
+    }
+    request->properties_callback = params->properties_callback;
+    request->toS3Callback = params->toObsCallback;
+    request->toS3CallbackBytesRemaining = params->toObsCallbackTotalSize;
+    request->progress_total_size = params->toObsCallbackTotalSize;
+    request->fromS3Callback = params->fromObsCallback;
+    request->complete_callback = params->complete_callback;
+    request->progressCallback = params->progressCallback;
+    request->callback_data = params->callback_data;
+    request->propertiesCallbackMade = 0;
+    request->pause_handle = params->pause_handle;
+    request->metrics_op = metrics_collecting() ? (int)metrics_classify_operation(params) : -1;
+    request->retry_count = metrics_collecting() ? metrics_current_retry() : 0;
+    request->hedge = NULL;
+    request->endpoint = endpoint;
+    request->ca_generation = ca_store_generation(params->bucketContext.certificate_info);
+    bandwidth_transfer_end(&request->bandwidth);
+    bandwidth_transfer_begin(&request->bandwidth, params->bucketContext.bucket_name,
+        params->request_option.bandwidth_priority);
+    return OBS_STATUS_OK;
+}
+
+void request_finish_reusable(http_request *request)
+{
+    bandwidth_transfer_end(&request->bandwidth);
+    request_finish_callback(request);
+    if (request->endpoint != NULL) {
+        request_release_endpoint(request);
+    }
+}
+
+void request_destroy_reusable(http_request *request)
+{
+    if (request->curl == NULL) {
+        return;
+    }
+    bandwidth_transfer_end(&request->bandwidth);
+    if (request->endpoint != NULL) {
+        release_endpoint(request->endpoint);
+        request->endpoint = NULL;
+    }
+    request_deinitialize(request);
+    curl_easy_cleanup(request->curl);
+    request->curl = NULL;
+    request->headers = NULL;
+}
+
+typedef struct request_prewarm_slot
+{
+    const request_params *params;
+    const request_computed_values *values;
+    http_request *request;
+    obs_status status;
+} request_prewarm_slot;
+
+/* 取得句柄并完成一次请求，句柄由request_prewarm统一放回，保证各线程建立的是不同的连接 */
+static void request_prewarm_one(request_prewarm_slot *slot)
+{
+    char authTmpParams[1024] = { 0 };
+    char authTmpActualHeaders[1024] = { 0 };
+    temp_auth_info stTempInfo;
+    long httpResponseCode = 0;
+    memset_s(&stTempInfo, sizeof(temp_auth_info), 0, sizeof(temp_auth_info));
+    stTempInfo.temp_auth_headers = authTmpActualHeaders;
+    stTempInfo.tempAuthParams = authTmpParams;
+
+    slot->status = request_get(slot->params, slot->values, &slot->request, &stTempInfo);
+    if (slot->status != OBS_STATUS_OK) {
+        slot->request = NULL;
+        return;
+    }
+    CURLcode code = curl_easy_perform(slot->request->curl);
+    if (code != CURLE_OK) {
+        slot->request->status = request_curl_code_to_status(code);
+        slot->status = slot->request->status;
+        COMMLOG(OBS_LOGWARN, "%s: curl_easy_perform failed, CURLcode = %d", __FUNCTION__, code);
+        return;
+    }
+    if (curl_easy_getinfo(slot->request->curl, CURLINFO_RESPONSE_CODE, &httpResponseCode) == CURLE_OK) {
+        slot->request->httpResponseCode = httpResponseCode;
+    }
+}
+
+#if defined __GNUC__ || defined LINUX
+static void *request_prewarm_linux(void *arg)
+{
+    request_prewarm_one((request_prewarm_slot *)arg);
+    return NULL;
+}
+#else
+static unsigned __stdcall request_prewarm_win32(void *arg)
+{
+    request_prewarm_one((request_prewarm_slot *)arg);
+    return 0;
+}
+#endif
+
+obs_status request_prewarm(const request_params *params, unsigned int count, unsigned int *warmed)
+{
+    obs_status status = OBS_STATUS_OK;
+    request_computed_values *computed = NULL;
+    request_prewarm_slot *slots = NULL;
+    int *started = NULL;
+    unsigned int i = 0;
+    *warmed = 0;
+    if ((status = checkParameters(params)) != OBS_STATUS_OK) {
+        return status;
+    }
+    if (count > REQUEST_STACK_SIZE) {
+        count = REQUEST_STACK_SIZE;
+    }
+    computed = (request_computed_values *)malloc(sizeof(request_computed_values));
+    slots = (request_prewarm_slot *)calloc(count, sizeof(request_prewarm_slot));
+    started = (int *)calloc(count, sizeof(int));
+#if defined __GNUC__ || defined LINUX
+    pthread_t *threads = (pthread_t *)calloc(count, sizeof(pthread_t));
+#else
+    HANDLE *threads = (HANDLE *)calloc(count, sizeof(HANDLE));
+#endif
+    if (computed == NULL || slots == NULL || started == NULL || threads == NULL) {
+        CHECK_NULL_FREE(computed);
+        CHECK_NULL_FREE(slots);
+        CHECK_NULL_FREE(started);
+        CHECK_NULL_FREE(threads);
+        return OBS_STATUS_OutOfMemory;
+    }
+    request_computed_values_reset(computed);
+    if ((status = compose_headers(params, computed)) == OBS_STATUS_OK) {
+        canonicalize_obs_headers(computed, params->use_api);
+        canonicalize_resource(params, computed->urlEncodedKey, computed->canonicalizedResource,
+            sizeof(computed->canonicalizedResource));
+        char signbuf[17 + 129 + 129 + 1 +
+            (sizeof(computed->canonicalizedAmzHeaders) - 1) +
+            (sizeof(computed->canonicalizedResource) - 1) + 1];
+        status = compose_auth_header(params, computed, signbuf, sizeof(signbuf));
+    }
+    if (status != OBS_STATUS_OK) {
+        free(computed);
+        free(slots);
+        free(started);
+        free(threads);
+        return status;
+    }
+
+    // 所有句柄都持有到全部请求结束，否则后发起的请求会复用先结束的连接而不是新建连接
+    for (i = 0; i < count; i++) {
+        slots[i].params = params;
+        slots[i].values = computed;
+#if defined __GNUC__ || defined LINUX
+        started[i] = pthread_create(&threads[i], NULL, request_prewarm_linux, &slots[i]) == 0;
+#else
+        threads[i] = (HANDLE)_beginthreadex(NULL, 0, request_prewarm_win32, &slots[i], 0, NULL);
+        started[i] = threads[i] != NULL;
+#endif
+        if (!started[i]) {
+            request_prewarm_one(&slots[i]);
+        }
+    }
+    for (i = 0; i < count; i++) {
+        if (started[i]) {
+#if defined __GNUC__ || defined LINUX
+            pthread_join(threads[i], NULL);
+#else
+            WaitForSingleObject(threads[i], INFINITE);
+            CloseHandle(threads[i]);
+#endif
+        }
+    }
+    status = OBS_STATUS_OK;
+    for (i = 0; i < count; i++) {
+        if (slots[i].status == OBS_STATUS_OK) {
+            (*warmed)++;
+        }
+        else if (status == OBS_STATUS_OK) {
+            status = slots[i].status;
+        }
+        if (slots[i].request != NULL) {
+            request_release(&slots[i].request);
+        }
+    }
+    free(started);
+    free(threads);
+    free(slots);
+    free(computed);
+    return status;
+}
+
 static obs_status compose_api_version_uri(char *buffer, int buffer_size,
                                           const char *bucket_name, const char *host_name, 
                                           const char *subResource, obs_protocol protocol)
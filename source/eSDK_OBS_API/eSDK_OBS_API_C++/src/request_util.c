@@ -27,6 +27,8 @@
 #include "object.h"
 #include "file_utils.h"
 #include "obs_time_util.h"
+#include "hedging.h"
+#include "ca_store.h"
 
 #if defined __GNUC__ || defined LINUX
 #include <sys/utsname.h>
@@ -157,7 +159,6 @@ void request_headers_done(http_request *request)
     }
 }
 
-#define ERROR_HEADER_LOWERCASE "error"
 void record_request_error_header(http_request *request, char* header);
 size_t curl_header_func(void *ptr, size_t size, size_t nmemb,
                                void *data)
@@ -165,21 +166,26 @@ size_t curl_header_func(void *ptr, size_t size, size_t nmemb,
     http_request *request = (http_request *) data;
 
     int64_t len = (int64_t)size * nmemb;
+    if (request->hedge != NULL) {
+        if (request->hedge->winner == NULL) {
+            request->hedge->winner = request;
+        }
+        else if (request->hedge->winner != request) {
+            // 另一个请求已先收到响应头，中止本请求
+            return 0;
+        }
+    }
 	if (OBS_LOGDEBUG >= getRunLogLevel()) {
-		COMMLOG(OBS_LOGDEBUG, "response header{%s}", ptr);
+		COMMLOG(OBS_LOGDEBUG, "response header{%.*s}", (int)len, (char *)ptr);
 	}
-    response_headers_handler_add
-        (&(request->responseHeadersHandler), (char *) ptr, len);
-
-	record_request_error_header(request, (char*)ptr);
+    if (response_headers_handler_add(&(request->responseHeadersHandler), (char *) ptr, len)
+        == RESPONSE_HEADER_ERROR) {
+        record_request_error_header(request, (char*)ptr);
+    }
 	return len;
 }
 
 void record_request_error_header(http_request *request, char* header) {
-
-	if (strstr(header, ERROR_HEADER_LOWERCASE) == NULL) {
-		return;
-	}
 	COMMLOG(OBS_LOGERROR, "%s", header);
 
 	if (request->errorParser.obsErrorDetails.error_headers_count >= ERROR_HEADERS_SIZE) {
@@ -239,6 +245,7 @@ size_t curl_read_func(void *ptr, size_t size, size_t nmemb, void *data)
             ret = request->toS3CallbackBytesRemaining;
         }
         request->toS3CallbackBytesRemaining -= ret;
+        bandwidth_consume(&request->bandwidth, BANDWIDTH_UPLOAD, (size_t)ret);
         return (size_t)ret;
     }
 }
@@ -255,6 +262,7 @@ size_t curl_write_func(void *ptr, size_t size, size_t nmemb,
     if (request->status != OBS_STATUS_OK) {
         return 0;
     }
+    bandwidth_consume(&request->bandwidth, BANDWIDTH_DOWNLOAD, (size_t)len);
 
     if ((request->httpResponseCode < 200) ||
         (request->httpResponseCode > 299)) {
@@ -276,24 +284,12 @@ CURLcode sslctx_function(CURL *curl, const void *sslctx, void *parm)
 {
     (void)curl;
 
-    X509_STORE *store = NULL;
-    X509 *cert = NULL;
-    BIO *bio = NULL;
-
-    bio = BIO_new_mem_buf((char *)parm, -1);
-
-	if (!PEM_read_bio_X509(bio, &cert, 0, NULL))
-	{
-		COMMLOG(OBS_LOGERROR, "%s Failed to read PEM certificate", __FUNCTION__);
-		return CURLE_SSL_CACERT_BADFILE;
-	}
-
-    store = SSL_CTX_get_cert_store((SSL_CTX *)sslctx);
-    X509_STORE_add_cert(store, cert);
-    X509_free(cert);
-    BIO_free(bio);
-    COMMLOG(OBS_LOGDEBUG, "%s Server certificate added to trust store", __FUNCTION__);
-    return CURLE_OK;
+    // 证书只解析一次，之后每个新连接只把共享的证书加入自己的store
+    CURLcode code = ca_store_add_certs(SSL_CTX_get_cert_store((SSL_CTX *)sslctx), (const char *)parm);
+    if (code == CURLE_OK) {
+        COMMLOG(OBS_LOGDEBUG, "%s Server certificate added to trust store", __FUNCTION__);
+    }
+    return code;
 }
 
 obs_status headers_append(int *len, request_computed_values *values, int isNewHeader,
@@ -1180,24 +1176,8 @@ obs_status request_compose_cors_conf(request_computed_values *values, const requ
 
 obs_status request_compose_data(request_computed_values *values, int *len,const request_params *params)
 {
-    time_t now = time(NULL);
     char date[64] = {0};
-    struct tm flagTemp;
-    struct tm* flag = NULL;
-#if defined __GNUC__ || defined LINUX            
-    flag  = gmtime_r(&now,&flagTemp);
-#else
-    if(_gmtime64_s(&flagTemp,&now)==0) {
-         flag = &flagTemp;               
-    }           
-#endif
-
-    if (flag != NULL) {
-		rfc1123_date_format(date, sizeof(date), &flagTemp, NULL, " GMT");
-    }
-    else {
-         COMMLOG(OBS_LOGWARN, "in request_compose_data, gmtime failed\n");
-    }
+    obs_current_rfc1123_date(date, sizeof(date));
 	obs_status status = OBS_STATUS_OK;
     if (params->use_api == OBS_USE_API_S3) {
 		status = headers_append(len, values, 1, "x-amz-date: %s", date, NULL);
@@ -1356,7 +1336,8 @@ obs_status compose_put_header(const request_params *params,
                   OBS_STATUS_ContentEncodingTooLong);
     if (params->put_properties && (params->put_properties->expires >= 0)) {
         time_t t = (time_t) params->put_properties->expires;
-        struct tm *flag = gmtime(&t);
+        struct tm tmTemp;
+        struct tm *flag = obs_gmtime((int64_t)t, &tmTemp);
         if(flag != NULL){
 			rfc1123_date_format(values->expiresHeader, sizeof(values->expiresHeader), flag, "Expires: ", " UTC");
         }
@@ -1387,14 +1368,16 @@ obs_status compose_get_put_header_s3(const request_params *params,
         (params->put_properties->get_conditions->if_modified_since >= 0));
     if (is_true1) {
         time_t t = (time_t) params->get_conditions->if_modified_since;
-        struct tm *flag = gmtime(&t);
+        struct tm tmTemp;
+        struct tm *flag = obs_gmtime((int64_t)t, &tmTemp);
         if(flag != NULL){
 			rfc1123_date_format(values->ifModifiedSinceHeader, sizeof(values->ifModifiedSinceHeader), flag, "If-Modified-Since: ", " UTC");
         }
     }
     else if (is_true2) {
         time_t t = (time_t) params->put_properties->get_conditions->if_modified_since;
-        struct tm *flag = gmtime(&t);
+        struct tm tmTemp;
+        struct tm *flag = obs_gmtime((int64_t)t, &tmTemp);
         if(flag != NULL){
 			rfc1123_date_format(values->ifModifiedSinceHeader, sizeof(values->ifModifiedSinceHeader), 
 				flag, "x-amz-copy-source-if-modified-since: ", " UTC");
@@ -1409,7 +1392,8 @@ obs_status compose_get_put_header_s3(const request_params *params,
             (params->put_properties->get_conditions->if_not_modified_since >= 0));
     if (is_true1) {
         time_t t = (time_t) params->get_conditions->if_not_modified_since;
-        struct tm *flag = gmtime(&t);
+        struct tm tmTemp;
+        struct tm *flag = obs_gmtime((int64_t)t, &tmTemp);
         if(flag != NULL)
         {
 			rfc1123_date_format(values->ifUnmodifiedSinceHeader, sizeof(values->ifUnmodifiedSinceHeader), 
@@ -1419,7 +1403,8 @@ obs_status compose_get_put_header_s3(const request_params *params,
     else if (is_true2) {
       time_t t = (time_t) params->put_properties->get_conditions->if_not_modified_since;
 
-      struct tm *flag = gmtime(&t);
+      struct tm tmTemp;
+        struct tm *flag = obs_gmtime((int64_t)t, &tmTemp);
       if(flag != NULL){
 		  rfc1123_date_format(values->ifUnmodifiedSinceHeader, sizeof(values->ifUnmodifiedSinceHeader),
 			  flag, "x-amz-copy-source-if-unmodified-since: ", " UTC");
@@ -1453,7 +1438,8 @@ obs_status compose_get_put_header_obs(const request_params *params,
         (params->put_properties->get_conditions->if_modified_since >= 0));
     if (is_true1) {
         time_t t = (time_t) params->get_conditions->if_modified_since;
-        struct tm *flag = gmtime(&t);
+        struct tm tmTemp;
+        struct tm *flag = obs_gmtime((int64_t)t, &tmTemp);
         if(flag != NULL){
 			rfc1123_date_format(values->ifModifiedSinceHeader, sizeof(values->ifModifiedSinceHeader),
 				flag, "If-Modified-Since: ", " UTC");
@@ -1461,7 +1447,8 @@ obs_status compose_get_put_header_obs(const request_params *params,
     }
     else if (is_true2) {
         time_t t = (time_t) params->put_properties->get_conditions->if_modified_since;
-        struct tm *flag = gmtime(&t);
+        struct tm tmTemp;
+        struct tm *flag = obs_gmtime((int64_t)t, &tmTemp);
         if(flag != NULL){
 			rfc1123_date_format(values->ifModifiedSinceHeader, sizeof(values->ifModifiedSinceHeader),
 				flag, "x-obs-copy-source-if-modified-since: ", " UTC");
@@ -1476,7 +1463,8 @@ obs_status compose_get_put_header_obs(const request_params *params,
             (params->put_properties->get_conditions->if_not_modified_since >= 0));
     if (is_true1) {
         time_t t = (time_t) params->get_conditions->if_not_modified_since;
-        struct tm *flag = gmtime(&t);
+        struct tm tmTemp;
+        struct tm *flag = obs_gmtime((int64_t)t, &tmTemp);
         if(flag != NULL)
         {
 			rfc1123_date_format(values->ifUnmodifiedSinceHeader, sizeof(values->ifUnmodifiedSinceHeader),
@@ -1486,7 +1474,8 @@ obs_status compose_get_put_header_obs(const request_params *params,
     else if (is_true2) {
       time_t t = (time_t) params->put_properties->get_conditions->if_not_modified_since;
 
-      struct tm *flag = gmtime(&t);
+      struct tm tmTemp;
+        struct tm *flag = obs_gmtime((int64_t)t, &tmTemp);
       if(flag != NULL){
 		  rfc1123_date_format(values->ifUnmodifiedSinceHeader, sizeof(values->ifUnmodifiedSinceHeader),
 			  flag, "x-obs-copy-source-if-unmodified-since: ", " UTC");
@@ -1779,6 +1768,8 @@ obs_status response_to_status(http_request *request)
             return OBS_STATUS_ConnectionFailed;
         case 301:
             return OBS_STATUS_PermanentRedirect;
+        case 304:
+            return OBS_STATUS_HttpErrorNotModified;
         case 307:
             return OBS_STATUS_HttpErrorMovedTemporarily;
         case 400:
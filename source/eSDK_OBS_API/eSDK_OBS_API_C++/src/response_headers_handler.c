@@ -13,14 +13,141 @@
 **********************************************************************************
 */
 #include <ctype.h>
+#include <stddef.h>
 #include <string.h>
 #include "response_headers_handler.h"
 
-#define MAX(a,b) (((a)>(b))?(a):(b))
+#define RESPONSE_HEADER_HASH_SIZE 128
+#define RESPONSE_HEADER_AMZ_PREFIX "x-amz-"
+#define RESPONSE_HEADER_OBS_PREFIX "x-obs-"
+#define RESPONSE_HEADER_VENDOR_PREFIX_LEN (sizeof(RESPONSE_HEADER_OBS_PREFIX) - 1)
+#define RESPONSE_HEADER_META_PREFIX "meta-"
+#define RESPONSE_PROPERTY_OFFSET(field) ((unsigned short) offsetof(obs_response_properties, field))
 
-int prefix_cmp(const char *header, const char* prefix, int namelen)
+#define RESPONSE_HEADER_VENDOR_NONE 0x01
+#define RESPONSE_HEADER_VENDOR_AMZ  0x02
+#define RESPONSE_HEADER_VENDOR_OBS  0x04
+
+typedef struct response_header_entry
+{
+    const char *name;                  // 小写，已去掉x-amz-/x-obs-前缀
+    unsigned char name_len;
+    unsigned char vendors;             // 允许的前缀
+    unsigned char type;
+    unsigned short offset;             // obs_response_properties中字符串字段的偏移
+} response_header_entry;
+
+/**
+ * 以response_header_hash为槽位的完美哈希表，增删表项后需重新搜索哈希系数并确认无冲突
+ */
+static const response_header_entry response_header_table[RESPONSE_HEADER_HASH_SIZE] = {
+    [1] = {"server-side-encryption-aws-kms-key-id", 37, RESPONSE_HEADER_VENDOR_AMZ, RESPONSE_HEADER_STRING, RESPONSE_PROPERTY_OFFSET(kms_key_id)},
+    [11] = {"access-control-max-age", 22, RESPONSE_HEADER_VENDOR_NONE, RESPONSE_HEADER_STRING, RESPONSE_PROPERTY_OFFSET(max_age)},
+    [12] = {"next-append-position", 20, RESPONSE_HEADER_VENDOR_OBS, RESPONSE_HEADER_STRING, RESPONSE_PROPERTY_OFFSET(obs_next_append_position)},
+    [15] = {"version", 7, RESPONSE_HEADER_VENDOR_OBS, RESPONSE_HEADER_STRING, RESPONSE_PROPERTY_OFFSET(obs_version)},
+    [16] = {"x-default-storage-class", 23, RESPONSE_HEADER_VENDOR_NONE, RESPONSE_HEADER_STRING, RESPONSE_PROPERTY_OFFSET(storage_class)},
+    [17] = {"error-code", 10, RESPONSE_HEADER_VENDOR_AMZ | RESPONSE_HEADER_VENDOR_OBS, RESPONSE_HEADER_ERROR, 0},
+    [20] = {"content-length", 14, RESPONSE_HEADER_VENDOR_NONE, RESPONSE_HEADER_CONTENT_LENGTH, 0},
+    [24] = {"fs-file-interface", 17, RESPONSE_HEADER_VENDOR_OBS, RESPONSE_HEADER_STRING, RESPONSE_PROPERTY_OFFSET(fs_file_interface)},
+    [25] = {"date", 4, RESPONSE_HEADER_VENDOR_NONE, RESPONSE_HEADER_IGNORED, 0},
+    [28] = {"version-id", 10, RESPONSE_HEADER_VENDOR_AMZ | RESPONSE_HEADER_VENDOR_OBS, RESPONSE_HEADER_STRING, RESPONSE_PROPERTY_OFFSET(version_id)},
+    [30] = {"object-type", 11, RESPONSE_HEADER_VENDOR_OBS, RESPONSE_HEADER_STRING, RESPONSE_PROPERTY_OFFSET(obs_object_type)},
+    [35] = {"last-modified", 13, RESPONSE_HEADER_VENDOR_NONE, RESPONSE_HEADER_IGNORED, 0},
+    [40] = {"server", 6, RESPONSE_HEADER_VENDOR_NONE, RESPONSE_HEADER_STRING, RESPONSE_PROPERTY_OFFSET(server)},
+    [44] = {"storage-class", 13, RESPONSE_HEADER_VENDOR_AMZ | RESPONSE_HEADER_VENDOR_OBS, RESPONSE_HEADER_STRING, RESPONSE_PROPERTY_OFFSET(storage_class)},
+    [47] = {"bucket-location", 15, RESPONSE_HEADER_VENDOR_OBS, RESPONSE_HEADER_STRING, RESPONSE_PROPERTY_OFFSET(bucket_location)},
+    [51] = {"website-redirect-location", 25, RESPONSE_HEADER_VENDOR_AMZ | RESPONSE_HEADER_VENDOR_OBS, RESPONSE_HEADER_STRING, RESPONSE_PROPERTY_OFFSET(website_redirect_location)},
+    [60] = {"connection", 10, RESPONSE_HEADER_VENDOR_NONE, RESPONSE_HEADER_IGNORED, 0},
+    [61] = {"access-control-allow-origin", 27, RESPONSE_HEADER_VENDOR_NONE, RESPONSE_HEADER_STRING, RESPONSE_PROPERTY_OFFSET(allow_origin)},
+    [65] = {"keep-alive", 10, RESPONSE_HEADER_VENDOR_NONE, RESPONSE_HEADER_IGNORED, 0},
+    [66] = {"id-2", 4, RESPONSE_HEADER_VENDOR_AMZ | RESPONSE_HEADER_VENDOR_OBS, RESPONSE_HEADER_STRING, RESPONSE_PROPERTY_OFFSET(request_id2)},
+    [68] = {"x-reserved-indicator", 20, RESPONSE_HEADER_VENDOR_NONE, RESPONSE_HEADER_STRING, RESPONSE_PROPERTY_OFFSET(reserved_indicator)},
+    [71] = {"content-type", 12, RESPONSE_HEADER_VENDOR_NONE, RESPONSE_HEADER_STRING, RESPONSE_PROPERTY_OFFSET(content_type)},
+    [74] = {"error-message", 13, RESPONSE_HEADER_VENDOR_AMZ | RESPONSE_HEADER_VENDOR_OBS, RESPONSE_HEADER_ERROR, 0},
+    [78] = {"az-redundancy", 13, RESPONSE_HEADER_VENDOR_OBS, RESPONSE_HEADER_STRING, RESPONSE_PROPERTY_OFFSET(az_redundancy)},
+    [84] = {"request-id", 10, RESPONSE_HEADER_VENDOR_AMZ | RESPONSE_HEADER_VENDOR_OBS, RESPONSE_HEADER_STRING, RESPONSE_PROPERTY_OFFSET(request_id)},
+    [87] = {"etag", 4, RESPONSE_HEADER_VENDOR_NONE, RESPONSE_HEADER_STRING, RESPONSE_PROPERTY_OFFSET(etag)},
+    [96] = {"expiration", 10, RESPONSE_HEADER_VENDOR_AMZ | RESPONSE_HEADER_VENDOR_OBS, RESPONSE_HEADER_STRING, RESPONSE_PROPERTY_OFFSET(expiration)},
+    [100] = {"epid", 4, RESPONSE_HEADER_VENDOR_AMZ | RESPONSE_HEADER_VENDOR_OBS, RESPONSE_HEADER_STRING, RESPONSE_PROPERTY_OFFSET(obs_head_epid)},
+    [101] = {"access-control-allow-headers", 28, RESPONSE_HEADER_VENDOR_NONE, RESPONSE_HEADER_STRING, RESPONSE_PROPERTY_OFFSET(allow_headers)},
+    [102] = {"access-control-expose-headers", 29, RESPONSE_HEADER_VENDOR_NONE, RESPONSE_HEADER_STRING, RESPONSE_PROPERTY_OFFSET(expose_headers)},
+    [104] = {"server-side-encryption", 22, RESPONSE_HEADER_VENDOR_AMZ | RESPONSE_HEADER_VENDOR_OBS, RESPONSE_HEADER_SSE, RESPONSE_PROPERTY_OFFSET(server_side_encryption)},
+    [105] = {"access-control-allow-methods", 28, RESPONSE_HEADER_VENDOR_NONE, RESPONSE_HEADER_STRING, RESPONSE_PROPERTY_OFFSET(allow_methods)},
+    [108] = {"accept-ranges", 13, RESPONSE_HEADER_VENDOR_NONE, RESPONSE_HEADER_IGNORED, 0},
+    [116] = {"restore", 7, RESPONSE_HEADER_VENDOR_AMZ | RESPONSE_HEADER_VENDOR_OBS, RESPONSE_HEADER_STRING, RESPONSE_PROPERTY_OFFSET(restore)},
+    [118] = {"location-clustergroup-id", 24, RESPONSE_HEADER_VENDOR_AMZ | RESPONSE_HEADER_VENDOR_OBS, RESPONSE_HEADER_STRING, RESPONSE_PROPERTY_OFFSET(location_clustergroup_id)},
+    [122] = {"server-side-encryption-customer-key-md5", 39, RESPONSE_HEADER_VENDOR_AMZ | RESPONSE_HEADER_VENDOR_OBS, RESPONSE_HEADER_STRING, RESPONSE_PROPERTY_OFFSET(customer_key_md5)},
+    [124] = {"server-side-encryption-customer-algorithm", 41, RESPONSE_HEADER_VENDOR_AMZ | RESPONSE_HEADER_VENDOR_OBS, RESPONSE_HEADER_SSE_CUSTOMER_ALGORITHM, RESPONSE_PROPERTY_OFFSET(customer_algorithm)},
+    [125] = {"server-side-encryption-kms-key-id", 33, RESPONSE_HEADER_VENDOR_OBS, RESPONSE_HEADER_STRING, RESPONSE_PROPERTY_OFFSET(kms_key_id)},
+};
+
+static unsigned int response_header_hash(const char *name, int len)
+{
+    return ((unsigned int)len + (unsigned int)tolower((unsigned char)name[0]) * 18 +
+        (unsigned int)tolower((unsigned char)name[len - 2]) * 18 +
+        (unsigned int)tolower((unsigned char)name[len - 1])) & (RESPONSE_HEADER_HASH_SIZE - 1);
+}
+
+// key为小写
+static int header_name_equals(const char *name, const char *key, int len)
+{
+    int i;
+    for (i = 0; i < len; i++) {
+        if (tolower((unsigned char)name[i]) != key[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int header_name_contains_error(const char *name, int len)
 {
-	return strncmp(header, prefix, namelen) == 0 && namelen == (int)(strlen(prefix));
+    int i;
+    for (i = 0; i + (int)(sizeof("error") - 1) <= len; i++) {
+        if (header_name_equals(name + i, "error", sizeof("error") - 1)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static response_header_type classify_response_header(const char *header, int namelen,
+    const response_header_entry **entry)
+{
+    const char *name = header;
+    int len = namelen;
+    unsigned char vendor = RESPONSE_HEADER_VENDOR_NONE;
+
+    *entry = NULL;
+    if (len > (int)RESPONSE_HEADER_VENDOR_PREFIX_LEN) {
+        if (header_name_equals(header, RESPONSE_HEADER_AMZ_PREFIX, RESPONSE_HEADER_VENDOR_PREFIX_LEN)) {
+            vendor = RESPONSE_HEADER_VENDOR_AMZ;
+        } else if (header_name_equals(header, RESPONSE_HEADER_OBS_PREFIX, RESPONSE_HEADER_VENDOR_PREFIX_LEN)) {
+            vendor = RESPONSE_HEADER_VENDOR_OBS;
+        }
+        if (vendor != RESPONSE_HEADER_VENDOR_NONE) {
+            name += RESPONSE_HEADER_VENDOR_PREFIX_LEN;
+            len -= RESPONSE_HEADER_VENDOR_PREFIX_LEN;
+        }
+    }
+
+    if (len >= 2) {
+        const response_header_entry *candidate = &response_header_table[response_header_hash(name, len)];
+        if (candidate->name && candidate->name_len == len && (candidate->vendors & vendor) &&
+            header_name_equals(name, candidate->name, len)) {
+            *entry = candidate;
+            return (response_header_type)candidate->type;
+        }
+    }
+
+    if (vendor != RESPONSE_HEADER_VENDOR_NONE && len > (int)(sizeof(RESPONSE_HEADER_META_PREFIX) - 1) &&
+        header_name_equals(name, RESPONSE_HEADER_META_PREFIX, sizeof(RESPONSE_HEADER_META_PREFIX) - 1)) {
+        return RESPONSE_HEADER_META;
+    }
+    if (header_name_contains_error(header, namelen)) {
+        return RESPONSE_HEADER_ERROR;
+    }
+    return RESPONSE_HEADER_UNKNOWN;
 }
 
 void response_headers_handler_initialize(response_headers_handler *handler)
@@ -33,259 +160,91 @@ void response_headers_handler_initialize(response_headers_handler *handler)
     string_multibuffer_initialize(handler->responseMetaDataStrings);
 }
 
-void parse_xml_header(response_headers_handler *handler, char *header, 
-	int namelen, int valuelen, char *c)
-{
-	int fit;
-	obs_response_properties *responseProperties = &(handler->responseProperties);
+// 拷贝len字节并补结束符，空间不足返回NULL
+#define copy_header_string(smb, str, len, copied)                       \
+    do {                                                                \
+        copied = NULL;                                                  \
+        if ((len) >= 0 && smb##Size + (len) + 1 <= (int) sizeof(smb)) { \
+            copied = &(smb[smb##Size]);                                 \
+            if ((len) > 0) {                                            \
+                (void)memcpy_s(copied, sizeof(smb) - smb##Size, str, len); \
+            }                                                           \
+            copied[len] = 0;                                            \
+            smb##Size += (len) + 1;                                     \
+        }                                                               \
+    } while (0)
 
-	if (prefix_cmp(header, "x-amz-request-id", namelen)||prefix_cmp(header, "x-obs-request-id", namelen)) {
-		responseProperties->request_id = 
-			string_multibuffer_current(handler->responsePropertyStrings);
-		string_multibuffer_add(handler->responsePropertyStrings, c, 
-			valuelen, fit);
-	}
-	else_if (prefix_cmp(header, "x-reserved-indicator", namelen)) {
-		responseProperties->reserved_indicator = 
-			string_multibuffer_current(handler->responsePropertyStrings);
-		string_multibuffer_add(handler->responsePropertyStrings, c, 
-			valuelen, fit);
-	}
-	else_if (prefix_cmp(header, "x-amz-id-2", namelen)||prefix_cmp(header, "x-obs-id-2", namelen)) {
-		responseProperties->request_id2 = 
-			string_multibuffer_current(handler->responsePropertyStrings);
-		string_multibuffer_add(handler->responsePropertyStrings, c, 
-			valuelen, fit);
-	}
-	else_if (prefix_cmp(header, "Content-Type", namelen)) {
-		responseProperties->content_type = 
-			string_multibuffer_current(handler->responsePropertyStrings);
-		string_multibuffer_add(handler->responsePropertyStrings, c, 
-			valuelen, fit);
-	}
-	else_if (prefix_cmp(header, "Content-Length", namelen)) {
-		handler->responseProperties.content_length = 0;
-		while (*c) {
-			handler->responseProperties.content_length *= 10;
-			handler->responseProperties.content_length += (*c++ - '0');
-		}
-	}
-	else_if (prefix_cmp(header, "Server", namelen)) {
-		responseProperties->server = 
-			string_multibuffer_current(handler->responsePropertyStrings);
-		string_multibuffer_add(handler->responsePropertyStrings, c, 
-			valuelen, fit);
-	}
-	else_if (prefix_cmp(header, "ETag", namelen)) {
-		responseProperties->etag = 
-			string_multibuffer_current(handler->responsePropertyStrings);
-		string_multibuffer_add(handler->responsePropertyStrings, c, 
-			valuelen, fit);
-	}
-	else_if (prefix_cmp(header, "x-amz-expiration", namelen)||prefix_cmp(header, "x-obs-expiration", namelen)) {
-		responseProperties->expiration= 
-			string_multibuffer_current(handler->responsePropertyStrings);
-		string_multibuffer_add(handler->responsePropertyStrings, c, 
-			valuelen, fit);
-	}
-	else_if(prefix_cmp(header, "x-amz-website-redirect-location", namelen)||prefix_cmp(header, "x-obs-website-redirect-location", namelen)) {
-		responseProperties->website_redirect_location= 
-			string_multibuffer_current(handler->responsePropertyStrings);
-		string_multibuffer_add(handler->responsePropertyStrings, c, 
-			valuelen, fit);
-	}
-	else_if (prefix_cmp(header, "x-amz-version-id", namelen)||prefix_cmp(header, "x-obs-version-id", MAX(namelen, 16))) {
-		responseProperties->version_id= 
-			string_multibuffer_current(handler->responsePropertyStrings);
-		string_multibuffer_add(handler->responsePropertyStrings, c, 
-			valuelen, fit);
-	}
-	else_if (prefix_cmp(header, "Access-Control-Allow-Origin", namelen)) {
-		responseProperties->allow_origin= 
-			string_multibuffer_current(handler->responsePropertyStrings);
-		string_multibuffer_add(handler->responsePropertyStrings, c, 
-			valuelen, fit);
-	}
-	else_if (prefix_cmp(header, "Access-Control-Allow-Headers", namelen)) {
-		responseProperties->allow_headers= 
-			string_multibuffer_current(handler->responsePropertyStrings);
-		string_multibuffer_add(handler->responsePropertyStrings, c, 
-			valuelen, fit);
-	}
-	else_if (prefix_cmp(header, "Access-Control-Max-Age", namelen)) {
-		responseProperties->max_age= 
-			string_multibuffer_current(handler->responsePropertyStrings);
-		string_multibuffer_add(handler->responsePropertyStrings, c, 
-			valuelen, fit);
-	}
-	else_if (prefix_cmp(header, "Access-Control-Allow-Methods", namelen)) {
-		responseProperties->allow_methods= 
-			string_multibuffer_current(handler->responsePropertyStrings);
-		string_multibuffer_add(handler->responsePropertyStrings, c, 
-			valuelen, fit);
-	}
-	else_if (prefix_cmp(header, "Access-Control-Expose-Headers", namelen)) {
-		responseProperties->expose_headers= 
-			string_multibuffer_current(handler->responsePropertyStrings);
-		string_multibuffer_add(handler->responsePropertyStrings, c, 
-			valuelen, fit);
-	}
-	else_if (prefix_cmp(header, "x-default-storage-class", namelen)||prefix_cmp(header, "x-obs-storage-class", namelen)) {
-		responseProperties->storage_class=
-			string_multibuffer_current(handler->responsePropertyStrings);
-		string_multibuffer_add(handler->responsePropertyStrings, c,
-			valuelen, fit);
-	}
-	else_if (prefix_cmp(header, "x-amz-storage-class", namelen)) {
-		responseProperties->storage_class=
-			string_multibuffer_current(handler->responsePropertyStrings);
-		string_multibuffer_add(handler->responsePropertyStrings, c,
-			valuelen, fit);
-	}
-	else_if (prefix_cmp(header, "x-amz-server-side-encryption", namelen)||prefix_cmp(header, "x-obs-server-side-encryption", namelen)) {
-		responseProperties->server_side_encryption= 
-			string_multibuffer_current(handler->responsePropertyStrings);
-		string_multibuffer_add(handler->responsePropertyStrings, c, 
-			valuelen, fit);
-		responseProperties->use_server_side_encryption = 1;
-	}
-	else_if (prefix_cmp(header, "x-amz-server-side-encryption-aws-kms-key-id", namelen)||prefix_cmp(header, "x-obs-server-side-encryption-kms-key-id", namelen)) {
-		responseProperties->kms_key_id= 
-			string_multibuffer_current(handler->responsePropertyStrings);
-		string_multibuffer_add(handler->responsePropertyStrings, c, 
-			valuelen, fit);
-	}
-	else_if (prefix_cmp(header, "x-amz-server-side-encryption-customer-algorithm", namelen)||prefix_cmp(header, "x-obs-server-side-encryption-customer-algorithm", namelen)) {
-		responseProperties->customer_algorithm= 
-			string_multibuffer_current(handler->responsePropertyStrings);
-		string_multibuffer_add(handler->responsePropertyStrings, c, 
-			valuelen, fit);
-		if(prefix_cmp(c,"AES256",sizeof("AES256")-1))
-		{
-			responseProperties->use_server_side_encryption = 1;
-		}
-	}
-	else_if (prefix_cmp(header, "x-amz-server-side-encryption-customer-key-MD5", namelen)||prefix_cmp(header, "x-obs-server-side-encryption-customer-key-MD5", namelen)) {
-		responseProperties->customer_key_md5= 
-			string_multibuffer_current(handler->responsePropertyStrings);
-		string_multibuffer_add(handler->responsePropertyStrings, c, 
-			valuelen, fit);
-	}
-	else_if (prefix_cmp(header, "x-obs-bucket-location", namelen)) {
-		responseProperties->bucket_location=
-			string_multibuffer_current(handler->responsePropertyStrings);
-		string_multibuffer_add(handler->responsePropertyStrings, c,
-			valuelen, fit);
-	}
-	else_if (prefix_cmp(header, "x-obs-version", namelen)) {
-		responseProperties->obs_version =
-			string_multibuffer_current(handler->responsePropertyStrings);
-		string_multibuffer_add(handler->responsePropertyStrings, c,
-			valuelen, fit);
-	}
-	else_if (prefix_cmp(header, "x-amz-restore", namelen)||prefix_cmp(header, "x-obs-restore", namelen)) {
-		responseProperties->restore =
-			string_multibuffer_current(handler->responsePropertyStrings);
-		string_multibuffer_add(handler->responsePropertyStrings, c,
-			valuelen, fit);
-	}
-	else_if (prefix_cmp(header, "x-obs-object-type", namelen)) {
-		responseProperties->obs_object_type =
-			string_multibuffer_current(handler->responsePropertyStrings);
-		string_multibuffer_add(handler->responsePropertyStrings, c,
-			valuelen, fit);
-	}
-	else_if (prefix_cmp(header, "x-obs-next-append-position", namelen)) {
-		responseProperties->obs_next_append_position =
-			string_multibuffer_current(handler->responsePropertyStrings);
-		string_multibuffer_add(handler->responsePropertyStrings, c,
-			valuelen, fit);
-	}
-	else_if (prefix_cmp(header, "x-amz-epid", namelen)) {
-		responseProperties->obs_head_epid  =
-			string_multibuffer_current(handler->responsePropertyStrings);
-		string_multibuffer_add(handler->responsePropertyStrings, c,
-			valuelen, fit);
-	}
-	else_if (prefix_cmp(header, "x-obs-epid", namelen)) {
-		responseProperties->obs_head_epid  =
-			string_multibuffer_current(handler->responsePropertyStrings);
-		string_multibuffer_add(handler->responsePropertyStrings, c,
-			valuelen, fit);
-	}
-	else_if(prefix_cmp(header, "x-obs-fs-file-interface", namelen)) {
-		responseProperties->fs_file_interface =
-			string_multibuffer_current(handler->responsePropertyStrings);
-		string_multibuffer_add(handler->responsePropertyStrings, c,
-			valuelen, fit);
-	}
-	else_if(prefix_cmp(header, "x-obs-az-redundancy", namelen)) {
-		responseProperties->az_redundancy =
-			string_multibuffer_current(handler->responsePropertyStrings);
-		string_multibuffer_add(handler->responsePropertyStrings, c,
-			valuelen, fit);
-	}
-	else_if(prefix_cmp(header, "x-amz-location-clustergroup-id", namelen)) {
-		responseProperties->location_clustergroup_id =
-			string_multibuffer_current(handler->responsePropertyStrings);
-		string_multibuffer_add(handler->responsePropertyStrings, c,
-			valuelen, fit);
-	}
-	else_if(prefix_cmp(header, "x-obs-location-clustergroup-id", namelen)) {
-		responseProperties->location_clustergroup_id =
-			string_multibuffer_current(handler->responsePropertyStrings);
-		string_multibuffer_add(handler->responsePropertyStrings, c,
-			valuelen, fit);
-	}
-	else_if (prefix_cmp(header, OBS_METADATA_HEADER_NAME_PREFIX, 
-		sizeof(OBS_METADATA_HEADER_NAME_PREFIX) - 1) ||
-		prefix_cmp(header, "x-obs-meta-", sizeof("x-obs-meta-") - 1)) 
-	{
-		if (handler->responseProperties.meta_data_count ==
-			sizeof(handler->responseMetaData)) {
-				return;
-		}
-		char *metaName = &(header[sizeof(OBS_METADATA_HEADER_NAME_PREFIX) - 1]);
-		int metaNameLen = 
-			(namelen - (sizeof(OBS_METADATA_HEADER_NAME_PREFIX) - 1));
-		char *copiedName = string_multibuffer_current(handler->responseMetaDataStrings);
-		string_multibuffer_add(handler->responseMetaDataStrings, metaName, metaNameLen, fit);
-		if (!fit) {
-			return;
-		}
+static void add_response_meta_data(response_headers_handler *handler, char *header,
+    int namelen, int valuelen, char *value)
+{
+    char *copiedName = NULL;
+    char *copiedValue = NULL;
+    int prefixLen = RESPONSE_HEADER_VENDOR_PREFIX_LEN + sizeof(RESPONSE_HEADER_META_PREFIX) - 1;
 
-		char *copiedValue = string_multibuffer_current(handler->responseMetaDataStrings);
-		string_multibuffer_add(handler->responseMetaDataStrings, c, valuelen, fit);
-		if (!fit) {
-			return;
-		}
+    if (handler->responseProperties.meta_data_count >=
+        (int)(sizeof(handler->responseMetaData) / sizeof(handler->responseMetaData[0]))) {
+        return;
+    }
+    copy_header_string(handler->responseMetaDataStrings, header + prefixLen, namelen - prefixLen, copiedName);
+    if (copiedName == NULL) {
+        return;
+    }
+    copy_header_string(handler->responseMetaDataStrings, value, valuelen, copiedValue);
+    if (copiedValue == NULL) {
+        return;
+    }
 
-		if (!handler->responseProperties.meta_data_count) {
-			handler->responseProperties.meta_data = handler->responseMetaData;
-		}
+    if (!handler->responseProperties.meta_data_count) {
+        handler->responseProperties.meta_data = handler->responseMetaData;
+    }
+    obs_name_value *metaHeader = &(handler->responseMetaData
+        [handler->responseProperties.meta_data_count++]);
+    metaHeader->name = copiedName;
+    metaHeader->value = copiedValue;
+}
 
-		obs_name_value *metaHeader = &(handler->responseMetaData
-			[handler->responseProperties.meta_data_count++]);
-		metaHeader->name = copiedName;
-		metaHeader->value = copiedValue;
-	}
+static void dispatch_response_header(response_headers_handler *handler, response_header_type type,
+    const response_header_entry *entry, char *header, int namelen, int valuelen, char *value)
+{
+    obs_response_properties *responseProperties = &(handler->responseProperties);
+    char *copied = NULL;
 
-	return;
-} 
+    switch (type) {
+    case RESPONSE_HEADER_STRING:
+    case RESPONSE_HEADER_SSE:
+    case RESPONSE_HEADER_SSE_CUSTOMER_ALGORITHM:
+        copy_header_string(handler->responsePropertyStrings, value, valuelen, copied);
+        if (copied == NULL) {
+            COMMLOG(OBS_LOGWARN, "response header %.*s dropped, property buffer is full", namelen, header);
+            return;
+        }
+        *(const char **)((char *)responseProperties + entry->offset) = copied;
+        if (type == RESPONSE_HEADER_SSE || (type == RESPONSE_HEADER_SSE_CUSTOMER_ALGORITHM &&
+            strncmp(value, "AES256", sizeof("AES256") - 1) == 0)) {
+            responseProperties->use_server_side_encryption = 1;
+        }
+        break;
+    case RESPONSE_HEADER_CONTENT_LENGTH:
+        responseProperties->content_length = 0;
+        while (*value >= '0' && *value <= '9') {
+            responseProperties->content_length *= 10;
+            responseProperties->content_length += (*value++ - '0');
+        }
+        break;
+    case RESPONSE_HEADER_META:
+        add_response_meta_data(handler, header, namelen, valuelen, value);
+        break;
+    default:
+        break;
+    }
+}
 
-void response_headers_handler_add(response_headers_handler *handler,
-                                  char *header, int len)
+response_header_type response_headers_handler_add(response_headers_handler *handler,
+                                                  char *header, int len)
 {
     char *end = &(header[len]);
-    if (handler->done) {
-        return;
-    }
-    
-    if (handler->responsePropertyStringsSize == (sizeof(handler->responsePropertyStrings) - 1)) {
-        return;
-    }
     if (len < 3) {
-        return;
+        return RESPONSE_HEADER_IGNORED;
     }
     
     while (is_blank(*header)) {
@@ -299,8 +258,8 @@ void response_headers_handler_add(response_headers_handler *handler,
         end++;
     }
 
-    if (end == header) {
-        return;
+    if (end <= header) {
+        return RESPONSE_HEADER_IGNORED;
     }
 
     *end = 0;
@@ -308,17 +267,24 @@ void response_headers_handler_add(response_headers_handler *handler,
     while (*c && (*c != ':')) {
         c++;
     }
+    if (*c != ':') {
+        // 状态行和空行
+        return RESPONSE_HEADER_IGNORED;
+    }
     
     int namelen = c - header;
     c++;
     while (is_blank(*c)) {
         c++;
     }
-    int valuelen = (end - c) + 1;
-    
-    parse_xml_header(handler, header, namelen, valuelen, c);
+    int valuelen = end - c;
 
-    return;
+    const response_header_entry *entry = NULL;
+    response_header_type type = classify_response_header(header, namelen, &entry);
+    if (!handler->done) {
+        dispatch_response_header(handler, type, entry, header, namelen, valuelen, c);
+    }
+    return type;
 }
 void response_headers_handler_done(response_headers_handler *handler, CURL *curl)
 {
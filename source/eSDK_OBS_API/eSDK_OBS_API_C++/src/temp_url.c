@@ -15,11 +15,21 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <ctype.h>
+#include <openssl/hmac.h>
 #include "temp_url.h"
 #include "util.h"
 #include "log.h"
 #include "securec.h"
 
+#if defined __GNUC__ || defined LINUX
+#include <pthread.h>
+#endif
+
+#if defined WIN32
+#include <process.h>
+#endif
+
 /**
  * HTTP方法字符串映射
  */
@@ -89,12 +99,11 @@ static obs_status build_canonicalized_resource(
             if (encoded_len < 0) {
                 return OBS_STATUS_UriTooLong;
             }
-            len += encoded_len;
+            len += strlen(&output[len]);
         }
     }
 
-    return OBS;
-_STATUS_OK;
+    return OBS_STATUS_OK;
 }
 
 /**
@@ -158,19 +167,6 @@ static obs_status build_canonicalized_query_string(
     return OBS_STATUS_OK;
 }
 
-/**
- * 获取当前时间戳（ISO 8601格式）
- */
-static void get_iso8601_time(char *buffer, int buffer_size)
-{
-    time_t now = time(NULL);
-    struct tm *tm_info = gmtime(&now);
-
-    if (tm_info != NULL) {
-        strftime(buffer, buffer_size, "%Y-%m-%dT%H:%M:%SZ", GMTIME_INFO_TM);
-    }
-}
-
 /**
  * 生成V2签名（华为云OBS使用）
  */
@@ -526,3 +522,456 @@ obs_status create_head_temp_url(
 
     return create_presigned_url_internal(options, &params, url_out, url_out_len, NULL);
 }
+
+/*************************************批量生成临时授权URL**************************************/
+
+#define TEMP_URL_BATCH_FRAGMENT_SIZE  2048
+
+/**
+ * 批量生成时所有key共享的预编码片段，只构建一次
+ *
+ * 待签名字符串 = sign_prefix + 编码后的key
+ * URL = url_prefix + 编码后的key + url_middle + 编码后的签名
+ */
+typedef struct temp_url_batch_context
+{
+    const obs_temp_url_batch_params *params;
+    obs_temp_url_batch_result *result;
+    const char *secret_access_key;
+    int secret_access_key_len;
+    uint64_t expires_timestamp;
+    char sign_prefix[TEMP_URL_BATCH_FRAGMENT_SIZE];    // "METHOD\nquery\n/bucket/"
+    int sign_prefix_len;
+    char url_prefix[TEMP_URL_BATCH_FRAGMENT_SIZE];     // "https://host/bucket/"
+    int url_prefix_len;
+    char url_middle[TEMP_URL_BATCH_FRAGMENT_SIZE];     // "?query&AWSAccessKeyId=ak&Signature="
+    int url_middle_len;
+} temp_url_batch_context;
+
+/**
+ * 单个线程负责的key区间及其在输出缓冲区中的独占区域
+ */
+typedef struct temp_url_batch_task
+{
+    const temp_url_batch_context *ctx;
+    unsigned int begin;
+    unsigned int end;
+    uint64_t arena_begin;
+    uint64_t arena_used;
+    unsigned int success_count;
+} temp_url_batch_task;
+
+/**
+ * 初始化批量临时授权URL参数结构
+ */
+void init_temp_url_batch_params(obs_temp_url_batch_params *params)
+{
+    if (params == NULL) {
+        return;
+    }
+
+    memset_s(params, sizeof(obs_temp_url_batch_params), 0, sizeof(obs_temp_url_batch_params));
+    params->http_method = OBS_HTTP_METHOD_GET;
+    params->expires = 3600; // 默认1小时
+}
+
+/**
+ * 与urlEncode相同的编码规则，直接写入目标缓冲区并返回写入长度
+ */
+static unsigned int temp_url_encode_key(char *dest, const char *src)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    char *start = dest;
+
+    while (*src) {
+        unsigned char c = (unsigned char)*src++;
+        if (isalnum(c) || (c == '.') || (c == '-') || (c == '_') || (c == '~')) {
+            *dest++ = (char)c;
+        } else {
+            *dest++ = '%';
+            *dest++ = hex[c >> 4];
+            *dest++ = hex[c & 15];
+        }
+    }
+
+    return (unsigned int)(dest - start);
+}
+
+/**
+ * 对20字节HMAC-SHA1做base64编码并URL编码，结果与generate_signature_v2 + url_encode_param一致
+ */
+static unsigned int temp_url_encode_signature(char *dest, const unsigned char hmac[20])
+{
+    static const char b64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    char base64_signature[32];
+    int len = 0;
+    int i;
+
+    for (i = 0; i + 2 < 20; i += 3) {
+        unsigned int v = ((unsigned int)hmac[i] << 16) | ((unsigned int)hmac[i + 1] << 8) | hmac[i + 2];
+        base64_signature[len++] = b64[(v >> 18) & 0x3F];
+        base64_signature[len++] = b64[(v >> 12) & 0x3F];
+        base64_signature[len++] = b64[(v >> 6) & 0x3F];
+        base64_signature[len++] = b64[v & 0x3F];
+    }
+    // 20 = 6 * 3 + 2，剩余两个字节补一个'='
+    unsigned int tail = ((unsigned int)hmac[18] << 16) | ((unsigned int)hmac[19] << 8);
+    base64_signature[len++] = b64[(tail >> 18) & 0x3F];
+    base64_signature[len++] = b64[(tail >> 12) & 0x3F];
+    base64_signature[len++] = b64[(tail >> 6) & 0x3F];
+    base64_signature[len++] = '=';
+    base64_signature[len] = '\0';
+
+    return temp_url_encode_key(dest, base64_signature);
+}
+
+/**
+ * 单个key生成URL所需的缓冲区上限（含结尾'\0'）
+ */
+static uint64_t temp_url_batch_key_bound(const temp_url_batch_context *ctx, const char *key)
+{
+    if (key == NULL || key[0] == '\0') {
+        return 0;
+    }
+    return (uint64_t)ctx->url_prefix_len + 3 * (uint64_t)strlen(key) + ctx->url_middle_len +
+        OBS_MAX_ENCODED_SIGNATURE_SIZE + 1;
+}
+
+/**
+ * 校验参数并构建所有key共享的签名和URL片段
+ */
+static obs_status build_temp_url_batch_context(
+    const obs_options *options,
+    const obs_temp_url_batch_params *params,
+    temp_url_batch_context *ctx)
+{
+    if (options == NULL || params == NULL) {
+        COMMLOG(OBS_LOGERROR, "Invalid parameters in create_presigned_url_batch");
+        return OBS_STATUS_InvalidParameter;
+    }
+
+    if (params->keys == NULL || params->key_count == 0) {
+        COMMLOG(OBS_LOGERROR, "Keys parameter is required");
+        return OBS_STATUS_InvalidParameter;
+    }
+
+    if (params->expires == 0) {
+        COMMLOG(OBS_LOGERROR, "Expires parameter is required");
+        return OBS_STATUS_InvalidParameter;
+    }
+
+    const obs_bucket_context *bucket_ctx = &options->bucket_options;
+    if (bucket_ctx->access_key == NULL || bucket_ctx->secret_access_key == NULL) {
+        COMMLOG(OBS_LOGERROR, "Access key and secret access key are required");
+        return OBS_STATUS_NoToken;
+    }
+
+    if (bucket_ctx->host_name == NULL || bucket_ctx->bucket_name == NULL ||
+        bucket_ctx->bucket_name[0] == '\0') {
+        COMMLOG(OBS_LOGERROR, "Host name and bucket name are required");
+        return OBS_STATUS_InvalidParameter;
+    }
+
+    if (params->http_method < 0 || params->http_method >= sizeof(g_http_method_strings) / sizeof(g_http_method_strings[0])) {
+        COMMLOG(OBS_LOGERROR, "Invalid HTTP method");
+        return OBS_STATUS_InvalidParameter;
+    }
+
+    memset_s(ctx, sizeof(temp_url_batch_context), 0, sizeof(temp_url_batch_context));
+    ctx->params = params;
+    ctx->secret_access_key = bucket_ctx->secret_access_key;
+    ctx->secret_access_key_len = (int)strlen(bucket_ctx->secret_access_key);
+    ctx->expires_timestamp = (uint64_t)time(NULL) + params->expires;
+
+    char canonicalized_query[OBS_MAX_QUERY_STRING_SIZE + 1];
+    obs_status status = build_canonicalized_query_string(canonicalized_query,
+                                                         sizeof(canonicalized_query),
+                                                         params->query_params,
+                                                         params->query_params_count,
+                                                         ctx->expires_timestamp,
+                                                         NULL);
+    if (status != OBS_STATUS_OK) {
+        COMMLOG(OBS_LOGERROR, "Failed to build canonicalized query string: %d", status);
+        return status;
+    }
+
+    const char *protocol = (bucket_ctx->protocol == OBS_PROTOCOL_HTTPS) ? "https://" : "http://";
+    ctx->sign_prefix_len = snprintf_s(ctx->sign_prefix, sizeof(ctx->sign_prefix), _TRUNCATE,
+        "%s\n%s\n/%s/", g_http_method_strings[params->http_method], canonicalized_query,
+        bucket_ctx->bucket_name);
+    ctx->url_prefix_len = snprintf_s(ctx->url_prefix, sizeof(ctx->url_prefix), _TRUNCATE,
+        "%s%s/%s/", protocol, bucket_ctx->host_name, bucket_ctx->bucket_name);
+    ctx->url_middle_len = snprintf_s(ctx->url_middle, sizeof(ctx->url_middle), _TRUNCATE,
+        "?%s&AWSAccessKeyId=%s&Signature=", canonicalized_query, bucket_ctx->access_key);
+    if (ctx->sign_prefix_len < 0 || ctx->url_prefix_len < 0 || ctx->url_middle_len < 0) {
+        COMMLOG(OBS_LOGERROR, "Shared url fragments are too long in function: %s", __FUNCTION__);
+        return OBS_STATUS_UriTooLong;
+    }
+
+    return OBS_STATUS_OK;
+}
+
+/**
+ * 在任务独占的缓冲区区域内为[begin, end)的key生成URL
+ *
+ * 每个线程只初始化一次带密钥的HMAC状态，之后每个URL复用该密钥重新开始计算；
+ * 编码后的key直接写入输出缓冲区，并从缓冲区中参与签名，不再额外拷贝。
+ */
+static void run_temp_url_batch_task(temp_url_batch_task *task)
+{
+    const temp_url_batch_context *ctx = task->ctx;
+    obs_temp_url_batch_entry *entries = ctx->result->entries;
+    char *arena = ctx->result->arena;
+    uint64_t pos = task->arena_begin;
+    unsigned char hmac[20];
+    unsigned int hmac_len = 20;
+    unsigned int i;
+
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+    HMAC_CTX hmac_ctx_stack;
+    HMAC_CTX *hmac_ctx = &hmac_ctx_stack;
+    HMAC_CTX_init(hmac_ctx);
+#else
+    HMAC_CTX *hmac_ctx = HMAC_CTX_new();
+    if (hmac_ctx == NULL) {
+        COMMLOG(OBS_LOGERROR, "HMAC_CTX_new failed!");
+        for (i = task->begin; i < task->end; i++) {
+            entries[i].offset = pos;
+            entries[i].length = 0;
+            entries[i].status = OBS_STATUS_OutOfMemory;
+        }
+        task->arena_used = 0;
+        return;
+    }
+#endif
+    HMAC_Init_ex(hmac_ctx, ctx->secret_access_key, ctx->secret_access_key_len, EVP_sha1(), NULL);
+
+    for (i = task->begin; i < task->end; i++) {
+        const char *key = ctx->params->keys[i];
+        entries[i].offset = pos;
+        entries[i].length = 0;
+        if (key == NULL || key[0] == '\0') {
+            entries[i].status = OBS_STATUS_InvalidParameter;
+            continue;
+        }
+
+        char *url = &arena[pos];
+        unsigned int len = 0;
+        memcpy_s(url, ctx->url_prefix_len, ctx->url_prefix, ctx->url_prefix_len);
+        len += ctx->url_prefix_len;
+        unsigned int key_len = temp_url_encode_key(&url[len], key);
+
+        HMAC_Init_ex(hmac_ctx, NULL, 0, NULL, NULL);
+        HMAC_Update(hmac_ctx, (const unsigned char *)ctx->sign_prefix, ctx->sign_prefix_len);
+        HMAC_Update(hmac_ctx, (const unsigned char *)&url[len], key_len);
+        HMAC_Final(hmac_ctx, hmac, &hmac_len);
+        len += key_len;
+
+        memcpy_s(&url[len], ctx->url_middle_len, ctx->url_middle, ctx->url_middle_len);
+        len += ctx->url_middle_len;
+        len += temp_url_encode_signature(&url[len], hmac);
+
+        if (len >= OBS_MAX_TEMP_URL_LENGTH) {
+            entries[i].status = OBS_STATUS_UriTooLong;
+            continue;
+        }
+        url[len] = '\0';
+        entries[i].length = len;
+        entries[i].status = OBS_STATUS_OK;
+        pos += len + 1;
+        task->success_count++;
+    }
+
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+    HMAC_CTX_cleanup(hmac_ctx);
+#else
+    HMAC_CTX_free(hmac_ctx);
+#endif
+    task->arena_used = pos - task->arena_begin;
+}
+
+#if defined __GNUC__ || defined LINUX
+static void *temp_url_batch_thread_linux(void *param)
+{
+    run_temp_url_batch_task((temp_url_batch_task *)param);
+    return NULL;
+}
+#endif
+
+#ifdef WIN32
+static unsigned __stdcall temp_url_batch_thread_win32(void *param)
+{
+    run_temp_url_batch_task((temp_url_batch_task *)param);
+    return 0;
+}
+#endif
+
+/**
+ * 并行执行各任务，线程创建失败时在调用线程中执行该任务
+ */
+static void run_temp_url_batch_tasks(temp_url_batch_task *tasks, unsigned int task_count)
+{
+    unsigned int i;
+
+    if (task_count == 1) {
+        run_temp_url_batch_task(&tasks[0]);
+        return;
+    }
+
+#if defined __GNUC__ || defined LINUX
+    pthread_t arr_thread[OBS_MAX_TEMP_URL_BATCH_THREADS];
+    int created[OBS_MAX_TEMP_URL_BATCH_THREADS] = {0};
+    for (i = 1; i < task_count; i++) {
+        if (pthread_create(&arr_thread[i], NULL, temp_url_batch_thread_linux, (void *)&tasks[i]) == 0) {
+            created[i] = 1;
+        } else {
+            COMMLOG(OBS_LOGWARN, "create temp url batch thread failed i[%u]", i);
+        }
+    }
+    run_temp_url_batch_task(&tasks[0]);
+    for (i = 1; i < task_count; i++) {
+        if (created[i]) {
+            pthread_join(arr_thread[i], NULL);
+        } else {
+            run_temp_url_batch_task(&tasks[i]);
+        }
+    }
+#endif
+
+#ifdef WIN32
+    HANDLE arr_thread[OBS_MAX_TEMP_URL_BATCH_THREADS] = {0};
+    for (i = 1; i < task_count; i++) {
+        arr_thread[i] = (HANDLE)_beginthreadex(NULL, 0, temp_url_batch_thread_win32, (void *)&tasks[i], 0, NULL);
+        if (arr_thread[i] == 0) {
+            COMMLOG(OBS_LOGWARN, "create temp url batch thread failed i[%u]", i);
+        }
+    }
+    run_temp_url_batch_task(&tasks[0]);
+    for (i = 1; i < task_count; i++) {
+        if (arr_thread[i] != 0) {
+            WaitForSingleObject(arr_thread[i], INFINITE);
+            CloseHandle(arr_thread[i]);
+        } else {
+            run_temp_url_batch_task(&tasks[i]);
+        }
+    }
+#endif
+}
+
+/**
+ * 计算批量生成所需的输出缓冲区大小（上限值）
+ */
+uint64_t get_presigned_url_batch_size(
+    const obs_options *options,
+    const obs_temp_url_batch_params *params)
+{
+    temp_url_batch_context ctx;
+    uint64_t total = 0;
+    unsigned int i;
+
+    if (build_temp_url_batch_context(options, params, &ctx) != OBS_STATUS_OK) {
+        return 0;
+    }
+    for (i = 0; i < params->key_count; i++) {
+        total += temp_url_batch_key_bound(&ctx, params->keys[i]);
+    }
+    return total;
+}
+
+/**
+ * 批量生成临时授权URL
+ *
+ * key按区间划分给各线程，每个线程写入按上限值预留的独占区域，
+ * 全部完成后再把各区域依次前移，使输出缓冲区保持连续。
+ */
+obs_status create_presigned_url_batch(
+    const obs_options *options,
+    const obs_temp_url_batch_params *params,
+    obs_temp_url_batch_result *result)
+{
+    temp_url_batch_context ctx;
+    temp_url_batch_task tasks[OBS_MAX_TEMP_URL_BATCH_THREADS];
+    unsigned int task_count;
+    unsigned int i;
+
+    if (result == NULL || result->entries == NULL || result->arena == NULL) {
+        COMMLOG(OBS_LOGERROR, "Invalid result in create_presigned_url_batch");
+        return OBS_STATUS_InvalidParameter;
+    }
+    result->arena_used = 0;
+    result->success_count = 0;
+
+    obs_status status = build_temp_url_batch_context(options, params, &ctx);
+    if (status != OBS_STATUS_OK) {
+        return status;
+    }
+    ctx.result = result;
+    result->expires_timestamp = (int64_t)ctx.expires_timestamp;
+
+    task_count = params->thread_num;
+    if (task_count == 0) {
+        task_count = 1;
+    }
+    if (task_count > OBS_MAX_TEMP_URL_BATCH_THREADS) {
+        task_count = OBS_MAX_TEMP_URL_BATCH_THREADS;
+    }
+    if (task_count > params->key_count) {
+        task_count = params->key_count;
+    }
+
+    // 按key数量均分区间，同时按上限值为每个区间预留缓冲区
+    uint64_t required = 0;
+    unsigned int keys_per_task = params->key_count / task_count;
+    unsigned int remainder = params->key_count % task_count;
+    unsigned int begin = 0;
+    for (i = 0; i < task_count; i++) {
+        unsigned int end = begin + keys_per_task + (i < remainder ? 1 : 0);
+        unsigned int k;
+        tasks[i].ctx = &ctx;
+        tasks[i].begin = begin;
+        tasks[i].end = end;
+        tasks[i].arena_begin = required;
+        tasks[i].arena_used = 0;
+        tasks[i].success_count = 0;
+        for (k = begin; k < end; k++) {
+            required += temp_url_batch_key_bound(&ctx, params->keys[k]);
+        }
+        begin = end;
+    }
+
+    if (required > result->arena_size) {
+        COMMLOG(OBS_LOGERROR, "Arena is too small for presigned url batch, required: %llu, given: %llu",
+            (unsigned long long)required, (unsigned long long)result->arena_size);
+        result->arena_used = required;
+        return OBS_STATUS_InvalidParameter;
+    }
+
+    run_temp_url_batch_tasks(tasks, task_count);
+
+    // 压缩各线程区域之间的空隙
+    uint64_t write_pos = 0;
+    for (i = 0; i < task_count; i++) {
+        uint64_t shift = tasks[i].arena_begin - write_pos;
+        if (shift > 0 && tasks[i].arena_used > 0) {
+            errno_t err = memmove_s(&result->arena[write_pos], result->arena_size - write_pos,
+                &result->arena[tasks[i].arena_begin], tasks[i].arena_used);
+            if (err != EOK) {
+                COMMLOG(OBS_LOGWARN, "%s(%d): memmove_s failed!(%d)", __FUNCTION__, __LINE__, err);
+            }
+        }
+        if (shift > 0) {
+            unsigned int k;
+            for (k = tasks[i].begin; k < tasks[i].end; k++) {
+                result->entries[k].offset -= shift;
+            }
+        }
+        write_pos += tasks[i].arena_used;
+        result->success_count += tasks[i].success_count;
+    }
+    result->arena_used = write_pos;
+
+    COMMLOG(OBS_LOGINFO, "Created presigned url batch, keys: %u, succeeded: %u, threads: %u",
+        params->key_count, result->success_count, task_count);
+
+    return OBS_STATUS_OK;
+}
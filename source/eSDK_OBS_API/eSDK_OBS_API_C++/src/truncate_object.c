@@ -16,6 +16,7 @@
 #include "request.h"
 #include "securec.h"
 #include "request_util.h"
+#include "metadata_cache.h"
 
 
 // only posix bucke use
@@ -64,5 +65,6 @@ void truncate_object(const obs_options *options, char *key, uint64_t object_leng
 	params.use_api = use_api;
 
 	request_perform(&params);
+	metadata_cache_invalidate_object(&params.bucketContext, key);
 	COMMLOG(OBS_LOGINFO, "Leave truncate_object successfully !");
 }
\ No newline at end of file
@@ -20,6 +20,7 @@
 #include <ctype.h>
 #include <string.h>
 #include "util.h"
+#include "obs_time_util.h"
 #include "securec.h"
 #include "log.h"
 #include "pcre.h"
@@ -419,8 +420,8 @@ int64_t parseIso8601Time(const char *str)
 	stm.tm_sec += getnum();
 	++str;
 
-	stm.tm_isdst = -1;
-	int64_t ret = mktime(&stm);
+	int64_t ret = obs_days_from_civil(stm.tm_year + 1900, stm.tm_mon + 1, stm.tm_mday) * 86400 +
+		stm.tm_hour * 3600 + stm.tm_min * 60 + stm.tm_sec;
 
 	if (*str == '.') {
 		str++;
@@ -0,0 +1,199 @@
+/*********************************************************************************
+* Copyright 2024 Huawei Technologies Co.,Ltd.
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+* this file except in compliance with the License.  You may obtain a copy of the
+* License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed
+* under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+* CONDITIONS OF ANY KIND, either express or implied.  See the License for the
+* specific language governing permissions and limitations under the License.
+**********************************************************************************
+*/
+#include <string.h>
+#include <openssl/md5.h>
+#include "xml_writer.h"
+#include "securec.h"
+#include "log.h"
+
+#define XML_WRITER_UINT_LEN 16
+
+/* 与pcre_replace转义的字符集一致 */
+static const char xml_special_chars[] = "&<>'\"";
+
+void xml_writer_initialize(xml_writer *writer, xml_writer_record_callback *record_callback,
+    void *record_data)
+{
+    memset_s(writer, sizeof(xml_writer), 0, sizeof(xml_writer));
+    writer->record_callback = record_callback;
+    writer->record_data = record_data;
+}
+
+void xml_writer_rewind(xml_writer *writer)
+{
+    writer->record = 0;
+    writer->record_offset = 0;
+    writer->bytes_written = 0;
+    writer->position = 0;
+    writer->out = NULL;
+    writer->window_end = 0;
+    writer->finished = 0;
+}
+
+int64_t xml_writer_measure(xml_writer *writer, unsigned char *md5)
+{
+    MD5_CTX context;
+    unsigned int index = 0;
+    int64_t len = 0;
+
+    xml_writer_rewind(writer);
+    if (md5 != NULL) {
+        MD5_Init(&context);
+        writer->md5_context = &context;
+    }
+    while ((*(writer->record_callback))(writer, index, writer->record_data)) {
+        index++;
+    }
+    if (md5 != NULL) {
+        MD5_Final(md5, &context);
+        writer->md5_context = NULL;
+    }
+    len = writer->position;
+    xml_writer_rewind(writer);
+    return len;
+}
+
+int xml_writer_measuring(const xml_writer *writer)
+{
+    return writer->out == NULL;
+}
+
+int xml_writer_read(xml_writer *writer, char *buffer, int buffer_size)
+{
+    int64_t end = 0;
+    int produced = 0;
+
+    if (writer->finished || buffer_size <= 0) {
+        return 0;
+    }
+    writer->out = buffer;
+    writer->window_end = writer->bytes_written + buffer_size;
+    for (;;) {
+        writer->position = writer->record_offset;
+        if (!(*(writer->record_callback))(writer, writer->record, writer->record_data)) {
+            writer->finished = 1;
+            break;
+        }
+        if (writer->position > writer->window_end) {
+            // 记录跨越了缓冲区末尾，下次从该记录开头重新生成并跳过已输出部分
+            break;
+        }
+        writer->record++;
+        writer->record_offset = writer->position;
+        if (writer->position == writer->window_end) {
+            break;
+        }
+    }
+    end = writer->position < writer->window_end ? writer->position : writer->window_end;
+    produced = (int)(end - writer->bytes_written);
+    writer->bytes_written = end;
+    writer->out = NULL;
+    return produced;
+}
+
+void xml_writer_raw(xml_writer *writer, const char *data, size_t len)
+{
+    int64_t start = writer->position;
+    int64_t end = start + (int64_t)len;
+    int64_t from = 0;
+    int64_t to = 0;
+
+    writer->position = end;
+    if (writer->md5_context != NULL) {
+        MD5_Update((MD5_CTX *)writer->md5_context, data, len);
+    }
+    if (writer->out == NULL || end <= writer->bytes_written || start >= writer->window_end) {
+        return;
+    }
+    from = start > writer->bytes_written ? start : writer->bytes_written;
+    to = end < writer->window_end ? end : writer->window_end;
+    errno_t err = memcpy_s(writer->out + (from - writer->bytes_written),
+        (size_t)(writer->window_end - from), data + (from - start), (size_t)(to - from));
+    CheckAndLogNoneZero(err, "memcpy_s", __FUNCTION__, __LINE__);
+}
+
+static void xml_writer_escaped(xml_writer *writer, const char *content)
+{
+    while (*content) {
+        // strcspn一次扫描出不需要转义的整段，避免逐字符判断
+        size_t run = strcspn(content, xml_special_chars);
+        if (run) {
+            xml_writer_raw(writer, content, run);
+            content += run;
+        }
+        switch (*content) {
+            case '&':
+                xml_writer_raw(writer, "&amp;", 5);
+                break;
+            case '<':
+                xml_writer_raw(writer, "&lt;", 4);
+                break;
+            case '>':
+                xml_writer_raw(writer, "&gt;", 4);
+                break;
+            case '\'':
+                xml_writer_raw(writer, "&apos;", 6);
+                break;
+            case '\"':
+                xml_writer_raw(writer, "&quot;", 6);
+                break;
+            default:
+                return;
+        }
+        content++;
+    }
+}
+
+void xml_writer_open(xml_writer *writer, const char *element_name)
+{
+    xml_writer_raw(writer, "<", 1);
+    xml_writer_raw(writer, element_name, strlen(element_name));
+    xml_writer_raw(writer, ">", 1);
+}
+
+void xml_writer_close(xml_writer *writer, const char *element_name)
+{
+    xml_writer_raw(writer, "</", 2);
+    xml_writer_raw(writer, element_name, strlen(element_name));
+    xml_writer_raw(writer, ">", 1);
+}
+
+void xml_writer_element(xml_writer *writer, const char *element_name, const char *content,
+    eFormalizeChoice needFormalize)
+{
+    if (content == NULL || '\0' == content[0]) {
+        return;
+    }
+    xml_writer_open(writer, element_name);
+    if (needFormalize == NEED_FORMALIZE) {
+        xml_writer_escaped(writer, content);
+    } else {
+        xml_writer_raw(writer, content, strlen(content));
+    }
+    xml_writer_close(writer, element_name);
+}
+
+void xml_writer_element_uint(xml_writer *writer, const char *element_name, unsigned int value)
+{
+    char buffer[XML_WRITER_UINT_LEN] = {0};
+    int len = snprintf_s(buffer, sizeof(buffer), _TRUNCATE, "%u", value);
+    if (len < 0) {
+        COMMLOG(OBS_LOGERROR, "snprintf_s error xmlElementName:%s!", element_name);
+        return;
+    }
+    xml_writer_open(writer, element_name);
+    xml_writer_raw(writer, buffer, (size_t)len);
+    xml_writer_close(writer, element_name);
+}
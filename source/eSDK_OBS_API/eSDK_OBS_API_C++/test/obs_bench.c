@@ -0,0 +1,1076 @@
+/*********************************************************************************
+* Copyright 2024 Huawei Technologies Co.,Ltd.
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+* this file except in compliance with the License.  You may obtain a copy of the
+* License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed
+* under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+* CONDITIONS OF ANY KIND, either express or implied.  See the License for the
+* specific language governing permissions and limitations under the License.
+**********************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "eSDKOBS.h"
+#include "obs_stub_server.h"
+
+/**
+ * OBS SDK性能测试
+ *
+ * 通过公开API对本地回环的obs_stub_server（默认在子进程中运行，CPU统计只包含客户端）
+ * 或-e指定的服务端执行put/get/head/list/delete/mixed/upload_file/download_file/
+ * batch_delete/presign/put_stream/get_stream负载，按对象大小和并发度组合运行，每个组合输出一行JSON：
+ * ops/s、MB/s、p50/p99/p999时延（微秒）和每次操作的CPU时间（微秒）
+ *
+ * 内置stub服务可通过-L/-R/-F注入时延、限速和故障，用于测量重试等失败路径的开销
+ *
+ * 用法: obs_bench [-e host:port] [-T] [-b bucket] [-w workloads] [-s sizes] [-c threads]
+ *                 [-n ops] [-k keys] [-x mix] [-p part_size] [-B batch] [-o json|text]
+ *                 [-L latency] [-R bandwidth] [-F faults] [-S seed]
+ */
+
+#define BENCH_DEFAULT_OPS           2000
+#define BENCH_DEFAULT_KEYSPACE      256
+#define BENCH_DEFAULT_PART_SIZE     (5 * 1024 * 1024)
+#define BENCH_DEFAULT_BATCH         100
+#define BENCH_MAX_LIST              16
+#define BENCH_PREPARE_ATTEMPTS      10
+#define BENCH_KEY_SIZE              256
+#define BENCH_PREFIX_SIZE           128
+#define BENCH_PATH_SIZE             512
+
+typedef enum
+{
+    BENCH_PUT = 0,
+    BENCH_GET,
+    BENCH_HEAD,
+    BENCH_LIST,
+    BENCH_DELETE,
+    BENCH_MIXED,
+    BENCH_UPLOAD_FILE,
+    BENCH_DOWNLOAD_FILE,
+    BENCH_BATCH_DELETE,
+    BENCH_PRESIGN,
+    BENCH_PUT_STREAM,
+    BENCH_GET_STREAM,
+    BENCH_WORKLOAD_BUTT
+} bench_workload;
+
+static const char *g_workload_names[BENCH_WORKLOAD_BUTT] = {
+    "put", "get", "head", "list", "delete", "mixed", "upload_file", "download_file", "batch_delete", "presign",
+    "put_stream", "get_stream"
+};
+
+typedef struct bench_config
+{
+    const char *endpoint;
+    const char *bucket;
+    int in_process;
+    int workloads[BENCH_MAX_LIST];
+    int workload_count;
+    uint64_t sizes[BENCH_MAX_LIST];
+    int size_count;
+    unsigned int threads[BENCH_MAX_LIST];
+    int thread_count;
+    unsigned int ops;
+    unsigned int keyspace;
+    unsigned int mix[BENCH_WORKLOAD_BUTT];    // mixed负载中各操作的权重
+    unsigned int mix_total;
+    uint64_t part_size;
+    unsigned int batch;
+    int json;
+    obs_stub_server_config server;            // 内置stub服务的时延/限速/故障参数
+} bench_config;
+
+typedef struct bench_scenario
+{
+    const bench_config *config;
+    obs_options options;
+    bench_workload workload;
+    uint64_t size;
+    unsigned int threads;
+    unsigned int ops;
+    char prefix[BENCH_PREFIX_SIZE];
+    char upload_path[BENCH_PREFIX_SIZE];
+    const char *payload;
+    volatile unsigned int next_op;
+    volatile unsigned int errors;
+    volatile uint64_t bytes;
+    uint64_t *latency_us;
+    obs_status first_error;
+} bench_scenario;
+
+/**
+ * 单次调用的回调状态
+ */
+typedef struct bench_call
+{
+    obs_status status;
+    const char *payload;
+    uint64_t size;
+    uint64_t offset;
+    uint64_t bytes;
+} bench_call;
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static double cpu_seconds(void)
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (double)usage.ru_utime.tv_sec + (double)usage.ru_utime.tv_usec / 1e6 +
+        (double)usage.ru_stime.tv_sec + (double)usage.ru_stime.tv_usec / 1e6;
+}
+
+/***************************************回调*******************************************/
+
+static obs_status bench_properties_callback(const obs_response_properties *properties, void *callback_data)
+{
+    (void)properties;
+    (void)callback_data;
+    return OBS_STATUS_OK;
+}
+
+static void bench_complete_callback(obs_status status, const obs_error_details *error, void *callback_data)
+{
+    bench_call *call = (bench_call *)callback_data;
+    (void)error;
+    if (call->status == OBS_STATUS_OK) {
+        call->status = status;
+    }
+}
+
+static int bench_put_data_callback(int buffer_size, char *buffer, void *callback_data)
+{
+    bench_call *call = (bench_call *)callback_data;
+    uint64_t left = call->size - call->offset;
+    int len = left < (uint64_t)buffer_size ? (int)left : buffer_size;
+    if (len > 0) {
+        memcpy(buffer, call->payload + call->offset, (size_t)len);
+        call->offset += (uint64_t)len;
+    }
+    return len;
+}
+
+static obs_status bench_get_data_callback(int buffer_size, const char *buffer, void *callback_data)
+{
+    bench_call *call = (bench_call *)callback_data;
+    (void)buffer;
+    call->bytes += (uint64_t)buffer_size;
+    return OBS_STATUS_OK;
+}
+
+static obs_status bench_list_callback(int is_truncated, const char *next_marker, int contents_count,
+    const obs_list_objects_content *contents, int common_prefixes_count, const char **common_prefixes,
+    void *callback_data)
+{
+    (void)is_truncated;
+    (void)next_marker;
+    (void)contents;
+    (void)common_prefixes_count;
+    (void)common_prefixes;
+    ((bench_call *)callback_data)->bytes += (uint64_t)contents_count;
+    return OBS_STATUS_OK;
+}
+
+static obs_status bench_delete_data_callback(int contents_count, obs_delete_objects *contents, void *callback_data)
+{
+    (void)contents_count;
+    (void)contents;
+    (void)callback_data;
+    return OBS_STATUS_OK;
+}
+
+static void bench_upload_file_callback(obs_status status, char *result_message, int part_count_return,
+    obs_upload_file_part_info *upload_info_list, void *callback_data)
+{
+    (void)result_message;
+    (void)part_count_return;
+    (void)upload_info_list;
+    bench_complete_callback(status, NULL, callback_data);
+}
+
+static void bench_download_file_callback(obs_status status, char *result_message, int part_count_return,
+    obs_download_file_part_info *download_info_list, void *callback_data)
+{
+    (void)result_message;
+    (void)part_count_return;
+    (void)download_info_list;
+    bench_complete_callback(status, NULL, callback_data);
+}
+
+/***************************************单次操作*******************************************/
+
+static obs_status bench_put(bench_scenario *scenario, char *key, uint64_t size)
+{
+    obs_put_object_handler handler = {
+        {&bench_properties_callback, &bench_complete_callback}, &bench_put_data_callback, NULL
+    };
+    bench_call call = {OBS_STATUS_OK, scenario->payload, size, 0, 0};
+    put_object(&scenario->options, key, size, NULL, NULL, &handler, &call);
+    return call.status;
+}
+
+static obs_status bench_get(bench_scenario *scenario, char *key)
+{
+    obs_get_object_handler handler = {
+        {&bench_properties_callback, &bench_complete_callback}, &bench_get_data_callback
+    };
+    obs_object_info object_info = {key, NULL};
+    bench_call call = {OBS_STATUS_OK, NULL, 0, 0, 0};
+    get_object(&scenario->options, &object_info, NULL, NULL, &handler, &call);
+    return call.status;
+}
+
+static obs_status bench_head(bench_scenario *scenario, char *key)
+{
+    obs_response_handler handler = {&bench_properties_callback, &bench_complete_callback};
+    bench_call call = {OBS_STATUS_OK, NULL, 0, 0, 0};
+    obs_head_object(&scenario->options, key, &handler, &call);
+    return call.status;
+}
+
+static obs_status bench_list(bench_scenario *scenario)
+{
+    obs_list_objects_handler handler = {
+        {&bench_properties_callback, &bench_complete_callback}, &bench_list_callback
+    };
+    bench_call call = {OBS_STATUS_OK, NULL, 0, 0, 0};
+    list_bucket_objects(&scenario->options, scenario->prefix, NULL, NULL, 1000, &handler, &call);
+    return call.status;
+}
+
+static obs_status bench_delete(bench_scenario *scenario, char *key)
+{
+    obs_response_handler handler = {&bench_properties_callback, &bench_complete_callback};
+    obs_object_info object_info = {key, NULL};
+    bench_call call = {OBS_STATUS_OK, NULL, 0, 0, 0};
+    delete_object(&scenario->options, &object_info, &handler, &call);
+    return call.status;
+}
+
+static obs_status bench_upload_file(bench_scenario *scenario, char *key)
+{
+    obs_upload_file_configuration upload_config;
+    obs_upload_file_server_callback server_callback;
+    obs_upload_file_response_handler handler = {
+        {&bench_properties_callback, &bench_complete_callback}, &bench_upload_file_callback, NULL
+    };
+    bench_call call = {OBS_STATUS_OK, NULL, 0, 0, 0};
+    int pause_flag = 0;
+
+    memset(&upload_config, 0, sizeof(upload_config));
+    memset(&server_callback, 0, sizeof(server_callback));
+    upload_config.upload_file = scenario->upload_path;
+    upload_config.part_size = scenario->config->part_size;
+    upload_config.task_num = 1;
+    upload_config.pause_upload_flag = &pause_flag;
+    upload_file(&scenario->options, key, NULL, &upload_config, server_callback, &handler, &call);
+    return call.status;
+}
+
+static obs_status bench_put_stream(bench_scenario *scenario, char *key)
+{
+    obs_put_object_stream_configuration stream_config;
+    obs_put_object_stream_summary summary;
+    bench_call call = {OBS_STATUS_OK, scenario->payload, scenario->size, 0, 0};
+
+    init_put_object_stream_configuration(&stream_config);
+    stream_config.read_callback = &bench_put_data_callback;
+    stream_config.callback_data = &call;
+    stream_config.part_size = scenario->config->part_size;
+    return put_object_stream(&scenario->options, key, &stream_config, &summary);
+}
+
+static obs_status bench_get_stream(bench_scenario *scenario, char *key)
+{
+    obs_get_object_stream_configuration stream_config;
+    obs_get_object_stream_summary summary;
+    bench_call call = {OBS_STATUS_OK, NULL, 0, 0, 0};
+
+    init_get_object_stream_configuration(&stream_config);
+    stream_config.write_callback = &bench_get_data_callback;
+    stream_config.callback_data = &call;
+    stream_config.part_size = scenario->config->part_size;
+    return get_object_stream(&scenario->options, key, &stream_config, &summary);
+}
+
+static obs_status bench_download_file(bench_scenario *scenario, char *key, unsigned int op)
+{
+    obs_download_file_configuration download_config;
+    obs_download_file_response_handler handler = {
+        {&bench_properties_callback, &bench_complete_callback}, &bench_download_file_callback
+    };
+    obs_get_conditions get_conditions;
+    bench_call call = {OBS_STATUS_OK, NULL, 0, 0, 0};
+    char path[BENCH_PATH_SIZE];
+
+    snprintf(path, sizeof(path), "%s.get%u", scenario->upload_path, op);
+    init_get_properties(&get_conditions);
+    memset(&download_config, 0, sizeof(download_config));
+    download_config.downLoad_file = path;
+    download_config.part_size = scenario->config->part_size;
+    download_config.task_num = 1;
+    (void)unlink(path);
+    download_file(&scenario->options, key, NULL, &get_conditions, NULL, &download_config, &handler, &call);
+    (void)unlink(path);
+    return call.status;
+}
+
+static obs_status bench_batch_delete(bench_scenario *scenario, unsigned int op)
+{
+    obs_delete_object_handler handler = {
+        {&bench_properties_callback, &bench_complete_callback}, &bench_delete_data_callback
+    };
+    unsigned int batch = scenario->config->batch;
+    obs_object_info *objects = (obs_object_info *)calloc(batch, sizeof(obs_object_info));
+    char *keys = (char *)malloc((size_t)batch * BENCH_KEY_SIZE);
+    obs_delete_object_info delete_info = {batch, 1};
+    bench_call call = {OBS_STATUS_OK, NULL, 0, 0, 0};
+    unsigned int i;
+
+    if (objects == NULL || keys == NULL) {
+        free(objects);
+        free(keys);
+        return OBS_STATUS_OutOfMemory;
+    }
+    for (i = 0; i < batch; i++) {
+        objects[i].key = keys + (size_t)i * BENCH_KEY_SIZE;
+        snprintf(objects[i].key, BENCH_KEY_SIZE, "%sdel-%08u", scenario->prefix, op * batch + i);
+    }
+    batch_delete_objects(&scenario->options, objects, &delete_info, NULL, &handler, &call);
+    free(objects);
+    free(keys);
+    return call.status;
+}
+
+static obs_status bench_presign(bench_scenario *scenario, char *key)
+{
+    obs_temp_url_params params;
+    obs_temp_url_result result;
+    init_temp_url_params(&params);
+    params.key = key;
+    params.expires = 300;
+    return create_presigned_url(&scenario->options, &params, &result);
+}
+
+/**
+ * mixed负载中按权重确定第op个操作的类型
+ */
+static bench_workload bench_mixed_choice(const bench_config *config, unsigned int op)
+{
+    unsigned int pick = (unsigned int)(((uint64_t)op * 2654435761u) % config->mix_total);
+    int i;
+    for (i = 0; i < BENCH_WORKLOAD_BUTT; i++) {
+        if (pick < config->mix[i]) {
+            return (bench_workload)i;
+        }
+        pick -= config->mix[i];
+    }
+    return BENCH_GET;
+}
+
+static obs_status bench_run_op(bench_scenario *scenario, bench_workload workload, unsigned int op,
+    uint64_t *bytes)
+{
+    char key[BENCH_KEY_SIZE];
+    obs_status status = OBS_STATUS_OK;
+    unsigned int slot = op % scenario->config->keyspace;
+
+    switch (workload) {
+        case BENCH_PUT:
+            snprintf(key, sizeof(key), "%sput-%08u", scenario->prefix, op);
+            status = bench_put(scenario, key, scenario->size);
+            *bytes = scenario->size;
+            break;
+        case BENCH_GET:
+            snprintf(key, sizeof(key), "%sobj-%08u", scenario->prefix, slot);
+            status = bench_get(scenario, key);
+            *bytes = scenario->size;
+            break;
+        case BENCH_HEAD:
+            snprintf(key, sizeof(key), "%sobj-%08u", scenario->prefix, slot);
+            status = bench_head(scenario, key);
+            break;
+        case BENCH_LIST:
+            status = bench_list(scenario);
+            break;
+        case BENCH_DELETE:
+            snprintf(key, sizeof(key), "%sdel-%08u", scenario->prefix, op);
+            status = bench_delete(scenario, key);
+            break;
+        case BENCH_UPLOAD_FILE:
+            snprintf(key, sizeof(key), "%sfile-%08u", scenario->prefix, op);
+            status = bench_upload_file(scenario, key);
+            *bytes = scenario->size;
+            break;
+        case BENCH_PUT_STREAM:
+            snprintf(key, sizeof(key), "%sstream-%08u", scenario->prefix, op);
+            status = bench_put_stream(scenario, key);
+            *bytes = scenario->size;
+            break;
+        case BENCH_GET_STREAM:
+            snprintf(key, sizeof(key), "%sobj-%08u", scenario->prefix, slot);
+            status = bench_get_stream(scenario, key);
+            *bytes = scenario->size;
+            break;
+        case BENCH_DOWNLOAD_FILE:
+            snprintf(key, sizeof(key), "%sobj-%08u", scenario->prefix, slot);
+            status = bench_download_file(scenario, key, op);
+            *bytes = scenario->size;
+            break;
+        case BENCH_BATCH_DELETE:
+            status = bench_batch_delete(scenario, op);
+            break;
+        case BENCH_PRESIGN:
+            snprintf(key, sizeof(key), "%sobj-%08u", scenario->prefix, slot);
+            status = bench_presign(scenario, key);
+            break;
+        case BENCH_MIXED:
+            status = bench_run_op(scenario, bench_mixed_choice(scenario->config, op), op, bytes);
+            break;
+        default:
+            status = OBS_STATUS_InvalidParameter;
+            break;
+    }
+    return status;
+}
+
+/***************************************场景执行*******************************************/
+
+static void *bench_worker(void *arg)
+{
+    bench_scenario *scenario = (bench_scenario *)arg;
+    for (;;) {
+        unsigned int op = __sync_fetch_and_add(&scenario->next_op, 1);
+        uint64_t bytes = 0;
+        double start;
+        obs_status status;
+        if (op >= scenario->ops) {
+            break;
+        }
+        start = now_seconds();
+        status = bench_run_op(scenario, scenario->workload, op, &bytes);
+        scenario->latency_us[op] = (uint64_t)((now_seconds() - start) * 1e6);
+        if (status == OBS_STATUS_OK) {
+            __sync_fetch_and_add(&scenario->bytes, bytes);
+        }
+        else if (__sync_fetch_and_add(&scenario->errors, 1) == 0) {
+            scenario->first_error = status;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * 启动threads个线程并发执行scenario->ops个操作
+ */
+static void bench_parallel(bench_scenario *scenario, unsigned int threads)
+{
+    pthread_t *thread_ids = (pthread_t *)calloc(threads, sizeof(pthread_t));
+    unsigned int i;
+    scenario->next_op = 0;
+    for (i = 0; i < threads; i++) {
+        if (pthread_create(&thread_ids[i], NULL, bench_worker, scenario) != 0) {
+            thread_ids[i] = 0;
+        }
+    }
+    for (i = 0; i < threads; i++) {
+        if (thread_ids[i]) {
+            pthread_join(thread_ids[i], NULL);
+        }
+    }
+    free(thread_ids);
+}
+
+static int bench_prepare_file(bench_scenario *scenario)
+{
+    FILE *file;
+    uint64_t left = scenario->size;
+    snprintf(scenario->upload_path, sizeof(scenario->upload_path), "/tmp/obs_bench_%d_%llu",
+        (int)getpid(), (unsigned long long)scenario->size);
+    file = fopen(scenario->upload_path, "wb");
+    if (file == NULL) {
+        return -1;
+    }
+    while (left > 0) {
+        size_t chunk = left > scenario->size ? (size_t)scenario->size : (size_t)left;
+        if (fwrite(scenario->payload, 1, chunk, file) != chunk) {
+            fclose(file);
+            return -1;
+        }
+        left -= chunk;
+    }
+    return fclose(file);
+}
+
+/**
+ * 准备阶段写对象，失败时重试，以免stub服务注入的故障影响准备
+ */
+static obs_status bench_prepare_put(bench_scenario *scenario, char *key, uint64_t size)
+{
+    obs_status status = OBS_STATUS_OK;
+    int attempt;
+    for (attempt = 0; attempt < BENCH_PREPARE_ATTEMPTS; attempt++) {
+        if ((status = bench_put(scenario, key, size)) == OBS_STATUS_OK) {
+            break;
+        }
+    }
+    return status;
+}
+
+/**
+ * 准备阶段：按负载预先写入对象
+ */
+static int bench_prepare(bench_scenario *scenario)
+{
+    unsigned int batch = scenario->config->batch;
+    bench_workload workload = scenario->workload;
+    int need_objects = workload == BENCH_GET || workload == BENCH_HEAD || workload == BENCH_LIST ||
+        workload == BENCH_DOWNLOAD_FILE || workload == BENCH_MIXED || workload == BENCH_GET_STREAM;
+    unsigned int i;
+
+    if (workload == BENCH_UPLOAD_FILE || workload == BENCH_DOWNLOAD_FILE) {
+        if (bench_prepare_file(scenario) != 0) {
+            fprintf(stderr, "failed to create %s\n", scenario->upload_path);
+            return -1;
+        }
+    }
+    if (workload == BENCH_PRESIGN) {
+        return 0;
+    }
+
+    scenario->errors = 0;
+    if (need_objects) {
+        char key[BENCH_KEY_SIZE];
+        for (i = 0; i < scenario->config->keyspace; i++) {
+            snprintf(key, sizeof(key), "%sobj-%08u", scenario->prefix, i);
+            if (bench_prepare_put(scenario, key, scenario->size) != OBS_STATUS_OK) {
+                scenario->errors++;
+            }
+        }
+    }
+    if (workload == BENCH_DELETE || workload == BENCH_BATCH_DELETE || workload == BENCH_MIXED) {
+        unsigned int count = workload == BENCH_BATCH_DELETE ? scenario->ops * batch : scenario->ops;
+        char key[BENCH_KEY_SIZE];
+        for (i = 0; i < count; i++) {
+            snprintf(key, sizeof(key), "%sdel-%08u", scenario->prefix, i);
+            if (bench_prepare_put(scenario, key, workload == BENCH_MIXED ? scenario->size : 0) != OBS_STATUS_OK) {
+                scenario->errors++;
+            }
+        }
+    }
+    if (scenario->errors) {
+        fprintf(stderr, "prepare %s: %u puts failed\n", g_workload_names[workload], scenario->errors);
+        return -1;
+    }
+    return 0;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static uint64_t percentile(const uint64_t *sorted, unsigned int count, double p)
+{
+    unsigned int index;
+    if (count == 0) {
+        return 0;
+    }
+    index = (unsigned int)(p / 100.0 * (double)count + 0.5);
+    if (index > 0) {
+        index--;
+    }
+    return sorted[index < count ? index : count - 1];
+}
+
+static void bench_report(const bench_scenario *scenario, double seconds, double cpu,
+    const obs_metrics_snapshot *before, const obs_metrics_snapshot *after)
+{
+    uint64_t *sorted = scenario->latency_us;
+    double ops_per_sec = seconds > 0 ? (double)scenario->ops / seconds : 0;
+    double mb_per_sec = seconds > 0 ? (double)scenario->bytes / seconds / (1024.0 * 1024.0) : 0;
+    double cpu_us_per_op = scenario->ops ? cpu * 1e6 / (double)scenario->ops : 0;
+    uint64_t max_us;
+    char cpu_text[32];
+    uint64_t created = after->connections_created - before->connections_created;
+    uint64_t reused = after->connections_reused - before->connections_reused;
+
+    qsort(sorted, scenario->ops, sizeof(uint64_t), compare_u64);
+    max_us = scenario->ops ? sorted[scenario->ops - 1] : 0;
+    // cpu小于0表示无法单独统计客户端的CPU时间
+    if (cpu < 0) {
+        snprintf(cpu_text, sizeof(cpu_text), scenario->config->json ? "null" : "n/a");
+    }
+    else {
+        snprintf(cpu_text, sizeof(cpu_text), scenario->config->json ? "%.2f" : "%.1fus/op", cpu_us_per_op);
+    }
+    if (scenario->config->json) {
+        printf("{\"workload\":\"%s\",\"size\":%llu,\"threads\":%u,\"ops\":%u,\"errors\":%u,"
+            "\"first_error\":\"%s\",\"seconds\":%.6f,\"ops_per_sec\":%.1f,\"mb_per_sec\":%.3f,"
+            "\"p50_us\":%llu,\"p99_us\":%llu,\"p999_us\":%llu,\"max_us\":%llu,\"cpu_us_per_op\":%s,"
+            "\"connections_created\":%llu,\"connections_reused\":%llu}\n",
+            g_workload_names[scenario->workload], (unsigned long long)scenario->size, scenario->threads,
+            scenario->ops, scenario->errors, obs_get_status_name(scenario->first_error), seconds, ops_per_sec,
+            mb_per_sec, (unsigned long long)percentile(sorted, scenario->ops, 50),
+            (unsigned long long)percentile(sorted, scenario->ops, 99),
+            (unsigned long long)percentile(sorted, scenario->ops, 99.9),
+            (unsigned long long)max_us, cpu_text,
+            (unsigned long long)created, (unsigned long long)reused);
+    }
+    else {
+        printf("%-14s size=%-10llu threads=%-3u ops=%-7u err=%-4u %10.1f ops/s %9.3f MB/s "
+            "p50=%lluus p99=%lluus p999=%lluus cpu=%s conn=%llu/%llu\n",
+            g_workload_names[scenario->workload], (unsigned long long)scenario->size, scenario->threads,
+            scenario->ops, scenario->errors, ops_per_sec, mb_per_sec,
+            (unsigned long long)percentile(sorted, scenario->ops, 50),
+            (unsigned long long)percentile(sorted, scenario->ops, 99),
+            (unsigned long long)percentile(sorted, scenario->ops, 99.9), cpu_text,
+            (unsigned long long)created, (unsigned long long)reused);
+    }
+    fflush(stdout);
+}
+
+static int bench_run_scenario(const bench_config *config, const obs_options *options, const char *payload,
+    bench_workload workload, uint64_t size, unsigned int threads, unsigned int index)
+{
+    bench_scenario scenario;
+    obs_metrics_snapshot *before = (obs_metrics_snapshot *)malloc(sizeof(obs_metrics_snapshot));
+    obs_metrics_snapshot *after = (obs_metrics_snapshot *)malloc(sizeof(obs_metrics_snapshot));
+    double start;
+    double cpu_start;
+    double seconds;
+    double cpu;
+    int ret = 0;
+
+    memset(&scenario, 0, sizeof(scenario));
+    scenario.config = config;
+    scenario.options = *options;
+    scenario.workload = workload;
+    scenario.size = size;
+    scenario.threads = threads;
+    scenario.ops = config->ops;
+    scenario.payload = payload;
+    scenario.first_error = OBS_STATUS_OK;
+    snprintf(scenario.prefix, sizeof(scenario.prefix), "bench/%d-%u-%s/", (int)getpid(), index,
+        g_workload_names[workload]);
+    scenario.latency_us = (uint64_t *)calloc(scenario.ops, sizeof(uint64_t));
+    if (scenario.latency_us == NULL || before == NULL || after == NULL) {
+        free(scenario.latency_us);
+        free(before);
+        free(after);
+        return -1;
+    }
+
+    if (bench_prepare(&scenario) != 0) {
+        ret = -1;
+    }
+    else {
+        scenario.errors = 0;
+        obs_get_metrics_snapshot(before);
+        cpu_start = cpu_seconds();
+        start = now_seconds();
+        bench_parallel(&scenario, threads);
+        seconds = now_seconds() - start;
+        // 进程内stub服务的线程也计入RUSAGE_SELF，此时不统计CPU
+        cpu = config->in_process ? -1 : cpu_seconds() - cpu_start;
+        obs_get_metrics_snapshot(after);
+        bench_report(&scenario, seconds, cpu, before, after);
+        ret = scenario.errors ? -1 : 0;
+    }
+    if (scenario.upload_path[0]) {
+        (void)unlink(scenario.upload_path);
+    }
+    free(scenario.latency_us);
+    free(before);
+    free(after);
+    return ret;
+}
+
+/***************************************参数解析*******************************************/
+
+static uint64_t parse_size(const char *text)
+{
+    char *end = NULL;
+    uint64_t value = strtoull(text, &end, 10);
+    if (end && (*end == 'k' || *end == 'K')) {
+        value <<= 10;
+    }
+    else if (end && (*end == 'm' || *end == 'M')) {
+        value <<= 20;
+    }
+    else if (end && (*end == 'g' || *end == 'G')) {
+        value <<= 30;
+    }
+    return value;
+}
+
+static int parse_workload(const char *name)
+{
+    int i;
+    for (i = 0; i < BENCH_WORKLOAD_BUTT; i++) {
+        if (!strcmp(name, g_workload_names[i])) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * 逐项解析逗号分隔的列表，返回项数，出错返回-1
+ */
+static int parse_list(const char *text, int (*parse_item)(const char *item, int index, void *out), void *out)
+{
+    char buffer[1024];
+    char *save = NULL;
+    char *item;
+    int count = 0;
+    snprintf(buffer, sizeof(buffer), "%s", text);
+    for (item = strtok_r(buffer, ",", &save); item; item = strtok_r(NULL, ",", &save)) {
+        if (count == BENCH_MAX_LIST || parse_item(item, count, out) != 0) {
+            return -1;
+        }
+        count++;
+    }
+    return count;
+}
+
+static int parse_workload_item(const char *item, int index, void *out)
+{
+    int workload = parse_workload(item);
+    ((int *)out)[index] = workload;
+    return workload < 0 ? -1 : 0;
+}
+
+static int parse_size_item(const char *item, int index, void *out)
+{
+    ((uint64_t *)out)[index] = parse_size(item);
+    return 0;
+}
+
+static int parse_thread_item(const char *item, int index, void *out)
+{
+    unsigned int threads = (unsigned int)strtoul(item, NULL, 10);
+    ((unsigned int *)out)[index] = threads;
+    return threads == 0 ? -1 : 0;
+}
+
+static int parse_mix_item(const char *item, int index, void *out)
+{
+    bench_config *config = (bench_config *)out;
+    char name[64];
+    const char *eq = strchr(item, '=');
+    int workload;
+    (void)index;
+    if (eq == NULL || (size_t)(eq - item) >= sizeof(name)) {
+        return -1;
+    }
+    snprintf(name, sizeof(name), "%.*s", (int)(eq - item), item);
+    workload = parse_workload(name);
+    if (workload < 0 || workload == BENCH_MIXED || workload == BENCH_BATCH_DELETE ||
+        workload == BENCH_UPLOAD_FILE || workload == BENCH_DOWNLOAD_FILE || workload == BENCH_PUT_STREAM ||
+        workload == BENCH_GET_STREAM) {
+        return -1;
+    }
+    config->mix[workload] = (unsigned int)strtoul(eq + 1, NULL, 10);
+    return 0;
+}
+
+/**
+ * 时延格式：fixed:US、uniform:MIN-MAX、exp:MEAN[-MAX]
+ */
+static int parse_latency(const char *text, obs_stub_server_config *server)
+{
+    const char *value = strchr(text, ':');
+    char *end = NULL;
+    if (value == NULL) {
+        return -1;
+    }
+    value++;
+    if (!strncmp(text, "fixed:", 6)) {
+        server->latency_type = OBS_STUB_LATENCY_FIXED;
+        server->latency_us = (unsigned int)strtoul(value, &end, 10);
+    }
+    else if (!strncmp(text, "uniform:", 8)) {
+        server->latency_type = OBS_STUB_LATENCY_UNIFORM;
+        server->latency_min_us = (unsigned int)strtoul(value, &end, 10);
+        server->latency_max_us = *end == '-' ? (unsigned int)strtoul(end + 1, &end, 10) : server->latency_min_us;
+    }
+    else if (!strncmp(text, "exp:", 4)) {
+        server->latency_type = OBS_STUB_LATENCY_EXPONENTIAL;
+        server->latency_us = (unsigned int)strtoul(value, &end, 10);
+        server->latency_max_us = *end == '-' ? (unsigned int)strtoul(end + 1, &end, 10) : 0;
+    }
+    else {
+        return -1;
+    }
+    return *end == '\0' ? 0 : -1;
+}
+
+static int parse_fault_item(const char *item, int index, void *out)
+{
+    obs_stub_server_config *server = (obs_stub_server_config *)out;
+    const char *eq = strchr(item, '=');
+    double rate;
+    (void)index;
+    if (eq == NULL) {
+        return -1;
+    }
+    rate = strtod(eq + 1, NULL);
+    if (!strncmp(item, "error=", 6)) {
+        server->error_rate = rate;
+    }
+    else if (!strncmp(item, "slowdown=", 9)) {
+        server->slowdown_rate = rate;
+    }
+    else if (!strncmp(item, "reset=", 6)) {
+        server->reset_rate = rate;
+    }
+    else if (!strncmp(item, "truncate=", 9)) {
+        server->truncate_rate = rate;
+    }
+    else {
+        return -1;
+    }
+    return 0;
+}
+
+static void usage(const char *program)
+{
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  -e host:port   benchmark an external endpoint instead of the built-in stub server\n"
+        "  -T             run the stub server in this process (default: child process);\n"
+        "                 CPU per op is not reported since it would include the server threads\n"
+        "  -b bucket      bucket name (default obs-bench)\n"
+        "  -w workloads   comma list of put,get,head,list,delete,mixed,upload_file,download_file,\n"
+        "                 batch_delete,presign,put_stream,get_stream (default put,get,head,list,delete)\n"
+        "  -s sizes       comma list of object sizes, K/M/G suffixes allowed (default 4K)\n"
+        "  -c threads     comma list of concurrency levels (default 1,8)\n"
+        "  -n ops         operations per scenario (default %u)\n"
+        "  -k keys        objects prepared for get/head/list/download_file/get_stream (default %u)\n"
+        "  -x mix         weights for mixed, e.g. get=70,put=20,head=10 (default)\n"
+        "  -p part_size   part size for upload_file/download_file/put_stream/get_stream (default 5M)\n"
+        "  -B batch       keys per batch_delete request (default %u)\n"
+        "  -o format      json (default) or text\n"
+        "  -L latency     stub server latency: fixed:US, uniform:MIN-MAX or exp:MEAN[-MAX]\n"
+        "  -R bandwidth   stub server bandwidth per connection and direction, bytes/s (K/M/G)\n"
+        "  -F faults      stub server fault rates, e.g. error=0.01,slowdown=0.01,reset=0.001,truncate=0.001\n"
+        "  -S seed        stub server random seed\n",
+        program, BENCH_DEFAULT_OPS, BENCH_DEFAULT_KEYSPACE, BENCH_DEFAULT_BATCH);
+}
+
+static int parse_args(int argc, char *argv[], bench_config *config)
+{
+    int opt;
+    int i;
+    memset(config, 0, sizeof(bench_config));
+    config->bucket = "obs-bench";
+    config->ops = BENCH_DEFAULT_OPS;
+    config->keyspace = BENCH_DEFAULT_KEYSPACE;
+    config->part_size = BENCH_DEFAULT_PART_SIZE;
+    config->batch = BENCH_DEFAULT_BATCH;
+    config->json = 1;
+    obs_stub_server_init_config(&config->server);
+    config->workload_count = parse_list("put,get,head,list,delete", parse_workload_item, config->workloads);
+    config->size_count = parse_list("4K", parse_size_item, config->sizes);
+    config->thread_count = parse_list("1,8", parse_thread_item, config->threads);
+    (void)parse_list("get=70,put=20,head=10", parse_mix_item, config);
+
+    while ((opt = getopt(argc, argv, "e:Tb:w:s:c:n:k:x:p:B:o:L:R:F:S:h")) != -1) {
+        switch (opt) {
+            case 'e': config->endpoint = optarg; break;
+            case 'T': config->in_process = 1; break;
+            case 'b': config->bucket = optarg; break;
+            case 'w': config->workload_count = parse_list(optarg, parse_workload_item, config->workloads); break;
+            case 's': config->size_count = parse_list(optarg, parse_size_item, config->sizes); break;
+            case 'c': config->thread_count = parse_list(optarg, parse_thread_item, config->threads); break;
+            case 'n': config->ops = (unsigned int)strtoul(optarg, NULL, 10); break;
+            case 'k': config->keyspace = (unsigned int)strtoul(optarg, NULL, 10); break;
+            case 'x':
+                memset(config->mix, 0, sizeof(config->mix));
+                if (parse_list(optarg, parse_mix_item, config) < 0) {
+                    return -1;
+                }
+                break;
+            case 'p': config->part_size = parse_size(optarg); break;
+            case 'B': config->batch = (unsigned int)strtoul(optarg, NULL, 10); break;
+            case 'o': config->json = strcmp(optarg, "text") != 0; break;
+            case 'L':
+                if (parse_latency(optarg, &config->server) != 0) {
+                    return -1;
+                }
+                break;
+            case 'R': config->server.bandwidth = parse_size(optarg); break;
+            case 'F':
+                if (parse_list(optarg, parse_fault_item, &config->server) < 0) {
+                    return -1;
+                }
+                break;
+            case 'S': config->server.seed = (unsigned int)strtoul(optarg, NULL, 10); break;
+            default: return -1;
+        }
+    }
+    config->mix_total = 0;
+    for (i = 0; i < BENCH_WORKLOAD_BUTT; i++) {
+        config->mix_total += config->mix[i];
+    }
+    if (config->workload_count <= 0 || config->size_count <= 0 || config->thread_count <= 0 ||
+        config->ops == 0 || config->keyspace == 0 || config->mix_total == 0 ||
+        config->batch == 0 || config->batch > OBS_MAX_DELETE_OBJECT_NUMBER) {
+        return -1;
+    }
+    return 0;
+}
+
+/***************************************stub服务*******************************************/
+
+/**
+ * 在子进程中运行stub服务，通过管道返回端口；返回子进程号，失败返回-1
+ */
+static pid_t start_stub_child(const obs_stub_server_config *server_config, unsigned short *port)
+{
+    int fds[2];
+    pid_t pid;
+    if (pipe(fds) != 0) {
+        return -1;
+    }
+    pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        obs_stub_server *server = NULL;
+        unsigned short child_port = 0;
+        close(fds[0]);
+        if (obs_stub_server_start(server_config, &server) == 0) {
+            child_port = obs_stub_server_port(server);
+        }
+        if (write(fds[1], &child_port, sizeof(child_port)) != (ssize_t)sizeof(child_port) || child_port == 0) {
+            _exit(1);
+        }
+        close(fds[1]);
+        for (;;) {
+            pause();
+        }
+    }
+    close(fds[1]);
+    if (read(fds[0], port, sizeof(*port)) != (ssize_t)sizeof(*port) || *port == 0) {
+        close(fds[0]);
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+        return -1;
+    }
+    close(fds[0]);
+    return pid;
+}
+
+int main(int argc, char *argv[])
+{
+    bench_config config;
+    obs_options options;
+    obs_stub_server *server = NULL;
+    pid_t child = -1;
+    char endpoint[64];
+    char *payload;
+    uint64_t max_size = 0;
+    unsigned int index = 0;
+    int failed = 0;
+    int w;
+    int s;
+    int t;
+
+    if (parse_args(argc, argv, &config) != 0) {
+        usage(argv[0]);
+        return 2;
+    }
+    for (s = 0; s < config.size_count; s++) {
+        max_size = config.sizes[s] > max_size ? config.sizes[s] : max_size;
+    }
+    payload = (char *)malloc(max_size ? (size_t)max_size : 1);
+    if (payload == NULL) {
+        fprintf(stderr, "malloc payload failed\n");
+        return 1;
+    }
+    for (uint64_t i = 0; i < max_size; i++) {
+        payload[i] = (char)('a' + (i * 7 + i / 251) % 26);
+    }
+
+    // stub服务需在obs_initialize之前fork
+    if (config.endpoint == NULL) {
+        unsigned short port = 0;
+        if (config.in_process) {
+            if (obs_stub_server_start(&config.server, &server) == 0) {
+                port = obs_stub_server_port(server);
+            }
+        }
+        else {
+            child = start_stub_child(&config.server, &port);
+        }
+        if (port == 0) {
+            fprintf(stderr, "failed to start stub server\n");
+            free(payload);
+            return 1;
+        }
+        snprintf(endpoint, sizeof(endpoint), "127.0.0.1:%u", port);
+        config.endpoint = endpoint;
+    }
+
+    if (obs_initialize(OBS_INIT_ALL) != OBS_STATUS_OK) {
+        fprintf(stderr, "obs_initialize failed\n");
+        failed = 1;
+    }
+    else {
+        obs_metrics_enable(1);
+        init_obs_options(&options);
+        options.bucket_options.host_name = (char *)config.endpoint;
+        options.bucket_options.bucket_name = (char *)config.bucket;
+        options.bucket_options.access_key = "BENCHACCESSKEYID0000";
+        options.bucket_options.secret_access_key = "BenchSecretAccessKey0000000000000000000";
+        options.bucket_options.protocol = OBS_PROTOCOL_HTTP;
+        options.bucket_options.uri_style = OBS_URI_STYLE_PATH;
+
+        for (w = 0; w < config.workload_count; w++) {
+            for (s = 0; s < config.size_count; s++) {
+                for (t = 0; t < config.thread_count; t++) {
+                    if (bench_run_scenario(&config, &options, payload, (bench_workload)config.workloads[w],
+                        config.sizes[s], config.threads[t], index++) != 0) {
+                        failed = 1;
+                    }
+                }
+            }
+        }
+        obs_deinitialize();
+    }
+
+    if (server) {
+        obs_stub_server_stop(server);
+    }
+    if (child > 0) {
+        kill(child, SIGTERM);
+        waitpid(child, NULL, 0);
+    }
+    free(payload);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,2012 @@
+/*********************************************************************************
+* Copyright 2024 Huawei Technologies Co.,Ltd.
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+* this file except in compliance with the License.  You may obtain a copy of the
+* License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed
+* under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+* CONDITIONS OF ANY KIND, either express or implied.  See the License for the
+* specific language governing permissions and limitations under the License.
+**********************************************************************************/
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <strings.h>
+#include <errno.h>
+#include <time.h>
+#include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "obs_stub_server.h"
+
+#define STUB_IO_SIZE            65536
+#define STUB_LINE_SIZE          8192
+#define STUB_NAME_SIZE          2048
+#define STUB_HASH_BUCKETS       65536
+#define STUB_MAX_PARTS          10000
+#define STUB_DEFAULT_MAX_KEYS   1000
+#define STUB_FAULT_METHODS_SIZE 128
+#define STUB_META_SIZE          2048
+
+/**
+ * 对象数据只读共享，GET在锁外发送时持有引用
+ */
+typedef struct stub_object
+{
+    unsigned int refs;
+    char *data;
+    size_t size;
+    time_t mtime;
+    char etag[48];
+    char *headers;                            // 原样回显的Content-Encoding和自定义元数据头，可为NULL
+} stub_object;
+
+typedef struct stub_entry
+{
+    struct stub_entry *next;
+    char *name;                               // "bucket/key"
+    stub_object *object;
+} stub_entry;
+
+typedef struct stub_upload
+{
+    struct stub_upload *next;
+    char id[32];
+    char *name;
+    char *headers;                            // 初始化时携带的元数据，合并后转给对象
+    stub_object **parts;                      // 下标为段号
+    time_t initiated;
+} stub_upload;
+
+/**
+ * 令牌桶限速，令牌不足时记为欠额并休眠到还清
+ */
+typedef struct stub_shaper
+{
+    double tokens;
+    double last;
+} stub_shaper;
+
+typedef enum
+{
+    STUB_FAULT_NONE = 0,
+    STUB_FAULT_ERROR,
+    STUB_FAULT_SLOWDOWN,
+    STUB_FAULT_RESET,
+    STUB_FAULT_TRUNCATE
+} stub_fault;
+
+typedef struct stub_conn
+{
+    struct stub_conn *prev;
+    struct stub_conn *next;
+    obs_stub_server *server;
+    int fd;
+    uint64_t bandwidth;                       // 当前请求生效的限速
+    int truncate;                             // 本次响应体发送一半后断连
+    stub_shaper tx;
+    stub_shaper rx;
+    size_t pos;
+    size_t len;
+    char buf[STUB_IO_SIZE];
+} stub_conn;
+
+struct obs_stub_server
+{
+    obs_stub_server_config config;
+    int listen_fd;
+    unsigned short port;
+    int stopping;
+    pthread_t accept_thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t conn_cond;
+    stub_conn *conns;
+    stub_entry *table[STUB_HASH_BUCKETS];
+    stub_upload *uploads;
+    uint64_t next_upload_id;
+    uint64_t next_request_id;
+    uint64_t rng;
+    char fault_methods[STUB_FAULT_METHODS_SIZE];
+    obs_stub_server_stats stats;
+};
+
+typedef struct stub_request
+{
+    char method[16];
+    char bucket[256];
+    char key[STUB_NAME_SIZE];
+    char query[STUB_LINE_SIZE];
+    char range[128];
+    char if_match[128];
+    char if_none_match[128];
+    char copy_source[STUB_NAME_SIZE];
+    char copy_range[128];
+    char metadata_directive[32];
+    char meta[STUB_META_SIZE];                // "name: value\r\n"形式的元数据头
+    size_t meta_len;
+    long long content_length;
+    int chunked;
+    int expect_continue;
+    int keep_alive;
+    char *body;
+    size_t body_len;
+    char request_id[32];
+} stub_request;
+
+typedef struct stub_buffer
+{
+    char *data;
+    size_t len;
+    size_t cap;
+} stub_buffer;
+
+/***************************************字符串工具*******************************************/
+
+static void stub_buffer_append(stub_buffer *buffer, const char *data, size_t len)
+{
+    if (buffer->len + len + 1 > buffer->cap) {
+        size_t cap = buffer->cap ? buffer->cap : 1024;
+        char *grown;
+        while (cap < buffer->len + len + 1) {
+            cap *= 2;
+        }
+        grown = (char *)realloc(buffer->data, cap);
+        if (grown == NULL) {
+            return;
+        }
+        buffer->data = grown;
+        buffer->cap = cap;
+    }
+    memcpy(buffer->data + buffer->len, data, len);
+    buffer->len += len;
+    buffer->data[buffer->len] = '\0';
+}
+
+static void stub_buffer_printf(stub_buffer *buffer, const char *format, ...)
+{
+    char line[STUB_LINE_SIZE];
+    va_list args;
+    int len;
+    va_start(args, format);
+    len = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if (len > 0) {
+        stub_buffer_append(buffer, line, (size_t)len < sizeof(line) ? (size_t)len : sizeof(line) - 1);
+    }
+}
+
+static void stub_buffer_append_xml(stub_buffer *buffer, const char *text)
+{
+    for (; *text; text++) {
+        switch (*text) {
+            case '&': stub_buffer_append(buffer, "&amp;", 5); break;
+            case '<': stub_buffer_append(buffer, "&lt;", 4); break;
+            case '>': stub_buffer_append(buffer, "&gt;", 4); break;
+            case '"': stub_buffer_append(buffer, "&quot;", 6); break;
+            default: stub_buffer_append(buffer, text, 1); break;
+        }
+    }
+}
+
+static int stub_hex_value(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+static void stub_url_decode(const char *src, size_t src_len, char *dst, size_t dst_size)
+{
+    size_t out = 0;
+    size_t i;
+    for (i = 0; i < src_len && out + 1 < dst_size; i++) {
+        if (src[i] == '%' && i + 2 < src_len &&
+            stub_hex_value(src[i + 1]) >= 0 && stub_hex_value(src[i + 2]) >= 0) {
+            dst[out++] = (char)(stub_hex_value(src[i + 1]) * 16 + stub_hex_value(src[i + 2]));
+            i += 2;
+        }
+        else {
+            dst[out++] = src[i];
+        }
+    }
+    dst[out] = '\0';
+}
+
+/**
+ * 查询参数存在时返回1，value为URL解码后的值
+ */
+static int stub_query_get(const char *query, const char *name, char *value, size_t value_size)
+{
+    size_t name_len = strlen(name);
+    const char *p = query;
+    while (p && *p) {
+        const char *end = strchr(p, '&');
+        size_t item_len = end ? (size_t)(end - p) : strlen(p);
+        if (item_len >= name_len && !strncmp(p, name, name_len) &&
+            (item_len == name_len || p[name_len] == '=')) {
+            if (value) {
+                if (item_len > name_len) {
+                    stub_url_decode(p + name_len + 1, item_len - name_len - 1, value, value_size);
+                }
+                else {
+                    value[0] = '\0';
+                }
+            }
+            return 1;
+        }
+        p = end ? end + 1 : NULL;
+    }
+    return 0;
+}
+
+static uint64_t stub_fnv(const char *data, size_t len, uint64_t hash)
+{
+    size_t i;
+    for (i = 0; i < len; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * 计算ETag；为减少服务端CPU开销使用FNV而非MD5，客户端不应据此校验MD5
+ */
+static void stub_make_etag(const char *data, size_t len, char *etag, size_t etag_size)
+{
+    snprintf(etag, etag_size, "%016llx%016llx",
+        (unsigned long long)stub_fnv(data, len, 14695981039346656037ULL),
+        (unsigned long long)stub_fnv(data, len, 0x84222325cbf29ce4ULL));
+}
+
+static void stub_http_date(time_t t, char *buffer, size_t size)
+{
+    struct tm tm_value;
+    gmtime_r(&t, &tm_value);
+    strftime(buffer, size, "%a, %d %b %Y %H:%M:%S GMT", &tm_value);
+}
+
+static void stub_iso_date(time_t t, char *buffer, size_t size)
+{
+    struct tm tm_value;
+    gmtime_r(&t, &tm_value);
+    strftime(buffer, size, "%Y-%m-%dT%H:%M:%S.000Z", &tm_value);
+}
+
+static double stub_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void stub_sleep(double seconds)
+{
+    struct timespec ts;
+    if (seconds <= 0) {
+        return;
+    }
+    ts.tv_sec = (time_t)seconds;
+    ts.tv_nsec = (long)((seconds - (double)ts.tv_sec) * 1e9);
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
+
+/**
+ * xorshift64*，返回[0, 1)；调用者需持有server->mutex
+ */
+static double stub_random(obs_stub_server *server)
+{
+    uint64_t x = server->rng;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    server->rng = x;
+    return (double)((x * 2685821657736338717ULL) >> 11) / 9007199254740992.0;
+}
+
+static void stub_shape(stub_shaper *shaper, uint64_t rate, size_t len)
+{
+    double now;
+    double burst;
+    if (rate == 0) {
+        return;
+    }
+    now = stub_now();
+    burst = (double)rate / 50 > STUB_IO_SIZE ? (double)rate / 50 : STUB_IO_SIZE;
+    shaper->tokens += (now - shaper->last) * (double)rate;
+    if (shaper->tokens > burst) {
+        shaper->tokens = burst;
+    }
+    shaper->last = now;
+    shaper->tokens -= (double)len;
+    if (shaper->tokens < 0) {
+        stub_sleep(-shaper->tokens / (double)rate);
+    }
+}
+
+/***************************************对象存储*******************************************/
+
+static stub_object *stub_object_create(char *data, size_t size)
+{
+    stub_object *object = (stub_object *)calloc(1, sizeof(stub_object));
+    if (object == NULL) {
+        return NULL;
+    }
+    object->refs = 1;
+    object->data = data;
+    object->size = size;
+    object->mtime = time(NULL);
+    stub_make_etag(data ? data : "", size, object->etag, sizeof(object->etag));
+    return object;
+}
+
+/* 复制元数据头，空串返回NULL */
+static char *stub_dup_headers(const char *headers)
+{
+    return headers && headers[0] ? strdup(headers) : NULL;
+}
+
+/* headers中是否有与line同名的头 */
+static int stub_header_listed(const char *headers, const char *line)
+{
+    size_t name_len = strcspn(line, ":");
+    while (headers && *headers) {
+        if (!strncasecmp(headers, line, name_len) && headers[name_len] == ':') {
+            return 1;
+        }
+        headers = strstr(headers, "\r\n");
+        headers = headers ? headers + 2 : NULL;
+    }
+    return 0;
+}
+
+/**
+ * REPLACE_NEW保留更新中未出现的已有头，REPLACE只保留更新中的头
+ */
+static char *stub_merge_headers(const char *headers, const char *update, int replace_all)
+{
+    stub_buffer merged = {NULL, 0, 0};
+    const char *line = replace_all ? NULL : headers;
+    while (line && *line) {
+        const char *end = strstr(line, "\r\n");
+        size_t len = end ? (size_t)(end - line) + 2 : strlen(line);
+        if (!stub_header_listed(update, line)) {
+            stub_buffer_append(&merged, line, len);
+        }
+        line += len;
+    }
+    stub_buffer_append(&merged, update, strlen(update));
+    if (merged.data && merged.data[0] == '\0') {
+        free(merged.data);
+        return NULL;
+    }
+    return merged.data;
+}
+
+/* 调用方需持有server->mutex */
+static void stub_object_release(stub_object *object)
+{
+    if (object && --object->refs == 0) {
+        free(object->data);
+        free(object->headers);
+        free(object);
+    }
+}
+
+static stub_entry **stub_find_slot(obs_stub_server *server, const char *name)
+{
+    uint64_t hash = stub_fnv(name, strlen(name), 14695981039346656037ULL);
+    stub_entry **slot = &server->table[hash & (STUB_HASH_BUCKETS - 1)];
+    while (*slot && strcmp((*slot)->name, name)) {
+        slot = &(*slot)->next;
+    }
+    return slot;
+}
+
+/* 调用方需持有server->mutex，object的引用转交给存储 */
+static void stub_store_put(obs_stub_server *server, const char *name, stub_object *object)
+{
+    stub_entry **slot = stub_find_slot(server, name);
+    if (*slot) {
+        stub_object_release((*slot)->object);
+        (*slot)->object = object;
+        return;
+    }
+    stub_entry *entry = (stub_entry *)calloc(1, sizeof(stub_entry));
+    if (entry == NULL || (entry->name = strdup(name)) == NULL) {
+        free(entry);
+        stub_object_release(object);
+        return;
+    }
+    entry->object = object;
+    *slot = entry;
+    server->stats.objects++;
+}
+
+/* 调用方需持有server->mutex，返回的对象已增加引用 */
+static stub_object *stub_store_get(obs_stub_server *server, const char *name)
+{
+    stub_entry **slot = stub_find_slot(server, name);
+    if (*slot == NULL) {
+        return NULL;
+    }
+    (*slot)->object->refs++;
+    return (*slot)->object;
+}
+
+static int stub_store_delete(obs_stub_server *server, const char *name)
+{
+    stub_entry **slot = stub_find_slot(server, name);
+    stub_entry *entry = *slot;
+    if (entry == NULL) {
+        return 0;
+    }
+    *slot = entry->next;
+    stub_object_release(entry->object);
+    free(entry->name);
+    free(entry);
+    server->stats.objects--;
+    return 1;
+}
+
+static stub_upload *stub_find_upload(obs_stub_server *server, const char *id, stub_upload ***link)
+{
+    stub_upload **p = &server->uploads;
+    while (*p && strcmp((*p)->id, id)) {
+        p = &(*p)->next;
+    }
+    if (link) {
+        *link = p;
+    }
+    return *p;
+}
+
+static void stub_upload_free(stub_upload *upload)
+{
+    unsigned int i;
+    if (upload->parts) {
+        for (i = 0; i <= STUB_MAX_PARTS; i++) {
+            stub_object_release(upload->parts[i]);
+        }
+    }
+    free(upload->parts);
+    free(upload->name);
+    free(upload->headers);
+    free(upload);
+}
+
+/***************************************连接读写*******************************************/
+
+static int stub_send_all(stub_conn *conn, const char *data, size_t len)
+{
+    while (len > 0) {
+        size_t chunk = conn->bandwidth && len > STUB_IO_SIZE ? STUB_IO_SIZE : len;
+        ssize_t n = send(conn->fd, data, chunk, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        stub_shape(&conn->tx, conn->bandwidth, (size_t)n);
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int stub_fill(stub_conn *conn)
+{
+    ssize_t n;
+    if (conn->pos > 0 && conn->pos < conn->len) {
+        memmove(conn->buf, conn->buf + conn->pos, conn->len - conn->pos);
+    }
+    conn->len -= conn->pos;
+    conn->pos = 0;
+    do {
+        n = recv(conn->fd, conn->buf + conn->len, sizeof(conn->buf) - conn->len, 0);
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0) {
+        return -1;
+    }
+    stub_shape(&conn->rx, conn->bandwidth, (size_t)n);
+    conn->len += (size_t)n;
+    return 0;
+}
+
+/**
+ * 读一行（去掉CRLF），返回行长度，连接关闭或行过长返回-1
+ */
+static int stub_read_line(stub_conn *conn, char *line, size_t size)
+{
+    for (;;) {
+        char *start = conn->buf + conn->pos;
+        char *eol = (char *)memchr(start, '\n', conn->len - conn->pos);
+        if (eol) {
+            size_t len = (size_t)(eol - start);
+            if (len > 0 && start[len - 1] == '\r') {
+                len--;
+            }
+            if (len >= size) {
+                return -1;
+            }
+            memcpy(line, start, len);
+            line[len] = '\0';
+            conn->pos += (size_t)(eol - start) + 1;
+            return (int)len;
+        }
+        if (conn->len - conn->pos >= sizeof(conn->buf) || stub_fill(conn) != 0) {
+            return -1;
+        }
+    }
+}
+
+static int stub_read_exact(stub_conn *conn, char *dst, size_t len)
+{
+    while (len > 0) {
+        size_t avail = conn->len - conn->pos;
+        if (avail == 0) {
+            if (stub_fill(conn) != 0) {
+                return -1;
+            }
+            continue;
+        }
+        if (avail > len) {
+            avail = len;
+        }
+        memcpy(dst, conn->buf + conn->pos, avail);
+        conn->pos += avail;
+        dst += avail;
+        len -= avail;
+    }
+    return 0;
+}
+
+static int stub_read_body(stub_conn *conn, stub_request *request)
+{
+    char line[256];
+    if (request->expect_continue && (request->chunked || request->content_length > 0)) {
+        const char *cont = "HTTP/1.1 100 Continue\r\n\r\n";
+        if (stub_send_all(conn, cont, strlen(cont)) != 0) {
+            return -1;
+        }
+    }
+    if (!request->chunked) {
+        if (request->content_length <= 0) {
+            return 0;
+        }
+        request->body = (char *)malloc((size_t)request->content_length + 1);
+        if (request->body == NULL) {
+            return -1;
+        }
+        request->body_len = (size_t)request->content_length;
+        request->body[request->body_len] = '\0';
+        return stub_read_exact(conn, request->body, request->body_len);
+    }
+    for (;;) {
+        unsigned long long chunk;
+        char *grown;
+        if (stub_read_line(conn, line, sizeof(line)) < 0) {
+            return -1;
+        }
+        chunk = strtoull(line, NULL, 16);
+        if (chunk == 0) {
+            // 跳过trailer直到空行
+            while (stub_read_line(conn, line, sizeof(line)) > 0) {
+            }
+            return 0;
+        }
+        grown = (char *)realloc(request->body, request->body_len + chunk + 1);
+        if (grown == NULL) {
+            return -1;
+        }
+        request->body = grown;
+        if (stub_read_exact(conn, request->body + request->body_len, chunk) != 0 ||
+            stub_read_line(conn, line, sizeof(line)) != 0) {
+            return -1;
+        }
+        request->body_len += chunk;
+        request->body[request->body_len] = '\0';
+    }
+}
+
+static void stub_copy_header(char *dst, size_t size, const char *value)
+{
+    snprintf(dst, size, "%s", value);
+}
+
+static int stub_read_request(stub_conn *conn, stub_request *request)
+{
+    char line[STUB_LINE_SIZE];
+    char target[STUB_LINE_SIZE];
+    char version[16] = "";
+    char *path;
+    char *query;
+    char *slash;
+
+    memset(request, 0, sizeof(stub_request));
+    if (stub_read_line(conn, line, sizeof(line)) <= 0) {
+        return -1;
+    }
+    if (sscanf(line, "%15s %8191s %15s", request->method, target, version) != 3) {
+        return -1;
+    }
+    request->keep_alive = strcmp(version, "HTTP/1.0") != 0;
+    for (;;) {
+        char *colon;
+        char *value;
+        int len = stub_read_line(conn, line, sizeof(line));
+        if (len < 0) {
+            return -1;
+        }
+        if (len == 0) {
+            break;
+        }
+        colon = strchr(line, ':');
+        if (colon == NULL) {
+            continue;
+        }
+        *colon = '\0';
+        value = colon + 1;
+        while (*value == ' ' || *value == '\t') {
+            value++;
+        }
+        if (!strcasecmp(line, "Content-Length")) {
+            request->content_length = strtoll(value, NULL, 10);
+        }
+        else if (!strcasecmp(line, "Transfer-Encoding")) {
+            request->chunked = strcasestr(value, "chunked") != NULL;
+        }
+        else if (!strcasecmp(line, "Expect")) {
+            request->expect_continue = strcasestr(value, "100-continue") != NULL;
+        }
+        else if (!strcasecmp(line, "Connection")) {
+            if (!strcasecmp(value, "close")) {
+                request->keep_alive = 0;
+            }
+            else if (!strcasecmp(value, "keep-alive")) {
+                request->keep_alive = 1;
+            }
+        }
+        else if (!strcasecmp(line, "Range")) {
+            stub_copy_header(request->range, sizeof(request->range), value);
+        }
+        else if (!strcasecmp(line, "If-Match")) {
+            stub_copy_header(request->if_match, sizeof(request->if_match), value);
+        }
+        else if (!strcasecmp(line, "If-None-Match")) {
+            stub_copy_header(request->if_none_match, sizeof(request->if_none_match), value);
+        }
+        else if (!strcasecmp(line, "x-amz-copy-source-range") || !strcasecmp(line, "x-obs-copy-source-range")) {
+            stub_copy_header(request->copy_range, sizeof(request->copy_range), value);
+        }
+        else if (!strcasecmp(line, "x-amz-copy-source") || !strcasecmp(line, "x-obs-copy-source")) {
+            stub_url_decode(value, strlen(value), request->copy_source, sizeof(request->copy_source));
+        }
+        else if (!strcasecmp(line, "x-amz-metadata-directive") || !strcasecmp(line, "x-obs-metadata-directive")) {
+            stub_copy_header(request->metadata_directive, sizeof(request->metadata_directive), value);
+        }
+        else if (!strcasecmp(line, "Content-Encoding") || !strncasecmp(line, "x-amz-meta-", 11) ||
+            !strncasecmp(line, "x-obs-meta-", 11)) {
+            int meta_written = snprintf(request->meta + request->meta_len,
+                sizeof(request->meta) - request->meta_len, "%s: %s\r\n", line, value);
+            if (meta_written > 0 && (size_t)meta_written < sizeof(request->meta) - request->meta_len) {
+                request->meta_len += (size_t)meta_written;
+            }
+            else {
+                request->meta[request->meta_len] = '\0';
+            }
+        }
+    }
+
+    // 绝对URI形式只保留路径部分
+    path = target;
+    if (!strncmp(path, "http://", 7) || !strncmp(path, "https://", 8)) {
+        path = strchr(strstr(path, "//") + 2, '/');
+        if (path == NULL) {
+            path = "/";
+        }
+    }
+    query = strchr(path, '?');
+    if (query) {
+        *query++ = '\0';
+        snprintf(request->query, sizeof(request->query), "%s", query);
+    }
+    while (*path == '/') {
+        path++;
+    }
+    slash = strchr(path, '/');
+    if (slash) {
+        stub_url_decode(path, (size_t)(slash - path), request->bucket, sizeof(request->bucket));
+        stub_url_decode(slash + 1, strlen(slash + 1), request->key, sizeof(request->key));
+    }
+    else {
+        stub_url_decode(path, strlen(path), request->bucket, sizeof(request->bucket));
+    }
+    return stub_read_body(conn, request);
+}
+
+/***************************************响应*******************************************/
+
+/**
+ * 关闭时发送RST而不是FIN
+ */
+static void stub_reset(stub_conn *conn)
+{
+    struct linger linger_value;
+    linger_value.l_onoff = 1;
+    linger_value.l_linger = 0;
+    (void)setsockopt(conn->fd, SOL_SOCKET, SO_LINGER, &linger_value, sizeof(linger_value));
+}
+
+static const char *stub_reason(int code)
+{
+    switch (code) {
+        case 200: return "OK";
+        case 204: return "No Content";
+        case 206: return "Partial Content";
+        case 304: return "Not Modified";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 412: return "Precondition Failed";
+        case 416: return "Requested Range Not Satisfiable";
+        case 500: return "Internal Server Error";
+        case 503: return "Service Unavailable";
+        default: return "Unknown";
+    }
+}
+
+/**
+ * 发送响应；extra_headers为完整的若干"Name: value\r\n"行，可为NULL
+ */
+static int stub_respond(stub_conn *conn, const stub_request *request, int code, const char *extra_headers,
+    const char *body, size_t body_len, int send_body)
+{
+    char head[STUB_LINE_SIZE];
+    char date[64];
+    int len;
+    if (conn->truncate && !(send_body && body_len > 0)) {
+        stub_reset(conn);
+        return -1;
+    }
+    stub_http_date(time(NULL), date, sizeof(date));
+    len = snprintf(head, sizeof(head),
+        "HTTP/1.1 %d %s\r\n"
+        "Date: %s\r\n"
+        "Server: OBS\r\n"
+        "x-amz-request-id: %s\r\n"
+        "Content-Length: %llu\r\n"
+        "%s"
+        "%s"
+        "\r\n",
+        code, stub_reason(code), date, request->request_id, (unsigned long long)body_len,
+        request->keep_alive ? "" : "Connection: close\r\n",
+        extra_headers ? extra_headers : "");
+    if (len <= 0 || (size_t)len >= sizeof(head)) {
+        return -1;
+    }
+    if (stub_send_all(conn, head, (size_t)len) != 0) {
+        return -1;
+    }
+    if (send_body && body_len > 0) {
+        size_t send_len = conn->truncate ? body_len / 2 : body_len;
+        if (stub_send_all(conn, body, send_len) != 0) {
+            return -1;
+        }
+        pthread_mutex_lock(&conn->server->mutex);
+        conn->server->stats.bytes_sent += send_len;
+        pthread_mutex_unlock(&conn->server->mutex);
+        if (conn->truncate) {
+            stub_reset(conn);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int stub_respond_xml(stub_conn *conn, const stub_request *request, int code, stub_buffer *xml)
+{
+    int ret = stub_respond(conn, request, code, "Content-Type: application/xml\r\n",
+        xml->data ? xml->data : "", xml->len, strcmp(request->method, "HEAD") != 0);
+    free(xml->data);
+    return ret;
+}
+
+static int stub_respond_error(stub_conn *conn, const stub_request *request, int code, const char *error_code,
+    const char *message)
+{
+    stub_buffer xml = {NULL, 0, 0};
+    stub_buffer_printf(&xml, "<?xml version=\"1.0\" encoding=\"UTF-8\"?><Error><Code>%s</Code>"
+        "<Message>%s</Message><RequestId>%s</RequestId></Error>", error_code, message, request->request_id);
+    return stub_respond_xml(conn, request, code, &xml);
+}
+
+static void stub_object_name(const stub_request *request, char *name, size_t size)
+{
+    snprintf(name, size, "%s/%s", request->bucket, request->key);
+}
+
+/***************************************对象操作*******************************************/
+
+static int stub_etag_matches(const char *header, const char *etag)
+{
+    const char *p = header;
+    size_t etag_len = strlen(etag);
+    if (!strcmp(header, "*")) {
+        return 1;
+    }
+    while ((p = strstr(p, etag)) != NULL) {
+        if ((p == header || p[-1] == '"' || p[-1] == ' ' || p[-1] == ',') &&
+            (p[etag_len] == '"' || p[etag_len] == '\0' || p[etag_len] == ',' || p[etag_len] == ' ')) {
+            return 1;
+        }
+        p += etag_len;
+    }
+    return 0;
+}
+
+/**
+ * 解析Range，成功返回1并给出闭区间；不可满足返回-1；无Range返回0
+ */
+static int stub_parse_range(const char *range, size_t size, size_t *first, size_t *last)
+{
+    unsigned long long a;
+    unsigned long long b;
+    if (range[0] == '\0' || strncmp(range, "bytes=", 6)) {
+        return 0;
+    }
+    range += 6;
+    if (range[0] == '-') {
+        b = strtoull(range + 1, NULL, 10);
+        if (b == 0 || size == 0) {
+            return -1;
+        }
+        *first = b >= size ? 0 : size - (size_t)b;
+        *last = size - 1;
+        return 1;
+    }
+    a = strtoull(range, (char **)&range, 10);
+    if (a >= size) {
+        return -1;
+    }
+    b = (*range == '-' && range[1] >= '0' && range[1] <= '9') ? strtoull(range + 1, NULL, 10) : size - 1;
+    if (b < a) {
+        return -1;
+    }
+    *first = (size_t)a;
+    *last = b >= size ? size - 1 : (size_t)b;
+    return 1;
+}
+
+static int stub_get_object(stub_conn *conn, stub_request *request)
+{
+    obs_stub_server *server = conn->server;
+    char name[STUB_NAME_SIZE + 256];
+    char headers[STUB_META_SIZE * 2 + 512];
+    char date[64];
+    size_t first = 0;
+    size_t last = 0;
+    int head = !strcmp(request->method, "HEAD");
+    int ranged;
+    int ret;
+    stub_object *object;
+
+    stub_object_name(request, name, sizeof(name));
+    pthread_mutex_lock(&server->mutex);
+    object = stub_store_get(server, name);
+    pthread_mutex_unlock(&server->mutex);
+    if (object == NULL) {
+        return head ? stub_respond(conn, request, 404, NULL, NULL, 0, 0) :
+            stub_respond_error(conn, request, 404, "NoSuchKey", "The specified key does not exist.");
+    }
+
+    stub_http_date(object->mtime, date, sizeof(date));
+    if (request->if_match[0] && !stub_etag_matches(request->if_match, object->etag)) {
+        ret = stub_respond_error(conn, request, 412, "PreconditionFailed", "At least one of the pre-conditions "
+            "you specified did not hold.");
+    }
+    else if (request->if_none_match[0] && stub_etag_matches(request->if_none_match, object->etag)) {
+        snprintf(headers, sizeof(headers), "ETag: \"%s\"\r\nLast-Modified: %s\r\n", object->etag, date);
+        ret = stub_respond(conn, request, 304, headers, NULL, 0, 0);
+    }
+    else if ((ranged = stub_parse_range(request->range, object->size, &first, &last)) < 0) {
+        ret = stub_respond_error(conn, request, 416, "InvalidRange", "The requested range cannot be satisfied.");
+    }
+    else if (ranged) {
+        snprintf(headers, sizeof(headers), "ETag: \"%s\"\r\nLast-Modified: %s\r\n"
+            "Content-Type: binary/octet-stream\r\nAccept-Ranges: bytes\r\nContent-Range: bytes %llu-%llu/%llu\r\n%s",
+            object->etag, date, (unsigned long long)first, (unsigned long long)last,
+            (unsigned long long)object->size, object->headers ? object->headers : "");
+        ret = stub_respond(conn, request, 206, headers, object->data + first, last - first + 1, !head);
+    }
+    else {
+        snprintf(headers, sizeof(headers), "ETag: \"%s\"\r\nLast-Modified: %s\r\n"
+            "Content-Type: binary/octet-stream\r\nAccept-Ranges: bytes\r\n%s", object->etag, date,
+            object->headers ? object->headers : "");
+        ret = stub_respond(conn, request, 200, headers, object->data, object->size, !head);
+    }
+
+    pthread_mutex_lock(&server->mutex);
+    stub_object_release(object);
+    pthread_mutex_unlock(&server->mutex);
+    return ret;
+}
+
+/**
+ * 根据拷贝源得到对象，返回的对象已增加引用
+ */
+static stub_object *stub_copy_source_object(obs_stub_server *server, const char *copy_source)
+{
+    char name[STUB_NAME_SIZE];
+    char *version;
+    stub_object *object;
+    while (*copy_source == '/') {
+        copy_source++;
+    }
+    snprintf(name, sizeof(name), "%s", copy_source);
+    if ((version = strstr(name, "?versionId=")) != NULL) {
+        *version = '\0';
+    }
+    pthread_mutex_lock(&server->mutex);
+    object = stub_store_get(server, name);
+    pthread_mutex_unlock(&server->mutex);
+    return object;
+}
+
+static int stub_put_object(stub_conn *conn, stub_request *request)
+{
+    obs_stub_server *server = conn->server;
+    char name[STUB_NAME_SIZE + 256];
+    char headers[256];
+    char date[64];
+    stub_object *object;
+    stub_buffer xml = {NULL, 0, 0};
+
+    if (request->copy_source[0]) {
+        stub_object *source = stub_copy_source_object(server, request->copy_source);
+        char *data;
+        if (source == NULL) {
+            return stub_respond_error(conn, request, 404, "NoSuchKey", "The specified key does not exist.");
+        }
+        data = (char *)malloc(source->size ? source->size : 1);
+        if (data != NULL) {
+            memcpy(data, source->data, source->size);
+        }
+        object = data ? stub_object_create(data, source->size) : NULL;
+        if (object != NULL) {
+            object->headers = strcasecmp(request->metadata_directive, "REPLACE") ?
+                stub_dup_headers(source->headers) : stub_dup_headers(request->meta);
+        }
+        pthread_mutex_lock(&server->mutex);
+        stub_object_release(source);
+        pthread_mutex_unlock(&server->mutex);
+        if (object == NULL) {
+            free(data);
+            return stub_respond_error(conn, request, 500, "InternalError", "Out of memory.");
+        }
+        stub_object_name(request, name, sizeof(name));
+        stub_iso_date(object->mtime, date, sizeof(date));
+        stub_buffer_printf(&xml, "<?xml version=\"1.0\" encoding=\"UTF-8\"?><CopyObjectResult>"
+            "<LastModified>%s</LastModified><ETag>\"%s\"</ETag></CopyObjectResult>", date, object->etag);
+        pthread_mutex_lock(&server->mutex);
+        stub_store_put(server, name, object);
+        pthread_mutex_unlock(&server->mutex);
+        return stub_respond_xml(conn, request, 200, &xml);
+    }
+
+    object = stub_object_create(request->body, request->body_len);
+    if (object == NULL) {
+        return stub_respond_error(conn, request, 500, "InternalError", "Out of memory.");
+    }
+    request->body = NULL;
+    object->headers = stub_dup_headers(request->meta);
+    snprintf(headers, sizeof(headers), "ETag: \"%s\"\r\n", object->etag);
+    stub_object_name(request, name, sizeof(name));
+    pthread_mutex_lock(&server->mutex);
+    stub_store_put(server, name, object);
+    pthread_mutex_unlock(&server->mutex);
+    return stub_respond(conn, request, 200, headers, NULL, 0, 0);
+}
+
+/**
+ * PUT ?metadata：按指令合并元数据，数据拷贝到新对象，GET在锁外发送的旧对象不受影响
+ */
+static int stub_set_metadata(stub_conn *conn, stub_request *request)
+{
+    obs_stub_server *server = conn->server;
+    char name[STUB_NAME_SIZE + 256];
+    stub_object *source;
+    stub_object *object = NULL;
+    char *data;
+
+    stub_object_name(request, name, sizeof(name));
+    pthread_mutex_lock(&server->mutex);
+    source = stub_store_get(server, name);
+    pthread_mutex_unlock(&server->mutex);
+    if (source == NULL) {
+        return stub_respond_error(conn, request, 404, "NoSuchKey", "The specified key does not exist.");
+    }
+    data = (char *)malloc(source->size ? source->size : 1);
+    if (data != NULL) {
+        memcpy(data, source->data, source->size);
+        object = stub_object_create(data, source->size);
+    }
+    if (object != NULL) {
+        memcpy(object->etag, source->etag, sizeof(object->etag));
+        object->mtime = source->mtime;
+        object->headers = stub_merge_headers(source->headers, request->meta,
+            !strcasecmp(request->metadata_directive, "REPLACE"));
+    }
+    pthread_mutex_lock(&server->mutex);
+    stub_object_release(source);
+    if (object != NULL) {
+        stub_store_put(server, name, object);
+    }
+    pthread_mutex_unlock(&server->mutex);
+    if (object == NULL) {
+        free(data);
+        return stub_respond_error(conn, request, 500, "InternalError", "Out of memory.");
+    }
+    return stub_respond(conn, request, 200, NULL, NULL, 0, 0);
+}
+
+static int stub_delete_object(stub_conn *conn, stub_request *request)
+{
+    char name[STUB_NAME_SIZE + 256];
+    stub_object_name(request, name, sizeof(name));
+    pthread_mutex_lock(&conn->server->mutex);
+    (void)stub_store_delete(conn->server, name);
+    pthread_mutex_unlock(&conn->server->mutex);
+    return stub_respond(conn, request, 204, NULL, NULL, 0, 0);
+}
+
+/***************************************分段上传*******************************************/
+
+static int stub_initiate_upload(stub_conn *conn, stub_request *request)
+{
+    obs_stub_server *server = conn->server;
+    char name[STUB_NAME_SIZE + 256];
+    stub_buffer xml = {NULL, 0, 0};
+    stub_upload *upload = (stub_upload *)calloc(1, sizeof(stub_upload));
+
+    stub_object_name(request, name, sizeof(name));
+    if (upload == NULL || (upload->name = strdup(name)) == NULL ||
+        (upload->parts = (stub_object **)calloc(STUB_MAX_PARTS + 1, sizeof(stub_object *))) == NULL) {
+        if (upload) {
+            free(upload->name);
+            free(upload);
+        }
+        return stub_respond_error(conn, request, 500, "InternalError", "Out of memory.");
+    }
+    upload->headers = stub_dup_headers(request->meta);
+    upload->initiated = time(NULL);
+    pthread_mutex_lock(&server->mutex);
+    snprintf(upload->id, sizeof(upload->id), "stubupload%016llx", (unsigned long long)++server->next_upload_id);
+    upload->next = server->uploads;
+    server->uploads = upload;
+    pthread_mutex_unlock(&server->mutex);
+
+    stub_buffer_printf(&xml, "<?xml version=\"1.0\" encoding=\"UTF-8\"?><InitiateMultipartUploadResult>"
+        "<Bucket>%s</Bucket><Key>", request->bucket);
+    stub_buffer_append_xml(&xml, request->key);
+    stub_buffer_printf(&xml, "</Key><UploadId>%s</UploadId></InitiateMultipartUploadResult>", upload->id);
+    return stub_respond_xml(conn, request, 200, &xml);
+}
+
+static int stub_upload_part(stub_conn *conn, stub_request *request, const char *upload_id)
+{
+    obs_stub_server *server = conn->server;
+    char value[32];
+    char headers[256];
+    char date[64];
+    long part_number = 0;
+    stub_object *object;
+    stub_upload *upload;
+    stub_buffer xml = {NULL, 0, 0};
+
+    if (stub_query_get(request->query, "partNumber", value, sizeof(value))) {
+        part_number = strtol(value, NULL, 10);
+    }
+    if (part_number < 1 || part_number > STUB_MAX_PARTS) {
+        return stub_respond_error(conn, request, 400, "InvalidArgument", "Part number must be 1-10000.");
+    }
+    if (request->copy_source[0]) {
+        stub_object *source = stub_copy_source_object(server, request->copy_source);
+        size_t first = 0;
+        size_t last = 0;
+        char *data = NULL;
+        if (source == NULL) {
+            return stub_respond_error(conn, request, 404, "NoSuchKey", "The specified key does not exist.");
+        }
+        last = source->size ? source->size - 1 : 0;
+        if (request->copy_range[0]) {
+            (void)stub_parse_range(request->copy_range, source->size, &first, &last);
+        }
+        data = (char *)malloc(source->size ? last - first + 1 : 1);
+        if (data) {
+            memcpy(data, source->data + first, source->size ? last - first + 1 : 0);
+        }
+        object = data ? stub_object_create(data, source->size ? last - first + 1 : 0) : NULL;
+        pthread_mutex_lock(&server->mutex);
+        stub_object_release(source);
+        pthread_mutex_unlock(&server->mutex);
+    }
+    else {
+        object = stub_object_create(request->body, request->body_len);
+        if (object) {
+            request->body = NULL;
+        }
+    }
+    if (object == NULL) {
+        return stub_respond_error(conn, request, 500, "InternalError", "Out of memory.");
+    }
+
+    pthread_mutex_lock(&server->mutex);
+    upload = stub_find_upload(server, upload_id, NULL);
+    if (upload) {
+        stub_object_release(upload->parts[part_number]);
+        upload->parts[part_number] = object;
+        object->refs++;
+    }
+    pthread_mutex_unlock(&server->mutex);
+    if (upload == NULL) {
+        pthread_mutex_lock(&server->mutex);
+        stub_object_release(object);
+        pthread_mutex_unlock(&server->mutex);
+        return stub_respond_error(conn, request, 404, "NoSuchUpload", "The specified upload does not exist.");
+    }
+
+    if (request->copy_source[0]) {
+        stub_iso_date(object->mtime, date, sizeof(date));
+        stub_buffer_printf(&xml, "<?xml version=\"1.0\" encoding=\"UTF-8\"?><CopyPartResult>"
+            "<LastModified>%s</LastModified><ETag>\"%s\"</ETag></CopyPartResult>", date, object->etag);
+        pthread_mutex_lock(&server->mutex);
+        stub_object_release(object);
+        pthread_mutex_unlock(&server->mutex);
+        return stub_respond_xml(conn, request, 200, &xml);
+    }
+    snprintf(headers, sizeof(headers), "ETag: \"%s\"\r\n", object->etag);
+    pthread_mutex_lock(&server->mutex);
+    stub_object_release(object);
+    pthread_mutex_unlock(&server->mutex);
+    return stub_respond(conn, request, 200, headers, NULL, 0, 0);
+}
+
+/**
+ * 按请求体中PartNumber出现的顺序拼接各段
+ */
+static int stub_complete_upload(stub_conn *conn, stub_request *request, const char *upload_id)
+{
+    obs_stub_server *server = conn->server;
+    stub_upload **link = NULL;
+    stub_upload *upload;
+    stub_buffer data = {NULL, 0, 0};
+    stub_buffer etags = {NULL, 0, 0};
+    stub_buffer xml = {NULL, 0, 0};
+    stub_object *object;
+    unsigned int part_count = 0;
+    const char *p = request->body;
+    int missing = 0;
+
+    pthread_mutex_lock(&server->mutex);
+    upload = stub_find_upload(server, upload_id, &link);
+    if (upload == NULL) {
+        pthread_mutex_unlock(&server->mutex);
+        return stub_respond_error(conn, request, 404, "NoSuchUpload", "The specified upload does not exist.");
+    }
+    while (p && (p = strstr(p, "<PartNumber>")) != NULL) {
+        long part_number = strtol(p + 12, NULL, 10);
+        p += 12;
+        if (part_number < 1 || part_number > STUB_MAX_PARTS || upload->parts[part_number] == NULL) {
+            missing = 1;
+            break;
+        }
+        stub_buffer_append(&data, upload->parts[part_number]->data, upload->parts[part_number]->size);
+        stub_buffer_append(&etags, upload->parts[part_number]->etag, strlen(upload->parts[part_number]->etag));
+        part_count++;
+    }
+    if (missing || part_count == 0) {
+        pthread_mutex_unlock(&server->mutex);
+        free(data.data);
+        free(etags.data);
+        return stub_respond_error(conn, request, 400, "InvalidPart", "One or more of the specified parts "
+            "could not be found.");
+    }
+    *link = upload->next;
+    pthread_mutex_unlock(&server->mutex);
+
+    object = stub_object_create(data.data, data.len);
+    if (object == NULL) {
+        free(data.data);
+        free(etags.data);
+        pthread_mutex_lock(&server->mutex);
+        stub_upload_free(upload);
+        pthread_mutex_unlock(&server->mutex);
+        return stub_respond_error(conn, request, 500, "InternalError", "Out of memory.");
+    }
+    // 与OBS一致，合并后的ETag为各段ETag摘要加段数
+    stub_make_etag(etags.data, etags.len, object->etag, sizeof(object->etag));
+    snprintf(object->etag + strlen(object->etag), sizeof(object->etag) - strlen(object->etag), "-%u", part_count);
+    free(etags.data);
+    object->headers = upload->headers;
+    upload->headers = NULL;
+
+    stub_buffer_printf(&xml, "<?xml version=\"1.0\" encoding=\"UTF-8\"?><CompleteMultipartUploadResult>"
+        "<Location>/%s/", request->bucket);
+    stub_buffer_append_xml(&xml, request->key);
+    stub_buffer_printf(&xml, "</Location><Bucket>%s</Bucket><Key>", request->bucket);
+    stub_buffer_append_xml(&xml, request->key);
+    stub_buffer_printf(&xml, "</Key><ETag>\"%s\"</ETag></CompleteMultipartUploadResult>", object->etag);
+
+    pthread_mutex_lock(&server->mutex);
+    stub_store_put(server, upload->name, object);
+    stub_upload_free(upload);
+    pthread_mutex_unlock(&server->mutex);
+    return stub_respond_xml(conn, request, 200, &xml);
+}
+
+static int stub_abort_upload(stub_conn *conn, stub_request *request, const char *upload_id)
+{
+    obs_stub_server *server = conn->server;
+    stub_upload **link = NULL;
+    stub_upload *upload;
+    pthread_mutex_lock(&server->mutex);
+    upload = stub_find_upload(server, upload_id, &link);
+    if (upload) {
+        *link = upload->next;
+        stub_upload_free(upload);
+    }
+    pthread_mutex_unlock(&server->mutex);
+    if (upload == NULL) {
+        return stub_respond_error(conn, request, 404, "NoSuchUpload", "The specified upload does not exist.");
+    }
+    return stub_respond(conn, request, 204, NULL, NULL, 0, 0);
+}
+
+static int stub_list_parts(stub_conn *conn, stub_request *request, const char *upload_id)
+{
+    obs_stub_server *server = conn->server;
+    char value[32];
+    char date[64];
+    long max_parts = STUB_DEFAULT_MAX_KEYS;
+    long marker = 0;
+    long next_marker = 0;
+    long emitted = 0;
+    long i;
+    int truncated = 0;
+    stub_upload *upload;
+    stub_buffer parts = {NULL, 0, 0};
+    stub_buffer xml = {NULL, 0, 0};
+
+    if (stub_query_get(request->query, "max-parts", value, sizeof(value))) {
+        max_parts = strtol(value, NULL, 10);
+        if (max_parts <= 0 || max_parts > STUB_DEFAULT_MAX_KEYS) {
+            max_parts = STUB_DEFAULT_MAX_KEYS;
+        }
+    }
+    if (stub_query_get(request->query, "part-number-marker", value, sizeof(value))) {
+        marker = strtol(value, NULL, 10);
+        marker = marker < 0 ? 0 : marker;
+    }
+
+    pthread_mutex_lock(&server->mutex);
+    upload = stub_find_upload(server, upload_id, NULL);
+    for (i = marker + 1; upload && i <= STUB_MAX_PARTS; i++) {
+        stub_object *part = upload->parts[i];
+        if (part == NULL) {
+            continue;
+        }
+        if (emitted == max_parts) {
+            truncated = 1;
+            break;
+        }
+        stub_iso_date(part->mtime, date, sizeof(date));
+        stub_buffer_printf(&parts, "<Part><PartNumber>%ld</PartNumber><LastModified>%s</LastModified>"
+            "<ETag>\"%s\"</ETag><Size>%llu</Size></Part>", i, date, part->etag, (unsigned long long)part->size);
+        next_marker = i;
+        emitted++;
+    }
+    pthread_mutex_unlock(&server->mutex);
+    if (upload == NULL) {
+        free(parts.data);
+        return stub_respond_error(conn, request, 404, "NoSuchUpload", "The specified upload does not exist.");
+    }
+
+    stub_buffer_printf(&xml, "<?xml version=\"1.0\" encoding=\"UTF-8\"?><ListPartsResult>"
+        "<Bucket>%s</Bucket><Key>", request->bucket);
+    stub_buffer_append_xml(&xml, request->key);
+    stub_buffer_printf(&xml, "</Key><UploadId>%s</UploadId><Initiator><ID>stub</ID><DisplayName>stub</DisplayName>"
+        "</Initiator><Owner><ID>stub</ID><DisplayName>stub</DisplayName></Owner><StorageClass>STANDARD</StorageClass>"
+        "<PartNumberMarker>%ld</PartNumberMarker><NextPartNumberMarker>%ld</NextPartNumberMarker>"
+        "<MaxParts>%ld</MaxParts><IsTruncated>%s</IsTruncated>",
+        upload_id, marker, next_marker, max_parts, truncated ? "true" : "false");
+    if (parts.data) {
+        stub_buffer_append(&xml, parts.data, parts.len);
+    }
+    stub_buffer_append(&xml, "</ListPartsResult>", 18);
+    free(parts.data);
+    return stub_respond_xml(conn, request, 200, &xml);
+}
+
+/**
+ * 列举分段上传，只支持prefix，结果不分页
+ */
+static int stub_list_uploads(stub_conn *conn, stub_request *request)
+{
+    obs_stub_server *server = conn->server;
+    char prefix[STUB_NAME_SIZE];
+    char name_prefix[STUB_NAME_SIZE + 256];
+    char date[64];
+    size_t name_prefix_len;
+    stub_upload *upload;
+    stub_buffer xml = {NULL, 0, 0};
+
+    prefix[0] = '\0';
+    (void)stub_query_get(request->query, "prefix", prefix, sizeof(prefix));
+    snprintf(name_prefix, sizeof(name_prefix), "%s/%s", request->bucket, prefix);
+    name_prefix_len = strlen(name_prefix);
+
+    stub_buffer_printf(&xml, "<?xml version=\"1.0\" encoding=\"UTF-8\"?><ListMultipartUploadsResult>"
+        "<Bucket>%s</Bucket><KeyMarker></KeyMarker><UploadIdMarker></UploadIdMarker>"
+        "<MaxUploads>1000</MaxUploads><IsTruncated>false</IsTruncated>", request->bucket);
+    pthread_mutex_lock(&server->mutex);
+    for (upload = server->uploads; upload; upload = upload->next) {
+        if (strncmp(upload->name, name_prefix, name_prefix_len)) {
+            continue;
+        }
+        stub_iso_date(upload->initiated, date, sizeof(date));
+        stub_buffer_append(&xml, "<Upload><Key>", 13);
+        stub_buffer_append_xml(&xml, upload->name + strlen(request->bucket) + 1);
+        stub_buffer_printf(&xml, "</Key><UploadId>%s</UploadId><Initiator><ID>stub</ID></Initiator>"
+            "<Owner><ID>stub</ID></Owner><StorageClass>STANDARD</StorageClass><Initiated>%s</Initiated></Upload>",
+            upload->id, date);
+    }
+    pthread_mutex_unlock(&server->mutex);
+    stub_buffer_append(&xml, "</ListMultipartUploadsResult>", 29);
+    return stub_respond_xml(conn, request, 200, &xml);
+}
+
+/***************************************桶操作*******************************************/
+
+typedef struct stub_listed
+{
+    char *key;
+    stub_object *object;
+} stub_listed;
+
+static int stub_listed_compare(const void *a, const void *b)
+{
+    return strcmp(((const stub_listed *)a)->key, ((const stub_listed *)b)->key);
+}
+
+/**
+ * 列举对象；versions非0时按ListVersionsResult返回，每个对象只有一个版本"null"
+ */
+static int stub_list_objects(stub_conn *conn, stub_request *request, int versions)
+{
+    obs_stub_server *server = conn->server;
+    char prefix[STUB_NAME_SIZE] = "";
+    char marker[STUB_NAME_SIZE] = "";
+    char delimiter[64] = "";
+    char value[32];
+    char bucket_prefix[STUB_NAME_SIZE + 256];
+    char date[64];
+    char last_prefix[STUB_NAME_SIZE] = "";
+    const char *next_marker = NULL;
+    size_t bucket_prefix_len;
+    size_t count = 0;
+    size_t capacity = 0;
+    size_t i;
+    long max_keys = STUB_DEFAULT_MAX_KEYS;
+    long emitted = 0;
+    int truncated = 0;
+    stub_listed *listed = NULL;
+    stub_buffer contents = {NULL, 0, 0};
+    stub_buffer prefixes = {NULL, 0, 0};
+    stub_buffer xml = {NULL, 0, 0};
+
+    (void)stub_query_get(request->query, "prefix", prefix, sizeof(prefix));
+    (void)stub_query_get(request->query, versions ? "key-marker" : "marker", marker, sizeof(marker));
+    (void)stub_query_get(request->query, "delimiter", delimiter, sizeof(delimiter));
+    if (stub_query_get(request->query, "max-keys", value, sizeof(value))) {
+        max_keys = strtol(value, NULL, 10);
+        if (max_keys <= 0 || max_keys > STUB_DEFAULT_MAX_KEYS) {
+            max_keys = STUB_DEFAULT_MAX_KEYS;
+        }
+    }
+    snprintf(bucket_prefix, sizeof(bucket_prefix), "%s/%s", request->bucket, prefix);
+    bucket_prefix_len = strlen(bucket_prefix);
+
+    pthread_mutex_lock(&server->mutex);
+    for (i = 0; i < STUB_HASH_BUCKETS; i++) {
+        stub_entry *entry;
+        for (entry = server->table[i]; entry; entry = entry->next) {
+            const char *key = entry->name + strlen(request->bucket) + 1;
+            if (strncmp(entry->name, bucket_prefix, bucket_prefix_len) || strcmp(key, marker) <= 0) {
+                continue;
+            }
+            if (count == capacity) {
+                stub_listed *grown;
+                capacity = capacity ? capacity * 2 : 256;
+                grown = (stub_listed *)realloc(listed, capacity * sizeof(stub_listed));
+                if (grown == NULL) {
+                    continue;
+                }
+                listed = grown;
+            }
+            listed[count].key = strdup(key);
+            listed[count].object = entry->object;
+            entry->object->refs++;
+            count++;
+        }
+    }
+    pthread_mutex_unlock(&server->mutex);
+    if (count > 0) {
+        qsort(listed, count, sizeof(stub_listed), stub_listed_compare);
+    }
+
+    for (i = 0; i < count; i++) {
+        const char *key = listed[i].key;
+        if (key == NULL) {
+            continue;
+        }
+        if (delimiter[0]) {
+            const char *d = strstr(key + strlen(prefix), delimiter);
+            if (d) {
+                size_t len = (size_t)(d - key) + strlen(delimiter);
+                if (len < sizeof(last_prefix) && strlen(last_prefix) == len && !strncmp(last_prefix, key, len)) {
+                    continue;
+                }
+                if (emitted == max_keys) {
+                    truncated = 1;
+                    break;
+                }
+                snprintf(last_prefix, sizeof(last_prefix), "%.*s", (int)len, key);
+                stub_buffer_append(&prefixes, "<CommonPrefixes><Prefix>", 24);
+                stub_buffer_append_xml(&prefixes, last_prefix);
+                stub_buffer_append(&prefixes, "</Prefix></CommonPrefixes>", 26);
+                next_marker = key;
+                emitted++;
+                continue;
+            }
+        }
+        if (emitted == max_keys) {
+            truncated = 1;
+            break;
+        }
+        stub_iso_date(listed[i].object->mtime, date, sizeof(date));
+        stub_buffer_printf(&contents, "<%s><Key>", versions ? "Version" : "Contents");
+        stub_buffer_append_xml(&contents, key);
+        stub_buffer_printf(&contents, "</Key>%s<LastModified>%s</LastModified><ETag>\"%s\"</ETag><Size>%llu</Size>"
+            "<Owner><ID>stub</ID></Owner><StorageClass>STANDARD</StorageClass></%s>",
+            versions ? "<VersionId>null</VersionId><IsLatest>true</IsLatest>" : "",
+            date, listed[i].object->etag, (unsigned long long)listed[i].object->size,
+            versions ? "Version" : "Contents");
+        next_marker = key;
+        emitted++;
+    }
+
+    stub_buffer_printf(&xml, "<?xml version=\"1.0\" encoding=\"UTF-8\"?><%s>"
+        "<Name>%s</Name><Prefix>", versions ? "ListVersionsResult" : "ListBucketResult", request->bucket);
+    stub_buffer_append_xml(&xml, prefix);
+    stub_buffer_printf(&xml, "</Prefix><%s>", versions ? "KeyMarker" : "Marker");
+    stub_buffer_append_xml(&xml, marker);
+    stub_buffer_printf(&xml, "</%s>%s<MaxKeys>%ld</MaxKeys><IsTruncated>%s</IsTruncated>",
+        versions ? "KeyMarker" : "Marker", versions ? "<VersionIdMarker></VersionIdMarker>" : "",
+        max_keys, truncated ? "true" : "false");
+    if (truncated && next_marker) {
+        stub_buffer_printf(&xml, "<%s>", versions ? "NextKeyMarker" : "NextMarker");
+        stub_buffer_append_xml(&xml, next_marker);
+        stub_buffer_printf(&xml, "</%s>%s", versions ? "NextKeyMarker" : "NextMarker",
+            versions ? "<NextVersionIdMarker>null</NextVersionIdMarker>" : "");
+    }
+    if (delimiter[0]) {
+        stub_buffer_append(&xml, "<Delimiter>", 11);
+        stub_buffer_append_xml(&xml, delimiter);
+        stub_buffer_append(&xml, "</Delimiter>", 12);
+    }
+    if (contents.data) {
+        stub_buffer_append(&xml, contents.data, contents.len);
+    }
+    if (prefixes.data) {
+        stub_buffer_append(&xml, prefixes.data, prefixes.len);
+    }
+    stub_buffer_printf(&xml, "</%s>", versions ? "ListVersionsResult" : "ListBucketResult");
+    free(contents.data);
+    free(prefixes.data);
+
+    pthread_mutex_lock(&server->mutex);
+    for (i = 0; i < count; i++) {
+        stub_object_release(listed[i].object);
+        free(listed[i].key);
+    }
+    pthread_mutex_unlock(&server->mutex);
+    free(listed);
+    return stub_respond_xml(conn, request, 200, &xml);
+}
+
+static void stub_xml_unescape(char *text)
+{
+    static const struct {
+        const char *entity;
+        char c;
+    } entities[] = {{"&amp;", '&'}, {"&lt;", '<'}, {"&gt;", '>'}, {"&quot;", '"'}, {"&apos;", '\''}};
+    char *out = text;
+    while (*text) {
+        size_t i;
+        int replaced = 0;
+        if (*text == '&') {
+            for (i = 0; i < sizeof(entities) / sizeof(entities[0]); i++) {
+                size_t len = strlen(entities[i].entity);
+                if (!strncmp(text, entities[i].entity, len)) {
+                    *out++ = entities[i].c;
+                    text += len;
+                    replaced = 1;
+                    break;
+                }
+            }
+        }
+        if (!replaced) {
+            *out++ = *text++;
+        }
+    }
+    *out = '\0';
+}
+
+static int stub_batch_delete(stub_conn *conn, stub_request *request)
+{
+    obs_stub_server *server = conn->server;
+    stub_buffer xml = {NULL, 0, 0};
+    const char *p = request->body;
+    int quiet = request->body && strstr(request->body, "<Quiet>true</Quiet>") != NULL;
+
+    stub_buffer_append(&xml, "<?xml version=\"1.0\" encoding=\"UTF-8\"?><DeleteResult>", 52);
+    while (p && (p = strstr(p, "<Key>")) != NULL) {
+        char key[STUB_NAME_SIZE];
+        char name[STUB_NAME_SIZE + 256];
+        const char *end = strstr(p + 5, "</Key>");
+        if (end == NULL || (size_t)(end - p - 5) >= sizeof(key)) {
+            break;
+        }
+        memcpy(key, p + 5, (size_t)(end - p - 5));
+        key[end - p - 5] = '\0';
+        stub_xml_unescape(key);
+        snprintf(name, sizeof(name), "%s/%s", request->bucket, key);
+        pthread_mutex_lock(&server->mutex);
+        (void)stub_store_delete(server, name);
+        pthread_mutex_unlock(&server->mutex);
+        if (!quiet) {
+            stub_buffer_append(&xml, "<Deleted><Key>", 14);
+            stub_buffer_append_xml(&xml, key);
+            stub_buffer_append(&xml, "</Key></Deleted>", 16);
+        }
+        p = end + 6;
+    }
+    stub_buffer_append(&xml, "</DeleteResult>", 15);
+    return stub_respond_xml(conn, request, 200, &xml);
+}
+
+/***************************************请求分发*******************************************/
+
+static int stub_dispatch(stub_conn *conn, stub_request *request)
+{
+    const char *method = request->method;
+    char upload_id[64];
+    int has_upload_id = stub_query_get(request->query, "uploadId", upload_id, sizeof(upload_id));
+
+    if (stub_query_get(request->query, "apiversion", NULL, 0)) {
+        int obs_api;
+        pthread_mutex_lock(&conn->server->mutex);
+        obs_api = conn->server->config.obs_api;
+        pthread_mutex_unlock(&conn->server->mutex);
+        return obs_api ? stub_respond(conn, request, 200, "x-obs-api: 3.0\r\n", NULL, 0, 0) :
+            stub_respond_error(conn, request, 404, "NoSuchKey", "The specified key does not exist.");
+    }
+    if (request->bucket[0] == '\0') {
+        stub_buffer xml = {NULL, 0, 0};
+        stub_buffer_printf(&xml, "<?xml version=\"1.0\" encoding=\"UTF-8\"?><ListAllMyBucketsResult>"
+            "<Owner><ID>stub</ID></Owner><Buckets></Buckets></ListAllMyBucketsResult>");
+        return stub_respond_xml(conn, request, 200, &xml);
+    }
+    if (request->key[0] == '\0') {
+        if (!strcmp(method, "GET") && stub_query_get(request->query, "uploads", NULL, 0)) {
+            return stub_list_uploads(conn, request);
+        }
+        if (!strcmp(method, "GET")) {
+            return stub_list_objects(conn, request, stub_query_get(request->query, "versions", NULL, 0));
+        }
+        if (!strcmp(method, "POST") && stub_query_get(request->query, "delete", NULL, 0)) {
+            return stub_batch_delete(conn, request);
+        }
+        if (!strcmp(method, "PUT") || !strcmp(method, "HEAD")) {
+            return stub_respond(conn, request, 200, NULL, NULL, 0, 0);
+        }
+        if (!strcmp(method, "DELETE")) {
+            return stub_respond(conn, request, 204, NULL, NULL, 0, 0);
+        }
+        return stub_respond_error(conn, request, 405, "MethodNotAllowed", "The specified method is not allowed.");
+    }
+    if (!strcmp(method, "GET") && has_upload_id) {
+        return stub_list_parts(conn, request, upload_id);
+    }
+    if (!strcmp(method, "GET") || !strcmp(method, "HEAD")) {
+        return stub_get_object(conn, request);
+    }
+    if (!strcmp(method, "PUT") && stub_query_get(request->query, "metadata", NULL, 0)) {
+        return stub_set_metadata(conn, request);
+    }
+    if (!strcmp(method, "PUT")) {
+        return has_upload_id ? stub_upload_part(conn, request, upload_id) : stub_put_object(conn, request);
+    }
+    if (!strcmp(method, "POST")) {
+        if (stub_query_get(request->query, "uploads", NULL, 0)) {
+            return stub_initiate_upload(conn, request);
+        }
+        if (has_upload_id) {
+            return stub_complete_upload(conn, request, upload_id);
+        }
+    }
+    if (!strcmp(method, "DELETE")) {
+        return has_upload_id ? stub_abort_upload(conn, request, upload_id) : stub_delete_object(conn, request);
+    }
+    return stub_respond_error(conn, request, 405, "MethodNotAllowed", "The specified method is not allowed.");
+}
+
+/**
+ * 逗号分隔的方法列表中是否包含method
+ */
+static int stub_method_listed(const char *list, const char *method)
+{
+    size_t len = strlen(method);
+    while (*list) {
+        const char *end = strchr(list, ',');
+        size_t item_len = end ? (size_t)(end - list) : strlen(list);
+        if (item_len == len && !strncasecmp(list, method, len)) {
+            return 1;
+        }
+        if (end == NULL) {
+            break;
+        }
+        list = end + 1;
+    }
+    return 0;
+}
+
+static double stub_sample_latency(obs_stub_server *server)
+{
+    const obs_stub_server_config *config = &server->config;
+    double us = 0;
+    switch (config->latency_type) {
+        case OBS_STUB_LATENCY_FIXED:
+            us = config->latency_us;
+            break;
+        case OBS_STUB_LATENCY_UNIFORM:
+            us = config->latency_min_us;
+            if (config->latency_max_us > config->latency_min_us) {
+                us += stub_random(server) * (double)(config->latency_max_us - config->latency_min_us);
+            }
+            break;
+        case OBS_STUB_LATENCY_EXPONENTIAL:
+            us = config->latency_min_us - log(1.0 - stub_random(server)) * (double)config->latency_us;
+            if (config->latency_max_us && us > config->latency_max_us) {
+                us = config->latency_max_us;
+            }
+            break;
+        default:
+            break;
+    }
+    return us / 1e6;
+}
+
+/**
+ * 确定本次请求的时延和故障；调用者需持有server->mutex
+ */
+static stub_fault stub_plan_request(stub_conn *conn, const stub_request *request, double *delay)
+{
+    obs_stub_server *server = conn->server;
+    const obs_stub_server_config *config = &server->config;
+    stub_fault fault = STUB_FAULT_NONE;
+    double roll;
+
+    conn->bandwidth = config->bandwidth;
+    conn->truncate = 0;
+    *delay = stub_sample_latency(server);
+    if (server->fault_methods[0] && !stub_method_listed(server->fault_methods, request->method)) {
+        return STUB_FAULT_NONE;
+    }
+    roll = stub_random(server);
+    if ((roll -= config->reset_rate) < 0) {
+        fault = STUB_FAULT_RESET;
+    }
+    else if ((roll -= config->truncate_rate) < 0) {
+        fault = STUB_FAULT_TRUNCATE;
+        conn->truncate = 1;
+    }
+    else if ((roll -= config->error_rate) < 0) {
+        fault = STUB_FAULT_ERROR;
+    }
+    else if ((roll -= config->slowdown_rate) < 0) {
+        fault = STUB_FAULT_SLOWDOWN;
+    }
+    if (fault == STUB_FAULT_RESET || fault == STUB_FAULT_TRUNCATE) {
+        server->stats.injected_resets++;
+    }
+    else if (fault != STUB_FAULT_NONE) {
+        server->stats.injected_errors++;
+    }
+    return fault;
+}
+
+static void *stub_conn_thread(void *arg)
+{
+    stub_conn *conn = (stub_conn *)arg;
+    obs_stub_server *server = conn->server;
+    stub_request *request = (stub_request *)malloc(sizeof(stub_request));
+
+    while (request != NULL) {
+        stub_fault fault;
+        double delay = 0;
+        int ret = stub_read_request(conn, request);
+        if (ret == 0) {
+            pthread_mutex_lock(&server->mutex);
+            server->stats.requests++;
+            server->stats.bytes_received += request->body_len;
+            snprintf(request->request_id, sizeof(request->request_id), "stub%016llx",
+                (unsigned long long)++server->next_request_id);
+            fault = stub_plan_request(conn, request, &delay);
+            pthread_mutex_unlock(&server->mutex);
+            stub_sleep(delay);
+            if (fault == STUB_FAULT_RESET) {
+                stub_reset(conn);
+                ret = -1;
+            }
+            else if (fault == STUB_FAULT_ERROR) {
+                ret = stub_respond_error(conn, request, 500, "InternalError",
+                    "We encountered an internal error. Please try again.");
+            }
+            else if (fault == STUB_FAULT_SLOWDOWN) {
+                ret = stub_respond_error(conn, request, 503, "SlowDown", "Please reduce your request rate.");
+            }
+            else {
+                ret = stub_dispatch(conn, request);
+            }
+        }
+        free(request->body);
+        if (ret != 0 || !request->keep_alive) {
+            break;
+        }
+    }
+    free(request);
+
+    close(conn->fd);
+    pthread_mutex_lock(&server->mutex);
+    if (conn->prev) {
+        conn->prev->next = conn->next;
+    }
+    else {
+        server->conns = conn->next;
+    }
+    if (conn->next) {
+        conn->next->prev = conn->prev;
+    }
+    pthread_cond_broadcast(&server->conn_cond);
+    pthread_mutex_unlock(&server->mutex);
+    free(conn);
+    return NULL;
+}
+
+static void *stub_accept_thread(void *arg)
+{
+    obs_stub_server *server = (obs_stub_server *)arg;
+    for (;;) {
+        pthread_t thread;
+        pthread_attr_t attr;
+        stub_conn *conn;
+        int one = 1;
+        int fd = accept(server->listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            break;
+        }
+        (void)setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        conn = (stub_conn *)malloc(sizeof(stub_conn));
+        if (conn == NULL) {
+            close(fd);
+            continue;
+        }
+        conn->server = server;
+        conn->fd = fd;
+        conn->pos = 0;
+        conn->len = 0;
+        conn->prev = NULL;
+        conn->bandwidth = 0;
+        conn->truncate = 0;
+        memset(&conn->tx, 0, sizeof(conn->tx));
+        memset(&conn->rx, 0, sizeof(conn->rx));
+        pthread_mutex_lock(&server->mutex);
+        if (server->stopping) {
+            pthread_mutex_unlock(&server->mutex);
+            close(fd);
+            free(conn);
+            break;
+        }
+        conn->next = server->conns;
+        if (server->conns) {
+            server->conns->prev = conn;
+        }
+        server->conns = conn;
+        server->stats.connections++;
+        pthread_mutex_unlock(&server->mutex);
+
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        if (pthread_create(&thread, &attr, stub_conn_thread, conn) != 0) {
+            pthread_mutex_lock(&server->mutex);
+            server->conns = conn->next;
+            if (conn->next) {
+                conn->next->prev = NULL;
+            }
+            pthread_mutex_unlock(&server->mutex);
+            close(fd);
+            free(conn);
+        }
+        pthread_attr_destroy(&attr);
+    }
+    return NULL;
+}
+
+/***************************************对外接口*******************************************/
+
+void obs_stub_server_init_config(obs_stub_server_config *config)
+{
+    memset(config, 0, sizeof(obs_stub_server_config));
+}
+
+/**
+ * 保存除port和seed外的参数；fault_methods拷贝到服务内部
+ */
+static void stub_apply_config(obs_stub_server *server, const obs_stub_server_config *config)
+{
+    unsigned short port = server->config.port;
+    unsigned int seed = server->config.seed;
+    server->config = *config;
+    server->config.port = port;
+    server->config.seed = seed;
+    server->config.fault_methods = NULL;
+    snprintf(server->fault_methods, sizeof(server->fault_methods), "%s",
+        config->fault_methods ? config->fault_methods : "");
+}
+
+int obs_stub_server_start(const obs_stub_server_config *config, obs_stub_server **server_return)
+{
+    obs_stub_server *server = (obs_stub_server *)calloc(1, sizeof(obs_stub_server));
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    int one = 1;
+
+    *server_return = NULL;
+    if (server == NULL) {
+        return -1;
+    }
+    if (config) {
+        server->config.port = config->port;
+        server->config.seed = config->seed;
+        stub_apply_config(server, config);
+    }
+    server->rng = server->config.seed ? server->config.seed : (uint64_t)time(NULL) ^ ((uint64_t)getpid() << 32);
+    server->rng = server->rng ? server->rng : 1;
+    server->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (server->listen_fd < 0) {
+        free(server);
+        return -1;
+    }
+    (void)setsockopt(server->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(server->config.port);
+    if (bind(server->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(server->listen_fd, 128) != 0 ||
+        getsockname(server->listen_fd, (struct sockaddr *)&addr, &addr_len) != 0) {
+        close(server->listen_fd);
+        free(server);
+        return -1;
+    }
+    server->port = ntohs(addr.sin_port);
+    pthread_mutex_init(&server->mutex, NULL);
+    pthread_cond_init(&server->conn_cond, NULL);
+    if (pthread_create(&server->accept_thread, NULL, stub_accept_thread, server) != 0) {
+        pthread_cond_destroy(&server->conn_cond);
+        pthread_mutex_destroy(&server->mutex);
+        close(server->listen_fd);
+        free(server);
+        return -1;
+    }
+    *server_return = server;
+    return 0;
+}
+
+void obs_stub_server_update_config(obs_stub_server *server, const obs_stub_server_config *config)
+{
+    pthread_mutex_lock(&server->mutex);
+    stub_apply_config(server, config);
+    pthread_mutex_unlock(&server->mutex);
+}
+
+unsigned short obs_stub_server_port(const obs_stub_server *server)
+{
+    return server->port;
+}
+
+void obs_stub_server_get_stats(obs_stub_server *server, obs_stub_server_stats *stats)
+{
+    pthread_mutex_lock(&server->mutex);
+    *stats = server->stats;
+    pthread_mutex_unlock(&server->mutex);
+}
+
+void obs_stub_server_stop(obs_stub_server *server)
+{
+    stub_conn *conn;
+    stub_upload *upload;
+    unsigned int i;
+    if (server == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&server->mutex);
+    server->stopping = 1;
+    pthread_mutex_unlock(&server->mutex);
+    shutdown(server->listen_fd, SHUT_RDWR);
+    pthread_join(server->accept_thread, NULL);
+    close(server->listen_fd);
+
+    // 唤醒阻塞在recv上的连接线程，等待全部退出
+    pthread_mutex_lock(&server->mutex);
+    for (conn = server->conns; conn; conn = conn->next) {
+        shutdown(conn->fd, SHUT_RDWR);
+    }
+    while (server->conns) {
+        pthread_cond_wait(&server->conn_cond, &server->mutex);
+    }
+    pthread_mutex_unlock(&server->mutex);
+
+    for (i = 0; i < STUB_HASH_BUCKETS; i++) {
+        while (server->table[i]) {
+            stub_entry *entry = server->table[i];
+            server->table[i] = entry->next;
+            stub_object_release(entry->object);
+            free(entry->name);
+            free(entry);
+        }
+    }
+    while ((upload = server->uploads) != NULL) {
+        server->uploads = upload->next;
+        stub_upload_free(upload);
+    }
+    pthread_cond_destroy(&server->conn_cond);
+    pthread_mutex_destroy(&server->mutex);
+    free(server);
+}
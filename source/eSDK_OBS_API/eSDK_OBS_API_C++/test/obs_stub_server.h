@@ -0,0 +1,94 @@
+/*********************************************************************************
+* Copyright 2024 Huawei Technologies Co.,Ltd.
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+* this file except in compliance with the License.  You may obtain a copy of the
+* License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed
+* under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+* CONDITIONS OF ANY KIND, either express or implied.  See the License for the
+* specific language governing permissions and limitations under the License.
+**********************************************************************************/
+#ifndef OBS_STUB_SERVER_H
+#define OBS_STUB_SERVER_H
+
+#include <stdint.h>
+
+/**
+ * 仅监听127.0.0.1的内存版OBS兼容服务，用于性能测试和离线测试
+ *
+ * 只支持路径方式访问（/bucket/key），不校验签名，对象保存在内存中，不支持多版本
+ * （每个对象只有一个版本"null"）。
+ * 支持的操作：对象PUT/GET/HEAD/DELETE/拷贝、范围读取和条件请求、
+ * 分段上传（初始化/上传段/列举段/合并/取消）、列举对象和多版本对象、批量删除、
+ * 创建/HEAD/删除桶、?apiversion探测、?metadata修改元数据。
+ * Content-Encoding和x-amz-meta-/x-obs-meta-头随对象保存并在GET/HEAD时原样返回
+ *
+ * 可配置每请求时延分布、每连接带宽限速，以及按概率注入500/503 SlowDown、
+ * 响应前断连和响应体发送一半后断连，用于离线复现吞吐和失败路径
+ */
+
+typedef enum
+{
+    OBS_STUB_LATENCY_NONE = 0,
+    OBS_STUB_LATENCY_FIXED,                   // 固定latency_us
+    OBS_STUB_LATENCY_UNIFORM,                 // [latency_min_us, latency_max_us]均匀分布
+    OBS_STUB_LATENCY_EXPONENTIAL              // latency_min_us + 均值为latency_us的指数分布
+} obs_stub_latency_type;
+
+typedef struct obs_stub_server obs_stub_server;
+
+typedef struct obs_stub_server_config
+{
+    unsigned short port;                      // 0表示由系统分配端口
+    unsigned int seed;                        // 随机数种子，0表示按时间生成
+    obs_stub_latency_type latency_type;       // 请求体读完后、处理前注入的时延
+    unsigned int latency_us;
+    unsigned int latency_min_us;
+    unsigned int latency_max_us;              // EXPONENTIAL时为截断值，0表示不截断
+    uint64_t bandwidth;                       // 每连接每方向的字节/秒，0表示不限速
+    double error_rate;                        // 返回500 InternalError的概率
+    double slowdown_rate;                     // 返回503 SlowDown的概率
+    double reset_rate;                        // 不响应直接RST断连的概率
+    double truncate_rate;                     // 响应体发送一半后RST断连的概率
+    const char *fault_methods;                // 只对这些方法注入故障，如"GET,PUT"，NULL表示全部
+    int obs_api;                              // 非0时?apiversion返回x-obs-api: 3.0
+} obs_stub_server_config;
+
+typedef struct obs_stub_server_stats
+{
+    uint64_t requests;
+    uint64_t connections;
+    uint64_t bytes_received;                  // 请求体字节数
+    uint64_t bytes_sent;                      // 响应体字节数
+    uint64_t objects;                         // 当前保存的对象数
+    uint64_t injected_errors;                 // 注入的500/503次数
+    uint64_t injected_resets;                 // 注入的断连次数
+} obs_stub_server_stats;
+
+void obs_stub_server_init_config(obs_stub_server_config *config);
+
+/**
+ * 启动服务，监听与处理均在后台线程中进行
+ *
+ * @return 0成功，-1失败
+ */
+int obs_stub_server_start(const obs_stub_server_config *config, obs_stub_server **server);
+
+/**
+ * 运行中修改时延、限速和故障注入参数，port和seed不变，对之后的请求生效
+ */
+void obs_stub_server_update_config(obs_stub_server *server, const obs_stub_server_config *config);
+
+unsigned short obs_stub_server_port(const obs_stub_server *server);
+
+void obs_stub_server_get_stats(obs_stub_server *server, obs_stub_server_stats *stats);
+
+/**
+ * 停止监听、断开所有连接并释放全部对象
+ */
+void obs_stub_server_stop(obs_stub_server *server);
+
+#endif /* OBS_STUB_SERVER_H */
@@ -0,0 +1,139 @@
+/*********************************************************************************
+* Copyright 2024 Huawei Technologies Co.,Ltd.
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+* this file except in compliance with the License.  You may obtain a copy of the
+* License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed
+* under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+* CONDITIONS OF ANY KIND, either express or implied.  See the License for the
+* specific language governing permissions and limitations under the License.
+**********************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "eSDKOBS.h"
+
+/**
+ * 批量临时授权URL生成性能测试
+ *
+ * 用法: temp_url_batch_bench [key数量] [线程数] [轮数]
+ * 输出逐个调用create_presigned_url与create_presigned_url_batch的URLs/sec及URLs/sec/core
+ */
+
+#define BENCH_DEFAULT_KEY_COUNT  100000
+#define BENCH_DEFAULT_THREADS    4
+#define BENCH_DEFAULT_ROUNDS     10
+#define BENCH_KEY_SIZE           64
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void report(const char *name, unsigned int threads, uint64_t urls, double seconds)
+{
+    double rate = seconds > 0 ? (double)urls / seconds : 0;
+    printf("%-24s threads=%-3u urls=%-10llu time=%8.3fs  %12.0f URLs/sec  %12.0f URLs/sec/core\n",
+           name, threads, (unsigned long long)urls, seconds, rate, rate / threads);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int key_count = (argc > 1) ? (unsigned int)strtoul(argv[1], NULL, 10) : BENCH_DEFAULT_KEY_COUNT;
+    unsigned int threads = (argc > 2) ? (unsigned int)strtoul(argv[2], NULL, 10) : BENCH_DEFAULT_THREADS;
+    unsigned int rounds = (argc > 3) ? (unsigned int)strtoul(argv[3], NULL, 10) : BENCH_DEFAULT_ROUNDS;
+    unsigned int i;
+    unsigned int r;
+
+    if (key_count == 0 || threads == 0 || rounds == 0) {
+        printf("usage: %s [key_count] [threads] [rounds]\n", argv[0]);
+        return 1;
+    }
+
+    obs_status init_status = obs_initialize(OBS_INIT_ALL);
+    if (init_status != OBS_STATUS_OK) {
+        printf("obs_initialize failed: %s\n", obs_get_status_name(init_status));
+        return 1;
+    }
+
+    obs_options options;
+    init_obs_options(&options);
+    options.bucket_options.access_key = "BENCHACCESSKEYID0000";
+    options.bucket_options.secret_access_key = "BenchSecretAccessKey0000000000000000000";
+    options.bucket_options.bucket_name = "bench-bucket";
+    options.bucket_options.host_name = "obs.cn-north-4.myhuaweicloud.com";
+    options.bucket_options.protocol = OBS_PROTOCOL_HTTPS;
+
+    char *key_buffer = (char *)malloc((size_t)key_count * BENCH_KEY_SIZE);
+    const char **keys = (const char **)malloc(sizeof(char *) * key_count);
+    obs_temp_url_batch_entry *entries = (obs_temp_url_batch_entry *)malloc(sizeof(obs_temp_url_batch_entry) * key_count);
+    if (key_buffer == NULL || keys == NULL || entries == NULL) {
+        printf("malloc failed\n");
+        return 1;
+    }
+    for (i = 0; i < key_count; i++) {
+        char *key = key_buffer + (size_t)i * BENCH_KEY_SIZE;
+        snprintf(key, BENCH_KEY_SIZE, "videos/2024/segment-%08u.ts", i);
+        keys[i] = key;
+    }
+
+    obs_temp_url_batch_params params;
+    init_temp_url_batch_params(&params);
+    params.keys = keys;
+    params.key_count = key_count;
+    params.expires = 300;
+
+    obs_temp_url_batch_result result;
+    memset(&result, 0, sizeof(result));
+    result.arena_size = get_presigned_url_batch_size(&options, &params);
+    result.arena = (char *)malloc(result.arena_size);
+    result.entries = entries;
+    if (result.arena == NULL) {
+        printf("malloc arena failed\n");
+        return 1;
+    }
+
+    // 基线：逐个生成
+    obs_temp_url_params single_params;
+    init_temp_url_params(&single_params);
+    single_params.expires = 300;
+    obs_temp_url_result single_result;
+    double start = now_seconds();
+    for (i = 0; i < key_count; i++) {
+        single_params.key = keys[i];
+        create_presigned_url(&options, &single_params, &single_result);
+    }
+    report("create_presigned_url", 1, key_count, now_seconds() - start);
+
+    // 单线程批量
+    params.thread_num = 1;
+    start = now_seconds();
+    for (r = 0; r < rounds; r++) {
+        create_presigned_url_batch(&options, &params, &result);
+    }
+    report("batch", 1, (uint64_t)key_count * rounds, now_seconds() - start);
+
+    // 多线程批量
+    params.thread_num = threads;
+    start = now_seconds();
+    for (r = 0; r < rounds; r++) {
+        create_presigned_url_batch(&options, &params, &result);
+    }
+    report("batch", threads, (uint64_t)key_count * rounds, now_seconds() - start);
+
+    printf("succeeded=%u arena_used=%llu arena_size=%llu\n", result.success_count,
+           (unsigned long long)result.arena_used, (unsigned long long)result.arena_size);
+
+    free(result.arena);
+    free(entries);
+    free((void *)keys);
+    free(key_buffer);
+    obs_deinitialize();
+    return 0;
+}
@@ -0,0 +1,349 @@
+/*********************************************************************************
+* Copyright 2024 Huawei Technologies Co.,Ltd.
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+* this file except in compliance with the License.  You may obtain a copy of the
+* License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed
+* under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+* CONDITIONS OF ANY KIND, either express or implied.  See the License for the
+* specific language governing permissions and limitations under the License.
+**********************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// 直接包含实现以访问静态的分桶和计数函数；不链接libeSDKOBS，避免与其中的同名符号重复定义
+#include "../src/metrics.c"
+
+// metrics.c依赖的库内其他符号，由测试提供最小实现
+void COMMLOG(OBS_LOGLEVEL level, const char *pszFormat, ...)
+{
+    (void)level;
+    (void)pszFormat;
+}
+
+const char *obs_get_status_name(obs_status status)
+{
+    switch (status) {
+        case OBS_STATUS_OK:
+            return "OK";
+        case OBS_STATUS_NoSuchKey:
+            return "NoSuchKey";
+        case OBS_STATUS_ServiceUnavailable:
+            return "ServiceUnavailable";
+        case OBS_STATUS_ConnectionFailed:
+            return "ConnectionFailed";
+        default:
+            return "Unknown";
+    }
+}
+
+// 测试结果统计
+static int tests_run = 0;
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+// 测试辅助宏
+#define TEST_START(name) \
+    printf("\n=== 开始测试: %s ===\n", name); \
+    tests_run++;
+
+#define TEST_PASS() \
+    printf("  [PASS]\n"); \
+    tests_passed++;
+
+#define TEST_FAIL(message) \
+    printf("  [FAIL] %s\n", message); \
+    tests_failed++;
+
+#define ASSERT_EQUAL64(expected, actual, message) \
+    if ((uint64_t)(expected) != (uint64_t)(actual)) { \
+        printf("  [FAIL] %s: 期望=%llu, 实际=%llu\n", message, \
+               (unsigned long long)(expected), (unsigned long long)(actual)); \
+        tests_failed++; \
+        return; \
+    }
+
+#define ASSERT_CONTAINS(text, expected) \
+    if (strstr(text, expected) == NULL) { \
+        printf("  [FAIL] 输出中缺少: %s", expected); \
+        tests_failed++; \
+        return; \
+    }
+
+static void record(obs_metrics_snapshot *counters, obs_metrics_operation operation, obs_status status,
+    int http_code, int64_t total_us)
+{
+    obs_request_trace trace;
+    memset(&trace, 0, sizeof(trace));
+    trace.operation = operation;
+    trace.status = status;
+    trace.http_code = http_code;
+    trace.total_us = total_us;
+    trace.bytes_sent = 100;
+    trace.bytes_received = 10;
+    trace.new_connections = (http_code == 503) ? 1 : 0;
+    metrics_count_request(counters, &trace);
+}
+
+/**
+ * 测试1：分桶连续且覆盖全部取值，每个值落在[下界, 上界)内
+ */
+static void test_histogram_buckets(void)
+{
+    TEST_START("时延直方图分桶");
+
+    int i;
+    uint64_t value;
+    for (value = 0; value < METRICS_SUB_BUCKETS; value++) {
+        ASSERT_EQUAL64(value, metrics_bucket_index(value), "小于4微秒时每个值一个桶");
+    }
+    ASSERT_EQUAL64(8, metrics_bucket_index(8), "8微秒");
+    ASSERT_EQUAL64(9, metrics_bucket_index(10), "10微秒");
+    ASSERT_EQUAL64(11, metrics_bucket_index(15), "15微秒");
+    ASSERT_EQUAL64(12, metrics_bucket_index(16), "16微秒");
+    // 相邻桶首尾相接：本桶上界减一仍在本桶，上界本身在下一个桶
+    for (i = 0; i < OBS_METRICS_HISTOGRAM_BUCKETS - 1; i++) {
+        uint64_t upper = metrics_bucket_upper(i);
+        if (metrics_bucket_index(upper - 1) != i || metrics_bucket_index(upper) != i + 1) {
+            printf("  [FAIL] 桶%d上界=%llu, 上界-1的桶=%d, 上界的桶=%d\n", i, (unsigned long long)upper,
+                   metrics_bucket_index(upper - 1), metrics_bucket_index(upper));
+            tests_failed++;
+            return;
+        }
+    }
+    ASSERT_EQUAL64(OBS_METRICS_HISTOGRAM_BUCKETS - 1, metrics_bucket_index((uint64_t)1 << 40), "超出范围的时延");
+    ASSERT_EQUAL64(OBS_METRICS_HISTOGRAM_BUCKETS - 1, metrics_bucket_index(UINT64_MAX), "最大值");
+
+    TEST_PASS();
+}
+
+/**
+ * 测试2：单次请求计入请求数、错误数、字节数、直方图、响应码和连接计数
+ */
+static void test_count_request(void)
+{
+    TEST_START("请求计数");
+
+    obs_metrics_snapshot *counters = (obs_metrics_snapshot *)calloc(1, sizeof(obs_metrics_snapshot));
+    if (counters == NULL) {
+        TEST_FAIL("calloc失败");
+        return;
+    }
+    record(counters, OBS_METRICS_OP_GET_OBJECT, OBS_STATUS_OK, 200, 1500);
+    record(counters, OBS_METRICS_OP_GET_OBJECT, OBS_STATUS_OK, 200, 700);
+    record(counters, OBS_METRICS_OP_GET_OBJECT, OBS_STATUS_ServiceUnavailable, 503, 90);
+    record(counters, OBS_METRICS_OP_GET_OBJECT, OBS_STATUS_ConnectionFailed, 0, 5);
+
+    const obs_metrics_operation_stats *op = &counters->operations[OBS_METRICS_OP_GET_OBJECT];
+    uint64_t requests = op->requests;
+    uint64_t errors = op->errors;
+    uint64_t sent = op->bytes_sent;
+    uint64_t latency_count = op->latency.count;
+    uint64_t sum_us = op->latency.sum_us;
+    uint64_t max_us = op->latency.max_us;
+    uint64_t bucket_1500 = op->latency.buckets[metrics_bucket_index(1500)];
+    uint64_t code_200 = counters->http_code_count[200];
+    uint64_t code_none = counters->http_code_count[0];
+    uint64_t status_ok = counters->status_count[OBS_STATUS_OK];
+    uint64_t reused = counters->connections_reused;
+    uint64_t created = counters->connections_created;
+    free(counters);
+
+    ASSERT_EQUAL64(4, requests, "请求数");
+    ASSERT_EQUAL64(2, errors, "错误数");
+    ASSERT_EQUAL64(400, sent, "发送字节数");
+    ASSERT_EQUAL64(4, latency_count, "直方图计数");
+    ASSERT_EQUAL64(2295, sum_us, "时延总和");
+    ASSERT_EQUAL64(1500, max_us, "最大时延");
+    ASSERT_EQUAL64(1, bucket_1500, "1500微秒所在桶");
+    ASSERT_EQUAL64(2, code_200, "200响应数");
+    ASSERT_EQUAL64(1, code_none, "未收到响应的请求数");
+    ASSERT_EQUAL64(2, status_ok, "成功状态数");
+    // 未收到响应的请求既不算复用也不算新建
+    ASSERT_EQUAL64(2, reused, "复用连接数");
+    ASSERT_EQUAL64(1, created, "新建连接数");
+
+    TEST_PASS();
+}
+
+/**
+ * 测试3：百分位取所在桶的上界，不小于真实值、不超过最大值，且与真实值同桶
+ */
+static void test_histogram_percentile(void)
+{
+    TEST_START("百分位提取");
+
+    obs_metrics_snapshot *counters = (obs_metrics_snapshot *)calloc(1, sizeof(obs_metrics_snapshot));
+    int value;
+    int percentile;
+    if (counters == NULL) {
+        TEST_FAIL("calloc失败");
+        return;
+    }
+    // 1..1000微秒各一次，第p百分位的真实值为10p
+    for (value = 1; value <= 1000; value++) {
+        record(counters, OBS_METRICS_OP_PUT_OBJECT, OBS_STATUS_OK, 200, value);
+    }
+    obs_metrics_histogram histogram = counters->operations[OBS_METRICS_OP_PUT_OBJECT].latency;
+    free(counters);
+
+    for (percentile = 1; percentile <= 100; percentile++) {
+        uint64_t exact = (uint64_t)percentile * 10;
+        uint64_t result = obs_metrics_histogram_percentile(&histogram, percentile);
+        if (result < exact || result > histogram.max_us ||
+            metrics_bucket_index(result) != metrics_bucket_index(exact)) {
+            printf("  [FAIL] p%d: 真实值=%llu, 结果=%llu\n", percentile, (unsigned long long)exact,
+                   (unsigned long long)result);
+            tests_failed++;
+            return;
+        }
+    }
+    ASSERT_EQUAL64(511, obs_metrics_histogram_percentile(&histogram, 50), "p50取[448,512)桶的上界");
+    ASSERT_EQUAL64(1000, obs_metrics_histogram_percentile(&histogram, 100), "p100不超过最大值");
+    ASSERT_EQUAL64(1, obs_metrics_histogram_percentile(&histogram, 0), "p0取最小值所在桶");
+    ASSERT_EQUAL64(1000, obs_metrics_histogram_percentile(&histogram, 150), "超过100按100处理");
+
+    memset(&histogram, 0, sizeof(histogram));
+    ASSERT_EQUAL64(0, obs_metrics_histogram_percentile(&histogram, 99), "空直方图");
+    ASSERT_EQUAL64(0, obs_metrics_histogram_percentile(NULL, 99), "空指针");
+
+    TEST_PASS();
+}
+
+/**
+ * 测试4：Prometheus导出的内容，以及缓冲区不足时截断在整行处并返回完整长度
+ */
+static void test_export_prometheus(void)
+{
+    TEST_START("Prometheus导出");
+
+    obs_metrics_snapshot *counters = metrics_thread_counters();
+    char small[200];
+    char *full = NULL;
+    char *part = NULL;
+    int length;
+    int i;
+    if (counters == NULL) {
+        TEST_FAIL("取不到线程计数器");
+        return;
+    }
+    record(counters, OBS_METRICS_OP_GET_OBJECT, OBS_STATUS_OK, 200, 1500);
+    record(counters, OBS_METRICS_OP_GET_OBJECT, OBS_STATUS_OK, 200, 3000);
+    record(counters, OBS_METRICS_OP_HEAD_OBJECT, OBS_STATUS_NoSuchKey, 404, 100);
+
+    length = obs_metrics_export_prometheus(NULL, 0);
+    if (length <= 0) {
+        TEST_FAIL("未返回所需长度");
+        return;
+    }
+    full = (char *)malloc(length + 1);
+    if (full == NULL) {
+        TEST_FAIL("malloc失败");
+        return;
+    }
+    ASSERT_EQUAL64(length, obs_metrics_export_prometheus(full, length + 1), "完整输出的返回值");
+    ASSERT_EQUAL64(length, strlen(full), "完整输出的长度");
+
+    // 恰好少一个字节时最后一行写不下
+    ASSERT_EQUAL64(length, obs_metrics_export_prometheus(full, length), "差一字节时的返回值");
+    if ((int)strlen(full) >= length || full[strlen(full) - 1] != '\n') {
+        TEST_FAIL("差一字节时应截断在整行处");
+        free(full);
+        return;
+    }
+    ASSERT_EQUAL64(length, obs_metrics_export_prometheus(full, length + 1), "重新完整导出");
+
+    memset(small, 'x', sizeof(small));
+    ASSERT_EQUAL64(length, obs_metrics_export_prometheus(small, sizeof(small)), "截断时的返回值");
+    if (strlen(small) >= sizeof(small) || strncmp(small, full, strlen(small)) != 0 ||
+        small[strlen(small) - 1] != '\n') {
+        TEST_FAIL("截断的输出应为完整输出的前若干整行");
+        free(full);
+        return;
+    }
+    // 任意大小的缓冲区都得到完整输出中放得下的前若干整行，中间不能缺行
+    part = (char *)malloc(length + 1);
+    if (part == NULL) {
+        TEST_FAIL("malloc失败");
+        free(full);
+        return;
+    }
+    for (i = 1; i <= length; i++) {
+        int written;
+        const char *next_line = NULL;
+        if (obs_metrics_export_prometheus(part, i) != length) {
+            break;
+        }
+        written = (int)strlen(part);
+        if (written >= i || strncmp(part, full, written) != 0 || (written > 0 && part[written - 1] != '\n')) {
+            break;
+        }
+        // 下一行本可以写下时说明截断过早
+        next_line = strchr(full + written, '\n');
+        if (next_line != NULL && next_line - full + 1 < i) {
+            break;
+        }
+    }
+    free(part);
+    if (i <= length) {
+        printf("  [FAIL] 缓冲区%d字节时输出不是完整输出中放得下的前若干整行\n", i);
+        tests_failed++;
+        free(full);
+        return;
+    }
+    ASSERT_EQUAL64(length, obs_metrics_export_prometheus(small, 1), "一字节缓冲区的返回值");
+    ASSERT_EQUAL64(0, strlen(small), "一字节缓冲区只写结尾");
+
+    ASSERT_CONTAINS(full, "# TYPE obs_sdk_requests_total counter\n");
+    ASSERT_CONTAINS(full, "obs_sdk_requests_total{op=\"get_object\"} 2\n");
+    ASSERT_CONTAINS(full, "obs_sdk_request_errors_total{op=\"head_object\"} 1\n");
+    ASSERT_CONTAINS(full, "obs_sdk_sent_bytes_total{op=\"get_object\"} 200\n");
+    // 1500微秒计入le=0.002048，3000微秒计入le=0.004096
+    ASSERT_CONTAINS(full, "obs_sdk_request_duration_seconds_bucket{op=\"get_object\",le=\"0.001024\"} 0\n");
+    ASSERT_CONTAINS(full, "obs_sdk_request_duration_seconds_bucket{op=\"get_object\",le=\"0.002048\"} 1\n");
+    ASSERT_CONTAINS(full, "obs_sdk_request_duration_seconds_bucket{op=\"get_object\",le=\"0.004096\"} 2\n");
+    ASSERT_CONTAINS(full, "obs_sdk_request_duration_seconds_bucket{op=\"get_object\",le=\"+Inf\"} 2\n");
+    ASSERT_CONTAINS(full, "obs_sdk_request_duration_seconds_sum{op=\"get_object\"} 0.004500\n");
+    ASSERT_CONTAINS(full, "obs_sdk_request_duration_seconds_count{op=\"head_object\"} 1\n");
+    ASSERT_CONTAINS(full, "obs_sdk_http_responses_total{code=\"404\"} 1\n");
+    ASSERT_CONTAINS(full, "obs_sdk_status_total{status=\"NoSuchKey\"} 1\n");
+    if (strstr(full, "op=\"put_object\"") != NULL) {
+        TEST_FAIL("没有请求的操作不应输出");
+        free(full);
+        return;
+    }
+    free(full);
+
+    TEST_PASS();
+}
+
+/**
+ * 主测试函数
+ */
+int main(int argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+    printf("========================================\n");
+    printf("华为云OBS SDK - 指标采集测试\n");
+    printf("========================================\n");
+
+    metrics_initialize();
+    test_histogram_buckets();
+    test_count_request();
+    test_histogram_percentile();
+    test_export_prometheus();
+
+    printf("\n========================================\n");
+    printf("测试结果统计:\n");
+    printf("  运行测试数: %d\n", tests_run);
+    printf("  通过测试数: %d\n", tests_passed);
+    printf("  失败测试数: %d\n", tests_failed);
+    printf("========================================\n");
+
+    return (tests_failed > 0) ? 1 : 0;
+}
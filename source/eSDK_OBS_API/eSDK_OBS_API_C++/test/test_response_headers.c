@@ -0,0 +1,245 @@
+/*********************************************************************************
+* Copyright 2024 Huawei Technologies Co.,Ltd.
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+* this file except in compliance with the License.  You may obtain a copy of the
+* License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed
+* under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+* CONDITIONS OF ANY KIND, either express or implied.  See the License for the
+* specific language governing permissions and limitations under the License.
+**********************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+// 直接包含实现以访问静态的哈希表和分类函数；不链接libeSDKOBS，避免与其中的同名符号重复定义
+#include "../src/response_headers_handler.c"
+
+// response_headers_handler.c依赖的库内其他符号，由测试提供最小实现
+void COMMLOG(OBS_LOGLEVEL level, const char *pszFormat, ...)
+{
+    (void)level;
+    (void)pszFormat;
+}
+
+int is_blank(char c)
+{
+    return ((c == ' ') || (c == '\t'));
+}
+
+// 测试结果统计
+static int tests_run = 0;
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+// 测试辅助宏
+#define TEST_START(name) \
+    printf("\n=== 开始测试: %s ===\n", name); \
+    tests_run++;
+
+#define TEST_PASS() \
+    printf("  [PASS]\n"); \
+    tests_passed++;
+
+#define TEST_FAIL(message) \
+    printf("  [FAIL] %s\n", message); \
+    tests_failed++;
+
+#define ASSERT_EQUAL(expected, actual, message) \
+    if ((expected) != (actual)) { \
+        printf("  [FAIL] %s: 期望=%d, 实际=%d\n", message, (int)(expected), (int)(actual)); \
+        tests_failed++; \
+        return; \
+    }
+
+#define TABLE_SIZE ((int)(sizeof(response_header_table) / sizeof(response_header_table[0])))
+
+static const struct
+{
+    const char *prefix;
+    unsigned char vendor;
+} g_prefixes[] = {
+    {"", RESPONSE_HEADER_VENDOR_NONE},
+    {RESPONSE_HEADER_AMZ_PREFIX, RESPONSE_HEADER_VENDOR_AMZ},
+    {RESPONSE_HEADER_OBS_PREFIX, RESPONSE_HEADER_VENDOR_OBS},
+};
+
+static int build_header_name(char *buffer, size_t size, const char *prefix, const char *name, int upper)
+{
+    int len = snprintf(buffer, size, "%s%s", prefix, name);
+    int i;
+    // 服务端返回的头名大小写不固定，如X-Obs-Request-Id
+    for (i = 0; upper && i < len; i++) {
+        if (i == 0 || buffer[i - 1] == '-') {
+            buffer[i] = (char)toupper((unsigned char)buffer[i]);
+        }
+    }
+    return len;
+}
+
+/**
+ * 测试1：每个表项位于自身哈希值对应的槽位，长度字段与名称一致
+ */
+static void test_table_slots(void)
+{
+    TEST_START("响应头表项槽位与长度");
+
+    int i;
+    for (i = 0; i < TABLE_SIZE; i++) {
+        const response_header_entry *entry = &response_header_table[i];
+        if (entry->name == NULL) {
+            continue;
+        }
+        if ((int)strlen(entry->name) != entry->name_len) {
+            printf("  [FAIL] %s: name_len=%d\n", entry->name, entry->name_len);
+            tests_failed++;
+            return;
+        }
+        if ((int)response_header_hash(entry->name, entry->name_len) != i) {
+            printf("  [FAIL] %s: 槽位=%d, 哈希=%u\n", entry->name, i,
+                   response_header_hash(entry->name, entry->name_len));
+            tests_failed++;
+            return;
+        }
+    }
+
+    TEST_PASS();
+}
+
+/**
+ * 测试2：每个表项在允许的前缀(无前缀、x-amz-、x-obs-)下解析到自身，不允许的前缀不命中
+ */
+static void test_table_self_lookup(void)
+{
+    TEST_START("响应头表项按前缀解析到自身");
+
+    char header[128];
+    int checked = 0;
+    int i;
+    int p;
+    int upper;
+    for (i = 0; i < TABLE_SIZE; i++) {
+        const response_header_entry *entry = &response_header_table[i];
+        if (entry->name == NULL) {
+            continue;
+        }
+        for (p = 0; p < (int)(sizeof(g_prefixes) / sizeof(g_prefixes[0])); p++) {
+            int allowed = (entry->vendors & g_prefixes[p].vendor) != 0;
+            for (upper = 0; upper < 2; upper++) {
+                const response_header_entry *found = NULL;
+                int len = build_header_name(header, sizeof(header), g_prefixes[p].prefix, entry->name, upper);
+                response_header_type type = classify_response_header(header, len, &found);
+                if (allowed && (found != entry || type != (response_header_type)entry->type)) {
+                    printf("  [FAIL] %s 未解析到表项%d, 类型=%d\n", header, i, type);
+                    tests_failed++;
+                    return;
+                }
+                if (!allowed && found == entry) {
+                    printf("  [FAIL] %s 不应匹配表项%d\n", header, i);
+                    tests_failed++;
+                    return;
+                }
+                checked++;
+            }
+        }
+    }
+    printf("  [INFO] 检查头名数量: %d\n", checked);
+
+    TEST_PASS();
+}
+
+/**
+ * 测试3：字符串类表项经response_headers_handler_add写入obs_response_properties对应字段
+ */
+static void test_string_header_dispatch(void)
+{
+    TEST_START("字符串类响应头写入属性字段");
+
+    response_headers_handler handler;
+    char header[160];
+    char value[32];
+    int i;
+    int p;
+    for (i = 0; i < TABLE_SIZE; i++) {
+        const response_header_entry *entry = &response_header_table[i];
+        if (entry->name == NULL || entry->type != RESPONSE_HEADER_STRING) {
+            continue;
+        }
+        for (p = 0; p < (int)(sizeof(g_prefixes) / sizeof(g_prefixes[0])); p++) {
+            const char *stored;
+            int len;
+            if (!(entry->vendors & g_prefixes[p].vendor)) {
+                continue;
+            }
+            snprintf(value, sizeof(value), "value-%d-%d", i, p);
+            len = snprintf(header, sizeof(header), "%s%s: %s\r\n", g_prefixes[p].prefix, entry->name, value);
+            response_headers_handler_initialize(&handler);
+            ASSERT_EQUAL(RESPONSE_HEADER_STRING, response_headers_handler_add(&handler, header, len), header);
+            stored = *(const char **)((char *)&handler.responseProperties + entry->offset);
+            if (stored == NULL || strcmp(stored, value) != 0) {
+                printf("  [FAIL] %s%s: 期望=%s, 实际=%s\n", g_prefixes[p].prefix, entry->name, value,
+                       stored ? stored : "(null)");
+                tests_failed++;
+                return;
+            }
+        }
+    }
+
+    TEST_PASS();
+}
+
+/**
+ * 测试4：不在表中的头按自定义元数据、错误和未知分类
+ */
+static void test_fallback_classification(void)
+{
+    TEST_START("表外响应头分类");
+
+    const response_header_entry *found = NULL;
+    ASSERT_EQUAL(RESPONSE_HEADER_META, classify_response_header("x-obs-meta-owner", 16, &found),
+                 "x-obs-meta-应为元数据");
+    ASSERT_EQUAL(RESPONSE_HEADER_META, classify_response_header("X-Amz-Meta-Owner", 16, &found),
+                 "X-Amz-Meta-应为元数据");
+    ASSERT_EQUAL(RESPONSE_HEADER_UNKNOWN, classify_response_header("meta-owner", 10, &found),
+                 "无前缀的meta-不是元数据");
+    ASSERT_EQUAL(RESPONSE_HEADER_ERROR, classify_response_header("x-obs-some-error-detail", 23, &found),
+                 "包含error的头应为错误");
+    ASSERT_EQUAL(RESPONSE_HEADER_UNKNOWN, classify_response_header("x-obs-unknown", 13, &found),
+                 "未知头");
+    if (found != NULL) {
+        TEST_FAIL("表外头不应返回表项");
+        return;
+    }
+
+    TEST_PASS();
+}
+
+/**
+ * 主测试函数
+ */
+int main(int argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+    printf("========================================\n");
+    printf("华为云OBS SDK - 响应头解析测试\n");
+    printf("========================================\n");
+
+    test_table_slots();
+    test_table_self_lookup();
+    test_string_header_dispatch();
+    test_fallback_classification();
+
+    printf("\n========================================\n");
+    printf("测试结果统计:\n");
+    printf("  运行测试数: %d\n", tests_run);
+    printf("  通过测试数: %d\n", tests_passed);
+    printf("  失败测试数: %d\n", tests_failed);
+    printf("========================================\n");
+
+    return (tests_failed > 0) ? 1 : 0;
+}
@@ -377,6 +377,83 @@ static void test_temp_url_with_custom_params(void)
     }
 }
 
+/**
+ * 测试10：批量生成临时URL，结果应与逐个生成一致
+ */
+static void test_create_presigned_url_batch(void)
+{
+    TEST_START("批量生成临时URL");
+
+    obs_options options;
+    init_obs_options(&options);
+    options.bucket_options.access_key = TEST_ACCESS_KEY;
+    options.bucket_options.secret_access_key = TEST_SECRET_ACCESS_KEY;
+    options.bucket_options.bucket_name = TEST_BUCKET_NAME;
+    options.bucket_options.host_name = TEST_HOST_NAME;
+    options.bucket_options.protocol = OBS_PROTOCOL_HTTPS;
+
+    const char *keys[] = { TEST_OBJECT_KEY, "dir/sub dir/a+b=c.txt", "", "中文对象名", "x~y_z-1.bin" };
+    unsigned int key_count = sizeof(keys) / sizeof(keys[0]);
+
+    obs_temp_url_batch_params params;
+    init_temp_url_batch_params(&params);
+    params.keys = keys;
+    params.key_count = key_count;
+    params.expires = TEST_EXPIRES_TIME;
+    params.thread_num = 3;
+
+    uint64_t arena_size = get_presigned_url_batch_size(&options, &params);
+    if (arena_size == 0) {
+        TEST_FAIL("缓冲区大小应大于0");
+        return;
+    }
+
+    obs_temp_url_batch_entry entries[5];
+    obs_temp_url_batch_result result;
+    memset(&result, 0, sizeof(result));
+    result.arena = (char *)malloc(arena_size);
+    ASSERT_NOT_NULL(result.arena, "分配输出缓冲区失败");
+    result.arena_size = arena_size;
+    result.entries = entries;
+
+    obs_status status = create_presigned_url_batch(&options, &params, &result);
+    if (status != OBS_STATUS_OK) {
+        free(result.arena);
+    }
+    ASSERT_STATUS_OK(status, "批量生成失败");
+    ASSERT_EQUAL(OBS_STATUS_InvalidParameter, entries[2].status, "空key应返回无效参数错误");
+    ASSERT_EQUAL(4, (int)result.success_count, "成功数量应为4");
+
+    unsigned int i;
+    for (i = 0; i < key_count; i++) {
+        if (entries[i].status != OBS_STATUS_OK) {
+            continue;
+        }
+        obs_temp_url_params single_params;
+        init_temp_url_params(&single_params);
+        single_params.key = keys[i];
+        single_params.expires = TEST_EXPIRES_TIME;
+
+        obs_temp_url_result single_result;
+        status = create_presigned_url(&options, &single_params, &single_result);
+        // 跨秒时过期时间戳不同，URL无法直接比较
+        if (status != OBS_STATUS_OK || single_result.expires_timestamp != result.expires_timestamp) {
+            continue;
+        }
+        if (strcmp(single_result.url, result.arena + entries[i].offset) != 0 ||
+            strlen(single_result.url) != entries[i].length) {
+            free(result.arena);
+            TEST_FAIL("批量生成的URL与逐个生成的URL不一致");
+            return;
+        }
+    }
+
+    printf("  [INFO] 批量生成URL数量: %u, 使用缓冲区: %llu\n",
+           result.success_count, (unsigned long long)result.arena_used);
+    free(result.arena);
+    TEST_PASS();
+}
+
 /**
  * 主测试函数
  */
@@ -403,6 +480,7 @@ int main(int argc, char *argv[])
     test_null_parameters();
     test_temp_url_with_version_id();
     test_temp_url_with_custom_params();
+    test_create_presigned_url_batch();
 
     // 清理SDK
     obs_deinitialize();
@@ -0,0 +1,195 @@
+/*********************************************************************************
+* Copyright 2024 Huawei Technologies Co.,Ltd.
+* Licensed under the Apache License, Version 2.0 (the "License"); you may not use
+* this file except in compliance with the License.  You may obtain a copy of the
+* License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software distributed
+* under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+* CONDITIONS OF ANY KIND, either express or implied.  See the License for the
+* specific language governing permissions and limitations under the License.
+**********************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdint.h>
+#include "obs_time_util.h"
+#include "util.h"
+
+// 测试结果统计
+static int tests_run = 0;
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+// 测试辅助宏
+#define TEST_START(name) \
+    printf("\n=== 开始测试: %s ===\n", name); \
+    tests_run++;
+
+#define TEST_PASS() \
+    printf("  [PASS]\n"); \
+    tests_passed++;
+
+#define TEST_FAIL(message) \
+    printf("  [FAIL] %s\n", message); \
+    tests_failed++;
+
+#define ASSERT_EQUAL64(expected, actual, message) \
+    if ((int64_t)(expected) != (int64_t)(actual)) { \
+        printf("  [FAIL] %s: 期望=%lld, 实际=%lld\n", message, \
+               (long long)(expected), (long long)(actual)); \
+        tests_failed++; \
+        return; \
+    }
+
+#define SECONDS_PER_DAY 86400
+
+static int64_t tm_to_seconds(const struct tm *tm)
+{
+    return obs_days_from_civil(tm->tm_year + 1900LL, tm->tm_mon + 1, tm->tm_mday) * SECONDS_PER_DAY +
+        tm->tm_hour * 3600 + tm->tm_min * 60 + tm->tm_sec;
+}
+
+/**
+ * 测试1：已知日期的天数，覆盖1970、闰日、世纪年和1970年之前
+ */
+static void test_days_from_civil(void)
+{
+    TEST_START("公历日期到天数");
+
+    ASSERT_EQUAL64(0, obs_days_from_civil(1970, 1, 1), "1970-01-01");
+    ASSERT_EQUAL64(-1, obs_days_from_civil(1969, 12, 31), "1969-12-31");
+    ASSERT_EQUAL64(11016, obs_days_from_civil(2000, 2, 29), "2000-02-29");
+    ASSERT_EQUAL64(19782, obs_days_from_civil(2024, 2, 29), "2024-02-29");
+    ASSERT_EQUAL64(24855, obs_days_from_civil(2038, 1, 19), "2038-01-19");
+    // 2100年不是闰年，2月28日的下一天是3月1日
+    ASSERT_EQUAL64(obs_days_from_civil(2100, 2, 28) + 1, obs_days_from_civil(2100, 3, 1), "2100-03-01");
+    ASSERT_EQUAL64(-25567, obs_days_from_civil(1900, 1, 1), "1900-01-01");
+    ASSERT_EQUAL64(-135140, obs_days_from_civil(1600, 1, 1), "1600-01-01");
+
+    TEST_PASS();
+}
+
+/**
+ * 测试2：obs_gmtime与libc gmtime_r一致，且经obs_days_from_civil往返得到原值
+ */
+static void test_gmtime_round_trip(void)
+{
+    TEST_START("obs_gmtime往返与gmtime_r对照");
+
+    // 约-400年到+400年，步长不与天、周对齐以覆盖各时刻和星期
+    const int64_t limit = 400LL * 366 * SECONDS_PER_DAY;
+    const int64_t step = 7 * SECONDS_PER_DAY + 3607;
+    int64_t seconds;
+    int checked = 0;
+    for (seconds = -limit; seconds <= limit; seconds += step) {
+        struct tm ours;
+        struct tm libc;
+        time_t value = (time_t)seconds;
+        obs_gmtime(seconds, &ours);
+        if (tm_to_seconds(&ours) != seconds) {
+            printf("  [FAIL] %lld 往返得到 %lld\n", (long long)seconds, (long long)tm_to_seconds(&ours));
+            tests_failed++;
+            return;
+        }
+        if (sizeof(time_t) >= sizeof(int64_t) && gmtime_r(&value, &libc) != NULL &&
+            (ours.tm_year != libc.tm_year || ours.tm_mon != libc.tm_mon || ours.tm_mday != libc.tm_mday ||
+            ours.tm_hour != libc.tm_hour || ours.tm_min != libc.tm_min || ours.tm_sec != libc.tm_sec ||
+            ours.tm_wday != libc.tm_wday || ours.tm_yday != libc.tm_yday)) {
+            printf("  [FAIL] %lld: %04d-%02d-%02d %02d:%02d:%02d wday=%d yday=%d, libc %04d-%02d-%02d wday=%d yday=%d\n",
+                   (long long)seconds, ours.tm_year + 1900, ours.tm_mon + 1, ours.tm_mday, ours.tm_hour,
+                   ours.tm_min, ours.tm_sec, ours.tm_wday, ours.tm_yday, libc.tm_year + 1900, libc.tm_mon + 1,
+                   libc.tm_mday, libc.tm_wday, libc.tm_yday);
+            tests_failed++;
+            return;
+        }
+        checked++;
+    }
+    printf("  [INFO] 检查时刻数量: %d\n", checked);
+
+    TEST_PASS();
+}
+
+/**
+ * 测试3：边界时刻的分解结果
+ */
+static void test_gmtime_boundaries(void)
+{
+    TEST_START("obs_gmtime边界时刻");
+
+    struct tm tm;
+    obs_gmtime(-1, &tm);
+    ASSERT_EQUAL64(69, tm.tm_year, "-1的年份");
+    ASSERT_EQUAL64(11, tm.tm_mon, "-1的月份");
+    ASSERT_EQUAL64(31, tm.tm_mday, "-1的日期");
+    ASSERT_EQUAL64(23, tm.tm_hour, "-1的小时");
+    ASSERT_EQUAL64(59, tm.tm_sec, "-1的秒");
+    ASSERT_EQUAL64(3, tm.tm_wday, "1969-12-31为星期三");
+
+    obs_gmtime(2147483648LL, &tm);
+    ASSERT_EQUAL64(138, tm.tm_year, "2^31的年份");
+    ASSERT_EQUAL64(0, tm.tm_mon, "2^31的月份");
+    ASSERT_EQUAL64(19, tm.tm_mday, "2^31的日期");
+    ASSERT_EQUAL64(3, tm.tm_hour, "2^31的小时");
+    ASSERT_EQUAL64(14, tm.tm_min, "2^31的分钟");
+    ASSERT_EQUAL64(8, tm.tm_sec, "2^31的秒");
+
+    obs_gmtime(1709251199LL, &tm);
+    ASSERT_EQUAL64(1, tm.tm_mon, "2024-02-29的月份");
+    ASSERT_EQUAL64(29, tm.tm_mday, "2024-02-29的日期");
+    ASSERT_EQUAL64(59, tm.tm_yday, "2024-02-29的年内天数");
+    ASSERT_EQUAL64(4, tm.tm_wday, "2024-02-29为星期四");
+
+    TEST_PASS();
+}
+
+/**
+ * 测试4：ISO 8601时间解析，含毫秒、Z和时区偏移
+ */
+static void test_parse_iso8601(void)
+{
+    TEST_START("ISO 8601时间解析");
+
+    ASSERT_EQUAL64(0, parseIso8601Time("1970-01-01T00:00:00Z"), "纪元");
+    ASSERT_EQUAL64(1709251199LL, parseIso8601Time("2024-02-29T23:59:59.000Z"), "闰日");
+    ASSERT_EQUAL64(1709251200LL, parseIso8601Time("2024-03-01T00:00:00Z"), "闰日次日");
+    // 东五区半的本地时间比UTC早5.5小时
+    ASSERT_EQUAL64(1709251199LL - 19800, parseIso8601Time("2024-02-29T23:59:59.000+05:30"), "+05:30偏移");
+    ASSERT_EQUAL64(1709251199LL + 18000, parseIso8601Time("2024-02-29T23:59:59-05:00"), "-05:00偏移");
+    ASSERT_EQUAL64(2147483648LL, parseIso8601Time("2038-01-19T03:14:08.123Z"), "2038年");
+    // -1表示解析失败，1970年之前的时刻取-2验证
+    ASSERT_EQUAL64(-2, parseIso8601Time("1969-12-31T23:59:58+00:00"), "1970年之前");
+    ASSERT_EQUAL64(-1, parseIso8601Time("2024-02-29 23:59:59"), "格式错误");
+    ASSERT_EQUAL64(-1, parseIso8601Time(NULL), "空指针");
+
+    TEST_PASS();
+}
+
+/**
+ * 主测试函数
+ */
+int main(int argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+    printf("========================================\n");
+    printf("华为云OBS SDK - 时间工具测试\n");
+    printf("========================================\n");
+
+    test_days_from_civil();
+    test_gmtime_round_trip();
+    test_gmtime_boundaries();
+    test_parse_iso8601();
+
+    printf("\n========================================\n");
+    printf("测试结果统计:\n");
+    printf("  运行测试数: %d\n", tests_run);
+    printf("  通过测试数: %d\n", tests_passed);
+    printf("  失败测试数: %d\n", tests_failed);
+    printf("========================================\n");
+
+    return (tests_failed > 0) ? 1 : 0;
+}